@@ -0,0 +1,95 @@
+//
+//  Lol Engine — Benchmark program
+//
+//  Copyright © 2005—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  This program is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#if HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <lol/engine.h>
+
+using namespace lol;
+
+static int const AUDIO_FREQUENCY = 48000;
+static int const AUDIO_FRAMES = 256;
+static int const AUDIO_SECONDS = 20;
+
+/* Mix a number of voices with the null backend and report how much
+ * faster than real time it went. */
+void bench_audio(int mode)
+{
+    int const voices = mode == 1 ? 8 : 64;
+
+    audio::init(audio::backend::null, AUDIO_FREQUENCY, 2, AUDIO_FRAMES);
+
+    /* Half the voices are fed from callbacks at the output frequency,
+     * the other half from queues that need resampling. */
+    std::vector<int> queues;
+    std::vector<int16_t> samples(AUDIO_FRAMES * 2);
+    std::vector<float> noise(AUDIO_FRAMES * 4);
+    for (auto &s : samples)
+        s = rand<int16_t>() / 16;
+    for (auto &x : noise)
+        x = rand(-0.1f, 0.1f);
+
+    for (int n = 0; n < voices; ++n)
+    {
+        if (n & 1)
+        {
+            queues.push_back(audio::start_queue(audio::format::sint16le,
+                                                44100, 1, 4096));
+            audio::set_pan(queues.back(), rand(-1.f, 1.f));
+        }
+        else
+        {
+            /* Copy precomputed noise so that we only measure the mixer */
+            audio::start_streaming([&](void *buf, int bytes)
+            {
+                bytes = lol::min(bytes, (int)noise.size() * 4);
+                memcpy(buf, noise.data(), bytes);
+            }, audio::format::float32le, AUDIO_FREQUENCY, 2);
+        }
+    }
+
+    std::vector<int16_t> output(AUDIO_FRAMES * 2);
+    float queue_time = 0.f, render_time = 0.f;
+    lol::timer timer;
+
+    int const runs = AUDIO_SECONDS * AUDIO_FREQUENCY / AUDIO_FRAMES;
+    for (int run = 0; run < runs; ++run)
+    {
+        /* Keep the queues fed, as the game thread would */
+        timer.get();
+        for (int track : queues)
+            while (audio::queued_frames(track) < AUDIO_FRAMES * 2)
+                audio::queue_samples(track, samples.data(),
+                                     (int)samples.size() * 2);
+        queue_time += timer.get();
+
+        audio::render(output.data(), AUDIO_FRAMES);
+        render_time += timer.get();
+    }
+
+    audio::shutdown();
+
+    msg::info("%d voices, %d frames per buffer (%.2f ms latency)\n",
+              voices, AUDIO_FRAMES, 1e3f * AUDIO_FRAMES / AUDIO_FREQUENCY);
+    msg::info("                          seconds   x realtime\n");
+    msg::info("queue samples            %8.3f   %9.1f\n",
+              queue_time, AUDIO_SECONDS / queue_time);
+    msg::info("mix and convert          %8.3f   %9.1f\n",
+              render_time, AUDIO_SECONDS / render_time);
+}
+
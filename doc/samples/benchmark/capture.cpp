@@ -0,0 +1,103 @@
+//
+//  Lol Engine — Benchmark program
+//
+//  Copyright © 2005—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  This program is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#if HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <lol/engine.h>
+
+using namespace lol;
+
+static int const CAPTURE_FRAMES = 120;
+static float const CAPTURE_FPS = 60.f;
+
+/* Record frames from a headless source, which copies a moving window of
+ * a precomputed pattern much like a GPU readback would, and report how
+ * much time the game thread spends on recording. */
+void bench_capture(int mode)
+{
+    ivec2 const size = mode == 1 ? ivec2(640, 360) : ivec2(1920, 1080);
+    int const pixels = size.x * size.y;
+
+    std::vector<u8vec4> source(pixels * 2);
+    for (auto &p : source)
+        p = u8vec4(rand<uint8_t>(), rand<uint8_t>(), rand<uint8_t>(), 255);
+
+    float inline_time = 0.f, game_time = 0.f, total_time = 0.f;
+    lol::timer timer;
+
+    /* The previous approach: a new buffer per frame, converted to 3:3:2
+     * on the calling thread */
+    uint8_t checksum = 0;
+    for (int n = 0; n < CAPTURE_FRAMES; ++n)
+    {
+        timer.get();
+        u8vec4 *buffer = new u8vec4[pixels];
+        memcpy((void *)buffer, source.data() + n * size.x, pixels * sizeof(u8vec4));
+        uint8_t *converted = new uint8_t[pixels];
+        for (int i = 0; i < pixels; ++i)
+            converted[i] = (buffer[i].r & 0xe0) | ((buffer[i].g & 0xe0) >> 3)
+                         | (buffer[i].b >> 6);
+        checksum ^= converted[n];
+        delete[] converted;
+        delete[] buffer;
+        inline_time += timer.get();
+    }
+
+    /* The pipeline, fed at the rate of a running game and never waiting:
+     * frames are dropped when it is full */
+    movie m(size);
+    lol::timer frame_timer;
+    for (int n = 0; n < CAPTURE_FRAMES; ++n)
+    {
+        frame_timer.reset();
+        timer.get();
+        u8vec4 *frame = m.acquire_frame();
+        if (frame)
+        {
+            memcpy((void *)frame, source.data() + n * size.x, pixels * sizeof(u8vec4));
+            m.submit_frame(frame, true);
+        }
+        game_time += timer.get();
+        frame_timer.wait(1.f / CAPTURE_FPS);
+    }
+    int const dropped = m.dropped_frames();
+    m.close();
+
+    /* The pipeline with backpressure, to measure its throughput */
+    movie m2(size);
+    timer.get();
+    for (int n = 0; n < CAPTURE_FRAMES; ++n)
+    {
+        u8vec4 *frame = m2.acquire_frame(true);
+        memcpy((void *)frame, source.data() + n * size.x, pixels * sizeof(u8vec4));
+        m2.submit_frame(frame, true);
+    }
+    m2.close();
+    total_time += timer.get();
+
+    msg::info("%dx%d, %d frames (checksum %02x)\n", size.x, size.y,
+              CAPTURE_FRAMES, checksum);
+    msg::info("                          ms/frame\n");
+    msg::info("inline conversion        %8.3f\n",
+              1e3f * inline_time / CAPTURE_FRAMES);
+    msg::info("pipeline, game thread    %8.3f   (%d frames dropped)\n",
+              1e3f * game_time / CAPTURE_FRAMES, dropped);
+    msg::info("pipeline, throughput     %8.3f\n",
+              1e3f * total_time / CAPTURE_FRAMES);
+}
+
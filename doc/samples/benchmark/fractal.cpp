@@ -0,0 +1,84 @@
+//
+//  Lol Engine — Benchmark program
+//
+//  Copyright © 2005—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  This program is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#if HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <cstdio>
+
+#include <lol/engine.h>
+
+using namespace lol;
+
+static int const FRACTAL_SIZE = 256;
+static int const FRACTAL_ITERATIONS = 2000;
+static int const FRACTAL_RUNS = 3;
+
+/* Render near the Misiurewicz point c = i, which has detail at any depth,
+ * and compare with a few pixels iterated directly with reals. */
+void bench_fractal(int mode)
+{
+    UNUSED(mode);
+
+    static char const *offsets[][2] =
+    {
+        { "1.23e-12", "-6.78e-13" },
+        { "1.23e-52", "-6.78e-53" },
+        { "1.23e-102", "-6.78e-103" },
+    };
+    double const radii[] = { 1e-10, 1e-50, 1e-100 };
+
+    array2d<float> out(ivec2(FRACTAL_SIZE, FRACTAL_SIZE));
+    dvec2 const origin(-1.0, 1.0), step(2.0 / FRACTAL_SIZE, -2.0 / FRACTAL_SIZE);
+    lol::timer timer;
+
+    msg::info("zoom     double (ms)  ldouble (ms)  ref  skip  real (ms/pixel)\n");
+    for (int depth = 0; depth < 3; ++depth)
+    {
+        rcmplx center = rcmplx(real::R_0(), real::R_1())
+                      + rcmplx(real(offsets[depth][0]), real(offsets[depth][1]));
+
+        fractal_renderer renderer;
+        renderer.set_view(center, radii[depth]);
+        renderer.set_max_iterations(FRACTAL_ITERATIONS);
+
+        float result[3] = { 0.f };
+        for (int run = 0; run < FRACTAL_RUNS; ++run)
+        {
+            for (int ld = 0; ld < 2; ++ld)
+            {
+                renderer.set_long_double(ld != 0);
+                timer.get();
+                renderer.render(out, origin, step);
+                result[ld] += timer.get();
+            }
+        }
+
+        /* The naive method, on the first pixels of the top row */
+        timer.get();
+        for (int i = 0; i < 4; ++i)
+        {
+            dvec2 u = (origin + dvec2(i, 0) * step) * radii[depth];
+            rcmplx c = center + rcmplx(real(u.x), real(u.y)), z(0.0);
+            for (int n = 0; n < FRACTAL_ITERATIONS && (double)sqlength(z) < 65536.0; ++n)
+                z = z * z + c;
+        }
+        result[2] = timer.get() / 4;
+
+        fractal_renderer::stats const &stats = renderer.get_stats();
+        msg::info("%-7g  %11.2f  %12.2f  %3d  %4d  %15.2f\n", 1.0 / radii[depth],
+                  result[0] * 1e3f / FRACTAL_RUNS, result[1] * 1e3f / FRACTAL_RUNS,
+                  stats.reference, stats.skipped, result[2] * 1e3f);
+    }
+}
+
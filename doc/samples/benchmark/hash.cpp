@@ -0,0 +1,131 @@
+//
+//  Lol Engine — Benchmark program
+//
+//  Copyright © 2005—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  This program is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#if HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <cstdio>
+#include <map>
+#include <unordered_map>
+
+#include <lol/engine.h>
+
+using namespace lol;
+
+static int const HASH_TABLE_SIZE = 1000;
+static int const HASH_LOOKUPS = 1000 * 1000;
+static int const HASH_RUNS = 10;
+
+/* Visit keys in a cache-unfriendly order */
+static inline int scramble(int i, int count)
+{
+    return (int)((int64_t)i * 7919 % count);
+}
+
+/* Look up names the way the engine does, e.g. input key names or
+ * shader sections, then iterate the whole container. */
+template<typename T>
+static void bench_strings(char const *name, array<std::string> const &keys)
+{
+    float result[2] = { 0.0f };
+    uint32_t checksum = 0;
+    lol::timer timer;
+
+    T m;
+    for (int i = 0; i < keys.count(); ++i)
+        m[keys[i]] = i;
+
+    for (int run = 0; run < HASH_RUNS; ++run)
+    {
+        timer.get();
+        for (int i = 0; i < HASH_LOOKUPS; ++i)
+            checksum += m.find(keys[scramble(i, keys.count())])->second;
+        result[0] += timer.get() * 1e9f / HASH_LOOKUPS;
+
+        timer.get();
+        for (auto const &kv : m)
+            checksum += kv.second;
+        result[1] += timer.get() * 1e9f / keys.count();
+    }
+
+    msg::info("%-20s  %7.2f %7.2f  (%u)\n", name, result[0] / HASH_RUNS,
+              result[1] / HASH_RUNS, checksum);
+}
+
+/* Iterate a pointer-keyed container like the scene's primitive renderers,
+ * either by copying the keys first or by iterating it directly. */
+template<typename T>
+static void bench_pointers(char const *name, array<int> const &storage)
+{
+    float result[2] = { 0.0f };
+    uint32_t checksum = 0;
+    lol::timer timer;
+
+    T m;
+    for (int i = 0; i < storage.count(); ++i)
+        m[(uintptr_t)&storage[i]] = i;
+
+    for (int run = 0; run < HASH_RUNS; ++run)
+    {
+        timer.get();
+        for (uintptr_t key : keys(m))
+            checksum += m[key];
+        result[0] += timer.get() * 1e9f / storage.count();
+
+        timer.get();
+        for (auto const &kv : m)
+            checksum += kv.second;
+        result[1] += timer.get() * 1e9f / storage.count();
+    }
+
+    msg::info("%-20s  %7.2f %7.2f  (%u)\n", name, result[0] / HASH_RUNS,
+              result[1] / HASH_RUNS, checksum);
+}
+
+void bench_hash(int mode)
+{
+    UNUSED(mode);
+
+    array<std::string> keys;
+    for (int i = 0; i < HASH_TABLE_SIZE; ++i)
+        keys << format("SC_Key_%d", i * 37);
+
+    msg::info("String keys           ns/elem\n");
+    msg::info("                       lookup iterate\n");
+    bench_strings<std::map<std::string, int>>("std::map", keys);
+    bench_strings<std::unordered_map<std::string, int>>("std::unordered_map", keys);
+    bench_strings<hash_map<std::string, int>>("hash_map", keys);
+
+    array<int> storage;
+    storage.resize(HASH_TABLE_SIZE);
+
+    msg::info("Pointer keys          ns/elem\n");
+    msg::info("                       keys() iterate\n");
+    bench_pointers<std::map<uintptr_t, int>>("std::map", storage);
+    bench_pointers<hash_map<uintptr_t, int>>("hash_map", storage);
+
+    /* Interning costs one lookup, then comparisons are free */
+    float result = 0.0f;
+    uint32_t checksum = 0;
+    lol::timer timer;
+    for (int run = 0; run < HASH_RUNS; ++run)
+    {
+        timer.get();
+        for (int i = 0; i < HASH_LOOKUPS; ++i)
+            checksum += intern(keys[scramble(i, keys.count())]);
+        result += timer.get() * 1e9f / HASH_LOOKUPS;
+    }
+
+    msg::info("intern()              %7.2f          (%u)\n", result / HASH_RUNS, checksum);
+}
+
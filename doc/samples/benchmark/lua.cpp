@@ -0,0 +1,149 @@
+//
+//  Lol Engine — Benchmark program
+//
+//  Copyright © 2005—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  This program is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#if HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <cstdio>
+
+#include <lol/engine.h>
+#include <lol/lua.h>
+
+using namespace lol;
+
+static int const LUA_CALLS = 1000000;
+static int const LUA_READS = 1000000;
+
+/* A bound object, fetched either by metatable name (the former GetPtr()
+ * path) or through the cached registry reference */
+class BenchLuaObject : public LuaObject
+{
+public:
+    static BenchLuaObject* New(lua_State* l, int arg_nb)
+    {
+        UNUSED(l, arg_nb);
+        return new BenchLuaObject();
+    }
+
+    static int ByName(lua_State* l)
+    {
+        auto obj = (BenchLuaObject**)luaL_checkudata(l, 1, LuaObjectHelper::GetMethodName<BenchLuaObject>());
+        (*obj)->m_count++;
+        return 0;
+    }
+
+    static int Cached(lua_State* l)
+    {
+        auto stack = LuaStack::Begin(l);
+        BenchLuaObject* obj = stack.GetPtr<BenchLuaObject>();
+        obj->m_count++;
+        return stack.End();
+    }
+
+    static const LuaObjectLibrary* GetLib()
+    {
+        static const LuaObjectLibrary lib = LuaObjectLibrary(
+            "BenchObject",
+            { },
+            { { "ByName", &BenchLuaObject::ByName },
+              { "Cached", &BenchLuaObject::Cached } },
+            { });
+        return &lib;
+    }
+
+    int m_count = 0;
+};
+
+/* Vectors passed as separate numbers, as before the userdata types */
+static int scale_floats(lua_State* l)
+{
+    auto stack = LuaStack::Begin(l);
+    vec3 v = stack.Get<vec3>() * 2.f;
+    return (stack << v.x << v.y << v.z).End();
+}
+
+static int scale_vec3(lua_State* l)
+{
+    auto stack = LuaStack::Begin(l);
+    vec3 v = stack.Get<vec3>() * 2.f;
+    return (stack << LuaValue<vec3>(v)).End();
+}
+
+class BenchLuaLoader : public LuaLoader
+{
+public:
+    BenchLuaLoader()
+    {
+        lua_State* l = GetLuaState();
+        LuaObjectHelper::Register<BenchLuaObject>(l);
+        LuaFunction f1(l, "scale_floats", &scale_floats);
+        LuaFunction f2(l, "scale_vec3", &scale_vec3);
+    }
+};
+
+void bench_lua(int mode)
+{
+    UNUSED(mode);
+
+    BenchLuaLoader loader;
+    lol::timer timer;
+
+    static struct { char const *name, *code; } const scripts[] =
+    {
+        { "vec3 as 3 numbers",
+          "local x, y, z = 1, 2, 3\n"
+          "for i = 1, %d do x, y, z = scale_floats(x, y, z) end\n" },
+        { "vec3 as userdata",
+          "local v = vec3(1, 2, 3)\n"
+          "for i = 1, %d do v = scale_vec3(v) end\n" },
+        { "vec3 arithmetic",
+          "local v, w = vec3(1, 2, 3), vec3(0.5)\n"
+          "for i = 1, %d do v = v * w + w end\n" },
+        { "object by name",
+          "local o = BenchObject.New()\n"
+          "for i = 1, %d do o:ByName() end\n" },
+        { "object cached",
+          "local o = BenchObject.New()\n"
+          "for i = 1, %d do o:Cached() end\n" },
+    };
+
+    msg::info("                      ns/call\n");
+    for (auto const &s : scripts)
+    {
+        std::string code = format(s.code, LUA_CALLS);
+        timer.get();
+        loader.ExecLuaCode(code);
+        float t = timer.get();
+        msg::info("%-20s %8.1f\n", s.name, 1e9f * t / LUA_CALLS);
+    }
+
+    /* Reading a global from C++ */
+    loader.ExecLuaCode("speed = 4.5");
+    float sum = 0.f;
+
+    timer.get();
+    for (int i = 0; i < LUA_READS; ++i)
+        sum += loader.Get<float>("speed");
+    float t1 = timer.get();
+
+    LuaRef<float> speed = loader.GetRef<float>("speed");
+    timer.get();
+    for (int i = 0; i < LUA_READS; ++i)
+        sum += speed.Get();
+    float t2 = timer.get();
+
+    msg::info("%-20s %8.1f\n", "global by name", 1e9f * t1 / LUA_READS);
+    msg::info("%-20s %8.1f\n", "global by LuaRef", 1e9f * t2 / LUA_READS);
+    UNUSED(sum);
+}
+
@@ -0,0 +1,149 @@
+//
+//  Lol Engine — Benchmark program
+//
+//  Copyright © 2005—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  This program is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#if HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <cstdio>
+#include <string>
+
+#if _WIN32
+#   include <direct.h>
+#else
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+#include <lol/engine.h>
+
+using namespace lol;
+
+static int const PACK_ASSETS = 10000;
+static char const *PACK_DIR = "lol-bench-pack";
+static char const *PACK_FILE = "lol-bench-pack.lpk";
+
+static std::string asset_name(int n)
+{
+    char buf[32];
+    sprintf(buf, "%05d.bin", n);
+    return buf;
+}
+
+/* Open and read every asset the way the engine used to, probing the
+ * data directories in turn, then through a mounted pack. The first pass
+ * is the first access by this process; the OS cache is warm either way
+ * since the files were just written. */
+void bench_pack(int mode)
+{
+    bool const compress = mode == 2;
+    std::string const dir = std::string(PACK_DIR) + "/";
+    std::string const data_dirs[] = { dir + "a/", dir + "b/", dir };
+
+#if _WIN32
+    _mkdir(PACK_DIR);
+#else
+    mkdir(PACK_DIR, 0755);
+#endif
+
+    static char const *words[] = { "mesh", "tile", "vertex", "shader",
+                                   "texture", "sound", "entity", "scene" };
+    pack_writer writer;
+    size_t total = 0;
+    for (int n = 0; n < PACK_ASSETS; ++n)
+    {
+        std::string data;
+        int len = rand(64, 2048);
+        while ((int)data.size() < len)
+            data += std::string(words[rand(8)]) + " " + std::to_string(rand(100)) + "\n";
+        total += data.size();
+
+        File f;
+        f.Open(dir + asset_name(n), FileAccess::Write, true);
+        f.Write(data);
+        f.Close();
+
+        writer.add(asset_name(n), span<uint8_t const>((uint8_t const *)data.data(),
+                                                      data.size()), compress);
+    }
+    writer.save(PACK_FILE);
+
+    float fs_time[2], mount_time, pack_time[2];
+    size_t checksum = 0;
+    lol::timer timer;
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        timer.get();
+        for (int n = 0; n < PACK_ASSETS; ++n)
+        {
+            for (auto const &candidate : data_dirs)
+            {
+                File f;
+                f.Open(candidate + asset_name(n), FileAccess::Read, true);
+                if (f.IsValid())
+                {
+                    checksum += f.ReadString().size();
+                    break;
+                }
+            }
+        }
+        fs_time[pass] = timer.get();
+    }
+
+    timer.get();
+    sys::mount_pack(PACK_FILE);
+    mount_time = timer.get();
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        timer.get();
+        for (int n = 0; n < PACK_ASSETS; ++n)
+        {
+            File f;
+            f.Open(asset_name(n), FileAccess::Read, true);
+            checksum += f.ReadString().size();
+        }
+        pack_time[pass] = timer.get();
+    }
+
+    sys::unmount_packs();
+
+    File f;
+    f.Open(PACK_FILE, FileAccess::Read, true);
+    int64_t pack_size = f.size();
+    f.Close();
+
+    for (int n = 0; n < PACK_ASSETS; ++n)
+        std::remove((dir + asset_name(n)).c_str());
+    std::remove(PACK_FILE);
+#if _WIN32
+    _rmdir(PACK_DIR);
+#else
+    rmdir(PACK_DIR);
+#endif
+
+    if (checksum != 4 * total)
+        msg::error("pack contents do not match the files\n");
+
+    msg::info("%d assets, %d bytes, pack %d bytes\n",
+              PACK_ASSETS, (int)total, (int)pack_size);
+    msg::info("                           µs/asset\n");
+    msg::info("                         first    again\n");
+    msg::info("filesystem, 3 data dirs %6.2f   %6.2f\n",
+              1e6f * fs_time[0] / PACK_ASSETS, 1e6f * fs_time[1] / PACK_ASSETS);
+    msg::info("pack, mount             %6.2f\n",
+              1e6f * mount_time / PACK_ASSETS);
+    msg::info("pack, open and read     %6.2f   %6.2f\n",
+              1e6f * pack_time[0] / PACK_ASSETS, 1e6f * pack_time[1] / PACK_ASSETS);
+}
+
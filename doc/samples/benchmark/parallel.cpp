@@ -0,0 +1,93 @@
+//
+//  Lol Engine — Benchmark program
+//
+//  Copyright © 2005—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  This program is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#if HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <cstdio>
+
+#include <lol/engine.h>
+
+using namespace lol;
+
+static int const PARALLEL_SIZE = 4 * 1024 * 1024;
+static int const PARALLEL_RUNS = 5;
+
+/* Run each parallel algorithm with 1, 2, 4… threads up to the number of
+ * hardware threads, and report the speedup over the single thread run. */
+void bench_parallel(int mode)
+{
+    UNUSED(mode);
+
+    thread_pool &pool = thread_pool::shared();
+    int const max_threads = pool.size();
+
+    array<float> data, out;
+    for (int i = 0; i < PARALLEL_SIZE; ++i)
+        data << rand(-1.f, 1.f);
+
+    float base[4] = { 0.f };
+    lol::timer timer;
+
+    msg::info("threads   for (ms)  reduce (ms)  scan (ms)  sort (ms)\n");
+    for (int threads = 1; ; threads = lol::min(threads * 2, max_threads))
+    {
+        pool.set_max_threads(threads);
+        float result[4] = { 0.f };
+
+        for (int run = 0; run < PARALLEL_RUNS; ++run)
+        {
+            timer.get();
+            parallel_transform(data, out, [](float x)
+            {
+                return lol::sin(x) * lol::exp(x) + lol::sqrt(x * x + 1.f);
+            });
+            result[0] += timer.get();
+
+            timer.get();
+            float sum = parallel_reduce(data.count(), 0.f,
+                                        [&](ptrdiff_t i) { return data[i] * data[i]; },
+                                        [](float a, float b) { return a + b; });
+            result[1] += timer.get();
+            UNUSED(sum);
+
+            timer.get();
+            parallel_inclusive_scan(data, out, [](float a, float b) { return a + b; });
+            result[2] += timer.get();
+
+            out = data;
+            timer.get();
+            parallel_sort(out);
+            result[3] += timer.get();
+        }
+
+        for (int i = 0; i < 4; ++i)
+        {
+            result[i] *= 1e3f / PARALLEL_RUNS;
+            if (threads == 1)
+                base[i] = result[i];
+        }
+
+        msg::info("%7d  %9.2f    %9.2f  %9.2f  %9.2f\n", threads,
+                  result[0], result[1], result[2], result[3]);
+        msg::info("  speedup %6.2fx    %8.2fx  %8.2fx  %8.2fx\n",
+                  base[0] / result[0], base[1] / result[1],
+                  base[2] / result[2], base[3] / result[3]);
+
+        if (threads == max_threads)
+            break;
+    }
+
+    pool.set_max_threads(0);
+}
+
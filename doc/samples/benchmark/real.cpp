@@ -67,6 +67,21 @@ void bench_real(int mode)
         for (size_t i = 0; i < REAL_TABLE_SIZE / 128; i++)
             (void)exp((real)(int)(i - REAL_TABLE_SIZE / 256));
         result[4] += timer.get() * 128;
+
+        timer.get();
+        for (size_t i = 0; i < REAL_TABLE_SIZE / 128; i++)
+            (void)log(real(1.0 + 0.37 * i));
+        result[5] += timer.get() * 128;
+
+        timer.get();
+        for (size_t i = 0; i < REAL_TABLE_SIZE / 128; i++)
+            (void)atan(real(0.03 * i));
+        result[6] += timer.get() * 128;
+
+        timer.get();
+        for (size_t i = 0; i < REAL_TABLE_SIZE / 128; i++)
+            (void)sqrt(real(1.0 + i));
+        result[7] += timer.get() * 128;
     }
 
     for (size_t i = 0; i < sizeof(result) / sizeof(*result); i++)
@@ -78,5 +93,8 @@ void bench_real(int mode)
     msg::info("real = real / real           %7.3f\n", result[2]);
     msg::info("real = sin(real)             %7.3f\n", result[3]);
     msg::info("real = exp(real)             %7.3f\n", result[4]);
+    msg::info("real = log(real)             %7.3f\n", result[5]);
+    msg::info("real = atan(real)            %7.3f\n", result[6]);
+    msg::info("real = sqrt(real)            %7.3f\n", result[7]);
 }
 
@@ -0,0 +1,81 @@
+//
+//  Lol Engine — Benchmark program
+//
+//  Copyright © 2005—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  This program is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#if HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <cstdio>
+
+#include <lol/engine.h>
+
+using namespace lol;
+
+static int const RESAMPLE_SIZE = 2048;
+static int const RESAMPLE_RUNS = 3;
+
+/* Shrink a large image by four, then enlarge it back, in 8-bit and in
+ * float, with the old and the separable algorithms. */
+void bench_resample(int mode)
+{
+    UNUSED(mode);
+
+    static struct { ResampleAlgorithm algorithm; char const *name; } const list[] =
+    {
+        { ResampleAlgorithm::Bicubic, "Bicubic" },
+        { ResampleAlgorithm::Bresenham, "Bresenham" },
+        { ResampleAlgorithm::Box, "Box" },
+        { ResampleAlgorithm::Mitchell, "Mitchell" },
+        { ResampleAlgorithm::CatmullRom, "CatmullRom" },
+        { ResampleAlgorithm::Lanczos3, "Lanczos3" },
+    };
+
+    ivec2 const big(RESAMPLE_SIZE), small(RESAMPLE_SIZE / 4);
+
+    image src8(big);
+    u8vec4 *data = src8.lock<PixelFormat::RGBA_8>();
+    for (int i = 0; i < big.x * big.y; ++i)
+        data[i] = u8vec4(rand(256), rand(256), rand(256), 255);
+    src8.unlock(data);
+
+    image srcf(src8);
+    srcf.unlock(srcf.lock<PixelFormat::RGBA_F32>());
+    image small8 = src8.Resize(small, ResampleAlgorithm::Box);
+    image smallf = srcf.Resize(small, ResampleAlgorithm::Box);
+
+    lol::timer timer;
+
+    msg::info("                      ms/image\n");
+    msg::info("              shrink8  shrinkf enlarge8 enlargef\n");
+    for (auto const &it : list)
+    {
+        float result[4] = { 0.f };
+        for (int run = 0; run < RESAMPLE_RUNS; ++run)
+        {
+            image const *inputs[] = { &src8, &srcf, &small8, &smallf };
+            for (int i = 0; i < 4; ++i)
+            {
+                /* The old algorithms convert to float; start each run
+                 * from the original format */
+                image tmp(*inputs[i]);
+                timer.get();
+                image dst = tmp.Resize(i < 2 ? small : big, it.algorithm);
+                result[i] += timer.get();
+            }
+        }
+
+        msg::info("%-12s  %7.2f  %7.2f  %7.2f  %7.2f\n", it.name,
+                  result[0] * 1e3f / RESAMPLE_RUNS, result[1] * 1e3f / RESAMPLE_RUNS,
+                  result[2] * 1e3f / RESAMPLE_RUNS, result[3] * 1e3f / RESAMPLE_RUNS);
+    }
+}
+
@@ -0,0 +1,98 @@
+//
+//  Lol Engine — Benchmark program
+//
+//  Copyright © 2005—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  This program is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#if HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <cstdio>
+
+#include <lol/engine.h>
+
+using namespace lol;
+
+static int const TEXTURE_SIZE = 1024;
+
+/* Measure the CPU side of texture preparation on a synthetic image made
+ * of smooth gradients, hard edges and noise: block compression speed
+ * and error, and mipmap chain generation. */
+void bench_texture(int mode)
+{
+    UNUSED(mode);
+
+    ivec2 const size(TEXTURE_SIZE);
+    image src(size);
+    u8vec4 *p = src.lock<PixelFormat::RGBA_8>();
+    for (int y = 0; y < size.y; ++y)
+        for (int x = 0; x < size.x; ++x)
+        {
+            bool edge = ((x / 96) ^ (y / 64)) & 1;
+            ivec3 c(x * 200 / size.x, edge ? 180 : y * 200 / size.y, 128);
+            p[y * size.x + x] = u8vec4((u8vec3)(c + ivec3(rand(32))),
+                                       lol::min(255, (x + y) / 4));
+        }
+    src.unlock(p);
+
+    static struct { CompressedFormat format; char const *name; } const formats[] =
+    {
+        { CompressedFormat::BC1, "BC1" },
+        { CompressedFormat::BC3, "BC3" },
+        { CompressedFormat::ETC2_RGB8, "ETC2 RGB8" },
+        { CompressedFormat::ETC2_RGBA8, "ETC2 RGBA8" },
+    };
+
+    lol::timer timer;
+    float const mpix = size.x * size.y / 1e6f;
+
+    msg::info("                  Mpix/s    RMSE  alpha RMSE\n");
+    for (auto const &f : formats)
+    {
+        timer.get();
+        array<uint8_t> blocks = src.compress(f.format);
+        float t = timer.get();
+
+        image dst = image::decompress(size, f.format,
+                                      span<uint8_t const>(blocks.data(), blocks.count()));
+        u8vec4 const *a = src.lock<PixelFormat::RGBA_8>();
+        u8vec4 const *b = dst.lock<PixelFormat::RGBA_8>();
+        double err = 0.0, aerr = 0.0;
+        for (int i = 0; i < size.x * size.y; ++i)
+        {
+            vec4 d = (vec4)a[i] - (vec4)b[i];
+            err += (d.r * d.r + d.g * d.g + d.b * d.b) / 3.0;
+            aerr += d.a * d.a;
+        }
+        src.unlock(a);
+        dst.unlock(b);
+
+        bool alpha = f.format == CompressedFormat::BC3
+                  || f.format == CompressedFormat::ETC2_RGBA8;
+        msg::info("%-16s %7.2f  %6.2f  %10s\n", f.name, mpix / t,
+                  lol::sqrt(err / (size.x * size.y)),
+                  alpha ? lol::format("%.2f", lol::sqrt(aerr / (size.x * size.y))).c_str() : "-");
+    }
+
+    for (auto filter : { MipmapFilter::Box, MipmapFilter::Kaiser })
+    {
+        timer.get();
+        image level = src;
+        int levels = 1;
+        while (level.size() != ivec2(1))
+        {
+            level = level.mipmap(filter);
+            ++levels;
+        }
+        float t = timer.get();
+        msg::info("%s mip chain, %d levels: %.2f ms\n",
+                  filter == MipmapFilter::Box ? "box" : "Kaiser", levels, 1e3f * t);
+    }
+}
@@ -0,0 +1,114 @@
+//
+//  Lol Engine — Benchmark program
+//
+//  Copyright © 2005—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  This program is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#if HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <cstdio>
+#include <map>
+
+#include <lol/engine.h>
+
+using namespace lol;
+
+static int const TREE_TABLE_SIZE = 100 * 1000;
+static int const TREE_RUNS = 5;
+
+/* Small adapters so that all containers can be timed with the same code */
+static void insert(std::map<int, int> &m, int k, int v) { m[k] = v; }
+static bool lookup(std::map<int, int> &m, int k) { return m.find(k) != m.end(); }
+static void erase(std::map<int, int> &m, int k) { m.erase(k); }
+static int sum(std::map<int, int> const &m)
+{
+    int ret = 0;
+    for (auto const &it : m)
+        ret += it.second;
+    return ret;
+}
+
+template<typename T> static void insert(T &t, int k, int v) { t.insert(k, v); }
+template<typename T> static bool lookup(T &t, int k) { return t.exists(k); }
+template<typename T> static void erase(T &t, int k) { t.erase(k); }
+template<typename T> static int sum(T const &t)
+{
+    int ret = 0;
+    for (auto it : t)
+        ret += it.value;
+    return ret;
+}
+
+template<typename T>
+static void bench_container(char const *name, array<int> const &keys)
+{
+    float result[5] = { 0.0f };
+    int checksum = 0;
+    lol::timer timer;
+
+    for (int run = 0; run < TREE_RUNS; run++)
+    {
+        T t;
+
+        timer.get();
+        for (int i = 0; i < keys.count(); i++)
+            insert(t, keys[i], i);
+        result[0] += timer.get();
+
+        timer.get();
+        for (int i = 0; i < keys.count(); i++)
+            checksum += lookup(t, keys[keys.count() - 1 - i]);
+        result[1] += timer.get();
+
+        timer.get();
+        checksum += sum(t);
+        result[2] += timer.get();
+
+        T copy = t;
+        timer.get();
+        T other = copy;
+        result[3] += timer.get();
+
+        timer.get();
+        for (int i = 0; i < keys.count(); i++)
+            erase(t, keys[i]);
+        result[4] += timer.get();
+    }
+
+    for (size_t i = 0; i < sizeof(result) / sizeof(*result); i++)
+        result[i] *= 1e9f / (TREE_TABLE_SIZE * TREE_RUNS);
+
+    msg::info("%-12s  %7.2f %7.2f %7.2f %7.2f %7.2f  (%d)\n", name,
+              result[0], result[1], result[2], result[3], result[4], checksum);
+}
+
+void bench_tree(int mode)
+{
+    array<int> keys;
+    for (int i = 0; i < TREE_TABLE_SIZE; i++)
+        keys << i;
+
+    switch (mode)
+    {
+    case 1:
+        /* Random order */
+        for (int i = TREE_TABLE_SIZE; i-- > 1; )
+            std::swap(keys[i], keys[rand(i + 1)]);
+        break;
+    }
+
+    msg::info("                          ns/elem\n");
+    msg::info("              insert  lookup iterate    copy   erase\n");
+    bench_container<std::map<int, int>>("std::map", keys);
+    bench_container<avl_tree<int, int>>("avl_tree", keys);
+    bench_container<bplus_tree<int, int>>("bplus_tree", keys);
+}
+
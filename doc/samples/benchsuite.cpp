@@ -23,6 +23,16 @@ using namespace lol;
 void bench_real(int mode);
 void bench_matrix(int mode);
 void bench_half(int mode);
+void bench_audio(int mode);
+void bench_capture(int mode);
+void bench_pack(int mode);
+void bench_texture(int mode);
+void bench_lua(int mode);
+void bench_parallel(int mode);
+void bench_fractal(int mode);
+void bench_tree(int mode);
+void bench_hash(int mode);
+void bench_resample(int mode);
 
 int main(int argc, char **argv)
 {
@@ -48,6 +58,71 @@ int main(int argc, char **argv)
     msg::info("-----------------------------------\n");
     bench_half(2);
 
+    msg::info("------------------------------\n");
+    msg::info(" Audio mixer (8 voices, null)\n");
+    msg::info("------------------------------\n");
+    bench_audio(1);
+
+    msg::info("-------------------------------\n");
+    msg::info(" Audio mixer (64 voices, null)\n");
+    msg::info("-------------------------------\n");
+    bench_audio(2);
+
+    msg::info("-------------------------\n");
+    msg::info(" Frame capture (640x360)\n");
+    msg::info("-------------------------\n");
+    bench_capture(1);
+
+    msg::info("---------------------------\n");
+    msg::info(" Frame capture (1920x1080)\n");
+    msg::info("---------------------------\n");
+    bench_capture(2);
+
+    msg::info("------------------------------\n");
+    msg::info(" Asset lookup (stored pack)\n");
+    msg::info("------------------------------\n");
+    bench_pack(1);
+
+    msg::info("------------------------------\n");
+    msg::info(" Asset lookup (compressed pack)\n");
+    msg::info("------------------------------\n");
+    bench_pack(2);
+
+    msg::info("------------------------------\n");
+    msg::info(" Texture compression (1024x1024)\n");
+    msg::info("------------------------------\n");
+    bench_texture(1);
+
+    msg::info("------------------------------\n");
+    msg::info(" Lua call overhead\n");
+    msg::info("------------------------------\n");
+    bench_lua(1);
+
+    msg::info("------------------------------\n");
+    msg::info(" Parallel algorithms scaling\n");
+    msg::info("------------------------------\n");
+    bench_parallel(1);
+
+    msg::info("------------------------------\n");
+    msg::info(" Deep zoom fractal rendering\n");
+    msg::info("------------------------------\n");
+    bench_fractal(1);
+
+    msg::info("------------------------------\n");
+    msg::info(" Ordered maps (100k random keys)\n");
+    msg::info("------------------------------\n");
+    bench_tree(1);
+
+    msg::info("------------------------------\n");
+    msg::info(" Hash maps and string interning\n");
+    msg::info("------------------------------\n");
+    bench_hash(1);
+
+    msg::info("------------------------------\n");
+    msg::info(" Image resampling (2048x2048)\n");
+    msg::info("------------------------------\n");
+    bench_resample(1);
+
 #if defined _WIN32
     getchar();
 #endif
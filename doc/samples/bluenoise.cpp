@@ -22,7 +22,7 @@ int main(int argc, char **argv)
 {
     UNUSED(argc, argv);
 
-    ivec2 const size(64);
+    ivec2 const size(256);
     auto const &kernel = image::kernel::blue_noise(size, ivec2(8));
 
     image im(size.xy);
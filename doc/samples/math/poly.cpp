@@ -15,6 +15,7 @@
 #endif
 
 #include <cstdio>
+#include <cmath>
 
 #include <lol/engine.h>
 
@@ -24,7 +25,43 @@ int main(int argc, char **argv)
 {
     UNUSED(argc, argv);
 
-    polynomial<polynomial<float>> p;
+    /* Find a minimax approximation of exp() on [-ln(2)/2, ln(2)/2], which
+     * is all that is needed once x is reduced modulo ln(2), and print its
+     * coefficients as C++ code. */
+    remez_solver solver;
+    remez_solver::function f = [](real const &x) { return exp(x); };
+    real const r = real::R_LN2() / 2;
+    polynomial<real> p = solver.run(6, -r, r, f, f);
+    std::printf("%s\n", solver.cpp_table<float>("exp_coeffs").c_str());
+
+    /* Evaluate it over a large array of floats and compare with exp() */
+    polynomial<float> q;
+    for (int i = 0; i <= p.degree(); ++i)
+        q.set(i, (float)p[i]);
+
+    array<float> x;
+    for (int i = 0; i < 1000000; ++i)
+        x << (float)(((double)i / 999999 - 0.5) * std::log(2.0));
+
+    lol::timer timer;
+    array<float> y = q.eval(x);
+    float const t_poly = timer.get();
+
+    array<float> z;
+    z.resize(x.count());
+    timer.get();
+    for (int i = 0; i < x.count(); ++i)
+        z[i] = std::exp(x[i]);
+    float const t_exp = timer.get();
+
+    double error = 0.0;
+    for (int i = 0; i < x.count(); ++i)
+        error = lol::max(error, std::fabs((double)y[i] / std::exp((double)x[i]) - 1.0));
+
+    std::printf("minimax relative error: %g (real), %g (float)\n",
+                (double)solver.error(), error);
+    std::printf("time: %.2f ms (polynomial), %.2f ms (std::exp)\n",
+                t_poly * 1e3f, t_exp * 1e3f);
 
     return EXIT_SUCCESS;
 }
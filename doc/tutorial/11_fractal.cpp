@@ -21,8 +21,6 @@
 #include <lol/engine.h>
 #include "loldebug.h"
 
-#define USE_REAL 0
-
 using namespace lol;
 
 LOLFX_RESOURCE_DECLARE(11_fractal);
@@ -53,6 +51,8 @@ public:
         m_oldmouse = ivec2(0, 0);
 
         m_pixels.resize(m_size.x * m_size.y);
+        m_iterations.resize(m_size / 2);
+        m_renderer.set_max_iterations(MAX_ITERATIONS);
         for (int i = 0; i < 4; i++)
         {
             m_deltashift[i] = real("0");
@@ -99,39 +99,15 @@ public:
         m_position = vec3::zero;
         m_aabb.aa = m_position;
         m_aabb.bb = vec3((vec2)m_window_size, 0);
-
-#if LOL_FEATURE_THREADS
-        /* Spawn worker threads and wait for their readiness. */
-        for (int i = 0; i < MAX_THREADS; i++)
-            m_threads[i] = new thread(std::bind(&Fractal::DoWorkHelper, this, std::placeholders::_1));
-        for (int i = 0; i < MAX_THREADS; i++)
-            m_spawnqueue.pop();
-#endif
     }
 
     ~Fractal()
     {
-#if LOL_FEATURE_THREADS
-        /* Signal worker threads for completion and wait for
-         * them to quit. */
-        for (int i = 0; i < MAX_THREADS; i++)
-            m_jobqueue.push(-1);
-        for (int i = 0; i < MAX_THREADS; i++)
-            m_donequeue.pop();
-#endif
-
         Ticker::Unref(m_centertext);
         Ticker::Unref(m_mousetext);
         Ticker::Unref(m_zoomtext);
     }
 
-    inline f128cmplx TexelToWorldOffset(vec2 texel)
-    {
-        double dx = (0.5 + texel.x - m_size.x / 2) * m_texel2world.x;
-        double dy = (0.5 + m_size.y / 2 - texel.y) * m_texel2world.y;
-        return m_view.radius * f128cmplx(dx, dy);
-    }
-
     inline f128cmplx ScreenToWorldOffset(vec2 pixel)
     {
         /* No 0.5 offset here, because we want to be able to position the
@@ -296,131 +272,26 @@ public:
         {
             m_dirty[m_frame]--;
 
-            for (int i = 0; i < m_size.y; i += MAX_LINES * 2)
-            {
-#if LOL_FEATURE_THREADS
-                m_jobqueue.push(i);
-#else
-                DoWork(i);
-#endif
-            }
-        }
-    }
-
-#if LOL_FEATURE_THREADS
-    void DoWorkHelper(thread *)
-    {
-        m_spawnqueue.push(0);
-        for ( ; ; )
-        {
-            int line = m_jobqueue.pop();
-            if (line == -1)
-                break;
-            DoWork(line);
-            m_donequeue.push(0);
-        }
-        m_donequeue.push(0);
-    };
-#endif
-
-    void DoWork(int line)
-    {
-        double const maxsqlen = 1024;
-        double const k1 = 1.0 / (1 << 10) / (std::log(maxsqlen) / std::log(2.0));
-
-        int jmin = ((m_frame + 1) % 4) / 2 + line;
-        int jmax = jmin + MAX_LINES * 2;
-        if (jmax > m_size.y)
-            jmax = m_size.y;
-        u8vec4 *pixelstart = m_pixels.data()
-                           + m_size.x * (m_size.y / 4 * m_frame + line / 4);
-
-#if USE_REAL
-        rcmplx c = (rcmplx)m_view.center;
-        rcmplx jr0 = (rcmplx)m_view.r0;
-#else
-        f128cmplx c = (f128cmplx)m_view.center;
-        f128cmplx jr0 = (f128cmplx)m_view.r0;
-#endif
-
-        for (int j = jmin; j < jmax; j += 2)
-        for (int i = m_frame % 2; i < m_size.x; i += 2)
-        {
-#if USE_REAL
-            real xr, yr, x0, y0, x1, y1, x2, y2, x3, y3;
-            real sqx0, sqy0, sqx1, sqy1, sqx2, sqy2, sqx3, sqy3;
-            rcmplx z0 = c + rcmplx(TexelToWorldOffset(vec2(ivec2(i, j))));
-            rcmplx r0 = m_julia ? jr0 : z0;
-#else
-            ldouble xr, yr, x0, y0, x1, y1, x2, y2, x3, y3;
-            ldouble sqx0, sqy0, sqx1, sqy1, sqx2, sqy2, sqx3, sqy3;
-            f128cmplx z0 = c + TexelToWorldOffset(vec2(ivec2(i, j)));
-            f128cmplx r0 = m_julia ? jr0 : z0;
-#endif
-
-            x0 = z0.x; y0 = z0.y;
-            xr = r0.x; yr = r0.y;
-            sqx0 = x0 * x0; sqy0 = y0 * y0;
-
-            int iter = MAX_ITERATIONS - 4;
-            for (;;)
-            {
-                /* Unroll the loop: tests are more expensive to do at each
-                 * iteration than the few extra multiplications, at least
-                 * with floats/doubles. */
-                x1 = sqx0 - sqy0 + xr; y1 = x0 * y0 + x0 * y0 + yr;
-                sqx1 = x1 * x1; sqy1 = y1 * y1;
-                x2 = sqx1 - sqy1 + xr; y2 = x1 * y1 + x1 * y1 + yr;
-                sqx2 = x2 * x2; sqy2 = y2 * y2;
-                x3 = sqx2 - sqy2 + xr; y3 = x2 * y2 + x2 * y2 + yr;
-                sqx3 = x3 * x3; sqy3 = y3 * y3;
-                x0 = sqx3 - sqy3 + xr; y0 = x3 * y3 + x3 * y3 + yr;
-                sqx0 = x0 * x0; sqy0 = y0 * y0;
-
-                if ((double)sqx0 + (double)sqy0 >= maxsqlen)
-                    break;
-                iter -= 4;
-                if (iter < 4)
-                    break;
-            }
+            m_renderer.set_view(m_view.center, m_view.radius);
+            m_renderer.set_julia(m_julia, m_view.r0);
 
-            if (iter)
-            {
-                double n = (double)sqx0 + (double)sqy0;
+            /* Each frame renders one pixel out of four, with an offset
+             * that depends on the frame number. */
+            int const i0 = m_frame % 2, j0 = ((m_frame + 1) % 4) / 2;
+            dvec2 origin = dvec2(0.5 + i0 - m_size.x / 2,
+                                 0.5 + m_size.y / 2 - j0) * m_texel2world;
+            dvec2 step = dvec2(2.0, -2.0) * m_texel2world;
+            m_renderer.render(m_iterations, origin, step);
 
-                if ((double)sqx1 + (double)sqy1 >= maxsqlen)
-                {
-                    iter += 3; n = (double)sqx1 + (double)sqy1;
-                }
-                else if ((double)sqx2 + (double)sqy2 >= maxsqlen)
+            u8vec4 *pixels = m_pixels.data() + m_size.x * m_size.y / 4 * m_frame;
+            for (int j = 0; j < m_size.y / 2; ++j)
+                for (int i = 0; i < m_size.x / 2; ++i)
                 {
-                    iter += 2; n = (double)sqx2 + (double)sqy2;
+                    float f = m_iterations[i][j];
+                    int index = (int)((MAX_ITERATIONS - f) * PALETTE_STEP);
+                    *pixels++ = f < 0.f ? u8vec4(0, 0, 0, 255)
+                              : m_palette[lol::clamp(index, 0, m_palette.count() - 1)];
                 }
-                else if ((double)sqx3 + (double)sqy3 >= maxsqlen)
-                {
-                    iter += 1; n = (double)sqx3 + (double)sqy3;
-                }
-
-                if (n > maxsqlen * maxsqlen)
-                    n = maxsqlen * maxsqlen;
-
-                /* Approximate log(sqrt(n))/log(sqrt(maxsqlen)) */
-                double f = iter;
-                union { double n; uint64_t x; } u = { (double)n };
-                double k = (double)(u.x >> 42) - (((1 << 10) - 1) << 10);
-                k *= k1;
-
-                /* Approximate log2(k) in [1,2]. */
-                f += (- 0.344847817623168308695977510213252644185 * k
-                      + 2.024664188044341212602376988171727038739) * k
-                      - 1.674876738008591047163498125918330313237;
-
-                *pixelstart++ = m_palette[(int)(f * PALETTE_STEP)];
-            }
-            else
-            {
-                *pixelstart++ = u8vec4(0, 0, 0, 255);
-            }
         }
     }
 
@@ -489,11 +360,6 @@ public:
 
         if (m_dirty[m_frame])
         {
-#if LOL_FEATURE_THREADS
-            for (int i = 0; i < m_size.y; i += MAX_LINES * 2)
-                m_donequeue.pop();
-#endif
-
             m_dirty[m_frame]--;
 
             m_texture->SetSubData(ivec2(0, m_frame * m_size.y / 2),
@@ -525,18 +391,19 @@ public:
     }
 
 private:
-    static int const MAX_ITERATIONS = 400;
+    static int const MAX_ITERATIONS = 1000;
     static int const PALETTE_STEP = 32;
-    static int const MAX_THREADS = 8;
-    static int const MAX_LINES = 8;
 
-    // 1e-14 for doubles, 1e-17 for long doubles
-    static double constexpr MAX_ZOOM = 1e-17;
+    /* The renderer only needs the view centre to be precise enough,
+     * which default reals allow until about 1e-120. */
+    static double constexpr MAX_ZOOM = 1e-120;
 
     ivec2 m_size, m_window_size, m_oldmouse;
     double m_window2world;
     dvec2 m_texel2world;
     array<u8vec4> m_pixels, m_palette;
+    array2d<float> m_iterations;
+    fractal_renderer m_renderer;
 
     std::shared_ptr<Shader> m_shader;
     ShaderAttrib m_vertexattrib, m_texattrib;
@@ -565,12 +432,6 @@ private:
     vec4 m_texel_settings, m_screen_settings;
     mat4 m_zoom_settings;
 
-#if LOL_FEATURE_THREADS
-    /* Worker threads */
-    thread *m_threads[MAX_THREADS];
-    queue<int> m_spawnqueue, m_jobqueue, m_donequeue;
-#endif
-
     /* Debug information */
     Text *m_centertext, *m_mousetext, *m_zoomtext;
 };
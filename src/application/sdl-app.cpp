@@ -174,6 +174,7 @@ void sdl::app::Tick()
 sdl::app::~app()
 {
 #if LOL_USE_SDL
+    audio::shutdown();
     SDL_Quit();
 #endif
 }
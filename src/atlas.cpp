@@ -0,0 +1,217 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <algorithm>
+#include <climits>
+
+namespace lol
+{
+
+atlas::atlas(ivec2 page_size, int padding)
+  : m_page_size(page_size),
+    m_padding(padding)
+{
+}
+
+int atlas::add(ivec2 size)
+{
+    ivec2 padded = size + ivec2(2 * m_padding);
+    if (size.x <= 0 || size.y <= 0
+         || padded.x > m_page_size.x || padded.y > m_page_size.y)
+        return -1;
+
+    int handle;
+    if (m_free_handles.count())
+        handle = m_free_handles.pop();
+    else
+    {
+        handle = m_allocs.count();
+        m_allocs.push(alloc());
+    }
+
+    m_allocs[handle].page = -1;
+    m_allocs[handle].size = size;
+    m_allocs[handle].live = true;
+
+    for (int i = 0; i < m_pages.count(); ++i)
+        if (place(handle, i))
+            return handle;
+
+    m_pages.push(page_info());
+    reset_page(m_pages.count() - 1);
+    place(handle, m_pages.count() - 1);
+    return handle;
+}
+
+void atlas::remove(int handle)
+{
+    alloc &a = m_allocs[handle];
+    ASSERT(a.live, "removing atlas handle %d twice", handle);
+
+    page_info &p = m_pages[a.page];
+    ivec2 padded = a.size + ivec2(2 * m_padding);
+    p.used -= (int64_t)padded.x * padded.y;
+    p.wasted += (int64_t)padded.x * padded.y;
+    a.live = false;
+    m_free_handles.push(handle);
+
+    /* Empty pages can be reused right away */
+    if (--p.live == 0)
+        reset_page(a.page);
+}
+
+float atlas::waste(int page) const
+{
+    page_info const &p = m_pages[page];
+    int64_t total = p.used + p.wasted;
+    return total ? (float)p.wasted / (float)total : 0.f;
+}
+
+array<int> atlas::defragment(float threshold)
+{
+    array<int> pending, moved;
+
+    for (int i = 0; i < m_pages.count(); ++i)
+    {
+        if (waste(i) <= threshold)
+            continue;
+
+        for (int h = 0; h < m_allocs.count(); ++h)
+            if (m_allocs[h].live && m_allocs[h].page == i)
+                pending.push(h);
+        reset_page(i);
+    }
+
+    /* Tallest first packs best with a skyline */
+    std::sort(pending.data(), pending.data() + pending.count(),
+              [this](int a, int b)
+              {
+                  ivec2 sa = m_allocs[a].size, sb = m_allocs[b].size;
+                  return sa.y != sb.y ? sa.y > sb.y : sa.x > sb.x;
+              });
+
+    for (int h : pending)
+    {
+        int page = m_allocs[h].page;
+        ivec2 origin = m_allocs[h].origin;
+
+        bool done = false;
+        for (int i = 0; i < m_pages.count() && !done; ++i)
+            done = place(h, i);
+        if (!done)
+        {
+            m_pages.push(page_info());
+            reset_page(m_pages.count() - 1);
+            place(h, m_pages.count() - 1);
+        }
+
+        if (m_allocs[h].page != page || m_allocs[h].origin != origin)
+            moved.push(h);
+    }
+
+    return moved;
+}
+
+float atlas::occupancy() const
+{
+    int64_t used = 0;
+    for (auto const &p : m_pages)
+        used += p.used;
+    int64_t total = (int64_t)m_pages.count() * m_page_size.x * m_page_size.y;
+    return total ? (float)used / (float)total : 0.f;
+}
+
+bool atlas::place(int handle, int page)
+{
+    page_info &p = m_pages[page];
+    array<ivec3> &sky = p.skyline;
+    ivec2 padded = m_allocs[handle].size + ivec2(2 * m_padding);
+
+    /* Find the segment where the rectangle’s top ends up lowest, then
+     * prefer the narrowest segment */
+    int best = -1, best_top = INT_MAX, best_width = INT_MAX;
+    for (int i = 0; i < sky.count(); ++i)
+    {
+        if (sky[i].x + padded.x > m_page_size.x)
+            break;
+
+        int y = 0;
+        for (int j = i, left = padded.x; left > 0; left -= sky[j++].z)
+            y = lol::max(y, sky[j].y);
+
+        int top = y + padded.y;
+        if (top > m_page_size.y)
+            continue;
+
+        if (top < best_top || (top == best_top && sky[i].z < best_width))
+        {
+            best = i;
+            best_top = top;
+            best_width = sky[i].z;
+        }
+    }
+
+    if (best < 0)
+        return false;
+
+    ivec3 node(sky[best].x, best_top, padded.x);
+    sky.insert(node, best);
+
+    /* Shrink or remove the segments now covered by the new one */
+    for (int i = best + 1; i < sky.count(); )
+    {
+        int covered = node.x + node.z - sky[i].x;
+        if (covered <= 0)
+            break;
+        if (sky[i].z <= covered)
+        {
+            sky.remove(i);
+            continue;
+        }
+        sky[i].x += covered;
+        sky[i].z -= covered;
+        break;
+    }
+
+    /* Merge neighbouring segments of the same height */
+    for (int i = 0; i + 1 < sky.count(); )
+    {
+        if (sky[i].y == sky[i + 1].y)
+        {
+            sky[i].z += sky[i + 1].z;
+            sky.remove(i + 1);
+        }
+        else
+            ++i;
+    }
+
+    alloc &a = m_allocs[handle];
+    a.page = page;
+    a.origin = ivec2(node.x, best_top - padded.y) + ivec2(m_padding);
+    p.used += (int64_t)padded.x * padded.y;
+    ++p.live;
+    return true;
+}
+
+void atlas::reset_page(int page)
+{
+    page_info &p = m_pages[page];
+    p.skyline.clear();
+    p.skyline.push(ivec3(0, 0, m_page_size.x));
+    p.used = p.wasted = 0;
+    p.live = 0;
+}
+
+} /* namespace lol */
+
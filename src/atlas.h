@@ -0,0 +1,89 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// The atlas class
+// ---------------
+// Packs rectangles into fixed size pages with a bottom-left skyline
+// allocator, creating pages as needed. Freed space is only reclaimed
+// when a page becomes empty or when defragment() repacks it, so callers
+// must be ready for allocations to move.
+//
+// Each rectangle gets a border of padding pixels on every side, that no
+// other rectangle uses. Callers can fill it with copies of the edge
+// pixels so that filtering does not pick up the neighbours.
+//
+
+#include <cstdint>
+
+namespace lol
+{
+
+class atlas
+{
+public:
+    atlas(ivec2 page_size = ivec2(2048), int padding = 1);
+
+    /* Allocate a rectangle and return its handle, or -1 if it cannot
+     * fit in a page */
+    int add(ivec2 size);
+    void remove(int handle);
+
+    inline int page(int handle) const { return m_allocs[handle].page; }
+    inline ivec2 origin(int handle) const { return m_allocs[handle].origin; }
+    inline ivec2 size(int handle) const { return m_allocs[handle].size; }
+    inline int padding() const { return m_padding; }
+
+    /* Ratio of a page’s allocated area that was freed since the page
+     * was last packed */
+    float waste(int page) const;
+
+    /* Repack the pages whose waste exceeds threshold, and return the
+     * handles of the rectangles that moved */
+    array<int> defragment(float threshold = 0.25f);
+
+    inline ivec2 page_size() const { return m_page_size; }
+    inline int page_count() const { return m_pages.count(); }
+
+    /* Ratio of the page area used by live rectangles */
+    float occupancy() const;
+
+private:
+    bool place(int handle, int page);
+    void reset_page(int page);
+
+    struct alloc
+    {
+        int page;
+        ivec2 origin, size;
+        bool live;
+    };
+
+    struct page_info
+    {
+        /* Skyline segments: x, y, width */
+        array<ivec3> skyline;
+        int64_t used, wasted;
+        int live;
+    };
+
+    ivec2 m_page_size;
+    int m_padding;
+    array<alloc> m_allocs;
+    array<int> m_free_handles;
+    array<page_info> m_pages;
+};
+
+} /* namespace lol */
+
@@ -12,8 +12,8 @@
 
 #include <lol/engine-internal.h>
 
-#include <array>
-#include <unordered_set>
+#include <cstdio>
+#include <memory>
 #include <functional>
 
 #if LOL_USE_SDL_MIXER
@@ -26,6 +26,8 @@
 #   endif
 #endif
 
+#include "mixer.h"
+
 // Buffer size, in samples (https://wiki.libsdl.org/SDL_AudioSpec)
 // “[…] refers to the size of the audio buffer in sample frames. A sample frame
 // is a chunk of audio data of the size specified in format multiplied by the
@@ -34,35 +36,20 @@
 
 #define LOL_AUDIO_DEFAULT_TRACKS 8
 #define LOL_AUDIO_DEFAULT_CHANNELS 2
-#define LOL_AUDIO_DEFAULT_FORMAT AUDIO_S16
 #define LOL_AUDIO_DEFAULT_RATE 22050
 
 namespace lol
 {
 
-struct audio_streamer
-{
-    int m_track = -1;
-    std::function<void(void *, int)> m_callback;
-    // Buffer where the streaming client will write, and where the SDL
-    // audio conversion may happen.
-    std::vector<uint8_t> m_convert_buffer;
-    // Remaining bytes in the conversion buffer.
-    int m_extra_bytes = 0;
-    // Buffer used to write the converted audio data for mixing.
-    std::vector<uint8_t> m_output_buffer;
-#if defined LOL_USE_SDL_MIXER
-    SDL_AudioCVT m_convert;
-    Mix_Chunk *m_chunk = nullptr;
-#endif
-};
+// The global mixer and output backend
+static std::unique_ptr<audio_mixer> g_mixer;
+static audio::backend g_backend;
 
-std::unordered_set<std::shared_ptr<audio_streamer>> audio::m_streamers;
-
-// The global audio format
-static int g_frequency, g_channels;
-static audio::format g_format;
+// The output file for the file backend, and how many bytes were written
+static FILE *g_wav_file = nullptr;
+static uint32_t g_wav_bytes = 0;
 
+#if defined LOL_USE_SDL_MIXER
 static audio::format sdl2lol_format(Uint16 sdl_format)
 {
     switch (sdl_format)
@@ -81,75 +68,230 @@ static audio::format sdl2lol_format(Uint16 sdl_format)
     }
 }
 
-static int lol2sdl_format(audio::format format)
+static bool open_device(int frequency, int channels, int frames)
 {
-    switch (format)
+    if (Mix_OpenAudio(frequency, AUDIO_S16SYS, channels, frames) < 0)
     {
-        case audio::format::uint8: return AUDIO_U8;
-        case audio::format::sint8: return AUDIO_S8;
-        case audio::format::uint16le: return AUDIO_U16LSB;
-        case audio::format::uint16be: return AUDIO_U16MSB;
-        case audio::format::sint16le: return AUDIO_S16LSB;
-        case audio::format::sint16be: return AUDIO_S16MSB;
-        case audio::format::sint32le: return AUDIO_S32LSB;
-        case audio::format::sint32be: return AUDIO_S32MSB;
-        case audio::format::float32le: return AUDIO_F32LSB;
-        case audio::format::float32be: return AUDIO_F32MSB;
-        default: return 0;
+        msg::error("error opening audio: %s\n", Mix_GetError());
+        return false;
+    }
+
+    Uint16 sdl_format;
+    if (Mix_QuerySpec(&frequency, &sdl_format, &channels) == 0)
+    {
+        msg::error("error querying audio: %s\n", Mix_GetError());
+        Mix_CloseAudio();
+        return false;
     }
+
+    g_mixer = std::make_unique<audio_mixer>(sdl2lol_format(sdl_format),
+                                            frequency, channels, frames);
+
+    // Our mix is added to whatever SDL_mixer itself played, so that the
+    // application can still use SDL_mixer for music.
+    Mix_SetPostMix([](void *, Uint8 *stream, int bytes)
+    {
+        int frame_bytes = audio::bytes_per_sample(g_mixer->format())
+                        * g_mixer->channels();
+        g_mixer->render(stream, bytes / frame_bytes, true);
+    }, nullptr);
+
+    return true;
+}
+
+static void close_device()
+{
+    Mix_SetPostMix(nullptr, nullptr);
+    Mix_CloseAudio();
+}
+#else
+static bool open_device(int, int, int) { return false; }
+static void close_device() {}
+#endif
+
+// Write a canonical WAV header; called again on shutdown with the
+// final data size.
+static void write_wav_header()
+{
+    int const channels = g_mixer->channels();
+    int const frequency = g_mixer->frequency();
+    int const bytes = audio::bytes_per_sample(g_mixer->format());
+
+    auto u16 = [](uint16_t x) { fputc(x & 0xff, g_wav_file); fputc(x >> 8, g_wav_file); };
+    auto u32 = [&](uint32_t x) { u16((uint16_t)(x & 0xffff)); u16((uint16_t)(x >> 16)); };
+
+    fseek(g_wav_file, 0, SEEK_SET);
+    fwrite("RIFF", 1, 4, g_wav_file);
+    u32(36 + g_wav_bytes);
+    fwrite("WAVEfmt ", 1, 8, g_wav_file);
+    u32(16);
+    u16(1); // PCM
+    u16((uint16_t)channels);
+    u32((uint32_t)frequency);
+    u32((uint32_t)(frequency * channels * bytes));
+    u16((uint16_t)(channels * bytes));
+    u16((uint16_t)(bytes * 8));
+    fwrite("data", 1, 4, g_wav_file);
+    u32(g_wav_bytes);
+    fseek(g_wav_file, 0, SEEK_END);
 }
 
  /*
  * Public audio class
  */
 
-#if defined LOL_USE_SDL_MIXER
+int audio::bytes_per_sample(audio::format format)
+{
+    switch (format)
+    {
+        case audio::format::uint8:
+        case audio::format::sint8:
+            return 1;
+        case audio::format::uint16le:
+        case audio::format::uint16be:
+        case audio::format::sint16le:
+        case audio::format::sint16be:
+            return 2;
+        case audio::format::sint32le:
+        case audio::format::sint32be:
+        case audio::format::float32le:
+        case audio::format::float32be:
+            return 4;
+        default:
+            return 0;
+    }
+}
+
 void audio::init()
 {
-    if (Mix_OpenAudio(LOL_AUDIO_DEFAULT_RATE, LOL_AUDIO_DEFAULT_FORMAT, LOL_AUDIO_DEFAULT_CHANNELS, LOL_AUDIO_DEFAULT_FRAMES) < 0)
+    init(backend::device, LOL_AUDIO_DEFAULT_RATE, LOL_AUDIO_DEFAULT_CHANNELS,
+         LOL_AUDIO_DEFAULT_FRAMES);
+}
+
+void audio::init(backend backend, int frequency, int channels, int frames,
+                 std::string const &path /* = "" */)
+{
+    shutdown();
+
+    g_backend = backend;
+    if (g_backend == backend::device && !open_device(frequency, channels, frames))
     {
-        msg::error("error opening audio: %s\n", Mix_GetError());
-        return;
+        msg::info("no audio device, falling back to null output\n");
+        g_backend = backend::null;
     }
 
-    set_tracks(LOL_AUDIO_DEFAULT_TRACKS);
+    if (g_backend == backend::file)
+    {
+        g_wav_file = fopen(path.c_str(), "wb");
+        if (!g_wav_file)
+        {
+            msg::error("could not open %s for audio output\n", path.c_str());
+            g_backend = backend::null;
+        }
+    }
 
-    Uint16 sdl_format;
-    if (Mix_QuerySpec(&g_frequency, &sdl_format, &g_channels) == 0)
+    // The null and file backends mix to 16-bit PCM, like most devices
+    if (g_backend != backend::device)
+        g_mixer = std::make_unique<audio_mixer>(format::sint16le, frequency,
+                                                channels, frames);
+
+    if (g_wav_file)
     {
-        msg::error("error querying audio: %s\n", Mix_GetError());
+        g_wav_bytes = 0;
+        write_wav_header();
+    }
+
+    set_tracks(LOL_AUDIO_DEFAULT_TRACKS);
+
+    msg::info("audio initialised: backend=%s freq=%dHz channels=%d frames=%d\n",
+              g_backend == backend::device ? "device" :
+              g_backend == backend::file ? "file" : "null",
+              g_mixer->frequency(), g_mixer->channels(), g_mixer->frames());
+}
+
+void audio::shutdown()
+{
+    if (!g_mixer)
         return;
+
+    if (g_backend == backend::device)
+        close_device();
+
+    if (g_wav_file)
+    {
+        write_wav_header();
+        fclose(g_wav_file);
+        g_wav_file = nullptr;
     }
 
-    g_format = sdl2lol_format(sdl_format);
+    g_mixer.reset();
+}
 
-    char const *u = (SDL_AUDIO_ISFLOAT(sdl_format) || SDL_AUDIO_ISSIGNED(sdl_format)) ? "" : "u";
-    char const *t = SDL_AUDIO_ISFLOAT(sdl_format) ? "float" : "int";
-    int b = SDL_AUDIO_BITSIZE(sdl_format);
-    char const *e = b <= 8 ? "" : SDL_AUDIO_ISLITTLEENDIAN(sdl_format) ? "le" : "be";
+int audio::frequency()
+{
+    return g_mixer ? g_mixer->frequency() : 0;
+}
+
+int audio::channels()
+{
+    return g_mixer ? g_mixer->channels() : 0;
+}
+
+audio::format audio::output_format()
+{
+    return g_mixer ? g_mixer->format() : format::unknown;
+}
 
-    msg::info("audio initialised: freq=%dHz format=%s%s%d%s channels=%d\n",
-              g_frequency, u, t, b, e, g_channels);
+float audio::latency()
+{
+    return g_mixer ? (float)g_mixer->frames() / g_mixer->frequency() : 0.f;
 }
 
 void audio::set_tracks(int tracks)
 {
-    Mix_AllocateChannels(tracks);
+#if defined LOL_USE_SDL_MIXER
+    if (g_backend == backend::device)
+        Mix_AllocateChannels(tracks);
+#else
+    UNUSED(tracks);
+#endif
 }
 
 void audio::set_volume(int track, int volume)
 {
-    Mix_Volume(track, volume);
+    if (!g_mixer)
+        return;
+
+    // A negative track means all tracks, like with SDL_mixer
+    for (auto const &v : g_mixer->voices())
+        if (track < 0 || v.first == track)
+            v.second->m_volume = volume / 128.f;
+}
+
+void audio::set_pan(int track, float pan)
+{
+    if (auto voice = g_mixer ? g_mixer->voice(track) : nullptr)
+        voice->m_pan = pan;
 }
 
 void audio::mute_all()
 {
-    Mix_Volume(-1, 0);
+    if (g_mixer)
+        g_mixer->set_master(0.f);
+#if defined LOL_USE_SDL_MIXER
+    if (g_backend == backend::device)
+        Mix_Volume(-1, 0);
+#endif
 }
 
 void audio::unmute_all()
 {
-    Mix_Volume(-1, MIX_MAX_VOLUME);
+    if (g_mixer)
+        g_mixer->set_master(1.f);
+#if defined LOL_USE_SDL_MIXER
+    if (g_backend == backend::device)
+        Mix_Volume(-1, MIX_MAX_VOLUME);
+#endif
 }
 
 int audio::start_streaming(std::function<void(void *, int)> const &f,
@@ -157,82 +299,87 @@ int audio::start_streaming(std::function<void(void *, int)> const &f,
                            int frequency /* = 22050 */,
                            int channels /* = 2 */)
 {
-    static auto trampoline = [](int, void *stream, int bytes, void *udata)
-    {
-        auto s = (audio_streamer *)udata;
+    if (!g_mixer)
+        return -1;
 
-        // If there were still bytes from a previous conversion, copy them.
-        if (s->m_extra_bytes)
-        {
-            int tocopy = lol::min(bytes, s->m_extra_bytes);
-            memcpy(stream, s->m_convert.buf + s->m_convert.len_cvt - s->m_extra_bytes, tocopy);
-            s->m_extra_bytes -= tocopy;
-            bytes -= tocopy;
-            stream = (void *)((uint8_t *)stream + tocopy);
-        }
+    auto voice = std::make_shared<audio_voice>(format, frequency, channels);
+    voice->m_callback = f;
+    return g_mixer->add_voice(voice);
+}
 
-        // Ask the callback for more bytes as long as we need them.
-        while (bytes > 0)
-        {
-            s->m_callback(s->m_convert.buf, s->m_convert.len);
-            if (s->m_convert.needed)
-                SDL_ConvertAudio(&s->m_convert);
-            int tocopy = lol::min(bytes, s->m_convert.len_cvt);
-            s->m_extra_bytes = s->m_convert.len_cvt - tocopy;
-            memcpy(stream, s->m_convert.buf, tocopy);
-            bytes -= tocopy;
-            stream = (void *)((uint8_t *)stream + tocopy);
-        }
-    };
+int audio::start_queue(enum audio::format format /* = audio::format::sint16le */,
+                       int frequency /* = 22050 */,
+                       int channels /* = 2 */,
+                       int frames /* = 4096 */)
+{
+    if (!g_mixer)
+        return -1;
 
-    auto s = std::make_shared<audio_streamer>();
-    m_streamers.insert(s);
+    auto voice = std::make_shared<audio_voice>(format, frequency, channels);
+    voice->m_queue = std::make_unique<spsc_queue<uint8_t>>(
+                         (size_t)frames * voice->m_frame_bytes);
+    return g_mixer->add_voice(voice);
+}
 
-    // Build an audio converter that converts from a given streaming format
-    // to the format SDL was currently initialised with, if necessary.
-    Uint16 sdl_format = lol2sdl_format(format);
-    Uint16 sdl_g_format = lol2sdl_format(g_format);
-    SDL_BuildAudioCVT(&s->m_convert, sdl_format, channels, frequency, sdl_g_format, g_channels, g_frequency);
+int audio::queue_samples(int track, void const *buf, int bytes)
+{
+    auto voice = g_mixer ? g_mixer->voice(track) : nullptr;
+    if (!voice || !voice->m_queue)
+        return 0;
+
+    // Only queue whole frames. The mixer can only free some room in the
+    // meantime, so this never fails.
+    auto &queue = *voice->m_queue;
+    size_t room = queue.capacity() - queue.size();
+    size_t count = lol::min((size_t)bytes, room);
+    count -= count % voice->m_frame_bytes;
+    return (int)queue.push((uint8_t const *)buf, count);
+}
 
-    // This is how many bytes we will ask the streaming callback
-    s->m_convert.len = LOL_AUDIO_DEFAULT_FRAMES * channels * SDL_AUDIO_BITSIZE(sdl_format) / 8;
-    s->m_convert_buffer.resize(s->m_convert.len * s->m_convert.len_mult);
-    s->m_convert.buf = s->m_convert_buffer.data();
+int audio::queued_frames(int track)
+{
+    auto voice = g_mixer ? g_mixer->voice(track) : nullptr;
+    if (!voice || !voice->m_queue)
+        return 0;
 
-    // This is how many bytes we will send to the SDL mixer
-    Uint32 output_bytes = LOL_AUDIO_DEFAULT_FRAMES * g_channels * SDL_AUDIO_BITSIZE(sdl_g_format) / 8;
-    s->m_output_buffer.resize(output_bytes);
-    Uint8* audio_data = (Uint8*)s->m_output_buffer.data();
-    s->m_chunk = Mix_QuickLoad_RAW(audio_data, output_bytes);
-    s->m_track = Mix_PlayChannel(-1, s->m_chunk, -1);
-    s->m_callback = f;
-    Mix_RegisterEffect(s->m_track, trampoline, nullptr, s.get());
+    return (int)(voice->m_queue->size() / voice->m_frame_bytes);
+}
 
-    return s->m_track;
+int audio_play_buffer(std::shared_ptr<void const> owner, void const *data,
+                      size_t bytes, bool loop)
+{
+    if (!g_mixer)
+        return -1;
+
+    auto voice = std::make_shared<audio_voice>(g_mixer->format(),
+                                               g_mixer->frequency(),
+                                               g_mixer->channels());
+    voice->m_owner = owner;
+    voice->m_data = (uint8_t const *)data;
+    voice->m_data_bytes = bytes - bytes % voice->m_frame_bytes;
+    voice->m_loop = loop;
+    return g_mixer->add_voice(voice);
 }
 
 void audio::stop_streaming(int track)
 {
-    for (auto streamer : m_streamers)
+    if (g_mixer)
+        g_mixer->remove_voice(track);
+}
+
+void audio::render(void *buf, int frames)
+{
+    if (!g_mixer)
+        return;
+
+    g_mixer->render(buf, frames);
+
+    if (g_wav_file)
     {
-        if (streamer->m_track == track)
-        {
-            Mix_HaltChannel(track);
-            m_streamers.erase(streamer);
-            break;
-        }
+        size_t bytes = (size_t)frames * g_mixer->channels()
+                     * bytes_per_sample(g_mixer->format());
+        g_wav_bytes += (uint32_t)fwrite(buf, 1, bytes, g_wav_file);
     }
 }
 
-#else
-void audio::init() {}
-void audio::set_tracks(int) {}
-void audio::set_volume(int, int) {}
-void audio::mute_all() {}
-void audio::unmute_all() {}
-int audio::start_streaming(std::function<void(void *, int)> const &) { return -1; }
-void audio::stop_streaming(int) {}
-#endif
-
 } /* namespace lol */
-
@@ -0,0 +1,590 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define LOL_AUDIO_SSE2 1
+#endif
+
+#include "mixer.h"
+
+namespace lol
+{
+
+/*
+ * Sample format conversion
+ */
+
+static inline uint16_t swap16(uint16_t x)
+{
+    return (uint16_t)(x << 8 | x >> 8);
+}
+
+static inline uint32_t swap32(uint32_t x)
+{
+    return x << 24 | (x & 0xff00) << 8 | (x >> 8 & 0xff00) | x >> 24;
+}
+
+/* Whether the given format does not use the host byte order */
+static bool needs_swap(audio::format format)
+{
+    switch (format)
+    {
+        case audio::format::uint16le:
+        case audio::format::sint16le:
+        case audio::format::sint32le:
+        case audio::format::float32le:
+            return is_big_endian();
+        case audio::format::uint16be:
+        case audio::format::sint16be:
+        case audio::format::sint32be:
+        case audio::format::float32be:
+            return !is_big_endian();
+        default:
+            return false;
+    }
+}
+
+/* Scale and round a float sample to an integer, with saturation */
+template<typename T>
+static inline T quantise(float x, float scale, float lo, float hi)
+{
+    return (T)std::lrint(lol::clamp(x * scale, lo, hi));
+}
+
+void audio_convert(audio::format format, void const *src,
+                   float *dst, size_t count)
+{
+    bool const swap = needs_swap(format);
+    size_t i = 0;
+
+    switch (format)
+    {
+    case audio::format::uint8:
+        for (auto p = (uint8_t const *)src; i < count; ++i)
+            dst[i] = ((int)p[i] - 0x80) * (1.f / 0x80);
+        break;
+
+    case audio::format::sint8:
+        for (auto p = (int8_t const *)src; i < count; ++i)
+            dst[i] = p[i] * (1.f / 0x80);
+        break;
+
+    case audio::format::uint16le:
+    case audio::format::uint16be:
+        for (auto p = (uint16_t const *)src; i < count; ++i)
+            dst[i] = ((int)(swap ? swap16(p[i]) : p[i]) - 0x8000)
+                   * (1.f / 0x8000);
+        break;
+
+    case audio::format::sint16le:
+    case audio::format::sint16be:
+    {
+        auto p = (int16_t const *)src;
+#if LOL_AUDIO_SSE2
+        if (!swap)
+        {
+            __m128 const scale = _mm_set1_ps(1.f / 0x8000);
+            for ( ; i + 8 <= count; i += 8)
+            {
+                __m128i x = _mm_loadu_si128((__m128i const *)(p + i));
+                /* Sign-extend by unpacking to the high half and shifting */
+                __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+                __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+                _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+                _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+            }
+        }
+#endif
+        for ( ; i < count; ++i)
+            dst[i] = (int16_t)(swap ? swap16((uint16_t)p[i]) : p[i])
+                   * (1.f / 0x8000);
+        break;
+    }
+
+    case audio::format::sint32le:
+    case audio::format::sint32be:
+        for (auto p = (uint32_t const *)src; i < count; ++i)
+            dst[i] = (float)(int32_t)(swap ? swap32(p[i]) : p[i])
+                   * (1.f / 2147483648.f);
+        break;
+
+    case audio::format::float32le:
+    case audio::format::float32be:
+        if (!swap)
+        {
+            memcpy(dst, src, count * sizeof(float));
+            break;
+        }
+        for (auto p = (uint32_t const *)src; i < count; ++i)
+        {
+            uint32_t x = swap32(p[i]);
+            memcpy(dst + i, &x, sizeof(x));
+        }
+        break;
+
+    default:
+        memset(dst, 0, count * sizeof(float));
+        break;
+    }
+}
+
+void audio_convert(float const *src, audio::format format,
+                   void *dst, size_t count)
+{
+    bool const swap = needs_swap(format);
+    size_t i = 0;
+
+    switch (format)
+    {
+    case audio::format::uint8:
+        for (auto p = (uint8_t *)dst; i < count; ++i)
+            p[i] = (uint8_t)(quantise<int>(src[i], 128.f, -128.f, 127.f) + 0x80);
+        break;
+
+    case audio::format::sint8:
+        for (auto p = (int8_t *)dst; i < count; ++i)
+            p[i] = quantise<int8_t>(src[i], 128.f, -128.f, 127.f);
+        break;
+
+    case audio::format::uint16le:
+    case audio::format::uint16be:
+        for (auto p = (uint16_t *)dst; i < count; ++i)
+        {
+            uint16_t x = (uint16_t)(quantise<int>(src[i], 32768.f, -32768.f,
+                                                  32767.f) + 0x8000);
+            p[i] = swap ? swap16(x) : x;
+        }
+        break;
+
+    case audio::format::sint16le:
+    case audio::format::sint16be:
+    {
+        auto p = (int16_t *)dst;
+#if LOL_AUDIO_SSE2
+        if (!swap)
+        {
+            /* The conversion rounds to nearest and the packing saturates */
+            __m128 const scale = _mm_set1_ps(32768.f);
+            for ( ; i + 8 <= count; i += 8)
+            {
+                __m128i lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i), scale));
+                __m128i hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale));
+                _mm_storeu_si128((__m128i *)(p + i), _mm_packs_epi32(lo, hi));
+            }
+        }
+#endif
+        for ( ; i < count; ++i)
+        {
+            int16_t x = quantise<int16_t>(src[i], 32768.f, -32768.f, 32767.f);
+            p[i] = swap ? (int16_t)swap16((uint16_t)x) : x;
+        }
+        break;
+    }
+
+    case audio::format::sint32le:
+    case audio::format::sint32be:
+        /* 2147483520 is the largest float below 2³¹ */
+        for (auto p = (uint32_t *)dst; i < count; ++i)
+        {
+            uint32_t x = (uint32_t)quantise<int32_t>(src[i], 2147483648.f,
+                                                     -2147483648.f,
+                                                     2147483520.f);
+            p[i] = swap ? swap32(x) : x;
+        }
+        break;
+
+    case audio::format::float32le:
+    case audio::format::float32be:
+        if (!swap)
+        {
+            memcpy(dst, src, count * sizeof(float));
+            break;
+        }
+        for (auto p = (uint32_t *)dst; i < count; ++i)
+        {
+            uint32_t x;
+            memcpy(&x, src + i, sizeof(x));
+            p[i] = swap32(x);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+/*
+ * Mixer voices
+ */
+
+audio_voice::audio_voice(audio::format format, int frequency, int channels)
+  : m_format(format),
+    m_frequency(frequency),
+    m_channels(channels),
+    m_frame_bytes(audio::bytes_per_sample(format) * channels),
+    m_done(false),
+    m_volume(1.f),
+    m_pan(0.f)
+{
+    /* Start silent so that the first buffer fades in */
+    m_gain[0] = m_gain[1] = 0.f;
+    m_input.resize(lol::min(channels, 2), 0.f);
+}
+
+void audio_voice::reserve(int frames, int frequency)
+{
+    /* One output buffer needs at most this many new input frames, plus
+     * the ones kept for interpolation */
+    int const in_channels = lol::min(m_channels, 2);
+    size_t const count = (size_t)(((uint64_t)frames * m_frequency
+                                    + frequency - 1) / frequency) + 4;
+
+    m_raw.reserve(count * m_frame_bytes);
+    m_input.reserve(count * in_channels);
+    m_convert.reserve(count * m_channels);
+    m_resampled.resize((size_t)frames * in_channels);
+}
+
+/* Make sure m_input holds the given number of frames, fetching new ones
+ * from the callback, the queue or the buffer. Missing samples are
+ * replaced with silence. This never allocates, as long as reserve() was
+ * called with large enough values. */
+void audio_voice::fetch(int frames)
+{
+    int const count = frames - m_history;
+    if (count <= 0)
+        return;
+
+    int const in_channels = lol::min(m_channels, 2);
+    size_t const bytes = (size_t)count * m_frame_bytes;
+    m_raw.resize(bytes);
+
+    int available = count;
+    if (m_callback)
+        m_callback(m_raw.data(), (int)bytes);
+    else if (m_queue)
+        available = (int)(m_queue->pop(m_raw.data(), bytes) / m_frame_bytes);
+    else if (m_data)
+    {
+        size_t done = 0;
+        while (done < bytes && m_data_offset < m_data_bytes)
+        {
+            size_t const n = lol::min(bytes - done, m_data_bytes - m_data_offset);
+            memcpy(m_raw.data() + done, m_data + m_data_offset, n);
+            done += n;
+            m_data_offset += n;
+            if (m_loop && m_data_offset >= m_data_bytes)
+                m_data_offset = 0;
+        }
+        available = (int)(done / m_frame_bytes);
+        if (m_data_offset >= m_data_bytes)
+            m_done = true;
+    }
+    else
+        available = 0;
+
+    size_t const offset = (size_t)m_history * in_channels;
+    m_input.resize(offset + (size_t)count * in_channels);
+    float *dst = m_input.data() + offset;
+
+    if (m_channels == in_channels)
+    {
+        audio_convert(m_format, m_raw.data(), dst,
+                      (size_t)available * m_channels);
+    }
+    else
+    {
+        /* Only keep the front left and right channels */
+        m_convert.resize((size_t)available * m_channels);
+        audio_convert(m_format, m_raw.data(), m_convert.data(),
+                      m_convert.size());
+        for (int n = 0; n < available; ++n)
+        {
+            dst[n * 2] = m_convert[n * m_channels];
+            dst[n * 2 + 1] = m_convert[n * m_channels + 1];
+        }
+    }
+
+    std::fill(dst + (size_t)available * in_channels,
+              dst + (size_t)count * in_channels, 0.f);
+    m_history = frames;
+}
+
+/*
+ * Mixing kernels
+ */
+
+/* Add frames of ic channels to frames of oc channels, with gains for
+ * the left and right channels ramping from g0 by dg at each frame. Mono
+ * inputs go to both sides, and mono outputs get both sides. */
+static void mix_add(float *out, int oc, float const *in, int ic,
+                    int frames, float const g0[2], float const dg[2])
+{
+    int n = 0;
+
+#if LOL_AUDIO_SSE2
+    if (oc == 2 && ic == 2)
+    {
+        /* Two interleaved frames per vector */
+        __m128 const g = _mm_setr_ps(g0[0], g0[1], g0[0], g0[1]);
+        __m128 const d = _mm_setr_ps(dg[0], dg[1], dg[0], dg[1]);
+        __m128 const two = _mm_set1_ps(2.f);
+        __m128 t = _mm_setr_ps(0.f, 0.f, 1.f, 1.f);
+        for ( ; n + 2 <= frames; n += 2, t = _mm_add_ps(t, two))
+        {
+            __m128 const gain = _mm_add_ps(g, _mm_mul_ps(d, t));
+            __m128 const x = _mm_mul_ps(_mm_loadu_ps(in + n * 2), gain);
+            _mm_storeu_ps(out + n * 2, _mm_add_ps(_mm_loadu_ps(out + n * 2), x));
+        }
+    }
+    else if (oc == 2 && ic == 1)
+    {
+        /* Four frames per iteration, duplicated to both sides */
+        __m128 const g = _mm_setr_ps(g0[0], g0[1], g0[0], g0[1]);
+        __m128 const d = _mm_setr_ps(dg[0], dg[1], dg[0], dg[1]);
+        __m128 const two = _mm_set1_ps(2.f), four = _mm_set1_ps(4.f);
+        __m128 t = _mm_setr_ps(0.f, 0.f, 1.f, 1.f);
+        for ( ; n + 4 <= frames; n += 4, t = _mm_add_ps(t, four))
+        {
+            __m128 const x = _mm_loadu_ps(in + n);
+            __m128 const g_lo = _mm_add_ps(g, _mm_mul_ps(d, t));
+            __m128 const g_hi = _mm_add_ps(g, _mm_mul_ps(d, _mm_add_ps(t, two)));
+            __m128 const lo = _mm_mul_ps(_mm_unpacklo_ps(x, x), g_lo);
+            __m128 const hi = _mm_mul_ps(_mm_unpackhi_ps(x, x), g_hi);
+            _mm_storeu_ps(out + n * 2, _mm_add_ps(_mm_loadu_ps(out + n * 2), lo));
+            _mm_storeu_ps(out + n * 2 + 4, _mm_add_ps(_mm_loadu_ps(out + n * 2 + 4), hi));
+        }
+    }
+    else if (oc == 1 && ic == 1)
+    {
+        /* Four frames per vector, with the sum of both gains */
+        __m128 const g = _mm_set1_ps(g0[0] + g0[1]);
+        __m128 const d = _mm_set1_ps(dg[0] + dg[1]);
+        __m128 const four = _mm_set1_ps(4.f);
+        __m128 t = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+        for ( ; n + 4 <= frames; n += 4, t = _mm_add_ps(t, four))
+        {
+            __m128 const gain = _mm_add_ps(g, _mm_mul_ps(d, t));
+            __m128 const x = _mm_mul_ps(_mm_loadu_ps(in + n), gain);
+            _mm_storeu_ps(out + n, _mm_add_ps(_mm_loadu_ps(out + n), x));
+        }
+    }
+#endif
+
+    int const right = oc == 1 ? 0 : 1;
+    for ( ; n < frames; ++n)
+    {
+        float const l = in[n * ic], r = in[n * ic + ic - 1];
+        out[n * oc] += l * (g0[0] + dg[0] * n);
+        out[n * oc + right] += r * (g0[1] + dg[1] * n);
+    }
+}
+
+/* Add src to dst */
+static void mix_add(float *dst, float const *src, size_t count)
+{
+    size_t i = 0;
+
+#if LOL_AUDIO_SSE2
+    for ( ; i + 4 <= count; i += 4)
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i),
+                                          _mm_loadu_ps(src + i)));
+#endif
+
+    for ( ; i < count; ++i)
+        dst[i] += src[i];
+}
+
+/*
+ * The mixer itself
+ */
+
+audio_mixer::audio_mixer(audio::format format, int frequency, int channels,
+                         int frames)
+  : m_format(format),
+    m_frequency(frequency),
+    m_channels(channels),
+    m_frames(frames),
+    m_pending(nullptr),
+    m_current(new voice_list()),
+    m_retired(8),
+    m_master(1.f)
+{
+    m_mix.resize((size_t)frames * channels);
+    m_tmp.resize((size_t)frames * channels);
+}
+
+/* The audio thread must be stopped by now */
+audio_mixer::~audio_mixer()
+{
+    voice_list *old;
+    while (m_retired.pop(&old, 1))
+        delete old;
+    delete m_pending.exchange(nullptr);
+    delete m_current;
+}
+
+int audio_mixer::add_voice(std::shared_ptr<audio_voice> voice)
+{
+    voice->reserve(m_frames, m_frequency);
+
+    /* Also forget about the voices that are done playing */
+    m_voices.erase(std::remove_if(m_voices.begin(), m_voices.end(),
+                                  [&](voice_list::value_type const &v)
+                                  { return v.second->m_done.load(); }),
+                   m_voices.end());
+    m_voices.push_back(std::make_pair(m_next_id, voice));
+    publish();
+    return m_next_id++;
+}
+
+void audio_mixer::remove_voice(int id)
+{
+    m_voices.erase(std::remove_if(m_voices.begin(), m_voices.end(),
+                                  [&](voice_list::value_type const &v)
+                                  { return v.first == id; }),
+                   m_voices.end());
+    publish();
+}
+
+std::shared_ptr<audio_voice> audio_mixer::voice(int id) const
+{
+    for (auto const &v : m_voices)
+        if (v.first == id)
+            return v.second;
+    return nullptr;
+}
+
+/* Hand a copy of the voice list over to the audio thread, after freeing
+ * the lists it gave back. A pending list the audio thread did not pick
+ * yet was never seen by it, so it can be freed right away. */
+void audio_mixer::publish()
+{
+    voice_list *old;
+    while (m_retired.pop(&old, 1))
+        delete old;
+
+    delete m_pending.exchange(new voice_list(m_voices),
+                              std::memory_order_acq_rel);
+}
+
+void audio_mixer::render(void *buf, int frames, bool add)
+{
+    /* Pick the latest voice list, if any, and give the previous one back
+     * to the game thread. There is always room for it: each list is
+     * given back at most once per publish(), which empties the queue. */
+    voice_list *next = m_pending.exchange(nullptr, std::memory_order_acq_rel);
+    if (next)
+    {
+        m_retired.push(&m_current, 1);
+        m_current = next;
+    }
+
+    /* Our buffers are only large enough for m_frames frames */
+    size_t const frame_bytes = (size_t)audio::bytes_per_sample(m_format) * m_channels;
+    for (int done = 0; done < frames; done += m_frames)
+        render_chunk((uint8_t *)buf + done * frame_bytes,
+                     lol::min(m_frames, frames - done), add);
+}
+
+void audio_mixer::render_chunk(void *buf, int frames, bool add)
+{
+    size_t const count = (size_t)frames * m_channels;
+    std::fill(m_mix.begin(), m_mix.begin() + count, 0.f);
+
+    float const master = m_master;
+    for (auto const &v : *m_current)
+        mix(*v.second, m_mix.data(), frames, master);
+
+    if (add)
+    {
+        audio_convert(m_format, buf, m_tmp.data(), count);
+        mix_add(m_mix.data(), m_tmp.data(), count);
+    }
+
+    audio_convert(m_mix.data(), m_format, buf, count);
+}
+
+/* Resample a voice to the output frequency and add it to the mix. Input
+ * frames are linearly interpolated, and the gains are linearly ramped
+ * from their previous values to the current targets. */
+void audio_mixer::mix(audio_voice &voice, float *out, int frames, float master)
+{
+    uint64_t const one = (uint64_t)1 << 32;
+    uint64_t const step = ((uint64_t)voice.m_frequency << 32) / m_frequency;
+    uint64_t const end = voice.m_pos + step * frames;
+
+    /* We need frames up to the one after the last interpolated position,
+     * and the first frame of the next buffer. */
+    int const last = (int)((voice.m_pos + step * (frames - 1)) >> 32) + 1;
+    voice.fetch(lol::max(last, (int)(end >> 32)) + 1);
+
+    /* Compute the target gains; with a stereo output, pan acts as a
+     * balance control so that a centred voice is at full volume. The
+     * master gain ramps along with them. */
+    float const volume = lol::clamp(voice.m_volume.load(), 0.f, 1.f) * master;
+    float const pan = lol::clamp(voice.m_pan.load(), -1.f, 1.f);
+    float target[2];
+    if (m_channels == 1)
+        target[0] = target[1] = 0.5f * volume;
+    else
+    {
+        target[0] = volume * lol::min(1.f, 1.f - pan);
+        target[1] = volume * lol::min(1.f, 1.f + pan);
+    }
+
+    float const g0[2] = { voice.m_gain[0], voice.m_gain[1] };
+    float const dg[2] = { (target[0] - g0[0]) / frames,
+                          (target[1] - g0[1]) / frames };
+    voice.m_gain[0] = target[0];
+    voice.m_gain[1] = target[1];
+
+    int const ic = lol::min(voice.m_channels, 2);
+    float const *in = voice.m_input.data();
+
+    if (step == one && (voice.m_pos & (one - 1)) == 0)
+    {
+        /* Same frequency: no interpolation needed */
+        in += (voice.m_pos >> 32) * ic;
+    }
+    else
+    {
+        float *dst = voice.m_resampled.data();
+        uint64_t pos = voice.m_pos;
+        for (int n = 0; n < frames; ++n, pos += step)
+        {
+            float const *p = in + (pos >> 32) * ic;
+            float const t = (float)(pos & (one - 1)) * (1.f / 4294967296.f);
+            for (int c = 0; c < ic; ++c)
+                dst[n * ic + c] = p[c] + (p[ic + c] - p[c]) * t;
+        }
+        in = dst;
+    }
+
+    mix_add(out, m_channels, in, ic, frames, g0, dg);
+
+    /* Drop the frames we no longer need */
+    int const consumed = (int)(end >> 32);
+    voice.m_input.erase(voice.m_input.begin(),
+                        voice.m_input.begin() + (size_t)consumed * ic);
+    voice.m_history -= consumed;
+    voice.m_pos = end & (one - 1);
+}
+
+} /* namespace lol */
@@ -0,0 +1,142 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// The audio mixer
+// ---------------
+// Streams are converted to floats, resampled to the output frequency and
+// mixed together, then converted to the output format. When streams are
+// started or stopped, the game thread hands a new voice list over to the
+// audio thread through a lock-free mailbox, and gets the old one back to
+// free it. Samples pushed from the game thread go through lock-free
+// queues. The audio thread thus never waits for the game thread, and
+// never allocates or frees memory.
+//
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <functional>
+
+namespace lol
+{
+
+/* Sample format conversion, from and to floats in [-1, 1] */
+void audio_convert(audio::format format, void const *src,
+                   float *dst, size_t count);
+void audio_convert(float const *src, audio::format format,
+                   void *dst, size_t count);
+
+/* Play a buffer in the output format, once or in a loop. The buffer is
+ * kept alive by owner for as long as the mixer needs it. */
+int audio_play_buffer(std::shared_ptr<void const> owner, void const *data,
+                      size_t bytes, bool loop);
+
+class audio_voice
+{
+public:
+    audio_voice(audio::format format, int frequency, int channels);
+
+    audio::format const m_format;
+    int const m_frequency, m_channels, m_frame_bytes;
+
+    /* Only one of these is set: either the mixer pulls samples from a
+     * callback, or the game thread pushes them to a queue, or the mixer
+     * plays a buffer, kept alive by m_owner, once or in a loop. */
+    std::function<void(void *, int)> m_callback;
+    std::unique_ptr<spsc_queue<uint8_t>> m_queue;
+    std::shared_ptr<void const> m_owner;
+    uint8_t const *m_data = nullptr;
+    size_t m_data_bytes = 0;
+    bool m_loop = false;
+
+    /* Set by the mixer once a buffer played once is over; the voice is
+     * then removed the next time the voice list changes. */
+    std::atomic<bool> m_done;
+
+    /* Target volume and pan, set from any thread; the mixer ramps the
+     * actual gains towards them over one buffer. */
+    std::atomic<float> m_volume, m_pan;
+
+private:
+    friend class audio_mixer;
+
+    /* Allocate the buffers for mixing at most frames frames at the given
+     * output frequency; called from the game thread. */
+    void reserve(int frames, int frequency);
+
+    /* Mixer thread state. m_input holds converted frames (at most two
+     * channels), starting with the frames kept for interpolation, and
+     * m_pos is the position in m_input in 32.32 fixed point. m_resampled
+     * holds the frames interpolated at the output frequency. */
+    void fetch(int frames);
+
+    float m_gain[2];
+    uint64_t m_pos = 0;
+    int m_history = 1;
+    size_t m_data_offset = 0;
+    std::vector<uint8_t> m_raw;
+    std::vector<float> m_input, m_convert, m_resampled;
+};
+
+class audio_mixer
+{
+public:
+    typedef std::vector<std::pair<int, std::shared_ptr<audio_voice>>> voice_list;
+
+    audio_mixer(audio::format format, int frequency, int channels,
+                int frames);
+    ~audio_mixer();
+
+    audio::format format() const { return m_format; }
+    int frequency() const { return m_frequency; }
+    int channels() const { return m_channels; }
+    int frames() const { return m_frames; }
+
+    /* Only call these from the game thread */
+    int add_voice(std::shared_ptr<audio_voice> voice);
+    void remove_voice(int id);
+    std::shared_ptr<audio_voice> voice(int id) const;
+    voice_list const &voices() const { return m_voices; }
+
+    void set_master(float gain) { m_master = gain; }
+
+    /* Mix frames into buf, in the output format, either replacing or
+     * adding to its contents. Only call this from one thread at a time. */
+    void render(void *buf, int frames, bool add = false);
+
+private:
+    void publish();
+    void render_chunk(void *buf, int frames, bool add);
+    void mix(audio_voice &voice, float *out, int frames, float master);
+
+    audio::format const m_format;
+    int const m_frequency, m_channels, m_frames;
+
+    /* The game thread’s voice list, and its copies handed over to the
+     * audio thread: m_pending is the latest one the audio thread has not
+     * picked yet, m_current the one it uses, and m_retired the ones it
+     * no longer uses, for the game thread to free. */
+    voice_list m_voices;
+    std::atomic<voice_list *> m_pending;
+    voice_list *m_current;
+    spsc_queue<voice_list *> m_retired;
+    int m_next_id = 0;
+
+    std::atomic<float> m_master;
+    std::vector<float> m_mix, m_tmp;
+};
+
+} /* namespace lol */
+
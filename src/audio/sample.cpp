@@ -26,6 +26,8 @@
 #   endif
 #endif
 
+#include "mixer.h"
+
 namespace lol
 {
 
@@ -43,7 +45,8 @@ class sample_data
 private:
     std::string m_name;
 #if defined LOL_USE_SDL_MIXER
-    Mix_Chunk *m_chunk;
+    // Shared with the mixer voices that play it
+    std::shared_ptr<Mix_Chunk> m_chunk;
     int m_channel;
 #endif
 };
@@ -77,7 +80,7 @@ sample::sample(std::string const &path)
 #if defined LOL_USE_SDL_MIXER
     for (auto candidate : sys::get_path_list(path))
     {
-        data->m_chunk = Mix_LoadWAV(candidate.c_str());
+        data->m_chunk.reset(Mix_LoadWAV(candidate.c_str()), Mix_FreeChunk);
         if (data->m_chunk)
             break;
     }
@@ -95,17 +98,14 @@ sample::sample(void const *samples, size_t len)
     data->m_name = std::string("<sample>");
 
 #if defined LOL_USE_SDL_MIXER
-    data->m_chunk = Mix_QuickLoad_RAW((Uint8 *)samples, (Uint32)len);
+    data->m_chunk.reset(Mix_QuickLoad_RAW((Uint8 *)samples, (Uint32)len),
+                        Mix_FreeChunk);
     data->m_channel = -1;
 #endif
 }
 
 sample::~sample()
 {
-#if defined LOL_USE_SDL_MIXER
-    if (data->m_chunk)
-        Mix_FreeChunk(data->m_chunk);
-#endif
 }
 
 void sample::tick_game(float seconds)
@@ -121,8 +121,10 @@ std::string sample::GetName() const
 void sample::play()
 {
 #if defined LOL_USE_SDL_MIXER
+    // Chunks are already in the output format
     if (data->m_chunk)
-        data->m_channel = Mix_PlayChannel(-1, data->m_chunk, 0);
+        data->m_channel = audio_play_buffer(data->m_chunk, data->m_chunk->abuf,
+                                            data->m_chunk->alen, false);
 #endif
 }
 
@@ -130,7 +132,8 @@ void sample::loop()
 {
 #if defined LOL_USE_SDL_MIXER
     if (data->m_chunk)
-        data->m_channel = Mix_PlayChannel(-1, data->m_chunk, -1);
+        data->m_channel = audio_play_buffer(data->m_chunk, data->m_chunk->abuf,
+                                            data->m_chunk->alen, true);
 #endif
 }
 
@@ -138,7 +141,7 @@ void sample::stop()
 {
 #if defined LOL_USE_SDL_MIXER
     if (data->m_channel >= 0)
-        Mix_HaltChannel(data->m_channel);
+        audio::stop_streaming(data->m_channel);
     data->m_channel = -1;
 #endif
 }
@@ -0,0 +1,89 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <deque>
+#include <mutex>
+
+namespace lol
+{
+
+/*
+ * The interning table
+ */
+
+struct intern_table
+{
+    intern_table()
+    {
+        m_ids[std::string()] = 0;
+        m_strings.push_back(std::string());
+    }
+
+    /* Q is std::string or char const *; the map accepts both for lookups */
+    template<typename Q> uint32_t get_id(Q const &s)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_ids.find(s);
+        if (it != m_ids.end())
+            return it->second;
+
+        uint32_t ret = (uint32_t)m_strings.size();
+        m_strings.push_back(s);
+        m_ids[m_strings.back()] = ret;
+        return ret;
+    }
+
+    std::string const &get_string(uint32_t id)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        ASSERT(id < m_strings.size(), "invalid interned string id %d", (int)id);
+        return m_strings[id];
+    }
+
+    std::mutex m_mutex;
+    hash_map<std::string, uint32_t> m_ids;
+    /* A deque never moves its elements, so references remain valid */
+    std::deque<std::string> m_strings;
+};
+
+/* Created on first use, so that static initialisers may intern strings */
+static intern_table &table()
+{
+    static intern_table ret;
+    return ret;
+}
+
+/*
+ * Public interning functions
+ */
+
+uint32_t intern(std::string const &s)
+{
+    return table().get_id(s);
+}
+
+uint32_t intern(char const *s)
+{
+    return table().get_id(s);
+}
+
+std::string const &interned(uint32_t id)
+{
+    return table().get_string(id);
+}
+
+} /* namespace lol */
+
@@ -0,0 +1,202 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <atomic>
+#include <map>
+
+namespace lol
+{
+
+/*
+ * Unit meshes, as lists of line endpoints
+ */
+
+/* Same layout as the former Debug::DrawCircle() */
+static void add_circle(array<vec3> &mesh, vec3 x, vec3 y, int segments)
+{
+    for (int i = 0; i < segments; i++)
+    {
+        float a0 = (((float)i)     / (float)segments) * F_PI_2;
+        float a1 = (((float)i + 1) / (float)segments) * F_PI_2;
+        vec2 p0 = vec2(lol::cos(a0), lol::sin(a0));
+        vec2 p1 = vec2(lol::cos(a1), lol::sin(a1));
+
+        mesh << p0.x *  x + p0.y *  y << p1.x *  x + p1.y *  y
+             << p0.x * -x + p0.y * -y << p1.x * -x + p1.y * -y
+             << p0.x *  x + p0.y * -y << p1.x *  x + p1.y * -y
+             << p0.x * -x + p0.y *  y << p1.x * -x + p1.y *  y;
+    }
+}
+
+/* Only the render thread builds and reads these */
+static array<vec3> const &unit_mesh(Debug::Shape shape, int segments)
+{
+    static std::map<int, array<vec3>> cache;
+
+    int key = (int)shape * 1024 + segments;
+    auto it = cache.find(key);
+    if (it != cache.end())
+        return it->second;
+
+    array<vec3> &mesh = cache[key];
+    vec3 const x = vec3::axis_x, y = vec3::axis_y, z = vec3::axis_z;
+
+    switch (shape)
+    {
+    case Debug::Shape::Box:
+        /* The unit cube, with the same edges as the former DrawBox() */
+        for (int i = 0; i < 4; i++)
+        {
+            int j = ((i & 1) << 1) | ((i >> 1) ^ 1);
+            vec3 vi(i & 1, (i >> 1) & 1, 0), vj(j & 1, (j >> 1) & 1, 0);
+            mesh << vi << vi + z << vi << vj << vi + z << vj + z;
+        }
+        break;
+    case Debug::Shape::Circle:
+        add_circle(mesh, x, y, segments);
+        break;
+    case Debug::Shape::Sphere:
+        add_circle(mesh, x, y, segments);
+        add_circle(mesh, x, (y + z) * .707f, segments);
+        add_circle(mesh, x, (y - z) * .707f, segments);
+        add_circle(mesh, z, x, segments);
+        add_circle(mesh, z, (x + y) * .707f, segments);
+        add_circle(mesh, z, (x - y) * .707f, segments);
+        add_circle(mesh, y, z, segments);
+        add_circle(mesh, y, (z + x) * .707f, segments);
+        add_circle(mesh, y, (z - x) * .707f, segments);
+        break;
+    case Debug::Shape::Gizmo:
+        mesh << vec3::zero << x << vec3::zero << y << vec3::zero << z;
+        break;
+    }
+
+    return mesh;
+}
+
+/*
+ * DebugDrawQueue implementation
+ */
+
+struct DebugDrawQueue::buffer
+{
+    mutex m_mutex;
+    std::vector<line_command> m_lines;
+    std::vector<shape_command> m_shapes;
+};
+
+DebugDrawQueue::DebugDrawQueue()
+{
+    static std::atomic<uint64_t> next_id(1);
+    m_id = next_id++;
+}
+
+DebugDrawQueue::~DebugDrawQueue()
+{
+}
+
+DebugDrawQueue::buffer &DebugDrawQueue::GetLocalBuffer()
+{
+    /* Each thread keeps one buffer for every queue it has drawn to;
+     * queues are identified by a unique number rather than by their
+     * address, which could be reused. */
+    static thread_local std::map<uint64_t, std::shared_ptr<buffer>> buffers;
+
+    auto &buf = buffers[m_id];
+    if (!buf)
+    {
+        buf = std::make_shared<buffer>();
+        m_mutex.lock();
+        m_buffers << buf;
+        m_mutex.unlock();
+    }
+    return *buf;
+}
+
+void DebugDrawQueue::AddLine(vec3 a, vec3 b, vec4 color, float duration, int mask)
+{
+    buffer &buf = GetLocalBuffer();
+    buf.m_mutex.lock();
+    buf.m_lines.push_back(line_command { a, b, color, duration, mask });
+    buf.m_mutex.unlock();
+}
+
+void DebugDrawQueue::AddShape(Debug::Shape shape, mat4 const &transform,
+                              vec4 color, float duration, int mask, int segments)
+{
+    /* Bound the number of cached meshes */
+    segments = lol::clamp(segments, 1, 64);
+
+    buffer &buf = GetLocalBuffer();
+    buf.m_mutex.lock();
+    buf.m_shapes.push_back(shape_command { transform, color, duration, mask, segments, shape });
+    buf.m_mutex.unlock();
+}
+
+void DebugDrawQueue::Merge(int mask, float now, array<DebugLineVertex> &frame,
+                           array<DebugLineVertex> &persistent)
+{
+    m_mutex.lock();
+    for (int n = 0; n < m_buffers.count(); ++n)
+    {
+        /* Swap the arrays so that the recording thread is only blocked
+         * for a very short time */
+        buffer &buf = *m_buffers[n];
+        buf.m_mutex.lock();
+        m_lines.swap(buf.m_lines);
+        m_shapes.swap(buf.m_shapes);
+        buf.m_mutex.unlock();
+
+        auto emit = [&](vec3 a, vec3 b, vec4 color, float duration)
+        {
+            bool keep = duration > 0.f;
+            float expiry = keep ? now + duration : 0.f;
+            (keep ? persistent : frame)
+                << DebugLineVertex { vec4(a, 0.f), color, expiry }
+                << DebugLineVertex { vec4(b, 0.f), color, expiry };
+        };
+
+        for (auto const &l : m_lines)
+            if (l.m_mask & mask)
+                emit(l.m_a, l.m_b, l.m_color, l.m_duration);
+
+        for (auto const &s : m_shapes)
+        {
+            if (!(s.m_mask & mask))
+                continue;
+
+            array<vec3> const &mesh = unit_mesh(s.m_shape, s.m_segments);
+            for (int i = 0; i < mesh.count(); i += 2)
+            {
+                /* Gizmos always use red, green and blue axes */
+                vec4 color = s.m_shape != Debug::Shape::Gizmo ? s.m_color
+                           : i == 0 ? Color::red : i == 2 ? Color::green : Color::blue;
+                emit((s.m_transform * vec4(mesh[i], 1.f)).xyz,
+                     (s.m_transform * vec4(mesh[i + 1], 1.f)).xyz,
+                     color, s.m_duration);
+            }
+        }
+
+        m_lines.clear();
+        m_shapes.clear();
+
+        /* If we hold the last reference, the recording thread is gone */
+        if (m_buffers[n].use_count() == 1)
+            m_buffers.remove_swap(n--);
+    }
+    m_mutex.unlock();
+}
+
+} /* namespace lol */
+
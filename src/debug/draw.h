@@ -0,0 +1,89 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// The DebugDrawQueue class
+// ------------------------
+//
+// Debug lines and shapes are recorded into one buffer per thread, so
+// that any thread can draw without contention, and merged by the render
+// thread. Shapes are stored as a single transform and expanded from a
+// cached unit mesh at merge time.
+//
+
+#include <memory>
+#include <vector>
+
+namespace lol
+{
+
+/* One line vertex as sent to the GPU; lines that have a duration carry
+ * the time at which they expire, and are hidden by the vertex shader
+ * once that time is reached. */
+struct DebugLineVertex
+{
+    vec4 m_pos;
+    vec4 m_color;
+    float m_expiry;
+};
+
+class DebugDrawQueue
+{
+public:
+    DebugDrawQueue();
+    ~DebugDrawQueue();
+
+    /* These can be called from any thread */
+    void AddLine(vec3 a, vec3 b, vec4 color, float duration, int mask);
+    void AddShape(Debug::Shape shape, mat4 const &transform, vec4 color,
+                  float duration, int mask, int segments);
+
+    /* Collect every thread’s commands, dropping those that do not match
+     * mask. Lines with no duration are appended to frame, the others to
+     * persistent with an expiry time relative to now. */
+    void Merge(int mask, float now, array<DebugLineVertex> &frame,
+               array<DebugLineVertex> &persistent);
+
+private:
+    struct line_command
+    {
+        vec3 m_a, m_b;
+        vec4 m_color;
+        float m_duration;
+        int m_mask;
+    };
+
+    struct shape_command
+    {
+        mat4 m_transform;
+        vec4 m_color;
+        float m_duration;
+        int m_mask, m_segments;
+        Debug::Shape m_shape;
+    };
+
+    struct buffer;
+    buffer &GetLocalBuffer();
+
+    uint64_t m_id;
+    mutex m_mutex;
+    array<std::shared_ptr<buffer>> m_buffers;
+
+    /* Commands being merged, swapped with the thread buffers */
+    std::vector<line_command> m_lines;
+    std::vector<shape_command> m_shapes;
+};
+
+} /* namespace lol */
+
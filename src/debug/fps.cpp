@@ -84,12 +84,13 @@ void DebugFps::tick_game(float seconds)
             1e3f * Profiler::GetMax(Profiler::STAT_TICK_FRAME));
     data->lines[4]->SetText(buf);
 #else
-    sprintf(buf, "%2.2f/%2.2f/%2.2f/%2.2f %2.2f fps (%i) %2.2f",
+    sprintf(buf, "%2.2f/%2.2f/%2.2f/%2.2f %2.2f fps p99 %2.2f (%i) %2.2f",
             1e3f * Profiler::GetAvg(Profiler::STAT_TICK_GAME),
             1e3f * Profiler::GetAvg(Profiler::STAT_TICK_DRAW),
             1e3f * Profiler::GetAvg(Profiler::STAT_TICK_BLIT),
             1e3f * Profiler::GetAvg(Profiler::STAT_TICK_FRAME),
             1.0f / Profiler::GetAvg(Profiler::STAT_TICK_FRAME),
+            1e3f * Profiler::GetPercentile(Profiler::STAT_TICK_FRAME, 0.99f),
             Ticker::GetFrameNum(),
             1e3f * Profiler::GetAvg(Profiler::STAT_USER_00));
     data->lines[0]->SetText(buf);
@@ -14,7 +14,7 @@
 
 namespace lol
 {
-Debug::DrawContext::Data Debug::DrawContext::m_global = Debug::DrawContext::Data(vec4(1.f));
+thread_local Debug::DrawContext::Data Debug::DrawContext::m_global = Debug::DrawContext::Data(vec4(1.f));
 
 typedef Debug::DrawContext       DC;
 typedef Debug::DrawContext::Data DCD;
@@ -61,6 +61,19 @@ vec3 Debug::ScreenToWorld(vec3 pos, mat4 view, mat4 proj)
 //Draw stuff in World
 //-- LINE: 3D -2D - 3D_to_2D --------------------------------------------------
 
+/* Number of segments per quarter circle for a given radius */
+static int circle_segments(float radius, DCD const &data)
+{
+    float size = F_PI * 2.f * radius;
+    return lol::max(1, (int)((size * .25f) / data.m_segment_size));
+}
+
+/* A transform mapping the unit axes to x, y, z and the origin to a */
+static mat4 basis(vec3 a, vec3 x, vec3 y, vec3 z)
+{
+    return mat4(vec4(x, 0.f), vec4(y, 0.f), vec4(z, 0.f), vec4(a, 1.f));
+}
+
 //Root func
 void Debug::DrawLine(vec3 a, vec3 b, DCD data)
 {
@@ -75,9 +88,10 @@ void Debug::DrawLine(vec2 a, vec2 b, float az, float bz)           { DrawLine(a,
 //-- GIZMO --------------------------------------------------------------------
 void Debug::DrawGizmo(vec3 pos, vec3 x, vec3 y, vec3 z, float size)
 {
-    Debug::DrawLine(pos, pos + x * size, Color::red);
-    Debug::DrawLine(pos, pos + y * size, Color::green);
-    Debug::DrawLine(pos, pos + z * size, Color::blue);
+    /* Like lines drawn with a plain colour, gizmos last one frame */
+    DCD data(Color::white);
+    Scene::GetScene().AddShape(Shape::Gizmo, basis(pos, x * size, y * size, z * size),
+                               data.m_color, data.m_duration, data.m_mask);
 }
 void Debug::DrawGizmo(vec2 pos, vec3 x, vec3 y, vec3 z, float size, float posz)
 {
@@ -196,23 +210,8 @@ void Debug::DrawBox(vec2 a, vec2 b, mat2 transform)   { Debug::DrawBox(a, b, tra
 void Debug::DrawBox(vec2 a, float s, mat2 transform)  { Debug::DrawBox(a, s, transform, DC::GetGlobalData()); }
 void Debug::DrawBox(vec3 a, vec3 b, mat4 transform, DCD data)
 {
-    vec4 v[8];
-    for (int i = 0; i < 8; i++)
-    {
-        v[i].x = i & 1 ? a.x : b.x;
-        v[i].y = i & 2 ? a.y : b.y;
-        v[i].z = i & 4 ? a.z : b.z;
-        v[i].w = 1.f;
-    }
-
-    for (int i = 0; i < 4; i++)
-    {
-        int j = ((i & 1) << 1) | ((i >> 1) ^ 1);
-
-        Debug::DrawLine((transform * v[i]).xyz,     (transform * v[i + 4]).xyz, data);
-        Debug::DrawLine((transform * v[i]).xyz,     (transform * v[j]).xyz,     data);
-        Debug::DrawLine((transform * v[i + 4]).xyz, (transform * v[j + 4]).xyz, data);
-    }
+    mat4 unit = transform * mat4::translate(a) * mat4::scale(b - a);
+    Scene::GetScene().AddShape(Shape::Box, unit, data.m_color, data.m_duration, data.m_mask);
 }
 void Debug::DrawBox(vec2 a, vec2 b, mat2 transform, DCD data)
 {
@@ -254,20 +253,9 @@ void Debug::DrawCircle(vec2 a, vec2 s, DCD data)
 //--
 void Debug::DrawCircle(vec3 a, vec3 x, vec3 y, DCD data)
 {
-    float size = F_PI * 2.f * lol::max(length(x), length(y));
-    int segment_nb = lol::max(1, (int)((size * .25f) / data.m_segment_size));
-    for (int i = 0; i < segment_nb; i++)
-    {
-        float a0 = (((float)i)     / (float)segment_nb) * F_PI_2;
-        float a1 = (((float)i + 1) / (float)segment_nb) * F_PI_2;
-        vec2 p0 = vec2(lol::cos(a0), lol::sin(a0));
-        vec2 p1 = vec2(lol::cos(a1), lol::sin(a1));
-
-        Debug::DrawLine(a + p0.x *  x + p0.y *  y, a + p1.x *  x + p1.y *  y, data);
-        Debug::DrawLine(a + p0.x * -x + p0.y * -y, a + p1.x * -x + p1.y * -y, data);
-        Debug::DrawLine(a + p0.x *  x + p0.y * -y, a + p1.x *  x + p1.y * -y, data);
-        Debug::DrawLine(a + p0.x * -x + p0.y *  y, a + p1.x * -x + p1.y *  y, data);
-    }
+    int segments = circle_segments(lol::max(length(x), length(y)), data);
+    Scene::GetScene().AddShape(Shape::Circle, basis(a, x, y, cross(x, y)),
+                               data.m_color, data.m_duration, data.m_mask, segments);
 }
 //--
 void Debug::DrawCircle(vec2 a, vec2 x, vec2 y, DCD data)
@@ -294,15 +282,9 @@ void Debug::DrawSphere(vec3 a, float s, DCD data)      { Debug::DrawSphere(a, ve
 void Debug::DrawSphere(vec3 a, vec3 x, vec3 y, vec3 z) { Debug::DrawSphere(a, x, y, z, DC::GetGlobalData()); }
 void Debug::DrawSphere(vec3 a, vec3 x, vec3 y, vec3 z, DCD data)
 {
-    Debug::DrawCircle(a, x, y, data);
-    Debug::DrawCircle(a, x, (y + z) * .707f, data);
-    Debug::DrawCircle(a, x, (y - z) * .707f, data);
-    Debug::DrawCircle(a, z, x, data);
-    Debug::DrawCircle(a, z, (x + y) * .707f, data);
-    Debug::DrawCircle(a, z, (x - y) * .707f, data);
-    Debug::DrawCircle(a, y, z, data);
-    Debug::DrawCircle(a, y, (z + x) * .707f, data);
-    Debug::DrawCircle(a, y, (z - x) * .707f, data);
+    int segments = circle_segments(lol::max(lol::max(length(x), length(y)), length(z)), data);
+    Scene::GetScene().AddShape(Shape::Sphere, basis(a, x, y, z),
+                               data.m_color, data.m_duration, data.m_mask, segments);
 }
 
 //-- CAPSULE ------------------------------------------------------------------
@@ -14,10 +14,6 @@
 
 #include <cstring>
 
-#if defined USE_PIPI
-#   include <pipi.h>
-#endif
-
 #include "loldebug.h"
 
 namespace lol
@@ -32,14 +28,38 @@ class DebugRecordData
     friend class DebugRecord;
 
 private:
+    void close_movie();
+
     std::string m_path;
     ivec2 m_size;
     int m_fps;
-#if defined USE_PIPI
-    pipi_sequence_t *m_sequence;
-#endif
+    movie *m_movie;
+    u8vec4 *m_frame;
 };
 
+/* Submit the frames the GPU still holds for the current movie, so that
+ * the last frames are not lost, then close the movie. */
+void DebugRecordData::close_movie()
+{
+    if (!m_movie)
+        return;
+
+    for (;;)
+    {
+        if (!m_frame)
+            m_frame = m_movie->acquire_frame(true);
+        if (!Video::FlushCapture(m_frame, m_size))
+            break;
+        m_movie->submit_frame(m_frame, true);
+        m_frame = nullptr;
+    }
+
+    /* This waits for the frames to be encoded */
+    delete m_movie;
+    m_movie = nullptr;
+    m_frame = nullptr;
+}
+
 /*
  * Public DebugRecord class
  */
@@ -52,9 +72,8 @@ DebugRecord::DebugRecord(std::string const &path, float fps)
     m_data->m_path = path;
     m_data->m_size = ivec2::zero;
     m_data->m_fps = (int)(fps + 0.5f);
-#if defined USE_PIPI
-    m_data->m_sequence = nullptr;
-#endif
+    m_data->m_movie = nullptr;
+    m_data->m_frame = nullptr;
 
     m_drawgroup = tickable::group::draw::capture;
 }
@@ -72,34 +91,40 @@ void DebugRecord::tick_draw(float seconds, Scene &scene)
 
     if (m_data->m_size != size)
     {
+        m_data->close_movie();
         m_data->m_size = size;
 
-#if defined USE_PIPI
-        if (m_data->m_sequence)
-            pipi_close_sequence(m_data->m_sequence);
-
-        m_data->m_sequence = pipi_open_sequence(m_data->m_path, size.x, size.y,
-                                                1 /* RGB */, m_data->m_fps,
-                                                1, 1, 60 * 1024 * 1024);
-#endif
+        m_data->m_movie = new movie(size, m_data->m_fps);
+        if (!m_data->m_movie->open_file(m_data->m_path))
+        {
+            msg::error("cannot record to %s\n", m_data->m_path.c_str());
+            delete m_data->m_movie;
+            m_data->m_movie = nullptr;
+        }
     }
 
-#if defined USE_PIPI
-    if (m_data->m_sequence)
+    if (!m_data->m_movie)
+        return;
+
+    /* Hold a frame from the pool until the GPU has a capture ready for
+     * it. If the encoder cannot keep up, no frame is available and the
+     * current frame is simply not recorded. */
+    if (!m_data->m_frame)
+        m_data->m_frame = m_data->m_movie->acquire_frame();
+
+    if (m_data->m_frame
+         && Video::CaptureAsync(m_data->m_frame, m_data->m_size))
     {
-        uint32_t *buffer = new uint32_t[size.x * size.y];
-        Video::Capture(buffer);
-        pipi_feed_sequence(m_data->m_sequence, (uint8_t *)buffer,
-                           size.x, size.y);
-        delete[] buffer;
+        m_data->m_movie->submit_frame(m_data->m_frame, true);
+        m_data->m_frame = nullptr;
     }
-#endif
 }
 
 DebugRecord::~DebugRecord()
 {
     Ticker::StopRecording();
 
+    m_data->close_movie();
     delete m_data;
 }
 
@@ -14,6 +14,8 @@
 
 #include <lol/engine-internal.h>
 
+#include <cfloat>
+
 namespace lol
 {
 
@@ -54,8 +56,11 @@ void EasyMesh::MeshConvert()
 
     auto vbo = std::make_shared<VertexBuffer>(m_vert.count() * sizeof(Vertex));
     Vertex *vert = (Vertex *)vbo->Lock(0, 0);
+    box3 bounds(vec3(FLT_MAX), vec3(-FLT_MAX));
     for (int i = 0; i < m_vert.count(); ++i)
     {
+        bounds.aa = min(bounds.aa, m_vert[i].m_coord);
+        bounds.bb = max(bounds.bb, m_vert[i].m_coord);
         vert[i].pos = m_vert[i].m_coord,
         vert[i].normal = m_vert[i].m_normal,
         vert[i].color = (u8vec4)(m_vert[i].m_color * 255.f);
@@ -67,6 +72,8 @@ void EasyMesh::MeshConvert()
     m_submeshes.push_back(std::make_shared<SubMesh>(shader, vdecl));
     m_submeshes.back()->SetIndexBuffer(ibo);
     m_submeshes.back()->SetVertexBuffer(0, vbo);
+    if (m_vert.count())
+        m_submeshes.back()->SetBounds(bounds);
 
     m_state = MeshRender::CanRender;
 }
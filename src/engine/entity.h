@@ -45,6 +45,12 @@ public:
         release_draw = 1 << 4,
         destroying   = 1 << 5,
         autorelease  = 1 << 6,
+        /* Set by the world partition: throttled entities skip game
+         * ticks and catch up later, suspended ones are not ticked and
+         * are taken out of the tick lists (parked) until resumed */
+        throttled    = 1 << 7,
+        suspended    = 1 << 8,
+        parked       = 1 << 9,
     };
 
     inline void add_flags(flags f);
@@ -73,6 +79,7 @@ private:
     flags m_flags = flags::none;
     int m_ref = 0;
     uint64_t m_scene_mask = 0;
+    float m_skipped_time = 0.f;
 };
 
 static inline entity::flags operator |(entity::flags a, entity::flags b)
@@ -112,12 +119,15 @@ template<typename T> struct entity_dict
     void erase(T *entity)
     {
         // FIXME: temporary; we need Ticker::Ref etc.
-        m_cache1.erase(m_cache2[entity]);
+        auto it = m_cache2.find(entity);
+        if (it == m_cache2.end())
+            return;
+        m_cache1.erase(it->second);
         m_cache2.erase(entity);
     }
 
-    std::map<std::string, T*> m_cache1;
-    std::map<T*, std::string> m_cache2;
+    hash_map<std::string, T*> m_cache1;
+    hash_map<T*, std::string> m_cache2;
 };
 
 } /* namespace lol */
@@ -14,6 +14,7 @@
 
 #include <cstdlib>
 #include <cstdint>
+#include <atomic>
 #include <functional>
 
 namespace lol
@@ -30,7 +31,8 @@ class ticker_data
 public:
     ticker_data()
       : DEPRECATED_nentities(0),
-        m_frame(0), m_recording(0), deltatime(0), bias(0), fps(0),
+        m_frame(0), m_recording(0), deltatime(0), fps(0), m_lag(0),
+        m_step_rate(0), m_step_time(0), m_interpolation(1), m_max_steps(1),
 #if LOL_BUILD_DEBUG
         keepalive(0),
 #endif
@@ -57,6 +59,7 @@ public:
 
     void handle_shutdown();
     void collect_garbage();
+    void park_suspended();
 
 private:
     // Tickables waiting to be inserted
@@ -70,10 +73,26 @@ private:
     array<int> DEPRECATED_m_scenes[(int)tickable::group::all::end];
     int DEPRECATED_nentities;
 
+    /* Suspended entities, out of the tick lists */
+    array<entity *> m_parked;
+    bool m_park_dirty = false;
+
     /* Fixed framerate management */
     int m_frame, m_recording;
     timer m_timer;
-    float deltatime, bias, fps;
+    float deltatime, fps;
+
+    /* Frame pacing: how late the previous frames ended, which the next
+     * frames try to catch up with */
+    timer m_pace_timer;
+    float m_lag;
+
+    /* Fixed timestep simulation, if the step rate is non-zero; the step
+     * time is how far the simulation is into the next step. Only the
+     * interpolation factor is read by the draw thread. */
+    float m_step_rate, m_step_time;
+    std::atomic<float> m_interpolation;
+    int m_max_steps;
 #if LOL_BUILD_DEBUG
     float keepalive;
 #endif
@@ -82,6 +101,7 @@ private:
     static void GameThreadTick();
     static void DrawThreadTick();
     static void DiskThreadTick();
+    static void GameStep(float seconds);
 
 #if LOL_FEATURE_THREADS
     /* The associated background threads */
@@ -166,9 +186,25 @@ int Ticker::Unref(entity *entity)
     ASSERT(!entity->has_flags(entity::flags::autorelease),
            "dereferencing autoreleased entity %s\n", entity->GetName().c_str());
 
+    /* A parked entity must get back in the lists to be destroyed */
+    if (entity->m_ref == 1 && entity->has_flags(entity::flags::parked))
+        data->m_park_dirty = true;
+
     return --entity->m_ref;
 }
 
+void Ticker::Suspend(entity *entity, bool suspended)
+{
+    if (suspended == entity->has_flags(entity::flags::suspended))
+        return;
+
+    if (suspended)
+        entity->add_flags(entity::flags::suspended);
+    else
+        entity->remove_flags(entity::flags::suspended);
+    data->m_park_dirty = true;
+}
+
 #if LOL_FEATURE_THREADS
 void ticker_data::GameThreadMain()
 {
@@ -258,21 +294,35 @@ void ticker_data::GameThreadTick()
 
     /* If recording with fixed framerate, set deltatime to a fixed value */
     if (data->m_recording && data->fps)
-    {
         data->deltatime = 1.f / data->fps;
-    }
     else
-    {
         data->deltatime = data->m_timer.get();
-        data->bias += data->deltatime;
-    }
 
     /* Do not go below 15 fps */
     if (data->deltatime > 1.f / 15.f)
-    {
         data->deltatime = 1.f / 15.f;
-        data->bias = 0.f;
+
+    /* With a fixed timestep, run as many steps as needed to catch up with
+     * real time; if that is too many, drop the backlog rather than make
+     * the next frame even longer. */
+    int steps = 1;
+    float step = data->deltatime;
+    if (data->m_step_rate > 0.f)
+    {
+        step = 1.f / data->m_step_rate;
+        data->m_step_time += data->deltatime;
+        steps = (int)(data->m_step_time / step);
+        if (steps > data->m_max_steps)
+        {
+            steps = data->m_max_steps;
+            data->m_step_time = lol::fmod(data->m_step_time, step);
+        }
+        else
+            data->m_step_time -= steps * step;
+        data->m_interpolation.store(lol::clamp(data->m_step_time / step, 0.f, 1.f),
+                                    std::memory_order_relaxed);
     }
+    Profiler::SetCounter(Profiler::COUNTER_GAME_STEPS, steps);
 
 #if LOL_BUILD_DEBUG
     data->keepalive += data->deltatime;
@@ -343,15 +393,35 @@ void ticker_data::GameThreadTick()
         }
     }
 
-    /* Tick objects for the game loop */
+    /* Let the world partition throttle or suspend far entities */
+    g_world.Tick();
+    data->park_suspended();
+
+    for (int i = 0; i < steps && !data->m_quit; ++i)
+        GameStep(step);
+
+    Profiler::Stop(Profiler::STAT_TICK_GAME);
+}
+
+/* Tick objects for the game loop */
+void ticker_data::GameStep(float seconds)
+{
     for (int g = (int)tickable::group::game::begin; g < (int)tickable::group::game::end && !data->m_quit /* Stop as soon as required */; ++g)
     {
         for (int i = 0; i < data->DEPRECATED_m_list[g].count() && !data->m_quit /* Stop as soon as required */; ++i)
         {
             entity *e = data->DEPRECATED_m_list[g][i];
 
+            if (e->has_flags(entity::flags::throttled))
+            {
+                /* Catch up with the skipped time at the next tick */
+                e->m_skipped_time += seconds;
+                continue;
+            }
+
             if (e->has_flags(entity::flags::init_game)
-                 && !e->has_flags(entity::flags::destroying))
+                 && !e->has_flags(entity::flags::destroying)
+                 && !e->has_flags(entity::flags::suspended))
             {
 #if !LOL_BUILD_RELEASE
                 if (e->m_tickstate != tickable::state::idle)
@@ -359,7 +429,8 @@ void ticker_data::GameThreadTick()
                                e->GetName().c_str(), e);
                 e->m_tickstate = tickable::state::pre_game;
 #endif
-                e->tick_game(data->deltatime);
+                e->tick_game(seconds + e->m_skipped_time);
+                e->m_skipped_time = 0.f;
 #if !LOL_BUILD_RELEASE
                 if (e->m_tickstate != tickable::state::post_game)
                     msg::error("entity %s [%p] missed super game tick\n",
@@ -369,8 +440,6 @@ void ticker_data::GameThreadTick()
             }
         }
     }
-
-    Profiler::Stop(Profiler::STAT_TICK_GAME);
 }
 
 //-----------------------------------------------------------------------------
@@ -427,7 +496,8 @@ void ticker_data::DrawThreadTick()
                 entity *e = data->DEPRECATED_m_list[g][i];
 
                 if (e->has_flags(entity::flags::init_draw)
-                     && !e->has_flags(entity::flags::destroying))
+                     && !e->has_flags(entity::flags::destroying)
+                     && !e->has_flags(entity::flags::suspended))
                 {
 #if !LOL_BUILD_RELEASE
                     if (e->m_tickstate != tickable::state::idle)
@@ -546,6 +616,71 @@ void ticker_data::collect_garbage()
     }
 }
 
+void ticker_data::park_suspended()
+{
+    if (!m_park_dirty && !(m_quit && m_parked.count()))
+        return;
+    m_park_dirty = false;
+
+    /* Entities that were resumed or released, or all of them when
+     * quitting, get inserted again at the next frame */
+    for (int i = m_parked.count(); i--; )
+    {
+        entity *e = m_parked[i];
+        if (e->has_flags(entity::flags::suspended) && e->m_ref > 0 && !m_quit)
+            continue;
+
+        e->remove_flags(entity::flags::parked);
+        m_parked.remove_swap(i);
+        DEPRECATED_m_todolist.push(e);
+    }
+
+    if (m_quit)
+        return;
+
+    /* Only park entities that are fully initialised and still alive */
+    for (int g = (int)tickable::group::game::begin; g < (int)tickable::group::game::end; ++g)
+    {
+        auto &list = DEPRECATED_m_list[g];
+        int dst = 0;
+        for (entity *e : list)
+        {
+            if (e->has_flags(entity::flags::suspended)
+                 && e->has_flags(entity::flags::init_game)
+                 && (e->m_drawgroup == tickable::group::draw::none
+                      || e->has_flags(entity::flags::init_draw))
+                 && !e->has_flags(entity::flags::destroying)
+                 && e->m_ref > 0)
+            {
+                e->add_flags(entity::flags::parked);
+                m_parked.push(e);
+            }
+            else
+                list[dst++] = e;
+        }
+        list.resize(dst);
+    }
+
+    /* Draw lists hold each entity once per scene, sorted by scene, and
+     * DEPRECATED_m_scenes has the end of each scene’s range */
+    for (int g = (int)tickable::group::draw::begin; g < (int)tickable::group::draw::end; ++g)
+    {
+        auto &list = DEPRECATED_m_list[g];
+        auto &scenes = DEPRECATED_m_scenes[g];
+        int src = 0, dst = 0;
+        for (int i = 0; i <= scenes.count(); ++i)
+        {
+            int end = i < scenes.count() ? scenes[i] : list.count();
+            for (; src < end; ++src)
+                if (!list[src]->has_flags(entity::flags::parked))
+                    list[dst++] = list[src];
+            if (i < scenes.count())
+                scenes[i] = dst;
+        }
+        list.resize(dst);
+    }
+}
+
 void ticker_data::DiskThreadTick()
 {
     ;
@@ -605,21 +740,41 @@ void ticker::tick_draw()
     Profiler::Stop(Profiler::STAT_TICK_BLIT);
 
 #if !__EMSCRIPTEN__
-    /* If framerate is fixed, force wait time to 1/FPS. Otherwise, set wait
-     * time to 0. */
+    /* If framerate is fixed, wait until 1/FPS after the end of the previous
+     * frame, minus how late it was, so that frames end on a regular beat.
+     * Otherwise, do not wait. */
     float frametime = data->fps ? 1.f / data->fps : 0.f;
 
-    if (frametime > data->bias + .2f)
-        frametime = data->bias + .2f; /* Don't go below 5 fps */
-    if (frametime > data->bias)
-        data->m_timer.wait(frametime - data->bias);
+    if (frametime > data->m_lag)
+        data->m_pace_timer.wait(frametime - data->m_lag);
+    float elapsed = data->m_pace_timer.get();
 
-    /* If recording, do not try to compensate for lag. */
-    if (!data->m_recording)
-        data->bias -= frametime;
+    /* If recording, do not try to compensate for lag; if more than 0.2 s
+     * late, give up catching up. */
+    data->m_lag = data->m_recording || !data->fps ? 0.f
+                : data->m_lag + elapsed - frametime;
+    if (data->m_lag < 0.f || data->m_lag > .2f)
+        data->m_lag = 0.f;
+
+    Profiler::SetCounter(Profiler::COUNTER_WAKE_SLACK_US,
+                         (int)(timer::get_wake_slack() * 1e6f));
 #endif
 }
 
+void ticker::set_fixed_step(float rate, int max_steps)
+{
+    data->m_step_rate = rate;
+    data->m_step_time = 0.f;
+    data->m_interpolation.store(1.f, std::memory_order_relaxed);
+    data->m_max_steps = lol::max(max_steps, 1);
+}
+
+float ticker::get_interpolation()
+{
+    /* Stays at 1 without a fixed rate */
+    return data->m_interpolation.load(std::memory_order_relaxed);
+}
+
 void Ticker::StartRecording()
 {
     ++data->m_recording;
@@ -33,6 +33,14 @@ public:
     static void tick_draw();
     static void teardown();
 
+    /* Run the game tick at a fixed rate, in as many steps per frame as
+     * needed but at most max_steps, or at the frame rate if rate is zero.
+     * The draw tick can then blend the two most recent game states using
+     * get_interpolation(), which is always 1 without a fixed rate and
+     * is safe to call from the draw thread. */
+    static void set_fixed_step(float rate, int max_steps = 4);
+    static float get_interpolation();
+
     static void add(std::shared_ptr<tickable> entity);
     static void remove(std::shared_ptr<tickable> entity);
 
@@ -41,6 +49,10 @@ public:
     static void Ref(class entity *entity);
     static int Unref(class entity *entity);
 
+    /* Stop ticking an entity, or start again; suspended entities are
+     * moved out of the tick lists so that they cost nothing per frame */
+    static void Suspend(class entity *entity, bool suspended);
+
     static void StartBenchmark();
     static void StopBenchmark();
     static void StartRecording();
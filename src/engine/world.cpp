@@ -13,6 +13,9 @@
 #include <cstring>
 #include <cstdlib>
 #include <ctype.h>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace lol
 {
@@ -24,11 +27,190 @@ namespace lol
 class WorldData
 {
     friend class World;
+
+    /* A streamed-out cell: a sequence of (type, data) records */
+    struct blob
+    {
+        array<uint8_t> m_data;
+        size_t m_size = 0;
+    };
+
+    void StreamOut(ivec3 cell, array<WorldEntity *> const &entities);
+    void StreamIn(ivec3 cell);
+
+    /* Apply a cell’s level to its entities at the next tick */
+    void Touch(ivec3 cell);
+    int Apply(ivec3 cell, world_grid::level level, bool skip);
+
+    world_grid m_grid;
+    array<WorldEntity *> m_entities;
+    std::map<std::string, World::Loader> m_loaders;
+    std::unordered_map<uint64_t, blob> m_blobs;
+
+    /* Cells whose level changed or that entities entered */
+    std::unordered_set<uint64_t> m_touched;
+    array<ivec3> m_touched_cells;
+
+    array<vec3> m_focus;
+    int m_reduced_rate = 4;
+    int m_frame = 0;
 };
 
 static WorldData g_world_data;
 World g_world;
 
+static void write_u32(array<uint8_t> &out, uint32_t x)
+{
+    for (int i = 0; i < 4; ++i)
+        out.push((uint8_t)(x >> (8 * i)));
+}
+
+static uint32_t read_u32(uint8_t const *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void WorldData::StreamOut(ivec3 cell, array<WorldEntity *> const &entities)
+{
+    blob &b = m_blobs[world_grid::cell_key(cell)];
+    m_grid.set_stored(cell, true);
+
+    /* Append to any content the cell already had */
+    array<uint8_t> records;
+    records.resize((int)b.m_size);
+    if (b.m_size)
+        pack::lz_decompress(span<uint8_t const>(b.m_data.data(), b.m_data.count()),
+                            span<uint8_t>(records.data(), b.m_size));
+
+    array<uint8_t> data;
+    for (WorldEntity *e : entities)
+    {
+        std::string type = e->GetStreamType();
+        data.clear();
+        e->SaveStream(data);
+
+        write_u32(records, (uint32_t)type.size());
+        for (char ch : type)
+            records.push((uint8_t)ch);
+        write_u32(records, (uint32_t)data.count());
+        for (uint8_t x : data)
+            records.push(x);
+
+        /* The entity is destroyed once nobody else references it */
+        g_world.Remove(e);
+        Ticker::Suspend(e, true);
+        Ticker::Unref(e);
+    }
+
+    b.m_size = records.count();
+    b.m_data = pack::lz_compress(span<uint8_t const>(records.data(), b.m_size));
+}
+
+void WorldData::StreamIn(ivec3 cell)
+{
+    auto it = m_blobs.find(world_grid::cell_key(cell));
+    if (it == m_blobs.end())
+        return;
+
+    array<uint8_t> records;
+    records.resize((int)it->second.m_size);
+    bool ok = pack::lz_decompress(span<uint8_t const>(it->second.m_data.data(),
+                                                      it->second.m_data.count()),
+                                  span<uint8_t>(records.data(), records.count()));
+    m_blobs.erase(it);
+    m_grid.set_stored(cell, false);
+
+    if (!ok)
+    {
+        msg::error("corrupt world cell %d,%d,%d\n", cell.x, cell.y, cell.z);
+        return;
+    }
+
+    /* Each record is a type name then the entity data, both prefixed
+     * with their length, which must fit in what is left of the blob */
+    size_t const total = (size_t)records.count();
+    size_t pos = 0;
+    auto next = [&](span<uint8_t const> &field)
+    {
+        if (total - pos < 4 || total - pos - 4 < read_u32(&records[pos]))
+            return false;
+        field = span<uint8_t const>(records.data() + pos + 4, read_u32(&records[pos]));
+        pos += 4 + field.size();
+        return true;
+    };
+
+    while (pos < total)
+    {
+        span<uint8_t const> name, data;
+        if (!next(name) || !next(data))
+        {
+            msg::error("corrupt world cell %d,%d,%d\n", cell.x, cell.y, cell.z);
+            break;
+        }
+
+        std::string type((char const *)name.data(), name.size());
+        auto loader = m_loaders.find(type);
+        if (loader == m_loaders.end())
+        {
+            msg::error("no loader for world entity type “%s”\n", type.c_str());
+            continue;
+        }
+
+        if (WorldEntity *e = loader->second(data))
+            g_world.Register(e);
+    }
+}
+
+void WorldData::Touch(ivec3 cell)
+{
+    if (m_touched.insert(world_grid::cell_key(cell)).second)
+        m_touched_cells.push(cell);
+}
+
+/* Return how many entities of the cell get ticked */
+int WorldData::Apply(ivec3 cell, world_grid::level level, bool skip)
+{
+    array<int> const *items = m_grid.cell_items(cell);
+    if (!items)
+        return 0;
+
+    /* Streaming out removes entities from the cell, so work on a copy */
+    array<WorldEntity *> entities, streamed;
+    for (int handle : *items)
+        entities.push(m_entities[handle]);
+
+    for (WorldEntity *e : entities)
+    {
+        e->remove_flags(entity::flags::throttled);
+
+        switch (level)
+        {
+        case world_grid::level::active:
+            Ticker::Suspend(e, false);
+            break;
+        case world_grid::level::reduced:
+            Ticker::Suspend(e, false);
+            if (skip)
+                e->add_flags(entity::flags::throttled);
+            break;
+        case world_grid::level::streamed:
+            if (e->GetStreamType().length())
+                streamed.push(e);
+            LOL_ATTR_FALLTHROUGH
+        case world_grid::level::suspended:
+            Ticker::Suspend(e, true);
+            break;
+        }
+    }
+
+    if (streamed.count())
+        StreamOut(cell, streamed);
+
+    bool ticked = level == world_grid::level::active
+               || (level == world_grid::level::reduced && !skip);
+    return ticked ? entities.count() : 0;
+}
+
 /*
  * Public World class
  */
@@ -41,5 +223,151 @@ World::~World()
 {
 }
 
+void World::SetCellSize(float size)
+{
+    WorldData *data = &g_world_data;
+    ASSERT(!data->m_grid.cell_count(), "cannot resize a non-empty world");
+    data->m_grid = world_grid(size);
+}
+
+void World::SetRadii(float active, float reduced, float suspended)
+{
+    WorldData *data = &g_world_data;
+    data->m_grid.set_radii(active, reduced, suspended,
+                           .5f * data->m_grid.cell_size());
+}
+
+void World::SetReducedRate(int frames)
+{
+    g_world_data.m_reduced_rate = lol::max(frames, 1);
+}
+
+void World::SetFocus(array<vec3> const &focus)
+{
+    g_world_data.m_focus = focus;
+}
+
+void World::Register(WorldEntity *e)
+{
+    WorldData *data = &g_world_data;
+    if (e->m_world_handle >= 0)
+        return;
+
+    Ticker::Ref(e);
+    e->m_world_handle = data->m_grid.insert(e->GetBounds());
+    if (data->m_entities.count() <= e->m_world_handle)
+        data->m_entities.resize(e->m_world_handle + 1);
+    data->m_entities[e->m_world_handle] = e;
+    data->Touch(data->m_grid.cell_of(e->m_world_handle));
+}
+
+void World::Unregister(WorldEntity *e)
+{
+    if (e->m_world_handle < 0)
+        return;
+
+    Remove(e);
+    e->remove_flags(entity::flags::throttled);
+    Ticker::Suspend(e, false);
+    Ticker::Unref(e);
+}
+
+void World::RegisterLoader(std::string const &type, Loader loader)
+{
+    g_world_data.m_loaders[type] = loader;
+}
+
+void World::Update(WorldEntity *e)
+{
+    WorldData *data = &g_world_data;
+    ivec3 cell = data->m_grid.cell_of(e->m_world_handle);
+    data->m_grid.move(e->m_world_handle, e->GetBounds());
+    if (data->m_grid.cell_of(e->m_world_handle) != cell)
+        data->Touch(data->m_grid.cell_of(e->m_world_handle));
+}
+
+void World::Remove(WorldEntity *e)
+{
+    WorldData *data = &g_world_data;
+    data->m_grid.remove(e->m_world_handle);
+    data->m_entities[e->m_world_handle] = nullptr;
+    e->m_world_handle = -1;
+}
+
+void World::Query(box3 const &box, array<WorldEntity *> &out) const
+{
+    WorldData *data = &g_world_data;
+    array<int> handles;
+    data->m_grid.query(box, handles);
+    for (int handle : handles)
+        out.push(data->m_entities[handle]);
+}
+
+void World::Query(vec3 center, float radius, array<WorldEntity *> &out) const
+{
+    WorldData *data = &g_world_data;
+    array<int> handles;
+    data->m_grid.query(center, radius, handles);
+    for (int handle : handles)
+        out.push(data->m_entities[handle]);
+}
+
+world_grid const &World::GetGrid() const
+{
+    return g_world_data.m_grid;
+}
+
+void World::Tick()
+{
+    WorldData *data = &g_world_data;
+    ++data->m_frame;
+
+    array<vec3> focus = data->m_focus;
+    if (!focus.count())
+    {
+        for (int i = 0; i < Scene::GetCount(); ++i)
+            if (Camera *camera = Scene::GetScene(i).GetCamera())
+                focus.push(camera->GetPosition());
+    }
+
+    /* Bring back cells that came into range */
+    array<world_grid::change> changes;
+    data->m_grid.update(focus, changes);
+    for (auto const &c : changes)
+    {
+        if (c.from == world_grid::level::streamed && data->m_grid.is_stored(c.cell))
+            data->StreamIn(c.cell);
+        data->Touch(c.cell);
+    }
+
+    /* Entities keep their flags until their cell changes level or they
+     * move to another cell, so only those cells are visited, and reduced
+     * cells, whose ticks are spread over several frames. */
+    auto skip = [&](ivec3 cell)
+    {
+        uint32_t phase = (uint32_t)(world_grid::cell_key(cell) % (uint64_t)data->m_reduced_rate);
+        return (data->m_frame + phase) % data->m_reduced_rate != 0;
+    };
+
+    for (ivec3 cell : data->m_touched_cells)
+    {
+        world_grid::level level = data->m_grid.cell_level(cell);
+        if (level != world_grid::level::reduced)
+            data->Apply(cell, level, false);
+    }
+    data->m_touched.clear();
+    data->m_touched_cells.clear();
+
+    int ticked = data->m_grid.item_count(world_grid::level::active);
+    for (int n = data->m_grid.resident_count(world_grid::level::reduced); n--; )
+    {
+        ivec3 cell = data->m_grid.resident_cell(world_grid::level::reduced, n);
+        ticked += data->Apply(cell, world_grid::level::reduced, skip(cell));
+    }
+
+    Profiler::SetCounter(Profiler::COUNTER_WORLD_CELLS, data->m_grid.resident_count());
+    Profiler::SetCounter(Profiler::COUNTER_WORLD_TICKED, ticked);
+}
+
 } /* namespace lol */
 
@@ -13,16 +13,61 @@
 //
 // The World class
 // ---------------
+// The world keeps registered WorldEntity objects in a sparse grid of
+// cells. Cells near the focus points (by default, the scene cameras)
+// are ticked normally; further cells are ticked at a reduced rate, then
+// suspended, and finally streamed out: their entities are saved to a
+// compressed blob and destroyed, until the focus comes back.
 //
 
+#include <functional>
+#include <string>
+
+#include "engine/worldgrid.h"
+
 namespace lol
 {
 
+class WorldEntity;
+
 class World
 {
+    friend class WorldEntity;
+    friend class WorldData;
+
 public:
     World();
     virtual ~World();
+
+    /* Recreate an entity of the given type from its saved data */
+    typedef std::function<WorldEntity *(span<uint8_t const> data)> Loader;
+
+    /* Partition settings; the cell size can only change while empty */
+    void SetCellSize(float size);
+    void SetRadii(float active, float reduced, float suspended);
+    void SetReducedRate(int frames);
+
+    /* Use these focus points instead of the scene cameras; an empty
+     * list restores the default. */
+    void SetFocus(array<vec3> const &focus);
+
+    /* The world holds a reference to registered entities */
+    void Register(WorldEntity *entity);
+    void Unregister(WorldEntity *entity);
+    void RegisterLoader(std::string const &type, Loader loader);
+
+    /* Resident entities whose bounds intersect the query */
+    void Query(box3 const &box, array<WorldEntity *> &out) const;
+    void Query(vec3 center, float radius, array<WorldEntity *> &out) const;
+
+    /* Called by the ticker before each game tick */
+    void Tick();
+
+    world_grid const &GetGrid() const;
+
+private:
+    void Update(WorldEntity *entity);
+    void Remove(WorldEntity *entity);
 };
 
 extern World g_world;
@@ -32,6 +32,9 @@ WorldEntity::WorldEntity()
 
 WorldEntity::~WorldEntity()
 {
+    /* Only happens if the world’s reference was forcibly released */
+    if (m_world_handle >= 0)
+        g_world.Remove(this);
 }
 
 std::string WorldEntity::GetName() const
@@ -39,8 +42,19 @@ std::string WorldEntity::GetName() const
     return "<worldentity>";
 }
 
+box3 WorldEntity::GetBounds() const
+{
+    if (m_aabb.aa == m_aabb.bb)
+        return box3(m_position, m_position);
+    return m_aabb;
+}
+
 void WorldEntity::tick_game(float seconds)
 {
+    /* Keep the world partition up to date with our bounds */
+    if (m_world_handle >= 0)
+        g_world.Update(this);
+
     entity::tick_game(seconds);
 }
 
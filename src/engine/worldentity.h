@@ -29,6 +29,16 @@ class WorldEntity : public entity
 public:
     virtual std::string GetName() const;
 
+    /* The bounds used by the world partition: m_aabb if it is not
+     * empty, otherwise m_position. */
+    box3 GetBounds() const;
+
+    /* Entities with a stream type are saved and destroyed when their
+     * cell is streamed out, then recreated by the loader registered
+     * with World::RegisterLoader() for that type. */
+    virtual std::string GetStreamType() const { return std::string(); }
+    virtual void SaveStream(array<uint8_t> &data) const { UNUSED(data); }
+
 public:
     box3 m_aabb;
     vec3 m_position = vec3::zero;
@@ -42,6 +52,10 @@ protected:
 
     virtual void tick_game(float seconds);
     virtual void tick_draw(float seconds, Scene &scene);
+
+private:
+    friend class World;
+    int m_world_handle = -1;
 };
 
 } /* namespace lol */
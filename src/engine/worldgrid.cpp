@@ -0,0 +1,414 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include "engine/worldgrid.h"
+
+namespace lol
+{
+
+static float box_distance(box3 const &box, vec3 p)
+{
+    return length(max(max(box.aa - p, p - box.bb), vec3(0.f)));
+}
+
+static float half_size(box3 const &box)
+{
+    vec3 e = box.extent();
+    return lol::max(e.x, lol::max(e.y, e.z)) * .5f;
+}
+
+world_grid::world_grid(float cell_size)
+  : m_cell_size(cell_size)
+{
+    set_radii(2.f * cell_size, 4.f * cell_size, 8.f * cell_size, .5f * cell_size);
+}
+
+void world_grid::set_radii(float active, float reduced, float suspended,
+                           float hysteresis)
+{
+    m_radii[0] = active;
+    m_radii[1] = lol::max(active, reduced);
+    m_radii[2] = lol::max(m_radii[1], suspended);
+    m_hysteresis = hysteresis;
+
+    /* Force a full rescan at the next update */
+    m_focus_keys.clear();
+}
+
+uint64_t world_grid::cell_key(ivec3 key)
+{
+    /* 21 bits per axis, which is plenty for any sane cell size */
+    uint64_t const mask = (1 << 21) - 1;
+    return ((uint64_t)(key.x + (1 << 20)) & mask)
+         | ((uint64_t)(key.y + (1 << 20)) & mask) << 21
+         | ((uint64_t)(key.z + (1 << 20)) & mask) << 42;
+}
+
+ivec3 world_grid::key_of(vec3 p) const
+{
+    vec3 k = p / m_cell_size;
+    return ivec3((int)lol::floor(k.x), (int)lol::floor(k.y), (int)lol::floor(k.z));
+}
+
+world_grid::cell_data &world_grid::get_cell(ivec3 key)
+{
+    auto it = m_cells.find(cell_key(key));
+    if (it != m_cells.end())
+        return it->second;
+
+    /* A new cell gets its level without any hysteresis */
+    cell_data &cell = m_cells[cell_key(key)];
+    cell.m_key = key;
+    cell.m_level = m_focus.count() ? evaluate(key, level::streamed) : level::active;
+    return cell;
+}
+
+void world_grid::release_cell(cell_data &cell)
+{
+    if (cell.m_resident >= 0)
+        unlist(cell);
+
+    if (cell.m_stored)
+        m_watch.insert(cell_key(cell.m_key));
+    else
+        m_cells.erase(cell_key(cell.m_key));
+}
+
+/* Resident cells are in the list of their level */
+void world_grid::enlist(cell_data &cell)
+{
+    auto &list = m_resident[(int)cell.m_level];
+    cell.m_resident = list.count();
+    list.push(&cell);
+    m_item_count[(int)cell.m_level] += cell.m_items.count();
+}
+
+void world_grid::unlist(cell_data &cell)
+{
+    auto &list = m_resident[(int)cell.m_level];
+    list.remove_swap(cell.m_resident);
+    if (cell.m_resident < list.count())
+        list[cell.m_resident]->m_resident = cell.m_resident;
+    cell.m_resident = -1;
+    m_item_count[(int)cell.m_level] -= cell.m_items.count();
+}
+
+void world_grid::set_level(cell_data &cell, level l)
+{
+    bool resident = cell.m_resident >= 0;
+    if (resident)
+        unlist(cell);
+    cell.m_level = l;
+    if (resident)
+        enlist(cell);
+}
+
+int world_grid::resident_count() const
+{
+    int ret = 0;
+    for (auto const &list : m_resident)
+        ret += list.count();
+    return ret;
+}
+
+array<int> const *world_grid::cell_items(ivec3 key) const
+{
+    auto it = m_cells.find(cell_key(key));
+    return it != m_cells.end() && it->second.m_items.count()
+         ? &it->second.m_items : nullptr;
+}
+
+world_grid::level world_grid::cell_level(ivec3 key) const
+{
+    auto it = m_cells.find(cell_key(key));
+    if (it != m_cells.end())
+        return it->second.m_level;
+    return m_focus.count() ? evaluate(key, level::streamed) : level::active;
+}
+
+void world_grid::link(int handle)
+{
+    item_data &item = m_items[handle];
+    cell_data &cell = get_cell(key_of(item.m_bounds.center()));
+
+    item.m_cell = &cell;
+    item.m_slot = cell.m_items.count();
+    cell.m_items.push(handle);
+
+    if (cell.m_resident < 0)
+        enlist(cell);
+    else
+        ++m_item_count[(int)cell.m_level];
+}
+
+void world_grid::unlink(int handle)
+{
+    item_data &item = m_items[handle];
+    cell_data &cell = *item.m_cell;
+
+    cell.m_items.remove_swap(item.m_slot);
+    if (item.m_slot < cell.m_items.count())
+        m_items[cell.m_items[item.m_slot]].m_slot = item.m_slot;
+    item.m_cell = nullptr;
+    --m_item_count[(int)cell.m_level];
+
+    if (!cell.m_items.count())
+        release_cell(cell);
+}
+
+int world_grid::insert(box3 const &bounds)
+{
+    int handle;
+    if (m_free.count())
+    {
+        handle = m_free.pop();
+    }
+    else
+    {
+        handle = m_items.count();
+        m_items.push(item_data());
+    }
+
+    m_items[handle].m_bounds = bounds;
+    grow_loose(half_size(bounds));
+    link(handle);
+    return handle;
+}
+
+void world_grid::move(int handle, box3 const &bounds)
+{
+    item_data &item = m_items[handle];
+    bool relink = key_of(bounds.center()) != item.m_cell->m_key;
+    float old_size = half_size(item.m_bounds), size = half_size(bounds);
+
+    if (relink)
+        unlink(handle);
+    item.m_bounds = bounds;
+    if (size != old_size)
+    {
+        shrink_loose(old_size);
+        grow_loose(size);
+    }
+    if (relink)
+        link(handle);
+}
+
+void world_grid::remove(int handle)
+{
+    shrink_loose(half_size(m_items[handle].m_bounds));
+    unlink(handle);
+    m_free.push(handle);
+}
+
+void world_grid::grow_loose(float size)
+{
+    if (size > m_loose)
+    {
+        m_loose = size;
+        m_loose_count = 0;
+    }
+    if (size == m_loose)
+    {
+        ++m_loose_count;
+        m_loose_dirty = false;
+    }
+}
+
+void world_grid::shrink_loose(float size)
+{
+    /* Until update() recomputes it, queries just visit a few more cells */
+    if (size == m_loose && m_loose_count > 0 && --m_loose_count == 0)
+        m_loose_dirty = true;
+}
+
+template<typename F> void world_grid::visit(box3 const &box, F f) const
+{
+    /* Items may stick out of their cell by up to m_loose */
+    ivec3 lo = key_of(box.aa - vec3(m_loose));
+    ivec3 hi = key_of(box.bb + vec3(m_loose));
+    vec3 span = vec3(hi - lo + ivec3(1));
+
+    /* Walk whichever is smaller: the key range, or the cell list */
+    if (span.x * span.y * span.z > (float)m_cells.size())
+    {
+        for (auto const &it : m_cells)
+        {
+            ivec3 k = it.second.m_key;
+            if (k.x >= lo.x && k.y >= lo.y && k.z >= lo.z
+                 && k.x <= hi.x && k.y <= hi.y && k.z <= hi.z)
+                f(it.second);
+        }
+        return;
+    }
+
+    for (int z = lo.z; z <= hi.z; ++z)
+    for (int y = lo.y; y <= hi.y; ++y)
+    for (int x = lo.x; x <= hi.x; ++x)
+    {
+        auto it = m_cells.find(cell_key(ivec3(x, y, z)));
+        if (it != m_cells.end())
+            f(it->second);
+    }
+}
+
+void world_grid::query(box3 const &box, array<int> &out) const
+{
+    visit(box, [&](cell_data const &cell)
+    {
+        for (int handle : cell.m_items)
+            if (TestAABBVsAABB(m_items[handle].m_bounds, box))
+                out.push(handle);
+    });
+}
+
+void world_grid::query(vec3 center, float radius, array<int> &out) const
+{
+    visit(box3(center - vec3(radius), center + vec3(radius)),
+          [&](cell_data const &cell)
+    {
+        for (int handle : cell.m_items)
+            if (box_distance(m_items[handle].m_bounds, center) <= radius)
+                out.push(handle);
+    });
+}
+
+world_grid::level world_grid::evaluate(ivec3 key, level previous) const
+{
+    if (!m_focus.count())
+        return previous;
+
+    box3 box(vec3(key) * m_cell_size, vec3(key + ivec3(1)) * m_cell_size);
+    float dist = box_distance(box, m_focus[0]);
+    for (int i = 1; i < m_focus.count(); ++i)
+        dist = lol::min(dist, box_distance(box, m_focus[i]));
+
+    auto get_level = [&](float bias)
+    {
+        int n = 0;
+        while (n < 3 && dist > m_radii[n] + bias)
+            ++n;
+        return n;
+    };
+
+    /* Only demote cells once they are clearly out of range */
+    int ret = get_level(0.f);
+    if (ret > (int)previous)
+        ret = lol::max((int)previous, get_level(m_hysteresis));
+    return (level)ret;
+}
+
+void world_grid::update(array<vec3> const &focus, array<change> &changes)
+{
+    if (m_loose_dirty)
+    {
+        m_loose = 0.f;
+        m_loose_count = 0;
+        m_loose_dirty = false;
+        for (item_data const &item : m_items)
+            if (item.m_cell)
+                grow_loose(half_size(item.m_bounds));
+    }
+
+    m_focus = focus;
+    if (!m_focus.count())
+        return;
+
+    auto apply = [&](cell_data &cell, level l)
+    {
+        changes.push(change { cell.m_key, cell.m_level, l });
+        set_level(cell, l);
+    };
+
+    /* Cells without items are only looked for when a focus point enters
+     * a new cell; those that could come into range before that happens
+     * are watched, so that idle frames only visit nearby cells. */
+    array<ivec3> keys;
+    for (vec3 const &p : m_focus)
+        keys.push(key_of(p));
+
+    if (!(keys == m_focus_keys))
+    {
+        m_focus_keys = keys;
+        m_watch.clear();
+
+        float r = m_radii[2] + 2.f * m_cell_size;
+        for (vec3 const &p : m_focus)
+        {
+            visit(box3(p - vec3(r), p + vec3(r)), [&](cell_data const &cell)
+            {
+                if (cell.m_resident < 0)
+                    m_watch.insert(cell_key(cell.m_key));
+            });
+        }
+    }
+
+    for (auto it = m_watch.begin(); it != m_watch.end(); )
+    {
+        auto cell = m_cells.find(*it);
+        if (cell == m_cells.end())
+        {
+            it = m_watch.erase(it);
+            continue;
+        }
+
+        if (cell->second.m_resident < 0)
+        {
+            level l = evaluate(cell->second.m_key, cell->second.m_level);
+            if (l != cell->second.m_level)
+                apply(cell->second, l);
+        }
+        ++it;
+    }
+
+    /* Changing levels moves cells between lists, so do it afterwards */
+    array<cell_data *, level> moved;
+    for (auto const &list : m_resident)
+        for (cell_data *cell : list)
+        {
+            level l = evaluate(cell->m_key, cell->m_level);
+            if (l != cell->m_level)
+                moved.push(cell, l);
+        }
+
+    for (auto const &it : moved)
+        apply(*it.m1, it.m2);
+}
+
+void world_grid::set_stored(ivec3 key, bool stored)
+{
+    auto it = m_cells.find(cell_key(key));
+    if (it == m_cells.end())
+    {
+        if (stored)
+        {
+            get_cell(key).m_stored = true;
+            m_watch.insert(cell_key(key));
+        }
+        return;
+    }
+
+    cell_data &cell = it->second;
+    cell.m_stored = stored;
+    if (!stored && !cell.m_items.count())
+        release_cell(cell);
+}
+
+bool world_grid::is_stored(ivec3 key) const
+{
+    auto it = m_cells.find(cell_key(key));
+    return it != m_cells.end() && it->second.m_stored;
+}
+
+} /* namespace lol */
+
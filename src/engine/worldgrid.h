@@ -0,0 +1,156 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// The world_grid class
+// --------------------
+//
+// A sparse, loose grid of cubic cells. Items are stored in the cell that
+// contains the centre of their bounds, and cells get a level of detail
+// from their distance to a set of focus points (usually the cameras):
+// active, reduced, suspended or streamed. Only cells that hold items
+// are visited every frame, so the cost depends on the loaded content
+// and not on the size of the whole world. They are listed by level, so
+// that callers only need to look at the levels they care about.
+//
+
+#include <unordered_map>
+#include <unordered_set>
+
+namespace lol
+{
+
+class world_grid
+{
+public:
+    enum class level : uint8_t
+    {
+        active = 0,
+        reduced,
+        suspended,
+        streamed,
+    };
+
+    struct change
+    {
+        ivec3 cell;
+        level from, to;
+    };
+
+    world_grid(float cell_size = 64.f);
+
+    /* Distances beyond which cells get reduced, suspended and streamed.
+     * Cells only get demoted once they are hysteresis further away. */
+    void set_radii(float active, float reduced, float suspended,
+                   float hysteresis);
+
+    float cell_size() const { return m_cell_size; }
+
+    /* Items are identified by the handle returned by insert() */
+    int insert(box3 const &bounds);
+    void move(int handle, box3 const &bounds);
+    void remove(int handle);
+
+    ivec3 cell_of(int handle) const { return m_items[handle].m_cell->m_key; }
+    level level_of(int handle) const { return m_items[handle].m_cell->m_level; }
+    box3 const &bounds_of(int handle) const { return m_items[handle].m_bounds; }
+
+    /* Append the handles of items whose bounds intersect the query */
+    void query(box3 const &box, array<int> &out) const;
+    void query(vec3 center, float radius, array<int> &out) const;
+
+    /* Compute cell levels for a new set of focus points and append the
+     * cells that changed level to changes. With no focus points, cell
+     * levels are left untouched. */
+    void update(array<vec3> const &focus, array<change> &changes);
+
+    /* Cells holding items, by level; iterate backwards if items may be
+     * removed */
+    int resident_count() const;
+    int resident_count(level l) const { return m_resident[(int)l].count(); }
+    ivec3 resident_cell(level l, int n) const { return m_resident[(int)l][n]->m_key; }
+    array<int> const &resident_items(level l, int n) const { return m_resident[(int)l][n]->m_items; }
+
+    /* The number of items in cells of a given level */
+    int item_count(level l) const { return m_item_count[(int)l]; }
+
+    /* The items in a cell, or nullptr if it holds none, and its level */
+    array<int> const *cell_items(ivec3 cell) const;
+    level cell_level(ivec3 cell) const;
+
+    /* Mark whether a cell holds streamed-out content. Such cells are
+     * kept while empty so that their level keeps being tracked. */
+    void set_stored(ivec3 cell, bool stored);
+    bool is_stored(ivec3 cell) const;
+
+    int cell_count() const { return (int)m_cells.size(); }
+
+    /* How far items may stick out of their cell; it is recomputed at the
+     * next update when the largest item leaves or shrinks */
+    float loose() const { return m_loose; }
+
+    /* A unique 64-bit key for a cell */
+    static uint64_t cell_key(ivec3 cell);
+
+private:
+    struct cell_data
+    {
+        ivec3 m_key;
+        level m_level = level::active;
+        bool m_stored = false;
+        int m_resident = -1;
+        array<int> m_items;
+    };
+
+    struct item_data
+    {
+        box3 m_bounds;
+        cell_data *m_cell = nullptr;
+        int m_slot = -1;
+    };
+
+    ivec3 key_of(vec3 p) const;
+    cell_data &get_cell(ivec3 key);
+    void release_cell(cell_data &cell);
+    void enlist(cell_data &cell);
+    void unlist(cell_data &cell);
+    void set_level(cell_data &cell, level l);
+    void grow_loose(float size);
+    void shrink_loose(float size);
+    void link(int handle);
+    void unlink(int handle);
+    level evaluate(ivec3 key, level previous) const;
+    template<typename F> void visit(box3 const &box, F f) const;
+
+    float m_cell_size;
+    float m_radii[3], m_hysteresis;
+
+    /* The largest item half size, and how many items have it */
+    float m_loose = 0.f;
+    int m_loose_count = 0;
+    bool m_loose_dirty = false;
+
+    std::unordered_map<uint64_t, cell_data> m_cells;
+    array<cell_data *> m_resident[4];
+    int m_item_count[4] = { 0, 0, 0, 0 };
+    array<item_data> m_items;
+    array<int> m_free;
+
+    array<vec3> m_focus;
+    array<ivec3> m_focus_keys;
+    std::unordered_set<uint64_t> m_watch;
+};
+
+} /* namespace lol */
+
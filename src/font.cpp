@@ -46,18 +46,67 @@ Font *Font::create(std::string const &path)
     return ret ? ret : font_cache.set(path, new Font(path));
 }
 
+Font *Font::create_sdf(std::string const &path, float radius)
+{
+    std::string key = format("<sdf %g> %s", radius, path.c_str());
+    auto ret = font_cache.get(key);
+    return ret ? ret : font_cache.set(key, new Font(path, lol::max(radius, 0.f)));
+}
+
 void Font::destroy(Font *f)
 {
     // FIXME: decrement!
     font_cache.erase(f);
 }
 
-Font::Font(std::string const &path)
+/* A negative radius means a bitmap font; zero means a distance field
+ * atlas; anything else means a distance field computed from a bitmap. */
+Font::Font(std::string const &path, float radius)
   : data(new FontData())
 {
     data->m_name = "<font> " + path;
 
-    data->tileset = TileSet::create(path, ivec2::zero, ivec2(16));
+    if (radius > 0.f)
+    {
+        /* Compute the field of each glyph separately, so that glyphs
+         * do not bleed into their neighbours */
+        image src(path);
+        ivec2 const size = src.size() / ivec2(16);
+        image dst(src.size());
+        vec4 *pixels = src.lock<PixelFormat::RGBA_F32>();
+        u8vec4 *out = dst.lock<PixelFormat::RGBA_8>();
+
+        for (int n = 0; n < 256; ++n)
+        {
+            ivec2 const origin = size * ivec2(n % 16, n / 16);
+            image glyph(size);
+            float *coverage = glyph.lock<PixelFormat::Y_F32>();
+            for (int y = 0; y < size.y; ++y)
+                for (int x = 0; x < size.x; ++x)
+                    coverage[y * size.x + x] = pixels[(origin.y + y) * src.size().x + origin.x + x].a;
+            glyph.unlock(coverage);
+
+            image field = glyph.signed_distance_field(radius);
+            float *values = field.lock<PixelFormat::Y_F32>();
+            for (int y = 0; y < size.y; ++y)
+                for (int x = 0; x < size.x; ++x)
+                    out[(origin.y + y) * src.size().x + origin.x + x]
+                        = u8vec4(255, 255, 255, (uint8_t)(values[y * size.x + x] * 255.f + 0.5f));
+            field.unlock(values);
+        }
+
+        src.unlock(pixels);
+        dst.unlock(out);
+
+        data->tileset = TileSet::create("<sdf> " + path, new image(dst), ivec2::zero, ivec2(16));
+    }
+    else
+    {
+        data->tileset = TileSet::create(path, ivec2::zero, ivec2(16));
+    }
+
+    if (radius >= 0.f)
+        data->tileset->SetDistanceField(true);
     data->size = data->tileset->GetTileSize(0);
 
     m_drawgroup = tickable::group::draw::texture;
@@ -28,10 +28,15 @@ class Font : public entity
 {
 public:
     static Font *create(std::string const &path);
+    /* A font drawn from a signed distance field atlas, which stays sharp
+     * when scaled. If radius is zero, the file already holds the field,
+     * e.g. made offline with image::signed_distance_field(); otherwise
+     * it is a bitmap font and the field is computed at load time. */
+    static Font *create_sdf(std::string const &path, float radius = 0.f);
     static void destroy(Font *);
 
 protected:
-    Font(std::string const &path);
+    Font(std::string const &path, float radius = -1.f);
     ~Font();
 
     /* Inherited from entity */
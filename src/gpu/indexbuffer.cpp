@@ -31,7 +31,10 @@ class IndexBufferData
 
     size_t m_size;
     GLuint m_ibo;
-    uint8_t *m_memory;
+
+    /* Temporary storage between Lock() and Unlock() */
+    uint8_t *m_memory = nullptr;
+    size_t m_lock_offset, m_lock_size;
 };
 
 //
@@ -46,16 +49,15 @@ IndexBuffer::IndexBuffer(size_t size)
     if (!size)
         return;
     glGenBuffers(1, &m_data->m_ibo);
-    m_data->m_memory = new uint8_t[size];
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_data->m_ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, nullptr, GL_STATIC_DRAW);
 }
 
 IndexBuffer::~IndexBuffer()
 {
     if (m_data->m_size)
-    {
         glDeleteBuffers(1, &m_data->m_ibo);
-        delete[] m_data->m_memory;
-    }
+    delete[] m_data->m_memory;
     delete m_data;
 }
 
@@ -66,21 +68,35 @@ size_t IndexBuffer::GetSize()
 
 void *IndexBuffer::Lock(size_t offset, size_t size)
 {
-    if (!m_data->m_size)
+    if (!m_data->m_size || offset >= m_data->m_size)
         return nullptr;
 
-    UNUSED(size);
-    return m_data->m_memory + offset;
+    ASSERT(!m_data->m_memory, "index buffer is already locked");
+    m_data->m_lock_offset = offset;
+    m_data->m_lock_size = size ? lol::min(size, m_data->m_size - offset)
+                               : m_data->m_size - offset;
+    m_data->m_memory = new uint8_t[m_data->m_lock_size];
+    return m_data->m_memory;
 }
 
 void IndexBuffer::Unlock()
 {
-    if (!m_data->m_size)
+    if (!m_data->m_memory)
+        return;
+
+    Upload(m_data->m_lock_offset, m_data->m_memory, m_data->m_lock_size);
+    delete[] m_data->m_memory;
+    m_data->m_memory = nullptr;
+}
+
+void IndexBuffer::Upload(size_t offset, void const *data, size_t size)
+{
+    if (!size)
         return;
 
+    ASSERT(offset + size <= m_data->m_size, "upload out of index buffer bounds");
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_data->m_ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_data->m_size, m_data->m_memory,
-                 GL_STATIC_DRAW);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, size, data);
 }
 
 void IndexBuffer::Bind()
@@ -83,9 +83,8 @@ private:
     std::string m_name;
 
     GLuint prog_id, vert_id, frag_id;
-    // Benlitz: using a simple array could be faster since there is never more than a few attribute locations to store
-    std::map<uint64_t, GLint> attrib_locations;
-    std::map<uint64_t, bool> attrib_errors;
+    hash_map<uint64_t, GLint> attrib_locations;
+    hash_map<uint64_t, bool> attrib_errors;
     size_t vert_crc, frag_crc;
 
     /* Shader patcher */
@@ -107,7 +106,7 @@ struct lolfx_parser
 {
 public:
     std::string m_section;
-    std::map<std::string, std::string> m_programs;
+    hash_map<std::string, std::string> m_programs;
 
 private:
     // title <- '[' (!']')+ ']' .{eol}
@@ -17,6 +17,20 @@
 // FIXME: fine-tune this define
 #if defined LOL_USE_GLEW || defined HAVE_GL_2X || defined HAVE_GLES_2X
 
+/* Compressed formats may be missing from older headers */
+#if !defined GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#   define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#if !defined GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#   define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#if !defined GL_COMPRESSED_RGB8_ETC2
+#   define GL_COMPRESSED_RGB8_ETC2 0x9274
+#endif
+#if !defined GL_COMPRESSED_RGBA8_ETC2_EAC
+#   define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#endif
+
 namespace lol
 {
 
@@ -36,8 +50,23 @@ class TextureData
     GLint m_internal_format;
     GLenum m_gl_format, m_gl_type;
     int m_bytes_per_elem;
+
+    /* Non-zero for block compressed textures */
+    GLenum m_gl_compressed = 0;
 };
 
+static GLenum gl_compressed_format(CompressedFormat format)
+{
+    switch (format)
+    {
+    case CompressedFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case CompressedFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case CompressedFormat::ETC2_RGB8: return GL_COMPRESSED_RGB8_ETC2;
+    case CompressedFormat::ETC2_RGBA8: return GL_COMPRESSED_RGBA8_ETC2_EAC;
+    }
+    return 0;
+}
+
 //
 // The Texture class
 // -----------------
@@ -93,6 +122,33 @@ Texture::Texture(ivec2 size, PixelFormat format)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 }
 
+Texture::Texture(ivec2 size, CompressedFormat format)
+  : Texture(size, PixelFormat::RGBA_8)
+{
+    m_data->m_gl_compressed = gl_compressed_format(format);
+}
+
+bool Texture::IsSupported(CompressedFormat format)
+{
+    /* The list cannot change once there is a context */
+    static array<GLint> formats;
+    static bool init = false;
+    if (!init)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+        formats.resize(count);
+        if (count)
+            glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+        init = true;
+    }
+
+    for (GLint f : formats)
+        if (f == (GLint)gl_compressed_format(format))
+            return true;
+    return false;
+}
+
 TextureUniform Texture::GetTextureUniform() const
 {
     TextureUniform ret;
@@ -108,19 +164,31 @@ void Texture::Bind()
     glBindTexture(GL_TEXTURE_2D, m_data->m_texture);
 }
 
-void Texture::SetData(void *data)
+void Texture::SetData(void const *data, int level)
 {
-    glTexImage2D(GL_TEXTURE_2D, 0, m_data->m_internal_format,
-                 m_data->m_size.x, m_data->m_size.y, 0,
+    ivec2 size(lol::max(1, m_data->m_size.x >> level),
+               lol::max(1, m_data->m_size.y >> level));
+    glTexImage2D(GL_TEXTURE_2D, level, m_data->m_internal_format,
+                 size.x, size.y, 0,
                  m_data->m_gl_format, m_data->m_gl_type, data);
 }
 
-void Texture::SetSubData(ivec2 origin, ivec2 size, void *data)
+void Texture::SetSubData(ivec2 origin, ivec2 size, void const *data, int level)
 {
-    glTexSubImage2D(GL_TEXTURE_2D, 0, origin.x, origin.y, size.x, size.y,
+    glTexSubImage2D(GL_TEXTURE_2D, level, origin.x, origin.y, size.x, size.y,
                     m_data->m_gl_format, m_data->m_gl_type, data);
 }
 
+void Texture::SetCompressedData(span<uint8_t const> data, int level)
+{
+    ASSERT(m_data->m_gl_compressed, "texture is not compressed");
+
+    ivec2 size(lol::max(1, m_data->m_size.x >> level),
+               lol::max(1, m_data->m_size.y >> level));
+    glCompressedTexImage2D(GL_TEXTURE_2D, level, m_data->m_gl_compressed,
+                           size.x, size.y, 0, (GLsizei)data.size(), data.data());
+}
+
 void Texture::SetMagFiltering(TextureMagFilter filter)
 {
     glBindTexture(GL_TEXTURE_2D, m_data->m_texture);
@@ -0,0 +1,157 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+namespace lol
+{
+
+//
+// The transient_allocator class
+// -----------------------------
+//
+
+transient_allocator::transient_allocator(size_t page_size, int fence)
+  : m_page_size(page_size),
+    m_fence(fence)
+{
+}
+
+transient_allocator::allocation transient_allocator::alloc(size_t size, size_t align)
+{
+    ++m_allocs;
+    m_bytes += size;
+
+    /* Keep filling the current page if there is room left; the unused
+     * part of a page is never read by the GPU, even across frames. */
+    if (m_current >= 0)
+    {
+        page_data &p = m_pages[m_current];
+        size_t offset = (p.m_used + align - 1) / align * align;
+        if (offset + size <= p.m_size)
+        {
+            p.m_used = offset + size;
+            p.m_frame = m_frame;
+            return allocation { m_current, offset };
+        }
+    }
+
+    /* Otherwise, rewind the smallest page that is large enough and that
+     * was last used at least m_fence frames ago */
+    int best = -1;
+    for (int i = 0; i < m_pages.count(); ++i)
+    {
+        page_data const &p = m_pages[i];
+        if (i == m_current || p.m_size < size || m_frame - p.m_frame < m_fence)
+            continue;
+        if (best < 0 || p.m_size < m_pages[best].m_size)
+            best = i;
+    }
+
+    /* Or create a new page; allocations larger than a page get their
+     * own, which is recycled like the others afterwards */
+    if (best < 0)
+    {
+        best = m_pages.count();
+        m_pages.push(page_data { lol::max(size, m_page_size), 0, m_frame });
+    }
+
+    m_pages[best].m_used = size;
+    m_pages[best].m_frame = m_frame;
+    m_current = best;
+    return allocation { best, 0 };
+}
+
+void transient_allocator::next_frame()
+{
+    m_last_bytes = m_bytes;
+    m_last_allocs = m_allocs;
+    m_bytes = 0;
+    m_allocs = 0;
+    ++m_frame;
+}
+
+//
+// The TransientBuffer class
+// -------------------------
+//
+
+template<typename T> struct transient_pool
+{
+    transient_range<T> upload(void const *data, size_t size)
+    {
+        int count = m_allocator.page_count();
+        auto a = m_allocator.alloc(size);
+        if (m_allocator.page_count() > count)
+            m_buffers.push(std::make_shared<T>(m_allocator.page_size(a.page)));
+
+        m_buffers[a.page]->Upload(a.offset, data, size);
+        return transient_range<T> { m_buffers[a.page], a.offset };
+    }
+
+    transient_allocator m_allocator;
+    array<std::shared_ptr<T>> m_buffers;
+};
+
+static transient_pool<VertexBuffer> g_vertex_pool;
+static transient_pool<IndexBuffer> g_index_pool;
+
+/* Catch up with the ticker and publish the last frame’s statistics;
+ * after a few frames every page can be recycled anyway, so there is
+ * no need to count further. */
+static void sync_pools()
+{
+    static int ticker_frame = -1;
+
+    int frame = ticker::GetFrameNum();
+    if (frame == ticker_frame)
+        return;
+
+    for (int i = 0; i < 16 && i < frame - ticker_frame; ++i)
+    {
+        g_vertex_pool.m_allocator.next_frame();
+        g_index_pool.m_allocator.next_frame();
+    }
+    ticker_frame = frame;
+
+    transient_allocator const &vtx = g_vertex_pool.m_allocator;
+    transient_allocator const &idx = g_index_pool.m_allocator;
+    Profiler::SetCounter(Profiler::COUNTER_TRANSIENT_BYTES,
+                         (int)(vtx.last_frame_bytes() + idx.last_frame_bytes()));
+    Profiler::SetCounter(Profiler::COUNTER_TRANSIENT_ALLOCS,
+                         vtx.last_frame_allocs() + idx.last_frame_allocs());
+}
+
+transient_range<VertexBuffer> TransientBuffer::UploadVertices(void const *data, size_t size)
+{
+    sync_pools();
+    return g_vertex_pool.upload(data, size);
+}
+
+transient_range<IndexBuffer> TransientBuffer::UploadIndices(void const *data, size_t size)
+{
+    sync_pools();
+    return g_index_pool.upload(data, size);
+}
+
+transient_allocator const &TransientBuffer::GetVertexAllocator()
+{
+    return g_vertex_pool.m_allocator;
+}
+
+transient_allocator const &TransientBuffer::GetIndexAllocator()
+{
+    return g_index_pool.m_allocator;
+}
+
+} /* namespace lol */
+
@@ -33,7 +33,10 @@ class VertexBufferData
     size_t m_size;
 
     GLuint m_vbo;
-    uint8_t *m_memory;
+
+    /* Temporary storage between Lock() and Unlock() */
+    uint8_t *m_memory = nullptr;
+    size_t m_lock_offset, m_lock_size;
 };
 
 //
@@ -167,10 +170,37 @@ void VertexDeclaration::SetStream(std::shared_ptr<VertexBuffer> vb,
     ShaderAttrib attribs[12] = { attr1, attr2, attr3, attr4, attr5, attr6,
                            attr7, attr8, attr9, attr10, attr11, attr12 };
 
-    SetStream(vb, attribs);
+    SetStream(vb, 0, attribs);
 }
 
 void VertexDeclaration::SetStream(std::shared_ptr<VertexBuffer> vb, ShaderAttrib attribs[])
+{
+    SetStream(vb, 0, attribs);
+}
+
+void VertexDeclaration::SetStream(std::shared_ptr<VertexBuffer> vb,
+                                  size_t offset,
+                                  ShaderAttrib attr1,
+                                  ShaderAttrib attr2,
+                                  ShaderAttrib attr3,
+                                  ShaderAttrib attr4,
+                                  ShaderAttrib attr5,
+                                  ShaderAttrib attr6,
+                                  ShaderAttrib attr7,
+                                  ShaderAttrib attr8,
+                                  ShaderAttrib attr9,
+                                  ShaderAttrib attr10,
+                                  ShaderAttrib attr11,
+                                  ShaderAttrib attr12)
+{
+    ShaderAttrib attribs[12] = { attr1, attr2, attr3, attr4, attr5, attr6,
+                           attr7, attr8, attr9, attr10, attr11, attr12 };
+
+    SetStream(vb, offset, attribs);
+}
+
+void VertexDeclaration::SetStream(std::shared_ptr<VertexBuffer> vb,
+                                  size_t base, ShaderAttrib attribs[])
 {
     if (!vb->m_data->m_size)
         return;
@@ -264,14 +294,14 @@ void VertexDeclaration::SetStream(std::shared_ptr<VertexBuffer> vb, ShaderAttrib
                                    || (tlut[type_index].type == GL_BYTE);
                 glVertexAttribPointer((GLint)reg, tlut[type_index].size,
                                       tlut[type_index].type, normalize,
-                                      stride, (GLvoid const *)(uintptr_t)offset);
+                                      stride, (GLvoid const *)(uintptr_t)(base + offset));
             }
 #if defined GL_VERSION_3_0 && !(defined LOL_USE_GLEW && !defined glVertexAttribIPointer)
             else
             {
                 glVertexAttribIPointer((GLint)reg, tlut[type_index].size,
                                        tlut[type_index].type,
-                                       stride, (GLvoid const *)(uintptr_t)offset);
+                                       stride, (GLvoid const *)(uintptr_t)(base + offset));
             }
 #endif
         }
@@ -347,17 +377,18 @@ VertexBuffer::VertexBuffer(size_t size)
     if (!size)
         return;
 
+    /* Only allocate GPU storage; there is no CPU copy of the data */
     glGenBuffers(1, &m_data->m_vbo);
-    m_data->m_memory = new uint8_t[size];
+    glBindBuffer(GL_ARRAY_BUFFER, m_data->m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 VertexBuffer::~VertexBuffer()
 {
     if (m_data->m_size)
-    {
         glDeleteBuffers(1, &m_data->m_vbo);
-        delete[] m_data->m_memory;
-    }
+    delete[] m_data->m_memory;
     delete m_data;
 }
 
@@ -368,22 +399,35 @@ size_t VertexBuffer::GetSize()
 
 void *VertexBuffer::Lock(size_t offset, size_t size)
 {
-    if (!m_data->m_size)
+    if (!m_data->m_size || offset >= m_data->m_size)
         return nullptr;
 
-    /* FIXME: is there a way to use "size"? */
-    UNUSED(size);
-    return m_data->m_memory + offset;
+    ASSERT(!m_data->m_memory, "vertex buffer is already locked");
+    m_data->m_lock_offset = offset;
+    m_data->m_lock_size = size ? lol::min(size, m_data->m_size - offset)
+                               : m_data->m_size - offset;
+    m_data->m_memory = new uint8_t[m_data->m_lock_size];
+    return m_data->m_memory;
 }
 
 void VertexBuffer::Unlock()
 {
-    if (!m_data->m_size)
+    if (!m_data->m_memory)
+        return;
+
+    Upload(m_data->m_lock_offset, m_data->m_memory, m_data->m_lock_size);
+    delete[] m_data->m_memory;
+    m_data->m_memory = nullptr;
+}
+
+void VertexBuffer::Upload(size_t offset, void const *data, size_t size)
+{
+    if (!size)
         return;
 
+    ASSERT(offset + size <= m_data->m_size, "upload out of vertex buffer bounds");
     glBindBuffer(GL_ARRAY_BUFFER, m_data->m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, m_data->m_size, m_data->m_memory,
-                 GL_STATIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
@@ -30,7 +30,7 @@ class GradientData
 private:
     std::shared_ptr<Shader> shader;
     std::shared_ptr<VertexDeclaration> m_vdecl;
-    std::shared_ptr<VertexBuffer> m_vbo, m_cbo;
+    std::shared_ptr<VertexBuffer> m_cbo;
 };
 
 /*
@@ -73,8 +73,9 @@ void Gradient::tick_draw(float seconds, Scene &scene)
     {
         data->shader = Shader::Create(LOLFX_RESOURCE_NAME(gradient));
 
-        data->m_vbo = std::make_shared<VertexBuffer>(sizeof(vertex));
+        /* The colours never change, only the vertices do */
         data->m_cbo = std::make_shared<VertexBuffer>(sizeof(color));
+        data->m_cbo->Upload(0, color, sizeof(color));
 
         data->m_vdecl = std::make_shared<VertexDeclaration>
                             (VertexStream<vec3>(VertexUsage::Position),
@@ -100,16 +101,10 @@ void Gradient::tick_draw(float seconds, Scene &scene)
     data->shader->Bind();
     data->m_vdecl->Bind();
 
-    void *tmp = data->m_vbo->Lock(0, 0);
-    memcpy(tmp, vertex, sizeof(vertex));
-    data->m_vbo->Unlock();
-
-    tmp = data->m_cbo->Lock(0, 0);
-    memcpy(tmp, color, sizeof(color));
-    data->m_cbo->Unlock();
+    auto vbo = TransientBuffer::UploadVertices(vertex, sizeof(vertex));
 
     /* Bind vertex and color buffers */
-    data->m_vdecl->SetStream(data->m_vbo, attr_pos);
+    data->m_vdecl->SetStream(vbo.buffer, vbo.offset, attr_pos);
     data->m_vdecl->SetStream(data->m_cbo, attr_col);
 
     /* Draw arrays */
@@ -12,19 +12,23 @@
 
 #include <lol/engine-internal.h>
 
+#include <algorithm>
 #include <cctype>
+#include <cstring>
 #include <string>
 
 #include "../../image/resource-private.h"
+#include "../../image/image-private.h"
 
 namespace lol
 {
 
-/* Image dimensions and recursion depth. DEPTH = 2 is a reasonable value,
- * DEPTH = 3 gives good quality, and higher values may improve the results
- * even more but at the cost of significantly longer computation times. */
+/* Image dimensions and maximum recursion depth. The actual depth is
+ * chosen from the requested quality: 1 is fast, 2 is a reasonable value,
+ * 3 gives good quality, and higher values may improve the results even
+ * more but at the cost of significantly longer computation times. */
 #define WIDTH 240
-#define DEPTH 2
+#define MAX_DEPTH 3
 
 /*
  * Image implementation class
@@ -35,11 +39,13 @@ class OricImageCodec : public ResourceCodec
 public:
     virtual std::string GetName() { return "<OricImageCodec>"; }
     virtual ResourceCodecData* Load(std::string const &path);
+    virtual ResourceCodecData* Load(std::string const &path,
+                                    span<uint8_t const> data);
     virtual bool Save(std::string const &path, ResourceCodecData* data);
 
 private:
-    static std::string ReadScreen(std::string const &name);
-    static void WriteScreen(image &image, array<uint8_t> &result);
+    static span<uint8_t const> ReadScreen(span<uint8_t const> data);
+    static void WriteScreen(image &image, int quality, array<uint8_t> &result);
 };
 
 DECLARE_IMAGE_CODEC(OricImageCodec, 100)
@@ -50,6 +56,16 @@ DECLARE_IMAGE_CODEC(OricImageCodec, 100)
 
 ResourceCodecData* OricImageCodec::Load(std::string const &path)
 {
+    File f;
+    f.Open(path, FileAccess::Read, true);
+    return Load(path, f.Map(FileHint::Sequential));
+}
+
+ResourceCodecData* OricImageCodec::Load(std::string const &path,
+                                        span<uint8_t const> file_data)
+{
+    UNUSED(path);
+
     static u8vec4 const pal[8] =
     {
         u8vec4(0x00, 0x00, 0x00, 0xff),
@@ -62,11 +78,11 @@ ResourceCodecData* OricImageCodec::Load(std::string const &path)
         u8vec4(0xff, 0xff, 0xff, 0xff),
     };
 
-    std::string screen = ReadScreen(path);
-    if (screen.length() == 0)
+    span<uint8_t const> screen = ReadScreen(file_data);
+    if (screen.empty())
         return nullptr;
 
-    auto data = new ResourceImageData(new image(ivec2(WIDTH, (int)screen.length() * 6 / WIDTH)));
+    auto data = new ResourceImageData(new image(ivec2(WIDTH, (int)screen.size() * 6 / WIDTH)));
     auto img = data->m_image;
 
     u8vec4 *pixels = img->lock<PixelFormat::RGBA_8>();
@@ -143,7 +159,7 @@ bool OricImageCodec::Save(std::string const &path, ResourceCodecData* data)
         img = &tmp;
     }
 
-    WriteScreen(*img, result);
+    WriteScreen(*img, data_image->m_quality, result);
 
     File f;
     f.Open(path, FileAccess::Write);
@@ -153,35 +169,34 @@ bool OricImageCodec::Save(std::string const &path, ResourceCodecData* data)
     return true;
 }
 
-std::string OricImageCodec::ReadScreen(std::string const &name)
+span<uint8_t const> OricImageCodec::ReadScreen(span<uint8_t const> data)
 {
-    File f;
-    f.Open(name, FileAccess::Read);
-    std::string data = f.ReadString();
-    f.Close();
+    static uint8_t const header_bytes[] =
+        { 0x00, 0xff, 0x80, 0x00, 0xbf, 0x3f, 0xa0 };
 
     /* Skip the sync bytes */
-    if (data[0] != 0x16)
-        return "";
-    int header = 1;
-    while (data[header] == 0x16)
+    if (data.empty() || data[0] != 0x16)
+        return span<uint8_t const>();
+    size_t header = 1;
+    while (header < data.size() && data[header] == 0x16)
         ++header;
-    if (data[header] != 0x24)
-        return "";
+    if (header == data.size() || data[header] != 0x24)
+        return span<uint8_t const>();
     ++header;
 
     /* Skip the header, ignoring the last byte’s value */
-    if (!starts_with(data, std::string("\x00\xff\x80\x00\xbf\x3f\xa0\x00", 8)))
-        return "";
+    if (data.size() < header + 8
+         || memcmp(&data[header], header_bytes, sizeof(header_bytes)))
+        return span<uint8_t const>();
 
     /* Skip the file name, including trailing nul char */
-    data = data.substr(header + 8);
-    size_t filename_end = data.find('\0');
-    if (filename_end == std::string::npos)
-        return "";
+    data = data.subspan(header + 8);
+    uint8_t const *filename_end = std::find(data.begin(), data.end(), 0);
+    if (filename_end == data.end())
+        return span<uint8_t const>();
 
     /* Read screen data */
-    return data.substr(filename_end + 1);
+    return data.subspan(filename_end - data.begin() + 1);
 }
 
 /* Error diffusion table, similar to Floyd-Steinberg. I choose not to
@@ -295,30 +310,78 @@ static inline int geterror(ivec3 const *in, ivec3 indelta,
     return ret;
 }
 
-static uint8_t bestmove(ivec3 const *in, u8vec2 bgfg,
+/* Search state for one scanline. Sub-trees that start with no diffused
+ * error only depend on their cell, the current colours and the depth, so
+ * their best error is cached. A cell’s entries become stale when the error
+ * of the previous cell is propagated into its first pixel. */
+class oric_line
+{
+public:
+    oric_line(ivec3 const *pixels, int cells, int depth)
+      : m_pixels(pixels),
+        m_cells(cells),
+        m_depth(depth)
+    {
+        m_cache.resize(cells * 64 * max(depth, 1));
+        for (auto &entry : m_cache)
+            entry = -1;
+    }
+
+    inline ivec3 const *pixels(int cell) const { return m_pixels + cell * 6; }
+
+    inline int &cached_error(int cell, u8vec2 bgfg, int depth)
+    {
+        return m_cache[(cell * 64 + bgfg[0] * 8 + bgfg[1]) * m_depth + depth];
+    }
+
+    void invalidate(int cell)
+    {
+        if (cell < m_cells)
+            for (int n = 0; n < 64 * m_depth; ++n)
+                m_cache[cell * 64 * m_depth + n] = -1;
+    }
+
+private:
+    ivec3 const *m_pixels;
+    int m_cells, m_depth;
+    array<int> m_cache;
+};
+
+static uint8_t bestmove(oric_line &line, int cell, u8vec2 bgfg,
+                        ivec3 delta, int depth, int maxerror,
+                        int *error, ivec3 *out);
+
+/* Best error for printing pixels at the given cell with no diffused
+ * error and no colour change; computed once per line. */
+static int static_error(oric_line &line, int cell, u8vec2 bgfg, int depth)
+{
+    int &ret = line.cached_error(cell, bgfg, depth);
+    if (ret < 0)
+        bestmove(line, cell, bgfg, ivec3(0), depth,
+                 0x7ffffff, &ret, nullptr);
+    return ret;
+}
+
+/* Find the best command for the given cell. Moves whose error exceeds
+ * maxerror are not explored, so if the returned error is not below
+ * maxerror, the caller may only assume that the best error is at least
+ * maxerror. This lets us prune sub-trees that cannot beat the best move so far. */
+static uint8_t bestmove(oric_line &line, int cell, u8vec2 bgfg,
                         ivec3 delta, int depth, int maxerror,
                         int *error, ivec3 *out)
 {
+    ivec3 const *in = line.pixels(cell);
     ivec3 tmprgb[6], bestrgb[6];
-    ivec3 nop_rgb_delta, inop_rgb_delta;
-    ivec3 const *rgb, *nop_rgb, *inop_rgb;
-    int suberror, statice, nop_error, inop_error;
-
-    /* Precompute error for the case where we change the foreground colour
-     * and hence only print the background colour or its negative */
-    nop_rgb = palette[bgfg[0]];
-    nop_error = geterror(in, delta, nop_rgb, &nop_rgb_delta);
-    inop_rgb = palette[7 - bgfg[0]];
-    inop_error = geterror(in, delta, inop_rgb, &inop_rgb_delta);
-
-    /* Precompute sub-error for the case where we print pixels (and hence
-     * don’t change the palette). It’s not the exact error because we should
-     * be propagating the error to the first pixel here. */
-    if (depth > 0)
-    {
-        bestmove(in + 6, bgfg, ivec3(0), depth - 1,
-                 maxerror, &statice, nullptr);
-    }
+    ivec3 const *rgb;
+    int suberror;
+
+    /* Precompute the error for all plain colour blocks: every command
+     * that changes a colour prints the background colour or its negative,
+     * so there are only 8 possible outcomes. */
+    int plain_error[8];
+    ivec3 plain_delta[8];
+    for (int c = 0; c < 8; ++c)
+        plain_error[c] = geterror(in, delta, palette[c], &plain_delta[c]);
 
     /* Check every likely command:
      * 0-7: change foreground to 0-7
@@ -338,7 +401,7 @@ static uint8_t bestmove(ivec3 const *in, u8vec2 bgfg,
 
     int besterror = 0x7ffffff;
     uint8_t bestcommand = 0x10;
-    memcpy((void *)bestrgb, nop_rgb, sizeof(bestrgb));
+    memcpy((void *)bestrgb, palette[bgfg[0]], sizeof(bestrgb));
 
     for (uint8_t command : command_list)
     {
@@ -366,27 +429,17 @@ static uint8_t bestmove(ivec3 const *in, u8vec2 bgfg,
             continue;
 #endif
 
-        if ((command & 0xf8) == 0x00)
-        {
-            curerror = nop_error;
-            rgb = nop_rgb;
-            nexterr = nop_rgb_delta;
-        }
-        else if ((command & 0xf8) == 0x80)
-        {
-            curerror = inop_error;
-            rgb = inop_rgb;
-            nexterr = inop_rgb_delta;
-        }
-        else if ((command & 0xf8) == 0x10)
+        if ((command & 0xf8) == 0x00 || (command & 0xf8) == 0x10)
         {
+            curerror = plain_error[newbgfg[0]];
             rgb = palette[newbgfg[0]];
-            curerror = geterror(in, delta, rgb, &nexterr);
+            nexterr = plain_delta[newbgfg[0]];
         }
-        else if ((command & 0xf8) == 0x90)
+        else if ((command & 0xf8) == 0x80 || (command & 0xf8) == 0x90)
         {
+            curerror = plain_error[7 - newbgfg[0]];
             rgb = palette[7 - newbgfg[0]];
-            curerror = geterror(in, delta, rgb, &nexterr);
+            nexterr = plain_delta[7 - newbgfg[0]];
         }
         else
         {
@@ -437,12 +490,18 @@ static uint8_t bestmove(ivec3 const *in, u8vec2 bgfg,
          * the current error. */
         curerror = curerror * 3 / 4;
 
+        /* This move is dominated by the best one so far, or cannot fit
+         * in the error budget given by our caller. */
+        int const bound = min(besterror, maxerror);
+        if (curerror >= bound)
+            continue;
+
         if (depth == 0)
             suberror = 0; /* It’s the end of the tree */
         else if ((command & 0x68) == 0x00)
         {
-            bestmove(in + 6, newbgfg, nexterr, depth - 1,
-                     besterror - curerror, &suberror, nullptr);
+            bestmove(line, cell + 1, newbgfg, nexterr, depth - 1,
+                     bound - curerror, &suberror, nullptr);
 
 #if 0
             /* Slight penalty for colour changes; they're hard to revert. The
@@ -455,7 +514,11 @@ static uint8_t bestmove(ivec3 const *in, u8vec2 bgfg,
 #endif
         }
         else
-            suberror = statice;
+        {
+            /* Not the exact error because we should be propagating the
+             * error to the first pixel here, but it can be cached. */
+            suberror = static_error(line, cell + 1, bgfg, depth - 1);
+        }
 
         if (curerror + suberror < besterror)
         {
@@ -472,12 +535,14 @@ static uint8_t bestmove(ivec3 const *in, u8vec2 bgfg,
     return bestcommand;
 }
 
-void OricImageCodec::WriteScreen(image &img, array<uint8_t> &result)
+void OricImageCodec::WriteScreen(image &img, int quality, array<uint8_t> &result)
 {
     ivec2 size = img.size();
     vec4 *pixels = img.lock<PixelFormat::RGBA_F32>();
 
-    int stride = (size.x + 1);
+    int const depth = quality < 25 ? 1 : quality < 75 ? 2 : MAX_DEPTH;
+    int const stride = (size.x + 1);
+    int const cells = size.x / 6;
 
     array2d<ivec3> src, dst;
     src.resize(size + ivec2(1));
@@ -490,48 +555,79 @@ void OricImageCodec::WriteScreen(image &img, array<uint8_t> &result)
     for (int y = 0; y < size.y; y++)
         for (int x = 0; x < size.x; x++)
             for (int c = 0; c < 3; c++)
-                src[x][y][c] = 0xffff * (int32_t)pixels[y * size.x + x][2 - c];
+                src[x][y][c] = (int32_t)(0xffff * pixels[y * size.x + x][2 - c]);
 
-    /* Let the fun begin */
-    for (int y = 0; y < size.y; y++)
-    {
-        u8vec2 bgfg(0, 7);
+    img.unlock(pixels);
 
-        //fprintf(stderr, "\rProcessing... %i%%", (y * 100 + 99) / size.y);
+    /* Let the fun begin. Each line diffuses its error to the next one,
+     * but only locally: a line may work on a given cell once the line
+     * above is done with all the cells that the search will look at,
+     * plus one. Lines are thus processed concurrently as a wavefront,
+     * and the result is the same as with a sequential scan. */
+    array2d<uint8_t> commands(ivec2(cells, size.y));
+    std::unique_ptr<std::atomic<int>[]> progress(new std::atomic<int>[size.y]);
+    for (int y = 0; y < size.y; y++)
+        progress[y] = 0;
+    std::atomic<int> next_line(0);
 
-        for (int x = 0; x < size.x; x += 6)
+    image_parallel_run(size.y, [&]()
+    {
+        for (int y = next_line++; y < size.y; y = next_line++)
         {
-            int depth = (x + DEPTH < size.x) ? DEPTH : (size.x - x) / 6 - 1;
-            ivec3 *srcl = &src[x][y];
-            ivec3 *dstl = &dst[x][y];
-
-            /* Recursively compute and apply best command */
-            int dummy;
-            uint8_t command = bestmove(srcl, bgfg, ivec3(0), depth,
-                                       0x7fffff, &dummy, dstl);
-            /* Propagate error */
-            for (int i = 0; i < 6; i++)
+            oric_line line(&src[0][y], cells, depth);
+            u8vec2 bgfg(0, 7);
+            int avail = y ? 0 : cells;
+
+            for (int cell = 0; cell < cells; cell++)
             {
-                ivec3 delta = srcl[i] - dstl[i];
-                srcl[i + 1] = myclamp(srcl[i + 1] + delta * FS0 / FSX);
-                srcl[i + stride - 1] += delta * FS1 / FSX;
-                srcl[i + stride] += delta * FS2 / FSX;
-                srcl[i + stride + 1] += delta * FS3 / FSX;
-            }
+                int const needed = min(cell + depth + 2, cells);
+                while (avail < needed)
+                {
+                    avail = progress[y - 1].load(std::memory_order_acquire);
+#if LOL_FEATURE_THREADS
+                    if (avail < needed)
+                        std::this_thread::yield();
+#endif
+                }
 
-            for (int i = -1; i < 7; i++)
-                srcl[i + stride] = myclamp(srcl[i + stride]);
+                int const x = cell * 6;
+                ivec3 *srcl = &src[x][y];
+                ivec3 *dstl = &dst[x][y];
 
-            /* Iterate */
-            bgfg = domove(command, bgfg);
-            /* Write byte to file */
-            result << command;
-        }
-    }
+                /* Recursively compute and apply best command */
+                int dummy;
+                uint8_t command = bestmove(line, cell, bgfg, ivec3(0),
+                                           min(depth, cells - 1 - cell),
+                                           0x7ffffff, &dummy, dstl);
+                /* Propagate error */
+                for (int i = 0; i < 6; i++)
+                {
+                    ivec3 delta = srcl[i] - dstl[i];
+                    srcl[i + 1] = myclamp(srcl[i + 1] + delta * FS0 / FSX);
+                    srcl[i + stride - 1] += delta * FS1 / FSX;
+                    srcl[i + stride] += delta * FS2 / FSX;
+                    srcl[i + stride + 1] += delta * FS3 / FSX;
+                }
 
-    img.unlock(pixels);
+                for (int i = -1; i < 7; i++)
+                    srcl[i + stride] = myclamp(srcl[i + stride]);
+
+                /* The next cell’s first pixel was just modified */
+                line.invalidate(cell + 1);
 
-    //fprintf(stderr, " done.\n");
+                /* Iterate */
+                bgfg = domove(command, bgfg);
+                commands[cell][y] = command;
+
+                progress[y].store(cell + 1, std::memory_order_release);
+            }
+        }
+    });
+
+    /* Write bytes to file */
+    for (int y = 0; y < size.y; y++)
+        for (int cell = 0; cell < cells; cell++)
+            result << commands[cell][y];
 }
 
 } /* namespace lol */
@@ -38,6 +38,8 @@ class SdlImageCodec : public ResourceCodec
 public:
     virtual std::string GetName() { return "<SdlImageCodec>"; }
     virtual ResourceCodecData* Load(std::string const &path);
+    virtual ResourceCodecData* Load(std::string const &path,
+                                    span<uint8_t const> data);
     virtual bool Save(std::string const &path, ResourceCodecData* data);
 
     static SDL_Surface *Create32BppSurface(ivec2 size);
@@ -46,14 +48,25 @@ public:
 DECLARE_IMAGE_CODEC(SdlImageCodec, 50)
 
 ResourceCodecData* SdlImageCodec::Load(std::string const &path)
+{
+    return Load(path, span<uint8_t const>());
+}
+
+ResourceCodecData* SdlImageCodec::Load(std::string const &path,
+                                       span<uint8_t const> data)
 {
     SDL_Surface *surface = nullptr;
 
+    /* Decode from memory if the file was already found, which is the
+     * only way to load images from mounted packs */
+    if (!data.empty())
+        surface = IMG_Load_RW(SDL_RWFromConstMem(data.data(), (int)data.size()), 1);
+
     for (auto const &candidate : sys::get_path_list(path))
     {
-        surface = IMG_Load(candidate.c_str());
         if (surface)
             break;
+        surface = IMG_Load(candidate.c_str());
     }
 
     if (!surface)
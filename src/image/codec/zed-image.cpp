@@ -29,6 +29,8 @@ class ZedImageCodec : public ResourceCodec
 public:
     virtual std::string GetName() { return "<ZedImageCodec>"; }
     virtual ResourceCodecData* Load(std::string const &path);
+    virtual ResourceCodecData* Load(std::string const &path,
+                                    span<uint8_t const> file_buffer);
     virtual bool Save(std::string const &path, ResourceCodecData* data);
 };
 
@@ -43,6 +45,29 @@ ResourceCodecData* ZedImageCodec::Load(std::string const &path)
     if (!ends_with(path, ".RSC"))
         return nullptr;
 
+    File file;
+    file.Open(path, FileAccess::Read, true);
+    return Load(path, file.Map(FileHint::Random));
+}
+
+ResourceCodecData* ZedImageCodec::Load(std::string const &path,
+                                       span<uint8_t const> file_buffer)
+{
+    if (!ends_with(path, ".RSC"))
+        return nullptr;
+
+    /* The caller could not map the file, so read it instead; an empty
+     * file still gives an empty tileset */
+    std::string contents;
+    if (file_buffer.empty())
+    {
+        File file;
+        file.Open(path, FileAccess::Read, true);
+        contents = file.ReadString();
+        file_buffer = span<uint8_t const>((uint8_t const *)contents.data(),
+                                          contents.length());
+    }
+
     // Compacter definition
     struct CompactSecondary
     {
@@ -108,31 +133,24 @@ ResourceCodecData* ZedImageCodec::Load(std::string const &path)
         array<CompactMain>      m_primary;
     };
 
-    File file;
-    file.Open(path, FileAccess::Read, true);
-
-    //Put file in memory
-    long file_size = file.size();
-    array<uint8_t> file_buffer;
-    file_buffer.resize(file_size);
-    file.Read((uint8_t*)&file_buffer[0], file_size);
-    file.Close();
-
     //Get FileCount
     uint32_t file_pos = 0;
     uint16_t file_count = 0;
-    file_count = *((uint16_t*)(&file_buffer[file_pos]));
-    file_pos += sizeof(uint16_t);
+    if (file_buffer.size() >= sizeof(uint16_t))
+    {
+        file_count = *((uint16_t const *)(&file_buffer[file_pos]));
+        file_pos += sizeof(uint16_t);
+    }
 
     array<uint32_t> file_offset;
     file_offset.resize(file_count);
     //Get all the file offsets
     for (int i = 0; i < file_count; i++)
     {
-        file_offset[i] = *((uint32_t*)(&file_buffer[file_pos]));
+        file_offset[i] = *((uint32_t const *)(&file_buffer[file_pos]));
         file_pos += sizeof(uint32_t);
     }
-    file_offset << file_size;
+    file_offset << (uint32_t)file_buffer.size();
 
     //<Pos, Size>
     array<ivec2, ivec2> tiles;
@@ -143,7 +161,7 @@ ResourceCodecData* ZedImageCodec::Load(std::string const &path)
 
     uint32_t total_size = 0;
     array<uint8_t> file_convert;
-    file_convert.reserve(file_size);
+    file_convert.reserve((int)file_buffer.size());
     array<ivec2> available_sizes;
     //got through all the files and store them
     for (int i = 0; i < file_count; i++)
@@ -171,7 +189,7 @@ ResourceCodecData* ZedImageCodec::Load(std::string const &path)
         header_data.resize(header_length);
         memcpy(&header_data[0], &file_buffer[file_offset[i]], header_length);
         array<uint8_t> footer_data;
-        uint32_t footer_length = lol::min((uint32_t)file_buffer.count(), data_pos + data_length + header_length) - (data_pos + data_length);
+        uint32_t footer_length = lol::min((uint32_t)file_buffer.size(), data_pos + data_length + header_length) - (data_pos + data_length);
         if (footer_length > 0)
         {
             footer_data.resize(footer_length);
@@ -29,6 +29,8 @@ class ZedPaletteImageCodec : public ResourceCodec
 public:
     virtual std::string GetName() { return "<ZedPaletteImageCodec>"; }
     virtual ResourceCodecData* Load(std::string const &path);
+    virtual ResourceCodecData* Load(std::string const &path,
+                                    span<uint8_t const> file_buffer);
     virtual bool Save(std::string const &path, ResourceCodecData* data);
 };
 
@@ -45,23 +47,36 @@ ResourceCodecData* ZedPaletteImageCodec::Load(std::string const &path)
 
     File file;
     file.Open(path, FileAccess::Read, true);
+    return Load(path, file.Map(FileHint::Sequential));
+}
 
-    // Put file in memory
-    long file_size = file.size();
-    array<uint8_t> file_buffer;
-    file_buffer.resize(file_size);
-    file.Read((uint8_t*)&file_buffer[0], file_size);
-    file.Close();
+ResourceCodecData* ZedPaletteImageCodec::Load(std::string const &path,
+                                              span<uint8_t const> file_buffer)
+{
+    if (!ends_with(path, ".pal"))
+        return nullptr;
+
+    /* The caller could not map the file, so read it instead; an empty
+     * file still gives an empty palette */
+    std::string contents;
+    if (file_buffer.empty())
+    {
+        File file;
+        file.Open(path, FileAccess::Read, true);
+        contents = file.ReadString();
+        file_buffer = span<uint8_t const>((uint8_t const *)contents.data(),
+                                          contents.length());
+    }
 
 #if 0 //2D PALETTE
-    int32_t tex_sqrt = (int32_t)lol::sqrt((float)file_size / 3);
+    int32_t tex_sqrt = (int32_t)lol::sqrt((float)file_buffer.size() / 3);
     int32_t tex_size = 2;
     while (tex_size < tex_sqrt)
         tex_size <<= 1;
     auto data = new ResourceImageData(new image(ivec2(tex_size)));
     auto image = data->m_image;
 #else
-    int32_t tex_sqrt = file_size / 3;
+    int32_t tex_sqrt = (int32_t)file_buffer.size() / 3;
     int32_t tex_size = 2;
     while (tex_size < tex_sqrt)
         tex_size <<= 1;
@@ -70,7 +85,7 @@ ResourceCodecData* ZedPaletteImageCodec::Load(std::string const &path)
 #endif
 
     u8vec4 *pixels = image->lock<PixelFormat::RGBA_8>();
-    for (int i = 0; i < file_buffer.count();)
+    for (size_t i = 0; i < file_buffer.size();)
     {
         pixels->r = file_buffer[i++];
         pixels->g = file_buffer[i++];
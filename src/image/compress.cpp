@@ -0,0 +1,799 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <climits>
+#include <utility>
+
+/*
+ * Block compression: BC1, BC3 and ETC2 encoders and decoders
+ */
+
+namespace lol
+{
+
+static inline int sq(int x) { return x * x; }
+
+static inline int rgb_error(u8vec4 a, u8vec4 b)
+{
+    return sq(a.r - b.r) + sq(a.g - b.g) + sq(a.b - b.b);
+}
+
+static inline uint8_t clamp8(int x)
+{
+    return (uint8_t)lol::clamp(x, 0, 255);
+}
+
+/* Expand an n-bit value to 8 bits by repeating its high bits */
+static inline int expand(int x, int bits)
+{
+    return (x << (8 - bits)) | (x >> (2 * bits - 8));
+}
+
+static inline int quantize(float x, int bits)
+{
+    return lol::clamp((int)(x * ((1 << bits) - 1) / 255.f + .5f), 0, (1 << bits) - 1);
+}
+
+/*
+ * BC1 and BC3
+ */
+
+static inline uint16_t pack565(ivec3 c)
+{
+    return (uint16_t)((c.r << 11) | (c.g << 5) | c.b);
+}
+
+static inline u8vec4 unpack565(uint16_t c)
+{
+    return u8vec4(expand(c >> 11, 5), expand((c >> 5) & 0x3f, 6),
+                  expand(c & 0x1f, 5), 255);
+}
+
+static void bc1_palette(uint16_t c0, uint16_t c1, bool four, u8vec4 pal[4])
+{
+    pal[0] = unpack565(c0);
+    pal[1] = unpack565(c1);
+    if (four || c0 > c1)
+    {
+        pal[2] = u8vec4((u8vec3)(((ivec3)pal[0].rgb * 2 + (ivec3)pal[1].rgb) / 3), 255);
+        pal[3] = u8vec4((u8vec3)(((ivec3)pal[0].rgb + (ivec3)pal[1].rgb * 2) / 3), 255);
+    }
+    else
+    {
+        pal[2] = u8vec4((u8vec3)(((ivec3)pal[0].rgb + (ivec3)pal[1].rgb) / 2), 255);
+        pal[3] = u8vec4(0);
+    }
+}
+
+/* Pick the nearest palette entry for each pixel and return the error */
+static int bc1_indices(u8vec4 const *block, uint16_t c0, uint16_t c1,
+                       uint32_t &indices)
+{
+    u8vec4 pal[4];
+    bc1_palette(c0, c1, true, pal);
+
+    int error = 0;
+    indices = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        int best = 0, best_error = INT_MAX;
+        for (int k = 0; k < 4; ++k)
+        {
+            int e = rgb_error(block[i], pal[k]);
+            if (e < best_error)
+                best = k, best_error = e;
+        }
+        indices |= (uint32_t)best << (2 * i);
+        error += best_error;
+    }
+    return error;
+}
+
+static void encode_bc1(u8vec4 const *block, uint8_t *out)
+{
+    /* Principal axis of the colours, by power iteration */
+    vec3 mean(0.f);
+    for (int i = 0; i < 16; ++i)
+        mean += (vec3)block[i].rgb;
+    mean /= 16.f;
+
+    mat3 cov(0.f);
+    for (int i = 0; i < 16; ++i)
+    {
+        vec3 d = (vec3)block[i].rgb - mean;
+        cov += outer(d, d);
+    }
+
+    vec3 axis(1.f);
+    for (int n = 0; n < 8; ++n)
+    {
+        axis = cov * axis;
+        float len = lol::max(lol::abs(axis.x), lol::max(lol::abs(axis.y), lol::abs(axis.z)));
+        if (len < 1e-6f)
+        {
+            axis = vec3(1.f);
+            break;
+        }
+        axis /= len;
+    }
+
+    float tmin = 0.f, tmax = 0.f;
+    for (int i = 0; i < 16; ++i)
+    {
+        float t = dot((vec3)block[i].rgb - mean, axis);
+        tmin = lol::min(tmin, t);
+        tmax = lol::max(tmax, t);
+    }
+
+    float const norm = lol::max(dot(axis, axis), 1e-6f);
+    vec3 ends[2] = { mean + axis * (tmax / norm), mean + axis * (tmin / norm) };
+
+    uint16_t best_c0 = 0, best_c1 = 0;
+    uint32_t best_indices = 0;
+    int best_error = INT_MAX;
+
+    /* Fit the endpoints, then refine them by least squares over the
+     * chosen indices */
+    for (int pass = 0; pass < 3; ++pass)
+    {
+        ivec3 q0(quantize(ends[0].r, 5), quantize(ends[0].g, 6), quantize(ends[0].b, 5));
+        ivec3 q1(quantize(ends[1].r, 5), quantize(ends[1].g, 6), quantize(ends[1].b, 5));
+        uint16_t c0 = pack565(q0), c1 = pack565(q1);
+        if (c0 < c1)
+            std::swap(c0, c1);
+
+        uint32_t indices;
+        int error = bc1_indices(block, c0, c1, indices);
+        if (error < best_error)
+        {
+            best_c0 = c0, best_c1 = c1;
+            best_indices = indices;
+            best_error = error;
+        }
+        if (!error || c0 == c1)
+            break;
+
+        static float const weights[4] = { 1.f, 0.f, 2.f / 3.f, 1.f / 3.f };
+        float aa = 0.f, ab = 0.f, bb = 0.f;
+        vec3 ax(0.f), bx(0.f);
+        for (int i = 0; i < 16; ++i)
+        {
+            float a = weights[(indices >> (2 * i)) & 3], b = 1.f - a;
+            aa += a * a; ab += a * b; bb += b * b;
+            ax += a * (vec3)block[i].rgb;
+            bx += b * (vec3)block[i].rgb;
+        }
+
+        float det = aa * bb - ab * ab;
+        if (lol::abs(det) < 1e-6f)
+            break;
+        ends[0] = (ax * bb - bx * ab) / det;
+        ends[1] = (bx * aa - ax * ab) / det;
+        ends[0] = lol::clamp(ends[0], 0.f, 255.f);
+        ends[1] = lol::clamp(ends[1], 0.f, 255.f);
+    }
+
+    if (best_c0 == best_c1)
+        best_indices = 0;
+
+    out[0] = (uint8_t)best_c0; out[1] = (uint8_t)(best_c0 >> 8);
+    out[2] = (uint8_t)best_c1; out[3] = (uint8_t)(best_c1 >> 8);
+    for (int i = 0; i < 4; ++i)
+        out[4 + i] = (uint8_t)(best_indices >> (8 * i));
+}
+
+static void decode_bc1(uint8_t const *in, bool four, u8vec4 *block)
+{
+    uint16_t c0 = in[0] | (in[1] << 8), c1 = in[2] | (in[3] << 8);
+    uint32_t indices = in[4] | (in[5] << 8) | (in[6] << 16) | ((uint32_t)in[7] << 24);
+
+    u8vec4 pal[4];
+    bc1_palette(c0, c1, four, pal);
+    for (int i = 0; i < 16; ++i)
+        block[i] = pal[(indices >> (2 * i)) & 3];
+}
+
+static void bc3_alpha_palette(int a0, int a1, int pal[8])
+{
+    pal[0] = a0;
+    pal[1] = a1;
+    if (a0 > a1)
+    {
+        for (int k = 2; k < 8; ++k)
+            pal[k] = ((8 - k) * a0 + (k - 1) * a1) / 7;
+    }
+    else
+    {
+        for (int k = 2; k < 6; ++k)
+            pal[k] = ((6 - k) * a0 + (k - 1) * a1) / 5;
+        pal[6] = 0;
+        pal[7] = 255;
+    }
+}
+
+static int bc3_alpha_indices(u8vec4 const *block, int a0, int a1, uint64_t &indices)
+{
+    int pal[8];
+    bc3_alpha_palette(a0, a1, pal);
+
+    int error = 0;
+    indices = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        int best = 0, best_error = INT_MAX;
+        for (int k = 0; k < 8; ++k)
+        {
+            int e = sq(block[i].a - pal[k]);
+            if (e < best_error)
+                best = k, best_error = e;
+        }
+        indices |= (uint64_t)best << (3 * i);
+        error += best_error;
+    }
+    return error;
+}
+
+static void encode_bc3(u8vec4 const *block, uint8_t *out)
+{
+    /* Try the 8 value mode over the full range, and the 6 value mode
+     * over the range of the values other than 0 and 255 */
+    int amin = 255, amax = 0, imin = 255, imax = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        amin = lol::min(amin, (int)block[i].a);
+        amax = lol::max(amax, (int)block[i].a);
+        if (block[i].a != 0 && block[i].a != 255)
+        {
+            imin = lol::min(imin, (int)block[i].a);
+            imax = lol::max(imax, (int)block[i].a);
+        }
+    }
+
+    int a0 = amax, a1 = amin;
+    uint64_t indices;
+    int error = bc3_alpha_indices(block, a0, a1, indices);
+
+    if (error && imin <= imax)
+    {
+        uint64_t indices6;
+        if (bc3_alpha_indices(block, imin, imax, indices6) < error)
+            a0 = imin, a1 = imax, indices = indices6;
+    }
+
+    out[0] = (uint8_t)a0;
+    out[1] = (uint8_t)a1;
+    for (int i = 0; i < 6; ++i)
+        out[2 + i] = (uint8_t)(indices >> (8 * i));
+
+    encode_bc1(block, out + 8);
+}
+
+static void decode_bc3(uint8_t const *in, u8vec4 *block)
+{
+    decode_bc1(in + 8, true, block);
+
+    int pal[8];
+    bc3_alpha_palette(in[0], in[1], pal);
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; ++i)
+        indices |= (uint64_t)in[2 + i] << (8 * i);
+    for (int i = 0; i < 16; ++i)
+        block[i].a = (uint8_t)pal[(indices >> (3 * i)) & 7];
+}
+
+/*
+ * ETC2 and EAC. Blocks are stored big endian and pixels are indexed in
+ * column order. The encoder uses the individual, differential and planar
+ * modes; the decoder also handles the T and H modes.
+ */
+
+static int const etc_modifiers[8][2] =
+{
+    { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 },
+    { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 },
+};
+
+static int const etc_distances[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+static int const eac_modifiers[16][8] =
+{
+    { -3, -6, -9, -15, 2, 5, 8, 14 }, { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5, -8, -13, 1, 4, 7, 12 }, { -2, -4, -6, -13, 1, 3, 5, 12 },
+    { -3, -6, -8, -12, 2, 5, 7, 11 }, { -3, -7, -9, -11, 2, 6, 8, 10 },
+    { -4, -7, -8, -11, 3, 6, 7, 10 }, { -3, -5, -8, -11, 2, 4, 7, 10 },
+    { -2, -6, -8, -10, 1, 5, 7, 9 }, { -2, -5, -8, -10, 1, 4, 7, 9 },
+    { -2, -4, -8, -10, 1, 3, 7, 9 }, { -2, -5, -7, -10, 1, 4, 6, 9 },
+    { -3, -4, -7, -10, 2, 3, 6, 9 }, { -1, -2, -3, -10, 0, 1, 2, 9 },
+    { -4, -6, -8, -9, 3, 5, 7, 8 }, { -3, -5, -7, -9, 2, 4, 6, 8 },
+};
+
+static inline int etc_modifier(int table, int index)
+{
+    int m = etc_modifiers[table][index & 1];
+    return index & 2 ? -m : m;
+}
+
+static inline uint64_t load_be64(uint8_t const *in)
+{
+    uint64_t ret = 0;
+    for (int i = 0; i < 8; ++i)
+        ret = (ret << 8) | in[i];
+    return ret;
+}
+
+static inline void store_be64(uint64_t x, uint8_t *out)
+{
+    for (int i = 0; i < 8; ++i)
+        out[i] = (uint8_t)(x >> (56 - 8 * i));
+}
+
+static inline int bits(uint64_t x, int hi, int lo)
+{
+    return (int)((x >> lo) & ((1u << (hi - lo + 1)) - 1));
+}
+
+/* Block pixel (x, y) for ETC pixel number j */
+static inline int etc_pixel(int j) { return (j & 3) * 4 + (j >> 2); }
+
+/* Whether ETC pixel j belongs to the second sub-block */
+static inline bool etc_second(int j, bool flip)
+{
+    return flip ? (j & 3) >= 2 : j >= 8;
+}
+
+/* Best table and indices for a sub-block with the given base colour */
+static int etc_fit(u8vec4 const *block, bool flip, int second, ivec3 base,
+                   int &table, uint32_t &indices)
+{
+    int best_error = INT_MAX;
+    for (int t = 0; t < 8; ++t)
+    {
+        u8vec4 pal[4];
+        for (int k = 0; k < 4; ++k)
+        {
+            int m = etc_modifier(t, k);
+            pal[k] = u8vec4(clamp8(base.r + m), clamp8(base.g + m), clamp8(base.b + m), 255);
+        }
+
+        int error = 0;
+        uint32_t idx = 0;
+        for (int j = 0; j < 16 && error < best_error; ++j)
+        {
+            if (etc_second(j, flip) != !!second)
+                continue;
+
+            u8vec4 p = block[etc_pixel(j)];
+            int best = 0, best_e = INT_MAX;
+            for (int k = 0; k < 4; ++k)
+            {
+                int e = rgb_error(p, pal[k]);
+                if (e < best_e)
+                    best = k, best_e = e;
+            }
+            idx |= ((uint32_t)(best >> 1) << (16 + j)) | ((uint32_t)(best & 1) << j);
+            error += best_e;
+        }
+
+        if (error < best_error)
+        {
+            best_error = error;
+            table = t;
+            indices = idx;
+        }
+    }
+    return best_error;
+}
+
+static int etc_encode_planar(u8vec4 const *block, uint64_t &out)
+{
+    /* Least squares fit of O, H and V, where the colour at (x, y) is
+     * O + x (H − O) / 4 + y (V − O) / 4 */
+    static mat3 const inverse = []()
+    {
+        mat3 m(0.f);
+        for (int y = 0; y < 4; ++y)
+            for (int x = 0; x < 4; ++x)
+            {
+                vec3 w(1.f - x / 4.f - y / 4.f, x / 4.f, y / 4.f);
+                m += outer(w, w);
+            }
+        return lol::inverse(m);
+    }();
+
+    vec3 rhs[3] = { vec3(0.f), vec3(0.f), vec3(0.f) };
+    for (int y = 0; y < 4; ++y)
+        for (int x = 0; x < 4; ++x)
+        {
+            vec3 w(1.f - x / 4.f - y / 4.f, x / 4.f, y / 4.f);
+            vec3 c = (vec3)block[y * 4 + x].rgb;
+            for (int ch = 0; ch < 3; ++ch)
+                rhs[ch] += w * c[ch];
+        }
+
+    static int const depth[3] = { 6, 7, 6 };
+    ivec3 q[3]; /* O, H, V for each channel */
+    for (int ch = 0; ch < 3; ++ch)
+    {
+        vec3 ohv = inverse * rhs[ch];
+        for (int k = 0; k < 3; ++k)
+            q[ch][k] = quantize(ohv[k], depth[ch]);
+    }
+
+    int error = 0;
+    for (int y = 0; y < 4; ++y)
+        for (int x = 0; x < 4; ++x)
+        {
+            u8vec4 c(0, 0, 0, 255);
+            for (int ch = 0; ch < 3; ++ch)
+            {
+                int o = expand(q[ch][0], depth[ch]);
+                int h = expand(q[ch][1], depth[ch]);
+                int v = expand(q[ch][2], depth[ch]);
+                c[ch] = clamp8((x * (h - o) + y * (v - o) + 4 * o + 2) >> 2);
+            }
+            error += rgb_error(block[y * 4 + x], c);
+        }
+
+    int ro = q[0][0], go = q[1][0], bo = q[2][0];
+    uint64_t x = (uint64_t)ro << 57
+               | (uint64_t)(go >> 6) << 56 | (uint64_t)(go & 0x3f) << 49
+               | (uint64_t)(bo >> 5) << 48 | (uint64_t)((bo >> 3) & 3) << 43
+               | (uint64_t)(bo & 7) << 39
+               | (uint64_t)(q[0][1] >> 1) << 34 | (uint64_t)1 << 33
+               | (uint64_t)(q[0][1] & 1) << 32
+               | (uint64_t)q[1][1] << 25 | (uint64_t)q[2][1] << 19
+               | (uint64_t)q[0][2] << 13 | (uint64_t)q[1][2] << 6
+               | (uint64_t)q[2][2];
+
+    /* Use the free bits so that the red and green differential sums do
+     * not overflow and the blue one does */
+    int r = bits(x, 63, 59), dr = (bits(x, 58, 56) ^ 4) - 4;
+    if (r + dr < 0 || r + dr > 31)
+        x |= (uint64_t)1 << 63;
+    int g = bits(x, 55, 51), dg = (bits(x, 50, 48) ^ 4) - 4;
+    if (g + dg < 0 || g + dg > 31)
+        x |= (uint64_t)1 << 55;
+    if (bits(x, 44, 43) + bits(x, 41, 40) >= 4)
+        x |= (uint64_t)7 << 45;
+    else
+        x |= (uint64_t)1 << 42;
+
+    out = x;
+    return error;
+}
+
+static void encode_etc2_rgb(u8vec4 const *block, uint8_t *out)
+{
+    uint64_t best = 0;
+    int best_error = INT_MAX;
+
+    for (int flip = 0; flip < 2; ++flip)
+    {
+        vec3 avg[2] = { vec3(0.f), vec3(0.f) };
+        for (int j = 0; j < 16; ++j)
+            avg[etc_second(j, !!flip)] += (vec3)block[etc_pixel(j)].rgb / 8.f;
+
+        for (int diff = 0; diff < 2; ++diff)
+        {
+            ivec3 q[2], base[2];
+            for (int s = 0; s < 2; ++s)
+                for (int ch = 0; ch < 3; ++ch)
+                    q[s][ch] = quantize(avg[s][ch], diff ? 5 : 4);
+
+            /* The second colour is stored as a delta in [-4, 3] */
+            if (diff)
+                q[1] = lol::clamp(q[1], q[0] - ivec3(4), q[0] + ivec3(3));
+
+            for (int s = 0; s < 2; ++s)
+                for (int ch = 0; ch < 3; ++ch)
+                    base[s][ch] = expand(q[s][ch], diff ? 5 : 4);
+
+            int table[2];
+            uint32_t indices[2];
+            int error = etc_fit(block, !!flip, 0, base[0], table[0], indices[0])
+                      + etc_fit(block, !!flip, 1, base[1], table[1], indices[1]);
+            if (error >= best_error)
+                continue;
+
+            uint64_t x = 0;
+            if (diff)
+            {
+                ivec3 d = q[1] - q[0];
+                x = (uint64_t)q[0].r << 59 | (uint64_t)(d.r & 7) << 56
+                  | (uint64_t)q[0].g << 51 | (uint64_t)(d.g & 7) << 48
+                  | (uint64_t)q[0].b << 43 | (uint64_t)(d.b & 7) << 40;
+            }
+            else
+            {
+                x = (uint64_t)q[0].r << 60 | (uint64_t)q[1].r << 56
+                  | (uint64_t)q[0].g << 52 | (uint64_t)q[1].g << 48
+                  | (uint64_t)q[0].b << 44 | (uint64_t)q[1].b << 40;
+            }
+            x |= (uint64_t)table[0] << 37 | (uint64_t)table[1] << 34
+               | (uint64_t)diff << 33 | (uint64_t)flip << 32
+               | (indices[0] | indices[1]);
+
+            best = x;
+            best_error = error;
+        }
+    }
+
+    uint64_t planar;
+    if (best_error && etc_encode_planar(block, planar) < best_error)
+        best = planar;
+
+    store_be64(best, out);
+}
+
+static void decode_etc2_rgb(uint8_t const *in, u8vec4 *block)
+{
+    uint64_t x = load_be64(in);
+    bool const diff = bits(x, 33, 33), flip = bits(x, 32, 32);
+
+    int r = bits(x, 63, 59), dr = (bits(x, 58, 56) ^ 4) - 4;
+    int g = bits(x, 55, 51), dg = (bits(x, 50, 48) ^ 4) - 4;
+    int b = bits(x, 47, 43), db = (bits(x, 42, 40) ^ 4) - 4;
+
+    if (diff && (r + dr < 0 || r + dr > 31 || g + dg < 0 || g + dg > 31))
+    {
+        /* T and H modes: two colours and a distance make a palette */
+        ivec3 c1, c2;
+        int dist;
+        u8vec4 pal[4];
+
+        if (r + dr < 0 || r + dr > 31)
+        {
+            c1 = ivec3(bits(x, 60, 59) << 2 | bits(x, 57, 56),
+                       bits(x, 55, 52), bits(x, 51, 48));
+            c2 = ivec3(bits(x, 47, 44), bits(x, 43, 40), bits(x, 39, 36));
+            dist = etc_distances[bits(x, 35, 34) << 1 | bits(x, 32, 32)];
+        }
+        else
+        {
+            c1 = ivec3(bits(x, 62, 59), bits(x, 58, 56) << 1 | bits(x, 52, 52),
+                       bits(x, 51, 51) << 3 | bits(x, 49, 47));
+            c2 = ivec3(bits(x, 46, 43), bits(x, 42, 39), bits(x, 38, 35));
+            int v1 = c1.r << 8 | c1.g << 4 | c1.b;
+            int v2 = c2.r << 8 | c2.g << 4 | c2.b;
+            dist = etc_distances[bits(x, 34, 34) << 2 | bits(x, 32, 32) << 1
+                                  | (v1 >= v2 ? 1 : 0)];
+        }
+
+        c1 = c1 * 17;
+        c2 = c2 * 17;
+        auto make = [](ivec3 c, int d)
+        {
+            return u8vec4(clamp8(c.r + d), clamp8(c.g + d), clamp8(c.b + d), 255);
+        };
+
+        if (r + dr < 0 || r + dr > 31)
+        {
+            pal[0] = make(c1, 0); pal[1] = make(c2, dist);
+            pal[2] = make(c2, 0); pal[3] = make(c2, -dist);
+        }
+        else
+        {
+            pal[0] = make(c1, dist); pal[1] = make(c1, -dist);
+            pal[2] = make(c2, dist); pal[3] = make(c2, -dist);
+        }
+
+        for (int j = 0; j < 16; ++j)
+            block[etc_pixel(j)] = pal[bits(x, 16 + j, 16 + j) << 1 | bits(x, j, j)];
+        return;
+    }
+
+    if (diff && (b + db < 0 || b + db > 31))
+    {
+        /* Planar mode */
+        int o[3] = { expand(bits(x, 62, 57), 6),
+                     expand(bits(x, 56, 56) << 6 | bits(x, 54, 49), 7),
+                     expand(bits(x, 48, 48) << 5 | bits(x, 44, 43) << 3 | bits(x, 41, 39), 6) };
+        int h[3] = { expand(bits(x, 38, 34) << 1 | bits(x, 32, 32), 6),
+                     expand(bits(x, 31, 25), 7), expand(bits(x, 24, 19), 6) };
+        int v[3] = { expand(bits(x, 18, 13), 6),
+                     expand(bits(x, 12, 6), 7), expand(bits(x, 5, 0), 6) };
+
+        for (int py = 0; py < 4; ++py)
+            for (int px = 0; px < 4; ++px)
+            {
+                u8vec4 &c = block[py * 4 + px];
+                for (int ch = 0; ch < 3; ++ch)
+                    c[ch] = clamp8((px * (h[ch] - o[ch]) + py * (v[ch] - o[ch])
+                                     + 4 * o[ch] + 2) >> 2);
+                c.a = 255;
+            }
+        return;
+    }
+
+    ivec3 base[2];
+    if (diff)
+    {
+        base[0] = ivec3(expand(r, 5), expand(g, 5), expand(b, 5));
+        base[1] = ivec3(expand(r + dr, 5), expand(g + dg, 5), expand(b + db, 5));
+    }
+    else
+    {
+        base[0] = ivec3(bits(x, 63, 60), bits(x, 55, 52), bits(x, 47, 44)) * 17;
+        base[1] = ivec3(bits(x, 59, 56), bits(x, 51, 48), bits(x, 43, 40)) * 17;
+    }
+    int const table[2] = { bits(x, 39, 37), bits(x, 36, 34) };
+
+    for (int j = 0; j < 16; ++j)
+    {
+        int s = etc_second(j, flip);
+        int m = etc_modifier(table[s], bits(x, 16 + j, 16 + j) << 1 | bits(x, j, j));
+        block[etc_pixel(j)] = u8vec4(clamp8(base[s].r + m), clamp8(base[s].g + m),
+                                     clamp8(base[s].b + m), 255);
+    }
+}
+
+static int eac_fit(u8vec4 const *block, int base, int mult, int table,
+                   uint64_t &indices)
+{
+    int error = 0;
+    indices = 0;
+    for (int j = 0; j < 16; ++j)
+    {
+        int a = block[etc_pixel(j)].a;
+        int best = 0, best_e = INT_MAX;
+        for (int k = 0; k < 8; ++k)
+        {
+            int e = sq(a - clamp8(base + eac_modifiers[table][k] * mult));
+            if (e < best_e)
+                best = k, best_e = e;
+        }
+        indices |= (uint64_t)best << (45 - 3 * j);
+        error += best_e;
+    }
+    return error;
+}
+
+static void encode_eac(u8vec4 const *block, uint8_t *out)
+{
+    int amin = 255, amax = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        amin = lol::min(amin, (int)block[i].a);
+        amax = lol::max(amax, (int)block[i].a);
+    }
+
+    uint64_t best = 0;
+    int best_error = INT_MAX;
+    for (int t = 0; t < 16 && best_error; ++t)
+    {
+        int lo = eac_modifiers[t][3], hi = eac_modifiers[t][7];
+        int m0 = (amax - amin + (hi - lo) / 2) / (hi - lo);
+        for (int mult = lol::max(1, m0 - 1); mult <= lol::min(15, m0 + 1); ++mult)
+        {
+            int b0 = (amin + amax - (lo + hi) * mult) / 2;
+            for (int base = lol::max(0, b0 - 1); base <= lol::min(255, b0 + 1); ++base)
+            {
+                uint64_t indices;
+                int error = eac_fit(block, base, mult, t, indices);
+                if (error < best_error)
+                {
+                    best_error = error;
+                    best = (uint64_t)base << 56 | (uint64_t)mult << 52
+                         | (uint64_t)t << 48 | indices;
+                }
+            }
+        }
+    }
+
+    store_be64(best, out);
+}
+
+static void decode_eac(uint8_t const *in, u8vec4 *block)
+{
+    uint64_t x = load_be64(in);
+    int base = bits(x, 63, 56), mult = bits(x, 55, 52), table = bits(x, 51, 48);
+    for (int j = 0; j < 16; ++j)
+        block[etc_pixel(j)].a = clamp8(base + eac_modifiers[table][bits(x, 47 - 3 * j, 45 - 3 * j)] * mult);
+}
+
+/*
+ * Public functions
+ */
+
+array<uint8_t> image::compress(CompressedFormat format) const
+{
+    ivec2 const isize = size();
+    ivec2 const blocks = (isize + ivec2(3)) / 4;
+    int const block_bytes = BytesPerBlock(format);
+
+    array<uint8_t> ret;
+    ret.resize(blocks.x * blocks.y * block_bytes);
+
+    image src(*this);
+    u8vec4 const *pixels = src.lock<PixelFormat::RGBA_8>();
+
+    for (int by = 0; by < blocks.y; ++by)
+        for (int bx = 0; bx < blocks.x; ++bx)
+        {
+            u8vec4 block[16];
+            for (int y = 0; y < 4; ++y)
+                for (int x = 0; x < 4; ++x)
+                {
+                    int px = lol::min(bx * 4 + x, isize.x - 1);
+                    int py = lol::min(by * 4 + y, isize.y - 1);
+                    block[y * 4 + x] = pixels[py * isize.x + px];
+                }
+
+            uint8_t *out = ret.data() + (by * blocks.x + bx) * block_bytes;
+            switch (format)
+            {
+            case CompressedFormat::BC1:
+                encode_bc1(block, out);
+                break;
+            case CompressedFormat::BC3:
+                encode_bc3(block, out);
+                break;
+            case CompressedFormat::ETC2_RGB8:
+                encode_etc2_rgb(block, out);
+                break;
+            case CompressedFormat::ETC2_RGBA8:
+                encode_eac(block, out);
+                encode_etc2_rgb(block, out + 8);
+                break;
+            }
+        }
+
+    src.unlock(pixels);
+    return ret;
+}
+
+image image::decompress(ivec2 size, CompressedFormat format,
+                        span<uint8_t const> data)
+{
+    ivec2 const blocks = (size + ivec2(3)) / 4;
+    int const block_bytes = BytesPerBlock(format);
+
+    image ret(size);
+    if ((int)data.size() < blocks.x * blocks.y * block_bytes)
+        return ret;
+
+    u8vec4 *pixels = ret.lock<PixelFormat::RGBA_8>();
+
+    for (int by = 0; by < blocks.y; ++by)
+        for (int bx = 0; bx < blocks.x; ++bx)
+        {
+            uint8_t const *in = data.data() + (by * blocks.x + bx) * block_bytes;
+            u8vec4 block[16];
+            switch (format)
+            {
+            case CompressedFormat::BC1:
+                decode_bc1(in, false, block);
+                break;
+            case CompressedFormat::BC3:
+                decode_bc3(in, block);
+                break;
+            case CompressedFormat::ETC2_RGB8:
+                decode_etc2_rgb(in, block);
+                break;
+            case CompressedFormat::ETC2_RGBA8:
+                decode_etc2_rgb(in + 8, block);
+                decode_eac(in, block);
+                break;
+            }
+
+            for (int y = 0; y < 4 && by * 4 + y < size.y; ++y)
+                for (int x = 0; x < 4 && bx * 4 + x < size.x; ++x)
+                    pixels[(by * 4 + y) * size.x + bx * 4 + x] = block[y * 4 + x];
+        }
+
+    ret.unlock(pixels);
+    return ret;
+}
+
+} /* namespace lol */
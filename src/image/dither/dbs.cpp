@@ -12,8 +12,25 @@
 
 #include <lol/engine-internal.h>
 
+#include "../image-private.h"
+
 /*
  * Direct Binary Search dithering
+ *
+ * The perceived error is E = Σ e², where e = hvs * (halftone - image) is
+ * the filtered error. Instead of re-filtering the image for each trial,
+ * we keep c = hvs ⋆ e (the correlation of the filtered error with the HVS
+ * kernel) up to date. Toggling pixel p by a then changes E by
+ *    2a.c(p) + a².r(0)
+ * and swapping pixels p and p+op (by a and -a) changes it by
+ *    2a.(c(p) - c(p+op)) + 2a².(r(0) - r(op))
+ * where r = hvs ⋆ hvs is the autocorrelation of the kernel. Trials cost
+ * O(1) and accepting a change costs one update of c over the support of r.
+ *
+ * Cells are processed in nine interleaved phases: cells of the same phase
+ * are three cells apart, which is more than the support of r, so they
+ * never touch the same data and can be processed concurrently without
+ * changing the result.
  */
 
 #define CELL 16
@@ -21,11 +38,20 @@
 #define N 7
 #define NN ((N * 2 + 1))
 
+/* Support of the kernel autocorrelation */
+#define M (N * 2)
+#define MM ((M * 2 + 1))
+
+/* Changes smaller than this are considered noise and ignored, which also
+ * guarantees that the search terminates. */
+#define EPSILON 1e-6f
+
+/* Hard limit on the number of full image sweeps */
+#define MAX_SWEEPS 64
+
 namespace lol
 {
 
-/* FIXME: though the algorithm is supposed to stop, we do not have a real,
- * guaranteed stop condition here. */
 image image::dither_dbs() const
 {
     ivec2 isize = size();
@@ -47,136 +73,180 @@ image image::dither_dbs() const
         for (int i = 0; i < NN; i++)
             ker[i][j] /= t;
 
-    /* A list of cells in our picture. If no change is done to a cell
-     * for two iterations, we stop considering changes to it. */
-    ivec2 const csize = (isize + ivec2(CELL - 1)) / CELL;
-    array2d<int> changelist(csize);
-    memset(changelist.data(), 0, changelist.bytes());
+    /* Its autocorrelation */
+    array2d<float> corr(ivec2(MM, MM), 0.f);
+    for (int v = -M; v <= M; v++)
+        for (int u = -M; u <= M; u++)
+        {
+            float sum = 0.f;
+            for (int j = max(0, -v); j < min(NN, NN - v); j++)
+                for (int i = max(0, -u); i < min(NN, NN - u); i++)
+                    sum += ker[i][j] * ker[i + u][j + v];
+            corr[u + M][v + M] = sum;
+        }
 
     image dst = *this;
     dst.set_format(PixelFormat::Y_F32);
-
-    image tmp1 = dst.Convolution(ker);
-    array2d<float> &tmp1data = tmp1.lock2d<PixelFormat::Y_F32>();
+    image src = dst;
+    array2d<float> const &srcdata = src.lock2d<PixelFormat::Y_F32>();
 
     dst = dst.dither_random();
     array2d<float> &dstdata = dst.lock2d<PixelFormat::Y_F32>();
 
-    image tmp2 = dst.Convolution(ker);
-    array2d<float> &tmp2data = tmp2.lock2d<PixelFormat::Y_F32>();
+    /* Filtered error over the image plus a margin of N pixels, since the
+     * error spills outside the image. */
+    ivec2 const esize = isize + ivec2(2 * N);
+    array2d<float> err(esize);
+    std::atomic<int> next_row(0);
+    image_parallel_run(esize.y, [&]()
+    {
+        for (int y = next_row++; y < esize.y; y = next_row++)
+            for (int x = 0; x < esize.x; x++)
+            {
+                float sum = 0.f;
+                for (int j = max(0, y - 2 * N); j < min(isize.y, y + 1); j++)
+                    for (int i = max(0, x - 2 * N); i < min(isize.x, x + 1); i++)
+                        sum += ker[x - i][y - j] * (dstdata[i][j] - srcdata[i][j]);
+                err[x][y] = sum;
+            }
+    });
+
+    /* Correlation of the filtered error with the kernel, on the image */
+    array2d<float> cep(isize);
+    next_row = 0;
+    image_parallel_run(isize.y, [&]()
+    {
+        for (int y = next_row++; y < isize.y; y = next_row++)
+            for (int x = 0; x < isize.x; x++)
+            {
+                float sum = 0.f;
+                for (int j = 0; j < NN; j++)
+                    for (int i = 0; i < NN; i++)
+                        sum += ker[i][j] * err[x + i][y + j];
+                cep[x][y] = sum;
+            }
+    });
+
+    src.unlock2d(srcdata);
 
-    for (int run = 0, last_change = 0; ; ++run)
+    /* Apply a change of a to pixel pos */
+    auto apply = [&](ivec2 pos, float a)
     {
-        int const cell = run % (csize.x * csize.y);
-        int const cx = cell % csize.x;
-        int const cy = cell / csize.x;
+        dstdata[pos] += a;
 
-        /* Bail out if no change was done for the last full image run */
-        if (run > last_change + csize.x * csize.y)
-            break;
+        int const imin = max(-M, -pos.x), imax = min(M, isize.x - 1 - pos.x);
+        int const jmin = max(-M, -pos.y), jmax = min(M, isize.y - 1 - pos.y);
 
-        /* Skip cell if it was already ignored twice */
-        if (changelist[cx][cy] >= 2)
-            continue;
+        for (int j = jmin; j <= jmax; j++)
+            for (int i = imin; i <= imax; i++)
+                cep[pos.x + i][pos.y + j] += a * corr[i + M][j + M];
+    };
 
-        int changes = 0;
+    /* Try all possible toggles and swaps in one cell, and return whether
+     * anything was changed. */
+    auto process_cell = [&](ivec2 cell) -> bool
+    {
+        static ivec2 const op_list[] =
+        {
+            { 0, 1 },   { 0, -1 }, { -1, 0 }, { 1, 0 },
+            { -1, -1 }, { -1, 1 }, { 1, -1 }, { 1, 1 },
+        };
+
+        float const r0 = corr[M][M];
+        bool changed = false;
 
         for (int pixel = 0; pixel < CELL * CELL; ++pixel)
         {
-            ivec2 const pos(cx * CELL + pixel % CELL,
-                            cy * CELL + pixel / CELL);
+            ivec2 const pos = cell * CELL + ivec2(pixel % CELL, pixel / CELL);
 
-            if (!(pos >= ivec2(0)) || !(pos < isize))
+            if (!(pos < isize))
                 continue;
 
-            /* The best operation we can do */
-            ivec2 best_op(0);
-            float best_error = 0.f;
-
-            float d = dstdata[pos];
+            float const d = dstdata[pos];
+            float const c = cep[pos];
 
-            /* Compute the effect of all possible toggle and swaps */
-            static ivec2 const op_list[] =
-            {
-                { 0, 0 },
-                { 0, 1 },   { 0, -1 }, { -1, 0 }, { 1, 0 },
-                { -1, -1 }, { -1, 1 }, { 1, -1 }, { 1, 1 },
-            };
+            /* Toggling the pixel is the first candidate */
+            float a = 1.f - 2.f * d;
+            ivec2 best_op(0);
+            float best_delta = 2.f * a * c + r0;
 
-            for (ivec2 const op : op_list)
+            for (ivec2 const &op : op_list)
             {
                 if (!(pos + op >= ivec2(0)) || !(pos + op < isize))
                     continue;
 
-                bool flip = (op == ivec2(0));
-
-                float d2 = flip ? 1 - d : dstdata[pos + op];
-
-                if (!flip && d2 == d)
+                float const d2 = dstdata[pos + op];
+                if (d2 == d)
                     continue;
 
-                /* TODO: implement min/max for 3+ arguments */
-                int imin = max(max(-N, op.x - N), -pos.x);
-                int imax = min(min(N + 1, op.x + NN - N), isize.x - pos.x);
-                int jmin = max(max(-N, op.y - N), -pos.y);
-                int jmax = min(min(N + 1, op.y + NN - N), isize.y - pos.y);
+                float const a2 = d2 - d;
+                float const delta = 2.f * a2 * (c - cep[pos + op])
+                    + 2.f * (r0 - corr[op.x + M][op.y + M]);
 
-                float error = 0.f;
-                for (int j = jmin; j < jmax; j++)
-                for (int i = imin; i < imax; i++)
+                if (delta < best_delta)
                 {
-                    ivec2 pos2 = pos + ivec2(i, j);
-
-                    float m = ker[i + N][j + N];
-                    if (!flip)
-                        m -= ker[i - op.x + N][j - op.y + N];
-                    float p = tmp1data[pos2];
-                    float q1 = tmp2data[pos2];
-                    float q2 = q1 + m * (d2 - d);
-                    error += sq(q1 - p) - sq(q2 - p);
-                }
-
-                if (error > best_error)
-                {
-                    best_error = error;
+                    best_delta = delta;
                     best_op = op;
+                    a = a2;
                 }
             }
 
             /* Only apply the change if interesting */
-            if (best_error > 0.f)
+            if (best_delta < -EPSILON)
             {
-                bool flip = (best_op == ivec2(0));
-
-                float d2 = flip ? 1 - d : dstdata[pos + best_op];
-                dstdata[pos + best_op] = d;
-                dstdata[pos] = d2;
+                apply(pos, a);
+                if (best_op != ivec2(0))
+                    apply(pos + best_op, -a);
+                changed = true;
+            }
+        }
 
-                for (int j = -N; j <= N; j++)
-                for (int i = -N; i <= N; i++)
-                {
-                    ivec2 off(i, j);
-                    float delta = (d2 - d) * ker[i + N][j + N];
+        return changed;
+    };
 
-                    if (pos + off >= ivec2(0) && pos + off < isize)
-                        tmp2data[pos + off] += delta;
+    /* A list of cells in our picture. A cell needs to be visited again
+     * if it or one of its neighbours was changed during the last sweep;
+     * we stop when no cell needs visiting. */
+    ivec2 const csize = (isize + ivec2(CELL - 1)) / CELL;
+    array2d<uint8_t> dirty(csize, 1);
+    array2d<uint8_t> changed(csize, 0);
 
-                    if (!flip && pos + off + best_op >= ivec2(0)
-                         && pos + off + best_op < isize)
-                        tmp2data[pos + off + best_op] -= delta;
-                }
+    for (int sweep = 0; sweep < MAX_SWEEPS; ++sweep)
+    {
+        for (int phase = 0; phase < 9; ++phase)
+        {
+            array<ivec2> todo;
+            for (int cy = phase / 3; cy < csize.y; cy += 3)
+                for (int cx = phase % 3; cx < csize.x; cx += 3)
+                    if (dirty[cx][cy])
+                        todo.push(ivec2(cx, cy));
+
+            std::atomic<int> next_cell(0);
+            image_parallel_run(todo.count(), [&]()
+            {
+                for (int n = next_cell++; n < todo.count(); n = next_cell++)
+                    changed[todo[n]] = process_cell(todo[n]);
+            });
+        }
 
-                ++changes;
-                last_change = run;
+        bool done = true;
+        for (int cy = 0; cy < csize.y; ++cy)
+            for (int cx = 0; cx < csize.x; ++cx)
+            {
+                uint8_t flag = 0;
+                for (int j = max(0, cy - 1); j <= min(csize.y - 1, cy + 1); ++j)
+                    for (int i = max(0, cx - 1); i <= min(csize.x - 1, cx + 1); ++i)
+                        flag |= changed[i][j];
+                dirty[cx][cy] = flag;
+                done &= !flag;
             }
-        }
 
-        if (changes == 0)
-            ++changelist[cx][cy];
+        if (done)
+            break;
+
+        memset(changed.data(), 0, changed.bytes());
     }
 
-    tmp1.unlock2d(tmp1data);
-    tmp2.unlock2d(tmp2data);
     dst.unlock2d(dstdata);
 
     return dst;
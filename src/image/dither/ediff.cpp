@@ -1,7 +1,7 @@
 //
 //  Lol Engine
 //
-//  Copyright © 2004—2017 Sam Hocevar <sam@hocevar.net>
+//  Copyright © 2004—2019 Sam Hocevar <sam@hocevar.net>
 //
 //  Lol Engine is free software. It comes without any warranty, to
 //  the extent permitted by applicable law. You can redistribute it
@@ -12,6 +12,8 @@
 
 #include <lol/engine-internal.h>
 
+#include "../image-private.h"
+
 /*
  * Generic error diffusion functions
  */
@@ -19,12 +21,77 @@
 namespace lol
 {
 
+/* A kernel known at runtime, as passed to image::dither_ediff(). */
+struct ediff_dynamic_kernel
+{
+    int width, height, origin;
+    float const *data;
+};
+
+/* The stock kernels, known at compile time so that the diffusion loops
+ * get fully unrolled and the zero coefficients disappear. */
+template<EdiffAlgorithm A> struct ediff_static_kernel;
+
+template<int N>
+static constexpr int ediff_origin(float const (&data)[N], int n = 0)
+{
+    return n >= N || data[n] > 0.f ? n : ediff_origin(data, n + 1);
+}
+
+#define _EDIFF(name, w, h, ...) \
+    template<> struct ediff_static_kernel<EdiffAlgorithm::name> \
+    { \
+        static constexpr int width = w, height = h; \
+        static constexpr float data[w * h] = { __VA_ARGS__ }; \
+        static constexpr int origin = ediff_origin(data); \
+    }; \
+    constexpr int ediff_static_kernel<EdiffAlgorithm::name>::width; \
+    constexpr int ediff_static_kernel<EdiffAlgorithm::name>::height; \
+    constexpr float ediff_static_kernel<EdiffAlgorithm::name>::data[]; \
+    constexpr int ediff_static_kernel<EdiffAlgorithm::name>::origin;
+#include "ediff.inc"
+#undef _EDIFF
+
+/* Quantise one pixel and diffuse its error. x is the position along
+ * the scan, which is reversed for odd lines in serpentine mode. */
+template<typename K>
+static inline void ediff_pixel(K const &k, float *pixels, ivec2 size,
+                               int x, int y, bool reverse)
+{
+    int const x2 = reverse ? size.x - 1 - x : x;
+    int const s = reverse ? -1 : 1;
+
+    float const p = pixels[y * size.x + x2];
+    float const q = p < 0.5f ? 0.f : 1.f;
+    pixels[y * size.x + x2] = q;
+
+    float const e = p - q;
+
+    int const jmax = min(k.height, size.y - y);
+    bool const inside = x >= k.origin && x - k.origin + k.width <= size.x;
+
+    for (int j = 0; j < jmax; j++)
+        for (int i = j ? 0 : k.origin + 1; i < k.width; i++)
+        {
+            float const coeff = k.data[j * k.width + i];
+            if (coeff == 0.f)
+                continue;
+
+            if (!inside && (x + i - k.origin < 0
+                             || x + i - k.origin >= size.x))
+                continue;
+
+            pixels[(y + j) * size.x + x2 + (i - k.origin) * s] += e * coeff;
+        }
+}
+
 /* Perform a generic error diffusion dithering. The first non-zero
  * element in ker is treated as the current pixel. All other non-zero
  * elements are the error diffusion coefficients.
  * Making the matrix generic is not terribly slower: the performance
  * hit is around 4% for Floyd-Steinberg and 13% for JaJuNi, with the
- * benefit of a lot less code. */
+ * benefit of a lot less code. Stock kernels should still go through
+ * the EdiffAlgorithm version, which has specialised loops. */
 image image::dither_ediff(array2d<float> const &ker, ScanMode scan) const
 {
     image dst = *this;
@@ -37,36 +104,46 @@ image image::dither_ediff(array2d<float> const &ker, ScanMode scan) const
         if (ker[kx][0] > 0.f)
             break;
 
+    ediff_dynamic_kernel const k { (int)ksize.x, (int)ksize.y, kx, ker.data() };
+
     float *pixels = dst.lock<PixelFormat::Y_F32>();
-    for (int y = 0; y < isize.y; y++)
+    ediff_scan(isize, k.width, scan, [&](int x, int y, bool reverse)
     {
-        bool reverse = (y & 1) && (scan == ScanMode::Serpentine);
+        ediff_pixel(k, pixels, isize, x, y, reverse);
+    });
+    dst.unlock(pixels);
 
-        for (int x = 0; x < isize.x; x++)
-        {
-            int x2 = reverse ? isize.x - 1 - x : x;
-            int s = reverse ? -1 : 1;
+    return dst;
+}
 
-            float p = pixels[y * isize.x + x2];
-            float q = p < 0.5f ? 0.f : 1.f;
-            pixels[y * isize.x + x2] = q;
+template<EdiffAlgorithm A>
+static void ediff_static(float *pixels, ivec2 size, ScanMode scan)
+{
+    ediff_static_kernel<A> const k {};
 
-            float e = (p - q);
+    ediff_scan(size, k.width, scan, [&](int x, int y, bool reverse)
+    {
+        ediff_pixel(k, pixels, size, x, y, reverse);
+    });
+}
 
-            for (int j = 0; j < ksize.y && y < isize.y - j; j++)
-                for (int i = 0; i < ksize.x; i++)
-                {
-                    if (j == 0 && i <= kx)
-                        continue;
+image image::dither_ediff(EdiffAlgorithm algorithm, ScanMode scan) const
+{
+    image dst = *this;
 
-                    if (x + i - kx < 0 || x + i - kx >= isize.x)
-                        continue;
+    ivec2 isize = dst.size();
+    float *pixels = dst.lock<PixelFormat::Y_F32>();
 
-                    pixels[(y + j) * isize.x + x2 + (i - kx) * s]
-                       += e * ker[i][j];
-                }
-        }
+    switch (algorithm)
+    {
+#define _EDIFF(name, w, h, ...) \
+    case EdiffAlgorithm::name: \
+        ediff_static<EdiffAlgorithm::name>(pixels, isize, scan); \
+        break;
+#include "ediff.inc"
+#undef _EDIFF
     }
+
     dst.unlock(pixels);
 
     return dst;
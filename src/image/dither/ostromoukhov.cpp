@@ -12,6 +12,8 @@
 
 #include <lol/engine-internal.h>
 
+#include "../image-private.h"
+
 /*
  * Ostromoukhov dithering functions
  *
@@ -79,31 +81,27 @@ image image::dither_ostromoukhov(ScanMode scan) const
     int w = dst.size().x;
     int h = dst.size().y;
 
-    for (int y = 0; y < h; y++)
+    /* The diffusion kernel spans three pixels, hence the lag of 3 */
+    ediff_scan(dst.size(), 3, scan, [&](int x, int y, bool reverse)
     {
-        bool reverse = (y & 1) && (scan == ScanMode::Serpentine);
+        int x2 = reverse ? w - 1 - x : x;
+        int s = reverse ? -1 : 1;
+
+        float p = pixels[y * w + x2];
+        float q = p < 0.5f ? 0.f : 1.f;
+        pixels[y * w + x2] = q;
 
-        for (int x = 0; x < w; x++)
+        vec3 e = (p - q) * GetDiffusion(p);
+
+        if(x < w - 1)
+            pixels[y * w + x2 + s] += e[0];
+        if(y < h - 1)
         {
-            int x2 = reverse ? w - 1 - x : x;
-            int s = reverse ? -1 : 1;
-
-            float p = pixels[y * w + x2];
-            float q = p < 0.5f ? 0.f : 1.f;
-            pixels[y * w + x2] = q;
-
-            vec3 e = (p - q) * GetDiffusion(p);
-
-            if(x < w - 1)
-                pixels[y * w + x2 + s] += e[0];
-            if(y < h - 1)
-            {
-                if(x > 0)
-                    pixels[(y + 1) * w + x2 - s] += e[1];
-                pixels[(y + 1) * w + x2] += e[2];
-            }
+            if(x > 0)
+                pixels[(y + 1) * w + x2 - s] += e[1];
+            pixels[(y + 1) * w + x2] += e[2];
         }
-    }
+    });
 
     dst.unlock(pixels);
 
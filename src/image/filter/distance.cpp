@@ -0,0 +1,290 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2004—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <climits>
+#include <cstring>
+
+/*
+ * Distance transform functions
+ */
+
+namespace lol
+{
+
+/* The squared distance of pixels with no seed in sight; small enough
+ * that adding a squared pixel distance to it is still meaningful. */
+static double const EDT_INFINITY = 1e20;
+
+/* Exact squared distance transform of one line, after Felzenszwalb and
+ * Huttenlocher, “Distance Transforms of Sampled Functions”: out[q] is the
+ * minimum over p of (q - p)² + f[p], computed from the lower envelope of
+ * the parabolas rooted at each p. v and z need room for n and n + 1
+ * elements. Doubles keep the result exact for any realistic size. */
+static void edt_line(double const *f, double *out, int n, int *v, double *z)
+{
+    int k = 0;
+    v[0] = 0;
+    z[0] = -EDT_INFINITY;
+    z[1] = EDT_INFINITY;
+
+    for (int q = 1; q < n; ++q)
+    {
+        /* Where the parabola at q starts being lower than the envelope;
+         * z[0] is -∞ so the first parabola is never removed */
+        double s;
+        for (;;)
+        {
+            int const p = v[k];
+            s = ((f[q] + (double)q * q) - (f[p] + (double)p * p)) / (2 * (q - p));
+            if (s > z[k])
+                break;
+            --k;
+        }
+
+        ++k;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = EDT_INFINITY;
+    }
+
+    k = 0;
+    for (int q = 0; q < n; ++q)
+    {
+        while (z[k + 1] < q)
+            ++k;
+        double const d = q - v[k];
+        out[q] = d * d + f[v[k]];
+    }
+}
+
+/* Replace a grid of 0 (seed) and EDT_INFINITY (other) values with the
+ * squared distance to the nearest seed: columns first, then rows. */
+static void edt_grid(array<double> &grid, ivec2 size)
+{
+    int const len = lol::max(size.x, size.y);
+
+    parallel_for_range(size.x, [&](ptrdiff_t begin, ptrdiff_t end)
+    {
+        array<double> f, out, z;
+        array<int> v;
+        f.resize(len); out.resize(len); z.resize(len + 1); v.resize(len);
+
+        for (ptrdiff_t x = begin; x < end; ++x)
+        {
+            for (int y = 0; y < size.y; ++y)
+                f[y] = grid[y * size.x + x];
+            edt_line(f.data(), out.data(), size.y, v.data(), z.data());
+            for (int y = 0; y < size.y; ++y)
+                grid[y * size.x + x] = out[y];
+        }
+    });
+
+    parallel_for_range(size.y, [&](ptrdiff_t begin, ptrdiff_t end)
+    {
+        array<double> out, z;
+        array<int> v;
+        out.resize(len); z.resize(len + 1); v.resize(len);
+
+        for (ptrdiff_t y = begin; y < end; ++y)
+        {
+            double *line = &grid[y * size.x];
+            edt_line(line, out.data(), size.x, v.data(), z.data());
+            memcpy(line, out.data(), size.x * sizeof(double));
+        }
+    });
+}
+
+image image::distance_transform(float threshold) const
+{
+    ivec2 const isize = size();
+    int const count = isize.x * isize.y;
+    image tmp = *this;
+    image ret(isize);
+
+    array<double> grid;
+    grid.resize(count);
+
+    if (format() == PixelFormat::Y_8 || format() == PixelFormat::Y_F32)
+    {
+        float const *srcp = tmp.lock<PixelFormat::Y_F32>();
+        float *dstp = ret.lock<PixelFormat::Y_F32>();
+
+        for (int n = 0; n < count; ++n)
+            grid[n] = srcp[n] >= threshold ? 0.0 : EDT_INFINITY;
+        edt_grid(grid, isize);
+        for (int n = 0; n < count; ++n)
+            dstp[n] = (float)lol::sqrt(grid[n]);
+
+        tmp.unlock(srcp);
+        ret.unlock(dstp);
+    }
+    else
+    {
+        /* Every channel, including alpha, gets its own distance field */
+        vec4 const *srcp = tmp.lock<PixelFormat::RGBA_F32>();
+        vec4 *dstp = ret.lock<PixelFormat::RGBA_F32>();
+
+        for (int ch = 0; ch < 4; ++ch)
+        {
+            for (int n = 0; n < count; ++n)
+                grid[n] = srcp[n][ch] >= threshold ? 0.0 : EDT_INFINITY;
+            edt_grid(grid, isize);
+            for (int n = 0; n < count; ++n)
+                dstp[n][ch] = (float)lol::sqrt(grid[n]);
+        }
+
+        tmp.unlock(srcp);
+        ret.unlock(dstp);
+    }
+
+    return ret;
+}
+
+image image::signed_distance_field(float radius, float threshold) const
+{
+    ivec2 const isize = size();
+    int const count = isize.x * isize.y;
+    image tmp = *this;
+    image ret(isize);
+
+    float const *srcp = tmp.lock<PixelFormat::Y_F32>();
+    float *dstp = ret.lock<PixelFormat::Y_F32>();
+
+    /* Distances to the nearest inside pixel, and to the nearest outside
+     * pixel; the outline is half a pixel away from both */
+    array<double> inside, outside;
+    inside.resize(count);
+    outside.resize(count);
+    for (int n = 0; n < count; ++n)
+    {
+        bool const in = srcp[n] >= threshold;
+        inside[n] = in ? 0.0 : EDT_INFINITY;
+        outside[n] = in ? EDT_INFINITY : 0.0;
+    }
+    edt_grid(inside, isize);
+    edt_grid(outside, isize);
+
+    float const scale = 0.5f / lol::max(radius, 1e-6f);
+    for (int n = 0; n < count; ++n)
+    {
+        float d = inside[n] == 0.0 ? (float)lol::sqrt(outside[n]) - 0.5f
+                                   : 0.5f - (float)lol::sqrt(inside[n]);
+        dstp[n] = lol::clamp(0.5f + d * scale, 0.f, 1.f);
+    }
+
+    tmp.unlock(srcp);
+    ret.unlock(dstp);
+
+    return ret;
+}
+
+/* Jump flooding, after Rong and Tan, “Jump Flooding in GPU with
+ * Applications to Voronoi Diagram and Distance Transform”: every pass
+ * lets each pixel adopt the nearest seed known by its neighbours at a
+ * given step, with steps halving down to 1. A last pass with a step of
+ * 1 fixes most of the remaining errors. */
+array2d<ivec2> image::nearest_seed() const
+{
+    ivec2 const isize = size();
+    image tmp = *this;
+    array2d<ivec2> ret(isize), other(isize);
+    ivec2 *cur = ret.data(), *next = other.data();
+
+    vec4 const *srcp = tmp.lock<PixelFormat::RGBA_F32>();
+    for (int y = 0; y < isize.y; ++y)
+        for (int x = 0; x < isize.x; ++x)
+            cur[y * isize.x + x] = srcp[y * isize.x + x].a > 0.f ? ivec2(x, y) : ivec2(-1);
+    tmp.unlock(srcp);
+
+    array<int> steps;
+    for (int step = 1; step < lol::max(isize.x, isize.y); step *= 2)
+        steps.insert(step, 0);
+    steps << 1;
+
+    for (int step : steps)
+    {
+        parallel_for(isize.y, [&](ptrdiff_t y)
+        {
+            for (int x = 0; x < isize.x; ++x)
+            {
+                ivec2 best = cur[y * isize.x + x];
+                int best_dist = best.x < 0 ? INT_MAX : sqlength(best - ivec2(x, (int)y));
+
+                for (int j = -step; j <= step; j += step)
+                {
+                    int const y2 = (int)y + j;
+                    if (y2 < 0 || y2 >= isize.y)
+                        continue;
+
+                    for (int i = -step; i <= step; i += step)
+                    {
+                        int const x2 = x + i;
+                        if (x2 < 0 || x2 >= isize.x)
+                            continue;
+
+                        ivec2 const seed = cur[y2 * isize.x + x2];
+                        if (seed.x < 0)
+                            continue;
+                        int const dist = sqlength(seed - ivec2(x, (int)y));
+                        if (dist < best_dist)
+                        {
+                            best = seed;
+                            best_dist = dist;
+                        }
+                    }
+                }
+
+                next[y * isize.x + x] = best;
+            }
+        });
+
+        std::swap(cur, next);
+    }
+
+    if (cur != ret.data())
+        ret = other;
+    return ret;
+}
+
+image image::voronoi() const
+{
+    ivec2 const isize = size();
+    array2d<ivec2> seeds = nearest_seed();
+    image tmp = *this;
+    image ret(isize);
+
+    vec4 const *srcp = tmp.lock<PixelFormat::RGBA_F32>();
+    vec4 *dstp = ret.lock<PixelFormat::RGBA_F32>();
+
+    parallel_for(isize.y, [&](ptrdiff_t y)
+    {
+        for (int x = 0; x < isize.x; ++x)
+        {
+            /* Only images without any seed have pixels without one */
+            ivec2 const seed = seeds[x][y];
+            vec4 color(0.f);
+            if (seed.x >= 0)
+                color = srcp[seed.y * isize.x + seed.x];
+            dstp[y * isize.x + x] = color;
+        }
+    });
+
+    tmp.unlock(srcp);
+    ret.unlock(dstp);
+
+    return ret;
+}
+
+} /* namespace lol */
+
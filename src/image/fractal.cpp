@@ -0,0 +1,260 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <atomic>
+
+/*
+ * Perturbation fractal renderer
+ */
+
+namespace lol
+{
+
+/* Points escape when |z|² exceeds this; a large value gives smoother
+ * iteration counts. */
+static double const FRACTAL_BAILOUT = 65536.0;
+
+/* The series approximation is used as long as its third order term stays
+ * this small compared to its second order term. */
+static ldouble const FRACTAL_SERIES_TOLERANCE = 1e-4;
+
+/* z·w + t; complex values are built in place rather than through the
+ * generic vector operators, which copy them. */
+static inline f128cmplx mul_add(f128cmplx const &z, f128cmplx const &w,
+                                f128cmplx const &t)
+{
+    return f128cmplx(z.x * w.x - z.y * w.y + t.x, z.x * w.y + z.y * w.x + t.y);
+}
+
+struct fractal_renderer_private
+{
+    rcmplx m_center = rcmplx(0.0), m_julia_c = rcmplx(0.0);
+    double m_radius = 2.0;
+    int m_max_iterations = 256;
+    bool m_julia = false, m_long_double = false, m_series = true;
+
+    /* The reference orbit; it stops before the first point of modulus
+     * greater than 2, which keeps pixels from losing precision when
+     * they are rebased, but it always has at least two points. */
+    bool m_dirty = true;
+    array<dvec2> m_orbit;
+    array<vec_t<ldouble, 2>> m_orbit_ld;
+
+    fractal_renderer::stats m_stats;
+
+    void compute_orbit()
+    {
+        m_orbit.clear();
+        m_orbit_ld.clear();
+
+        real x = m_julia ? m_center.x : real::R_0();
+        real y = m_julia ? m_center.y : real::R_0();
+        real const cx = m_julia ? m_julia_c.x : m_center.x;
+        real const cy = m_julia ? m_julia_c.y : m_center.y;
+
+        for (int n = 0; ; ++n)
+        {
+            ldouble const zx = (ldouble)x, zy = (ldouble)y;
+
+            /* If the centre is far enough for the reference to escape
+             * right away, keep its first two points anyway: pixels
+             * need them to iterate, and escape soon too. */
+            bool const escaped = zx * zx + zy * zy > 4 || n > m_max_iterations;
+            if (escaped && m_orbit.count() >= 2)
+                break;
+
+            m_orbit_ld << vec_t<ldouble, 2>(zx, zy);
+            m_orbit << dvec2((double)zx, (double)zy);
+
+            real tmp = x * y;
+            x = x * x - y * y + cx;
+            y = tmp + tmp + cy;
+        }
+
+        m_dirty = false;
+    }
+
+    /* Find how many iterations the series approximation can skip for
+     * offsets of modulus up to r, and compute its coefficients. They are
+     * scaled by powers of the view radius so that they stay in range. */
+    int compute_series(ldouble r, f128cmplx coeffs[3])
+    {
+        ldouble const s = m_radius;
+        f128cmplx a(m_julia ? s : 0.0), b(0.0), c(0.0);
+        int n = 0;
+
+        if (m_series)
+        {
+            for (; n + 1 < m_orbit_ld.count(); ++n)
+            {
+                f128cmplx const z2(m_orbit_ld[n].x * 2, m_orbit_ld[n].y * 2);
+                f128cmplx const b2(b.x * 2, b.y * 2);
+                f128cmplx const na = mul_add(z2, a, f128cmplx(m_julia ? 0.0 : s));
+                f128cmplx const nb = mul_add(z2, b, a * a);
+                f128cmplx const nc = mul_add(z2, c, a * b2);
+
+                if (sqlength(nc) * r * r > sqlength(nb) * FRACTAL_SERIES_TOLERANCE
+                                                        * FRACTAL_SERIES_TOLERANCE)
+                    break;
+
+                a = na; b = nb; c = nc;
+            }
+        }
+
+        coeffs[0] = a; coeffs[1] = b; coeffs[2] = c;
+        return n;
+    }
+
+    template<typename T>
+    void render_tile(array<vec_t<T, 2>> const &orbit, f128cmplx const coeffs[3],
+                     int skip, array2d<float> &out, dvec2 origin, dvec2 step,
+                     ivec2 lo, ivec2 hi, int64_t &iterations, int64_t &rebases)
+    {
+        T const s = (T)m_radius;
+        int const last = orbit.count() - 1;
+        T const z0x = orbit[0].x, z0y = orbit[0].y;
+
+        for (int j = lo.y; j < hi.y; ++j)
+        for (int i = lo.x; i < hi.x; ++i)
+        {
+            dvec2 const u = origin + dvec2(i, j) * step;
+
+            /* Mandelbrot pixels perturb c; Julia pixels perturb z0 */
+            T const dcx = m_julia ? T(0) : (T)u.x * s;
+            T const dcy = m_julia ? T(0) : (T)u.y * s;
+
+            f128cmplx const v((ldouble)u.x, (ldouble)u.y);
+            f128cmplx const dz0 = mul_add(mul_add(coeffs[2], v, coeffs[1]), v, coeffs[0]) * v;
+            T dzx = (T)dz0.x, dzy = (T)dz0.y;
+
+            int n = skip, m = skip;
+            T zx = orbit[m].x + dzx, zy = orbit[m].y + dzy;
+            T r2 = zx * zx + zy * zy;
+
+            while (r2 <= (T)FRACTAL_BAILOUT && n < m_max_iterations)
+            {
+                /* Rebase when the pixel gets closer to zero than to the
+                 * reference, or when the reference is exhausted. */
+                if (m == last || r2 < dzx * dzx + dzy * dzy)
+                {
+                    dzx = zx - z0x;
+                    dzy = zy - z0y;
+                    m = 0;
+                    ++rebases;
+                }
+
+                /* dz ← (2Z + dz)·dz + dc */
+                T const tx = orbit[m].x + orbit[m].x + dzx;
+                T const ty = orbit[m].y + orbit[m].y + dzy;
+                T const nx = tx * dzx - ty * dzy + dcx;
+                dzy = tx * dzy + ty * dzx + dcy;
+                dzx = nx;
+                ++m;
+                ++n;
+
+                zx = orbit[m].x + dzx;
+                zy = orbit[m].y + dzy;
+                r2 = zx * zx + zy * zy;
+            }
+
+            iterations += n - skip;
+
+            if (r2 <= (T)FRACTAL_BAILOUT)
+                out[i][j] = -1.f;
+            else
+                out[i][j] = (float)(n + 1 - std::log2(std::log((double)r2)
+                                                       / std::log(FRACTAL_BAILOUT)));
+        }
+    }
+};
+
+fractal_renderer::fractal_renderer()
+  : m_private(new fractal_renderer_private())
+{
+}
+
+fractal_renderer::~fractal_renderer()
+{
+}
+
+void fractal_renderer::set_view(rcmplx const &center, double radius)
+{
+    m_private->m_center = center;
+    m_private->m_radius = radius;
+    m_private->m_dirty = true;
+}
+
+void fractal_renderer::set_julia(bool enabled, rcmplx const &c)
+{
+    m_private->m_julia = enabled;
+    m_private->m_julia_c = c;
+    m_private->m_dirty = true;
+}
+
+void fractal_renderer::set_max_iterations(int iterations)
+{
+    m_private->m_max_iterations = lol::max(iterations, 1);
+    m_private->m_dirty = true;
+}
+
+void fractal_renderer::set_long_double(bool enabled)
+{
+    m_private->m_long_double = enabled;
+}
+
+void fractal_renderer::set_series(bool enabled)
+{
+    m_private->m_series = enabled;
+}
+
+void fractal_renderer::render(array2d<float> &out, dvec2 origin, dvec2 step)
+{
+    fractal_renderer_private *data = m_private.get();
+    ivec2 const size = out.size();
+
+    if (data->m_dirty)
+        data->compute_orbit();
+
+    /* The series has to be valid for the farthest pixel */
+    dvec2 far = lol::abs(origin) + lol::abs(dvec2(size - ivec2(1)) * step);
+    f128cmplx coeffs[3];
+    int const skip = data->compute_series((ldouble)length(far), coeffs);
+
+    std::atomic<int64_t> iterations(0), rebases(0);
+    parallel_for(size, ivec2(32, 8), [&](ivec2 lo, ivec2 hi)
+    {
+        int64_t tile_iterations = 0, tile_rebases = 0;
+        if (data->m_long_double)
+            data->render_tile(data->m_orbit_ld, coeffs, skip, out, origin, step,
+                              lo, hi, tile_iterations, tile_rebases);
+        else
+            data->render_tile(data->m_orbit, coeffs, skip, out, origin, step,
+                              lo, hi, tile_iterations, tile_rebases);
+        iterations += tile_iterations;
+        rebases += tile_rebases;
+    });
+
+    data->m_stats.reference = data->m_orbit.count();
+    data->m_stats.skipped = skip;
+    data->m_stats.iterations = iterations;
+    data->m_stats.rebases = rebases;
+}
+
+fractal_renderer::stats const &fractal_renderer::get_stats() const
+{
+    return m_private->m_stats;
+}
+
+} /* namespace lol */
+
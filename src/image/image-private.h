@@ -13,6 +13,12 @@
 #pragma once
 
 #include <map>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#if LOL_FEATURE_THREADS
+#   include <thread>
+#endif
 
 //
 // The ImageCodecData class
@@ -70,5 +76,77 @@ public:
     PixelFormat m_format;
 };
 
+/* Run the same job on up to max_jobs threads of the shared pool, and
+ * wait for all of them to finish. The job is responsible for sharing work
+ * between threads, usually through an atomic counter; a thread that runs
+ * it again simply finds nothing left to do. Without thread support, or
+ * when only one job is requested, it is simply called once. */
+template<typename T>
+static inline void image_parallel_run(int max_jobs, T const &job)
+{
+    thread_pool &pool = thread_pool::shared();
+    pool.run(std::max(1, std::min(max_jobs, pool.size())), [&](int) { job(); });
+}
+
+/* Run an error diffusion over the whole image. In raster mode, rows are
+ * processed concurrently as a wavefront: row y may only process pixel x
+ * once row y - 1 has processed pixel x + lag - 1, where lag is the kernel
+ * width. This guarantees that no two threads touch the same pixel at the
+ * same time, and that each pixel receives its error contributions in the
+ * same order as in a sequential scan, so the output is bit-identical.
+ * Serpentine scans reverse every other row and cannot be pipelined, and
+ * small images are not worth spawning threads for.
+ * Progress is published every 16 pixels to limit cache line traffic. */
+template<typename F>
+static inline void ediff_scan(ivec2 size, int lag, ScanMode scan, F const &fn)
+{
+    if (scan == ScanMode::Serpentine || size.y < 2
+         || size.x * size.y < (1 << 16))
+    {
+        for (int y = 0; y < size.y; y++)
+        {
+            bool reverse = (y & 1) && (scan == ScanMode::Serpentine);
+            for (int x = 0; x < size.x; x++)
+                fn(x, y, reverse);
+        }
+        return;
+    }
+
+    std::unique_ptr<std::atomic<int>[]> progress(new std::atomic<int>[size.y]);
+    for (int y = 0; y < size.y; y++)
+        progress[y] = 0;
+    std::atomic<int> next_row(0);
+
+    image_parallel_run(size.y, [&]()
+    {
+        /* Rows are claimed in order, so the row above is always either
+         * finished or being processed by another running thread. */
+        for (int y = next_row++; y < size.y; y = next_row++)
+        {
+            int avail = y ? 0 : size.x;
+
+            for (int x = 0; x < size.x; x++)
+            {
+                int const needed = min(x + lag, size.x);
+                while (avail < needed)
+                {
+                    avail = progress[y - 1].load(std::memory_order_acquire);
+#if LOL_FEATURE_THREADS
+                    if (avail < needed)
+                        std::this_thread::yield();
+#endif
+                }
+
+                fn(x, y, false);
+
+                if (x % 16 == 15)
+                    progress[y].store(x + 1, std::memory_order_release);
+            }
+
+            progress[y].store(size.x, std::memory_order_release);
+        }
+    });
+}
+
 } /* namespace lol */
 
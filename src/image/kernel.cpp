@@ -12,6 +12,9 @@
 
 #include <lol/engine-internal.h>
 
+#include <algorithm>
+#include <cstdio>
+
 /*
  * Stock kernels
  */
@@ -77,95 +80,264 @@ array2d<float> image::kernel::halftone(ivec2 size)
     return normalize(ret);
 }
 
-array2d<float> image::kernel::blue_noise(ivec2 size, ivec2 gsize)
+/*
+ * Void-and-cluster blue noise. Energies are the toroidal convolution of
+ * the current dots with a Gaussian kernel, and a tournament tree over all
+ * texels tracks both the tightest cluster among the dots and the largest
+ * void among the empty texels, so that each step is O(log N) instead of a
+ * scan of the whole mask.
+ */
+
+class void_and_cluster
 {
-    float const epsilon = 1.f / (size.x * size.y + 1);
-    gsize = lol::min(size, gsize);
+public:
+    void_and_cluster(ivec2 size, ivec2 gsize)
+      : m_size(size),
+        m_gsize(gsize)
+    {
+        for (int j = 0; j < gsize.y; ++j)
+        for (int i = 0; i < gsize.x; ++i)
+        {
+            ivec2 const distance = gsize / 2 - ivec2(i, j);
+            m_kernel << lol::exp(-lol::sqlength(distance)
+                                   / (0.05f * gsize.x * gsize.y));
+        }
 
-    array2d<float> ret(size);
-    array2d<vec2> dots(size);
+        /* Wrapped coordinates of the taps around any texel, so that
+         * energy updates need no modulo */
+        for (int i = 0; i < size.x + gsize.x; ++i)
+            m_wrapx << (i - gsize.x / 2 + size.x) % size.x;
+        for (int j = 0; j < size.y + gsize.y; ++j)
+            m_wrapy << (j - gsize.y / 2 + size.y) % size.y;
+
+        int const count = size.x * size.y;
+        m_dots.resize(count, 0);
+        m_energy.resize(count, 0.f);
+
+        m_leaves = 1;
+        while (m_leaves < count)
+            m_leaves *= 2;
+        m_cluster.resize(2 * m_leaves, -1);
+        m_void.resize(2 * m_leaves, -1);
+    }
 
-    /* Create a small Gaussian kernel for filtering */
-    array2d<float> gaussian(gsize);
-    for (int j = 0; j < gsize.y; ++j)
-    for (int i = 0; i < gsize.x; ++i)
+    /* Replace all dots at once; energies are recomputed from scratch,
+     * with rows split across threads */
+    void reset(array<uint8_t> const &dots)
     {
-        ivec2 const distance = gsize / 2 - ivec2(i, j);
-        gaussian[i][j] = lol::exp(-lol::sqlength(distance)
-                                    / (0.05f * gsize.x * gsize.y));
+        m_dots = dots;
+
+        parallel_for_range(m_size.y, [&](ptrdiff_t begin, ptrdiff_t end)
+        {
+            for (int y = (int)begin; y < (int)end; ++y)
+            for (int x = 0; x < m_size.x; ++x)
+            {
+                /* The kernel is symmetric, so gathering is the same as
+                 * scattering from every dot */
+                float e = 0.f;
+                for (int j = 0; j < m_gsize.y; ++j)
+                {
+                    int const row = m_wrapy[y + j] * m_size.x;
+                    for (int i = 0; i < m_gsize.x; ++i)
+                        e += m_dots[row + m_wrapx[x + i]] * m_kernel[j * m_gsize.x + i];
+                }
+                m_energy[y * m_size.x + x] = e;
+                m_cluster[m_leaves + y * m_size.x + x] = m_dots[y * m_size.x + x] ? y * m_size.x + x : -1;
+                m_void[m_leaves + y * m_size.x + x] = m_dots[y * m_size.x + x] ? -1 : y * m_size.x + x;
+            }
+        });
+
+        rebuild();
     }
 
-    /* Helper function to find voids and clusters */
-    auto setdot = [&] (ivec2 pos, float val)
+    int tightest_cluster() const { return m_cluster[1]; }
+    int largest_void() const { return m_void[1]; }
+
+    void set(int n, bool dot)
     {
-        float const delta = val - dots[pos][0];
-        dots[pos][0] = val;
+        if (!m_dots[n] == !dot)
+            return;
 
-        for (int j = 0; j < gsize.y; ++j)
-        for (int i = 0; i < gsize.x; ++i)
-            dots[(pos.x + i - gsize.x / 2 + size.x) % size.x]
-                [(pos.y + j - gsize.y / 2 + size.y) % size.y]
-                [1] += gaussian[i][j] * delta;
-    };
+        m_dots[n] = dot;
+        m_cluster[m_leaves + n] = dot ? n : -1;
+        m_void[m_leaves + n] = dot ? -1 : n;
 
-    auto best = [&] (float val, float mul) -> ivec2
-    {
-        float maxval = -(float)(size.x * size.y);
-        ivec2 coord(0, 0);
-        for (int y = 0; y < size.y; ++y)
-        for (int x = 0; x < size.x; ++x)
+        float const delta = dot ? 1.f : -1.f;
+        int const x = n % m_size.x, y = n / m_size.x;
+        auto update = [&](ptrdiff_t begin, ptrdiff_t end)
+        {
+            for (int j = (int)begin; j < (int)end; ++j)
+            {
+                int const row = m_wrapy[y + j] * m_size.x;
+                float const *k = &m_kernel[j * m_gsize.x];
+                for (int i = 0; i < m_gsize.x; ++i)
+                    m_energy[row + m_wrapx[x + i]] += k[i] * delta;
+            }
+        };
+
+        /* Only kernels covering a large part of the mask are worth
+         * splitting across threads */
+        if (m_kernel.count() >= 4096)
+            parallel_for_range(m_gsize.y, update, 16);
+        else
+            update(0, m_gsize.y);
+
+        /* Refresh the tree above each row of updated texels; a row may
+         * wrap around and be split in two ranges */
+        int const x0 = m_wrapx[x], x1 = m_wrapx[x + m_gsize.x - 1];
+        m_ranges.clear();
+        for (int j = 0; j < m_gsize.y; ++j)
         {
-            if (dots[x][y][0] != val)
-                continue;
+            int const row = m_leaves + m_wrapy[y + j] * m_size.x;
+            if (x0 <= x1)
+                m_ranges << ivec2(row + x0, row + x1);
+            else
+                m_ranges << ivec2(row + x0, row + m_size.x - 1)
+                         << ivec2(row, row + x1);
+        }
+        refresh();
+    }
 
-            float total = dots[x][y][1];
-            if (total * mul > maxval)
+private:
+    /* Ties go to the lowest index, like a scan of the mask would */
+    inline void fix(int node)
+    {
+        int a = m_cluster[2 * node], b = m_cluster[2 * node + 1];
+        m_cluster[node] = a < 0 || (b >= 0 && m_energy[b] > m_energy[a]) ? b : a;
+        a = m_void[2 * node], b = m_void[2 * node + 1];
+        m_void[node] = a < 0 || (b >= 0 && m_energy[b] < m_energy[a]) ? b : a;
+    }
+
+    /* Fix the ancestors of all leaf ranges, one level at a time so that
+     * nodes shared by several ranges are only visited once */
+    void refresh()
+    {
+        std::sort(m_ranges.data(), m_ranges.data() + m_ranges.count(),
+                  [](ivec2 a, ivec2 b) { return a.x < b.x; });
+
+        while (m_ranges[0].x > 1)
+        {
+            int done = 0;
+            for (ivec2 &r : m_ranges)
             {
-                maxval = total * mul;
-                coord = ivec2(x, y);
+                r /= 2;
+                for (int node = lol::max(r.x, done + 1); node <= r.y; ++node)
+                    fix(node);
+                done = lol::max(done, r.y);
             }
         }
+    }
+
+    void rebuild()
+    {
+        for (int level = m_leaves / 2; level; level /= 2)
+            parallel_for_range(level, [&](ptrdiff_t begin, ptrdiff_t end)
+            {
+                for (ptrdiff_t node = begin; node < end; ++node)
+                    fix(level + (int)node);
+            }, 4096);
+    }
+
+    ivec2 m_size, m_gsize;
+    array<float> m_kernel, m_energy;
+    array<int> m_wrapx, m_wrapy, m_cluster, m_void;
+    array<ivec2> m_ranges;
+    array<uint8_t> m_dots;
+    int m_leaves;
+};
+
+array2d<float> image::kernel::blue_noise(ivec2 size, ivec2 gsize)
+{
+    int const count = size.x * size.y;
+    float const epsilon = 1.f / (count + 1);
+    gsize = lol::min(size, gsize);
 
-        return coord;
-    };
+    array2d<float> ret(size);
+    void_and_cluster pattern(size, gsize);
 
     /* Generate an array with about 10% random dots */
-    int const ndots = (size.x * size.y + 9) / 10;
-    memset((void *)dots.data(), 0, dots.bytes());
+    int const ndots = (count + 9) / 10;
+    array<uint8_t> dots;
+    dots.resize(count, 0);
     for (int n = 0; n < ndots; )
     {
-        ivec2 pos(lol::rand(size.x), lol::rand(size.y));
-        if (dots[pos][0])
+        int pos = lol::rand(size.x) + size.x * lol::rand(size.y);
+        if (dots[pos])
             continue;
-        setdot(ivec2(pos), 1.0f);
+        dots[pos] = 1;
         ++n;
     }
+    pattern.reset(dots);
 
     /* Rearrange 1s so that they occupy the largest voids */
     for (;;)
     {
-        ivec2 bestcluster = best(1.0f, 1.0f);
-        setdot(bestcluster, 0.0f);
-        ivec2 bestvoid = best(0.0f, -1.0f);
-        setdot(bestvoid, 1.0f);
+        int bestcluster = pattern.tightest_cluster();
+        pattern.set(bestcluster, false);
+        int bestvoid = pattern.largest_void();
+        pattern.set(bestvoid, true);
         if (bestcluster == bestvoid)
             break;
     }
 
-    /* Reorder all 1s and replace them with 0.0001 */
+    /* Rank all 1s by removing them from a copy of the pattern */
+    void_and_cluster ones = pattern;
     for (int n = ndots; n--; )
     {
-        ivec2 bestcluster = best(1.0f, 1.0f);
-        ret[bestcluster] = (n + 1.0f) * epsilon;
-        setdot(bestcluster, 0.0001f);
+        int bestcluster = ones.tightest_cluster();
+        ret.data()[bestcluster] = (n + 1.0f) * epsilon;
+        ones.set(bestcluster, false);
     }
 
-    /* Reorder all 0s and replace them with 0.0001 */
-    for (int n = ndots; n < size.x * size.y; ++n)
+    /* Rank all 0s by filling the largest voids */
+    for (int n = ndots; n < count; ++n)
     {
-        ivec2 bestvoid = best(0.0f, -1.0f);
-        ret[bestvoid] = (n + 1.0f) * epsilon;
-        setdot(bestvoid, 0.0001f);
+        int bestvoid = pattern.largest_void();
+        ret.data()[bestvoid] = (n + 1.0f) * epsilon;
+        pattern.set(bestvoid, true);
+    }
+
+    return ret;
+}
+
+array2d<float> image::kernel::blue_noise(ivec2 size, ivec2 gsize,
+                                         std::string const &cache)
+{
+    gsize = lol::min(size, gsize);
+
+    /* The file name holds all parameters; the header is only there to
+     * reject truncated or foreign files */
+    std::string path = cache + lol::format("/bluenoise1-%dx%d-%dx%d.bin",
+                                      size.x, size.y, gsize.x, gsize.y);
+    int32_t header[4] = { 0x314e4c42 /* “BLN1” */, size.x, size.y, (int32_t)sizeof(float) };
+
+    array2d<float> ret(size);
+    int64_t const bytes = ret.bytes();
+
+    File f;
+    f.Open(path, FileAccess::Read, true);
+    if (f.IsValid())
+    {
+        int32_t tmp[4];
+        bool ok = f.Read((uint8_t *)tmp, sizeof(tmp)) == (int64_t)sizeof(tmp)
+               && !memcmp(tmp, header, sizeof(header))
+               && f.Read((uint8_t *)ret.data(), bytes) == bytes;
+        f.Close();
+        if (ok)
+            return ret;
+    }
+
+    ret = blue_noise(size, gsize);
+
+    /* Write then rename, so that readers never see partial files */
+    f.Open(path + ".tmp", FileAccess::Write, true);
+    if (f.IsValid())
+    {
+        bool ok = f.Write(header, sizeof(header)) == (int64_t)sizeof(header)
+               && f.Write(ret.data(), (size_t)bytes) == bytes;
+        f.Close();
+        if (!ok || std::rename((path + ".tmp").c_str(), path.c_str()) != 0)
+            std::remove((path + ".tmp").c_str());
     }
 
     return ret;
@@ -215,53 +387,16 @@ array2d<float> image::kernel::ediff(EdiffAlgorithm algorithm)
 {
     switch (algorithm)
     {
-    case EdiffAlgorithm::FloydSteinberg:
-        return { {    0.f,     1.f,  7.f/16, },
-                 { 3.f/16,  5.f/16,  1.f/16, }, };
-
-    case EdiffAlgorithm::JaJuNi:
-        return { {    0.f,     0.f,     1.f,  7.f/48,  5.f/48, },
-                 { 3.f/48,  5.f/48,  7.f/48,  5.f/48,  3.f/48, },
-                 { 1.f/48,  3.f/48,  5.f/48,  3.f/48,  1.f/48, }, };
-
-    case EdiffAlgorithm::Atkinson:
-        return { {   0.f,    1.f,  1.f/8,  1.f/8, },
-                 { 1.f/8,  1.f/8,  1.f/8,    0.f, },
-                 {   0.f,  1.f/8,    0.f,    0.f, }, };
-
-    case EdiffAlgorithm::Fan:
-        return { {    0.f,     0.f,     1.f,  7.f/16, },
-                 { 1.f/16,  3.f/16,  5.f/16,     0.f, }, };
-
-    case EdiffAlgorithm::ShiauFan:
-        return { {   0.f,    0.f,    1.f,  1.f/2, },
-                 { 1.f/8,  1.f/8,  1.f/4,    0.f, }, };
-
-    case EdiffAlgorithm::ShiauFan2:
-        return { {    0.f,     0.f,    0.f,    1.f,  1.f/2, },
-                 { 1.f/16,  1.f/16,  1.f/8,  1.f/4,    0.f, }, };
-
-    case EdiffAlgorithm::Stucki:
-        return { {    0.f,     0.f,     1.f,  8.f/42,  4.f/42, },
-                 { 2.f/42,  4.f/42,  8.f/42,  4.f/42,  2.f/42, },
-                 { 1.f/42,  2.f/42,  4.f/42,  2.f/42,  1.f/42, }, };
-
-    case EdiffAlgorithm::Burkes:
-        return { {    0.f,     0.f,     1.f,  4.f/16,  2.f/16, },
-                 { 1.f/16,  2.f/16,  4.f/16,  2.f/16,  1.f/16, }, };
-
-    case EdiffAlgorithm::Sierra:
-        return { {    0.f,     0.f,     1.f,  5.f/32,  3.f/32, },
-                 { 2.f/32,  4.f/32,  5.f/32,  4.f/32,  2.f/32, },
-                 {    0.f,  2.f/32,  3.f/32,  2.f/32,     0.f, }, };
-
-    case EdiffAlgorithm::Sierra2:
-        return { {    0.f,     0.f,     1.f,  4.f/16,  3.f/16, },
-                 { 1.f/16,  2.f/16,  3.f/16,  2.f/16,  1.f/16, }, };
-
-    case EdiffAlgorithm::Lite:
-        return { {   0.f,    1.f,  1.f/2, },
-                 { 1.f/4,  1.f/4,    0.f, }, };
+#define _EDIFF(name, w, h, ...) \
+    case EdiffAlgorithm::name: \
+    { \
+        static float const data[] = { __VA_ARGS__ }; \
+        array2d<float> ret(ivec2(w, h)); \
+        memcpy(ret.data(), data, sizeof(data)); \
+        return ret; \
+    }
+#include "image/dither/ediff.inc"
+#undef _EDIFF
     }
 
     return { { 1.f } };
@@ -12,6 +12,12 @@
 
 #include <lol/engine-internal.h>
 
+#include <cstring>
+#include <map>
+#if LOL_FEATURE_THREADS
+#   include <thread>
+#endif
+
 #if LOL_USE_FFMPEG
 extern "C"
 {
@@ -45,13 +51,200 @@ static std::string error2string(int errnum)
 }*/
 #endif
 
-movie::movie(ivec2 size)
+// Ordered dithering to 3:3:2, using lookup tables that give the
+// already shifted component bits for each of the 16 Bayer thresholds.
+static struct dither_332
+{
+    dither_332()
+    {
+        static int const bayer[16] =
+            { 0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5 };
+
+        for (int i = 0; i < 16; ++i)
+            for (int v = 0; v < 256; ++v)
+            {
+                float t = (bayer[i] + 0.5f) / 16.f;
+                r[i][v] = (uint8_t)(min(7, (int)(v * 7 / 255.f + t)) << 5);
+                g[i][v] = (uint8_t)(min(7, (int)(v * 7 / 255.f + t)) << 2);
+                b[i][v] = (uint8_t)(min(3, (int)(v * 3 / 255.f + t)));
+            }
+    }
+
+    void convert(u8vec4 const *src, uint8_t *dst, ivec2 size,
+                 bool bottom_up) const
+    {
+        for (int y = 0; y < size.y; ++y)
+        {
+            u8vec4 const *line = src + (bottom_up ? size.y - 1 - y : y) * size.x;
+            uint8_t const (*row_r)[256] = r + (y & 3) * 4;
+            uint8_t const (*row_g)[256] = g + (y & 3) * 4;
+            uint8_t const (*row_b)[256] = b + (y & 3) * 4;
+
+            int x = 0;
+            for ( ; x + 4 <= size.x; x += 4, dst += 4)
+                for (int i = 0; i < 4; ++i)
+                    dst[i] = row_r[i][line[x + i].r] | row_g[i][line[x + i].g]
+                           | row_b[i][line[x + i].b];
+            for (int i = 0; x < size.x; ++x, ++i)
+                *dst++ = row_r[i][line[x].r] | row_g[i][line[x].g]
+                       | row_b[i][line[x].b];
+        }
+    }
+
+    uint8_t r[16][256], g[16][256], b[16][256];
+}
+const g_dither_332;
+
+//
+// The frame pipeline: frames go from the free list to the conversion
+// queue, where worker threads turn them into 3:3:2 pixels, then to the
+// encoder thread, which restores their submission order, encodes them
+// and puts them back in the free list.
+//
+
+class movie_pipeline
+{
+public:
+    movie_pipeline(movie &m)
+      : m_movie(m),
+        m_failed(false)
+    {
+        int jobs = 1;
+#if LOL_FEATURE_THREADS
+        jobs = clamp((int)std::thread::hardware_concurrency() - 2, 1, 4);
+#endif
+
+        // One frame per worker, plus one being filled, one waiting for
+        // conversion and one being encoded
+        m_frames.resize(jobs + 3);
+        for (int i = 0; i < m_frames.count(); ++i)
+        {
+            m_frames[i].m_rgba.resize(m.m_size.x * m.m_size.y);
+            m_frames[i].m_pixels.resize(m.m_size.x * m.m_size.y);
+            m_free.push(i);
+        }
+
+#if LOL_FEATURE_THREADS
+        for (int n = 0; n < jobs; ++n)
+            m_workers.push(new thread([this](thread *)
+            {
+                for (int slot = m_convert.pop(); slot >= 0; slot = m_convert.pop())
+                {
+                    convert(slot);
+                    m_encode.push(slot);
+                }
+            }));
+
+        m_encoder = new thread([this](thread *)
+        {
+            std::map<int, int> pending;
+            int next = 0;
+
+            for (int slot = m_encode.pop(); slot >= 0; slot = m_encode.pop())
+            {
+                pending[m_frames[slot].m_sequence] = slot;
+                for (auto it = pending.find(next); it != pending.end();
+                     it = pending.find(++next))
+                {
+                    encode(it->second);
+                    m_free.push(it->second);
+                    pending.erase(it);
+                }
+            }
+        });
+#endif
+    }
+
+    // Wait for all submitted frames to be encoded
+    ~movie_pipeline()
+    {
+#if LOL_FEATURE_THREADS
+        for (int n = 0; n < m_workers.count(); ++n)
+            m_convert.push(-1);
+        for (thread *t : m_workers)
+            delete t; // This joins the thread
+        m_encode.push(-1);
+        delete m_encoder;
+#endif
+    }
+
+    u8vec4 *acquire(bool wait)
+    {
+        int slot;
+        if (wait)
+            slot = m_free.pop();
+        else if (!m_free.try_pop(slot))
+            return nullptr;
+        return m_frames[slot].m_rgba.data();
+    }
+
+    void submit(u8vec4 *data, bool bottom_up)
+    {
+        int slot = 0;
+        while (m_frames[slot].m_rgba.data() != data)
+            ++slot;
+
+        m_frames[slot].m_sequence = m_sequence++;
+        m_frames[slot].m_bottom_up = bottom_up;
+
+#if LOL_FEATURE_THREADS
+        m_convert.push(slot);
+#else
+        convert(slot);
+        encode(slot);
+        m_free.push(slot);
+#endif
+    }
+
+    bool failed() const { return m_failed; }
+
+private:
+    void convert(int slot)
+    {
+        frame &f = m_frames[slot];
+        g_dither_332.convert(f.m_rgba.data(), f.m_pixels.data(),
+                             m_movie.m_size, f.m_bottom_up);
+    }
+
+    void encode(int slot)
+    {
+        if (!m_failed && !m_movie.encode(m_frames[slot].m_pixels.data()))
+            m_failed = true;
+    }
+
+    struct frame
+    {
+        array<u8vec4> m_rgba;
+        array<uint8_t> m_pixels;
+        int m_sequence;
+        bool m_bottom_up;
+    };
+
+    static int const MAX_FRAMES = 8;
+
+    movie &m_movie;
+    array<frame> m_frames;
+    int m_sequence = 0;
+    std::atomic<bool> m_failed;
+
+    queue<int, MAX_FRAMES> m_free, m_convert, m_encode;
+#if LOL_FEATURE_THREADS
+    array<thread *> m_workers;
+    thread *m_encoder;
+#endif
+};
+
+movie::movie(ivec2 size, int fps)
   : m_avformat(nullptr),
     m_avcodec(nullptr),
     m_stream(nullptr),
     m_frame(nullptr),
     m_size(size),
-    m_index(0)
+    m_fps(fps),
+    m_index(0),
+    m_pipeline(nullptr),
+    m_closed(false),
+    m_dropped(0)
 {
 #if LOL_USE_FFMPEG
     m_frame = av_frame_alloc();
@@ -66,6 +259,11 @@ movie::movie(ivec2 size)
 #endif
 }
 
+movie::~movie()
+{
+    close();
+}
+
 bool movie::open_file(std::string const &filename)
 {
 #if LOL_USE_FFMPEG
@@ -104,18 +302,56 @@ bool movie::open_file(std::string const &filename)
 }
 
 bool movie::push_image(image &im)
+{
+    ASSERT(im.size() == m_size);
+
+    u8vec4 *frame = acquire_frame(true);
+    if (!frame)
+        return false;
+
+    u8vec4 const *data = im.lock<PixelFormat::RGBA_8>();
+    memcpy((void *)frame, data, m_size.x * m_size.y * sizeof(u8vec4));
+    im.unlock(data);
+
+    submit_frame(frame);
+    return !m_pipeline->failed();
+}
+
+u8vec4 *movie::acquire_frame(bool wait)
+{
+    if (m_closed)
+        return nullptr;
+
+    if (!m_pipeline)
+        m_pipeline = new movie_pipeline(*this);
+
+    u8vec4 *frame = m_pipeline->acquire(wait);
+    if (!frame)
+        ++m_dropped;
+    return frame;
+}
+
+void movie::submit_frame(u8vec4 *frame, bool bottom_up)
+{
+    ASSERT(m_pipeline);
+    m_pipeline->submit(frame, bottom_up);
+}
+
+// Called from the encoder thread only
+bool movie::encode(uint8_t const *pixels)
 {
 #if LOL_USE_FFMPEG
+    if (!m_avcodec)
+        return true;
+
     // Make sure the encoder does not hold a reference on our
     // frame (GIF does that in order to compress using deltas).
     if (av_frame_make_writable(m_frame) < 0)
         return false;
 
-    // Convert image to 3:3:2. TODO: add some dithering
-    u8vec3 *data = im.lock<PixelFormat::RGB_8>();
-    for (int n = 0; n < im.size().x * im.size().y; ++n)
-        m_frame->data[0][n] = (data[n].r & 0xe0) | ((data[n].g & 0xe0) >> 3) | (data[n].b >> 6);
-    im.unlock(data);
+    for (int y = 0; y < m_size.y; ++y)
+        memcpy(m_frame->data[0] + y * m_frame->linesize[0],
+               pixels + y * m_size.x, m_size.x);
 
     m_frame->pts = m_index++;
 
@@ -150,7 +386,7 @@ bool movie::push_image(image &im)
         }
     }
 #else
-    UNUSED(im);
+    UNUSED(pixels);
 #endif
 
     return true;
@@ -158,17 +394,27 @@ bool movie::push_image(image &im)
 
 void movie::close()
 {
+    // Encode all pending frames first
+    delete m_pipeline;
+    m_pipeline = nullptr;
+    m_closed = true;
+
 #if LOL_USE_FFMPEG
-    // this must be done before m_avcodec is freed
-    av_write_trailer(m_avformat);
+    if (m_avformat)
+    {
+        // this must be done before m_avcodec is freed
+        av_write_trailer(m_avformat);
 
-    avcodec_free_context(&m_avcodec);
-    av_frame_free(&m_frame);
+        avcodec_free_context(&m_avcodec);
 
-    if (!(m_avformat->oformat->flags & AVFMT_NOFILE))
-        avio_closep(&m_avformat->pb);
+        if (!(m_avformat->oformat->flags & AVFMT_NOFILE))
+            avio_closep(&m_avformat->pb);
 
-    avformat_free_context(m_avformat);
+        avformat_free_context(m_avformat);
+        m_avformat = nullptr;
+    }
+
+    av_frame_free(&m_frame);
 #endif
 }
 
@@ -189,7 +435,7 @@ bool movie::open_codec()
         return false;
     }
     m_stream->id = 0; // first (and only?) stream
-    m_stream->time_base = AVRational{ 1, 30 }; // 30 fps
+    m_stream->time_base = AVRational{ 1, m_fps };
 
     m_avcodec = avcodec_alloc_context3(codec);
     if (!m_avcodec)
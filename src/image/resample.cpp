@@ -1,7 +1,7 @@
 //
 //  Lol Engine
 //
-//  Copyright © 2004—2017 Sam Hocevar <sam@hocevar.net>
+//  Copyright © 2004—2019 Sam Hocevar <sam@hocevar.net>
 //
 //  Lol Engine is free software. It comes without any warranty, to
 //  the extent permitted by applicable law. You can redistribute it
@@ -12,6 +12,13 @@
 
 #include <lol/engine-internal.h>
 
+#include <cstring>
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define LOL_RESAMPLE_SSE2 1
+#endif
+
 /*
  * Image resizing functions
  */
@@ -21,6 +28,7 @@ namespace lol
 
 static image ResizeBicubic(image &src, ivec2 size);
 static image ResizeBresenham(image &src, ivec2 size);
+static image ResizeSeparable(image &src, ivec2 size, ResampleAlgorithm algorithm);
 
 image image::Resize(ivec2 size, ResampleAlgorithm algorithm)
 {
@@ -28,6 +36,11 @@ image image::Resize(ivec2 size, ResampleAlgorithm algorithm)
     {
         case ResampleAlgorithm::Bicubic:
             return ResizeBicubic(*this, size);
+        case ResampleAlgorithm::Box:
+        case ResampleAlgorithm::Mitchell:
+        case ResampleAlgorithm::CatmullRom:
+        case ResampleAlgorithm::Lanczos3:
+            return ResizeSeparable(*this, size, algorithm);
         case ResampleAlgorithm::Bresenham:
         default:
             return ResizeBresenham(*this, size);
@@ -206,5 +219,495 @@ static image ResizeBresenham(image &src, ivec2 size)
     return dst;
 }
 
+/* Separable resampling. Each destination pixel is a weighted sum of a
+ * few source pixels; the weights only depend on the destination column
+ * or row, so they are computed once for each. The image is filtered
+ * horizontally, then vertically, in its own pixel format: 8-bit images
+ * use 14-bit fixed point weights, float images use float weights.
+ *
+ * The intermediate image is not clamped, just like in float: 8-bit
+ * images keep it in signed 16-bit with 6 fractional bits, which leaves
+ * room for the overshoot of the sharper filters. */
+
+static int const RESAMPLE_BITS = 14;
+static int const RESAMPLE_TMP_BITS = 6;
+static int const RESAMPLE_ROW_SHIFT = RESAMPLE_BITS - RESAMPLE_TMP_BITS;
+static int const RESAMPLE_COLUMN_SHIFT = RESAMPLE_BITS + RESAMPLE_TMP_BITS;
+
+static float filter_support(ResampleAlgorithm algorithm)
+{
+    switch (algorithm)
+    {
+        case ResampleAlgorithm::Box:
+            return .5f;
+        case ResampleAlgorithm::Lanczos3:
+            return 3.f;
+        default:
+            return 2.f;
+    }
+}
+
+static float filter_value(ResampleAlgorithm algorithm, float x)
+{
+    x = lol::abs(x);
+
+    switch (algorithm)
+    {
+        case ResampleAlgorithm::Box:
+            return x < .5f ? 1.f : 0.f;
+
+        case ResampleAlgorithm::Lanczos3:
+        {
+            if (x < 1e-6f)
+                return 1.f;
+            if (x >= 3.f)
+                return 0.f;
+            float const px = F_PI * x;
+            return 3.f * lol::sin(px) * lol::sin(px / 3.f) / (px * px);
+        }
+
+        default:
+        {
+            /* Mitchell-Netravali cubic filters: Mitchell is B = C = 1/3,
+             * Catmull-Rom is B = 0, C = 1/2 */
+            bool const mitchell = algorithm == ResampleAlgorithm::Mitchell;
+            float const b = mitchell ? 1.f / 3 : 0.f;
+            float const c = mitchell ? 1.f / 3 : .5f;
+            if (x < 1.f)
+                return ((12.f - 9.f * b - 6.f * c) * x * x * x
+                         + (-18.f + 12.f * b + 6.f * c) * x * x
+                         + (6.f - 2.f * b)) / 6.f;
+            if (x < 2.f)
+                return ((-b - 6.f * c) * x * x * x
+                         + (6.f * b + 30.f * c) * x * x
+                         + (-12.f * b - 48.f * c) * x
+                         + (8.f * b + 24.f * c)) / 6.f;
+            return 0.f;
+        }
+    }
+}
+
+/* The weights for every destination pixel along one axis. Destination
+ * pixel i reads taps source pixels starting at first[i]; pixels past
+ * the edges are clamped, so their weights go to the edge pixels. */
+struct resample_table
+{
+    resample_table(int src_size, int dst_size, ResampleAlgorithm algorithm)
+    {
+        /* When shrinking, stretch the filter to cover all source pixels */
+        float const scale = (float)src_size / dst_size;
+        float const stretch = lol::max(scale, 1.f);
+        float const support = filter_support(algorithm) * stretch;
+
+        taps = lol::min(src_size, (int)lol::ceil(2.f * support) + 1);
+        first.resize(dst_size);
+        weights.resize(dst_size * taps, 0.f);
+        fixed.resize(dst_size * taps, (int16_t)0);
+
+        for (int i = 0; i < dst_size; ++i)
+        {
+            float const center = (i + .5f) * scale - .5f;
+            int const lo = (int)lol::floor(center - support) + 1;
+            int const hi = (int)lol::floor(center + support);
+            first[i] = lol::clamp(lo, 0, src_size - taps);
+
+            float *w = &weights[i * taps];
+            float sum = 0.f;
+            for (int j = lo; j <= hi; ++j)
+            {
+                float const val = filter_value(algorithm, (j - center) / stretch);
+                w[lol::clamp(j, 0, src_size - 1) - first[i]] += val;
+                sum += val;
+            }
+
+            /* A box filter may miss every pixel; use the nearest one */
+            if (sum == 0.f)
+            {
+                w[lol::clamp((int)lol::round(center), 0, src_size - 1) - first[i]] = 1.f;
+                sum = 1.f;
+            }
+
+            /* Normalise, then make the fixed point weights sum to one
+             * exactly by fixing the largest one */
+            int16_t *fw = &fixed[i * taps];
+            int fixed_sum = 0, largest = 0;
+            for (int k = 0; k < taps; ++k)
+            {
+                w[k] /= sum;
+                fw[k] = (int16_t)lol::round(w[k] * (1 << RESAMPLE_BITS));
+                fixed_sum += fw[k];
+                if (lol::abs(w[k]) > lol::abs(w[largest]))
+                    largest = k;
+            }
+            fw[largest] += (int16_t)((1 << RESAMPLE_BITS) - fixed_sum);
+        }
+    }
+
+    int taps;
+    array<int> first;
+    array<float> weights;
+    array<int16_t> fixed;
+};
+
+#if LOL_RESAMPLE_SSE2
+/* Two 16-bit weights in each 32-bit lane, for _mm_madd_epi16() */
+static inline __m128i weight_pair(int16_t w0, int16_t w1)
+{
+    return _mm_set1_epi32((int)((uint32_t)(uint16_t)w0 | ((uint32_t)(uint16_t)w1 << 16)));
+}
+#endif
+
+/* Horizontal pass: filter one row of src into one row of dst */
+static void resample_row(float const *src, float *dst, int channels,
+                         resample_table const &t)
+{
+    int const count = t.first.count();
+
+#if LOL_RESAMPLE_SSE2
+    if (channels == 4)
+    {
+        for (int x = 0; x < count; ++x)
+        {
+            float const *w = &t.weights[x * t.taps];
+            float const *s = src + t.first[x] * 4;
+            __m128 acc = _mm_setzero_ps();
+            for (int k = 0; k < t.taps; ++k)
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[k]),
+                                                 _mm_loadu_ps(s + k * 4)));
+            _mm_storeu_ps(dst + x * 4, acc);
+        }
+        return;
+    }
+#endif
+
+    for (int x = 0; x < count; ++x)
+    {
+        float const *w = &t.weights[x * t.taps];
+        float const *s = src + t.first[x] * channels;
+        for (int c = 0; c < channels; ++c)
+        {
+            float acc = 0.f;
+            for (int k = 0; k < t.taps; ++k)
+                acc += w[k] * s[k * channels + c];
+            dst[x * channels + c] = acc;
+        }
+    }
+}
+
+static void resample_row(uint8_t const *src, int16_t *dst, int channels,
+                         resample_table const &t)
+{
+    int const count = t.first.count();
+
+#if LOL_RESAMPLE_SSE2
+    if (channels == 4)
+    {
+        __m128i const zero = _mm_setzero_si128();
+        for (int x = 0; x < count; ++x)
+        {
+            int16_t const *w = &t.fixed[x * t.taps];
+            uint8_t const *s = src + t.first[x] * 4;
+            __m128i acc = _mm_set1_epi32(1 << (RESAMPLE_ROW_SHIFT - 1));
+
+            /* Two pixels at a time, with their channels interleaved as
+             * r0 r1 g0 g1 b0 b1 a0 a1 */
+            int k = 0;
+            for ( ; k + 1 < t.taps; k += 2)
+            {
+                __m128i p = _mm_loadl_epi64((__m128i const *)(s + k * 4));
+                p = _mm_unpacklo_epi8(p, _mm_srli_si128(p, 4));
+                p = _mm_unpacklo_epi8(p, zero);
+                acc = _mm_add_epi32(acc, _mm_madd_epi16(p, weight_pair(w[k], w[k + 1])));
+            }
+
+            if (k < t.taps)
+            {
+                int32_t last;
+                memcpy(&last, s + k * 4, 4);
+                __m128i p = _mm_unpacklo_epi8(_mm_cvtsi32_si128(last), zero);
+                p = _mm_unpacklo_epi16(p, zero);
+                acc = _mm_add_epi32(acc, _mm_madd_epi16(p, weight_pair(w[k], 0)));
+            }
+
+            acc = _mm_srai_epi32(acc, RESAMPLE_ROW_SHIFT);
+            _mm_storel_epi64((__m128i *)(dst + x * 4), _mm_packs_epi32(acc, acc));
+        }
+        return;
+    }
+#endif
+
+    for (int x = 0; x < count; ++x)
+    {
+        int16_t const *w = &t.fixed[x * t.taps];
+        uint8_t const *s = src + t.first[x] * channels;
+        for (int c = 0; c < channels; ++c)
+        {
+            int acc = 1 << (RESAMPLE_ROW_SHIFT - 1);
+            for (int k = 0; k < t.taps; ++k)
+                acc += w[k] * s[k * channels + c];
+            dst[x * channels + c] = (int16_t)lol::clamp(acc >> RESAMPLE_ROW_SHIFT,
+                                                        INT16_MIN, INT16_MAX);
+        }
+    }
+}
+
+/* Vertical pass: combine taps rows of src, pitch elements apart, into
+ * one row of count elements */
+static void resample_column(float const *src, ptrdiff_t pitch, int taps,
+                            float const *w, int16_t const *, float *dst, int count)
+{
+    int i = 0;
+
+#if LOL_RESAMPLE_SSE2
+    __m128 const zero = _mm_setzero_ps(), one = _mm_set1_ps(1.f);
+    for ( ; i + 4 <= count; i += 4)
+    {
+        __m128 acc = _mm_setzero_ps();
+        for (int k = 0; k < taps; ++k)
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[k]),
+                                             _mm_loadu_ps(src + k * pitch + i)));
+        _mm_storeu_ps(dst + i, _mm_min_ps(_mm_max_ps(acc, zero), one));
+    }
+#endif
+
+    for ( ; i < count; ++i)
+    {
+        float acc = 0.f;
+        for (int k = 0; k < taps; ++k)
+            acc += w[k] * src[k * pitch + i];
+        dst[i] = lol::clamp(acc, 0.f, 1.f);
+    }
+}
+
+static void resample_column(int16_t const *src, ptrdiff_t pitch, int taps,
+                            float const *, int16_t const *w, uint8_t *dst, int count)
+{
+    int i = 0;
+
+#if LOL_RESAMPLE_SSE2
+    __m128i const zero = _mm_setzero_si128();
+    for ( ; i + 16 <= count; i += 16)
+    {
+        __m128i acc[4];
+        for (auto &a : acc)
+            a = _mm_set1_epi32(1 << (RESAMPLE_COLUMN_SHIFT - 1));
+
+        /* Two rows at a time, interleaved so that each 32-bit lane of
+         * _mm_madd_epi16() gets the same pixel from both rows */
+        int k = 0;
+        for ( ; k + 1 < taps; k += 2)
+        {
+            __m128i const wk = weight_pair(w[k], w[k + 1]);
+            for (int j = 0; j < 2; ++j)
+            {
+                __m128i const a = _mm_loadu_si128((__m128i const *)(src + k * pitch + i + j * 8));
+                __m128i const b = _mm_loadu_si128((__m128i const *)(src + (k + 1) * pitch + i + j * 8));
+                acc[2 * j] = _mm_add_epi32(acc[2 * j], _mm_madd_epi16(_mm_unpacklo_epi16(a, b), wk));
+                acc[2 * j + 1] = _mm_add_epi32(acc[2 * j + 1], _mm_madd_epi16(_mm_unpackhi_epi16(a, b), wk));
+            }
+        }
+
+        if (k < taps)
+        {
+            __m128i const wk = weight_pair(w[k], 0);
+            for (int j = 0; j < 2; ++j)
+            {
+                __m128i const a = _mm_loadu_si128((__m128i const *)(src + k * pitch + i + j * 8));
+                acc[2 * j] = _mm_add_epi32(acc[2 * j], _mm_madd_epi16(_mm_unpacklo_epi16(a, zero), wk));
+                acc[2 * j + 1] = _mm_add_epi32(acc[2 * j + 1], _mm_madd_epi16(_mm_unpackhi_epi16(a, zero), wk));
+            }
+        }
+
+        for (auto &a : acc)
+            a = _mm_srai_epi32(a, RESAMPLE_COLUMN_SHIFT);
+        __m128i const ret = _mm_packus_epi16(_mm_packs_epi32(acc[0], acc[1]),
+                                             _mm_packs_epi32(acc[2], acc[3]));
+        _mm_storeu_si128((__m128i *)(dst + i), ret);
+    }
+#endif
+
+    for ( ; i < count; ++i)
+    {
+        int acc = 1 << (RESAMPLE_COLUMN_SHIFT - 1);
+        for (int k = 0; k < taps; ++k)
+            acc += w[k] * src[k * pitch + i];
+        dst[i] = (uint8_t)lol::clamp(acc >> RESAMPLE_COLUMN_SHIFT, 0, 255);
+    }
+}
+
+/* Resample an image of T scalars with the given number of channels,
+ * through an intermediate image of TMP scalars; both passes process
+ * rows in parallel. */
+template<typename T, typename TMP>
+static void resample(T const *src, ivec2 src_size, T *dst, ivec2 dst_size,
+                     int channels, ResampleAlgorithm algorithm)
+{
+    resample_table const tx(src_size.x, dst_size.x, algorithm);
+    resample_table const ty(src_size.y, dst_size.y, algorithm);
+    ptrdiff_t const src_pitch = src_size.x * channels;
+    ptrdiff_t const pitch = dst_size.x * channels;
+
+    array<TMP> tmp;
+    tmp.resize(pitch * src_size.y);
+
+    parallel_for(src_size.y, [&](ptrdiff_t y)
+    {
+        resample_row(src + y * src_pitch, tmp.data() + y * pitch, channels, tx);
+    });
+
+    parallel_for(dst_size.y, [&](ptrdiff_t y)
+    {
+        resample_column(tmp.data() + ty.first[y] * pitch, pitch, ty.taps,
+                        &ty.weights[y * ty.taps], &ty.fixed[y * ty.taps],
+                        dst + y * pitch, (int)pitch);
+    });
+}
+
+template<PixelFormat F, typename T, typename TMP>
+static void resample_image(image &src, image &dst, ResampleAlgorithm algorithm)
+{
+    typedef typename PixelType<F>::type pixel;
+    int const channels = (int)(sizeof(pixel) / sizeof(T));
+
+    pixel const *srcp = src.lock<F>();
+    pixel *dstp = dst.lock<F>();
+
+    resample<T, TMP>((T const *)srcp, src.size(), (T *)dstp, dst.size(), channels, algorithm);
+
+    dst.unlock(dstp);
+    src.unlock(srcp);
+}
+
+static image ResizeSeparable(image &src, ivec2 size, ResampleAlgorithm algorithm)
+{
+    image dst(size);
+    if (size.x <= 0 || size.y <= 0 || src.size().x <= 0 || src.size().y <= 0)
+        return dst;
+
+    /* Work in the source format, to avoid any conversion */
+    switch (src.format())
+    {
+        case PixelFormat::Y_8:
+            resample_image<PixelFormat::Y_8, uint8_t, int16_t>(src, dst, algorithm);
+            break;
+        case PixelFormat::RGB_8:
+            resample_image<PixelFormat::RGB_8, uint8_t, int16_t>(src, dst, algorithm);
+            break;
+        case PixelFormat::RGBA_8:
+            resample_image<PixelFormat::RGBA_8, uint8_t, int16_t>(src, dst, algorithm);
+            break;
+        case PixelFormat::Y_F32:
+            resample_image<PixelFormat::Y_F32, float, float>(src, dst, algorithm);
+            break;
+        case PixelFormat::RGB_F32:
+            resample_image<PixelFormat::RGB_F32, float, float>(src, dst, algorithm);
+            break;
+        case PixelFormat::RGBA_F32:
+        default:
+            resample_image<PixelFormat::RGBA_F32, float, float>(src, dst, algorithm);
+            break;
+    }
+
+    return dst;
+}
+
+/* Mipmap reduction. Both filters halve the image separably, the box
+ * filter over 2 pixels and the Kaiser-windowed sinc over 8 pixels, with
+ * coordinates clamped to the edges. */
+
+static float bessel_i0(float x)
+{
+    float sum = 1.f, term = 1.f;
+    for (int k = 1; k < 16; ++k)
+    {
+        term *= (x * x) / (4.f * k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+static void mipmap_weights(MipmapFilter filter, array<float> &weights)
+{
+    if (filter == MipmapFilter::Box)
+    {
+        weights << .5f << .5f;
+        return;
+    }
+
+    /* Source pixels sit at ±0.5, ±1.5… from the destination pixel
+     * centre; cut off at half the source frequency */
+    float const beta = 4.f, radius = 4.f;
+    float sum = 0.f;
+    for (int i = 0; i < 8; ++i)
+    {
+        float d = i - 3.5f;
+        float t = d / radius;
+        float w = bessel_i0(beta * lol::sqrt(lol::max(0.f, 1.f - t * t)))
+                / bessel_i0(beta);
+        float x = F_PI * d * .5f;
+        weights << w * lol::sin(x) / x;
+        sum += weights.last();
+    }
+    for (auto &w : weights)
+        w /= sum;
+}
+
+image image::mipmap(MipmapFilter filter) const
+{
+    ivec2 const oldsize = size();
+    ivec2 const newsize = lol::max(ivec2(1), (oldsize + ivec2(1)) / 2);
+
+    array<float> weights;
+    mipmap_weights(filter, weights);
+    int const taps = weights.count();
+
+    image src(*this);
+    image dst(newsize);
+    vec4 const *srcp = src.lock<PixelFormat::RGBA_F32>();
+    vec4 *dstp = dst.lock<PixelFormat::RGBA_F32>();
+
+    /* Horizontal pass into a temporary buffer, then vertical pass */
+    array<vec4> tmp;
+    tmp.resize(newsize.x * oldsize.y);
+
+    for (int y = 0; y < oldsize.y; ++y)
+    {
+        vec4 const *line = srcp + y * oldsize.x;
+        for (int x = 0; x < newsize.x; ++x)
+        {
+            vec4 acc(0.f);
+            for (int i = 0; i < taps; ++i)
+            {
+                int x0 = lol::clamp(2 * x + i - taps / 2 + 1, 0, oldsize.x - 1);
+                acc += weights[i] * line[x0];
+            }
+            tmp[y * newsize.x + x] = acc;
+        }
+    }
+
+    for (int y = 0; y < newsize.y; ++y)
+    {
+        for (int x = 0; x < newsize.x; ++x)
+        {
+            vec4 acc(0.f);
+            for (int i = 0; i < taps; ++i)
+            {
+                int y0 = lol::clamp(2 * y + i - taps / 2 + 1, 0, oldsize.y - 1);
+                acc += weights[i] * tmp[y0 * newsize.x + x];
+            }
+            dstp[y * newsize.x + x] = lol::clamp(acc, 0.f, 1.f);
+        }
+    }
+
+    dst.unlock(dstp);
+    src.unlock(srcp);
+
+    /* Keep the source pixel format */
+    if (format() != PixelFormat::Unknown)
+        dst.set_format(format());
+
+    return dst;
+}
+
 } /* namespace lol */
 
@@ -26,6 +26,17 @@ namespace lol
     public:
         virtual std::string GetName() { return "<ResourceCodec>"; }
         virtual ResourceCodecData* Load(std::string const &path) = 0;
+
+        /* The contents of the file at path, mapped in memory if possible
+         * or empty otherwise. Codecs that can parse memory directly should
+         * override this instead of opening the file again. */
+        virtual ResourceCodecData* Load(std::string const &path,
+                                        span<uint8_t const> data)
+        {
+            UNUSED(data);
+            return Load(path);
+        }
+
         virtual bool Save(std::string const &path, ResourceCodecData* data) = 0;
 
         /* TODO: this should become more fine-grained */
@@ -81,11 +81,22 @@ g_resource_loader;
 
 ResourceCodecData* ResourceLoader::Load(std::string const &path)
 {
+    /* Look the file up once, in mounted packs or in the data directories,
+     * and map it for all the codecs that can use it */
+    File file;
+    for (auto const &candidate : sys::get_path_list(path))
+    {
+        file.Open(candidate, FileAccess::Read, true);
+        if (file.IsValid())
+            break;
+    }
+    span<uint8_t const> contents = file.Map(FileHint::Sequential);
+
     ResourceCodec* last_codec = nullptr;
     for (auto codec : g_resource_loader.m_codecs)
     {
         last_codec = codec;
-        auto data = codec->Load(path);
+        auto data = codec->Load(path, contents);
         if (data != nullptr)
         {
             msg::debug("image::load: codec %s succesfully loaded %s.\n",
@@ -13,4 +13,5 @@
 #include <lol/algorithm/sort.h>
 #include <lol/algorithm/aabb_tree.h>
 #include <lol/algorithm/portal.h>
+#include <lol/algorithm/parallel.h>
 
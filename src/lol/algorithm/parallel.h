@@ -0,0 +1,234 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// Parallel algorithms
+// -------------------
+//
+// Data-parallel loops, reductions, scans, sorts and transforms that run
+// on the shared thread pool. Work is split into chunks of “grain” items;
+// a grain of 0 picks one automatically. Chunk results are always
+// combined in order, and in deterministic mode the chunks do not depend
+// on the number of threads, so results are reproducible.
+//
+
+#include <lol/base/array.h>
+#include <lol/math/arraynd.h>
+#include <lol/sys/thread.h>
+
+#include <algorithm>
+#include <functional>
+
+namespace lol
+{
+
+/* Number of chunks to split count items into */
+static inline ptrdiff_t parallel_chunks(ptrdiff_t count, ptrdiff_t grain)
+{
+    if (count <= 0)
+        return 0;
+
+    if (grain <= 0)
+    {
+        thread_pool &pool = thread_pool::shared();
+        ptrdiff_t chunks = pool.deterministic() ? 64 : 8 * pool.size();
+        grain = (count + chunks - 1) / chunks;
+    }
+
+    return (count + grain - 1) / grain;
+}
+
+/* Call f(begin, end) for consecutive ranges covering [0, count) */
+template<typename F>
+void parallel_for_range(ptrdiff_t count, F const &f, ptrdiff_t grain = 0)
+{
+    ptrdiff_t const chunks = parallel_chunks(count, grain);
+    thread_pool::shared().run((int)chunks, [&](int n)
+    {
+        f(count * n / chunks, count * (n + 1) / chunks);
+    });
+}
+
+/* Call f(i) for every i in [0, count) */
+template<typename F>
+void parallel_for(ptrdiff_t count, F const &f, ptrdiff_t grain = 0)
+{
+    parallel_for_range(count, [&](ptrdiff_t begin, ptrdiff_t end)
+    {
+        for (ptrdiff_t i = begin; i < end; ++i)
+            f(i);
+    }, grain);
+}
+
+/* Call f(lo, hi) for every tile of a 2D or 3D domain; hi is exclusive */
+template<typename F>
+void parallel_for(ivec2 size, ivec2 tile, F const &f)
+{
+    ivec2 const tiles = (size + tile - ivec2(1)) / tile;
+    thread_pool::shared().run(tiles.x * tiles.y, [&](int n)
+    {
+        ivec2 lo = ivec2(n % tiles.x, n / tiles.x) * tile;
+        f(lo, min(lo + tile, size));
+    });
+}
+
+template<typename F>
+void parallel_for(ivec3 size, ivec3 tile, F const &f)
+{
+    ivec3 const tiles = (size + tile - ivec3(1)) / tile;
+    thread_pool::shared().run(tiles.x * tiles.y * tiles.z, [&](int n)
+    {
+        ivec3 lo = ivec3(n % tiles.x, n / tiles.x % tiles.y,
+                         n / tiles.x / tiles.y) * tile;
+        f(lo, min(lo + tile, size));
+    });
+}
+
+template<typename F, typename... T>
+void parallel_for(arraynd<2, T...> const &a, ivec2 tile, F const &f)
+{
+    parallel_for(a.size(), tile, f);
+}
+
+template<typename F, typename... T>
+void parallel_for(arraynd<3, T...> const &a, ivec3 tile, F const &f)
+{
+    parallel_for(a.size(), tile, f);
+}
+
+/* Compute reduce(…reduce(reduce(init, map(0)), map(1))…, map(count - 1)).
+ * Chunks start from init, so it must be an identity for reduce. */
+template<typename T, typename M, typename R>
+T parallel_reduce(ptrdiff_t count, T const &init, M const &map, R const &reduce,
+                  ptrdiff_t grain = 0)
+{
+    ptrdiff_t const chunks = parallel_chunks(count, grain);
+    array<T> partial;
+    partial.resize(chunks, init);
+
+    thread_pool::shared().run((int)chunks, [&](int n)
+    {
+        T acc = init;
+        for (ptrdiff_t i = count * n / chunks; i < count * (n + 1) / chunks; ++i)
+            acc = reduce(acc, map(i));
+        partial[n] = acc;
+    });
+
+    T ret = init;
+    for (T const &x : partial)
+        ret = reduce(ret, x);
+    return ret;
+}
+
+/* out[i] = in[0] op … op in[i]; out may alias in */
+template<typename T, typename OP>
+void parallel_inclusive_scan(array<T> const &in, array<T> &out, OP const &op,
+                             ptrdiff_t grain = 0)
+{
+    ptrdiff_t const count = in.count_s();
+    ptrdiff_t const chunks = parallel_chunks(count, grain);
+    out.resize(count);
+
+    /* Scan each chunk, then offset the chunks by the preceding totals */
+    thread_pool::shared().run((int)chunks, [&](int n)
+    {
+        ptrdiff_t begin = count * n / chunks, end = count * (n + 1) / chunks;
+        out[begin] = in[begin];
+        for (ptrdiff_t i = begin + 1; i < end; ++i)
+            out[i] = op(out[i - 1], in[i]);
+    });
+
+    array<T> offsets;
+    for (ptrdiff_t n = 1; n < chunks; ++n)
+    {
+        T const &last = out[count * n / chunks - 1];
+        offsets << (n > 1 ? op(offsets.last(), last) : last);
+    }
+
+    thread_pool::shared().run((int)chunks - 1, [&](int n)
+    {
+        for (ptrdiff_t i = count * (n + 1) / chunks; i < count * (n + 2) / chunks; ++i)
+            out[i] = op(offsets[n], out[i]);
+    });
+}
+
+/* out[0] = init, out[i] = init op in[0] op … op in[i - 1] */
+template<typename T, typename OP>
+void parallel_exclusive_scan(array<T> const &in, array<T> &out, T const &init,
+                             OP const &op, ptrdiff_t grain = 0)
+{
+    array<T> tmp;
+    parallel_inclusive_scan(in, tmp, op, grain);
+
+    out.resize(in.count_s());
+    parallel_for(in.count_s(), [&](ptrdiff_t i)
+    {
+        out[i] = i ? op(init, tmp[i - 1]) : init;
+    }, grain);
+}
+
+/* A stable sort: chunks are sorted in parallel, then merged pairwise */
+template<typename T, typename C = std::less<T>>
+void parallel_sort(array<T> &a, C const &cmp = C(), ptrdiff_t grain = 0)
+{
+    ptrdiff_t const count = a.count_s();
+    ptrdiff_t const chunks = parallel_chunks(count, grain);
+    if (chunks <= 1)
+    {
+        std::stable_sort(a.data(), a.data() + count, cmp);
+        return;
+    }
+
+    auto bound = [&](ptrdiff_t n) { return count * std::min(n, chunks) / chunks; };
+
+    thread_pool::shared().run((int)chunks, [&](int n)
+    {
+        std::stable_sort(a.data() + bound(n), a.data() + bound(n + 1), cmp);
+    });
+
+    array<T> tmp;
+    tmp.resize(count);
+    array<T> *src = &a, *dst = &tmp;
+    for (ptrdiff_t width = 1; width < chunks; width *= 2)
+    {
+        ptrdiff_t const pairs = (chunks + 2 * width - 1) / (2 * width);
+        thread_pool::shared().run((int)pairs, [&](int n)
+        {
+            ptrdiff_t lo = bound(2 * width * n), mid = bound(2 * width * n + width),
+                      hi = bound(2 * width * n + 2 * width);
+            std::merge(src->data() + lo, src->data() + mid,
+                       src->data() + mid, src->data() + hi,
+                       dst->data() + lo, cmp);
+        });
+        std::swap(src, dst);
+    }
+
+    if (src != &a)
+        parallel_for_range(count, [&](ptrdiff_t begin, ptrdiff_t end)
+        {
+            std::copy(tmp.data() + begin, tmp.data() + end, a.data() + begin);
+        });
+}
+
+/* out[i] = f(in[i]); out may alias in */
+template<typename T, typename U, typename F>
+void parallel_transform(array<T> const &in, array<U> &out, F const &f,
+                        ptrdiff_t grain = 0)
+{
+    out.resize(in.count_s());
+    parallel_for(in.count_s(), [&](ptrdiff_t i) { out[i] = f(in[i]); }, grain);
+}
+
+} /* namespace lol */
+
@@ -15,11 +15,12 @@
 //
 // The audio interface
 // -------------------
-// Helper functions to set up the audio device.
+// Helper functions to set up the audio device. Streams are mixed by the
+// engine itself and the result is sent to the selected backend.
 //
 
-#include <unordered_set>
 #include <functional>
+#include <string>
 
 namespace lol
 {
@@ -37,25 +38,75 @@ public:
         float32le, float32be,
     };
 
+    enum class backend : uint8_t
+    {
+        // The system audio device, if available
+        device = 0,
+        // No output; the application drives mixing with render()
+        null,
+        // Same as null, but everything rendered is written to a WAV file
+        file,
+    };
+
+    // Size in bytes of one sample in the given format
+    static int bytes_per_sample(format format);
+
     static void init();
+    // Initialise the audio output. frames is the size of the mixing buffer,
+    // which is also the minimum output latency.
+    static void init(backend backend, int frequency = 44100,
+                     int channels = 2, int frames = 512,
+                     std::string const &path = "");
+    static void shutdown();
 
-    // Set the number of audio tracks that can be mixed together
+    // Properties of the output, as actually negotiated with the backend
+    static int frequency();
+    static int channels();
+    static format output_format();
+    // Output latency in seconds, not counting the samples that are still
+    // waiting in stream queues (see queued_frames())
+    static float latency();
+
+    // Set the number of channels SDL_mixer itself can mix together; the
+    // engine’s mixer has no such limit
     static void set_tracks(int tracks);
-    // Set the volume of a specific track
+    // Set the volume of a specific track, or of all tracks if track is
+    // negative, from 0 to 128
     static void set_volume(int track, int volume);
+    // Set the stereo position of a specific track, from -1 to 1
+    static void set_pan(int track, float pan);
     static void mute_all();
     static void unmute_all();
 
+    // Start a stream whose samples are requested by the mixer from the
+    // audio thread, through the given callback.
     static int start_streaming(std::function<void(void *, int)> const &f,
                                format format = audio::format::sint16le,
                                int frequency = 22050,
                                int channels = 2);
 
+    // Start a stream whose samples are sent from the game thread using
+    // queue_samples(). frames is the capacity of the stream’s queue.
+    static int start_queue(format format = audio::format::sint16le,
+                           int frequency = 22050,
+                           int channels = 2,
+                           int frames = 4096);
+
+    // Append samples to a stream started with start_queue(). This never
+    // blocks; returns the number of bytes actually queued.
+    static int queue_samples(int track, void const *buf, int bytes);
+    // Number of frames waiting in the stream’s queue
+    static int queued_frames(int track);
+
     static void stop_streaming(int track);
 
+    // Mix the given number of frames into buf, in the output format. This
+    // is what the device backend does on its own; with the null and file
+    // backends, the application must call it regularly.
+    static void render(void *buf, int frames);
+
 private:
     audio() {}
-    static std::unordered_set<std::shared_ptr<struct audio_streamer>> m_streamers;
 };
 
 } /* namespace lol */
@@ -18,8 +18,13 @@
 #include <lol/base/assert.h>
 #include <lol/base/tuple.h>
 #include <lol/base/array.h>
+#include <lol/base/span.h>
+#include <lol/base/pool.h>
 #include <lol/base/avl_tree.h>
+#include <lol/base/bplus_tree.h>
 #include <lol/base/string.h>
 #include <lol/base/map.h>
+#include <lol/base/hash_map.h>
+#include <lol/base/intern.h>
 #include <lol/base/enum.h>
 
@@ -14,11 +14,20 @@
 
 #pragma once
 
+//
+// The avl_tree class
+// ------------------
+// An ordered map. Nodes come from a pool owned by the tree, so that nodes
+// inserted together, or copied together, are close in memory.
+//
+
+#include <lol/base/pool.h>
+
+#include <algorithm>
+
 namespace lol
 {
 
-#include <lol/base/all.h>
-
 template<typename K, typename V>
 class avl_tree
 {
@@ -33,19 +42,13 @@ public:
         m_root(nullptr),
         m_count(0)
     {
-        for (auto it : other)
-            insert(it.key, it.value);
+        assign(other);
     }
 
     avl_tree & operator=(avl_tree const & other)
     {
         if (&other != this)
-        {
-            clear();
-
-            for (auto it : other)
-                insert(it.key, it.value);
-        }
+            assign(other);
 
         return *this;
     }
@@ -59,12 +62,12 @@ public:
     {
         if (!m_root)
         {
-            m_root = new tree_node(key, value, &m_root);
+            m_root = m_pool.create(key, value, &m_root);
             ++m_count;
             return true;
         }
 
-        if (m_root->insert(key, value))
+        if (m_root->insert(key, value, m_pool))
         {
             ++m_count;
             return true;
@@ -78,7 +81,7 @@ public:
         if (!m_root)
             return false;
 
-        if (m_root->erase(key))
+        if (m_root->erase(key, m_pool))
         {
             --m_count;
             return true;
@@ -105,11 +108,12 @@ public:
             while (node)
             {
                 tree_node * next = node->get_next();
-                delete node;
+                m_pool.destroy(node);
                 node = next;
             }
         }
 
+        m_pool.reset();
         m_root = nullptr;
         m_count = 0;
     }
@@ -194,6 +198,24 @@ public:
 
 protected:
 
+    class tree_node;
+
+    /* Copy another tree: its nodes come in order, so we can allocate them
+     * contiguously and link them into a balanced tree directly, without
+     * any comparisons or rotations. */
+    void assign(avl_tree const & other)
+    {
+        clear();
+
+        array<tree_node *> nodes;
+        nodes.reserve(other.count());
+        for (auto it : other)
+            nodes << m_pool.create(it.key, it.value, nullptr);
+
+        m_root = tree_node::build(nodes.data(), 0, nodes.count(), nodes.count(), &m_root);
+        m_count = nodes.count();
+    }
+
     class tree_node
     {
     public:
@@ -217,9 +239,29 @@ protected:
             return m_value;
         }
 
+        /* Link the sorted nodes[begin..end[ into a balanced subtree and
+         * return its root */
+        static tree_node * build(tree_node * const * nodes, int begin, int end,
+                                 int count, tree_node ** parent_slot)
+        {
+            if (begin >= end)
+                return nullptr;
+
+            int const mid = (begin + end) / 2;
+            tree_node * node = nodes[mid];
+            node->m_parent_slot = parent_slot;
+            node->m_chain[0] = mid > 0 ? nodes[mid - 1] : nullptr;
+            node->m_chain[1] = mid + 1 < count ? nodes[mid + 1] : nullptr;
+            node->m_child[0] = build(nodes, begin, mid, count, &node->m_child[0]);
+            node->m_child[1] = build(nodes, mid + 1, end, count, &node->m_child[1]);
+            node->update_balance();
+
+            return node;
+        }
+
         /* Insert a value in tree and return true or update an existing value for
          * the existing key and return false */
-        bool insert(K const & key, V const & value)
+        bool insert(K const & key, V const & value, object_pool<tree_node> & pool)
         {
             int i = -1 + (key < m_key) + 2 * (m_key < key);
 
@@ -228,12 +270,12 @@ protected:
             if (i < 0)
                 m_value = value;
             else if (m_child[i])
-                created = m_child[i]->insert(key, value);
+                created = m_child[i]->insert(key, value, pool);
             else
             {
                 created = true;
 
-                m_child[i] = new tree_node(key, value, &m_child[i]);
+                m_child[i] = pool.create(key, value, &m_child[i]);
 
                 m_child[i]->m_chain[i] = m_chain[i];
                 m_child[i]->m_chain[i ? 0 : 1] = this;
@@ -252,7 +294,7 @@ protected:
         }
 
         /* Erase a value in tree and return true or return false */
-        bool erase(K const & key)
+        bool erase(K const & key, object_pool<tree_node> & pool)
         {
             int i = -1 + (key < m_key) + 2 * (m_key < key);
 
@@ -265,14 +307,14 @@ protected:
                 erased = true;
                 suicide = true;
             }
-            else if (m_child[i] && m_child[i]->erase(key))
+            else if (m_child[i] && m_child[i]->erase(key, pool))
             {
                 rebalance_if_needed();
                 erased = true;
             }
 
             if (suicide)
-                delete this;
+                pool.destroy(this);
 
             return erased;
         }
@@ -437,7 +479,7 @@ protected:
                 if (replacement->m_child[1-i])
                     replacement->m_child[1-i]->deep_balance(replacement->m_key);
 
-                replacement->update_balance();
+                replacement->rebalance_if_needed();
             }
             else
             {
@@ -458,7 +500,8 @@ protected:
             if (i != -1 && m_child[i])
                 m_child[i]->deep_balance(key);
 
-            update_balance();
+            /* The subtree lost a node, so it may need a rotation */
+            rebalance_if_needed();
         }
 
         void replace_chain(tree_node * replacement)
@@ -637,6 +680,8 @@ public:
 
 protected:
 
+    object_pool<tree_node> m_pool;
+
     tree_node * m_root;
 
     int m_count;
@@ -0,0 +1,705 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// The bplus_tree class
+// --------------------
+// An ordered map with the same interface as avl_tree, but storing many
+// keys per node: lookups touch a handful of cache lines instead of one
+// per level, and iteration walks a linked list of arrays. Keys and values
+// must be default-constructible and copyable.
+//
+
+#include <lol/base/pool.h>
+
+#include <algorithm>
+
+namespace lol
+{
+
+template<typename K, typename V>
+class bplus_tree
+{
+protected:
+    /* Aim for nodes of about 512 bytes */
+    static int const LEAF_SIZE = sizeof(K) + sizeof(V) > 64 ? 8
+                               : 512 / (int)(sizeof(K) + sizeof(V));
+    static int const INNER_SIZE = sizeof(K) + sizeof(void *) > 64 ? 8
+                                : 512 / (int)(sizeof(K) + sizeof(void *));
+
+    struct node
+    {
+        node(bool is_leaf) : leaf(is_leaf), count(0) {}
+
+        bool leaf;
+        int count;
+    };
+
+    /* The arrays have room for one extra element, so that a node can
+     * overflow before it is split. */
+    struct leaf_node : node
+    {
+        leaf_node() : node(true), prev(nullptr), next(nullptr) {}
+
+        K keys[LEAF_SIZE + 1];
+        V values[LEAF_SIZE + 1];
+        leaf_node *prev, *next;
+    };
+
+    /* Child i holds the keys k such that keys[i - 1] ≤ k < keys[i] */
+    struct inner_node : node
+    {
+        inner_node() : node(false) {}
+
+        K keys[INNER_SIZE + 1];
+        node *children[INNER_SIZE + 2];
+    };
+
+public:
+    bplus_tree() :
+        m_root(nullptr),
+        m_count(0)
+    {
+    }
+
+    bplus_tree(bplus_tree const & other) :
+        m_root(nullptr),
+        m_count(0)
+    {
+        *this = other;
+    }
+
+    bplus_tree & operator=(bplus_tree const & other)
+    {
+        if (&other != this)
+        {
+            clear();
+            for (leaf_node *leaf = other.first_leaf(); leaf; leaf = leaf->next)
+                for (int i = 0; i < leaf->count; ++i)
+                    append(leaf->keys[i], leaf->values[i]);
+            finish();
+        }
+
+        return *this;
+    }
+
+    ~bplus_tree()
+    {
+        clear();
+    }
+
+    /* Replace the contents of the tree with count keys in strictly
+     * increasing order and their values, in linear time. */
+    void assign_sorted(K const * keys, V const * values, int count)
+    {
+        clear();
+        for (int i = 0; i < count; ++i)
+        {
+            ASSERT(i == 0 || keys[i - 1] < keys[i], "assign_sorted() needs sorted keys");
+            append(keys[i], values[i]);
+        }
+        finish();
+    }
+
+    /* Insert a value and return true, or update the value of an existing
+     * key and return false */
+    bool insert(K const & key, V const & value)
+    {
+        if (!m_root)
+            m_root = m_leaves.create();
+
+        node * split = nullptr;
+        K split_key;
+        if (!insert(m_root, key, value, split, split_key))
+            return false;
+
+        if (split)
+        {
+            inner_node * root = m_inners.create();
+            root->count = 1;
+            root->keys[0] = split_key;
+            root->children[0] = m_root;
+            root->children[1] = split;
+            m_root = root;
+        }
+
+        ++m_count;
+        return true;
+    }
+
+    bool erase(K const & key)
+    {
+        if (!m_root || !erase(m_root, key))
+            return false;
+
+        /* Shrink the tree when the root has a single child left */
+        if (!m_root->leaf && m_root->count == 0)
+        {
+            inner_node * root = static_cast<inner_node *>(m_root);
+            m_root = root->children[0];
+            m_inners.destroy(root);
+        }
+        else if (m_root->leaf && m_root->count == 0)
+        {
+            m_leaves.destroy(static_cast<leaf_node *>(m_root));
+            m_root = nullptr;
+        }
+
+        --m_count;
+        return true;
+    }
+
+    bool exists(K const & key) const
+    {
+        leaf_node * leaf = find_leaf(key);
+        return leaf && find(leaf, key) < leaf->count;
+    }
+
+    void clear()
+    {
+        if (m_root)
+            destroy(m_root);
+
+        m_leaves.reset();
+        m_inners.reset();
+        m_root = nullptr;
+        m_count = 0;
+    }
+
+    bool try_get(K const & key, V * & value_ptr) const
+    {
+        leaf_node * leaf = find_leaf(key);
+        if (!leaf)
+            return false;
+
+        int i = find(leaf, key);
+        if (i == leaf->count)
+            return false;
+
+        value_ptr = &leaf->values[i];
+        return true;
+    }
+
+    bool try_get_min(K const * & key_ptr, V * & value_ptr) const
+    {
+        leaf_node * leaf = first_leaf();
+        if (!leaf)
+            return false;
+
+        key_ptr = &leaf->keys[0];
+        value_ptr = &leaf->values[0];
+        return true;
+    }
+
+    bool try_get_max(K const * & key_ptr, V * & value_ptr) const
+    {
+        leaf_node * leaf = last_leaf();
+        if (!leaf)
+            return false;
+
+        key_ptr = &leaf->keys[leaf->count - 1];
+        value_ptr = &leaf->values[leaf->count - 1];
+        return true;
+    }
+
+    int count() const
+    {
+        return m_count;
+    }
+
+    /* Iterators related */
+
+    struct output_value
+    {
+        output_value(K const & key_, V & value_) :
+            key(key_),
+            value(value_)
+        {
+        }
+
+        K const & key;
+        V & value;
+    };
+
+    struct const_output_value
+    {
+        const_output_value(K const & key_, V const & value_) :
+            key(key_),
+            value(value_)
+        {
+        }
+
+        K const & key;
+        V const & value;
+    };
+
+    template<typename OUT>
+    class base_iterator
+    {
+    public:
+        base_iterator(leaf_node * leaf, int index) :
+            m_leaf(leaf),
+            m_index(index)
+        {
+            /* Past the end of a leaf means the start of the next one */
+            if (m_leaf && m_index >= m_leaf->count)
+            {
+                m_leaf = m_leaf->next;
+                m_index = 0;
+            }
+        }
+
+        base_iterator & operator++()
+        {
+            if (++m_index >= m_leaf->count)
+            {
+                m_leaf = m_leaf->next;
+                m_index = 0;
+            }
+
+            return *this;
+        }
+
+        base_iterator operator++(int)
+        {
+            base_iterator ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        OUT operator*() const
+        {
+            return OUT(m_leaf->keys[m_index], m_leaf->values[m_index]);
+        }
+
+        bool operator==(base_iterator const & that) const
+        {
+            return m_leaf == that.m_leaf && m_index == that.m_index;
+        }
+
+        bool operator!=(base_iterator const & that) const
+        {
+            return !(*this == that);
+        }
+
+    protected:
+        leaf_node * m_leaf;
+        int m_index;
+    };
+
+    typedef base_iterator<output_value> iterator;
+    typedef base_iterator<const_output_value> const_iterator;
+
+    /* A pair of iterators, for use in range-based for loops */
+    template<typename IT>
+    struct base_range
+    {
+        IT begin() const { return m_begin; }
+        IT end() const { return m_end; }
+
+        IT m_begin, m_end;
+    };
+
+    iterator begin() { return iterator(first_leaf(), 0); }
+    const_iterator begin() const { return const_iterator(first_leaf(), 0); }
+    iterator end() { return iterator(nullptr, 0); }
+    const_iterator end() const { return const_iterator(nullptr, 0); }
+
+    /* The first element whose key is not less than key */
+    iterator lower_bound(K const & key)
+    {
+        leaf_node * leaf = find_leaf(key);
+        return leaf ? iterator(leaf, lower(leaf->keys, leaf->count, key)) : end();
+    }
+
+    const_iterator lower_bound(K const & key) const
+    {
+        leaf_node * leaf = find_leaf(key);
+        return leaf ? const_iterator(leaf, lower(leaf->keys, leaf->count, key)) : end();
+    }
+
+    /* The elements whose keys are in [lo, hi[ */
+    base_range<iterator> range(K const & lo, K const & hi)
+    {
+        return base_range<iterator> { lower_bound(lo), lower_bound(hi) };
+    }
+
+    base_range<const_iterator> range(K const & lo, K const & hi) const
+    {
+        return base_range<const_iterator> { lower_bound(lo), lower_bound(hi) };
+    }
+
+protected:
+    /* The index of the first key that is not less than key */
+    static int lower(K const * keys, int count, K const & key)
+    {
+        return (int)(std::lower_bound(keys, keys + count, key) - keys);
+    }
+
+    /* The index of the first key that is greater than key */
+    static int upper(K const * keys, int count, K const & key)
+    {
+        return (int)(std::upper_bound(keys, keys + count, key) - keys);
+    }
+
+    /* The index of key in a leaf, or leaf->count if it is absent */
+    static int find(leaf_node const * leaf, K const & key)
+    {
+        int i = lower(leaf->keys, leaf->count, key);
+        return i < leaf->count && !(key < leaf->keys[i]) ? i : leaf->count;
+    }
+
+    leaf_node * find_leaf(K const & key) const
+    {
+        node * n = m_root;
+        while (n && !n->leaf)
+        {
+            inner_node * inner = static_cast<inner_node *>(n);
+            n = inner->children[upper(inner->keys, inner->count, key)];
+        }
+        return static_cast<leaf_node *>(n);
+    }
+
+    leaf_node * first_leaf() const
+    {
+        node * n = m_root;
+        while (n && !n->leaf)
+            n = static_cast<inner_node *>(n)->children[0];
+        return static_cast<leaf_node *>(n);
+    }
+
+    leaf_node * last_leaf() const
+    {
+        node * n = m_root;
+        while (n && !n->leaf)
+            n = static_cast<inner_node *>(n)->children[n->count];
+        return static_cast<leaf_node *>(n);
+    }
+
+    void destroy(node * n)
+    {
+        if (n->leaf)
+        {
+            m_leaves.destroy(static_cast<leaf_node *>(n));
+            return;
+        }
+
+        inner_node * inner = static_cast<inner_node *>(n);
+        for (int i = 0; i <= inner->count; ++i)
+            destroy(inner->children[i]);
+        m_inners.destroy(inner);
+    }
+
+    /* Insert in the subtree at n. If n had to be split, return its new
+     * right sibling in split, and the smallest key of that sibling in
+     * split_key. */
+    bool insert(node * n, K const & key, V const & value,
+                node * & split, K & split_key)
+    {
+        if (n->leaf)
+        {
+            leaf_node * leaf = static_cast<leaf_node *>(n);
+            int i = lower(leaf->keys, leaf->count, key);
+            if (i < leaf->count && !(key < leaf->keys[i]))
+            {
+                leaf->values[i] = value;
+                return false;
+            }
+
+            std::copy_backward(leaf->keys + i, leaf->keys + leaf->count,
+                               leaf->keys + leaf->count + 1);
+            std::copy_backward(leaf->values + i, leaf->values + leaf->count,
+                               leaf->values + leaf->count + 1);
+            leaf->keys[i] = key;
+            leaf->values[i] = value;
+
+            if (++leaf->count > LEAF_SIZE)
+            {
+                leaf_node * right = m_leaves.create();
+                int const mid = leaf->count / 2;
+                right->count = leaf->count - mid;
+                std::copy(leaf->keys + mid, leaf->keys + leaf->count, right->keys);
+                std::copy(leaf->values + mid, leaf->values + leaf->count, right->values);
+                leaf->count = mid;
+
+                right->next = leaf->next;
+                right->prev = leaf;
+                if (leaf->next)
+                    leaf->next->prev = right;
+                leaf->next = right;
+
+                split = right;
+                split_key = right->keys[0];
+            }
+
+            return true;
+        }
+
+        inner_node * inner = static_cast<inner_node *>(n);
+        int i = upper(inner->keys, inner->count, key);
+        node * child_split = nullptr;
+        K child_key;
+        if (!insert(inner->children[i], key, value, child_split, child_key))
+            return false;
+
+        if (child_split)
+        {
+            std::copy_backward(inner->keys + i, inner->keys + inner->count,
+                               inner->keys + inner->count + 1);
+            std::copy_backward(inner->children + i + 1, inner->children + inner->count + 1,
+                               inner->children + inner->count + 2);
+            inner->keys[i] = child_key;
+            inner->children[i + 1] = child_split;
+
+            /* The middle key moves up to the parent */
+            if (++inner->count > INNER_SIZE)
+            {
+                inner_node * right = m_inners.create();
+                int const mid = inner->count / 2;
+                right->count = inner->count - mid - 1;
+                std::copy(inner->keys + mid + 1, inner->keys + inner->count, right->keys);
+                std::copy(inner->children + mid + 1, inner->children + inner->count + 1,
+                          right->children);
+                inner->count = mid;
+
+                split = right;
+                split_key = inner->keys[mid];
+            }
+        }
+
+        return true;
+    }
+
+    /* Erase from the subtree at n, then make sure that the child we went
+     * through is still at least half full. */
+    bool erase(node * n, K const & key)
+    {
+        if (n->leaf)
+        {
+            leaf_node * leaf = static_cast<leaf_node *>(n);
+            int i = find(leaf, key);
+            if (i == leaf->count)
+                return false;
+
+            std::copy(leaf->keys + i + 1, leaf->keys + leaf->count, leaf->keys + i);
+            std::copy(leaf->values + i + 1, leaf->values + leaf->count, leaf->values + i);
+            --leaf->count;
+            return true;
+        }
+
+        inner_node * inner = static_cast<inner_node *>(n);
+        int i = upper(inner->keys, inner->count, key);
+        if (!erase(inner->children[i], key))
+            return false;
+
+        node * child = inner->children[i];
+        if (child->count < (child->leaf ? LEAF_SIZE / 2 : INNER_SIZE / 2))
+            rebalance(inner, i);
+
+        return true;
+    }
+
+    /* Child i of inner is underfull: merge it with a sibling if the
+     * result fits in one node, otherwise borrow one element from it. */
+    void rebalance(inner_node * inner, int i)
+    {
+        /* Work on the pair (left, right) = children (j, j + 1) */
+        int const j = i > 0 ? i - 1 : i;
+        node * left = inner->children[j];
+        node * right = inner->children[j + 1];
+
+        if (left->leaf)
+        {
+            leaf_node * l = static_cast<leaf_node *>(left);
+            leaf_node * r = static_cast<leaf_node *>(right);
+
+            if (l->count + r->count > LEAF_SIZE)
+            {
+                /* Move one element to the underfull side */
+                if (l->count > r->count)
+                {
+                    std::copy_backward(r->keys, r->keys + r->count, r->keys + r->count + 1);
+                    std::copy_backward(r->values, r->values + r->count, r->values + r->count + 1);
+                    r->keys[0] = l->keys[l->count - 1];
+                    r->values[0] = l->values[l->count - 1];
+                    --l->count;
+                    ++r->count;
+                }
+                else
+                {
+                    l->keys[l->count] = r->keys[0];
+                    l->values[l->count] = r->values[0];
+                    std::copy(r->keys + 1, r->keys + r->count, r->keys);
+                    std::copy(r->values + 1, r->values + r->count, r->values);
+                    ++l->count;
+                    --r->count;
+                }
+                inner->keys[j] = r->keys[0];
+                return;
+            }
+
+            std::copy(r->keys, r->keys + r->count, l->keys + l->count);
+            std::copy(r->values, r->values + r->count, l->values + l->count);
+            l->count += r->count;
+            l->next = r->next;
+            if (r->next)
+                r->next->prev = l;
+            m_leaves.destroy(r);
+        }
+        else
+        {
+            inner_node * l = static_cast<inner_node *>(left);
+            inner_node * r = static_cast<inner_node *>(right);
+
+            /* Merging also brings down the separator key */
+            if (l->count + r->count >= INNER_SIZE)
+            {
+                /* Rotate one child through the separator key */
+                if (l->count > r->count)
+                {
+                    std::copy_backward(r->keys, r->keys + r->count, r->keys + r->count + 1);
+                    std::copy_backward(r->children, r->children + r->count + 1,
+                                       r->children + r->count + 2);
+                    r->keys[0] = inner->keys[j];
+                    r->children[0] = l->children[l->count];
+                    inner->keys[j] = l->keys[l->count - 1];
+                    --l->count;
+                    ++r->count;
+                }
+                else
+                {
+                    l->keys[l->count] = inner->keys[j];
+                    l->children[l->count + 1] = r->children[0];
+                    inner->keys[j] = r->keys[0];
+                    std::copy(r->keys + 1, r->keys + r->count, r->keys);
+                    std::copy(r->children + 1, r->children + r->count + 1, r->children);
+                    ++l->count;
+                    --r->count;
+                }
+                return;
+            }
+
+            /* The separator key comes down between the two halves */
+            l->keys[l->count] = inner->keys[j];
+            std::copy(r->keys, r->keys + r->count, l->keys + l->count + 1);
+            std::copy(r->children, r->children + r->count + 1, l->children + l->count + 1);
+            l->count += r->count + 1;
+            m_inners.destroy(r);
+        }
+
+        /* Remove the separator and the merged child from the parent */
+        std::copy(inner->keys + j + 1, inner->keys + inner->count, inner->keys + j);
+        std::copy(inner->children + j + 2, inner->children + inner->count + 1,
+                  inner->children + j + 1);
+        --inner->count;
+    }
+
+    /* Bulk loading: append() fills leaves from left to right, then
+     * finish() builds the inner levels on top of them. */
+    void append(K const & key, V const & value)
+    {
+        leaf_node * leaf = static_cast<leaf_node *>(m_root);
+        if (!leaf || leaf->count == LEAF_SIZE)
+        {
+            leaf_node * next = m_leaves.create();
+            next->prev = leaf;
+            if (leaf)
+                leaf->next = next;
+            leaf = next;
+            m_root = leaf;
+        }
+
+        leaf->keys[leaf->count] = key;
+        leaf->values[leaf->count] = value;
+        ++leaf->count;
+        ++m_count;
+    }
+
+    void finish()
+    {
+        /* During bulk loading, m_root is the last leaf */
+        leaf_node * last = static_cast<leaf_node *>(m_root);
+        if (!last)
+            return;
+
+        /* Even out the last two leaves so that both are half full */
+        if (last->prev && last->count < LEAF_SIZE / 2)
+        {
+            leaf_node * prev = last->prev;
+            int const move = (prev->count - last->count) / 2;
+            std::copy_backward(last->keys, last->keys + last->count,
+                               last->keys + last->count + move);
+            std::copy_backward(last->values, last->values + last->count,
+                               last->values + last->count + move);
+            std::copy(prev->keys + prev->count - move, prev->keys + prev->count, last->keys);
+            std::copy(prev->values + prev->count - move, prev->values + prev->count,
+                      last->values);
+            prev->count -= move;
+            last->count += move;
+        }
+
+        /* Build each level from the one below, with the smallest key of
+         * each subtree as the separator */
+        array<node *> level, parents;
+        array<K> mins, parent_mins;
+        leaf_node * leaf = last;
+        while (leaf->prev)
+            leaf = leaf->prev;
+        for ( ; leaf; leaf = leaf->next)
+        {
+            level << leaf;
+            mins << leaf->keys[0];
+        }
+
+        while (level.count() > 1)
+        {
+            /* Spread the children evenly so that no node is underfull */
+            int const n = level.count();
+            int const groups = (n + INNER_SIZE) / (INNER_SIZE + 1);
+            parents.clear();
+            parent_mins.clear();
+
+            for (int g = 0, first = 0; g < groups; ++g)
+            {
+                int const last_child = (int)((int64_t)n * (g + 1) / groups);
+                inner_node * inner = m_inners.create();
+                inner->count = last_child - first - 1;
+                for (int k = first; k < last_child; ++k)
+                {
+                    inner->children[k - first] = level[k];
+                    if (k > first)
+                        inner->keys[k - first - 1] = mins[k];
+                }
+                parents << inner;
+                parent_mins << mins[first];
+                first = last_child;
+            }
+
+            std::swap(level, parents);
+            std::swap(mins, parent_mins);
+        }
+
+        m_root = level[0];
+    }
+
+    object_pool<leaf_node> m_leaves;
+    object_pool<inner_node> m_inners;
+
+    node * m_root;
+
+    int m_count;
+};
+
+} /* namespace lol */
+
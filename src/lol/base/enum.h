@@ -13,6 +13,8 @@
 
 #pragma once
 
+#include <lol/base/hash_map.h>
+
 #include <string>
 #include <map>
 
@@ -60,18 +62,20 @@ public:
     /* Convert to string stuff */
     inline std::string tostring()
     {
-        /* FIXME: we all know this isn’t thread safe. But is it really
-        * a big deal? */
-        static std::map<int64_t, std::string> enum_map;
-        static bool ready = false;
-
-        if (ready || this->BuildEnumMap(enum_map))
+        /* The map is built once, in a thread safe way, then copied into
+         * a hash map for faster lookups. */
+        static hash_map<int64_t, std::string> const enum_map = [this]()
         {
-            ready = true;
-            if (has_key(enum_map, (int64_t)m_value))
-                return enum_map[(int64_t)m_value];
-        }
-        return "<invalid enum>";
+            std::map<int64_t, std::string> tmp;
+            hash_map<int64_t, std::string> ret;
+            if (this->BuildEnumMap(tmp))
+                for (auto const &kv : tmp)
+                    ret[kv.first] = kv.second;
+            return ret;
+        }();
+
+        auto it = enum_map.find((int64_t)m_value);
+        return it != enum_map.end() ? it->second : "<invalid enum>";
     }
 
     /* Safe comparisons between enums of the same type */
@@ -0,0 +1,387 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// The hash_map class
+// ------------------
+// An unordered map using open addressing with Robin Hood hashing: all
+// elements live in one flat array, so lookups and iteration touch very
+// little memory. It has the subset of the std::map interface that the
+// utilities in <lol/base/map.h> need. Lookups accept any type that the
+// hash function and operator == accept, e.g. char const * for string
+// keys, without building a temporary key.
+//
+// Inserting or erasing elements invalidates all iterators and pointers
+// to elements. Iteration order is unspecified.
+//
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <new>
+#include <string>
+#include <utility>
+
+namespace lol
+{
+
+/* The default hash function; strings get a hash that also works for
+ * C strings, so that they can be looked up without a copy. */
+template<typename T> struct hash : std::hash<T> {};
+
+template<> struct hash<std::string>
+{
+    size_t operator()(std::string const &s) const { return bytes(s.data(), s.size()); }
+    size_t operator()(char const *s) const { return bytes(s, strlen(s)); }
+
+    /* 64-bit FNV-1a; the map mixes the result again before using it */
+    static size_t bytes(char const *data, size_t len)
+    {
+        uint64_t ret = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < len; ++i)
+            ret = (ret ^ (uint8_t)data[i]) * 0x100000001b3ull;
+        return (size_t)ret;
+    }
+};
+
+template<typename K, typename V, typename H = hash<K>>
+class hash_map
+{
+public:
+    typedef K key_type;
+    typedef V mapped_type;
+    typedef std::pair<K, V> value_type;
+
+    hash_map()
+      : m_meta(empty_meta()),
+        m_slots(nullptr),
+        m_count(0),
+        m_shift(64)
+    {
+    }
+
+    hash_map(std::initializer_list<value_type> list)
+      : hash_map()
+    {
+        reserve(list.size());
+        for (auto const &kv : list)
+            (*this)[kv.first] = kv.second;
+    }
+
+    hash_map(hash_map const &other)
+      : hash_map()
+    {
+        *this = other;
+    }
+
+    hash_map(hash_map &&other)
+      : hash_map()
+    {
+        swap(other);
+    }
+
+    hash_map & operator=(hash_map const &other)
+    {
+        if (&other != this)
+        {
+            /* Same capacity, so every element goes to the same slot */
+            release();
+            if (!other.m_slots)
+                return *this;
+
+            allocate(other.capacity());
+            for (size_t i = 0; i < other.capacity(); ++i)
+            {
+                m_meta[i] = other.m_meta[i];
+                if (m_meta[i])
+                    new (&m_slots[i]) value_type(other.m_slots[i]);
+            }
+            m_count = other.m_count;
+        }
+
+        return *this;
+    }
+
+    hash_map & operator=(hash_map &&other)
+    {
+        swap(other);
+        return *this;
+    }
+
+    ~hash_map()
+    {
+        release();
+    }
+
+    void swap(hash_map &other)
+    {
+        std::swap(m_meta, other.m_meta);
+        std::swap(m_slots, other.m_slots);
+        std::swap(m_count, other.m_count);
+        std::swap(m_shift, other.m_shift);
+    }
+
+    size_t size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+
+    void clear()
+    {
+        for (size_t i = 0; i < capacity(); ++i)
+            if (m_meta[i])
+            {
+                m_slots[i].~value_type();
+                m_meta[i] = 0;
+            }
+        m_count = 0;
+    }
+
+    /* Make room for count elements without rehashing */
+    void reserve(size_t count)
+    {
+        size_t n = 8;
+        while (n * 7 / 8 < count)
+            n *= 2;
+        if (n > capacity())
+            rehash(n);
+    }
+
+    V & operator[](K const &key)
+    {
+        ptrdiff_t i = find_index(key);
+        if (i < 0)
+        {
+            i = insert_index(value_type(key, V()));
+            if (i < 0)
+                i = find_index(key);
+        }
+        return m_slots[i].second;
+    }
+
+    /* Iterators related */
+
+    template<typename SLOT>
+    class base_iterator
+    {
+    public:
+        base_iterator(uint8_t const *meta, SLOT *slot)
+          : m_meta(meta),
+            m_slot(slot)
+        {
+            /* The metadata array ends with a non-zero sentinel */
+            while (!*m_meta)
+                ++m_meta, ++m_slot;
+        }
+
+        base_iterator & operator++()
+        {
+            do
+                ++m_meta, ++m_slot;
+            while (!*m_meta);
+            return *this;
+        }
+
+        SLOT & operator*() const { return *m_slot; }
+        SLOT * operator->() const { return m_slot; }
+
+        bool operator==(base_iterator const &that) const { return m_slot == that.m_slot; }
+        bool operator!=(base_iterator const &that) const { return m_slot != that.m_slot; }
+
+    private:
+        uint8_t const *m_meta;
+        SLOT *m_slot;
+    };
+
+    typedef base_iterator<value_type> iterator;
+    typedef base_iterator<value_type const> const_iterator;
+
+    iterator begin() { return iterator(m_meta, m_slots); }
+    iterator end() { return iterator(m_meta + capacity(), m_slots + capacity()); }
+    const_iterator begin() const { return const_iterator(m_meta, m_slots); }
+    const_iterator end() const { return const_iterator(m_meta + capacity(), m_slots + capacity()); }
+
+    template<typename Q> iterator find(Q const &key)
+    {
+        ptrdiff_t i = find_index(key);
+        return i < 0 ? end() : iterator(m_meta + i, m_slots + i);
+    }
+
+    template<typename Q> const_iterator find(Q const &key) const
+    {
+        ptrdiff_t i = find_index(key);
+        return i < 0 ? end() : const_iterator(m_meta + i, m_slots + i);
+    }
+
+    template<typename Q> size_t count(Q const &key) const
+    {
+        return find_index(key) < 0 ? 0 : 1;
+    }
+
+    template<typename Q> size_t erase(Q const &key)
+    {
+        ptrdiff_t i = find_index(key);
+        if (i < 0)
+            return 0;
+
+        /* Shift the following elements back, so that no tombstones are
+         * needed; stop at an empty slot or an element at its home slot */
+        size_t const mask = capacity() - 1;
+        size_t hole = (size_t)i, next = (hole + 1) & mask;
+        m_slots[hole].~value_type();
+        while (m_meta[next] > 1)
+        {
+            new (&m_slots[hole]) value_type(std::move(m_slots[next]));
+            m_slots[next].~value_type();
+            m_meta[hole] = m_meta[next] - 1;
+            hole = next;
+            next = (next + 1) & mask;
+        }
+        m_meta[hole] = 0;
+        --m_count;
+        return 1;
+    }
+
+private:
+    /* The maximum load factor is 7/8; probe distances are stored as
+     * one byte, and the table grows if one would overflow. */
+    static uint8_t const MAX_DISTANCE = 255;
+
+    size_t capacity() const { return m_slots ? (size_t)1 << (64 - m_shift) : 0; }
+
+    /* Fibonacci hashing spreads poor hashes such as aligned pointers */
+    template<typename Q> size_t home(Q const &key) const
+    {
+        return (size_t)(((uint64_t)H()(key) * 0x9e3779b97f4a7c15ull) >> m_shift);
+    }
+
+    template<typename Q> ptrdiff_t find_index(Q const &key) const
+    {
+        if (!m_count)
+            return -1;
+
+        size_t const mask = capacity() - 1;
+        size_t i = home(key);
+        for (uint8_t dist = 1; m_meta[i] >= dist; ++dist)
+        {
+            if (m_meta[i] == dist && m_slots[i].first == key)
+                return (ptrdiff_t)i;
+            i = (i + 1) & mask;
+        }
+        return -1;
+    }
+
+    /* Insert an element that is not in the map yet, and return its slot,
+     * or -1 if the table had to be resized during the insertion. */
+    ptrdiff_t insert_index(value_type &&kv)
+    {
+        if ((m_count + 1) * 8 > capacity() * 7)
+            rehash(capacity() ? capacity() * 2 : 8);
+
+        size_t const mask = capacity() - 1;
+        size_t i = home(kv.first);
+        ptrdiff_t ret = -1;
+        value_type tmp(std::move(kv));
+
+        for (uint8_t dist = 1; ; ++dist)
+        {
+            if (!m_meta[i])
+            {
+                new (&m_slots[i]) value_type(std::move(tmp));
+                m_meta[i] = dist;
+                ++m_count;
+                return ret < 0 ? (ptrdiff_t)i : ret;
+            }
+
+            /* Take the slot from a richer element, and carry on with it */
+            if (m_meta[i] < dist)
+            {
+                std::swap(tmp, m_slots[i]);
+                std::swap(dist, m_meta[i]);
+                if (ret < 0)
+                    ret = (ptrdiff_t)i;
+            }
+
+            if (dist == MAX_DISTANCE - 1)
+            {
+                rehash(capacity() * 2);
+                insert_index(std::move(tmp));
+                return -1;
+            }
+
+            i = (i + 1) & mask;
+        }
+    }
+
+    void rehash(size_t new_capacity)
+    {
+        uint8_t *old_meta = m_meta;
+        value_type *old_slots = m_slots;
+        size_t const old_capacity = capacity();
+
+        allocate(new_capacity);
+        m_count = 0;
+        for (size_t i = 0; i < old_capacity; ++i)
+            if (old_meta[i])
+            {
+                insert_index(std::move(old_slots[i]));
+                old_slots[i].~value_type();
+            }
+
+        if (old_slots)
+        {
+            delete[] old_meta;
+            ::operator delete(old_slots);
+        }
+    }
+
+    void allocate(size_t n)
+    {
+        m_shift = 64;
+        while (((size_t)1 << (64 - m_shift)) < n)
+            --m_shift;
+
+        m_meta = new uint8_t[n + 1];
+        memset(m_meta, 0, n);
+        m_meta[n] = 1;
+        m_slots = static_cast<value_type *>(::operator new(n * sizeof(value_type)));
+    }
+
+    void release()
+    {
+        if (!m_slots)
+            return;
+
+        clear();
+        delete[] m_meta;
+        ::operator delete(m_slots);
+        m_meta = empty_meta();
+        m_slots = nullptr;
+        m_shift = 64;
+    }
+
+    /* Empty maps share a read-only sentinel, so that they allocate nothing */
+    static uint8_t *empty_meta()
+    {
+        static uint8_t sentinel = 1;
+        return &sentinel;
+    }
+
+    uint8_t *m_meta;
+    value_type *m_slots;
+    size_t m_count;
+    int m_shift;
+};
+
+} /* namespace lol */
+
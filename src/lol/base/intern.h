@@ -0,0 +1,37 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// String interning
+// ----------------
+// Map strings to 32-bit ids, so that names can be stored, hashed and
+// compared as integers. Equal strings always get the same id, ids never
+// change, and id 0 is the empty string. All functions are thread safe.
+//
+
+#include <cstdint>
+#include <string>
+
+namespace lol
+{
+
+uint32_t intern(std::string const &s);
+uint32_t intern(char const *s);
+
+/* The string for an id returned by intern(); the reference remains
+ * valid for the lifetime of the program. */
+std::string const &interned(uint32_t id);
+
+} /* namespace lol */
+
@@ -0,0 +1,120 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// The object_pool class
+// ---------------------
+// Allocates objects of a single type from large blocks instead of one
+// heap allocation each, and recycles freed slots. Objects allocated in
+// sequence are contiguous in memory, which helps node-based containers.
+// The owner must destroy all live objects before the pool goes away.
+//
+
+#include <lol/base/array.h>
+
+#include <algorithm>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace lol
+{
+
+template<typename T>
+class object_pool
+{
+public:
+    object_pool()
+      : m_free(nullptr),
+        m_capacity(0)
+    {
+    }
+
+    ~object_pool()
+    {
+        for (auto block : m_blocks)
+            delete[] block;
+    }
+
+    /* Pools hand out addresses, so they cannot be copied */
+    object_pool(object_pool const &) = delete;
+    object_pool & operator =(object_pool const &) = delete;
+
+    template<typename... ARGS> T *create(ARGS &&... args)
+    {
+        if (!m_free)
+            grow();
+
+        slot *s = m_free;
+        m_free = s->next;
+        return new (&s->data) T(std::forward<ARGS>(args)...);
+    }
+
+    void destroy(T *p)
+    {
+        p->~T();
+        slot *s = reinterpret_cast<slot *>(p);
+        s->next = m_free;
+        m_free = s;
+    }
+
+    /* Recycle all slots at once; all objects must have been destroyed.
+     * The memory is kept, and handed out again in address order. */
+    void reset()
+    {
+        m_free = nullptr;
+        for (int b = m_blocks.count(); b--; )
+            link(m_blocks[b], m_sizes[b]);
+    }
+
+    /* The number of objects the pool can hold without allocating */
+    int capacity() const { return m_capacity; }
+
+private:
+    union slot
+    {
+        slot *next;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type data;
+    };
+
+    /* Block sizes double, from 16 objects up to about 64 KiB */
+    void grow()
+    {
+        int const max_size = std::max(16, (int)(65536 / sizeof(slot)));
+        int const size = m_blocks.count()
+                       ? std::min(2 * m_sizes.last(), max_size) : 16;
+        m_blocks << new slot[size];
+        m_sizes << size;
+        m_capacity += size;
+        link(m_blocks.last(), size);
+    }
+
+    /* Prepend the slots of a block to the free list, lowest first */
+    void link(slot *block, int size)
+    {
+        for (int i = size; i--; )
+        {
+            block[i].next = m_free;
+            m_free = &block[i];
+        }
+    }
+
+    array<slot *> m_blocks;
+    array<int> m_sizes;
+    slot *m_free;
+    int m_capacity;
+};
+
+} /* namespace lol */
+
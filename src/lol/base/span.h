@@ -0,0 +1,72 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// The span class
+// --------------
+// A non-owning view of contiguous elements, such as a mapped file or
+// part of an array. The viewed memory must outlive the span.
+//
+
+#include <lol/base/assert.h>
+
+#include <cstddef>
+
+namespace lol
+{
+
+template<typename T>
+class span
+{
+public:
+    static size_t const npos = size_t(-1);
+
+    inline span() : m_data(nullptr), m_size(0) {}
+    inline span(T *data, size_t size) : m_data(data), m_size(size) {}
+
+    /* Allow conversion from span<U> to span<U const> */
+    template<typename U>
+    inline span(span<U> const &that) : m_data(that.data()), m_size(that.size()) {}
+
+    inline T *data() const { return m_data; }
+    inline size_t size() const { return m_size; }
+    inline bool empty() const { return m_size == 0; }
+
+    inline T &operator[](size_t n) const
+    {
+        ASSERT(n < m_size, "access span index %d/%d", (int)n, (int)m_size);
+        return m_data[n];
+    }
+
+    inline T *begin() const { return m_data; }
+    inline T *end() const { return m_data + m_size; }
+
+    /* Return count elements starting at offset, or fewer if the span
+     * is not large enough */
+    inline span subspan(size_t offset, size_t count = npos) const
+    {
+        if (offset > m_size)
+            offset = m_size;
+        if (count > m_size - offset)
+            count = m_size - offset;
+        return span(m_data + offset, count);
+    }
+
+private:
+    T *m_data;
+    size_t m_size;
+};
+
+} /* namespace lol */
+
@@ -22,6 +22,15 @@ namespace lol
 
 namespace Debug
 {
+    /* Shapes drawn from a cached unit mesh, see Scene::AddShape() */
+    enum class Shape : uint8_t
+    {
+        Box,
+        Circle,
+        Sphere,
+        Gizmo,
+    };
+
     class DrawContext
     {
     public:
@@ -45,7 +54,8 @@ namespace Debug
         };
 
     private:
-        static Data m_global;
+        /* Each thread has its own context stack */
+        static thread_local Data m_global;
         Data m_previous;
         Data m_current;
 
@@ -19,6 +19,8 @@
 
 #include <lol/../utils.h>
 #include <lol/../numeric.h>
+#include <lol/../visibility.h>
+#include <lol/../atlas.h>
 
 // Static classes
 #include <lol/../platform.h>
@@ -13,6 +13,7 @@
 #include <lol/gpu/shader.h>
 #include <lol/gpu/indexbuffer.h>
 #include <lol/gpu/vertexbuffer.h>
+#include <lol/gpu/transientbuffer.h>
 #include <lol/gpu/texture.h>
 #include <lol/gpu/framebuffer.h>
 #include <lol/gpu/lolfx.h>
@@ -30,8 +30,10 @@ public:
 
     size_t GetSize();
 
+    /* Same semantics as VertexBuffer::Lock() and VertexBuffer::Upload() */
     void *Lock(size_t offset, size_t size);
     void Unlock();
+    void Upload(size_t offset, void const *data, size_t size);
 
     void Bind();
     void Unbind();
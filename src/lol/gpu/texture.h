@@ -58,11 +58,18 @@ class Texture
 {
 public:
     Texture(ivec2 size, PixelFormat format);
+    Texture(ivec2 size, CompressedFormat format);
     ~Texture();
 
+    /* Whether the GPU can sample a compressed format; needs a context */
+    static bool IsSupported(CompressedFormat format);
+
     void Bind();
-    void SetData(void *data);
-    void SetSubData(ivec2 origin, ivec2 size, void *data);
+
+    /* Level sizes are halved and rounded down, but never below 1 */
+    void SetData(void const *data, int level = 0);
+    void SetSubData(ivec2 origin, ivec2 size, void const *data, int level = 0);
+    void SetCompressedData(span<uint8_t const> data, int level = 0);
 
     void SetMagFiltering(TextureMagFilter filter);
     void SetMinFiltering(TextureMinFilter filter);
@@ -0,0 +1,100 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// The transient_allocator and TransientBuffer classes
+// ---------------------------------------------------
+//
+// Geometry that only lives for one frame (lines, tiles, UI) is written
+// linearly into a few large persistent buffers instead of creating new
+// buffers every frame. A page is only written to again once the frame
+// that last used it is at least “fence” frames old, so that the GPU is
+// done reading from it.
+//
+
+#include <memory>
+
+namespace lol
+{
+
+/* The bookkeeping part, independent from any graphics API */
+class transient_allocator
+{
+public:
+    struct allocation
+    {
+        int page;
+        size_t offset;
+    };
+
+    transient_allocator(size_t page_size = 1024 * 1024, int fence = 3);
+
+    /* Reserve size bytes aligned on align bytes. If the returned page
+     * index equals page_count() - 1 and was not there before, a new
+     * page of page_size(page) bytes must be created by the caller. */
+    allocation alloc(size_t size, size_t align = 16);
+
+    /* Mark the end of a frame; this updates the last frame counters */
+    void next_frame();
+
+    int page_count() const { return m_pages.count(); }
+    size_t page_size(int page) const { return m_pages[page].m_size; }
+    int64_t frame() const { return m_frame; }
+
+    /* Statistics for the current and the last complete frame */
+    size_t frame_bytes() const { return m_bytes; }
+    int frame_allocs() const { return m_allocs; }
+    size_t last_frame_bytes() const { return m_last_bytes; }
+    int last_frame_allocs() const { return m_last_allocs; }
+
+private:
+    struct page_data
+    {
+        size_t m_size, m_used;
+        int64_t m_frame;
+    };
+
+    array<page_data> m_pages;
+    size_t m_page_size;
+    int m_fence, m_current = -1;
+    int64_t m_frame = 0;
+
+    size_t m_bytes = 0, m_last_bytes = 0;
+    int m_allocs = 0, m_last_allocs = 0;
+};
+
+/* A range in a transient buffer, valid until the end of the frame */
+template<typename T> struct transient_range
+{
+    std::shared_ptr<T> buffer;
+    size_t offset;
+};
+
+class TransientBuffer
+{
+public:
+    /* Copy data to the current frame’s vertex or index pages. The frame
+     * advances automatically when the ticker frame number changes. */
+    static transient_range<VertexBuffer> UploadVertices(void const *data, size_t size);
+    static transient_range<IndexBuffer> UploadIndices(void const *data, size_t size);
+
+    static transient_allocator const &GetVertexAllocator();
+    static transient_allocator const &GetIndexAllocator();
+
+private:
+    TransientBuffer() {}
+};
+
+} /* namespace lol */
+
@@ -33,9 +33,14 @@ public:
 
     size_t GetSize();
 
+    /* Lock returns a temporary write-only area; only the locked range,
+     * or everything after offset if size is zero, is sent on Unlock. */
     void *Lock(size_t offset, size_t size);
     void Unlock();
 
+    /* Send data directly, without going through a temporary area */
+    void Upload(size_t offset, void const *data, size_t size);
+
 private:
     class VertexBufferData *m_data;
 };
@@ -231,6 +236,25 @@ public:
     void SetStream(std::shared_ptr<VertexBuffer> vb,
                    ShaderAttrib attribs[]);
 
+    /* Same as above, with the stream starting offset bytes into the
+     * buffer, for instance in a transient buffer page. */
+    void SetStream(std::shared_ptr<VertexBuffer> vb, size_t offset,
+                   ShaderAttrib attr1,
+                   ShaderAttrib attr2 = ShaderAttrib(),
+                   ShaderAttrib attr3 = ShaderAttrib(),
+                   ShaderAttrib attr4 = ShaderAttrib(),
+                   ShaderAttrib attr5 = ShaderAttrib(),
+                   ShaderAttrib attr6 = ShaderAttrib(),
+                   ShaderAttrib attr7 = ShaderAttrib(),
+                   ShaderAttrib attr8 = ShaderAttrib(),
+                   ShaderAttrib attr9 = ShaderAttrib(),
+                   ShaderAttrib attr10 = ShaderAttrib(),
+                   ShaderAttrib attr11 = ShaderAttrib(),
+                   ShaderAttrib attr12 = ShaderAttrib());
+
+    void SetStream(std::shared_ptr<VertexBuffer> vb, size_t offset,
+                   ShaderAttrib attribs[]);
+
     int GetStreamCount() const;
 
     VertexStreamBase GetStream(int index) const;
@@ -17,4 +17,5 @@
 #include <lol/image/image.h>
 #include <lol/image/resource.h>
 #include <lol/image/movie.h>
+#include <lol/image/fractal.h>
 
@@ -0,0 +1,75 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// The fractal_renderer class
+// --------------------------
+//
+// Renders the Mandelbrot set or a Julia set at very deep zoom levels using
+// perturbation theory: a single reference orbit is computed with real
+// numbers at the view centre, and each pixel only iterates its difference
+// with that orbit, in double or long double precision. A series
+// approximation skips the first iterations that all pixels have in common,
+// and pixels whose orbit gets closer to zero than to the reference orbit
+// are rebased onto the start of the reference, which avoids glitches.
+//
+// Pixel offsets are doubles, so zoom depth is limited to about 1e300. The
+// view centre needs about log10(zoom) + 20 significant digits, which must
+// fit in real::DEFAULT_BIGIT_COUNT.
+//
+
+#include <lol/math/arraynd.h>
+#include <lol/math/real.h>
+#include <lol/math/transform.h>
+
+#include <memory>
+
+namespace lol
+{
+
+class fractal_renderer
+{
+public:
+    struct stats
+    {
+        /* Length of the reference orbit */
+        int reference = 0;
+        /* Iterations skipped by the series approximation */
+        int skipped = 0;
+        /* Iterations computed for all pixels, and number of rebases */
+        int64_t iterations = 0, rebases = 0;
+    };
+
+    fractal_renderer();
+    ~fractal_renderer();
+
+    void set_view(rcmplx const &center, double radius);
+    void set_julia(bool enabled, rcmplx const &c = rcmplx(0.0));
+    void set_max_iterations(int iterations);
+    void set_long_double(bool enabled);
+    void set_series(bool enabled);
+
+    /* Render the point at center + radius * (origin + (x, y) * step) into
+     * out[x][y]. Escaping points get a smooth iteration count, points that
+     * did not escape get -1. Tiles are spread across the thread pool. */
+    void render(array2d<float> &out, dvec2 origin, dvec2 step);
+
+    stats const &get_stats() const;
+
+private:
+    std::unique_ptr<struct fractal_renderer_private> m_private;
+};
+
+} /* namespace lol */
+
@@ -43,6 +43,17 @@ enum class ResampleAlgorithm : uint8_t
 {
     Bicubic,
     Bresenham,
+    /* Separable filters, computed in the image’s own pixel format */
+    Box,
+    Mitchell,
+    CatmullRom,
+    Lanczos3,
+};
+
+enum class MipmapFilter : uint8_t
+{
+    Box,
+    Kaiser,
 };
 
 enum class EdiffAlgorithm : uint8_t
@@ -119,6 +130,9 @@ public:
         static array2d<float> halftone(ivec2 size);
         static array2d<float> blue_noise(ivec2 size,
                                          ivec2 gsize = ivec2(7, 7));
+        /* The same mask, loaded from or saved to a cache directory */
+        static array2d<float> blue_noise(ivec2 size, ivec2 gsize,
+                                         std::string const &cache);
         static array2d<float> ediff(EdiffAlgorithm algorithm);
         static array2d<float> gaussian(vec2 radius,
                                        float angle = 0.f,
@@ -132,6 +146,15 @@ public:
     image Resize(ivec2 size, ResampleAlgorithm algorithm);
     image Crop(ibox2 box) const;
 
+    /* The next level of a mipmap chain, half the size rounded up */
+    image mipmap(MipmapFilter filter) const;
+
+    /* Block compression; sizes that are not multiples of 4 are padded
+     * by repeating the last row and column */
+    array<uint8_t> compress(CompressedFormat format) const;
+    static image decompress(ivec2 size, CompressedFormat format,
+                            span<uint8_t const> blocks);
+
     /* Image processing */
     image AutoContrast() const;
     image Brightness(float val) const;
@@ -148,10 +171,27 @@ public:
     image RGBToYUV() const;
     image YUVToRGB() const;
 
+    /* Distance fields. distance_transform() gives the exact Euclidean
+     * distance, in pixels, to the nearest pixel whose value is at least
+     * threshold, separately for each channel. signed_distance_field()
+     * gives a Y_F32 image where 0.5 is the outline of the mask, and
+     * values reach 0 and 1 at radius pixels outside and inside it. */
+    image distance_transform(float threshold = 0.5f) const;
+    image signed_distance_field(float radius, float threshold = 0.5f) const;
+
+    /* Voronoi diagrams, from the pixels with non-zero alpha, using jump
+     * flooding, which is very close to exact. nearest_seed() gives the
+     * coordinates of the nearest seed, or -1 if there is none, and
+     * voronoi() gives its colour. */
+    array2d<ivec2> nearest_seed() const;
+    image voronoi() const;
+
     /* Dithering */
     image dither_random() const;
     image dither_ediff(array2d<float> const &kernel,
                        ScanMode scan = ScanMode::Raster) const;
+    image dither_ediff(EdiffAlgorithm algorithm,
+                       ScanMode scan = ScanMode::Raster) const;
     image dither_ostromoukhov(ScanMode scan = ScanMode::Raster) const;
     image dither_ordered(array2d<float> const &kernel) const;
     image dither_halftone(float radius, float angle) const;
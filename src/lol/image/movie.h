@@ -31,14 +31,30 @@ namespace lol
 class movie
 {
 public:
-    movie(ivec2 size);
+    movie(ivec2 size, int fps = 30);
+    ~movie();
 
     bool open_file(std::string const &filename);
     bool push_image(image &im);
     void close();
 
+    // Asynchronous interface: fill a frame from the pool with RGBA
+    // pixels and submit it. Frames are converted to 3:3:2 on worker
+    // threads and encoded in order on a dedicated thread, so that the
+    // caller only pays for the copy. When every frame is in flight,
+    // acquire_frame() drops the frame and returns nullptr, unless it
+    // is told to wait. Frames submitted while no file is open are
+    // converted, then discarded.
+    u8vec4 *acquire_frame(bool wait = false);
+    void submit_frame(u8vec4 *frame, bool bottom_up = false);
+
+    int dropped_frames() const { return m_dropped; }
+
 private:
+    friend class movie_pipeline;
+
     bool open_codec();
+    bool encode(uint8_t const *pixels);
 
 private:
     AVFormatContext *m_avformat;
@@ -46,7 +62,11 @@ private:
     AVStream *m_stream;
     AVFrame *m_frame;
     ivec2 m_size;
-    int m_index;
+    int m_fps, m_index;
+
+    class movie_pipeline *m_pipeline;
+    bool m_closed;
+    int m_dropped;
 };
 
 } // namespace lol
@@ -75,5 +75,21 @@ static inline uint8_t BytesPerPixel(PixelFormat format)
 #endif
 };
 
+/* The block compressed formats we can encode; each block covers 4×4
+ * pixels */
+enum class CompressedFormat : uint8_t
+{
+    BC1,        /* DXT1, opaque */
+    BC3,        /* DXT5 */
+    ETC2_RGB8,
+    ETC2_RGBA8, /* ETC2 with EAC alpha */
+};
+
+static inline int BytesPerBlock(CompressedFormat format)
+{
+    return format == CompressedFormat::BC1
+        || format == CompressedFormat::ETC2_RGB8 ? 8 : 16;
+}
+
 } /* namespace lol */
 
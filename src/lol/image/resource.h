@@ -49,6 +49,10 @@ namespace lol
         }
 
         image* m_image = nullptr;
+
+        /* Quality versus speed trade-off for codecs that support it,
+         * from 0 (fastest) to 100 (best quality). */
+        int m_quality = 50;
     };
 
     //ResourceImageData -----------------------------------------------------------
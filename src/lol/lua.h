@@ -19,5 +19,6 @@
 
 // Lua
 #include <lol/../lolua/baselua.h>
+#include <lol/../lolua/luaworld.h>
 #include <lol/../easymesh/easymeshlua.h>
 
@@ -24,6 +24,7 @@
 #include <lol/math/interp.h>
 #include <lol/math/rand.h>
 #include <lol/math/polynomial.h>
+#include <lol/math/remez.h>
 
 #include <lol/math/noise/gradient.h>
 #include <lol/math/noise/perlin.h>
@@ -140,7 +140,7 @@ public:
     {
         ptrdiff_t n = pos[N - 1];
         for (ptrdiff_t i = N - 2; i >= 0; --i)
-            n = pos[i] + m_sizes[i + 1] * n;
+            n = pos[i] + m_sizes[i] * n;
         return super::operator[](n);
     }
 
@@ -157,7 +157,7 @@ public:
     {
         ptrdiff_t n = pos[N - 1];
         for (ptrdiff_t i = N - 2; i >= 0; --i)
-            n = pos[i] + m_sizes[i + 1] * n;
+            n = pos[i] + m_sizes[i] * n;
         return super::operator[](n);
     }
 
@@ -24,6 +24,11 @@
 namespace lol
 {
 
+/* Evaluate a polynomial at many values at once with SIMD code; see
+ * polynomial<T>::eval() for the generic version. */
+void polynomial_eval(span<float const> coeffs, span<float const> x, span<float> out);
+void polynomial_eval(span<double const> coeffs, span<double const> x, span<double> out);
+
 template<typename T>
 struct LOL_ATTR_NODISCARD polynomial
 {
@@ -98,6 +103,40 @@ struct LOL_ATTR_NODISCARD polynomial
         return ret;
     }
 
+    /* Evaluate polynomial using Estrin’s scheme: it needs a few more
+     * multiplications than Horner’s, but its terms do not depend on each
+     * other, so the CPU can compute them in parallel. This is usually
+     * faster for scalars and high degrees. */
+    template<typename U> LOL_ATTR_NODISCARD U eval_estrin(U x) const
+    {
+        if (degree() < 1)
+            return U(leading());
+
+        /* powers[k] = x^(2^k) */
+        U powers[32];
+        powers[0] = x;
+        for (int k = 1; (1 << k) <= degree(); ++k)
+            powers[k] = powers[k - 1] * powers[k - 1];
+        return estrin(powers, 0, degree() + 1);
+    }
+
+    /* Evaluate polynomial at many values at once. Float and double use
+     * SIMD code; other types interleave several Horner chains. */
+    template<typename U> void eval(span<U const> x, span<U> out) const
+    {
+        ASSERT(x.size() == out.size(), "eval() called with %d values for %d results",
+               (int)x.size(), (int)out.size());
+        eval_batch(span<T const>(m_coefficients.data(), m_coefficients.count()), x, out);
+    }
+
+    template<typename U> LOL_ATTR_NODISCARD array<U> eval(array<U> const &x) const
+    {
+        array<U> ret;
+        ret.resize(x.count());
+        eval(span<U const>(x.data(), x.count()), span<U>(ret.data(), ret.count()));
+        return ret;
+    }
+
     polynomial<T> derive() const
     {
         /* No need to reduce the degree after deriving. */
@@ -373,9 +412,22 @@ struct LOL_ATTR_NODISCARD polynomial
             for (int i = 0; i <= n; ++i)
                 ret.m_coefficients.push(T(0));
 
-            for (int i = 0; i <= p.degree(); ++i)
-                for (int j = 0; j <= q.degree(); ++j)
-                    ret.m_coefficients[i + j] += p[i] * q[j];
+            if (p.degree() < KARATSUBA_THRESHOLD || q.degree() < KARATSUBA_THRESHOLD)
+            {
+                for (int i = 0; i <= p.degree(); ++i)
+                    for (int j = 0; j <= q.degree(); ++j)
+                        ret.m_coefficients[i + j] += p[i] * q[j];
+            }
+            else
+            {
+                /* Pad both operands to the same size */
+                int const size = lol::max(p.degree(), q.degree()) + 1;
+                array<T> a(p.m_coefficients), b(q.m_coefficients);
+                a.resize(size, T(0));
+                b.resize(size, T(0));
+                ret.m_coefficients.resize(2 * size - 1, T(0));
+                karatsuba(a.data(), b.data(), size, ret.m_coefficients.data());
+            }
 
             ret.reduce_degree();
         }
@@ -408,6 +460,111 @@ struct LOL_ATTR_NODISCARD polynomial
     }
 
 private:
+    /* Below this degree, schoolbook multiplication is faster */
+    static int const KARATSUBA_THRESHOLD = 32;
+
+    /* Evaluate the count coefficients starting at first, where
+     * powers[k] = x^(2^k), by splitting them at the largest possible
+     * power of two. */
+    template<typename U> U estrin(U const *powers, int first, int count) const
+    {
+        if (count == 1)
+            return U(m_coefficients[first]);
+
+        int k = 0;
+        while ((2 << k) < count)
+            ++k;
+        return estrin(powers, first, 1 << k)
+             + powers[k] * estrin(powers, first + (1 << k), count - (1 << k));
+    }
+
+    static void eval_batch(span<float const> coeffs, span<float const> x, span<float> out)
+    {
+        polynomial_eval(coeffs, x, out);
+    }
+
+    static void eval_batch(span<double const> coeffs, span<double const> x, span<double> out)
+    {
+        polynomial_eval(coeffs, x, out);
+    }
+
+    template<typename U>
+    static void eval_batch(span<T const> coeffs, span<U const> x, span<U> out)
+    {
+        int const d = (int)coeffs.size() - 1;
+        size_t i = 0;
+
+        if (d < 0)
+        {
+            for ( ; i < x.size(); ++i)
+                out[i] = U(T(0));
+            return;
+        }
+
+        for ( ; i + 4 <= x.size(); i += 4)
+        {
+            U r0(coeffs[d]), r1(coeffs[d]), r2(coeffs[d]), r3(coeffs[d]);
+            for (int n = d - 1; n >= 0; --n)
+            {
+                r0 = r0 * x[i] + U(coeffs[n]);
+                r1 = r1 * x[i + 1] + U(coeffs[n]);
+                r2 = r2 * x[i + 2] + U(coeffs[n]);
+                r3 = r3 * x[i + 3] + U(coeffs[n]);
+            }
+            out[i] = r0; out[i + 1] = r1; out[i + 2] = r2; out[i + 3] = r3;
+        }
+
+        for ( ; i < x.size(); ++i)
+        {
+            U r(coeffs[d]);
+            for (int n = d - 1; n >= 0; --n)
+                r = r * x[i] + U(coeffs[n]);
+            out[i] = r;
+        }
+    }
+
+    /* Multiply two polynomials of n coefficients each into out, which
+     * has room for 2n - 1 coefficients, using Karatsuba’s method:
+     *   a = a0 + x^m a1 and b = b0 + x^m b1
+     *   ab = a0b0 + x^m ((a0 + a1)(b0 + b1) - a0b0 - a1b1) + x^2m a1b1
+     * which only needs three half-size products instead of four. */
+    static void karatsuba(T const *a, T const *b, int n, T *out)
+    {
+        if (n <= KARATSUBA_THRESHOLD)
+        {
+            for (int i = 0; i < 2 * n - 1; ++i)
+                out[i] = T(0);
+            for (int i = 0; i < n; ++i)
+                for (int j = 0; j < n; ++j)
+                    out[i + j] += a[i] * b[j];
+            return;
+        }
+
+        int const m = n / 2, h = n - m;
+
+        /* The sums a0 + a1 and b0 + b1, then their product */
+        array<T> tmp;
+        tmp.resize(4 * h - 1);
+        T *sa = tmp.data(), *sb = sa + h, *mid = sb + h;
+        for (int i = 0; i < h; ++i)
+        {
+            sa[i] = i < m ? a[i] + a[m + i] : a[m + i];
+            sb[i] = i < m ? b[i] + b[m + i] : b[m + i];
+        }
+
+        karatsuba(a, b, m, out);
+        out[2 * m - 1] = T(0);
+        karatsuba(a + m, b + m, h, out + 2 * m);
+        karatsuba(sa, sb, h, mid);
+
+        for (int i = 0; i < 2 * m - 1; ++i)
+            mid[i] -= out[i];
+        for (int i = 0; i < 2 * h - 1; ++i)
+            mid[i] -= out[2 * m + i];
+        for (int i = 0; i < 2 * h - 1; ++i)
+            out[m + i] += mid[i];
+    }
+
     /* Enforce the non-zero leading coefficient rule. */
     void reduce_degree()
     {
@@ -168,6 +168,15 @@ public:
         { \
             while (x >>= 1) \
                 m_exponent += 1 op 2 - 1; /* 1 if op is *, -1 if op is / */ \
+            return *this; \
+        } \
+        /* Small integers only need a linear time operation */ \
+        bool const neg = !(x > 0); \
+        uint64_t const ux = neg ? 0 - (uint64_t)x : (uint64_t)x; \
+        if (x && ux <= 0xffffffffu) \
+        { \
+            *this = scale_small((uint32_t)ux, 1 op 2 - 1 > 0); \
+            m_sign ^= neg; \
         } \
         else \
             *this = *this op (Real<T>)x; \
@@ -224,6 +233,9 @@ public:
     static Real<T> const& R_MAX();
 
 private:
+    /* Multiply (or divide) by a nonzero 32-bit integer */
+    Real<T> scale_small(uint32_t x, bool multiply) const;
+
     std::vector<T> m_mantissa;
     exponent_t m_exponent = 0;
     bool m_sign = false, m_nan = false, m_inf = false;
@@ -234,6 +246,10 @@ public:
     static inline int bigit_bits() { return 8 * (int)sizeof(bigit_t); }
     inline int bigit_count() const { return (int)m_mantissa.size(); }
     inline int total_bits() const { return bigit_count() * bigit_bits(); }
+
+    /* The same value with another number of bigits, truncated or padded
+     * with zeroes. Arithmetic operators expect operands of equal size. */
+    Real<T> with_bigits(int count) const;
 };
 
 /*
@@ -255,6 +271,8 @@ template<> LOL_ATTR_NODISCARD real::operator int32_t() const;
 template<> LOL_ATTR_NODISCARD real::operator uint32_t() const;
 template<> LOL_ATTR_NODISCARD real::operator int64_t() const;
 template<> LOL_ATTR_NODISCARD real::operator uint64_t() const;
+template<> real real::scale_small(uint32_t x, bool multiply) const;
+template<> real real::with_bigits(int count) const;
 template<> real real::operator +() const;
 template<> real real::operator -() const;
 template<> real real::operator +(real const &x) const;
@@ -0,0 +1,78 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// The Remez exchange algorithm
+// ----------------------------
+// Find the polynomial of a given degree that minimises the maximum error
+// with a function over an interval. All computations use real numbers, so
+// the result is only limited by the precision of the target type.
+//
+
+#include <lol/math/real.h>
+#include <lol/math/polynomial.h>
+
+#include <functional>
+#include <string>
+
+namespace lol
+{
+
+class remez_solver
+{
+public:
+    typedef std::function<real(real const &)> function;
+
+    remez_solver();
+
+    /* Find the minimax polynomial of the given degree for func over
+     * [a..b]. If a weight function is given, the error is divided by
+     * its value; use func itself as the weight to minimise the relative
+     * error instead of the absolute error. */
+    polynomial<real> run(int degree, real const &a, real const &b,
+                         function const &func,
+                         function const &weight = nullptr);
+
+    /* The maximum error of the last result, before its coefficients
+     * are rounded to the target type */
+    real const &error() const { return m_error; }
+    int iterations() const { return m_iterations; }
+
+    /* C++ code declaring the coefficients of the last result as a
+     * constexpr table, for T in float, double or ldouble */
+    template<typename T> std::string cpp_table(std::string const &name) const;
+
+private:
+    real eval_error(real const &t) const;
+    void solve();
+    void find_zeros();
+    real find_extrema();
+
+    /* The function is studied on [-1..1] with x = m_k1 + m_k2 t */
+    int m_degree, m_iterations;
+    real m_k1, m_k2, m_error, m_scale;
+    function m_func, m_weight;
+
+    /* The control points, where the error alternates in sign, and the
+     * zeros of the error between them */
+    array<real> m_control, m_zeros;
+    polynomial<real> m_estimate, m_result;
+};
+
+template<> std::string remez_solver::cpp_table<float>(std::string const &name) const;
+template<> std::string remez_solver::cpp_table<double>(std::string const &name) const;
+template<> std::string remez_solver::cpp_table<ldouble>(std::string const &name) const;
+
+} /* namespace lol */
+
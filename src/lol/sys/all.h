@@ -17,4 +17,5 @@
 #include <lol/sys/getopt.h>
 #include <lol/sys/init.h>
 #include <lol/sys/file.h>
+#include <lol/sys/pack.h>
 
@@ -65,6 +65,15 @@ protected:
 };
 typedef SafeEnum<StreamTypeBase> StreamType;
 
+//FileHint --------------------------------------------------------------------
+/* Expected access pattern, used by the system to tune read-ahead */
+enum class FileHint
+{
+    Normal,
+    Sequential,
+    Random,
+};
+
 class File
 {
 public:
@@ -78,19 +87,45 @@ public:
     bool IsValid() const;
     void Close();
 
-    int Read(uint8_t *buf, int count);
+    int64_t Read(uint8_t *buf, int64_t count);
     std::string ReadString();
-    int Write(void const *buf, int count);
-    int Write(std::string const &buf);
-    long int GetPosFromStart();
-    void SetPosFromStart(long int pos);
-    long int size();
+    int64_t Write(void const *buf, size_t count);
+    int64_t Write(span<uint8_t const> buf);
+    int64_t Write(std::string const &buf);
+    int64_t GetPosFromStart();
+    void SetPosFromStart(int64_t pos);
+    int64_t size();
     long int GetModificationTime();
 
+    /* Map the whole file in memory and return a read-only view of its
+     * contents, valid until the file is closed. The view is empty if the
+     * file cannot be mapped (empty file, pipe, unsupported platform); use
+     * Read() or a FileReader instead. */
+    span<uint8_t const> Map(FileHint hint = FileHint::Sequential);
+    void SetHint(FileHint hint);
+
 private:
     class FileData *m_data;
 };
 
+/* Read a file from its current position as a sequence of chunks. When
+ * the file can be mapped, the rest of it is returned as a single chunk;
+ * otherwise it goes through a buffer that is reused, so that each chunk
+ * is only valid until the next call to Next(). */
+class FileReader
+{
+public:
+    FileReader(File &file, size_t chunk_size = 64 * 1024);
+
+    /* Return the next chunk, or an empty span at the end of the file */
+    span<uint8_t const> Next();
+
+private:
+    File &m_file;
+    array<uint8_t> m_buffer;
+    bool m_started, m_mapped;
+};
+
 class Directory
 {
 public:
@@ -0,0 +1,107 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// Pack files and the virtual file system
+// --------------------------------------
+// A pack is a single file holding many assets: a header, the blobs, an
+// index sorted by name hash, and the names themselves. Identical blobs
+// are only stored once, each blob is aligned so that stored entries can
+// be used in place from a mapped pack, and entries may be compressed
+// with a built-in LZ77 codec.
+//
+// Mounted packs are consulted by File, Directory and the data directory
+// lookup before the filesystem.
+//
+
+#include <memory>
+#include <string>
+#include <cstdint>
+
+namespace lol
+{
+
+enum class pack_codec : uint16_t
+{
+    none = 0,
+    lz = 1,
+};
+
+class pack
+{
+public:
+    pack();
+    ~pack();
+
+    bool open(std::string const &path);
+    void close();
+    bool is_open() const;
+
+    /* Entry lookup; names use forward slashes and no leading “./” */
+    int count() const;
+    int find(std::string const &name) const;
+    std::string name(int n) const;
+    size_t size(int n) const;
+    pack_codec codec(int n) const;
+    long int modification_time() const;
+
+    /* Return the contents of entry n. Stored entries of a mapped pack
+     * are returned in place; otherwise the data is read or uncompressed
+     * into buffer, and the view is valid as long as buffer is. */
+    span<uint8_t const> read(int n, array<uint8_t> &buffer);
+
+    /* The built-in codec, also usable on its own. lz_decompress() returns
+     * false if the input is corrupt or does not fit in the output. */
+    static array<uint8_t> lz_compress(span<uint8_t const> data);
+    static bool lz_decompress(span<uint8_t const> data, span<uint8_t> out);
+
+private:
+    std::unique_ptr<struct pack_private> m_private;
+};
+
+class pack_writer
+{
+public:
+    pack_writer(uint32_t alignment = 16);
+    ~pack_writer();
+
+    /* Add an entry, replacing any entry with the same name */
+    bool add(std::string const &name, span<uint8_t const> data,
+             bool compress = true);
+    bool save(std::string const &path);
+
+    int count() const;
+    int blob_count() const;
+
+private:
+    std::unique_ptr<struct pack_writer_private> m_private;
+};
+
+namespace sys
+{
+
+/* Packs mounted last take precedence. Files that are still open keep
+ * their pack alive after it is unmounted. */
+extern bool mount_pack(std::string const &path);
+extern void unmount_packs();
+
+/* Low-level lookup used by File and Directory */
+extern std::shared_ptr<pack> vfs_find(std::string const &name, int &index);
+extern bool vfs_list(std::string const &directory,
+                     array<std::string> *files, array<std::string> *dirs);
+
+} /* namespace sys */
+
+} /* namespace lol */
+
@@ -18,6 +18,9 @@
 //
 
 #include <functional>
+#include <atomic>
+#include <memory>
+#include <algorithm>
 
 #if LOL_FEATURE_THREADS
 #   include <thread>
@@ -226,6 +229,73 @@ private:
 #endif
 };
 
+// A lock-free FIFO for exactly one producer thread and one consumer
+// thread, suited for streaming data such as audio samples. Neither
+// side ever blocks; push() and pop() return how many items they could
+// actually transfer.
+template<typename T>
+class spsc_queue
+{
+public:
+    spsc_queue(size_t capacity)
+      : m_capacity(capacity + 1),
+        m_values(new T[capacity + 1]),
+        m_read(0),
+        m_write(0)
+    {}
+
+    size_t capacity() const { return m_capacity - 1; }
+
+    // Approximate when called from a thread that is neither the
+    // producer nor the consumer
+    size_t size() const
+    {
+        size_t w = m_write.load(std::memory_order_acquire);
+        size_t r = m_read.load(std::memory_order_acquire);
+        return w >= r ? w - r : w + m_capacity - r;
+    }
+
+    // Only call from the producer thread
+    size_t push(T const *values, size_t count)
+    {
+        size_t w = m_write.load(std::memory_order_relaxed);
+        size_t r = m_read.load(std::memory_order_acquire);
+        size_t room = (r > w ? r - w : r + m_capacity - w) - 1;
+
+        count = std::min(count, room);
+        size_t first = std::min(count, m_capacity - w);
+        std::copy(values, values + first, m_values.get() + w);
+        std::copy(values + first, values + count, m_values.get());
+
+        m_write.store((w + count) % m_capacity, std::memory_order_release);
+        return count;
+    }
+
+    // Only call from the consumer thread
+    size_t pop(T *values, size_t count)
+    {
+        size_t r = m_read.load(std::memory_order_relaxed);
+        size_t w = m_write.load(std::memory_order_acquire);
+        size_t avail = w >= r ? w - r : w + m_capacity - r;
+
+        count = std::min(count, avail);
+        size_t first = std::min(count, m_capacity - r);
+        std::copy(m_values.get() + r, m_values.get() + r + first, values);
+        std::copy(m_values.get(), m_values.get() + count - first,
+                  values + first);
+
+        m_read.store((r + count) % m_capacity, std::memory_order_release);
+        return count;
+    }
+
+private:
+    size_t const m_capacity;
+    std::unique_ptr<T[]> m_values;
+    // Keep the indices in separate cache lines to avoid false sharing
+    alignas(64) std::atomic<size_t> m_read;
+    alignas(64) std::atomic<size_t> m_write;
+};
+
 // Base class for threads
 class thread
 {
@@ -266,5 +336,38 @@ private:
     std::function<void(thread*)> m_function;
 };
 
+// A pool of worker threads shared by the parallel algorithms. Jobs are
+// split into numbered tasks that the workers and the calling thread
+// claim in turn.
+class thread_pool
+{
+public:
+    thread_pool(int threads = 0);
+    ~thread_pool();
+
+    /* The pool used by the parallel algorithms, with one thread per
+     * hardware thread, including the caller */
+    static thread_pool &shared();
+
+    /* Number of threads that take part in a job, including the caller;
+     * set_max_threads(0) restores the default */
+    int size() const;
+    void set_max_threads(int threads);
+
+    /* In deterministic mode, the parallel algorithms split work the
+     * same way whatever the number of threads, so that floating point
+     * reductions are reproducible. */
+    bool deterministic() const;
+    void set_deterministic(bool deterministic);
+
+    /* Call fn(n) for every n in [0, count) and return once all calls are
+     * done. Calls from within a task, or while another thread is running
+     * a job on the same pool, are run serially by the calling thread. */
+    void run(int count, std::function<void(int)> const &fn);
+
+private:
+    std::unique_ptr<struct thread_pool_private> m_private;
+};
+
 } /* namespace lol */
 
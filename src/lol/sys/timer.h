@@ -1,7 +1,7 @@
 //
 //  Lol Engine
 //
-//  Copyright © 2010—2018 Sam Hocevar <sam@hocevar.net>
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
 //            © 2016 Guillaume Bittoun <guillaume.bittoun@gmail.com>
 //
 //  Lol Engine is free software. It comes without any warranty, to
@@ -13,7 +13,10 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <thread>
 
 //
@@ -33,18 +36,56 @@ public:
     inline float get() { return get_seconds(true); }
     inline float poll() { return get_seconds(false); }
 
+    /* Wait until the given time has elapsed since the last reset. The OS
+     * often wakes sleeping threads a millisecond or more too late, so only
+     * sleep for as long as that is unlikely to happen, then spin. */
     void wait(float seconds)
     {
-        if (seconds > 0.0f)
+        using namespace std::chrono;
+        auto const deadline = m_tp + duration_cast<steady_clock::duration>(duration<float>(seconds));
+
+        for (;;)
         {
-            float secs_elapsed = get_seconds(false);
-            std::this_thread::sleep_for(std::chrono::duration<float>(seconds - secs_elapsed));
+            auto const slack = nanoseconds(wake_slack().load(std::memory_order_relaxed));
+            auto const start = steady_clock::now();
+            if (deadline - start <= slack)
+                break;
+
+            auto const request = deadline - start - slack;
+            std::this_thread::sleep_for(request);
+            update_slack(steady_clock::now() - start - request);
         }
+
+        while (steady_clock::now() < deadline)
+            std::this_thread::yield();
+    }
+
+    /* How late the OS is expected to wake up a sleeping thread */
+    static float get_wake_slack()
+    {
+        return wake_slack().load(std::memory_order_relaxed) * 1e-9f;
     }
 
 private:
     std::chrono::steady_clock::time_point m_tp;
 
+    /* Shared by all timers, in nanoseconds. It starts at 1 ms, quickly
+     * grows towards the oversleeps we see, plus a margin, and slowly
+     * decays otherwise; a single hiccup does not make us spin for long. */
+    static std::atomic<int64_t> &wake_slack()
+    {
+        static std::atomic<int64_t> slack(1000000);
+        return slack;
+    }
+
+    static void update_slack(std::chrono::steady_clock::duration overslept)
+    {
+        int64_t const target = std::chrono::duration_cast<std::chrono::nanoseconds>(overslept).count() * 5 / 4;
+        int64_t const old = wake_slack().load(std::memory_order_relaxed);
+        int64_t const slack = target > old ? old + (target - old) / 4 : old - old / 64;
+        wake_slack().store(std::min(slack, (int64_t)20000000), std::memory_order_relaxed);
+    }
+
     float get_seconds(bool do_reset)
     {
         auto tp = std::chrono::steady_clock::now(), tp0 = m_tp;
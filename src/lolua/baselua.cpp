@@ -15,9 +15,12 @@
 #include <lol/lua.h>
 
 #include <string>
+#include <cstdio>
 #include <cstdlib>
 #include <cctype>
 
+#include "bytecode.h"
+
 //
 // Base Lua class for Lua script loading
 //
@@ -25,6 +28,9 @@
 namespace lol
 {
 
+//Compiled chunks, shared by all Lua states
+static LuaBytecodeCache g_bytecode_cache;
+
 //-----------------------------------------------------------------------------
 class LuaBaseData
 {
@@ -39,10 +45,54 @@ class LuaBaseData
         return 0;
     }
 
+    //Load lua code, from the bytecode cache when possible -------------------
+    static int LuaDumpWriter(lua_State *l, void const *p, size_t size, void *data)
+    {
+        UNUSED(l);
+        static_cast<std::string *>(data)->append((char const *)p, size);
+        return 0;
+    }
+
+    static int LuaLoadCode(lua_State *l, char const *code, size_t size,
+                           std::string const &name)
+    {
+        /* Precompiled code needs no caching */
+        if (size && code[0] == LUA_SIGNATURE[0])
+            return luaL_loadbuffer(l, code, size, name.c_str());
+
+        uint64_t key = LuaBytecodeCache::Hash(code, size, name);
+        std::string chunk;
+        if (g_bytecode_cache.Find(key, chunk))
+        {
+            /* A chunk from another Lua build fails the header check; just
+             * compile the source again */
+            if (luaL_loadbufferx(l, chunk.data(), chunk.length(),
+                                 name.c_str(), "b") == LUA_OK)
+                return LUA_OK;
+            lua_pop(l, 1);
+        }
+
+        int status = luaL_loadbufferx(l, code, size, name.c_str(), "t");
+        if (status == LUA_OK)
+        {
+            chunk.clear();
+            if (lua_dump(l, LuaDumpWriter, &chunk, 0) == 0)
+                g_bytecode_cache.Insert(key, chunk, true);
+        }
+        return status;
+    }
+
     //Exec lua code -----------------------------------------------------------
     static int LuaDoCode(lua_State *l, std::string const& s)
     {
-        int status = luaL_dostring(l, s.c_str());
+        return LuaDoCode(l, s.c_str(), s.length(), s);
+    }
+
+    static int LuaDoCode(lua_State *l, char const *code, size_t size,
+                         std::string const &name)
+    {
+        int status = LuaLoadCode(l, code, size, name)
+                      || lua_pcall(l, 0, LUA_MULTRET, 0);
         if (status == 1)
         {
             auto stack = LuaStack::Begin(l, -1);
@@ -69,11 +119,20 @@ class LuaBaseData
             f.Open(candidate, FileAccess::Read);
             if (f.IsValid())
             {
-                std::string s = f.ReadString();
-                f.Close();
-
                 msg::debug("loading Lua file %s\n", candidate.c_str());
-                status = LuaDoCode(l, s);
+
+                /* Parse straight from the mapped file when possible */
+                span<uint8_t const> code = f.Map(FileHint::Sequential);
+                std::string s;
+                if (code.empty())
+                {
+                    s = f.ReadString();
+                    code = span<uint8_t const>((uint8_t const *)s.data(), s.length());
+                }
+
+                status = LuaDoCode(l, (char const *)code.data(), code.size(),
+                                   "@" + candidate);
+                f.Close();
                 break;
             }
         }
@@ -104,6 +163,10 @@ Loader::Loader()
     lua_atpanic(m_lua_state, LuaBaseData::LuaPanic);
     luaL_openlibs(m_lua_state);
 
+    /* Coroutines copy this from the main thread */
+    *static_cast<Cache **>(lua_getextraspace(m_lua_state)) = &m_cache;
+    RegisterValueTypes(m_lua_state);
+
     /* Override dofile() */
     LuaFunction do_file(m_lua_state, "dofile", LuaBaseData::LuaDoFile);
 
@@ -167,6 +230,45 @@ bool Loader::ExecLuaCode(std::string const &lua)
     return 0 == LuaBaseData::LuaDoCode(m_lua_state, lua);
 }
 
+//-----------------------------------------------------------------------------
+void Loader::SetBytecodeCache(std::string const &directory)
+{
+    g_bytecode_cache.SetDirectory(directory);
+}
+
+//-----------------------------------------------------------------------------
+void Loader::SetGcBudget(float seconds)
+{
+    if (seconds > 0.f && m_gc_budget <= 0.f)
+        lua_gc(m_lua_state, LUA_GCSTOP);
+    else if (seconds <= 0.f && m_gc_budget > 0.f)
+        lua_gc(m_lua_state, LUA_GCRESTART);
+    m_gc_budget = seconds;
+}
+
+void Loader::CollectGarbage()
+{
+    if (m_gc_budget <= 0.f)
+        return;
+
+    /* Steps still run while the collector is stopped. If allocation has
+     * outpaced collection, ignore the budget and finish the cycle. */
+    int const step_kb = 64;
+    int const min_kb = 1024;
+    bool late = lua_gc(m_lua_state, LUA_GCCOUNT) > 2 * lol::max(m_gc_live_kb, min_kb);
+
+    lol::timer t;
+    do
+    {
+        if (lua_gc(m_lua_state, LUA_GCSTEP, step_kb))
+        {
+            m_gc_live_kb = lua_gc(m_lua_state, LUA_GCCOUNT);
+            break;
+        }
+    }
+    while (late || t.poll() < m_gc_budget);
+}
+
 //-----------------------------------------------------------------------------
 lua_State* Loader::GetLuaState()
 {
@@ -19,7 +19,9 @@ extern "C" {
 #include "3rdparty/lua/lauxlib.h"
 }
 
+#include <new>
 #include <string>
+#include <utility>
 
 //
 // Base Lua class for Lua script loading
@@ -28,6 +30,9 @@ extern "C" {
 namespace lol
 {
 
+class LuaWorld;
+class LuaWorldData;
+
 //-----------------------------------------------------------------------------
 namespace Lolua
 {
@@ -41,6 +46,67 @@ typedef struct ClassVar
     lua_CFunction set;
 } ClassVar;
 
+//-----------------------------------------------------------------------------
+// Math types stored by value in userdata, see mathlua.cpp
+//--
+template<typename T> struct ValueType;
+template<> struct ValueType<vec2> { static int const index = 0; static char const *name() { return "vec2"; } };
+template<> struct ValueType<vec3> { static int const index = 1; static char const *name() { return "vec3"; } };
+template<> struct ValueType<vec4> { static int const index = 2; static char const *name() { return "vec4"; } };
+template<> struct ValueType<quat> { static int const index = 3; static char const *name() { return "quat"; } };
+template<> struct ValueType<mat4> { static int const index = 4; static char const *name() { return "mat4"; } };
+
+static int const VALUE_TYPE_COUNT = 5;
+
+//-----------------------------------------------------------------------------
+// Registry references cached for each Lua state. The state's extra space
+// points to this, so type checks compare metatable identities instead of
+// looking up metatables by name.
+//--
+struct Cache
+{
+    static inline Cache *Get(lua_State *l)
+    {
+        return *static_cast<Cache **>(lua_getextraspace(l));
+    }
+
+    static inline void const *GetMetatable(lua_State *l, int index)
+    {
+        if (lua_type(l, index) != LUA_TUSERDATA || !lua_getmetatable(l, index))
+            return nullptr;
+        void const *ret = lua_topointer(l, -1);
+        lua_pop(l, 1);
+        return ret;
+    }
+
+    int m_value_refs[VALUE_TYPE_COUNT] = { LUA_NOREF, LUA_NOREF, LUA_NOREF, LUA_NOREF, LUA_NOREF };
+    void const *m_value_metatables[VALUE_TYPE_COUNT] = { nullptr };
+
+    /* Indexed by Object::Library::m_id */
+    array<int> m_class_refs;
+    array<void const *> m_class_metatables;
+};
+
+//-----------------------------------------------------------------------------
+template<typename T> inline T *TestValue(lua_State *l, int index)
+{
+    void const *mt = Cache::GetMetatable(l, index);
+    if (!mt || mt != Cache::Get(l)->m_value_metatables[ValueType<T>::index])
+        return nullptr;
+    return static_cast<T *>(lua_touserdata(l, index));
+}
+
+template<typename T> inline T *PushValue(lua_State *l, T const &value)
+{
+    /* No user values: the userdata is just the value */
+    T *ret = new (lua_newuserdatauv(l, sizeof(T), 0)) T(value);
+    lua_rawgeti(l, LUA_REGISTRYINDEX, Cache::Get(l)->m_value_refs[ValueType<T>::index]);
+    lua_setmetatable(l, -2);
+    return ret;
+}
+
+void RegisterValueTypes(lua_State *l);
+
 //-----------------------------------------------------------------------------
 class Object
 {
@@ -99,6 +165,8 @@ public:
                 m_variables.push(ClassVarStr());
         }
         std::string m_class_name = "";
+        /* Slot in the per-state Cache, assigned on first registration */
+        mutable int m_id = -1;
         std::string m_static_name = "";
         std::string m_method_name = "";
         array<ClassMethod> m_statics;
@@ -188,8 +256,32 @@ public:
             lua_setfield(l, -2, var.m_set_name.c_str());
         }
 
-        //Don't set it to global, but pop the stack to hide the metatable
-        lua_pop(l, 1);
+        //Cache the instance metatable for New() and type checks
+        const Object::Library* lib = GetLibrary<TLuaClass>();
+        if (lib->m_id < 0)
+            lib->m_id = NewClassId();
+        Cache* cache = Cache::Get(l);
+        if (cache->m_class_refs.count() <= lib->m_id)
+        {
+            cache->m_class_refs.resize(lib->m_id + 1, LUA_NOREF);
+            cache->m_class_metatables.resize(lib->m_id + 1, nullptr);
+        }
+        cache->m_class_metatables[lib->m_id] = lua_topointer(l, -1);
+        cache->m_class_refs[lib->m_id] = luaL_ref(l, LUA_REGISTRYINDEX);
+    }
+
+    //-------------------------------------------------------------------------
+    //Return the object at index if it is a TLuaClass instance, or nullptr
+    template <typename TLuaClass>
+    static TLuaClass** TestObject(lua_State* l, int index)
+    {
+        int id = GetLibrary<TLuaClass>()->m_id;
+        Cache* cache = Cache::Get(l);
+        void const* mt = Cache::GetMetatable(l, index);
+        if (!mt || id < 0 || id >= cache->m_class_metatables.count()
+             || mt != cache->m_class_metatables[id])
+            return nullptr;
+        return static_cast<TLuaClass**>(lua_touserdata(l, index));
     }
 
 private:
@@ -202,6 +294,12 @@ private:
         return lib;
     }
 
+    static int NewClassId()
+    {
+        static int next_id = 0;
+        return next_id++;
+    }
+
 public:
     //-------------------------------------------------------------------------
     template <typename TLuaClass>
@@ -226,11 +324,12 @@ protected:
         int n_args = lua_gettop(l);
 
         //Create user data
-        TLuaClass** data = (TLuaClass**)lua_newuserdata(l, sizeof(TLuaClass*));
+        TLuaClass** data = (TLuaClass**)lua_newuserdatauv(l, sizeof(TLuaClass*), 0);
         *data = TLuaClass::New(l, n_args);
 
         //Retrieve instance table
-        luaL_getmetatable(l, GetMethodName<TLuaClass>());
+        lua_rawgeti(l, LUA_REGISTRYINDEX,
+                    Cache::Get(l)->m_class_refs[GetLibrary<TLuaClass>()->m_id]);
         //Set metatable to instance
         lua_setmetatable(l, -2);
         //Return 1 so Lua will get the UserData and clean the stack.
@@ -330,6 +429,19 @@ public:
         inline Ptr<T>& operator=(T const*& value) { m_value = value; return *this; }
     };
 
+    //-------------------------------------------------------------------------
+    //The encapsulating struct for math values pushed as a single userdata,
+    //see mathlua.cpp. Vectors pushed directly go out as separate numbers.
+    template<typename T>
+    struct Value
+    {
+    public:
+        T m_value;
+
+        Value(T const &value) : m_value(value) { }
+        inline operator T const &() const { return m_value; }
+    };
+
 private:
     bool AllowGet(bool is_optional, bool value_validity)
     {
@@ -377,6 +489,7 @@ public:
     template<typename T> Stack& operator<<(T value) { m_result += InnerPush<T>(value); return *this; }
     template<typename E> Stack& operator<<(SafeEnum<E> value) { m_result += InnerPushSafeEnum<E>(value); return *this; }
     template<typename P> Stack& operator<<(Ptr<P> value) { m_result += InnerPushPtr<P>(value); return *this; }
+    template<typename T> Stack& operator<<(Value<T> value) { PushValue(m_state, value.m_value); m_result += 1; return *this; }
 
 protected:
     //-------------------------------------------------------------------------
@@ -398,9 +511,11 @@ protected:
     template<typename P> inline bool InnerIsValidPtr() { return !!lua_isuserdata(m_state, m_index); }
     template<typename P> inline Ptr<P> InnerGetPtr(Ptr<P> value)
     {
-        P** obj = static_cast<P**>(value.m_throw_error
-                                        ? luaL_checkudata(m_state, m_index++, ObjectHelper::GetMethodName<P>())
-                                        : luaL_testudata(m_state, m_index++, ObjectHelper::GetMethodName<P>()) );
+        //luaL_checkudata is only there to raise the error
+        P** obj = ObjectHelper::TestObject<P>(m_state, m_index);
+        if (!obj && value.m_throw_error)
+            obj = static_cast<P**>(luaL_checkudata(m_state, m_index, ObjectHelper::GetMethodName<P>()));
+        ++m_index;
         return Ptr<P>(obj ? *obj : value.m_value);
     }
     template<typename P> inline int InnerPushPtr(Ptr<P> value)
@@ -556,32 +671,159 @@ template<> inline int Stack::InnerPush<uint32_t>(uint32_t value)     { lua_pushi
 #endif //STACK_UINT32
 
 //-----------------------------------------------------------------------------
+// Vectors are pushed as consecutive numbers, so that existing bindings keep
+// returning as many values as before; use LuaValue<vec3> etc. to push them
+// as userdata instead. They can be read from either form. Quaternions and
+// matrices only exist as userdata.
 #ifndef STACK_VEC2
-template<> inline bool Stack::InnerIsValid<vec2>()       { return InnerIsValid<float>(); }
-template<> inline vec2 Stack::InnerGet<vec2>(vec2 value) { return vec2(InnerGet<float>(value.x), Get<float>(value.y, true)); }
+template<> inline bool Stack::InnerIsValid<vec2>()       { return TestValue<vec2>(m_state, m_index) || InnerIsValid<float>(); }
+template<> inline vec2 Stack::InnerGet<vec2>(vec2 value)
+{
+    if (vec2 const *v = TestValue<vec2>(m_state, m_index))
+    {
+        ++m_index;
+        return *v;
+    }
+    return vec2(InnerGet<float>(value.x), Get<float>(value.y, true));
+}
 template<> inline int Stack::InnerPush<vec2>(vec2 value) { return (InnerPush<float>(value.x) + InnerPush<float>(value.y)); }
 #endif //STACK_VEC2
 
 //-----------------------------------------------------------------------------
 #ifndef STACK_VEC3
-template<> inline bool Stack::InnerIsValid<vec3>()       { return InnerIsValid<float>(); }
-template<> inline vec3 Stack::InnerGet<vec3>(vec3 value) { return vec3(InnerGet<float>(value.x), Get<float>(value.y, true), Get<float>(value.z, true)); }
+template<> inline bool Stack::InnerIsValid<vec3>()       { return TestValue<vec3>(m_state, m_index) || InnerIsValid<float>(); }
+template<> inline vec3 Stack::InnerGet<vec3>(vec3 value)
+{
+    if (vec3 const *v = TestValue<vec3>(m_state, m_index))
+    {
+        ++m_index;
+        return *v;
+    }
+    return vec3(InnerGet<float>(value.x), Get<float>(value.y, true), Get<float>(value.z, true));
+}
 template<> inline int Stack::InnerPush<vec3>(vec3 value) { return (InnerPush<float>(value.x) + InnerPush<float>(value.y) + InnerPush<float>(value.z)); }
 #endif //STACK_VEC3
 
 //-----------------------------------------------------------------------------
 #ifndef STACK_VEC4
-template<> inline bool Stack::InnerIsValid<vec4>()       { return InnerIsValid<float>(); }
-template<> inline vec4 Stack::InnerGet<vec4>(vec4 value) { return vec4(InnerGet<float>(value.x), Get<float>(value.y, true), Get<float>(value.z, true), Get<float>(value.w, true)); }
+template<> inline bool Stack::InnerIsValid<vec4>()       { return TestValue<vec4>(m_state, m_index) || InnerIsValid<float>(); }
+template<> inline vec4 Stack::InnerGet<vec4>(vec4 value)
+{
+    if (vec4 const *v = TestValue<vec4>(m_state, m_index))
+    {
+        ++m_index;
+        return *v;
+    }
+    return vec4(InnerGet<float>(value.x), Get<float>(value.y, true), Get<float>(value.z, true), Get<float>(value.w, true));
+}
 template<> inline int Stack::InnerPush<vec4>(vec4 value) { return (InnerPush<float>(value.x) + InnerPush<float>(value.y) + InnerPush<float>(value.z) + InnerPush<float>(value.w)); }
 #endif // STACK_VEC4
 
+//-----------------------------------------------------------------------------
+#ifndef STACK_QUAT
+template<> inline quat Stack::InnerDefault<quat>()       { return quat(1.f); }
+template<> inline bool Stack::InnerIsValid<quat>()       { return !!TestValue<quat>(m_state, m_index); }
+template<> inline quat Stack::InnerGet<quat>(quat value)
+{
+    quat const *q = TestValue<quat>(m_state, m_index++);
+    return q ? *q : value;
+}
+template<> inline int Stack::InnerPush<quat>(quat value) { PushValue(m_state, value); return 1; }
+#endif // STACK_QUAT
+
+//-----------------------------------------------------------------------------
+#ifndef STACK_MAT4
+template<> inline mat4 Stack::InnerDefault<mat4>()       { return mat4(1.f); }
+template<> inline bool Stack::InnerIsValid<mat4>()       { return !!TestValue<mat4>(m_state, m_index); }
+template<> inline mat4 Stack::InnerGet<mat4>(mat4 value)
+{
+    mat4 const *m = TestValue<mat4>(m_state, m_index++);
+    return m ? *m : value;
+}
+template<> inline int Stack::InnerPush<mat4>(mat4 value) { PushValue(m_state, value); return 1; }
+#endif // STACK_MAT4
+
 #endif //REGION_STACK_VAR
 
+//-----------------------------------------------------------------------------
+// Ref: typed handle to a global variable. The name is interned once in the
+// registry, so reads and writes skip the string lookup of lua_getglobal()
+// while still seeing the variable's current value. A Ref must not outlive
+// its Loader.
+//--
+template<typename T>
+class Ref
+{
+public:
+    Ref() { }
+    Ref(lua_State* l, std::string const &name)
+      : m_state(l)
+    {
+        lua_pushstring(l, name.c_str());
+        m_key = luaL_ref(l, LUA_REGISTRYINDEX);
+    }
+
+    Ref(Ref const &) = delete;
+    Ref& operator=(Ref const &) = delete;
+    Ref(Ref&& other) { *this = std::move(other); }
+    Ref& operator=(Ref&& other)
+    {
+        std::swap(m_state, other.m_state);
+        std::swap(m_key, other.m_key);
+        return *this;
+    }
+
+    ~Ref()
+    {
+        if (m_state)
+            luaL_unref(m_state, LUA_REGISTRYINDEX, m_key);
+    }
+
+    bool IsValid() const { return m_state != nullptr; }
+
+    T Get()
+    {
+        PushGlobals();
+        lua_gettable(m_state, -2);
+        auto stack = Lolua::Stack::Begin(m_state, -1);
+        T result = stack.Get<T>();
+        lua_pop(m_state, 2);
+        return result;
+    }
+
+    void Set(T value)
+    {
+        PushGlobals();
+        auto stack = Lolua::Stack::Begin(m_state);
+        Push(stack, value);
+        lua_settable(m_state, -3);
+        lua_pop(m_state, 1);
+    }
+
+private:
+    //A global holds one value, so vectors go out as userdata
+    template<typename U> static void Push(Stack &stack, U const &value) { stack << value; }
+    static void Push(Stack &stack, vec2 const &value) { stack << Stack::Value<vec2>(value); }
+    static void Push(Stack &stack, vec3 const &value) { stack << Stack::Value<vec3>(value); }
+    static void Push(Stack &stack, vec4 const &value) { stack << Stack::Value<vec4>(value); }
+
+    //Push the globals table, then the key
+    void PushGlobals()
+    {
+        lua_rawgeti(m_state, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+        lua_rawgeti(m_state, LUA_REGISTRYINDEX, m_key);
+    }
+
+    lua_State* m_state = nullptr;
+    int m_key = LUA_NOREF;
+};
+
 //-----------------------------------------------------------------------------
 class Loader
 {
     friend class ObjectHelper;
+    friend class lol::LuaWorld;
+    friend class lol::LuaWorldData;
 public:
     Loader();
     virtual ~Loader();
@@ -589,6 +831,15 @@ public:
     bool ExecLuaFile(std::string const &lua);
     bool ExecLuaCode(std::string const &lua);
 
+    //Compiled chunks are cached in memory, and in this directory across
+    //runs if it is not empty
+    static void SetBytecodeCache(std::string const &directory);
+
+    //With a non-zero budget, the collector no longer runs on its own and
+    //CollectGarbage() advances it for at most that many seconds per call
+    void SetGcBudget(float seconds);
+    void CollectGarbage();
+
     //-------------------------------------------------------------------------
 #define DECLARE_LOADER_GET(T0, T1, GET_NAME) \
     template<typename T0> \
@@ -607,6 +858,13 @@ public:
 
 #undef DECLARE_LOADER_GET
 
+    //Handle for globals read or written repeatedly
+    template<typename T>
+    Ref<T> GetRef(std::string const &name)
+    {
+        return Ref<T>(m_lua_state, name);
+    }
+
 protected:
     lua_State* GetLuaState();
     static void Store(lua_State* l, Loader* loader);
@@ -617,6 +875,9 @@ protected:
 
 private:
     lua_State* m_lua_state;
+    Cache m_cache;
+    float m_gc_budget = 0.f;
+    int m_gc_live_kb = 0;
 };
 
 //-----------------------------------------------------------------------------
@@ -652,5 +913,7 @@ typedef Lolua::Object::Library  LuaObjectLibrary;
 typedef Lolua::Loader           LuaLoader;
 typedef Lolua::Stack            LuaStack;
 template <typename P> using LuaPtr = Lolua::Stack::Ptr<P>;
+template <typename T> using LuaValue = Lolua::Stack::Value<T>;
+template <typename T> using LuaRef = Lolua::Ref<T>;
 
 } /* namespace lol */
@@ -0,0 +1,159 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+#include <lol/lua.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include "bytecode.h"
+
+namespace lol
+{
+
+/* The header of saved chunks; files are only read back on the machine
+ * that wrote them, so it is stored in native byte order. */
+struct bytecode_header
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t key, size, checksum;
+};
+
+static char const BYTECODE_MAGIC[4] = { 'L', 'o', 'l', 'C' };
+static uint32_t const BYTECODE_VERSION = 1;
+
+static uint64_t fnv1a(void const *data, size_t len,
+                      uint64_t h = 0xcbf29ce484222325ull)
+{
+    uint8_t const *p = (uint8_t const *)data;
+    for (size_t i = 0; i < len; ++i)
+        h = (h ^ p[i]) * 0x100000001b3ull;
+    return h;
+}
+
+static std::string cache_path(std::string const &directory, uint64_t key)
+{
+    if (directory.empty())
+        return "";
+    return directory + format("/%016llx.luac", (unsigned long long)key);
+}
+
+void LuaBytecodeCache::SetDirectory(std::string const &directory)
+{
+    m_mutex.lock();
+    m_directory = directory;
+    m_mutex.unlock();
+}
+
+uint64_t LuaBytecodeCache::Hash(char const *code, size_t size,
+                                std::string const &name)
+{
+    /* The Lua version and pointer size are part of the key because they
+     * change the bytecode format */
+    int const version[] = { LUA_VERSION_NUM, (int)sizeof(void *) };
+    uint64_t h = fnv1a(version, sizeof(version));
+    h = fnv1a(name.c_str(), name.length() + 1, h);
+    return fnv1a(code, size, h);
+}
+
+bool LuaBytecodeCache::Find(uint64_t key, std::string &chunk)
+{
+    m_mutex.lock();
+    auto it = m_chunks.find(key);
+    bool found = it != m_chunks.end();
+    if (found)
+        chunk = it->second;
+    std::string path = found ? "" : cache_path(m_directory, key);
+    m_mutex.unlock();
+
+    if (path.empty())
+        return found;
+
+    File f;
+    f.Open(path, FileAccess::Read, true);
+    if (!f.IsValid())
+        return false;
+    std::string data = f.ReadString();
+    f.Close();
+
+    /* Anything that was not written by Insert() for this very source
+     * is ignored; the caller then compiles the source and saves it again */
+    bytecode_header h;
+    if (data.length() <= sizeof(h))
+        return false;
+    memcpy(&h, data.data(), sizeof(h));
+    if (memcmp(h.magic, BYTECODE_MAGIC, sizeof(h.magic)) != 0
+         || h.version != BYTECODE_VERSION || h.key != key
+         || h.size != data.length() - sizeof(h)
+         || h.checksum != fnv1a(data.data() + sizeof(h), (size_t)h.size))
+    {
+        msg::debug("ignoring damaged Lua bytecode %s\n", path.c_str());
+        return false;
+    }
+
+    chunk = data.substr(sizeof(h));
+    Insert(key, chunk, false);
+    return true;
+}
+
+void LuaBytecodeCache::Insert(uint64_t key, std::string const &chunk, bool save)
+{
+    m_mutex.lock();
+    /* Forget everything rather than grow forever with one-off code */
+    if (m_chunks.size() >= MAX_CHUNKS)
+        m_chunks.clear();
+    m_chunks[key] = chunk;
+    std::string path = save ? cache_path(m_directory, key) : "";
+    m_mutex.unlock();
+
+    if (path.empty())
+        return;
+
+    bytecode_header h;
+    memcpy(h.magic, BYTECODE_MAGIC, sizeof(h.magic));
+    h.version = BYTECODE_VERSION;
+    h.key = key;
+    h.size = chunk.length();
+    h.checksum = fnv1a(chunk.data(), chunk.length());
+
+    /* Write then rename, so that readers never see partial files. On
+     * Windows, rename() does not replace a damaged file, so remove it. */
+    std::string tmp = path + ".tmp";
+    File f;
+    f.Open(tmp, FileAccess::Write, true);
+    if (f.IsValid())
+    {
+        bool ok = f.Write(&h, sizeof(h)) == (int64_t)sizeof(h)
+                   && f.Write(chunk) == (int64_t)chunk.length();
+        f.Close();
+        if (ok && std::rename(tmp.c_str(), path.c_str()) != 0)
+        {
+            std::remove(path.c_str());
+            ok = std::rename(tmp.c_str(), path.c_str()) == 0;
+        }
+        if (!ok)
+            std::remove(tmp.c_str());
+    }
+}
+
+std::string LuaBytecodeCache::GetPath(uint64_t key)
+{
+    m_mutex.lock();
+    std::string path = cache_path(m_directory, key);
+    m_mutex.unlock();
+    return path;
+}
+
+} /* namespace lol */
+
@@ -0,0 +1,58 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// The Lua bytecode cache
+// ----------------------
+// Compiled chunks, keyed by a hash of the chunk name and source. They are
+// shared by all Lua states, which may live on different threads, and may
+// be saved to a directory to skip parsing on the next run.
+//
+// Lua does not verify bytecode, so a damaged chunk can crash the process.
+// Each saved file starts with a header holding its key and the size and
+// checksum of the chunk; files that do not match are ignored, and the
+// caller compiles the source again. The checksum catches damaged files,
+// not malicious ones: the directory must not be writable by others.
+//
+
+#include <map>
+#include <string>
+
+namespace lol
+{
+
+class LuaBytecodeCache
+{
+public:
+    void SetDirectory(std::string const &directory);
+
+    /* 64-bit FNV-1a of the source and chunk name */
+    static uint64_t Hash(char const *code, size_t size, std::string const &name);
+
+    bool Find(uint64_t key, std::string &chunk);
+    void Insert(uint64_t key, std::string const &chunk, bool save);
+
+    /* Where the chunk for this key is saved, or an empty string */
+    std::string GetPath(uint64_t key);
+
+private:
+    static size_t const MAX_CHUNKS = 256;
+
+    mutex m_mutex;
+    std::string m_directory;
+    std::map<uint64_t, std::string> m_chunks;
+};
+
+} /* namespace lol */
+
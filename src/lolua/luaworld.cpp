@@ -0,0 +1,219 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+#include <lol/lua.h>
+
+namespace lol
+{
+
+/*
+ * LuaWorld implementation class
+ */
+
+class LuaWorldData
+{
+    friend class LuaWorld;
+
+    //Ticker.Add(f): call f(seconds) every tick --------------------------------
+    static int TickerAdd(lua_State *l)
+    {
+        luaL_checktype(l, 1, LUA_TFUNCTION);
+        lua_pushvalue(l, 1);
+        lua_rawseti(l, lua_upvalueindex(1),
+                    (lua_Integer)lua_rawlen(l, lua_upvalueindex(1)) + 1);
+        return 0;
+    }
+
+    //Ticker.Remove(f): the slot is only compacted after ticking, so that
+    //callbacks may remove themselves
+    static int TickerRemove(lua_State *l)
+    {
+        int n = (int)lua_rawlen(l, lua_upvalueindex(1));
+        for (int i = 1; i <= n; ++i)
+        {
+            lua_rawgeti(l, lua_upvalueindex(1), i);
+            bool found = lua_rawequal(l, -1, 1);
+            lua_pop(l, 1);
+            if (found)
+            {
+                lua_pushboolean(l, 0);
+                lua_rawseti(l, lua_upvalueindex(1), i);
+                break;
+            }
+        }
+        return 0;
+    }
+
+    void Tick(float seconds)
+    {
+        lua_State *l = m_loader->GetLuaState();
+
+        lua_rawgeti(l, LUA_REGISTRYINDEX, m_callbacks);
+        int const n = (int)lua_rawlen(l, -1);
+        bool holes = false;
+        for (int i = 1; i <= n; ++i)
+        {
+            /* Functions added during the tick run from the next one */
+            if (lua_rawgeti(l, -1, i) != LUA_TFUNCTION)
+            {
+                holes = true;
+                lua_pop(l, 1);
+                continue;
+            }
+
+            lua_pushnumber(l, seconds);
+            if (lua_pcall(l, 1, 0, 0) != LUA_OK)
+            {
+                msg::error("Lua error %s\n", lua_tostring(l, -1));
+                lua_pop(l, 1);
+            }
+        }
+
+        if (holes)
+        {
+            int dst = 1, count = (int)lua_rawlen(l, -1);
+            for (int src = 1; src <= count; ++src)
+            {
+                if (lua_rawgeti(l, -1, src) == LUA_TFUNCTION)
+                    lua_rawseti(l, -2, dst++);
+                else
+                    lua_pop(l, 1);
+            }
+            for (; dst <= count; ++dst)
+            {
+                lua_pushnil(l);
+                lua_rawseti(l, -2, dst);
+            }
+        }
+        lua_pop(l, 1);
+
+        m_loader->CollectGarbage();
+    }
+
+    Lolua::Loader *m_loader;
+    int m_callbacks = LUA_NOREF;
+
+#if LOL_FEATURE_THREADS
+    /* One job at a time: the frame time to tick, then a completion */
+    thread *m_thread = nullptr;
+    queue<float, 1> m_jobs;
+    queue<int, 1> m_done;
+#endif
+    bool m_pending = false;
+};
+
+/*
+ * Public LuaWorld class
+ */
+
+LuaWorld::LuaWorld(Lolua::Loader *loader, tickable::group::game group)
+  : m_data(new LuaWorldData())
+{
+    m_gamegroup = group;
+    m_data->m_loader = loader ? loader : new Lolua::Loader();
+
+    //Create the Ticker table, whose functions share the callback list
+    lua_State *l = m_data->m_loader->GetLuaState();
+    lua_newtable(l);
+    lua_newtable(l);
+    lua_pushvalue(l, -1);
+    m_data->m_callbacks = luaL_ref(l, LUA_REGISTRYINDEX);
+    lua_pushvalue(l, -1);
+    lua_pushcclosure(l, LuaWorldData::TickerAdd, 1);
+    lua_setfield(l, -3, "Add");
+    lua_pushcclosure(l, LuaWorldData::TickerRemove, 1);
+    lua_setfield(l, -2, "Remove");
+    lua_setglobal(l, "Ticker");
+}
+
+LuaWorld::~LuaWorld()
+{
+    SetThreaded(false);
+    delete m_data->m_loader;
+    delete m_data;
+}
+
+Lolua::Loader &LuaWorld::GetLoader()
+{
+    return *m_data->m_loader;
+}
+
+void LuaWorld::SetGcBudget(float seconds)
+{
+    Wait();
+    m_data->m_loader->SetGcBudget(seconds);
+}
+
+void LuaWorld::SetThreaded(bool threaded)
+{
+#if LOL_FEATURE_THREADS
+    Wait();
+    if (threaded && !m_data->m_thread)
+    {
+        /* A negative frame time stops the thread */
+        m_data->m_thread = new thread([this](thread *)
+        {
+            for (float seconds = m_data->m_jobs.pop(); seconds >= 0.f;
+                 seconds = m_data->m_jobs.pop())
+            {
+                m_data->Tick(seconds);
+                m_data->m_done.push(0);
+            }
+        });
+    }
+    else if (!threaded && m_data->m_thread)
+    {
+        m_data->m_jobs.push(-1.f);
+        delete m_data->m_thread; // This joins the thread
+        m_data->m_thread = nullptr;
+    }
+#else
+    UNUSED(threaded);
+#endif
+}
+
+void LuaWorld::Wait()
+{
+#if LOL_FEATURE_THREADS
+    if (m_data->m_pending)
+        m_data->m_done.pop();
+#endif
+    m_data->m_pending = false;
+}
+
+void LuaWorld::tick_game(float seconds)
+{
+    super::tick_game(seconds);
+
+#if LOL_FEATURE_THREADS
+    if (m_data->m_thread)
+    {
+        /* Ticks never overlap, so a slow world delays the next frame
+         * rather than falling behind */
+        Wait();
+        m_data->m_jobs.push(seconds);
+        m_data->m_pending = true;
+        return;
+    }
+#endif
+
+    m_data->Tick(seconds);
+}
+
+std::string LuaWorld::GetName() const
+{
+    return "<luaworld>";
+}
+
+} /* namespace lol */
+
@@ -0,0 +1,64 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// The LuaWorld class
+// ------------------
+// A LuaWorld is an entity that owns a Lua state and calls the functions
+// scripts registered with Ticker.Add(function(seconds) ... end) every game
+// tick, followed by a time-budgeted garbage collection step. Each world is
+// independent, and threaded worlds tick on their own thread, overlapping
+// with the rest of the frame.
+//
+
+namespace lol
+{
+
+class LuaWorldData;
+
+class LuaWorld : public entity
+{
+    typedef entity super;
+
+public:
+    /* The world takes ownership of the loader; by default it creates a
+     * plain Lolua::Loader */
+    LuaWorld(Lolua::Loader *loader = nullptr,
+             tickable::group::game group = tickable::group::game::entity);
+    virtual ~LuaWorld();
+
+    Lolua::Loader &GetLoader();
+
+    /* Time given to the garbage collector after each tick, or 0 to let
+     * Lua collect whenever it wants */
+    void SetGcBudget(float seconds);
+
+    /* A threaded world starts its tick in tick_game() and completes it
+     * in the background, so C++ code must call Wait() before touching
+     * its Lua state. */
+    void SetThreaded(bool threaded);
+    void Wait();
+
+    /* Inherited from entity */
+    virtual std::string GetName() const;
+
+protected:
+    virtual void tick_game(float seconds);
+
+private:
+    LuaWorldData *m_data;
+};
+
+} /* namespace lol */
+
@@ -0,0 +1,492 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2017—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+#include <lol/lua.h>
+
+#include <cstring>
+#include <string>
+
+//
+// Lua value types for vectors, quaternions and matrices
+// -----------------------------------------------------
+// Values live directly in the userdata block, and all operators are
+// implemented in C++. The global “vec3” etc. tables hold the methods and
+// are callable as constructors, so both v:length() and vec3.length(v)
+// work, as well as vec3(1, 2, 3).
+//
+
+namespace lol
+{
+
+namespace Lolua
+{
+
+//-----------------------------------------------------------------------------
+// Return the argument at index, or raise a Lua error with the type name
+template<typename T> static T &check(lua_State *l, int index)
+{
+    if (T *v = TestValue<T>(l, index))
+        return *v;
+    return *static_cast<T *>(luaL_checkudata(l, index, ValueType<T>::name()));
+}
+
+template<typename T> static int push(lua_State *l, T const &value)
+{
+    PushValue(l, value);
+    return 1;
+}
+
+static float checkfloat(lua_State *l, int index)
+{
+    return (float)luaL_checknumber(l, index);
+}
+
+//-----------------------------------------------------------------------------
+// Map a one-letter field name or a 1-based index to a component index,
+// or return -1.
+static int component(lua_State *l, int index, int count,
+                     char const *names, char const *alt_names)
+{
+    if (lua_type(l, index) == LUA_TNUMBER)
+    {
+        lua_Integer i = lua_tointeger(l, index);
+        return i >= 1 && i <= count ? (int)i - 1 : -1;
+    }
+
+    size_t len;
+    char const *key = lua_type(l, index) == LUA_TSTRING
+                    ? lua_tolstring(l, index, &len) : nullptr;
+    if (!key || len != 1 || !key[0])
+        return -1;
+
+    char const *p = strchr(names, key[0]);
+    if (p)
+        return p - names < count ? (int)(p - names) : -1;
+    p = alt_names ? strchr(alt_names, key[0]) : nullptr;
+    return p && p - alt_names < count ? (int)(p - alt_names) : -1;
+}
+
+// Field names in storage order; quaternions are stored wxyz
+template<typename T> static char const *fields() { return "xyzw"; }
+template<> char const *fields<quat>() { return "wxyz"; }
+template<typename T> static char const *alt_fields() { return "rgba"; }
+template<> char const *alt_fields<quat>() { return nullptr; }
+
+//-----------------------------------------------------------------------------
+// Metamethods shared by vectors and quaternions
+
+template<typename T> static int value_index(lua_State *l)
+{
+    T const &v = *static_cast<T const *>(lua_touserdata(l, 1));
+    int i = component(l, 2, T::count, fields<T>(), alt_fields<T>());
+    if (i >= 0)
+    {
+        lua_pushnumber(l, v[i]);
+        return 1;
+    }
+
+    /* Not a component: look in the class table */
+    lua_pushvalue(l, 2);
+    lua_rawget(l, lua_upvalueindex(1));
+    return 1;
+}
+
+template<typename T> static int value_newindex(lua_State *l)
+{
+    T &v = *static_cast<T *>(lua_touserdata(l, 1));
+    int i = component(l, 2, T::count, fields<T>(), alt_fields<T>());
+    if (i < 0)
+        return luaL_error(l, "invalid %s field", ValueType<T>::name());
+    v[i] = checkfloat(l, 3);
+    return 0;
+}
+
+template<typename T> static int value_tostring(lua_State *l)
+{
+    T const &v = check<T>(l, 1);
+    std::string s = std::string(ValueType<T>::name()) + "(";
+    for (int i = 0; i < T::count; ++i)
+        s += format(i ? ", %g" : "%g", v[i]);
+    s += ")";
+    lua_pushlstring(l, s.c_str(), s.length());
+    return 1;
+}
+
+template<typename T> static int value_unpack(lua_State *l)
+{
+    T const &v = check<T>(l, 1);
+    for (int i = 0; i < T::count; ++i)
+        lua_pushnumber(l, v[i]);
+    return T::count;
+}
+
+template<typename T> static int value_eq(lua_State *l)
+{
+    /* Both operands are userdata, but not necessarily of type T */
+    T const *a = TestValue<T>(l, 1), *b = TestValue<T>(l, 2);
+    lua_pushboolean(l, a && b && *a == *b);
+    return 1;
+}
+
+template<typename T> static int value_add(lua_State *l) { return push(l, check<T>(l, 1) + check<T>(l, 2)); }
+template<typename T> static int value_sub(lua_State *l) { return push(l, check<T>(l, 1) - check<T>(l, 2)); }
+template<typename T> static int value_unm(lua_State *l) { return push(l, -check<T>(l, 1)); }
+
+template<typename T> static int value_length(lua_State *l) { lua_pushnumber(l, length(check<T>(l, 1))); return 1; }
+template<typename T> static int value_normalize(lua_State *l) { return push(l, normalize(check<T>(l, 1))); }
+template<typename T> static int value_dot(lua_State *l) { lua_pushnumber(l, dot(check<T>(l, 1), check<T>(l, 2))); return 1; }
+
+//-----------------------------------------------------------------------------
+// Vectors
+
+template<typename T> static int vec_new(lua_State *l)
+{
+    /* Argument 1 is the class table, since this is __call */
+    int args = lua_gettop(l) - 1;
+    T ret(0.f);
+    if (args == 1 && TestValue<T>(l, 2))
+        ret = *TestValue<T>(l, 2);
+    else if (args == 1)
+        ret = T(checkfloat(l, 2));
+    else
+        for (int i = 0; i < args && i < T::count; ++i)
+            ret[i] = checkfloat(l, i + 2);
+    return push(l, ret);
+}
+
+template<typename T> static int vec_mul(lua_State *l)
+{
+    if (lua_type(l, 1) == LUA_TNUMBER)
+        return push(l, checkfloat(l, 1) * check<T>(l, 2));
+    if (lua_type(l, 2) == LUA_TNUMBER)
+        return push(l, check<T>(l, 1) * checkfloat(l, 2));
+    return push(l, check<T>(l, 1) * check<T>(l, 2));
+}
+
+template<typename T> static int vec_div(lua_State *l)
+{
+    if (lua_type(l, 1) == LUA_TNUMBER)
+        return push(l, T(checkfloat(l, 1)) / check<T>(l, 2));
+    if (lua_type(l, 2) == LUA_TNUMBER)
+        return push(l, check<T>(l, 1) / checkfloat(l, 2));
+    return push(l, check<T>(l, 1) / check<T>(l, 2));
+}
+
+template<typename T> static int vec_distance(lua_State *l)
+{
+    lua_pushnumber(l, distance(check<T>(l, 1), check<T>(l, 2)));
+    return 1;
+}
+
+template<typename T> static int vec_mix(lua_State *l)
+{
+    return push(l, mix(check<T>(l, 1), check<T>(l, 2), checkfloat(l, 3)));
+}
+
+static int vec3_cross(lua_State *l)
+{
+    return push(l, cross(check<vec3>(l, 1), check<vec3>(l, 2)));
+}
+
+//-----------------------------------------------------------------------------
+// Quaternions
+
+static int quat_new(lua_State *l)
+{
+    int args = lua_gettop(l) - 1;
+    if (args == 0)
+        return push(l, quat(1.f));
+    if (args == 1 && TestValue<quat>(l, 2))
+        return push(l, *TestValue<quat>(l, 2));
+    if (args == 1)
+        return push(l, quat(mat3(check<mat4>(l, 2))));
+    return push(l, quat(checkfloat(l, 2), checkfloat(l, 3),
+                        checkfloat(l, 4), checkfloat(l, 5)));
+}
+
+static int quat_mul(lua_State *l)
+{
+    if (lua_type(l, 1) == LUA_TNUMBER)
+        return push(l, checkfloat(l, 1) * check<quat>(l, 2));
+    if (lua_type(l, 2) == LUA_TNUMBER)
+        return push(l, check<quat>(l, 1) * checkfloat(l, 2));
+    if (vec3 const *v = TestValue<vec3>(l, 2))
+        return push(l, check<quat>(l, 1).transform(*v));
+    return push(l, check<quat>(l, 1) * check<quat>(l, 2));
+}
+
+static int quat_div(lua_State *l)
+{
+    return push(l, check<quat>(l, 1) / checkfloat(l, 2));
+}
+
+static int quat_rotate(lua_State *l)
+{
+    /* Either (radians, axis) or (src, dst) */
+    if (lua_type(l, 1) == LUA_TNUMBER)
+        return push(l, quat::rotate(checkfloat(l, 1), check<vec3>(l, 2)));
+    return push(l, quat::rotate(check<vec3>(l, 1), check<vec3>(l, 2)));
+}
+
+static int quat_conjugate(lua_State *l) { return push(l, ~check<quat>(l, 1)); }
+static int quat_inverse(lua_State *l) { return push(l, inverse(check<quat>(l, 1))); }
+static int quat_transform(lua_State *l) { return push(l, check<quat>(l, 1).transform(check<vec3>(l, 2))); }
+
+static int quat_slerp(lua_State *l)
+{
+    return push(l, slerp(check<quat>(l, 1), check<quat>(l, 2), checkfloat(l, 3)));
+}
+
+//-----------------------------------------------------------------------------
+// Matrices
+
+static int mat4_new(lua_State *l)
+{
+    int args = lua_gettop(l) - 1;
+    if (args == 0)
+        return push(l, mat4(1.f));
+    if (args == 1 && lua_type(l, 2) == LUA_TNUMBER)
+        return push(l, mat4(checkfloat(l, 2)));
+    if (args == 1 && TestValue<quat>(l, 2))
+        return push(l, mat4(*TestValue<quat>(l, 2)));
+    if (args == 1)
+        return push(l, check<mat4>(l, 2));
+    return push(l, mat4(check<vec4>(l, 2), check<vec4>(l, 3),
+                        check<vec4>(l, 4), check<vec4>(l, 5)));
+}
+
+static int mat4_index(lua_State *l)
+{
+    mat4 const &m = *static_cast<mat4 const *>(lua_touserdata(l, 1));
+    int i = component(l, 2, 4, "", nullptr);
+    if (i >= 0)
+        return push(l, m[i]);
+
+    lua_pushvalue(l, 2);
+    lua_rawget(l, lua_upvalueindex(1));
+    return 1;
+}
+
+static int mat4_newindex(lua_State *l)
+{
+    mat4 &m = *static_cast<mat4 *>(lua_touserdata(l, 1));
+    int i = component(l, 2, 4, "", nullptr);
+    if (i < 0)
+        return luaL_error(l, "invalid mat4 column");
+    m[i] = check<vec4>(l, 3);
+    return 0;
+}
+
+static int mat4_tostring(lua_State *l)
+{
+    mat4 const &m = check<mat4>(l, 1);
+    std::string s = "mat4(";
+    for (int i = 0; i < 4; ++i)
+        s += format(i ? ", (%g, %g, %g, %g)" : "(%g, %g, %g, %g)",
+                    m[i].x, m[i].y, m[i].z, m[i].w);
+    s += ")";
+    lua_pushlstring(l, s.c_str(), s.length());
+    return 1;
+}
+
+static int mat4_eq(lua_State *l)
+{
+    mat4 const *a = TestValue<mat4>(l, 1), *b = TestValue<mat4>(l, 2);
+    bool ret = a && b;
+    for (int i = 0; ret && i < 4; ++i)
+        ret = (*a)[i] == (*b)[i];
+    lua_pushboolean(l, ret);
+    return 1;
+}
+
+static int mat4_mul(lua_State *l)
+{
+    mat4 const &m = check<mat4>(l, 1);
+    if (vec4 const *v = TestValue<vec4>(l, 2))
+        return push(l, m * *v);
+    /* vec3 operands are points */
+    if (vec3 const *v = TestValue<vec3>(l, 2))
+        return push(l, vec3((m * vec4(*v, 1.f)).xyz));
+    return push(l, m * check<mat4>(l, 2));
+}
+
+static int mat4_add(lua_State *l) { return push(l, check<mat4>(l, 1) + check<mat4>(l, 2)); }
+static int mat4_sub(lua_State *l) { return push(l, check<mat4>(l, 1) - check<mat4>(l, 2)); }
+static int mat4_unm(lua_State *l) { return push(l, -check<mat4>(l, 1)); }
+static int mat4_inverse(lua_State *l) { return push(l, inverse(check<mat4>(l, 1))); }
+static int mat4_transpose(lua_State *l) { return push(l, transpose(check<mat4>(l, 1))); }
+
+static int mat4_translate(lua_State *l)
+{
+    if (lua_type(l, 1) == LUA_TNUMBER)
+        return push(l, mat4::translate(checkfloat(l, 1), checkfloat(l, 2), checkfloat(l, 3)));
+    return push(l, mat4::translate(check<vec3>(l, 1)));
+}
+
+static int mat4_rotate(lua_State *l)
+{
+    return push(l, mat4::rotate(checkfloat(l, 1), check<vec3>(l, 2)));
+}
+
+static int mat4_scale(lua_State *l)
+{
+    if (lua_type(l, 1) == LUA_TNUMBER)
+        return push(l, mat4::scale(checkfloat(l, 1)));
+    return push(l, mat4::scale(check<vec3>(l, 1)));
+}
+
+static int mat4_lookat(lua_State *l)
+{
+    return push(l, mat4::lookat(check<vec3>(l, 1), check<vec3>(l, 2), check<vec3>(l, 3)));
+}
+
+//-----------------------------------------------------------------------------
+template<typename T>
+static void register_type(lua_State *l, luaL_Reg const *metamethods,
+                          luaL_Reg const *methods, lua_CFunction ctor,
+                          lua_CFunction index)
+{
+    Cache *cache = Cache::Get(l);
+    int const n = ValueType<T>::index;
+
+    //Class table, with the constructor as __call
+    lua_newtable(l);
+    luaL_setfuncs(l, methods, 0);
+    lua_newtable(l);
+    lua_pushcfunction(l, ctor);
+    lua_setfield(l, -2, "__call");
+    lua_setmetatable(l, -2);
+
+    //Instance metatable, whose __index falls back to the class table
+    luaL_newmetatable(l, ValueType<T>::name());
+    luaL_setfuncs(l, metamethods, 0);
+    lua_pushvalue(l, -2);
+    lua_pushcclosure(l, index, 1);
+    lua_setfield(l, -2, "__index");
+
+    //Keep it in the registry for PushValue() and TestValue()
+    cache->m_value_metatables[n] = lua_topointer(l, -1);
+    cache->m_value_refs[n] = luaL_ref(l, LUA_REGISTRYINDEX);
+
+    lua_setglobal(l, ValueType<T>::name());
+}
+
+template<typename T>
+static void register_vec(lua_State *l, luaL_Reg const *extra_methods)
+{
+    static luaL_Reg const metamethods[] =
+    {
+        { "__newindex", value_newindex<T> },
+        { "__tostring", value_tostring<T> },
+        { "__eq", value_eq<T> },
+        { "__add", value_add<T> },
+        { "__sub", value_sub<T> },
+        { "__mul", vec_mul<T> },
+        { "__div", vec_div<T> },
+        { "__unm", value_unm<T> },
+        { nullptr, nullptr }
+    };
+
+    static luaL_Reg const methods[] =
+    {
+        { "length", value_length<T> },
+        { "normalize", value_normalize<T> },
+        { "dot", value_dot<T> },
+        { "distance", vec_distance<T> },
+        { "mix", vec_mix<T> },
+        { "unpack", value_unpack<T> },
+        { nullptr, nullptr }
+    };
+
+    register_type<T>(l, metamethods, methods, vec_new<T>, value_index<T>);
+
+    if (extra_methods)
+    {
+        lua_getglobal(l, ValueType<T>::name());
+        luaL_setfuncs(l, extra_methods, 0);
+        lua_pop(l, 1);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void RegisterValueTypes(lua_State *l)
+{
+    static luaL_Reg const vec3_methods[] =
+    {
+        { "cross", vec3_cross },
+        { nullptr, nullptr }
+    };
+
+    register_vec<vec2>(l, nullptr);
+    register_vec<vec3>(l, vec3_methods);
+    register_vec<vec4>(l, nullptr);
+
+    static luaL_Reg const quat_metamethods[] =
+    {
+        { "__newindex", value_newindex<quat> },
+        { "__tostring", value_tostring<quat> },
+        { "__eq", value_eq<quat> },
+        { "__add", value_add<quat> },
+        { "__sub", value_sub<quat> },
+        { "__mul", quat_mul },
+        { "__div", quat_div },
+        { "__unm", value_unm<quat> },
+        { nullptr, nullptr }
+    };
+
+    static luaL_Reg const quat_methods[] =
+    {
+        { "rotate", quat_rotate },
+        { "length", value_length<quat> },
+        { "normalize", value_normalize<quat> },
+        { "dot", value_dot<quat> },
+        { "conjugate", quat_conjugate },
+        { "inverse", quat_inverse },
+        { "transform", quat_transform },
+        { "slerp", quat_slerp },
+        { "unpack", value_unpack<quat> },
+        { nullptr, nullptr }
+    };
+
+    register_type<quat>(l, quat_metamethods, quat_methods, quat_new, value_index<quat>);
+
+    static luaL_Reg const mat4_metamethods[] =
+    {
+        { "__newindex", mat4_newindex },
+        { "__tostring", mat4_tostring },
+        { "__eq", mat4_eq },
+        { "__add", mat4_add },
+        { "__sub", mat4_sub },
+        { "__mul", mat4_mul },
+        { "__unm", mat4_unm },
+        { nullptr, nullptr }
+    };
+
+    static luaL_Reg const mat4_methods[] =
+    {
+        { "translate", mat4_translate },
+        { "rotate", mat4_rotate },
+        { "scale", mat4_scale },
+        { "lookat", mat4_lookat },
+        { "inverse", mat4_inverse },
+        { "transpose", mat4_transpose },
+        { nullptr, nullptr }
+    };
+
+    register_type<mat4>(l, mat4_metamethods, mat4_methods, mat4_new, mat4_index);
+}
+
+} /* namespace Lolua */
+
+} /* namespace lol */
+
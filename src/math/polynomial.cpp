@@ -0,0 +1,116 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define LOL_POLYNOMIAL_SSE2 1
+#endif
+
+/*
+ * Batched polynomial evaluation
+ */
+
+namespace lol
+{
+
+/* Horner’s scheme has a long dependency chain, so evaluating a single
+ * value leaves most of the CPU idle. We run two SIMD registers of values
+ * at once, which keeps the multiplier busy without needing FMA. */
+
+void polynomial_eval(span<float const> coeffs, span<float const> x, span<float> out)
+{
+    ASSERT(x.size() == out.size());
+
+    int const d = (int)coeffs.size() - 1;
+    float const *c = coeffs.data();
+    size_t const count = x.size();
+    size_t i = 0;
+
+    if (d < 0)
+    {
+        for ( ; i < count; ++i)
+            out[i] = 0.f;
+        return;
+    }
+
+#if LOL_POLYNOMIAL_SSE2
+    for ( ; i + 8 <= count; i += 8)
+    {
+        __m128 const x0 = _mm_loadu_ps(x.data() + i);
+        __m128 const x1 = _mm_loadu_ps(x.data() + i + 4);
+        __m128 r0 = _mm_set1_ps(c[d]), r1 = r0;
+        for (int n = d - 1; n >= 0; --n)
+        {
+            __m128 const k = _mm_set1_ps(c[n]);
+            r0 = _mm_add_ps(_mm_mul_ps(r0, x0), k);
+            r1 = _mm_add_ps(_mm_mul_ps(r1, x1), k);
+        }
+        _mm_storeu_ps(out.data() + i, r0);
+        _mm_storeu_ps(out.data() + i + 4, r1);
+    }
+#endif
+
+    for ( ; i < count; ++i)
+    {
+        float r = c[d];
+        for (int n = d - 1; n >= 0; --n)
+            r = r * x[i] + c[n];
+        out[i] = r;
+    }
+}
+
+void polynomial_eval(span<double const> coeffs, span<double const> x, span<double> out)
+{
+    ASSERT(x.size() == out.size());
+
+    int const d = (int)coeffs.size() - 1;
+    double const *c = coeffs.data();
+    size_t const count = x.size();
+    size_t i = 0;
+
+    if (d < 0)
+    {
+        for ( ; i < count; ++i)
+            out[i] = 0.0;
+        return;
+    }
+
+#if LOL_POLYNOMIAL_SSE2
+    for ( ; i + 4 <= count; i += 4)
+    {
+        __m128d const x0 = _mm_loadu_pd(x.data() + i);
+        __m128d const x1 = _mm_loadu_pd(x.data() + i + 2);
+        __m128d r0 = _mm_set1_pd(c[d]), r1 = r0;
+        for (int n = d - 1; n >= 0; --n)
+        {
+            __m128d const k = _mm_set1_pd(c[n]);
+            r0 = _mm_add_pd(_mm_mul_pd(r0, x0), k);
+            r1 = _mm_add_pd(_mm_mul_pd(r1, x1), k);
+        }
+        _mm_storeu_pd(out.data() + i, r0);
+        _mm_storeu_pd(out.data() + i + 2, r1);
+    }
+#endif
+
+    for ( ; i < count; ++i)
+    {
+        double r = c[d];
+        for (int n = d - 1; n >= 0; --n)
+            r = r * x[i] + c[n];
+        out[i] = r;
+    }
+}
+
+} /* namespace lol */
+
@@ -13,9 +13,12 @@
 #include <lol/engine-internal.h>
 
 #include <new>
+#include <cmath>
 #include <cstring>
 #include <cstdio>
 #include <cstdlib>
+#include <map>
+#include <mutex>
 
 namespace lol
 {
@@ -29,37 +32,113 @@ template<> int real::DEFAULT_BIGIT_COUNT = 16;
 /*
  * Initialisation order is not important because everything is
  * done on demand, but here is the dependency list anyway:
- *  - fast_log() requires R_1
- *  - log() requires R_LN2
- *  - inverse() require R_2
- *  - exp() requires R_0, R_1, R_LN2
+ *  - load_pi(), load_ln2() and load_e() only require inverse()
+ *  - inverse() requires R_2
  *  - sqrt() requires R_3
+ *  - log() requires R_1, R_LN2 and R_PI at a higher precision
+ *  - exp() requires R_1, R_2 and R_LN2 at a higher precision
+ *  - sin() and cos() require R_PI and the sin/cos table at a higher
+ *    precision
  */
 
-static real fast_log(real const &x);
-
 static real load_min();
 static real load_max();
-static real load_pi();
+static real load_pi(int count);
+static real load_ln2(int count);
+static real load_e(int count);
+static std::vector<real> load_sincos_table(int count);
+
+/*
+ * Constants are cached for each precision level that was requested, so
+ * that code alternating between bigit counts does not recompute them. A
+ * value that is already known with more bigits is simply truncated.
+ */
+template<typename T>
+class real_cache
+{
+public:
+    real_cache(T (*load)(int count))
+      : m_load(load)
+    {
+    }
+
+    T const &get(int count)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_values.lower_bound(count);
+            if (it != m_values.end() && it->first == count)
+                return it->second;
+            if (it != m_values.end())
+                return m_values.emplace(count, truncate(it->second, count)).first->second;
+        }
+
+        /* Do not hold the lock while loading, because the value may
+         * depend on other cached values. */
+        T value = m_load(count);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_values.emplace(count, value).first->second;
+    }
+
+private:
+    static real truncate(real const &x, int count)
+    {
+        return x.with_bigits(count);
+    }
+
+    static std::vector<real> truncate(std::vector<real> const &v, int count)
+    {
+        std::vector<real> ret;
+        for (real const &x : v)
+            ret.push_back(x.with_bigits(count));
+        return ret;
+    }
+
+    T (*m_load)(int);
+    std::mutex m_mutex;
+    std::map<int, T> m_values;
+};
+
+/* Constants at any precision, for internal use */
+static real const &cached_pi(int count)
+{
+    static real_cache<real> cache(load_pi);
+    return cache.get(count);
+}
+
+static real const &cached_ln2(int count)
+{
+    static real_cache<real> cache(load_ln2);
+    return cache.get(count);
+}
+
+static real const &cached_e(int count)
+{
+    static real_cache<real> cache(load_e);
+    return cache.get(count);
+}
+
+/* The number of bigits of x; zero, infinite and NaN values have no
+ * mantissa, so they get the default precision instead. */
+static int precision(real const &x)
+{
+    return x.bigit_count() ? x.bigit_count() : real::DEFAULT_BIGIT_COUNT;
+}
 
 /* These getters do not need caching, their return values are small */
 template<> real const real::R_0() { return real(); }
 template<> real const real::R_INF() { real ret; ret.m_inf = true; return ret; }
 template<> real const real::R_NAN() { real ret; ret.m_nan = true; return ret; }
 
+template<> real const& real::R_LN2() { return cached_ln2(DEFAULT_BIGIT_COUNT); }
+template<> real const& real::R_E() { return cached_e(DEFAULT_BIGIT_COUNT); }
+template<> real const& real::R_PI() { return cached_pi(DEFAULT_BIGIT_COUNT); }
+
 #define LOL_CONSTANT_GETTER(name, value) \
     template<> real const& real::name() \
     { \
-        static real ret; \
-        static int prev_bigit_count = -1; \
-        /* If the default bigit count has changed, we must recompute
-         * the value with the desired precision. */ \
-        if (prev_bigit_count != DEFAULT_BIGIT_COUNT) \
-        { \
-            ret = (value); \
-            prev_bigit_count = DEFAULT_BIGIT_COUNT; \
-        } \
-        return ret; \
+        static real_cache<real> cache([](int) -> real { return (value); }); \
+        return cache.get(DEFAULT_BIGIT_COUNT); \
     }
 
 LOL_CONSTANT_GETTER(R_1,        real(1.0));
@@ -70,12 +149,9 @@ LOL_CONSTANT_GETTER(R_10,       real(10.0));
 LOL_CONSTANT_GETTER(R_MIN,      load_min());
 LOL_CONSTANT_GETTER(R_MAX,      load_max());
 
-LOL_CONSTANT_GETTER(R_LN2,      fast_log(R_2()));
 LOL_CONSTANT_GETTER(R_LN10,     log(R_10()));
 LOL_CONSTANT_GETTER(R_LOG2E,    inverse(R_LN2()));
 LOL_CONSTANT_GETTER(R_LOG10E,   inverse(R_LN10()));
-LOL_CONSTANT_GETTER(R_E,        exp(R_1()));
-LOL_CONSTANT_GETTER(R_PI,       load_pi());
 LOL_CONSTANT_GETTER(R_PI_2,     R_PI() / 2);
 LOL_CONSTANT_GETTER(R_PI_3,     R_PI() / R_3());
 LOL_CONSTANT_GETTER(R_PI_4,     R_PI() / 4);
@@ -606,6 +682,77 @@ template<> real const &real::operator /=(real const &x)
     return *this = tmp / x;
 }
 
+template<> real real::scale_small(uint32_t x, bool multiply) const
+{
+    if (is_zero() || x == 1)
+        return *this;
+
+    real ret;
+    ret.m_sign = m_sign;
+    ret.m_mantissa.resize(bigit_count());
+
+    if (multiply)
+    {
+        /* Multiply the mantissa and its implicit one, then shift the
+         * result right so that the new leading one is implicit. */
+        uint64_t carry = 0;
+        for (int i = bigit_count(); i--; )
+        {
+            carry += (uint64_t)m_mantissa[i] * x;
+            ret.m_mantissa[i] = (bigit_t)carry;
+            carry >>= bigit_bits();
+        }
+        carry += x;
+
+        int shift = 0;
+        while (carry >> (shift + 1))
+            ++shift;
+
+        bigit_t prev = (bigit_t)carry;
+        for (int i = 0; i < bigit_count(); ++i)
+        {
+            bigit_t tmp = ret.m_mantissa[i];
+            ret.m_mantissa[i] = (bigit_t)((((uint64_t)prev << bigit_bits()) | tmp) >> shift);
+            prev = tmp;
+        }
+        ret.m_exponent = m_exponent + shift;
+    }
+    else
+    {
+        /* Long division of the mantissa and its implicit one; we compute
+         * one more bigit than needed so that no bits are missing once the
+         * result is shifted left. */
+        ret.m_mantissa.resize(bigit_count() + 1);
+        uint64_t rem = 1;
+        for (int i = 0; i <= bigit_count(); ++i)
+        {
+            rem = (rem << bigit_bits()) | (i < bigit_count() ? m_mantissa[i] : 0);
+            ret.m_mantissa[i] = (bigit_t)(rem / x);
+            rem %= x;
+        }
+
+        int shift = bigit_bits() - 1;
+        while (!(ret.m_mantissa[0] >> shift))
+            --shift;
+
+        for (int i = 0; i < bigit_count(); ++i)
+            ret.m_mantissa[i] = (bigit_t)(((uint64_t)ret.m_mantissa[i] << bigit_bits()
+                                            | ret.m_mantissa[i + 1]) >> shift);
+        ret.m_mantissa.resize(bigit_count());
+        ret.m_exponent = m_exponent + shift - bigit_bits();
+    }
+
+    return ret;
+}
+
+template<> real real::with_bigits(int count) const
+{
+    real ret = *this;
+    if (!is_zero())
+        ret.m_mantissa.resize(count);
+    return ret;
+}
+
 template<> bool real::operator ==(real const &x) const
 {
     /* If NaN is involved, return false */
@@ -738,17 +885,23 @@ template<> real inverse(real const &x)
     u.x |= x.m_mantissa[0] >> 9;
     u.f = 1.0f / u.f;
 
-    ret.m_mantissa.resize(x.bigit_count());
+    ret.m_mantissa.resize(1);
     ret.m_mantissa[0] = u.x << 9;
     ret.m_sign = x.m_sign;
     ret.m_exponent = -x.m_exponent + (u.x >> 23) - 0x7f;
 
-    /* FIXME: 1+log2(bigit_count) steps of Newton-Raphson seems to be enough for
-     * convergence, but this hasn’t been checked seriously. */
-    for (int i = 1; i <= x.bigit_count(); i *= 2)
-        ret = ret * (real::R_2() - ret * x);
+    /* Each step of Newton-Raphson roughly doubles the number of correct
+     * bits, starting with about 20 bits, so only the last step needs to
+     * run with all the bigits. We keep one spare bigit in the others. */
+    for (int bits = 20; bits < x.total_bits(); )
+    {
+        bits = 2 * bits - 2;
+        int n = std::min(x.bigit_count(), bits / real::bigit_bits() + 2);
+        ret = ret.with_bigits(n);
+        ret = ret * (real::R_2().with_bigits(n) - ret * x.with_bigits(n));
+    }
 
-    return ret;
+    return ret.with_bigits(x.bigit_count());
 }
 
 template<> real sqrt(real const &x)
@@ -774,20 +927,22 @@ template<> real sqrt(real const &x)
     u.f = 1.0f / sqrtf(u.f);
 
     real ret;
-    ret.m_mantissa.resize(x.bigit_count());
+    ret.m_mantissa.resize(1);
     ret.m_mantissa[0] = u.x << 9;
 
     ret.m_exponent = -(x.m_exponent - tweak) / 2 + (u.x >> 23) - 0x7f;
 
-    /* FIXME: 1+log2(bigit_count()) steps of Newton-Raphson seems to be enough for
-     * convergence, but this hasn’t been checked seriously. */
-    for (int i = 1; i <= x.bigit_count(); i *= 2)
+    /* Newton-Raphson with increasing precision, see inverse() */
+    for (int bits = 20; bits < x.total_bits(); )
     {
-        ret = ret * (real::R_3() - ret * ret * x);
+        bits = 2 * bits - 2;
+        int n = std::min(x.bigit_count(), bits / real::bigit_bits() + 2);
+        ret = ret.with_bigits(n);
+        ret = ret * (real::R_3().with_bigits(n) - ret * ret * x.with_bigits(n));
         --ret.m_exponent;
     }
 
-    return ret * x;
+    return ret.with_bigits(x.bigit_count()) * x;
 }
 
 template<> real cbrt(real const &x)
@@ -811,20 +966,21 @@ template<> real cbrt(real const &x)
     u.f = powf(u.f, 1.f / 3);
 
     real ret;
-    ret.m_mantissa.resize(x.bigit_count());
+    ret.m_mantissa.resize(1);
     ret.m_mantissa[0] = u.x << 9;
     ret.m_exponent = (x.m_exponent - tweak) / 3 + (u.x >> 23) - 0x7f;
     ret.m_sign = x.m_sign;
 
-    /* FIXME: 1+log2(bigit_count()) steps of Newton-Raphson seems to be enough
-     * for convergence, but this hasn’t been checked seriously. */
-    real third = inverse(real::R_3());
-    for (int i = 1; i <= x.bigit_count(); i *= 2)
+    /* Newton-Raphson with increasing precision, see inverse() */
+    for (int bits = 20; bits < x.total_bits(); )
     {
-        ret = third * (x / (ret * ret) + (ret * 2));
+        bits = 2 * bits - 2;
+        int n = std::min(x.bigit_count(), bits / real::bigit_bits() + 2);
+        ret = ret.with_bigits(n);
+        ret = (x.with_bigits(n) / (ret * ret) + ret * 2) / 3;
     }
 
-    return ret;
+    return ret.with_bigits(x.bigit_count());
 }
 
 template<> real pow(real const &x, real const &y)
@@ -966,49 +1122,134 @@ template<> real radians(real const &x)
     return x * mul;
 }
 
+/* Evaluate the series Σ a(k)·y^k, where a(0) = 1 and a(k) = a(k-1)·p/q,
+ * with small integers p and q given by ratio(k, p, q), at the given number
+ * of bigits. |y| must be less than 1. We use rectangular splitting: with
+ * m ≈ √n powers of y, Horner’s scheme becomes
+ *    R(k) = y^0 + r(k+1) (y^1 + r(k+2) (... (y^(m-1) + r(k+m) y^m R(k+m))))
+ * so that only about 2√n full multiplications are needed for n terms; the
+ * rest are cheap multiplications and divisions by small integers. */
+template<typename F>
+static real fast_series(real const &y, int count, F const &ratio)
+{
+    real const one = real::R_1().with_bigits(count);
+    if (!y)
+        return one;
+
+    /* Estimate how many terms are needed */
+    real::exponent_t e;
+    double const mantissa = (double)frexp(y, &e);
+    double const log2y = (double)e + std::log2(std::fabs(mantissa));
+    int n = 1;
+    for (double mag = 0; ; ++n)
+    {
+        int p, q;
+        ratio(n, p, q);
+        mag += log2y + std::log2(std::fabs((double)p / q));
+        if (mag < -(double)(count * real::bigit_bits() + 8))
+            break;
+    }
+
+    int const m = std::max(1, (int)std::sqrt((double)n));
+    std::vector<real> powers { one, y };
+    for (int i = 2; i <= m; ++i)
+        powers.push_back(powers[i / 2] * powers[i - i / 2]);
+
+    real ret;
+    for (int k = (n - 1) / m * m; k >= 0; k -= m)
+    {
+        int const top = std::min(m, n - k);
+        real t = top == m && ret ? ret * powers[m] : real::R_0();
+        for (int i = top; i >= 1; --i)
+        {
+            int p, q;
+            ratio(k + i, p, q);
+            t = powers[i - 1] + t * p / q;
+        }
+        ret = t;
+    }
+
+    return ret;
+}
+
 static real fast_log(real const &x)
 {
-    /* This fast log method is tuned to work on the [1..2] range and
-     * no effort whatsoever was made to improve convergence outside this
-     * domain of validity. It can converge pretty fast, provided we use
-     * the following variable substitutions:
-     *    y = sqrt(x)
-     *    z = (y - 1) / (y + 1)
+    /* This fast log method works on the [0.75..1.5[ range and returns a
+     * value with the precision of x. Near 1 it uses the following series,
+     * which converges very fast since |z| < 1/512:
+     *    z = (x - 1) / (x + 1)
+     *    ln(x) = 2 atanh(z)
+     *          = 2 z (1 + z^2 / 3 + z^4 / 5 + z^6 / 7...)
      *
-     * And the following identities:
-     *    ln(x) = 2 ln(y)
-     *          = 2 ln((1 + z) / (1 - z))
-     *          = 4 z (1 + z^2 / 3 + z^4 / 5 + z^6 / 7...)
-     *
-     * Any additional sqrt() call would halve the convergence time, but
-     * would also impact the final precision. For now we stick with one
-     * sqrt() call. */
-    real y = sqrt(x);
-    real z = (y - real::R_1()) / (y + real::R_1()), z2 = z * z, zn = z2;
-    real sum = real::R_1();
-
-    for (int i = 3; ; i += 2)
+     * Elsewhere it uses the arithmetic-geometric mean, following Sasaki
+     * and Kanada: if s = x·2^m > 2^(p/2) where p is the desired number of
+     * bits, then
+     *    ln(s) = π / (2 AGM(1, 4/s)) + O(1/s^2)
+     *    ln(x) = ln(s) - m ln(2)
+     * The AGM converges in O(log(p)) iterations, each of them costing a
+     * multiplication and a square root. */
+    int const count = x.bigit_count();
+    real const one = real::R_1().with_bigits(count);
+    real const y = x - one;
+
+    if (!y)
+        return y;
+
+    real::exponent_t ey, ed, ea;
+    (void)frexp(y, &ey);
+    if (ey < -8)
+    {
+        real const z = y / (x + one);
+        return ldexp(z * fast_series(z * z, count, [](int k, int &p, int &q)
+        {
+            p = 2 * k - 1;
+            q = 2 * k + 1;
+        }), 1);
+    }
+
+    int const m = x.total_bits() / 2 + 8;
+    real a = one, b = ldexp(inverse(ldexp(x, m)), 2);
+    for (;;)
     {
-        real newsum = sum + zn / (real)i;
-        if (newsum == sum)
+        /* Once a and b agree on half of their bits, (a + b) / 2 is
+         * as close to the AGM as it gets. */
+        real d = a - b;
+        (void)frexp(d, &ed);
+        (void)frexp(a, &ea);
+        if (!d || ed < ea - x.total_bits() / 2)
             break;
-        sum = newsum;
-        zn *= z2;
+
+        real tmp = (a + b) / 2;
+        b = sqrt(a * b);
+        a = tmp;
     }
 
-    return z * sum * 4;
+    return cached_pi(count) / (a + b) - cached_ln2(count) * m;
 }
 
 template<> real log(real const &x)
 {
     /* Strategy for log(x): if x = 2^E*M then log(x) = E log(2) + log(M),
-     * with the property that M is in [1..2[, so fast_log() applies here. */
+     * with the property that M is in [0.75..1.5[, so fast_log() applies
+     * here. We use one extra bigit to absorb the cancellation between
+     * the two terms. */
     if (x.is_negative() || x.is_zero())
         return real::R_NAN();
 
-    real tmp(x);
+    int const count = x.bigit_count();
+    real tmp = x.with_bigits(count + 1);
+    real::exponent_t e = tmp.m_exponent;
     tmp.m_exponent = 0;
-    return real(x.m_exponent) * real::R_LN2() + fast_log(tmp);
+    if (tmp.m_mantissa[0] >> (real::bigit_bits() - 1))
+    {
+        tmp.m_exponent = -1;
+        ++e;
+    }
+
+    real ret = fast_log(tmp);
+    if (e)
+        ret += cached_ln2(count + 1) * real(e).with_bigits(count + 1);
+    return ret.with_bigits(count);
 }
 
 template<> real log2(real const &x)
@@ -1017,9 +1258,20 @@ template<> real log2(real const &x)
     if (x.is_negative() || x.is_zero())
         return real::R_NAN();
 
-    real tmp(x);
+    int const count = x.bigit_count();
+    real tmp = x.with_bigits(count + 1);
+    real::exponent_t e = tmp.m_exponent;
     tmp.m_exponent = 0;
-    return real(x.m_exponent) + fast_log(tmp) * real::R_LOG2E();
+    if (tmp.m_mantissa[0] >> (real::bigit_bits() - 1))
+    {
+        tmp.m_exponent = -1;
+        ++e;
+    }
+
+    real ret = fast_log(tmp) / cached_ln2(count + 1);
+    if (e)
+        ret += real(e).with_bigits(count + 1);
+    return ret.with_bigits(count);
 }
 
 template<> real log10(real const &x)
@@ -1060,27 +1312,49 @@ template<> real exp(real const &x)
      * Let E0 be an integer close to x / log(2). We need to find a value x0
      * such that exp(x) = 2^E0 * exp(x0). We get x0 = x - E0 log(2).
      *
+     * The series still needs many terms for |x0| ≈ 0.35, so we further
+     * use exp(x0) = exp(x0 / 2^k)^(2^k). The k squarings are done on
+     * y = exp(x0 / 2^k) - 1 to retain its precision:
+     *  exp(2t) - 1 = (exp(t) - 1) * (exp(t) + 1)
+     *
      * Thus the final algorithm:
      *  int E0 = x / log(2)
      *  real x0 = x - E0 log(2)
-     *  real x1 = exp(x0)
-     *  return x1 * 2^E0
+     *  real y = exp(x0 / 2^k) - 1
+     *  repeat k times: y = y * (y + 2)
+     *  return (y + 1) * 2^E0
+     *
+     * The squarings lose about k bits, so we work with one extra bigit.
      */
-    real::exponent_t e0 = x / real::R_LN2();
-    real x0 = x - (real)e0 * real::R_LN2();
-    real x1 = fast_exp_sub(x0, real::R_0());
-    x1.m_exponent += e0;
-    return x1;
+    int const count = precision(x);
+    real const x1 = x.with_bigits(count + 1), ln2 = cached_ln2(count + 1);
+
+    real::exponent_t e0 = (real::exponent_t)std::floor((double)x * 1.4426950408889634 + 0.5);
+    real x0 = x1 - ln2 * real(e0).with_bigits(count + 1);
+
+    int const k = std::min(20, (int)std::sqrt((double)x1.total_bits()) / 2);
+    real const t = ldexp(x0, -k);
+    real y = t * fast_series(t, count + 1, [](int i, int &p, int &q)
+    {
+        p = 1;
+        q = i + 1;
+    });
+
+    real const two = real::R_2().with_bigits(count + 1);
+    for (int i = 0; i < k; ++i)
+        y *= y + two;
+
+    return ldexp((y + real::R_1().with_bigits(count + 1)).with_bigits(count), e0);
 }
 
 template<> real exp2(real const &x)
 {
     /* Strategy for exp2(x): see strategy in exp(). */
-    real::exponent_t e0 = x;
-    real x0 = x - (real)e0;
-    real x1 = fast_exp_sub(x0 * real::R_LN2(), real::R_0());
-    x1.m_exponent += e0;
-    return x1;
+    int const count = precision(x);
+    real::exponent_t e0 = (real::exponent_t)std::floor((double)x);
+    real x0 = (x - real(e0).with_bigits(count)).with_bigits(count + 1);
+    real x1 = exp(x0 * cached_ln2(count + 1));
+    return ldexp(x1.with_bigits(count), e0);
 }
 
 template<> real erf(real const &x)
@@ -1229,7 +1503,7 @@ template<> real floor(real const &x)
         return -ceil(-x);
     if (!x)
         return x;
-    if (x < real::R_1())
+    if (x.m_exponent < 0)
         return real::R_0();
 
     real ret = x;
@@ -1282,41 +1556,104 @@ template<> real fmod(real const &x, real const &y)
     return x - tmp * y;
 }
 
-template<> real sin(real const &x)
+/* Compute sin(x) and cos(x) for a small x using their Taylor series,
+ * with the given number of bigits. */
+static void sincos_series(real const &x, int count, real *s, real *c)
+{
+    real const x2 = (x * x).with_bigits(count);
+    *s = x * fast_series(x2, count, [](int k, int &p, int &q)
+    {
+        p = -1;
+        q = 2 * k * (2 * k + 1);
+    });
+    *c = fast_series(x2, count, [](int k, int &p, int &q)
+    {
+        p = -1;
+        q = (2 * k - 1) * 2 * k;
+    });
+}
+
+/* The table of sin(j/32) and cos(j/32) for j in [0..25], which covers
+ * [0..π/4]. Only the first entry needs the Taylor series; the others use
+ * the angle addition formulas, which costs a few bits of precision. */
+static std::vector<real> load_sincos_table(int count)
 {
-    bool switch_sign = x.is_negative();
+    real s1, c1;
+    sincos_series(ldexp(real::R_1().with_bigits(count), -5), count, &s1, &c1);
 
-    real absx = fmod(fabs(x), real::R_PI() * 2);
-    if (absx > real::R_PI())
+    std::vector<real> ret { real::R_0(), real::R_1().with_bigits(count) };
+    for (int j = 1; j <= 25; ++j)
     {
-        absx -= real::R_PI();
-        switch_sign = !switch_sign;
+        real const s = ret[2 * j - 2], c = ret[2 * j - 1];
+        ret.push_back(s * c1 + c * s1);
+        ret.push_back(c * c1 - s * s1);
     }
+    return ret;
+}
 
-    if (absx > real::R_PI_2())
-        absx = real::R_PI() - absx;
+static void fast_sincos(real const &x, real *s, real *c)
+{
+    /* Strategy for sin(x) and cos(x) with x ≥ 0: first reduce x modulo
+     * π/2 to r in [-π/4..π/4], using enough extra bigits to account for
+     * the integer part of x/(π/2). Then split |r| = j/32 + h and use the
+     * cached values of sin(j/32) and cos(j/32):
+     *    sin(j/32 + h) = sin(j/32) cos(h) + cos(j/32) sin(h)
+     *    cos(j/32 + h) = cos(j/32) cos(h) - sin(j/32) sin(h)
+     * The series for sin(h) and cos(h) converge fast since h < 1/32.
+     * Finally, use the quadrant to get sin(x) and cos(x) from sin(r)
+     * and cos(r). */
+    static real_cache<std::vector<real>> cache(load_sincos_table);
+
+    int const count = precision(x), w = count + 1;
+    real::exponent_t e;
+    (void)frexp(x, &e);
+    int const extra = e > 0 ? (int)(e / real::bigit_bits()) + 1 : 0;
+
+    real const y = x.with_bigits(w + extra);
+    real const pi_2 = ldexp(cached_pi(w + extra), -1);
+    real const half = ldexp(real::R_1().with_bigits(w + extra), -1);
+    real const k = floor(y / pi_2 + half);
+    real r = (y - k * pi_2).with_bigits(w);
+    int const quadrant = (int)(double)(k - ldexp(floor(ldexp(k, -2)), 2));
+
+    bool const negative = r.is_negative();
+    r = fabs(r);
+    int const j = lol::clamp((int)std::floor((double)r * 32), 0, 25);
+    real const h = r - ldexp(real(j).with_bigits(w), -5);
+
+    real sh, ch;
+    sincos_series(h, w, &sh, &ch);
+
+    std::vector<real> const &table = cache.get(w);
+    real sr = table[2 * j] * ch + table[2 * j + 1] * sh;
+    real cr = table[2 * j + 1] * ch - table[2 * j] * sh;
+    if (negative)
+        sr = -sr;
 
-    real ret = real::R_0(), fact = real::R_1(), xn = absx, mx2 = -absx * absx;
-    int i = 1;
-    for (;;)
+    switch (quadrant)
     {
-        real newret = ret + xn;
-        if (newret == ret)
-            break;
-        ret = newret * ((i + 1) * (i + 2));
-        xn *= mx2;
-        i += 2;
+    case 0: *s = sr; *c = cr; break;
+    case 1: *s = cr; *c = -sr; break;
+    case 2: *s = -sr; *c = -cr; break;
+    default: *s = -cr; *c = sr; break;
     }
-    ret /= fast_fact(i);
 
-    /* Propagate sign */
-    ret.m_sign ^= switch_sign;
-    return ret;
+    *s = s->with_bigits(count);
+    *c = c->with_bigits(count);
+}
+
+template<> real sin(real const &x)
+{
+    real s, c;
+    fast_sincos(fabs(x), &s, &c);
+    return x.is_negative() ? -s : s;
 }
 
 template<> real cos(real const &x)
 {
-    return sin(real::R_PI_2() - x);
+    real s, c;
+    fast_sincos(fabs(x), &s, &c);
+    return c;
 }
 
 template<> real tan(real const &x)
@@ -1343,158 +1680,67 @@ template<> real tan(real const &x)
     return cos(y) / sin(y);
 }
 
-static inline real asinacos(real const &x, int is_asin)
-{
-    /* Strategy for asin(): in [-0.5..0.5], use a Taylor series around
-     * zero. In [0.5..1], use asin(x) = π/2 - 2*asin(sqrt((1-x)/2)), and
-     * in [-1..-0.5] just revert the sign.
-     * Strategy for acos(): use acos(x) = π/2 - asin(x) and try not to
-     * lose the precision around x=1. */
-    real absx = fabs(x);
-    int around_zero = (absx < (real::R_1() / 2));
-
-    if (!around_zero)
-        absx = sqrt((real::R_1() - absx) / 2);
-
-    real ret = absx, xn = absx, x2 = absx * absx, fact1 = 2, fact2 = 1;
-    for (int i = 1; ; ++i)
-    {
-        xn *= x2;
-        real mul = (real)(2 * i + 1);
-        real newret = ret + ldexp(fact1 * xn / (mul * fact2), -2 * i);
-        if (newret == ret)
-            break;
-        ret = newret;
-        fact1 *= (real)((2 * i + 1) * (2 * i + 2));
-        fact2 *= (real)((i + 1) * (i + 1));
-    }
-
-    if (x.is_negative())
-        ret = -ret;
-
-    if (around_zero)
-        ret = is_asin ? ret : real::R_PI_2() - ret;
-    else
-    {
-        real adjust = x.is_negative() ? real::R_PI() : real::R_0();
-        if (is_asin)
-            ret = real::R_PI_2() - adjust - ret * 2;
-        else
-            ret = adjust + ret * 2;
-    }
-
-    return ret;
-}
-
 template<> real asin(real const &x)
 {
-    return asinacos(x, 1);
+    /* Strategy for asin(x): use asin(x) = atan(x / sqrt((1-x)(1+x))),
+     * where the factored form keeps the precision around ±1. */
+    int const count = precision(x);
+    real const x1 = x.with_bigits(count + 1);
+    real const one = real::R_1().with_bigits(count + 1);
+    real const d = (one - x1) * (one + x1);
+    if (!d)
+        return copysign(ldexp(cached_pi(count), -1), x);
+
+    return atan(x1 / sqrt(d)).with_bigits(count);
 }
 
 template<> real acos(real const &x)
 {
-    return asinacos(x, 0);
+    /* Strategy for acos(x): use acos(x) = 2 atan(sqrt((1-x)/(1+x))),
+     * which keeps the precision around 1. */
+    int const count = precision(x);
+    real const x1 = x.with_bigits(count + 1);
+    real const one = real::R_1().with_bigits(count + 1);
+    if (!(one + x1))
+        return cached_pi(count);
+
+    return ldexp(atan(sqrt((one - x1) / (one + x1))), 1).with_bigits(count);
 }
 
 template<> real atan(real const &x)
 {
-    /* Computing atan(x): we choose a different Taylor series depending on
-     * the value of x to help with convergence.
-     *
-     * If |x| < 0.5 we evaluate atan(y) near 0:
+    /* Strategy for atan(x): if |x| > 1, use atan(x) = π/2 - atan(1/x).
+     * Then apply the half-angle formula k times:
+     *  atan(x) = 2 atan(x / (1 + sqrt(1 + x^2)))
+     * Each application roughly halves x, so that the Taylor series
      *  atan(y) = y - y^3/3 + y^5/5 - y^7/7 + y^9/9 ...
-     *
-     * If 0.5 <= |x| < 1.5 we evaluate atan(1+y) near 0:
-     *  atan(1+y) = π/4 + y/(1*2^1) - y^2/(2*2^1) + y^3/(3*2^2)
-     *                  - y^5/(5*2^3) + y^6/(6*2^3) - y^7/(7*2^4)
-     *                  + y^9/(9*2^5) - y^10/(10*2^5) + y^11/(11*2^6) ...
-     *
-     * If 1.5 <= |x| < 2 we evaluate atan(sqrt(3)+2y) near 0:
-     *  atan(sqrt(3)+2y) = π/3 + 1/2 y - sqrt(3)/2 y^2/2
-     *                         + y^3/3 - sqrt(3)/2 y^4/4 + 1/2 y^5/5
-     *                         - 1/2 y^7/7 + sqrt(3)/2 y^8/8
-     *                         - y^9/9 + sqrt(3)/2 y^10/10 - 1/2 y^11/11
-     *                         + 1/2 y^13/13 - sqrt(3)/2 y^14/14
-     *                         + y^15/15 - sqrt(3)/2 y^16/16 + 1/2 y^17/17 ...
-     *
-     * If |x| >= 2 we evaluate atan(y) near +∞:
-     *  atan(y) = π/2 - y^-1 + y^-3/3 - y^-5/5 + y^-7/7 - y^-9/9 ...
-     */
-    real absx = fabs(x);
+     * gains two more bits per term. A square root costs about as much
+     * as a few terms of the series, which gives the value of k. */
+    if (!x)
+        return x;
 
-    if (absx < (real::R_1() / 2))
-    {
-        real ret = x, xn = x, mx2 = -x * x;
-        for (int i = 3; ; i += 2)
-        {
-            xn *= mx2;
-            real newret = ret + xn / (real)i;
-            if (newret == ret)
-                break;
-            ret = newret;
-        }
-        return ret;
-    }
+    int const count = x.bigit_count(), w = count + 1;
+    real const one = real::R_1().with_bigits(w);
+    real y = fabs(x).with_bigits(w);
 
-    real ret = 0;
+    bool const invert = y > one;
+    if (invert)
+        y = inverse(y);
 
-    if (absx < (real::R_3() / 2))
-    {
-        real y = real::R_1() - absx;
-        real yn = y, my2 = -y * y;
-        for (int i = 0; ; i += 2)
-        {
-            real newret = ret + ldexp(yn / (real)(2 * i + 1), -i - 1);
-            yn *= y;
-            newret += ldexp(yn / (real)(2 * i + 2), -i - 1);
-            yn *= y;
-            newret += ldexp(yn / (real)(2 * i + 3), -i - 2);
-            if (newret == ret)
-                break;
-            ret = newret;
-            yn *= my2;
-        }
-        ret = real::R_PI_4() - ret;
-    }
-    else if (absx < real::R_2())
-    {
-        real y = (absx - real::R_SQRT3()) / 2;
-        real yn = y, my2 = -y * y;
-        for (int i = 1; ; i += 6)
-        {
-            real newret = ret + ((yn / (real)i) / 2);
-            yn *= y;
-            newret -= (real::R_SQRT3() / 2) * yn / (real)(i + 1);
-            yn *= y;
-            newret += yn / (real)(i + 2);
-            yn *= y;
-            newret -= (real::R_SQRT3() / 2) * yn / (real)(i + 3);
-            yn *= y;
-            newret += (yn / (real)(i + 4)) / 2;
-            if (newret == ret)
-                break;
-            ret = newret;
-            yn *= my2;
-        }
-        ret = real::R_PI_3() + ret;
-    }
-    else
+    int const k = (int)std::sqrt(y.total_bits() / 12.0);
+    for (int i = 0; i < k; ++i)
+        y /= one + sqrt(one + y * y);
+
+    real ret = ldexp(y * fast_series(y * y, w, [](int i, int &p, int &q)
     {
-        real y = inverse(absx);
-        real yn = y, my2 = -y * y;
-        ret = y;
-        for (int i = 3; ; i += 2)
-        {
-            yn *= my2;
-            real newret = ret + yn / (real)i;
-            if (newret == ret)
-                break;
-            ret = newret;
-        }
-        ret = real::R_PI_2() - ret;
-    }
+        p = 1 - 2 * i;
+        q = 2 * i + 1;
+    }), k);
 
-    /* Propagate sign */
+    if (invert)
+        ret = ldexp(cached_pi(w), -1) - ret;
+
+    ret = ret.with_bigits(count);
     ret.m_sign = x.m_sign;
     return ret;
 }
@@ -1670,23 +1916,85 @@ static real load_max()
     return real(str);
 }
 
-static real load_pi()
+/* Evaluate the series S = Σ p(0)…p(n) / (q(0)…q(n)) for n in [n1..n2[
+ * by binary splitting (Haible and Papanikolaou, “Fast multiprecision
+ * evaluation of series of rational numbers”): returns P = p(n1)…p(n2-1),
+ * Q = q(n1)…q(n2-1) and T such that S = T / Q. Since p(n) and q(n) are
+ * small integers, the products stay exact much longer than when adding
+ * the terms one by one, and most of the work is spent multiplying
+ * numbers of similar sizes. */
+template<typename F>
+static void binary_split(F const &term, int n1, int n2, int count,
+                         real &p, real &q, real &t)
+{
+    if (n2 - n1 == 1)
+    {
+        int64_t pn, qn;
+        term(n1, pn, qn);
+        p = t = real(pn).with_bigits(count);
+        q = real(qn).with_bigits(count);
+        return;
+    }
+
+    int const mid = (n1 + n2) / 2;
+    real p2, q2, t2;
+    binary_split(term, n1, mid, count, p, q, t);
+    binary_split(term, mid, n2, count, p2, q2, t2);
+    t = t * q2 + p * t2;
+    p *= p2;
+    q *= q2;
+}
+
+/* Compute atan(1/x), or atanh(1/x), with the given number of bigits.
+ * Each term of the series is ∓(2n-1)/((2n+1)·x^2) times the previous. */
+static real atan_inverse(int64_t x, bool hyperbolic, int count)
+{
+    int const terms = (int)(count * real::bigit_bits()
+                             / (2 * std::log2((double)x))) + 2;
+
+    real p, q, t;
+    binary_split([=](int n, int64_t &pn, int64_t &qn)
+    {
+        pn = n == 0 ? 1 : hyperbolic ? 2 * n - 1 : 1 - 2 * n;
+        qn = n == 0 ? x : (2 * n + 1) * x * x;
+    }, 0, terms, count, p, q, t);
+
+    return t / q;
+}
+
+static real load_pi(int count)
 {
     /* Approximate π using Machin’s formula: 16*atan(1/5)-4*atan(1/239) */
-    real ret = 0, x0 = 5, x1 = 239;
-    real const m0 = -x0 * x0, m1 = -x1 * x1, r16 = 16, r4 = 4;
+    real ret = atan_inverse(5, false, count + 1) * 16
+             - atan_inverse(239, false, count + 1) * 4;
+    return ret.with_bigits(count);
+}
+
+static real load_ln2(int count)
+{
+    /* Approximate log(2) using a Machin-like formula:
+     * 18*atanh(1/26)-2*atanh(1/4801)+8*atanh(1/8749) */
+    real ret = atan_inverse(26, true, count + 1) * 18
+             - atan_inverse(4801, true, count + 1) * 2
+             + atan_inverse(8749, true, count + 1) * 8;
+    return ret.with_bigits(count);
+}
 
-    for (int i = 1; ; i += 2)
+static real load_e(int count)
+{
+    /* Approximate e using the series Σ1/n! */
+    int terms = 1;
+    for (double bits = 0; bits < (count + 1) * real::bigit_bits(); )
+        bits += std::log2((double)++terms);
+
+    real p, q, t;
+    binary_split([](int n, int64_t &pn, int64_t &qn)
     {
-        real newret = ret + r16 / (x0 * (real)i) - r4 / (x1 * (real)i);
-        if (newret == ret)
-            break;
-        ret = newret;
-        x0 *= m0;
-        x1 *= m1;
-    }
+        pn = 1;
+        qn = n == 0 ? 1 : n;
+    }, 0, terms, count + 1, p, q, t);
 
-    return ret;
+    return (t / q).with_bigits(count);
 }
 
 } /* namespace lol */
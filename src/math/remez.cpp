@@ -0,0 +1,258 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+/*
+ * Remez exchange algorithm
+ */
+
+namespace lol
+{
+
+/* Give up if the error does not equioscillate after this many steps */
+static int const REMEZ_MAX_ITERATIONS = 50;
+
+/* Bisection steps for the zeros of the error; they only delimit the
+ * intervals where the extrema are searched, so they need little accuracy */
+static int const REMEZ_ZERO_ITERATIONS = 40;
+
+/* Golden section steps for the extrema of the error; the error is flat
+ * around them, so locating them to 2^-60 gives the value to 2^-120 */
+static int const REMEZ_EXTREMUM_ITERATIONS = 88;
+
+remez_solver::remez_solver()
+  : m_degree(0),
+    m_iterations(0)
+{
+}
+
+polynomial<real> remez_solver::run(int degree, real const &a, real const &b,
+                                   function const &func, function const &weight)
+{
+    ASSERT(degree >= 0 && a < b, "invalid Remez problem of degree %d", degree);
+
+    m_degree = degree;
+    m_k1 = (b + a) / 2;
+    m_k2 = (b - a) / 2;
+    m_func = func;
+    m_weight = weight;
+
+    /* Start from the extrema of the Chebyshev polynomial of degree n + 1,
+     * where the error of a near-minimax polynomial alternates. */
+    int const n = degree + 2;
+    m_control.clear();
+    for (int i = 0; i < n; ++i)
+        m_control << -cos(real::R_PI() * real(i) / real(n - 1));
+
+    /* The error of the minimax polynomial has the same magnitude at all
+     * control points; stop when they agree on enough digits, or when the
+     * error is down to rounding noise because func is a polynomial. */
+    real const tolerance = ldexp(real::R_1(), -50);
+    for (m_iterations = 1; m_iterations <= REMEZ_MAX_ITERATIONS; ++m_iterations)
+    {
+        solve();
+        find_zeros();
+        real const spread = find_extrema();
+        if (!(spread > m_error * tolerance))
+            break;
+        if (!(m_error > ldexp(m_scale, 16 - m_error.total_bits())))
+            break;
+    }
+
+    /* Go back from t to x = m_k1 + m_k2 t */
+    m_result = m_estimate.eval(polynomial<real>({ -m_k1 / m_k2, real::R_1() / m_k2 }));
+    return m_result;
+}
+
+real remez_solver::eval_error(real const &t) const
+{
+    real const x = m_k1 + m_k2 * t;
+    real ret = m_estimate.eval(t) - m_func(x);
+    return m_weight ? ret / m_weight(x) : ret;
+}
+
+void remez_solver::solve()
+{
+    /* Find the polynomial p and the error E such that at each control
+     * point t(i):
+     *    p(t(i)) - f(t(i)) = (-1)^i E w(t(i))
+     * This is a linear system of n equations with n unknowns, which we
+     * solve with Gaussian elimination and partial pivoting. */
+    int const n = m_degree + 2;
+    array<real> system;
+    system.resize(n * (n + 1));
+    auto row = [&](int i) { return system.data() + i * (n + 1); };
+
+    for (int i = 0; i < n; ++i)
+    {
+        real const &t = m_control[i];
+        real const x = m_k1 + m_k2 * t;
+        real tn = real::R_1();
+        for (int j = 0; j < n - 1; ++j, tn *= t)
+            row(i)[j] = tn;
+        real const w = m_weight ? m_weight(x) : real::R_1();
+        row(i)[n - 1] = (i & 1) ? w : -w;
+        row(i)[n] = m_func(x);
+
+        /* The magnitude of the weighted function, for rounding errors */
+        real const scale = fabs(row(i)[n] / w);
+        if (i == 0 || scale > m_scale)
+            m_scale = scale;
+    }
+
+    for (int j = 0; j < n; ++j)
+    {
+        int pivot = j;
+        for (int i = j + 1; i < n; ++i)
+            if (fabs(row(i)[j]) > fabs(row(pivot)[j]))
+                pivot = i;
+        for (int k = j; k <= n; ++k)
+            std::swap(row(j)[k], row(pivot)[k]);
+
+        for (int i = j + 1; i < n; ++i)
+        {
+            real const m = row(i)[j] / row(j)[j];
+            for (int k = j; k <= n; ++k)
+                row(i)[k] -= m * row(j)[k];
+        }
+    }
+
+    array<real> solution;
+    solution.resize(n);
+    for (int j = n - 1; j >= 0; --j)
+    {
+        real sum = row(j)[n];
+        for (int k = j + 1; k < n; ++k)
+            sum -= row(j)[k] * solution[k];
+        solution[j] = sum / row(j)[j];
+    }
+
+    m_estimate = polynomial<real>();
+    for (int j = 0; j < n - 1; ++j)
+        m_estimate.set(j, solution[j]);
+}
+
+void remez_solver::find_zeros()
+{
+    /* The error alternates in sign at the control points, so there is
+     * a zero between each pair of them. */
+    m_zeros.clear();
+    for (int i = 0; i + 1 < m_control.count(); ++i)
+    {
+        real lo = m_control[i], hi = m_control[i + 1];
+        bool const negative = eval_error(lo).is_negative();
+
+        for (int k = 0; k < REMEZ_ZERO_ITERATIONS; ++k)
+        {
+            real const mid = ldexp(lo + hi, -1);
+            if (eval_error(mid).is_negative() == negative)
+                lo = mid;
+            else
+                hi = mid;
+        }
+
+        m_zeros << ldexp(lo + hi, -1);
+    }
+}
+
+real remez_solver::find_extrema()
+{
+    /* Find the maximum of |error| between each pair of zeros; these are
+     * the new control points. Return the difference between the largest
+     * and the smallest of these maxima. */
+    real const phi = (sqrt(real(5)) - real::R_1()) / 2;
+    real min_error;
+    m_error = real::R_0();
+
+    int const n = m_control.count();
+    for (int i = 0; i < n; ++i)
+    {
+        real a = i == 0 ? -real::R_1() : m_zeros[i - 1];
+        real b = i == n - 1 ? real::R_1() : m_zeros[i];
+        real c = b - (b - a) * phi, d = a + (b - a) * phi;
+        real fc = fabs(eval_error(c)), fd = fabs(eval_error(d));
+
+        for (int k = 0; k < REMEZ_EXTREMUM_ITERATIONS; ++k)
+        {
+            if (fc > fd)
+            {
+                b = d; d = c; fd = fc;
+                c = b - (b - a) * phi;
+                fc = fabs(eval_error(c));
+            }
+            else
+            {
+                a = c; c = d; fc = fd;
+                d = a + (b - a) * phi;
+                fd = fabs(eval_error(d));
+            }
+        }
+
+        real t = fc > fd ? c : d, ft = fc > fd ? fc : fd;
+
+        /* The outer intervals may have their maximum on the boundary */
+        if (i == 0 || i == n - 1)
+        {
+            real const edge = i == 0 ? -real::R_1() : real::R_1();
+            real const fedge = fabs(eval_error(edge));
+            if (fedge > ft)
+            {
+                t = edge;
+                ft = fedge;
+            }
+        }
+
+        m_control[i] = t;
+        if (i == 0 || ft > m_error)
+            m_error = ft;
+        if (i == 0 || ft < min_error)
+            min_error = ft;
+    }
+
+    return m_error - min_error;
+}
+
+template<typename T>
+static std::string cpp_table_helper(polynomial<real> const &p, int degree,
+                                    real const &error, std::string const &name,
+                                    char const *type, char const *fmt)
+{
+    std::string ret = lol::format("/* Minimax polynomial of degree %d, "
+                                  "maximum error %.3g */\n", degree, (double)error);
+    ret += lol::format("static constexpr %s %s[] =\n{\n", type, name.c_str());
+    for (int i = 0; i <= degree; ++i)
+        ret += lol::format(fmt, (T)p[i]);
+    ret += "};\n";
+    return ret;
+}
+
+template<> std::string remez_solver::cpp_table<float>(std::string const &name) const
+{
+    return cpp_table_helper<float>(m_result, m_degree, m_error, name,
+                                   "float", "    %.9ef,\n");
+}
+
+template<> std::string remez_solver::cpp_table<double>(std::string const &name) const
+{
+    return cpp_table_helper<double>(m_result, m_degree, m_error, name,
+                                    "double", "    %.17e,\n");
+}
+
+template<> std::string remez_solver::cpp_table<ldouble>(std::string const &name) const
+{
+    return cpp_table_helper<ldouble>(m_result, m_degree, m_error, name,
+                                     "long double", "    %.21LeL,\n");
+}
+
+} /* namespace lol */
+
@@ -105,6 +105,18 @@ void SubMesh::AddTexture(std::string const &name, std::shared_ptr<Texture> textu
     m_textures.push(name, texture);
 }
 
+void SubMesh::SetBounds(box3 const &bounds)
+{
+    m_bounds = bounds;
+    m_has_bounds = true;
+}
+
+void SubMesh::SetOccluder(box3 const &occluder)
+{
+    m_occluder = occluder;
+    m_has_occluder = true;
+}
+
 void SubMesh::Render()
 {
     size_t vertex_count = 0;
@@ -99,6 +99,12 @@ public:
     void SetIndexBuffer(std::shared_ptr<IndexBuffer> ibo);
     void AddTexture(std::string const &name, std::shared_ptr<Texture> texture);
 
+    /* Object space bounds, used for visibility culling, and an optional
+     * box that is entirely inside the solid part of the mesh and may
+     * be used to hide other objects. */
+    void SetBounds(box3 const &bounds);
+    void SetOccluder(box3 const &occluder);
+
 protected:
     void Render();
 
@@ -109,6 +115,9 @@ protected:
     std::shared_ptr<IndexBuffer> m_ibo;
 
     array<std::string, std::shared_ptr<Texture>> m_textures;
+
+    bool m_has_bounds = false, m_has_occluder = false;
+    box3 m_bounds, m_occluder;
 };
 
 } /* namespace lol */
@@ -33,6 +33,41 @@ PrimitiveMesh::~PrimitiveMesh()
 {
 }
 
+/* Transform a box and return the world space box that contains it */
+static box3 transform_box(mat4 const &m, box3 const &b)
+{
+    vec3 c = (m * vec4(0.5f * (b.aa + b.bb), 1.f)).xyz;
+    vec3 e = 0.5f * (b.bb - b.aa);
+    e = abs(m[0].xyz) * e.x + abs(m[1].xyz) * e.y + abs(m[2].xyz) * e.z;
+    return box3(c - e, c + e);
+}
+
+bool PrimitiveMesh::GetBounds(box3 &bounds) const
+{
+    if (!m_submesh->m_has_bounds)
+        return false;
+
+    bounds = transform_box(m_matrix, m_submesh->m_bounds);
+    return true;
+}
+
+bool PrimitiveMesh::GetOccluder(box3 &occluder) const
+{
+    if (!m_submesh->m_has_occluder)
+        return false;
+
+    /* The transformed box contains the original box, so it is only
+     * still solid if the matrix does not rotate it. */
+    mat3 const m(m_matrix);
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            if (i != j && m[i][j] != 0.f)
+                return false;
+
+    occluder = transform_box(m_matrix, m_submesh->m_occluder);
+    return true;
+}
+
 void PrimitiveMesh::Render(Scene& scene, std::shared_ptr<PrimitiveSource> primitive)
 {
     /* TODO: this should be the main entry for rendering of all
@@ -63,7 +98,7 @@ void PrimitiveMesh::Render(Scene& scene, std::shared_ptr<PrimitiveSource> primit
             u_mat = shader->GetUniformLocation("u_view");
             shader->SetUniform(u_mat, scene.GetCamera()->GetView());
             u_mat = shader->GetUniformLocation("u_inv_view");
-            shader->SetUniform(u_mat, inverse(scene.GetCamera()->GetView()));
+            shader->SetUniform(u_mat, scene.GetInverseView());
 
             /* Per-object matrices, will be set later */
             u_model = shader->GetUniformLocation("u_model");
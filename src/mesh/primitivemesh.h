@@ -28,6 +28,8 @@ public:
     PrimitiveMesh(std::shared_ptr<SubMesh> submesh, mat4 const &matrix);
     virtual ~PrimitiveMesh();
     virtual void Render(Scene& scene, std::shared_ptr<PrimitiveSource> primitive);
+    virtual bool GetBounds(box3 &bounds) const;
+    virtual bool GetOccluder(box3 &occluder) const;
 
 private:
     std::shared_ptr<SubMesh> m_submesh;
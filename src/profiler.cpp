@@ -10,6 +10,8 @@
 
 #include <lol/engine-internal.h>
 
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
 #include <stdint.h>
 
@@ -24,7 +26,8 @@ static class ProfilerData
 {
     friend class Profiler;
 
-    static int const HISTORY = 32;
+    /* Enough samples for a meaningful 99th percentile */
+    static int const HISTORY = 256;
 
 public:
     ProfilerData()
@@ -32,15 +35,25 @@ public:
         for (int i = 0; i < HISTORY; i++)
             history[i] = 0.0f;
         avg = max = 0.0f;
+        index = count = 0;
+    }
+
+    /* The i-th oldest sample still in the history */
+    float sample(int i) const
+    {
+        return history[(index - count + i + HISTORY) % HISTORY];
     }
 
 private:
     float history[HISTORY];
     timer m_timer;
     float avg, max;
+    int index, count;
 }
 data[Profiler::STAT_COUNT];
 
+static int counters[Profiler::COUNTER_COUNT];
+
 /*
  * Profiler public class
  */
@@ -54,17 +67,24 @@ void Profiler::Stop(int id)
 {
     float seconds = data[id].m_timer.get();
 
-    data[id].history[Ticker::GetFrameNum() % ProfilerData::HISTORY] = seconds;
+    data[id].history[data[id].index] = seconds;
+    data[id].index = (data[id].index + 1) % ProfilerData::HISTORY;
+    data[id].count = std::min(data[id].count + 1, ProfilerData::HISTORY);
     data[id].avg = 0.0f;
     data[id].max = 0.0f;
 
-    for (int i = 0; i < ProfilerData::HISTORY; i++)
+    for (int i = 0; i < data[id].count; i++)
     {
         data[id].avg += data[id].history[i];
         if (data[id].history[i] > data[id].max)
             data[id].max = data[id].history[i];
     }
-    data[id].avg /= ProfilerData::HISTORY;
+    data[id].avg /= data[id].count;
+}
+
+void Profiler::Reset(int id)
+{
+    data[id] = ProfilerData();
 }
 
 float Profiler::GetAvg(int id)
@@ -77,5 +97,43 @@ float Profiler::GetMax(int id)
     return data[id].max;
 }
 
+float Profiler::GetPercentile(int id, float p)
+{
+    int const count = data[id].count;
+    if (!count)
+        return 0.0f;
+
+    /* Nearest rank: the smallest sample that p of them do not exceed */
+    float sorted[ProfilerData::HISTORY];
+    for (int i = 0; i < count; i++)
+        sorted[i] = data[id].sample(i);
+
+    int rank = std::min(std::max((int)std::ceil(p * count) - 1, 0), count - 1);
+    std::nth_element(sorted, sorted + rank, sorted + count);
+    return sorted[rank];
+}
+
+float Profiler::GetJitter(int id)
+{
+    int const count = data[id].count;
+    if (count < 2)
+        return 0.0f;
+
+    float ret = 0.0f;
+    for (int i = 1; i < count; i++)
+        ret += std::abs(data[id].sample(i) - data[id].sample(i - 1));
+    return ret / (count - 1);
+}
+
+void Profiler::SetCounter(int id, int value)
+{
+    counters[id] = value;
+}
+
+int Profiler::GetCounter(int id)
+{
+    return counters[id];
+}
+
 } /* namespace lol */
 
@@ -30,6 +30,7 @@ public:
         STAT_TICK_GAME,
         STAT_TICK_DRAW,
         STAT_TICK_BLIT,
+        STAT_TICK_CULL,
         STAT_USER_00,
         STAT_USER_01,
         STAT_USER_02,
@@ -43,11 +44,42 @@ public:
         STAT_COUNT
     };
 
+    /* Counters are plain values set once per frame, for instance by the
+     * scene’s visibility stage, the transient buffers, the GUI, the world
+     * or the ticker */
+    enum
+    {
+        COUNTER_VISIBLE = 0,
+        COUNTER_CULLED_FRUSTUM,
+        COUNTER_CULLED_OCCLUSION,
+        COUNTER_TILE_BATCHES,
+        COUNTER_TRANSIENT_BYTES,
+        COUNTER_TRANSIENT_ALLOCS,
+        COUNTER_GUI_COMMANDS,
+        COUNTER_GUI_DRAW_CALLS,
+        COUNTER_GUI_UPLOAD_BYTES,
+        COUNTER_WORLD_CELLS,
+        COUNTER_WORLD_TICKED,
+        COUNTER_GAME_STEPS,
+        COUNTER_WAKE_SLACK_US,
+        COUNTER_COUNT
+    };
+
     static void Start(int id);
     static void Stop(int id);
+    static void Reset(int id);
     static float GetAvg(int id);
     static float GetMax(int id);
 
+    /* Statistics over the last samples: GetPercentile(STAT_TICK_FRAME,
+     * 0.99f) is the 99th percentile of frame times, and GetJitter() the
+     * mean difference between consecutive samples. */
+    static float GetPercentile(int id, float p);
+    static float GetJitter(int id);
+
+    static void SetCounter(int id, int value);
+    static int GetCounter(int id);
+
 private:
     Profiler() {}
 };
@@ -26,6 +26,7 @@
 
 LOLFX_RESOURCE_DECLARE(gpu_tile);
 LOLFX_RESOURCE_DECLARE(gpu_palette);
+LOLFX_RESOURCE_DECLARE(gpu_distance_field);
 LOLFX_RESOURCE_DECLARE(gpu_line);
 
 LOLFX_RESOURCE_DECLARE(gpu_blit);
@@ -52,6 +53,17 @@ static inline void gpu_marker(char const *message)
 #endif
 }
 
+/* Accumulate culling statistics into the profiler counters */
+static void add_cull_stats(int visible, int frustum, int occlusion)
+{
+    Profiler::SetCounter(Profiler::COUNTER_VISIBLE, visible
+                 + Profiler::GetCounter(Profiler::COUNTER_VISIBLE));
+    Profiler::SetCounter(Profiler::COUNTER_CULLED_FRUSTUM, frustum
+                 + Profiler::GetCounter(Profiler::COUNTER_CULLED_FRUSTUM));
+    Profiler::SetCounter(Profiler::COUNTER_CULLED_OCCLUSION, occlusion
+                 + Profiler::GetCounter(Profiler::COUNTER_CULLED_OCCLUSION));
+}
+
 //
 // Public SceneDisplay class
 //
@@ -108,7 +120,7 @@ void PrimitiveRenderer::Render(Scene& scene, std::shared_ptr<PrimitiveSource> pr
 
 uint64_t Scene::g_used_id = 1;
 mutex Scene::g_prim_mutex;
-std::map<uintptr_t, array<std::shared_ptr<PrimitiveSource>>> Scene::g_prim_sources;
+hash_map<uintptr_t, array<std::shared_ptr<PrimitiveSource>>> Scene::g_prim_sources;
 
 /*
  * Public Scene class
@@ -152,11 +164,12 @@ Scene::Scene(ivec2 size)
     m_tile_api.m_cam = -1;
     m_tile_api.m_shader = 0;
     m_tile_api.m_palette_shader = 0;
+    m_tile_api.m_field_shader = 0;
     m_tile_api.m_vdecl = std::make_shared<VertexDeclaration>(VertexStream<vec3>(VertexUsage::Position),
                                                              VertexStream<vec2>(VertexUsage::TexCoord));
 
     m_line_api.m_shader = 0;
-    m_line_api.m_vdecl = std::make_shared<VertexDeclaration>(VertexStream<vec4,vec4>(VertexUsage::Position, VertexUsage::Color));
+    m_line_api.m_vdecl = std::make_shared<VertexDeclaration>(VertexStream<vec4,vec4,float>(VertexUsage::Position, VertexUsage::Color, VertexUsage::TexCoord));
 
     m_line_api.m_debug_mask = 1;
 }
@@ -166,6 +179,12 @@ void Scene::resize(ivec2 size)
     m_wanted_size = size;
 }
 
+void Scene::set_culling(bool hierarchy, bool occlusion)
+{
+    m_cull_hierarchy = hierarchy;
+    m_cull_occlusion = occlusion;
+}
+
 Scene::~Scene()
 {
     PopCamera(m_default_cam);
@@ -260,14 +279,13 @@ void Scene::SetTileCam(int cam_idx)
 void Scene::Reset()
 {
     /* New scenegraph: Release fire&forget primitives */
-    for (uintptr_t key : keys(m_prim_renderers))
+    for (auto &it : m_prim_renderers)
     {
-        for (int idx = 0; idx < m_prim_renderers[key].count(); ++idx)
-            if (m_prim_renderers[key][idx]->m_fire_and_forget)
-                ReleasePrimitiveRenderer(idx--, key);
+        for (int idx = 0; idx < it.second.count(); ++idx)
+            if (it.second[idx]->m_fire_and_forget)
+                it.second.remove(idx--);
     }
 
-    m_tile_api.m_bufs.clear();
     m_tile_api.m_lights.clear();
 }
 
@@ -406,18 +424,26 @@ void Scene::AddTile(TileSet *tileset, int id, mat4 model)
 
     if (tileset->GetPalette())
         m_tile_api.m_palettes.push(t);
+    else if (tileset->IsDistanceField())
+        m_tile_api.m_fields.push(t);
     else
         m_tile_api.m_tiles.push(t);
 }
 
 void Scene::AddLine(vec3 a, vec3 b, vec4 color)
 {
-    m_line_api.m_lines.push(a, b, color, -1.f, 0xFFFFFFFF, false, false);
+    m_line_api.m_queue.AddLine(a, b, color, -1.f, 0xFFFFFFFF);
 }
 
 void Scene::AddLine(vec3 a, vec3 b, vec4 color, float duration, int mask)
 {
-    m_line_api.m_lines.push(a, b, color, duration, mask, false, false);
+    m_line_api.m_queue.AddLine(a, b, color, duration, mask);
+}
+
+void Scene::AddShape(Debug::Shape shape, mat4 const &transform, vec4 color,
+                     float duration, int mask, int segments)
+{
+    m_line_api.m_queue.AddShape(shape, transform, color, duration, mask, segments);
 }
 
 void Scene::AddLight(Light *l)
@@ -489,6 +515,11 @@ void Scene::render(float seconds)
 {
     gpu_marker("Render");
 
+    Profiler::SetCounter(Profiler::COUNTER_VISIBLE, 0);
+    Profiler::SetCounter(Profiler::COUNTER_CULLED_FRUSTUM, 0);
+    Profiler::SetCounter(Profiler::COUNTER_CULLED_OCCLUSION, 0);
+    Profiler::SetCounter(Profiler::COUNTER_TILE_BATCHES, 0);
+
     // FIXME: get rid of the delta time argument
     render_primitives();
     render_tiles();
@@ -562,18 +593,53 @@ void Scene::render_primitives()
     rc.cull_mode(CullMode::Clockwise);
     rc.depth_func(DepthFunc::LessOrEqual);
 
+    Camera *camera = GetCamera();
+    m_inv_view = inverse(camera->GetView());
+
+    /* Gather the bounds of all primitives and decide which ones are
+     * visible; primitives without bounds get no slot and are always
+     * rendered. */
+    Profiler::Start(Profiler::STAT_TICK_CULL);
+    m_visibility.reset(camera->GetProjection() * camera->GetView());
+
+    array<int> slots;
+    for (auto const &it : m_prim_renderers)
+    {
+        for (auto const &renderer : it.second)
+        {
+            box3 bounds;
+            slots.push(renderer->GetBounds(bounds) ? m_visibility.add(bounds) : -1);
+            if (renderer->GetOccluder(bounds))
+                m_visibility.add(bounds, true);
+        }
+    }
+
+    m_visibility.cull(m_cull_hierarchy, m_cull_occlusion);
+    Profiler::Stop(Profiler::STAT_TICK_CULL);
+
     /* new scenegraph */
-    for (uintptr_t key : keys(m_prim_renderers))
+    int slot = 0, rendered = 0;
+    for (auto const &it : m_prim_renderers)
     {
-        for (int idx = 0; idx < m_prim_renderers[key].count(); ++idx)
+        /* TODO: Not sure if thread compliant */
+        auto sources = g_prim_sources.find(it.first);
+
+        for (int idx = 0; idx < it.second.count(); ++idx)
         {
-            /* TODO: Not sure if thread compliant */
+            int index = slots[slot++];
+            if (index >= 0 && !m_visibility.is_visible(index))
+                continue;
+
             std::shared_ptr<PrimitiveSource> source;
-            if (idx < g_prim_sources[key].count())
-                source = g_prim_sources[key][idx];
-            m_prim_renderers[key][idx]->Render(*this, source);
+            if (sources != g_prim_sources.end() && idx < sources->second.count())
+                source = sources->second[idx];
+            it.second[idx]->Render(*this, source);
+            ++rendered;
         }
     }
+
+    add_cull_stats(rendered, m_visibility.frustum_culled_count(),
+                   m_visibility.occlusion_culled_count());
 }
 
 void Scene::render_tiles() // XXX: rename to Blit()
@@ -581,7 +647,8 @@ void Scene::render_tiles() // XXX: rename to Blit()
     render_context rc(m_renderer);
 
     /* Early test if nothing needs to be rendered */
-    if (!m_tile_api.m_tiles.count() && !m_tile_api.m_palettes.count())
+    if (!m_tile_api.m_tiles.count() && !m_tile_api.m_palettes.count()
+         && !m_tile_api.m_fields.count())
         return;
 
     /* FIXME: we disable culling for now because we don’t have a reliable
@@ -601,11 +668,40 @@ void Scene::render_tiles() // XXX: rename to Blit()
         m_tile_api.m_shader = Shader::Create(LOLFX_RESOURCE_NAME(gpu_tile));
     if (!m_tile_api.m_palette_shader && m_tile_api.m_palettes.count())
         m_tile_api.m_palette_shader = Shader::Create(LOLFX_RESOURCE_NAME(gpu_palette));
+    if (!m_tile_api.m_field_shader && m_tile_api.m_fields.count())
+        m_tile_api.m_field_shader = Shader::Create(LOLFX_RESOURCE_NAME(gpu_distance_field));
 
-    for (int p = 0; p < 2; p++)
+    for (int p = 0; p < 3; p++)
     {
-        auto shader = (p == 0) ? m_tile_api.m_shader : m_tile_api.m_palette_shader;
-        auto &tiles  = (p == 0) ? m_tile_api.m_tiles : m_tile_api.m_palettes;
+        auto shader = (p == 0) ? m_tile_api.m_shader
+                    : (p == 1) ? m_tile_api.m_palette_shader : m_tile_api.m_field_shader;
+        auto &tiles  = (p == 0) ? m_tile_api.m_tiles
+                     : (p == 1) ? m_tile_api.m_palettes : m_tile_api.m_fields;
+
+        if (tiles.count() == 0)
+            continue;
+
+        /* Drop the tiles that are outside the camera frustum, keeping
+         * the others in order. Tiles are not solid, so they are never
+         * used as occluders. */
+        Camera *camera = GetCamera(m_tile_api.m_cam);
+        m_visibility.reset(camera->GetProjection() * camera->GetView());
+        for (auto const &t : tiles)
+        {
+            vec2 size = vec2(t.m_tileset->GetTileSize(t.m_id));
+            vec3 pos = (t.m_model * vec4(0.f, 0.f, 0.f, 1.f)).xyz;
+            vec3 extent = 0.5f * (size.x * abs((t.m_model * vec4::axis_x).xyz)
+                                + size.y * abs((t.m_model * vec4::axis_y).xyz));
+            m_visibility.add(box3(pos - extent, pos + extent));
+        }
+        m_visibility.cull(m_cull_hierarchy, false);
+
+        int visible = 0;
+        for (int i = 0; i < tiles.count(); ++i)
+            if (m_visibility.is_visible(i))
+                tiles[visible++] = tiles[i];
+        tiles.resize(visible);
+        add_cull_stats(visible, m_visibility.frustum_culled_count(), 0);
 
         if (tiles.count() == 0)
             continue;
@@ -628,30 +724,31 @@ void Scene::render_tiles() // XXX: rename to Blit()
         uni_pal = m_tile_api.m_palette_shader ? m_tile_api.m_palette_shader->GetUniformLocation("u_palette") : ShaderUniform();
         uni_texsize = shader->GetUniformLocation("u_texsize");
 
-        for (int buf = 0, i = 0, n; i < tiles.count(); i = n, buf += 2)
+        int batches = 0;
+        for (int buf = 0, i = 0, n; i < tiles.count(); i = n, buf += 2, ++batches)
         {
-            /* Count how many quads will be needed */
+            /* Count how many quads will be needed; tilesets sharing an
+             * atlas page and a palette can be drawn together */
             for (n = i + 1; n < tiles.count(); n++)
-                if (tiles[i].m_tileset != tiles[n].m_tileset)
+                if (tiles[i].m_tileset->GetTexture() != tiles[n].m_tileset->GetTexture()
+                     || tiles[i].m_tileset->GetPalette() != tiles[n].m_tileset->GetPalette())
                     break;
 
-            /* Create a vertex array object */
-            auto vb1 = std::make_shared<VertexBuffer>(6 * (n - i) * sizeof(vec3));
-            vec3 *vertex = (vec3 *)vb1->Lock(0, 0);
-            auto vb2 = std::make_shared<VertexBuffer>(6 * (n - i) * sizeof(vec2));
-            vec2 *texture = (vec2 *)vb2->Lock(0, 0);
-
-            m_tile_api.m_bufs.push(vb1);
-            m_tile_api.m_bufs.push(vb2);
+            /* Fill the batch geometry and send it to transient buffers */
+            m_tile_api.m_vertices.resize(6 * (n - i));
+            m_tile_api.m_texcoords.resize(6 * (n - i));
 
             for (int j = i; j < n; j++)
             {
-                tiles[i].m_tileset->BlitTile(tiles[j].m_id, tiles[j].m_model,
-                                vertex + 6 * (j - i), texture + 6 * (j - i));
+                tiles[j].m_tileset->BlitTile(tiles[j].m_id, tiles[j].m_model,
+                                &m_tile_api.m_vertices[6 * (j - i)],
+                                &m_tile_api.m_texcoords[6 * (j - i)]);
             }
 
-            vb1->Unlock();
-            vb2->Unlock();
+            auto vb1 = TransientBuffer::UploadVertices(m_tile_api.m_vertices.data(),
+                                                       m_tile_api.m_vertices.bytes());
+            auto vb2 = TransientBuffer::UploadVertices(m_tile_api.m_texcoords.data(),
+                                                       m_tile_api.m_texcoords.bytes());
 
             /* Bind texture */
             if (tiles[i].m_tileset->GetPalette())
@@ -673,8 +770,8 @@ void Scene::render_tiles() // XXX: rename to Blit()
 
             /* Bind vertex and texture coordinate buffers */
             m_tile_api.m_vdecl->Bind();
-            m_tile_api.m_vdecl->SetStream(vb1, attr_pos);
-            m_tile_api.m_vdecl->SetStream(vb2, attr_tex);
+            m_tile_api.m_vdecl->SetStream(vb1.buffer, vb1.offset, attr_pos);
+            m_tile_api.m_vdecl->SetStream(vb2.buffer, vb2.offset, attr_tex);
 
             /* Draw arrays */
             m_tile_api.m_vdecl->DrawElements(MeshPrimitive::Triangles, 0, (n - i) * 6);
@@ -683,11 +780,10 @@ void Scene::render_tiles() // XXX: rename to Blit()
         }
 
         tiles.clear();
+        Profiler::SetCounter(Profiler::COUNTER_TILE_BATCHES, batches
+                     + Profiler::GetCounter(Profiler::COUNTER_TILE_BATCHES));
 
         shader->Unbind();
-
-        if (!m_tile_api.m_palette_shader)
-            break;
     }
 
 #if (defined LOL_USE_GLEW || defined HAVE_GL_2X) && !defined HAVE_GLES_2X
@@ -701,66 +797,96 @@ void Scene::render_lines(float seconds)
 {
     render_context rc(m_renderer);
 
-    if (!m_line_api.m_lines.count())
-        return;
-
-    rc.depth_func(DepthFunc::LessOrEqual);
-    rc.blend_func(BlendFunc::SrcAlpha, BlendFunc::OneMinusSrcAlpha);
-    rc.blend_equation(BlendEquation::Add, BlendEquation::Max);
-    rc.alpha_func(AlphaFunc::GreaterOrEqual, 0.01f);
+    auto &api = m_line_api;
+    api.m_time += seconds;
+    float const now = api.m_time;
 
-    int linecount = (int)m_line_api.m_lines.count();
+    /* Gather what all threads recorded since the last frame */
+    int old_count = api.m_persistent.count();
+    api.m_frame.clear();
+    api.m_queue.Merge(api.m_debug_mask, now, api.m_frame, api.m_persistent);
 
-    if (!m_line_api.m_shader)
-        m_line_api.m_shader = Shader::Create(LOLFX_RESOURCE_NAME(gpu_line));
+    for (int i = old_count; i < api.m_persistent.count(); i += 2)
+        if (i == 0 || api.m_persistent[i].m_expiry < api.m_next_expiry)
+            api.m_next_expiry = api.m_persistent[i].m_expiry;
 
-    array<vec4, vec4, vec4, vec4> buff;
-    buff.resize(linecount);
-    int real_linecount = 0;
-    mat4 const inv_view_proj = inverse(GetCamera()->GetProjection() * GetCamera()->GetView());
-    for (int i = 0; i < linecount; i++)
+    /* Expired lines are hidden by the shader; only remove them from the
+     * buffer a few times per second, since this means a full upload. */
+    if (api.m_persistent.count() && now > api.m_next_expiry
+         && now - api.m_last_compact > 0.25f)
     {
-        if (m_line_api.m_lines[i].m5 & m_line_api.m_debug_mask)
-        {
-            buff[real_linecount].m1 = vec4(m_line_api.m_lines[i].m1, (float)m_line_api.m_lines[i].m6);
-            buff[real_linecount].m2 = m_line_api.m_lines[i].m3;
-            buff[real_linecount].m3 = vec4(m_line_api.m_lines[i].m2, (float)m_line_api.m_lines[i].m7);
-            buff[real_linecount].m4 = m_line_api.m_lines[i].m3;
-            real_linecount++;
-        }
-        m_line_api.m_lines[i].m4 -= seconds;
-        if (m_line_api.m_lines[i].m4 < 0.f)
+        int count = 0;
+        for (int i = 0; i < api.m_persistent.count(); i += 2)
         {
-            m_line_api.m_lines.remove_swap(i--);
-            linecount--;
+            if (api.m_persistent[i].m_expiry < now)
+                continue;
+            if (!count || api.m_persistent[i].m_expiry < api.m_next_expiry)
+                api.m_next_expiry = api.m_persistent[i].m_expiry;
+            api.m_persistent[count++] = api.m_persistent[i];
+            api.m_persistent[count++] = api.m_persistent[i + 1];
         }
+        api.m_persistent.resize(count);
+        api.m_last_compact = now;
+        api.m_uploaded = 0;
     }
-    auto vb = std::make_shared<VertexBuffer>(buff.bytes());
-    float *vertex = (float *)vb->Lock(0, 0);
-    memcpy(vertex, buff.data(), buff.bytes());
-    vb->Unlock();
 
-    m_line_api.m_shader->Bind();
+    /* Only send lines that are not on the GPU yet */
+    size_t capacity = api.m_persistent_vbo ? api.m_persistent_vbo->GetSize() : 0;
+    if ((size_t)api.m_persistent.bytes() > capacity)
+    {
+        size_t size = lol::max((size_t)api.m_persistent.bytes() * 2, (size_t)65536);
+        api.m_persistent_vbo = std::make_shared<VertexBuffer>(size);
+        api.m_uploaded = 0;
+    }
 
-    ShaderUniform uni_mat, uni_tex;
-    ShaderAttrib attr_pos, attr_col;
-    attr_pos = m_line_api.m_shader->GetAttribLocation(VertexUsage::Position, 0);
-    attr_col = m_line_api.m_shader->GetAttribLocation(VertexUsage::Color, 0);
+    if (api.m_uploaded < api.m_persistent.count())
+    {
+        api.m_persistent_vbo->Upload(api.m_uploaded * sizeof(DebugLineVertex),
+                                     &api.m_persistent[api.m_uploaded],
+                                     (api.m_persistent.count() - api.m_uploaded) * sizeof(DebugLineVertex));
+        api.m_uploaded = api.m_persistent.count();
+    }
+
+    if (!api.m_frame.count() && !api.m_persistent.count())
+        return;
 
-    m_line_api.m_shader->Bind();
+    rc.depth_func(DepthFunc::LessOrEqual);
+    rc.blend_func(BlendFunc::SrcAlpha, BlendFunc::OneMinusSrcAlpha);
+    rc.blend_equation(BlendEquation::Add, BlendEquation::Max);
+    rc.alpha_func(AlphaFunc::GreaterOrEqual, 0.01f);
 
-    uni_mat = m_line_api.m_shader->GetUniformLocation("u_projection");
-    m_line_api.m_shader->SetUniform(uni_mat, GetCamera()->GetProjection());
-    uni_mat = m_line_api.m_shader->GetUniformLocation("u_view");
-    m_line_api.m_shader->SetUniform(uni_mat, GetCamera()->GetView());
+    if (!api.m_shader)
+        api.m_shader = Shader::Create(LOLFX_RESOURCE_NAME(gpu_line));
 
-    m_line_api.m_vdecl->Bind();
-    m_line_api.m_vdecl->SetStream(vb, attr_pos, attr_col);
-    m_line_api.m_vdecl->DrawElements(MeshPrimitive::Lines, 0, 2 * real_linecount);
-    m_line_api.m_vdecl->Unbind();
-    m_line_api.m_shader->Unbind();
+    ShaderUniform uni_mat, uni_time;
+    ShaderAttrib attr_pos, attr_col, attr_exp;
+    attr_pos = api.m_shader->GetAttribLocation(VertexUsage::Position, 0);
+    attr_col = api.m_shader->GetAttribLocation(VertexUsage::Color, 0);
+    attr_exp = api.m_shader->GetAttribLocation(VertexUsage::TexCoord, 0);
 
-    //m_line_api.m_lines.clear();
+    api.m_shader->Bind();
+
+    uni_mat = api.m_shader->GetUniformLocation("u_projection");
+    api.m_shader->SetUniform(uni_mat, GetCamera()->GetProjection());
+    uni_mat = api.m_shader->GetUniformLocation("u_view");
+    api.m_shader->SetUniform(uni_mat, GetCamera()->GetView());
+    uni_time = api.m_shader->GetUniformLocation("u_time");
+    api.m_shader->SetUniform(uni_time, now);
+
+    api.m_vdecl->Bind();
+    if (api.m_frame.count())
+    {
+        auto vb = TransientBuffer::UploadVertices(api.m_frame.data(), api.m_frame.bytes());
+        api.m_vdecl->SetStream(vb.buffer, vb.offset, attr_pos, attr_col, attr_exp);
+        api.m_vdecl->DrawElements(MeshPrimitive::Lines, 0, api.m_frame.count());
+    }
+    if (api.m_persistent.count())
+    {
+        api.m_vdecl->SetStream(api.m_persistent_vbo, attr_pos, attr_col, attr_exp);
+        api.m_vdecl->DrawElements(MeshPrimitive::Lines, 0, api.m_persistent.count());
+    }
+    api.m_vdecl->Unbind();
+    api.m_shader->Unbind();
 }
 
 } /* namespace lol */
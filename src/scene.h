@@ -25,6 +25,7 @@
 #include "light.h"
 #include "camera.h"
 #include "mesh/mesh.h"
+#include "debug/draw.h"
 #include <lol/gpu/renderer.h>
 
 #define LOL_MAX_LIGHT_COUNT 8
@@ -65,6 +66,11 @@ public:
     virtual ~PrimitiveRenderer() { }
     virtual void Render(Scene& scene, std::shared_ptr<PrimitiveSource> primitive);
 
+    /* World space bounds used for culling; renderers that return false
+     * are always rendered. An occluder box must be entirely solid. */
+    virtual bool GetBounds(box3 &) const { return false; }
+    virtual bool GetOccluder(box3 &) const { return false; }
+
 private:
     bool m_fire_and_forget = false;
 };
@@ -242,8 +248,13 @@ public:
     void AddTile(TileSet *tileset, int id, mat4 model);
 
 public:
+    /* Debug lines and shapes can be added from any thread. A duration
+     * of zero or less means the current frame only. Shapes are unit
+     * meshes mapped to world space by transform. */
     void AddLine(vec3 a, vec3 b, vec4 color);
     void AddLine(vec3 a, vec3 b, vec4 color, float duration, int mask);
+    void AddShape(Debug::Shape shape, mat4 const &transform, vec4 color,
+                  float duration, int mask, int segments = 1);
 
     void AddLight(Light *light);
     array<Light *> const &GetLights();
@@ -259,6 +270,13 @@ public:
     void render(float seconds);
     void post_render(float seconds);
 
+    /* Frustum culling is always done; these enable the bounding volume
+     * hierarchy and the occlusion pass for primitives. */
+    void set_culling(bool hierarchy, bool occlusion);
+
+    /* Inverse of the current camera’s view matrix, updated every frame */
+    mat4 const &GetInverseView() const { return m_inv_view; }
+
 private:
     void render_primitives();
     void render_tiles();
@@ -268,6 +286,10 @@ private:
 
     std::shared_ptr<Renderer> m_renderer;
 
+    visibility m_visibility;
+    bool m_cull_hierarchy = true, m_cull_occlusion = false;
+    mat4 m_inv_view;
+
     //
     // The old SceneData stuff
     //
@@ -301,20 +323,26 @@ private:
      * - Updated by entity
      * - Marked Fire&Forget
      * - Scene is destroyed */
-    std::map<uintptr_t, array<std::shared_ptr<PrimitiveRenderer>>> m_prim_renderers;
-    static std::map<uintptr_t, array<std::shared_ptr<PrimitiveSource>>> g_prim_sources;
+    hash_map<uintptr_t, array<std::shared_ptr<PrimitiveRenderer>>> m_prim_renderers;
+    static hash_map<uintptr_t, array<std::shared_ptr<PrimitiveSource>>> g_prim_sources;
     static mutex g_prim_mutex;
 
     Camera *m_default_cam;
     array<Camera *> m_camera_stack;
 
-    /* Old line API <P0, P1, COLOR, TIME, MASK> */
+    /* Debug lines; those with a duration stay in a GPU buffer until
+     * they expire, which the vertex shader checks against m_time */
     struct line_api
     {
-        //float m_duration, m_segment_size;
-        //vec4 m_color;
-        array<vec3, vec3, vec4, float, int, bool, bool> m_lines;
-        int /*m_mask,*/ m_debug_mask;
+        DebugDrawQueue m_queue;
+        int m_debug_mask;
+        float m_time = 0.f;
+
+        array<DebugLineVertex> m_frame, m_persistent;
+        std::shared_ptr<VertexBuffer> m_persistent_vbo;
+        int m_uploaded = 0;
+        float m_next_expiry = 0.f, m_last_compact = 0.f;
+
         std::shared_ptr<Shader> m_shader;
         std::shared_ptr<VertexDeclaration> m_vdecl;
     }
@@ -326,13 +354,18 @@ private:
         int m_cam;
         array<Tile> m_tiles;
         array<Tile> m_palettes;
+        array<Tile> m_fields;
         array<Light *> m_lights;
 
         std::shared_ptr<Shader> m_shader;
         std::shared_ptr<Shader> m_palette_shader;
+        std::shared_ptr<Shader> m_field_shader;
 
         std::shared_ptr<VertexDeclaration> m_vdecl;
-        array<std::shared_ptr<VertexBuffer>> m_bufs;
+
+        /* Scratch storage for one batch, sent to transient buffers */
+        array<vec3> m_vertices;
+        array<vec2> m_texcoords;
     }
     m_tile_api;
 };
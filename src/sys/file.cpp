@@ -29,7 +29,15 @@
 #   include <unistd.h>
 #endif
 
+#if defined HAVE_SYS_MMAN_H && HAVE_STDIO_H && !__ANDROID__
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   define LOL_FILE_MMAP 1
+#endif
+
 #include <atomic>
+#include <cstring>
+#include <memory>
 #include <string>
 #include <algorithm>
 #include <sys/stat.h>
@@ -49,7 +57,18 @@ class FileData
     FileData()
       : m_refcount(0),
         m_type(StreamType::File)
-    { }
+    {
+#if __ANDROID__
+        m_asset = nullptr;
+#elif HAVE_STDIO_H
+        m_fd = nullptr;
+#endif
+    }
+
+    ~FileData()
+    {
+        Unmap();
+    }
 
     void Open(StreamType stream)
     {
@@ -72,7 +91,28 @@ class FileData
 
     void Open(std::string const &file, FileAccess mode, bool force_binary)
     {
+        Unmap();
         m_type = (force_binary) ? (StreamType::FileBinary) : (StreamType::File);
+
+        /* Files from mounted packs shadow the filesystem */
+        int index;
+        m_pack = mode == FileAccess::Read ? sys::vfs_find(file, index) : nullptr;
+        if (m_pack)
+        {
+            m_pack_data = m_pack->read(index, m_pack_buffer);
+            m_pack_pos = 0;
+
+            /* An entry that cannot be read leaves the file invalid */
+            if (m_pack_data.empty() && m_pack->size(index))
+                m_pack = nullptr;
+#if __ANDROID__
+            m_asset = nullptr;
+#elif HAVE_STDIO_H
+            m_fd = nullptr;
+#endif
+            return;
+        }
+
 #if __ANDROID__
         ASSERT(g_assets);
         m_asset = AAssetManager_open(g_assets, file.c_str(), AASSET_MODE_UNKNOWN);
@@ -88,6 +128,8 @@ class FileData
 
     inline bool IsValid() const
     {
+        if (m_pack)
+            return true;
 #if __ANDROID__
         return !!m_asset;
 #elif HAVE_STDIO_H
@@ -102,6 +144,10 @@ class FileData
         if (m_type != StreamType::File &&
             m_type != StreamType::FileBinary)
             return;
+        Unmap();
+        m_pack = nullptr;
+        m_pack_buffer.clear();
+        m_pack_data = span<uint8_t const>();
 #if __ANDROID__
         if (m_asset)
             AAsset_close(m_asset);
@@ -113,16 +159,26 @@ class FileData
 #endif
     }
 
-    int Read(uint8_t *buf, int count)
+    int64_t Read(uint8_t *buf, int64_t count)
     {
+        if (m_pack)
+        {
+            int64_t done = std::min(count, (int64_t)m_pack_data.size() - m_pack_pos);
+            if (done <= 0)
+                return -1;
+            memcpy(buf, m_pack_data.data() + m_pack_pos, (size_t)done);
+            m_pack_pos += done;
+            return done;
+        }
+
 #if __ANDROID__
-        return AAsset_read(m_asset, buf, count);
+        return AAsset_read(m_asset, buf, (size_t)count);
 #elif HAVE_STDIO_H
-        size_t done = fread(buf, 1, count, m_fd);
+        size_t done = fread(buf, 1, (size_t)count, m_fd);
         if (done <= 0)
             return -1;
 
-        return (int)done;
+        return (int64_t)done;
 #else
         return 0;
 #endif
@@ -130,69 +186,172 @@ class FileData
 
     std::string ReadString()
     {
-        array<uint8_t> buf;
-        buf.resize(BUFSIZ);
         std::string ret;
-        while (IsValid())
+        if (!IsValid())
+            return ret;
+
+        if (m_pack)
         {
-            int done = Read(&buf[0], buf.count());
+            ret.assign((char const *)m_pack_data.data() + m_pack_pos,
+                       (size_t)((int64_t)m_pack_data.size() - m_pack_pos));
+            m_pack_pos = (int64_t)m_pack_data.size();
+            return ret;
+        }
 
-            if (done <= 0)
-                break;
+        /* Read straight into the string: all at once if the size of the
+         * file is known, otherwise growing it geometrically. */
+        int64_t remaining = 0;
+#if HAVE_STDIO_H && !__ANDROID__
+        struct stat st;
+        if (fstat(fileno(m_fd), &st) == 0 && S_ISREG(st.st_mode))
+            remaining = (int64_t)st.st_size - GetPosFromStart();
+#endif
 
-            size_t oldsize = ret.length();
-            ret.resize(oldsize + done);
-            memcpy(&ret[oldsize], &buf[0], done);
+        size_t done = 0;
+        ret.resize(remaining > 0 ? (size_t)remaining + 1 : BUFSIZ);
+        for (;;)
+        {
+            int64_t n = Read((uint8_t *)&ret[done], ret.size() - done);
+            if (n <= 0)
+                break;
 
-            buf.resize(buf.count() * 3 / 2);
+            done += (size_t)n;
+            if (done == ret.size())
+                ret.resize(ret.size() * 2);
         }
+        ret.resize(done);
         return ret;
     }
 
-    int Write(void const *buf, int count)
+    span<uint8_t const> Map(FileHint hint)
+    {
+        if (m_pack)
+            return m_pack_data;
+
+        if (!m_map && IsValid() && (m_type == StreamType::File ||
+                                    m_type == StreamType::FileBinary))
+        {
+#if __ANDROID__
+            /* Uncompressed assets can be accessed directly */
+            void const *data = AAsset_getBuffer(m_asset);
+            if (data)
+            {
+                m_map = const_cast<void *>(data);
+                m_map_size = (size_t)AAsset_getLength64(m_asset);
+            }
+#elif LOL_FILE_MMAP
+            int fd = fileno(m_fd);
+            struct stat st;
+            if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+            {
+                void *data = mmap(nullptr, (size_t)st.st_size, PROT_READ,
+                                  MAP_PRIVATE, fd, 0);
+                if (data != MAP_FAILED)
+                {
+                    m_map = data;
+                    m_map_size = (size_t)st.st_size;
+                }
+            }
+#endif
+            SetHint(hint);
+        }
+
+        return span<uint8_t const>((uint8_t const *)m_map, m_map_size);
+    }
+
+    void Unmap()
+    {
+#if LOL_FILE_MMAP
+        if (m_map)
+            munmap(m_map, m_map_size);
+#endif
+        m_map = nullptr;
+        m_map_size = 0;
+    }
+
+    void SetHint(FileHint hint)
+    {
+#if LOL_FILE_MMAP
+        if (!IsValid() || m_pack)
+            return;
+
+        if (m_map)
+        {
+            int advice = hint == FileHint::Sequential ? MADV_SEQUENTIAL
+                       : hint == FileHint::Random ? MADV_RANDOM : MADV_NORMAL;
+            madvise(m_map, m_map_size, advice);
+        }
+#   if defined POSIX_FADV_SEQUENTIAL
+        int advice = hint == FileHint::Sequential ? POSIX_FADV_SEQUENTIAL
+                   : hint == FileHint::Random ? POSIX_FADV_RANDOM
+                   : POSIX_FADV_NORMAL;
+        posix_fadvise(fileno(m_fd), 0, 0, advice);
+#   endif
+#else
+        UNUSED(hint);
+#endif
+    }
+
+    int64_t Write(void const *buf, size_t count)
     {
 #if __ANDROID__
         //return AAsset_read(m_asset, buf, count);
         return 0;
 #elif HAVE_STDIO_H
+        if (count == 0)
+            return 0;
+
         size_t done = fwrite(buf, 1, count, m_fd);
         if (done <= 0)
             return -1;
 
-        return (int)done;
+        return (int64_t)done;
 #else
         return 0;
 #endif
     }
 
-    long int GetPosFromStart()
+    int64_t GetPosFromStart()
     {
+        if (m_pack)
+            return m_pack_pos;
 #if __ANDROID__
-        return 0;
+        return AAsset_getLength64(m_asset) - AAsset_getRemainingLength64(m_asset);
+#elif HAVE_STDIO_H && defined _WIN32
+        return _ftelli64(m_fd);
 #elif HAVE_STDIO_H
-        return ftell(m_fd);
+        return (int64_t)ftello(m_fd);
 #else
         return 0;
 #endif
     }
 
-    void SetPosFromStart(long int pos)
+    void SetPosFromStart(int64_t pos)
     {
+        if (m_pack)
+        {
+            m_pack_pos = std::max((int64_t)0, std::min(pos, (int64_t)m_pack_data.size()));
+            return;
+        }
 #if __ANDROID__
-        //NOT IMPLEMENTED
+        AAsset_seek64(m_asset, pos, SEEK_SET);
+#elif HAVE_STDIO_H && defined _WIN32
+        _fseeki64(m_fd, pos, SEEK_SET);
 #elif HAVE_STDIO_H
-        fseek(m_fd, pos, SEEK_SET);
+        fseeko(m_fd, (off_t)pos, SEEK_SET);
 #else
-        //NOT IMPLEMENTED
+        UNUSED(pos);
 #endif
     }
 
-    long int size()
+    int64_t size()
     {
+        if (m_pack)
+            return (int64_t)m_pack_data.size();
 #if __ANDROID__
         return 0;
 #elif HAVE_STDIO_H
-        return m_stat.st_size;
+        return (int64_t)m_stat.st_size;
 #else
         return 0;
 #endif
@@ -200,6 +359,8 @@ class FileData
 
     long int GetModificationTime()
     {
+        if (m_pack)
+            return m_pack->modification_time();
 #if __ANDROID__
         return 0;
 #elif HAVE_STDIO_H
@@ -218,6 +379,14 @@ class FileData
     std::atomic<int> m_refcount;
     StreamType m_type;
     struct stat m_stat;
+    void *m_map = nullptr;
+    size_t m_map_size = 0;
+
+    /* Set when the file comes from a mounted pack */
+    std::shared_ptr<pack> m_pack;
+    array<uint8_t> m_pack_buffer;
+    span<uint8_t const> m_pack_data;
+    int64_t m_pack_pos = 0;
 };
 
 //-- FILE --
@@ -290,7 +459,7 @@ void File::Close()
 }
 
 //--
-int File::Read(uint8_t *buf, int count)
+int64_t File::Read(uint8_t *buf, int64_t count)
 {
     return m_data->Read(buf, count);
 }
@@ -302,31 +471,37 @@ std::string File::ReadString()
 }
 
 //--
-int File::Write(void const *buf, int count)
+int64_t File::Write(void const *buf, size_t count)
 {
     return m_data->Write(buf, count);
 }
 
 //--
-int File::Write(std::string const &buf)
+int64_t File::Write(span<uint8_t const> buf)
 {
-    return m_data->Write(buf.c_str(), (int)buf.length());
+    return m_data->Write(buf.data(), buf.size());
 }
 
 //--
-long int File::GetPosFromStart()
+int64_t File::Write(std::string const &buf)
+{
+    return m_data->Write(buf.c_str(), buf.length());
+}
+
+//--
+int64_t File::GetPosFromStart()
 {
     return m_data->GetPosFromStart();
 }
 
 //--
-void File::SetPosFromStart(long int pos)
+void File::SetPosFromStart(int64_t pos)
 {
     m_data->SetPosFromStart(pos);
 }
 
 //--
-long int File::size()
+int64_t File::size()
 {
     return m_data->size();
 }
@@ -337,12 +512,60 @@ long int File::GetModificationTime()
     return m_data->GetModificationTime();
 }
 
+//--
+span<uint8_t const> File::Map(FileHint hint)
+{
+    return m_data->Map(hint);
+}
+
+//--
+void File::SetHint(FileHint hint)
+{
+    m_data->SetHint(hint);
+}
+
+//-- FILEREADER --
+FileReader::FileReader(File &file, size_t chunk_size)
+  : m_file(file),
+    m_started(false),
+    m_mapped(false)
+{
+    m_buffer.resize((int)chunk_size);
+}
+
+//--
+span<uint8_t const> FileReader::Next()
+{
+    if (!m_started)
+    {
+        m_started = true;
+        span<uint8_t const> view = m_file.Map(FileHint::Sequential);
+        if (!view.empty())
+        {
+            m_mapped = true;
+            int64_t pos = m_file.GetPosFromStart();
+            m_file.SetPosFromStart((int64_t)view.size());
+            return view.subspan((size_t)pos);
+        }
+    }
+
+    if (m_mapped)
+        return span<uint8_t const>();
+
+    int64_t done = m_file.Read(m_buffer.data(), m_buffer.count());
+    if (done <= 0)
+        return span<uint8_t const>();
+    return span<uint8_t const>(m_buffer.data(), (size_t)done);
+}
+
 //---------------
 class DirectoryData
 {
     friend class Directory;
 
-    DirectoryData() : m_type(StreamType::File)
+    DirectoryData()
+      : m_refcount(0),
+        m_type(StreamType::File)
     {
 #if __ANDROID__
         /* FIXME: not implemented */
@@ -531,7 +754,7 @@ void Directory::Open(FileAccess mode)
 //--
 bool Directory::IsValid() const
 {
-    return m_data->IsValid();
+    return m_data->IsValid() || sys::vfs_list(m_name, nullptr, nullptr);
 }
 
 //--
@@ -547,6 +770,9 @@ bool Directory::GetContent(array<std::string>* files, array<Directory>* director
     bool found_some = m_data->GetContentList(&sfiles, &sdirectories);
     UNUSED(found_some);
 
+    /* Add the contents of mounted packs */
+    sys::vfs_list(m_name, &sfiles, &sdirectories);
+
     if (directories)
         for (int i = 0; i < sdirectories.count(); i++)
             directories->push(Directory(m_name + sdirectories[i]));
@@ -167,6 +167,14 @@ array<std::string> get_path_list(std::string const &file)
 {
     array<std::string> ret;
 
+    /* Files from mounted packs shadow the data directories */
+    int index;
+    if (vfs_find(file, index))
+    {
+        ret << file;
+        return ret;
+    }
+
     /* If not an absolute path, look through known data directories */
     if (file[0] != '/')
     {
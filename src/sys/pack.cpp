@@ -0,0 +1,771 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace lol
+{
+
+/*
+ * Pack file layout. Integers are stored in native byte order, which is
+ * little-endian on every platform we support.
+ *
+ *   header  magic, version, entry count, blob alignment, and the
+ *           offsets of the index and of the name table
+ *   blobs   the entry contents, each aligned on the pack alignment
+ *   index   one pack_entry per name, sorted by name hash
+ *   names   the entry names, back to back
+ */
+
+static char const PACK_MAGIC[4] = { 'L', 'P', 'A', 'K' };
+static uint16_t const PACK_VERSION = 1;
+
+struct pack_header
+{
+    char magic[4];
+    uint16_t version, reserved;
+    uint32_t count, alignment;
+    uint64_t index_offset, names_offset;
+};
+
+struct pack_entry
+{
+    uint64_t hash, offset;
+    uint32_t stored_size, size;
+    uint32_t name_offset;
+    uint16_t name_length, codec;
+};
+
+static_assert(sizeof(pack_header) == 32, "unexpected pack_header size");
+static_assert(sizeof(pack_entry) == 32, "unexpected pack_entry size");
+
+/* Entry names use forward slashes and never start with “./” */
+static std::string normalise_name(std::string const &name)
+{
+    std::string ret = name;
+    std::replace(ret.begin(), ret.end(), '\\', '/');
+    while (ret.compare(0, 2, "./") == 0)
+        ret.erase(0, 2);
+    return ret;
+}
+
+/* 64-bit FNV-1a */
+static uint64_t hash_bytes(void const *data, size_t len)
+{
+    uint8_t const *p = (uint8_t const *)data;
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < len; ++i)
+        h = (h ^ p[i]) * 0x100000001b3ull;
+    return h;
+}
+
+/*
+ * The built-in codec is a byte-oriented LZ77 in the spirit of LZ4. Each
+ * sequence is a token (literal count in the high nibble, match length
+ * minus LZ_MIN_MATCH in the low nibble), optional extra literal count
+ * bytes, the literals, a 16-bit match offset and optional extra match
+ * length bytes. The last sequence has literals only.
+ */
+
+static size_t const LZ_MIN_MATCH = 4;
+static size_t const LZ_MAX_OFFSET = 65535;
+static int const LZ_HASH_BITS = 14;
+
+array<uint8_t> pack::lz_compress(span<uint8_t const> data)
+{
+    uint8_t const *src = data.data();
+    size_t const len = data.size();
+
+    array<uint8_t> out;
+    out.reserve(len + len / 255 + 16);
+
+    array<int32_t> table;
+    table.resize(1 << LZ_HASH_BITS, -1);
+
+    auto put_length = [&](size_t n)
+    {
+        for (; n >= 255; n -= 255)
+            out << 255;
+        out << (uint8_t)n;
+    };
+
+    size_t anchor = 0;
+    auto put_sequence = [&](size_t literal_end, size_t match, size_t offset)
+    {
+        size_t literals = literal_end - anchor;
+        size_t extra = match ? match - LZ_MIN_MATCH : 0;
+        out << (uint8_t)((std::min(literals, (size_t)15) << 4)
+                          | std::min(extra, (size_t)15));
+        if (literals >= 15)
+            put_length(literals - 15);
+        if (literals)
+        {
+            int pos = out.count();
+            out.resize(pos + (int)literals);
+            memcpy(out.data() + pos, src + anchor, literals);
+        }
+        if (match)
+        {
+            out << (uint8_t)offset << (uint8_t)(offset >> 8);
+            if (extra >= 15)
+                put_length(extra - 15);
+        }
+    };
+
+    for (size_t i = 0; i + LZ_MIN_MATCH <= len; )
+    {
+        uint32_t v;
+        memcpy(&v, src + i, sizeof(v));
+        uint32_t h = (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+        int32_t candidate = table[h];
+        table[h] = (int32_t)i;
+
+        if (candidate >= 0 && i - candidate <= LZ_MAX_OFFSET
+             && memcmp(src + candidate, src + i, LZ_MIN_MATCH) == 0)
+        {
+            size_t match = LZ_MIN_MATCH;
+            while (i + match < len && src[candidate + match] == src[i + match])
+                ++match;
+            put_sequence(i, match, i - candidate);
+            i += match;
+            anchor = i;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    put_sequence(len, 0, 0);
+    return out;
+}
+
+bool pack::lz_decompress(span<uint8_t const> data, span<uint8_t> out)
+{
+    uint8_t const *ip = data.begin(), *iend = data.end();
+    uint8_t *op = out.begin(), *oend = out.end();
+
+    auto get_length = [&](size_t &n) -> bool
+    {
+        for (uint8_t b = 255; b == 255; n += b)
+        {
+            if (ip == iend)
+                return false;
+            b = *ip++;
+        }
+        return true;
+    };
+
+    while (ip < iend)
+    {
+        uint8_t token = *ip++;
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !get_length(literals))
+            return false;
+        if ((size_t)(iend - ip) < literals || (size_t)(oend - op) < literals)
+            return false;
+        if (literals)
+            memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+
+        if (ip == iend)
+            break;
+
+        if (iend - ip < 2)
+            return false;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+
+        size_t match = token & 15;
+        if (match == 15 && !get_length(match))
+            return false;
+        match += LZ_MIN_MATCH;
+
+        if (offset == 0 || offset > (size_t)(op - out.begin())
+             || (size_t)(oend - op) < match)
+            return false;
+
+        /* Overlapping matches repeat the last offset bytes */
+        uint8_t const *from = op - offset;
+        if (offset >= match)
+            memcpy(op, from, match);
+        else
+            for (size_t i = 0; i < match; ++i)
+                op[i] = from[i];
+        op += match;
+    }
+
+    return op == oend;
+}
+
+/*
+ * Pack reader
+ */
+
+struct pack_private
+{
+    /* Copy bytes from the pack, whether it is mapped or not */
+    bool fetch(uint64_t offset, void *dst, size_t len)
+    {
+        if (offset > m_file_size || len > m_file_size - offset)
+            return false;
+
+        if (!m_map.empty())
+        {
+            if (len)
+                memcpy(dst, m_map.data() + offset, len);
+            return true;
+        }
+
+        m_mutex.lock();
+        m_file.SetPosFromStart((int64_t)offset);
+        size_t done = 0;
+        while (done < len)
+        {
+            int64_t n = m_file.Read((uint8_t *)dst + done, (int64_t)(len - done));
+            if (n <= 0)
+                break;
+            done += (size_t)n;
+        }
+        m_mutex.unlock();
+        return done == len;
+    }
+
+    File m_file;
+    mutex m_mutex;
+    span<uint8_t const> m_map;
+    uint64_t m_file_size = 0;
+    long int m_mtime = 0;
+
+    /* Point into the mapped pack when possible */
+    pack_entry const *m_index = nullptr;
+    char const *m_names = nullptr;
+    uint32_t m_count = 0;
+    bool m_open = false;
+
+    array<pack_entry> m_index_copy;
+    std::string m_names_copy;
+};
+
+pack::pack()
+  : m_private(new pack_private())
+{
+}
+
+pack::~pack()
+{
+    close();
+}
+
+bool pack::open(std::string const &path)
+{
+    close();
+
+    auto &p = *m_private;
+    p.m_file.Open(path, FileAccess::Read, true);
+    if (!p.m_file.IsValid())
+        return false;
+
+    p.m_map = p.m_file.Map(FileHint::Random);
+    p.m_file_size = p.m_map.empty() ? (uint64_t)p.m_file.size()
+                                    : (uint64_t)p.m_map.size();
+    p.m_mtime = p.m_file.GetModificationTime();
+
+    pack_header header;
+    if (!p.fetch(0, &header, sizeof(header))
+         || memcmp(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0)
+    {
+        msg::error("pack: %s is not a pack file\n", path.c_str());
+        close();
+        return false;
+    }
+
+    if (header.version != PACK_VERSION)
+    {
+        msg::error("pack: %s has unsupported version %d\n", path.c_str(),
+                   (int)header.version);
+        close();
+        return false;
+    }
+
+    /* Check the layout against the file size first, without sums that
+     * could overflow, so that nothing below reads outside the file */
+    uint64_t index_size = (uint64_t)header.count * sizeof(pack_entry);
+    bool valid = header.alignment && !(header.alignment & (header.alignment - 1))
+              && header.index_offset >= sizeof(header)
+              && header.index_offset <= header.names_offset
+              && header.names_offset - header.index_offset == index_size
+              && header.names_offset <= p.m_file_size;
+
+    /* Use the index and names in place if the pack is mapped */
+    uint64_t names_size = p.m_file_size - header.names_offset;
+    if (valid && !p.m_map.empty() && header.index_offset % alignof(pack_entry) == 0)
+    {
+        p.m_index = (pack_entry const *)(p.m_map.data() + header.index_offset);
+        p.m_names = (char const *)p.m_map.data() + header.names_offset;
+    }
+    else if (valid)
+    {
+        p.m_index_copy.resize(header.count);
+        p.m_names_copy.resize((size_t)names_size);
+        valid = p.fetch(header.index_offset, p.m_index_copy.data(), (size_t)index_size)
+             && p.fetch(header.names_offset, &p.m_names_copy[0], (size_t)names_size);
+        p.m_index = p.m_index_copy.data();
+        p.m_names = p.m_names_copy.c_str();
+    }
+
+    for (uint32_t i = 0; valid && i < header.count; ++i)
+    {
+        pack_entry const &e = p.m_index[i];
+        valid = e.offset >= sizeof(header)
+             && e.offset <= header.index_offset
+             && e.stored_size <= header.index_offset - e.offset
+             && (uint64_t)e.name_offset + e.name_length <= names_size
+             && (e.codec == (uint16_t)pack_codec::lz
+                  || (e.codec == (uint16_t)pack_codec::none
+                       && e.stored_size == e.size))
+             && (i == 0 || p.m_index[i - 1].hash <= e.hash);
+    }
+
+    if (!valid)
+    {
+        msg::error("pack: %s is corrupt\n", path.c_str());
+        close();
+        return false;
+    }
+
+    p.m_count = header.count;
+    p.m_open = true;
+    return true;
+}
+
+void pack::close()
+{
+    auto &p = *m_private;
+    p.m_file.Close();
+    p.m_map = span<uint8_t const>();
+    p.m_file_size = 0;
+    p.m_index = nullptr;
+    p.m_names = nullptr;
+    p.m_count = 0;
+    p.m_open = false;
+    p.m_index_copy.clear();
+    p.m_names_copy.clear();
+}
+
+bool pack::is_open() const
+{
+    return m_private->m_open;
+}
+
+int pack::count() const
+{
+    return (int)m_private->m_count;
+}
+
+int pack::find(std::string const &name) const
+{
+    auto const &p = *m_private;
+    std::string key = normalise_name(name);
+    uint64_t hash = hash_bytes(key.data(), key.size());
+
+    pack_entry const *begin = p.m_index, *end = p.m_index + p.m_count;
+    auto it = std::lower_bound(begin, end, hash,
+                  [](pack_entry const &e, uint64_t h) { return e.hash < h; });
+
+    /* Resolve hash collisions by comparing the names */
+    for (; it != end && it->hash == hash; ++it)
+        if (it->name_length == key.size()
+             && memcmp(p.m_names + it->name_offset, key.data(), key.size()) == 0)
+            return (int)(it - begin);
+
+    return -1;
+}
+
+std::string pack::name(int n) const
+{
+    auto const &p = *m_private;
+    ASSERT(n >= 0 && n < (int)p.m_count, "pack entry %d/%d", n, (int)p.m_count);
+    return std::string(p.m_names + p.m_index[n].name_offset,
+                       p.m_index[n].name_length);
+}
+
+size_t pack::size(int n) const
+{
+    auto const &p = *m_private;
+    ASSERT(n >= 0 && n < (int)p.m_count, "pack entry %d/%d", n, (int)p.m_count);
+    return p.m_index[n].size;
+}
+
+pack_codec pack::codec(int n) const
+{
+    auto const &p = *m_private;
+    ASSERT(n >= 0 && n < (int)p.m_count, "pack entry %d/%d", n, (int)p.m_count);
+    return (pack_codec)p.m_index[n].codec;
+}
+
+long int pack::modification_time() const
+{
+    return m_private->m_mtime;
+}
+
+span<uint8_t const> pack::read(int n, array<uint8_t> &buffer)
+{
+    auto &p = *m_private;
+    ASSERT(n >= 0 && n < (int)p.m_count, "pack entry %d/%d", n, (int)p.m_count);
+    pack_entry const &e = p.m_index[n];
+
+    /* Stored entries of mapped packs need no copy at all */
+    span<uint8_t const> stored;
+    array<uint8_t> tmp;
+    if (!p.m_map.empty())
+    {
+        stored = p.m_map.subspan((size_t)e.offset, e.stored_size);
+        if (e.codec == (uint16_t)pack_codec::none)
+            return stored;
+    }
+    else
+    {
+        array<uint8_t> &dst = e.codec == (uint16_t)pack_codec::none ? buffer : tmp;
+        dst.resize(e.stored_size);
+        if (!p.fetch(e.offset, dst.data(), e.stored_size))
+        {
+            msg::error("pack: cannot read entry %s\n", name(n).c_str());
+            return span<uint8_t const>();
+        }
+        stored = span<uint8_t const>(dst.data(), e.stored_size);
+        if (e.codec == (uint16_t)pack_codec::none)
+            return stored;
+    }
+
+    buffer.resize(e.size);
+    if (!lz_decompress(stored, span<uint8_t>(buffer.data(), e.size)))
+    {
+        msg::error("pack: corrupt entry %s\n", name(n).c_str());
+        return span<uint8_t const>();
+    }
+    return span<uint8_t const>(buffer.data(), e.size);
+}
+
+/*
+ * Pack writer
+ */
+
+struct pack_writer_private
+{
+    struct blob
+    {
+        std::vector<uint8_t> data;
+        uint32_t size;
+        pack_codec codec;
+    };
+
+    uint32_t m_alignment;
+    std::vector<blob> m_blobs;
+    std::map<std::string, int> m_names;
+    std::multimap<uint64_t, int> m_contents;
+};
+
+pack_writer::pack_writer(uint32_t alignment)
+  : m_private(new pack_writer_private())
+{
+    ASSERT(alignment && !(alignment & (alignment - 1)),
+           "pack alignment %d is not a power of two", (int)alignment);
+    m_private->m_alignment = alignment;
+}
+
+pack_writer::~pack_writer()
+{
+}
+
+bool pack_writer::add(std::string const &name, span<uint8_t const> data,
+                      bool compress)
+{
+    auto &p = *m_private;
+    std::string key = normalise_name(name);
+    if (key.empty() || key.size() > UINT16_MAX || data.size() > UINT32_MAX)
+    {
+        msg::error("pack: cannot add entry “%s”\n", name.c_str());
+        return false;
+    }
+
+    pack_writer_private::blob b;
+    b.size = (uint32_t)data.size();
+    b.codec = pack_codec::none;
+
+    /* Only keep the compressed data if it saves something worthwhile */
+    if (compress && data.size() >= 16)
+    {
+        array<uint8_t> packed = pack::lz_compress(data);
+        if ((size_t)packed.count() < data.size() - data.size() / 16)
+        {
+            b.data.assign(packed.data(), packed.data() + packed.count());
+            b.codec = pack_codec::lz;
+        }
+    }
+    if (b.codec == pack_codec::none)
+        b.data.assign(data.begin(), data.end());
+
+    /* Identical contents are only stored once */
+    uint64_t hash = hash_bytes(data.data(), data.size());
+    int index = -1;
+    auto range = p.m_contents.equal_range(hash);
+    for (auto it = range.first; it != range.second && index < 0; ++it)
+    {
+        auto const &other = p.m_blobs[it->second];
+        if (other.size == b.size && other.codec == b.codec && other.data == b.data)
+            index = it->second;
+    }
+
+    if (index < 0)
+    {
+        index = (int)p.m_blobs.size();
+        p.m_blobs.push_back(std::move(b));
+        p.m_contents.insert(std::make_pair(hash, index));
+    }
+
+    p.m_names[key] = index;
+    return true;
+}
+
+bool pack_writer::save(std::string const &path)
+{
+    auto &p = *m_private;
+
+    File f;
+    f.Open(path, FileAccess::Write, true);
+    if (!f.IsValid())
+    {
+        msg::error("pack: cannot create %s\n", path.c_str());
+        return false;
+    }
+
+    uint64_t const alignment = p.m_alignment;
+    auto align = [](uint64_t x, uint64_t a) { return (x + a - 1) / a * a; };
+
+    /* Lay out the blobs */
+    std::vector<uint64_t> offsets;
+    uint64_t pos = sizeof(pack_header);
+    for (auto const &b : p.m_blobs)
+    {
+        pos = align(pos, alignment);
+        offsets.push_back(pos);
+        pos += b.data.size();
+    }
+
+    /* Build the index */
+    std::string names;
+    std::vector<pack_entry> index;
+    for (auto const &kv : p.m_names)
+    {
+        auto const &b = p.m_blobs[kv.second];
+        pack_entry e;
+        e.hash = hash_bytes(kv.first.data(), kv.first.size());
+        e.offset = offsets[kv.second];
+        e.stored_size = (uint32_t)b.data.size();
+        e.size = b.size;
+        e.name_offset = (uint32_t)names.size();
+        e.name_length = (uint16_t)kv.first.size();
+        e.codec = (uint16_t)b.codec;
+        index.push_back(e);
+        names += kv.first;
+    }
+    std::stable_sort(index.begin(), index.end(),
+                     [](pack_entry const &a, pack_entry const &b)
+                     { return a.hash < b.hash; });
+
+    pack_header header;
+    memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+    header.version = PACK_VERSION;
+    header.reserved = 0;
+    header.count = (uint32_t)index.size();
+    header.alignment = p.m_alignment;
+    header.index_offset = align(pos, alignof(pack_entry));
+    header.names_offset = header.index_offset + index.size() * sizeof(pack_entry);
+
+    /* Write everything, padding with zeroes where needed */
+    uint64_t written = 0;
+    bool ok = true;
+    auto put = [&](void const *data, size_t len)
+    {
+        for (size_t done = 0; ok && done < len; )
+        {
+            int64_t n = f.Write((uint8_t const *)data + done, len - done);
+            ok = n > 0;
+            done += ok ? (size_t)n : 0;
+        }
+        written += len;
+    };
+    auto pad = [&](uint64_t to)
+    {
+        static uint8_t const zero[64] = { 0 };
+        while (ok && written < to)
+            put(zero, (size_t)std::min(to - written, (uint64_t)sizeof(zero)));
+    };
+
+    put(&header, sizeof(header));
+    for (size_t i = 0; i < p.m_blobs.size(); ++i)
+    {
+        pad(offsets[i]);
+        put(p.m_blobs[i].data.data(), p.m_blobs[i].data.size());
+    }
+    pad(header.index_offset);
+    put(index.data(), index.size() * sizeof(pack_entry));
+    put(names.data(), names.size());
+    f.Close();
+
+    if (!ok)
+        msg::error("pack: error writing %s\n", path.c_str());
+    return ok;
+}
+
+int pack_writer::count() const
+{
+    return (int)m_private->m_names.size();
+}
+
+int pack_writer::blob_count() const
+{
+    return (int)m_private->m_blobs.size();
+}
+
+/*
+ * The virtual file system
+ */
+
+namespace sys
+{
+
+static mutex g_vfs_mutex;
+static std::vector<std::shared_ptr<pack>> g_vfs_packs;
+static std::atomic<int> g_vfs_count(0);
+
+bool mount_pack(std::string const &path)
+{
+    auto p = std::make_shared<pack>();
+    for (auto const &candidate : get_path_list(path))
+        if (p->open(candidate))
+            break;
+
+    if (!p->is_open())
+    {
+        msg::error("cannot mount pack %s\n", path.c_str());
+        return false;
+    }
+
+    msg::debug("mounted pack %s (%d entries)\n", path.c_str(), p->count());
+
+    g_vfs_mutex.lock();
+    g_vfs_packs.insert(g_vfs_packs.begin(), p);
+    g_vfs_count = (int)g_vfs_packs.size();
+    g_vfs_mutex.unlock();
+    return true;
+}
+
+void unmount_packs()
+{
+    g_vfs_mutex.lock();
+    g_vfs_packs.clear();
+    g_vfs_count = 0;
+    g_vfs_mutex.unlock();
+}
+
+std::shared_ptr<pack> vfs_find(std::string const &name, int &index)
+{
+    /* Keep plain filesystem accesses cheap when nothing is mounted */
+    if (!g_vfs_count)
+        return nullptr;
+
+    std::shared_ptr<pack> ret;
+    g_vfs_mutex.lock();
+    for (auto const &p : g_vfs_packs)
+    {
+        index = p->find(name);
+        if (index >= 0)
+        {
+            ret = p;
+            break;
+        }
+    }
+    g_vfs_mutex.unlock();
+    return ret;
+}
+
+bool vfs_list(std::string const &directory,
+              array<std::string> *files, array<std::string> *dirs)
+{
+    if (!g_vfs_count)
+        return false;
+
+    std::string prefix = normalise_name(directory);
+    if (prefix == ".")
+        prefix.clear();
+    if (prefix.length() && prefix.back() != '/')
+        prefix += '/';
+
+    /* Names already listed, by the filesystem or by another pack; the
+     * same directory also comes up once per entry it contains */
+    std::unordered_set<std::string> seen_files, seen_dirs;
+    for (int i = 0; files && i < files->count(); ++i)
+        seen_files.insert((*files)[i]);
+    for (int i = 0; dirs && i < dirs->count(); ++i)
+        seen_dirs.insert((*dirs)[i]);
+
+    bool found = false;
+    g_vfs_mutex.lock();
+    for (auto const &p : g_vfs_packs)
+    {
+        for (int i = 0; i < p->count(); ++i)
+        {
+            std::string name = p->name(i);
+            if (name.compare(0, prefix.length(), prefix) != 0)
+                continue;
+
+            found = true;
+            if (!files && !dirs)
+                break;
+
+            size_t slash = name.find('/', prefix.length());
+            if (slash == std::string::npos && files)
+            {
+                std::string file = name.substr(prefix.length());
+                if (seen_files.insert(file).second)
+                    files->push(file);
+            }
+            else if (slash != std::string::npos && dirs)
+            {
+                std::string dir = name.substr(prefix.length(),
+                                              slash - prefix.length());
+                if (seen_dirs.insert(dir).second)
+                    dirs->push(dir);
+            }
+        }
+    }
+    g_vfs_mutex.unlock();
+    return found;
+}
+
+} /* namespace sys */
+
+} /* namespace lol */
+
@@ -0,0 +1,173 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <vector>
+
+namespace lol
+{
+
+/*
+ * Thread pool implementation
+ */
+
+/* Whether the current thread is running a pool task */
+static thread_local bool g_in_task = false;
+
+struct thread_pool_private
+{
+    int m_max_threads = 0;
+    bool m_deterministic = false;
+
+    /* The current job; workers with an index below m_limit take part
+     * in every job, and the caller waits until all of them are done. */
+    std::function<void(int)> const *m_fn = nullptr;
+    std::atomic<int> m_next { 0 };
+    int m_count = 0;
+
+    void work()
+    {
+        g_in_task = true;
+        for (int n = m_next++; n < m_count; n = m_next++)
+            (*m_fn)(n);
+        g_in_task = false;
+    }
+
+#if LOL_FEATURE_THREADS
+    void worker(int index)
+    {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            m_wake.wait(lock, [&]{ return m_quit || (m_generation != seen && index < m_limit); });
+            if (m_quit)
+                return;
+
+            seen = m_generation;
+            lock.unlock();
+            work();
+            lock.lock();
+
+            if (--m_pending == 0)
+                m_done.notify_one();
+        }
+    }
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex, m_run_mutex;
+    std::condition_variable m_wake, m_done;
+    uint64_t m_generation = 0;
+    int m_limit = 0, m_pending = 0;
+    bool m_quit = false;
+#endif
+};
+
+thread_pool::thread_pool(int threads)
+  : m_private(new thread_pool_private())
+{
+#if LOL_FEATURE_THREADS
+    if (threads <= 0)
+        threads = (int)std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 0; i < threads - 1; ++i)
+        m_private->m_threads.push_back(std::thread([this, i]() { m_private->worker(i); }));
+#else
+    UNUSED(threads);
+#endif
+}
+
+thread_pool::~thread_pool()
+{
+#if LOL_FEATURE_THREADS
+    {
+        std::unique_lock<std::mutex> lock(m_private->m_mutex);
+        m_private->m_quit = true;
+    }
+    m_private->m_wake.notify_all();
+    for (auto &t : m_private->m_threads)
+        t.join();
+#endif
+}
+
+thread_pool &thread_pool::shared()
+{
+    static thread_pool pool;
+    return pool;
+}
+
+int thread_pool::size() const
+{
+#if LOL_FEATURE_THREADS
+    int ret = (int)m_private->m_threads.size() + 1;
+    return m_private->m_max_threads > 0 ? std::min(ret, m_private->m_max_threads) : ret;
+#else
+    return 1;
+#endif
+}
+
+void thread_pool::set_max_threads(int threads)
+{
+    m_private->m_max_threads = std::max(threads, 0);
+}
+
+bool thread_pool::deterministic() const
+{
+    return m_private->m_deterministic;
+}
+
+void thread_pool::set_deterministic(bool deterministic)
+{
+    m_private->m_deterministic = deterministic;
+}
+
+void thread_pool::run(int count, std::function<void(int)> const &fn)
+{
+    thread_pool_private *data = m_private.get();
+
+#if LOL_FEATURE_THREADS
+    int const helpers = std::min(size(), count) - 1;
+    if (helpers > 0 && !g_in_task && data->m_run_mutex.try_lock())
+    {
+        {
+            std::unique_lock<std::mutex> lock(data->m_mutex);
+            data->m_fn = &fn;
+            data->m_count = count;
+            data->m_next = 0;
+            data->m_limit = data->m_pending = helpers;
+            ++data->m_generation;
+        }
+        data->m_wake.notify_all();
+
+        data->work();
+
+        {
+            std::unique_lock<std::mutex> lock(data->m_mutex);
+            data->m_done.wait(lock, [&]{ return data->m_pending == 0; });
+            data->m_fn = nullptr;
+        }
+        data->m_run_mutex.unlock();
+        return;
+    }
+#endif
+
+    /* Serial fallback; nested calls must not clear the task flag */
+    bool const nested = g_in_task;
+    g_in_task = true;
+    for (int n = 0; n < count; ++n)
+        fn(n);
+    g_in_task = nested;
+}
+
+} /* namespace lol */
+
@@ -14,6 +14,8 @@
 
 #include <lol/engine-internal.h>
 
+#include <map>
+
 #include <lolunit.h>
 
 namespace lol
@@ -277,6 +279,64 @@ lolunit_declare_fixture(avl_tree_test)
         lolunit_assert_equal(test1.count(), 10);
         lolunit_assert_equal(test2.count(), 10);
     }
+
+    lolunit_declare_test(avl_tree_test_copy_balance)
+    {
+        test_tree tree;
+
+        for (int i = 0 ; i < 1000 ; ++i)
+            tree.insert(i, i);
+
+        /* Copies are rebuilt perfectly balanced, and remain usable */
+        test_tree other = tree;
+        lolunit_assert_equal(other.get_root_balance(), 0);
+        lolunit_assert_equal(other.count(), 1000);
+
+        for (int i = 0 ; i < 1000 ; i += 2)
+            lolunit_assert_equal(other.erase(i), true);
+        for (int i = 1000 ; i < 1100 ; ++i)
+            lolunit_assert_equal(other.insert(i, i), true);
+
+        int i = -1;
+        for (auto iterator : other)
+        {
+            i += i < 999 ? 2 : 1;
+            lolunit_assert_equal(iterator.key, i);
+        }
+
+        lolunit_assert_equal(other.count(), 600);
+        lolunit_assert_equal(tree.count(), 1000);
+    }
+
+    lolunit_declare_test(avl_tree_test_random)
+    {
+        avl_tree<int, int> tree;
+        std::map<int, int> ref;
+
+        for (int n = 0 ; n < 20000 ; ++n)
+        {
+            int key = lol::rand(500);
+            if (lol::rand(3))
+            {
+                lolunit_assert_equal(tree.insert(key, n), ref.count(key) == 0);
+                ref[key] = n;
+            }
+            else
+            {
+                lolunit_assert_equal(tree.erase(key), ref.erase(key) == 1);
+            }
+        }
+
+        lolunit_assert_equal(tree.count(), (int)ref.size());
+
+        auto it = ref.begin();
+        for (auto iterator : tree)
+        {
+            lolunit_assert_equal(iterator.key, it->first);
+            lolunit_assert_equal(iterator.value, it->second);
+            ++it;
+        }
+    }
 };
 
 }
@@ -0,0 +1,221 @@
+//
+//  Lol Engine — Unit tests
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <map>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(bplus_tree_test)
+{
+    /* Check that tree and ref hold the same elements in the same order */
+    template<typename T>
+    void check_same(T const &tree, std::map<int, int> const &ref)
+    {
+        lolunit_assert_equal(tree.count(), (int)ref.size());
+
+        auto it = ref.begin();
+        for (auto iterator : tree)
+        {
+            lolunit_assert(it != ref.end());
+            lolunit_assert_equal(iterator.key, it->first);
+            lolunit_assert_equal(iterator.value, it->second);
+            ++it;
+        }
+        lolunit_assert(it == ref.end());
+    }
+
+    lolunit_declare_test(insert)
+    {
+        bplus_tree<int, int> tree;
+
+        lolunit_assert_equal(tree.insert(1, 1), true);
+        lolunit_assert_equal(tree.insert(2, 3), true);
+        lolunit_assert_equal(tree.insert(2, 0), false);
+        lolunit_assert_equal(tree.count(), 2);
+
+        int *value = nullptr;
+        lolunit_assert(tree.try_get(2, value));
+        lolunit_assert_equal(*value, 0);
+        lolunit_assert(!tree.try_get(3, value));
+    }
+
+    lolunit_declare_test(min_max)
+    {
+        bplus_tree<int, int> tree;
+        int const *key = nullptr;
+        int *value = nullptr;
+
+        lolunit_assert(!tree.try_get_min(key, value));
+        lolunit_assert(!tree.try_get_max(key, value));
+
+        for (int i = 0; i < 1000; ++i)
+            tree.insert((i * 37) % 1000, i);
+
+        lolunit_assert(tree.try_get_min(key, value));
+        lolunit_assert_equal(*key, 0);
+        lolunit_assert(tree.try_get_max(key, value));
+        lolunit_assert_equal(*key, 999);
+    }
+
+    lolunit_declare_test(random)
+    {
+        /* Enough keys for a tree with three levels */
+        bplus_tree<int, int> tree;
+        std::map<int, int> ref;
+
+        for (int n = 0; n < 100000; ++n)
+        {
+            int key = lol::rand(5000);
+            if (lol::rand(3))
+            {
+                lolunit_assert_equal(tree.insert(key, n), ref.count(key) == 0);
+                ref[key] = n;
+            }
+            else
+            {
+                lolunit_assert_equal(tree.erase(key), ref.erase(key) == 1);
+            }
+
+            if (n % 10000 == 0)
+                check_same(tree, ref);
+        }
+
+        check_same(tree, ref);
+
+        for (int key = 0; key < 5000; ++key)
+            lolunit_assert_equal(tree.exists(key), ref.count(key) == 1);
+    }
+
+    lolunit_declare_test(erase_all)
+    {
+        bplus_tree<int, int> tree;
+
+        for (int i = 0; i < 10000; ++i)
+            tree.insert(i, i);
+        for (int i = 0; i < 10000; ++i)
+            lolunit_assert_equal(tree.erase((i * 7919) % 10000), true);
+
+        lolunit_assert_equal(tree.count(), 0);
+        lolunit_assert(tree.begin() == tree.end());
+        lolunit_assert_equal(tree.erase(0), false);
+
+        /* The tree can be used again */
+        tree.insert(5, 5);
+        lolunit_assert_equal(tree.count(), 1);
+    }
+
+    lolunit_declare_test(range)
+    {
+        bplus_tree<int, int> tree;
+
+        for (int i = 0; i < 1000; ++i)
+            tree.insert(2 * i, i);
+
+        int count = 0, expected = 100;
+        for (auto iterator : tree.range(99, 301))
+        {
+            lolunit_assert_equal(iterator.key, expected);
+            expected += 2;
+            ++count;
+        }
+        lolunit_assert_equal(count, 101);
+
+        lolunit_assert_equal((*tree.lower_bound(500)).key, 500);
+        lolunit_assert_equal((*tree.lower_bound(501)).key, 502);
+        lolunit_assert(tree.lower_bound(1999) == tree.end());
+
+        auto empty = tree.range(40, 40);
+        lolunit_assert(empty.begin() == empty.end());
+    }
+
+    lolunit_declare_test(assign_sorted)
+    {
+        /* Try sizes around the leaf size, and a large one */
+        for (int size : { 0, 1, 7, 31, 32, 33, 64, 65, 100000 })
+        {
+            array<int> keys, values;
+            std::map<int, int> ref;
+            for (int i = 0; i < size; ++i)
+            {
+                keys << 3 * i;
+                values << i;
+                ref[3 * i] = i;
+            }
+
+            bplus_tree<int, int> tree;
+            tree.insert(-1, -1);
+            tree.assign_sorted(keys.data(), values.data(), size);
+            check_same(tree, ref);
+
+            /* The result is a valid tree for further changes */
+            for (int i = 0; i < size; i += 2)
+            {
+                lolunit_assert_equal(tree.erase(3 * i), true);
+                ref.erase(3 * i);
+            }
+            for (int i = 0; i < size; i += 3)
+            {
+                lolunit_assert_equal(tree.insert(3 * i + 1, i), true);
+                ref[3 * i + 1] = i;
+            }
+            check_same(tree, ref);
+        }
+    }
+
+    lolunit_declare_test(copy)
+    {
+        bplus_tree<int, int> tree;
+        std::map<int, int> ref;
+
+        for (int i = 0; i < 5000; ++i)
+        {
+            tree.insert(i * 13 % 5000, i);
+            ref[i * 13 % 5000] = i;
+        }
+
+        bplus_tree<int, int> other = tree;
+        check_same(other, ref);
+
+        other.erase(0);
+        lolunit_assert(tree.exists(0));
+        lolunit_assert(!other.exists(0));
+
+        other = tree;
+        check_same(other, ref);
+    }
+
+    lolunit_declare_test(string_keys)
+    {
+        bplus_tree<std::string, int> tree;
+
+        for (int i = 0; i < 1000; ++i)
+            tree.insert(lol::format("key%04d", i), i);
+
+        int *value = nullptr;
+        lolunit_assert(tree.try_get("key0420", value));
+        lolunit_assert_equal(*value, 420);
+
+        for (int i = 0; i < 1000; i += 2)
+            tree.erase(lol::format("key%04d", i));
+        lolunit_assert_equal(tree.count(), 500);
+        lolunit_assert(!tree.exists("key0420"));
+        lolunit_assert(tree.exists("key0421"));
+    }
+};
+
+} /* namespace lol */
+
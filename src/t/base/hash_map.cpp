@@ -0,0 +1,133 @@
+//
+//  Lol Engine — Unit tests
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <map>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(hash_map_test)
+{
+    lolunit_declare_test(insert_find)
+    {
+        hash_map<int, int> m;
+
+        lolunit_assert(m.empty());
+        lolunit_assert(m.begin() == m.end());
+        lolunit_assert(m.find(42) == m.end());
+
+        m[42] = 1;
+        m[43] = 2;
+        m[42] = 3;
+        lolunit_assert_equal(m.size(), 2u);
+        lolunit_assert_equal(m.find(42)->second, 3);
+        lolunit_assert_equal(m.count(43), 1u);
+        lolunit_assert_equal(m.count(44), 0u);
+
+        /* Helpers from map.h also work */
+        int val = 0;
+        lolunit_assert(has_key(m, 43));
+        lolunit_assert(try_get(m, 43, val));
+        lolunit_assert_equal(val, 2);
+        lolunit_assert_equal(keys(m).count(), 2);
+    }
+
+    lolunit_declare_test(random)
+    {
+        hash_map<int, int> m;
+        std::map<int, int> ref;
+
+        for (int n = 0; n < 100000; ++n)
+        {
+            int key = lol::rand(5000) * 16;
+            if (lol::rand(3))
+            {
+                m[key] = n;
+                ref[key] = n;
+            }
+            else
+            {
+                lolunit_assert_equal(m.erase(key), ref.erase(key));
+            }
+        }
+
+        lolunit_assert_equal(m.size(), ref.size());
+        for (auto const &kv : ref)
+            lolunit_assert_equal(m.find(kv.first)->second, kv.second);
+
+        /* Iteration visits every element exactly once */
+        std::map<int, int> seen;
+        for (auto const &kv : m)
+            seen[kv.first] = kv.second;
+        lolunit_assert(seen == ref);
+    }
+
+    lolunit_declare_test(string_keys)
+    {
+        hash_map<std::string, int> m { { "one", 1 }, { "two", 2 } };
+
+        lolunit_assert_equal(m.size(), 2u);
+        lolunit_assert_equal(m["one"], 1);
+
+        /* Lookups do not need a std::string */
+        char const *name = "two";
+        lolunit_assert_equal(m.find(name)->second, 2);
+        lolunit_assert_equal(m.count("three"), 0u);
+        lolunit_assert_equal(m.erase("one"), 1u);
+        lolunit_assert_equal(m.size(), 1u);
+    }
+
+    lolunit_declare_test(pointer_keys)
+    {
+        /* Aligned pointers only differ in their high bits */
+        array<int64_t> storage;
+        storage.resize(1000);
+
+        hash_map<int64_t *, int> m;
+        for (int i = 0; i < 1000; ++i)
+            m[&storage[i]] = i;
+        for (int i = 0; i < 1000; ++i)
+            lolunit_assert_equal(m[&storage[i]], i);
+    }
+
+    lolunit_declare_test(copy_move)
+    {
+        hash_map<std::string, std::string> m;
+        for (int i = 0; i < 100; ++i)
+            m[lol::format("%d", i)] = lol::format("value %d", i);
+
+        hash_map<std::string, std::string> copy = m;
+        m.erase("50");
+        lolunit_assert_equal(copy.size(), 100u);
+        lolunit_assert(copy["50"] == "value 50");
+
+        hash_map<std::string, std::string> moved = std::move(copy);
+        lolunit_assert_equal(moved.size(), 100u);
+        lolunit_assert(moved["99"] == "value 99");
+
+        moved = hash_map<std::string, std::string>();
+        lolunit_assert(moved.empty());
+        moved = m;
+        lolunit_assert_equal(moved.size(), 99u);
+
+        m.clear();
+        lolunit_assert(m.empty());
+        lolunit_assert(m.begin() == m.end());
+    }
+};
+
+} /* namespace lol */
+
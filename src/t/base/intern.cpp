@@ -0,0 +1,67 @@
+//
+//  Lol Engine — Unit tests
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <thread>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(intern_test)
+{
+    lolunit_declare_test(ids)
+    {
+        lolunit_assert_equal(intern(""), 0u);
+        lolunit_assert(interned(0).empty());
+
+        uint32_t foo = intern("intern_test_foo");
+        uint32_t bar = intern(std::string("intern_test_bar"));
+        lolunit_assert(foo != bar);
+        lolunit_assert_equal(intern(std::string("intern_test_foo")), foo);
+        lolunit_assert_equal(intern("intern_test_bar"), bar);
+        lolunit_assert(interned(foo) == "intern_test_foo");
+
+        /* References remain valid while more strings are interned */
+        std::string const &ref = interned(bar);
+        for (int i = 0; i < 10000; ++i)
+            intern(lol::format("intern_test_%d", i));
+        lolunit_assert(ref == "intern_test_bar");
+    }
+
+    lolunit_declare_test(threads)
+    {
+        /* Several threads interning the same strings get the same ids */
+        uint32_t ids[4][100];
+        std::thread threads[4];
+        for (int t = 0; t < 4; ++t)
+            threads[t] = std::thread([&ids, t]()
+            {
+                for (int i = 0; i < 100; ++i)
+                    ids[t][i] = intern(lol::format("intern_thread_%d", (i * (t + 1)) % 100));
+            });
+        for (auto &thread : threads)
+            thread.join();
+
+        for (int t = 0; t < 4; ++t)
+            for (int i = 0; i < 100; ++i)
+            {
+                int const n = (i * (t + 1)) % 100;
+                lolunit_assert_equal(ids[t][i], intern(lol::format("intern_thread_%d", n)));
+            }
+    }
+};
+
+} /* namespace lol */
+
@@ -0,0 +1,147 @@
+//
+//  Lol Engine — Unit tests for the texture atlas allocator
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(atlas_test)
+{
+    void setup()
+    {
+    }
+
+    void teardown()
+    {
+    }
+
+    /* Check that live rectangles and their padding stay inside their
+     * page and that no two of them on the same page overlap */
+    static bool check(atlas const &a, array<int> const &handles)
+    {
+        ivec2 const pad(a.padding());
+        for (int i = 0; i < handles.count(); ++i)
+        {
+            ivec2 o = a.origin(handles[i]) - pad, s = a.size(handles[i]) + 2 * pad;
+            if (o.x < 0 || o.y < 0 || o.x + s.x > a.page_size().x
+                 || o.y + s.y > a.page_size().y)
+                return false;
+
+            for (int j = 0; j < i; ++j)
+            {
+                if (a.page(handles[i]) != a.page(handles[j]))
+                    continue;
+
+                ivec2 o2 = a.origin(handles[j]) - pad;
+                ivec2 s2 = a.size(handles[j]) + 2 * pad;
+                if (o.x < o2.x + s2.x && o2.x < o.x + s.x
+                     && o.y < o2.y + s2.y && o2.y < o.y + s.y)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    lolunit_declare_test(pack)
+    {
+        atlas a(ivec2(256), 1);
+        array<int> handles;
+
+        for (int i = 0; i < 200; ++i)
+        {
+            int h = a.add(ivec2(4 + i % 13, 4 + (i * 7) % 11));
+            lolunit_assert(h >= 0);
+            handles << h;
+        }
+
+        lolunit_assert(check(a, handles));
+        lolunit_assert_equal(1, a.page_count());
+        lolunit_assert(a.occupancy() > 0.f);
+        lolunit_assert(a.occupancy() <= 1.f);
+    }
+
+    lolunit_declare_test(padding)
+    {
+        /* Rectangles get a border on every side, even at page edges */
+        atlas a(ivec2(16), 2);
+        int h1 = a.add(ivec2(4, 12)), h2 = a.add(ivec2(4, 12));
+        lolunit_assert_equal(ivec2(2), a.origin(h1));
+        lolunit_assert_equal(ivec2(10, 2), a.origin(h2));
+        lolunit_assert_equal(0, a.page(h2));
+
+        /* The padding counts towards the page size */
+        lolunit_assert_equal(-1, a.add(ivec2(13, 1)));
+        lolunit_assert(a.add(ivec2(12, 1)) >= 0);
+        lolunit_assert_equal(2, a.page_count());
+    }
+
+    lolunit_declare_test(pages)
+    {
+        atlas a(ivec2(64), 0);
+        array<int> handles;
+
+        for (int i = 0; i < 5; ++i)
+            handles << a.add(ivec2(32));
+
+        lolunit_assert(check(a, handles));
+        lolunit_assert_equal(2, a.page_count());
+        lolunit_assert_equal(1, a.page(handles[4]));
+
+        lolunit_assert_equal(-1, a.add(ivec2(65, 1)));
+        lolunit_assert_equal(-1, a.add(ivec2(0, 4)));
+    }
+
+    lolunit_declare_test(remove_and_defragment)
+    {
+        atlas a(ivec2(64), 0);
+        array<int> handles;
+
+        for (int i = 0; i < 8; ++i)
+            handles << a.add(ivec2(16, 32));
+        lolunit_assert_equal(1, a.page_count());
+        lolunit_assert_equal(1.f, a.occupancy());
+
+        /* Free the bottom row; the space is wasted until repacked */
+        for (int i = 0; i < 4; ++i)
+            a.remove(handles[i]);
+        lolunit_assert_equal(0.5f, a.waste(0));
+        lolunit_assert_equal(0.5f, a.occupancy());
+
+        array<int> live;
+        for (int i = 4; i < 8; ++i)
+            live << handles[i];
+
+        array<int> moved = a.defragment(0.25f);
+        lolunit_assert_equal(4, moved.count());
+        lolunit_assert_equal(0.f, a.waste(0));
+        for (int h : live)
+            lolunit_assert_equal(0, a.origin(h).y);
+        lolunit_assert(check(a, live));
+
+        /* The reclaimed space is usable again */
+        live << a.add(ivec2(16, 32));
+        lolunit_assert_equal(0, a.page(live.last()));
+        lolunit_assert_equal(1, a.page_count());
+        lolunit_assert(check(a, live));
+
+        /* An emptied page is reset at once */
+        for (int h : live)
+            a.remove(h);
+        lolunit_assert_equal(0.f, a.waste(0));
+        lolunit_assert_equal(ivec2(0), a.origin(a.add(ivec2(64))));
+    }
+};
+
+} /* namespace lol */
@@ -0,0 +1,113 @@
+//
+//  Lol Engine — Unit tests for the debug draw queue
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(debug_draw_test)
+{
+    lolunit_declare_test(lines)
+    {
+        DebugDrawQueue q;
+        array<DebugLineVertex> frame, persistent;
+
+        q.AddLine(vec3(0.f), vec3(1.f), Color::red, -1.f, 1);
+        q.AddLine(vec3(0.f), vec3(2.f), Color::green, 5.f, 1);
+        q.AddLine(vec3(0.f), vec3(3.f), Color::blue, -1.f, 2);
+        q.Merge(1, 10.f, frame, persistent);
+
+        /* The third line does not match the mask */
+        lolunit_assert_equal(2, frame.count());
+        lolunit_assert_equal(2, persistent.count());
+        lolunit_assert_equal(vec4(1.f, 1.f, 1.f, 0.f), frame[1].m_pos);
+        lolunit_assert_equal(Color::red, frame[0].m_color);
+        lolunit_assert_equal(0.f, frame[0].m_expiry);
+        lolunit_assert_equal(15.f, persistent[0].m_expiry);
+        lolunit_assert_equal(15.f, persistent[1].m_expiry);
+
+        /* Commands are only merged once */
+        frame.clear();
+        persistent.clear();
+        q.Merge(1, 11.f, frame, persistent);
+        lolunit_assert_equal(0, frame.count());
+        lolunit_assert_equal(0, persistent.count());
+    }
+
+    lolunit_declare_test(shapes)
+    {
+        DebugDrawQueue q;
+        array<DebugLineVertex> frame, persistent;
+
+        mat4 m = mat4::translate(vec3(1.f, 2.f, 3.f)) * mat4::scale(2.f);
+        q.AddShape(Debug::Shape::Box, m, Color::white, -1.f, 1, 1);
+        q.Merge(1, 0.f, frame, persistent);
+
+        /* Twelve edges spanning the transformed unit cube */
+        lolunit_assert_equal(24, frame.count());
+        for (auto const &v : frame)
+        {
+            lolunit_assert(v.m_pos.x == 1.f || v.m_pos.x == 3.f);
+            lolunit_assert(v.m_pos.y == 2.f || v.m_pos.y == 4.f);
+            lolunit_assert(v.m_pos.z == 3.f || v.m_pos.z == 5.f);
+        }
+
+        /* Gizmo axes keep their own colours */
+        frame.clear();
+        q.AddShape(Debug::Shape::Gizmo, mat4(1.f), Color::white, -1.f, 1, 1);
+        q.Merge(1, 0.f, frame, persistent);
+        lolunit_assert_equal(6, frame.count());
+        lolunit_assert_equal(Color::red, frame[0].m_color);
+        lolunit_assert_equal(Color::green, frame[2].m_color);
+        lolunit_assert_equal(Color::blue, frame[5].m_color);
+        lolunit_assert_equal(vec4(0.f, 0.f, 1.f, 0.f), frame[5].m_pos);
+
+        /* Circles of unit radius, four lines per segment */
+        frame.clear();
+        q.AddShape(Debug::Shape::Circle, mat4(1.f), Color::white, -1.f, 1, 8);
+        q.Merge(1, 0.f, frame, persistent);
+        lolunit_assert_equal(2 * 4 * 8, frame.count());
+        for (auto const &v : frame)
+            lolunit_assert_doubles_equal(1.f, length(v.m_pos.xyz), 1e-5f);
+    }
+
+    lolunit_declare_test(threads)
+    {
+        DebugDrawQueue q;
+        array<DebugLineVertex> frame, persistent;
+
+        int const threads = 4, lines = 1000;
+        array<thread *> workers;
+        for (int n = 0; n < threads; ++n)
+        {
+            workers << new thread([&q, n](thread *)
+            {
+                for (int i = 0; i < lines; ++i)
+                    q.AddLine(vec3((float)n), vec3((float)i), Color::white, -1.f, 1);
+            });
+        }
+
+        /* Merging while threads are still recording loses nothing */
+        q.Merge(1, 0.f, frame, persistent);
+        for (auto *t : workers)
+            delete t;
+        q.Merge(1, 0.f, frame, persistent);
+
+        lolunit_assert_equal(2 * threads * lines, frame.count());
+    }
+};
+
+} /* namespace lol */
+
@@ -0,0 +1,113 @@
+//
+//  Lol Engine — Unit tests for the GUI batcher
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <lolunit.h>
+
+#include "ui/guibatch.h"
+
+namespace lol
+{
+
+lolunit_declare_fixture(gui_batch_test)
+{
+    lolunit_declare_test(merge)
+    {
+        gui_batch batch;
+        uint8_t vertices[40] = { 0 };
+        uint16_t indices[12] = { 0 };
+        /* The batch never dereferences textures */
+        Texture *a = (Texture *)(uintptr_t)0x10, *b = (Texture *)(uintptr_t)0x20;
+        vec4 const clip0(0.f, 0.f, 100.f, 100.f), clip1(0.f, 0.f, 50.f, 50.f);
+        gui_batch::command commands[] =
+        {
+            { a, clip0, 3 },
+            { a, clip0, 3 },
+            { a, clip0, 0 },
+            { b, clip0, 3 },
+            { b, clip1, 3 },
+        };
+
+        batch.begin();
+        batch.add_list(vertices, sizeof(vertices), indices, sizeof(indices),
+                       sizeof(*indices), commands, 5);
+        batch.add_list(vertices, sizeof(vertices), indices, sizeof(indices),
+                       sizeof(*indices), commands, 2);
+
+        lolunit_assert_equal(7, batch.command_count());
+        lolunit_assert_equal(4, batch.draw_calls().count());
+
+        auto const &draws = batch.draw_calls();
+        lolunit_assert_equal(0, draws[0].index);
+        lolunit_assert_equal(6, draws[0].count);
+        lolunit_assert_equal(6, draws[1].index);
+        lolunit_assert_equal(9, draws[2].index);
+        lolunit_assert(draws[2].clip == clip1);
+
+        /* Lists are never merged together, and start on aligned offsets */
+        lolunit_assert_equal(a, draws[3].texture);
+        lolunit_assert_equal(6, draws[3].count);
+        lolunit_assert_equal(48, (int)draws[3].vertex_offset);
+        lolunit_assert_equal(16, draws[3].index);
+        lolunit_assert_equal(48 + 40, (int)batch.vertex_bytes());
+        lolunit_assert_equal(32 + 24, (int)batch.index_bytes());
+    }
+
+    lolunit_declare_test(reuse)
+    {
+        gui_batch batch;
+        uint8_t vertices[64] = { 0 };
+        uint16_t indices[6] = { 0 };
+        gui_batch::command command = { nullptr, vec4(0.f), 6 };
+
+        auto frame = [&]()
+        {
+            batch.begin();
+            batch.add_list(vertices, 64, indices, 12, 2, &command, 1);
+            batch.add_list(vertices, 32, indices, 12, 2, &command, 1);
+        };
+
+        frame();
+        lolunit_assert(batch.lists()[0].dirty);
+        lolunit_assert(batch.lists()[1].dirty);
+        lolunit_assert_equal(64 + 12 + 32 + 12, (int)batch.upload_bytes());
+
+        /* Nothing changed */
+        frame();
+        lolunit_assert(!batch.lists()[0].dirty);
+        lolunit_assert(!batch.lists()[1].dirty);
+        lolunit_assert_equal(0, (int)batch.upload_bytes());
+
+        /* Only the first 32 bytes belong to the second list */
+        vertices[40] = 1;
+        frame();
+        lolunit_assert(batch.lists()[0].dirty);
+        lolunit_assert(!batch.lists()[1].dirty);
+
+        /* Buffers were reallocated */
+        frame();
+        batch.invalidate();
+        lolunit_assert(batch.lists()[0].dirty);
+        lolunit_assert(batch.lists()[1].dirty);
+
+        /* A list that moves must be uploaded again */
+        batch.begin();
+        batch.add_list(vertices, 16, indices, 12, 2, &command, 1);
+        batch.add_list(vertices, 32, indices, 12, 2, &command, 1);
+        lolunit_assert(batch.lists()[0].dirty);
+        lolunit_assert(batch.lists()[1].dirty);
+    }
+};
+
+} /* namespace lol */
+
@@ -0,0 +1,127 @@
+//
+//  Lol Engine — Unit tests for the transient buffer allocator
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+/* transient_allocator does not touch the GPU, so these tests run
+ * without any graphics context */
+lolunit_declare_fixture(transient_test)
+{
+    lolunit_declare_test(linear)
+    {
+        transient_allocator a(1024, 2);
+
+        auto r1 = a.alloc(100);
+        auto r2 = a.alloc(10);
+        auto r3 = a.alloc(20, 4);
+
+        lolunit_assert_equal(1, a.page_count());
+        lolunit_assert_equal(0, r1.page);
+        lolunit_assert_equal(0, (int)r1.offset);
+        lolunit_assert_equal(112, (int)r2.offset);
+        lolunit_assert_equal(124, (int)r3.offset);
+    }
+
+    lolunit_declare_test(counters)
+    {
+        transient_allocator a(1024, 2);
+
+        a.alloc(100);
+        a.alloc(50);
+        lolunit_assert_equal(150, (int)a.frame_bytes());
+        lolunit_assert_equal(2, a.frame_allocs());
+
+        a.next_frame();
+        lolunit_assert_equal(0, (int)a.frame_bytes());
+        lolunit_assert_equal(0, a.frame_allocs());
+        lolunit_assert_equal(150, (int)a.last_frame_bytes());
+        lolunit_assert_equal(2, a.last_frame_allocs());
+
+        a.alloc(30);
+        a.next_frame();
+        lolunit_assert_equal(30, (int)a.last_frame_bytes());
+        lolunit_assert_equal(1, a.last_frame_allocs());
+    }
+
+    lolunit_declare_test(fence)
+    {
+        transient_allocator a(1024, 2);
+
+        /* Frame 0 fills page 0 and spills into page 1 */
+        a.alloc(1000);
+        lolunit_assert_equal(1, a.alloc(1000).page);
+        a.next_frame();
+
+        /* Frame 1 spills again; page 0 is only one frame old */
+        lolunit_assert_equal(2, a.alloc(1000).page);
+        a.next_frame();
+
+        /* Frame 2 may reuse page 0, from the start */
+        auto r = a.alloc(1000);
+        lolunit_assert_equal(0, r.page);
+        lolunit_assert_equal(0, (int)r.offset);
+        lolunit_assert_equal(3, a.page_count());
+    }
+
+    lolunit_declare_test(steady_state)
+    {
+        transient_allocator a(4096, 3);
+
+        /* The same workload every frame stops creating pages */
+        for (int frame = 0; frame < 50; ++frame)
+        {
+            for (int i = 0; i < 10; ++i)
+                a.alloc(1000);
+            a.next_frame();
+        }
+
+        int count = a.page_count();
+        for (int frame = 0; frame < 50; ++frame)
+        {
+            for (int i = 0; i < 10; ++i)
+                a.alloc(1000);
+            a.next_frame();
+        }
+        lolunit_assert_equal(count, a.page_count());
+        lolunit_assert_lequal(count, 4 * 4);
+    }
+
+    lolunit_declare_test(large)
+    {
+        transient_allocator a(1024, 1);
+
+        /* Allocations larger than a page get a dedicated page */
+        a.alloc(100);
+        auto r = a.alloc(5000);
+        lolunit_assert_equal(1, r.page);
+        lolunit_assert_equal(0, (int)r.offset);
+        lolunit_assert_equal(5000, (int)a.page_size(1));
+        lolunit_assert_equal(1024, (int)a.page_size(0));
+        a.next_frame();
+
+        /* Small allocations prefer small pages, but the large page is
+         * recycled for anything that fits */
+        lolunit_assert_equal(0, a.alloc(1000).page);
+        r = a.alloc(3000);
+        lolunit_assert_equal(1, r.page);
+        lolunit_assert_equal(0, (int)r.offset);
+        lolunit_assert_equal(2, a.page_count());
+    }
+};
+
+} /* namespace lol */
+
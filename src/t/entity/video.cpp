@@ -0,0 +1,62 @@
+//
+//  Lol Engine — Unit tests
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(video_test)
+{
+    /* Copy a frame whose pixels tell their own coordinates into a frame
+     * full of garbage, with guard pixels after it. */
+    void check_copy(ivec2 dst_size, ivec2 src_size)
+    {
+        array<u8vec4> src, dst;
+        src.resize(src_size.x * src_size.y);
+        dst.resize(dst_size.x * dst_size.y + 8, u8vec4(0xff));
+
+        for (int j = 0; j < src_size.y; ++j)
+            for (int i = 0; i < src_size.x; ++i)
+                src[j * src_size.x + i] = u8vec4(i, j, 1, 1);
+
+        Video::CopyFrame(dst.data(), dst_size, src.data(), src_size);
+
+        for (int j = 0; j < dst_size.y; ++j)
+            for (int i = 0; i < dst_size.x; ++i)
+            {
+                bool const inside = i < src_size.x && j < src_size.y;
+                u8vec4 const expected = inside ? u8vec4(i, j, 1, 1) : u8vec4(0);
+                lolunit_assert(dst[j * dst_size.x + i] == expected);
+            }
+
+        for (int n = dst_size.x * dst_size.y; n < dst.count(); ++n)
+            lolunit_assert(dst[n] == u8vec4(0xff));
+    }
+
+    lolunit_declare_test(copy_frame)
+    {
+        check_copy(ivec2(16, 9), ivec2(16, 9));
+        /* A viewport larger than the movie must not overflow it */
+        check_copy(ivec2(16, 9), ivec2(40, 30));
+        /* A smaller one leaves the rest of the frame black */
+        check_copy(ivec2(16, 9), ivec2(5, 4));
+        check_copy(ivec2(16, 9), ivec2(20, 3));
+        check_copy(ivec2(16, 9), ivec2(7, 12));
+        check_copy(ivec2(16, 9), ivec2(0, 0));
+    }
+};
+
+} /* namespace lol */
+
@@ -0,0 +1,109 @@
+//
+//  Lol Engine — Unit tests for the visibility stage
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(visibility_test)
+{
+    mat4 view_proj;
+
+    void setup()
+    {
+        /* Camera at the origin, looking towards negative z */
+        view_proj = mat4::perspective(radians(90.f), 800.f, 800.f, 1.f, 100.f)
+                  * mat4::lookat(vec3::zero, -vec3::axis_z, vec3::axis_y);
+    }
+
+    void teardown()
+    {
+    }
+
+    static box3 cube(vec3 centre, float radius)
+    {
+        return box3(centre - vec3(radius), centre + vec3(radius));
+    }
+
+    lolunit_declare_test(frustum)
+    {
+        visibility v;
+        v.reset(view_proj);
+
+        int front = v.add(cube(vec3(0.f, 0.f, -10.f), 1.f));
+        int behind = v.add(cube(vec3(0.f, 0.f, 10.f), 1.f));
+        int left = v.add(cube(vec3(-30.f, 0.f, -10.f), 1.f));
+        int edge = v.add(cube(vec3(-10.5f, 0.f, -10.f), 1.f));
+        int far = v.add(cube(vec3(0.f, 0.f, -200.f), 1.f));
+        int around = v.add(cube(vec3::zero, 500.f));
+
+        v.cull(false, false);
+
+        lolunit_assert(v.is_visible(front));
+        lolunit_assert(!v.is_visible(behind));
+        lolunit_assert(!v.is_visible(left));
+        lolunit_assert(v.is_visible(edge));
+        lolunit_assert(!v.is_visible(far));
+        lolunit_assert(v.is_visible(around));
+        lolunit_assert_equal(3, v.visible_count());
+        lolunit_assert_equal(3, v.frustum_culled_count());
+    }
+
+    lolunit_declare_test(hierarchy)
+    {
+        visibility v;
+        v.reset(view_proj);
+
+        for (int i = 0; i < 1000; ++i)
+            v.add(cube(vec3(rand(-150.f, 150.f), rand(-150.f, 150.f),
+                            rand(-150.f, 150.f)), rand(0.1f, 5.f)));
+
+        v.cull(false, false);
+        array<bool> expected;
+        for (int i = 0; i < v.count(); ++i)
+            expected.push(v.is_visible(i));
+
+        /* The hierarchy may only change how fast the answer is found */
+        v.cull(true, false);
+        for (int i = 0; i < v.count(); ++i)
+            lolunit_assert_equal(expected[i], v.is_visible(i));
+    }
+
+    lolunit_declare_test(occlusion)
+    {
+        visibility v;
+        v.reset(view_proj);
+
+        v.add(box3(vec3(-5.f, -5.f, -11.f), vec3(5.f, 5.f, -10.f)), true);
+        int hidden = v.add(cube(vec3(0.f, 0.f, -20.f), 1.f));
+        int front = v.add(cube(vec3(0.f, 0.f, -5.f), 1.f));
+        int side = v.add(cube(vec3(12.f, 0.f, -20.f), 1.f));
+        int partial = v.add(cube(vec3(9.f, 0.f, -20.f), 1.f));
+
+        v.cull(false, false);
+        lolunit_assert(v.is_visible(hidden));
+
+        v.cull(false, true);
+        lolunit_assert(!v.is_visible(hidden));
+        lolunit_assert(v.is_visible(front));
+        lolunit_assert(v.is_visible(side));
+        lolunit_assert(v.is_visible(partial));
+        lolunit_assert_equal(3, v.visible_count());
+        lolunit_assert_equal(1, v.occlusion_culled_count());
+    }
+};
+
+} /* namespace lol */
+
@@ -0,0 +1,183 @@
+//
+//  Lol Engine — Unit tests for the world partition
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <lolunit.h>
+
+#include "engine/worldgrid.h"
+
+namespace lol
+{
+
+lolunit_declare_fixture(world_grid_test)
+{
+    lolunit_declare_test(query)
+    {
+        world_grid grid(10.f);
+
+        int a = grid.insert(box3(vec3(1.f), vec3(2.f)));
+        int b = grid.insert(box3(vec3(25.f), vec3(26.f)));
+        /* Much larger than a cell, centred in cell (0,0,0) */
+        int c = grid.insert(box3(vec3(-40.f), vec3(40.f)));
+        lolunit_assert_equal(2, grid.cell_count());
+        lolunit_assert(grid.cell_of(a) == grid.cell_of(c));
+
+        array<int> out;
+        grid.query(box3(vec3(24.f), vec3(30.f)), out);
+        lolunit_assert_equal(2, out.count());
+        lolunit_assert(out.find(b) >= 0 && out.find(c) >= 0);
+
+        out.clear();
+        grid.query(vec3(0.f), 2.f, out);
+        lolunit_assert_equal(2, out.count());
+        lolunit_assert(out.find(b) < 0);
+
+        /* Moving to another cell, then removing */
+        grid.move(a, box3(vec3(31.f), vec3(32.f)));
+        lolunit_assert(grid.cell_of(a) == ivec3(3));
+        grid.remove(b);
+        out.clear();
+        grid.query(box3(vec3(24.f), vec3(26.f)), out);
+        lolunit_assert_equal(1, out.count());
+        lolunit_assert_equal(c, out[0]);
+
+        /* Handles are reused */
+        lolunit_assert_equal(b, grid.insert(box3(vec3(0.f), vec3(0.f))));
+    }
+
+    lolunit_declare_test(levels)
+    {
+        world_grid grid(10.f);
+        grid.set_radii(10.f, 30.f, 50.f, 5.f);
+
+        array<int> items;
+        for (int i = 0; i < 10; ++i)
+            items << grid.insert(box3(vec3(i * 10.f + 5.f, 5.f, 5.f),
+                                      vec3(i * 10.f + 5.f, 5.f, 5.f)));
+
+        array<world_grid::change> changes;
+        grid.update(array<vec3> { vec3(5.f) }, changes);
+        lolunit_assert(grid.level_of(items[0]) == world_grid::level::active);
+        lolunit_assert(grid.level_of(items[1]) == world_grid::level::active);
+        /* Cells start active, so demotions use the hysteresis */
+        lolunit_assert(grid.level_of(items[2]) == world_grid::level::active);
+        lolunit_assert(grid.level_of(items[3]) == world_grid::level::reduced);
+        lolunit_assert(grid.level_of(items[5]) == world_grid::level::suspended);
+        lolunit_assert(grid.level_of(items[9]) == world_grid::level::streamed);
+        lolunit_assert_equal(7, changes.count());
+
+        /* Moving a bit forward promotes cells, but only demotes those
+         * that are beyond the hysteresis distance */
+        changes.clear();
+        grid.update(array<vec3> { vec3(12.f, 5.f, 5.f) }, changes);
+        lolunit_assert(grid.level_of(items[2]) == world_grid::level::active);
+        lolunit_assert(grid.level_of(items[0]) == world_grid::level::active);
+        changes.clear();
+        grid.update(array<vec3> { vec3(22.f, 5.f, 5.f) }, changes);
+        lolunit_assert(grid.level_of(items[0]) == world_grid::level::active);
+        changes.clear();
+        grid.update(array<vec3> { vec3(27.f, 5.f, 5.f) }, changes);
+        lolunit_assert(grid.level_of(items[0]) == world_grid::level::reduced);
+    }
+
+    lolunit_declare_test(stored)
+    {
+        world_grid grid(10.f);
+        grid.set_radii(10.f, 20.f, 30.f, 0.f);
+
+        array<world_grid::change> changes;
+        grid.update(array<vec3> { vec3(0.f) }, changes);
+
+        /* A cell far away gets streamed out */
+        int a = grid.insert(box3(vec3(100.f), vec3(100.f)));
+        lolunit_assert(grid.level_of(a) == world_grid::level::streamed);
+        ivec3 cell = grid.cell_of(a);
+        grid.set_stored(cell, true);
+        grid.remove(a);
+        lolunit_assert_equal(0, grid.resident_count());
+        lolunit_assert_equal(1, grid.cell_count());
+
+        /* It comes back when the focus gets close */
+        changes.clear();
+        grid.update(array<vec3> { vec3(95.f) }, changes);
+        lolunit_assert_equal(1, changes.count());
+        lolunit_assert(changes[0].cell == cell);
+        lolunit_assert(changes[0].from == world_grid::level::streamed);
+        lolunit_assert(changes[0].to == world_grid::level::active);
+
+        /* Empty cells are dropped once their content is restored */
+        grid.set_stored(cell, false);
+        lolunit_assert(!grid.is_stored(cell));
+        lolunit_assert_equal(0, grid.cell_count());
+    }
+
+    lolunit_declare_test(resident_lists)
+    {
+        world_grid grid(10.f);
+        grid.set_radii(10.f, 30.f, 50.f, 0.f);
+
+        array<world_grid::change> changes;
+        grid.update(array<vec3> { vec3(5.f) }, changes);
+
+        int a = grid.insert(box3(vec3(5.f), vec3(5.f)));
+        grid.insert(box3(vec3(6.f), vec3(6.f)));
+        int c = grid.insert(box3(vec3(35.f, 5.f, 5.f), vec3(35.f, 5.f, 5.f)));
+        lolunit_assert_equal(1, grid.resident_count(world_grid::level::active));
+        lolunit_assert_equal(1, grid.resident_count(world_grid::level::reduced));
+        lolunit_assert_equal(2, grid.item_count(world_grid::level::active));
+        lolunit_assert_equal(1, grid.item_count(world_grid::level::reduced));
+        lolunit_assert(grid.resident_cell(world_grid::level::reduced, 0) == grid.cell_of(c));
+        lolunit_assert(grid.cell_items(grid.cell_of(c))->count() == 1);
+        lolunit_assert(!grid.cell_items(ivec3(9)));
+
+        /* Cells move between lists when their level changes */
+        changes.clear();
+        grid.update(array<vec3> { vec3(35.f, 5.f, 5.f) }, changes);
+        lolunit_assert_equal(2, changes.count());
+        lolunit_assert(grid.level_of(a) == world_grid::level::reduced);
+        lolunit_assert(grid.level_of(c) == world_grid::level::active);
+        lolunit_assert_equal(1, grid.item_count(world_grid::level::active));
+        lolunit_assert_equal(2, grid.item_count(world_grid::level::reduced));
+
+        grid.remove(a);
+        lolunit_assert_equal(1, grid.item_count(world_grid::level::reduced));
+        lolunit_assert_equal(2, grid.resident_count());
+    }
+
+    lolunit_declare_test(loose)
+    {
+        world_grid grid(10.f);
+        int a = grid.insert(box3(vec3(-40.f), vec3(40.f)));
+        int b = grid.insert(box3(vec3(0.f), vec3(2.f)));
+        lolunit_assert_equal(40.f, grid.loose());
+
+        /* The loose size follows the largest item that is left */
+        array<world_grid::change> changes;
+        grid.remove(a);
+        grid.update(array<vec3>(), changes);
+        lolunit_assert_equal(1.f, grid.loose());
+
+        grid.move(b, box3(vec3(0.f), vec3(6.f)));
+        lolunit_assert_equal(3.f, grid.loose());
+        grid.move(b, box3(vec3(0.f), vec3(4.f)));
+        grid.update(array<vec3>(), changes);
+        lolunit_assert_equal(2.f, grid.loose());
+
+        grid.remove(b);
+        grid.update(array<vec3>(), changes);
+        lolunit_assert_equal(0.f, grid.loose());
+    }
+};
+
+} /* namespace lol */
+
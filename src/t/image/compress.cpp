@@ -0,0 +1,166 @@
+//
+//  Lol Engine — Unit tests for block compression and mipmaps
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(compress_test)
+{
+    /* A smooth gradient with some noise and a varying alpha channel;
+     * the gradient spans ramp pixels */
+    static image make_image(ivec2 size, ivec2 ramp = ivec2(64, 48))
+    {
+        image img(size);
+        u8vec4 *p = img.lock<PixelFormat::RGBA_8>();
+        for (int y = 0; y < size.y; ++y)
+            for (int x = 0; x < size.x; ++x)
+            {
+                int n = (x * 7 + y * 13) % 9;
+                p[y * size.x + x] = u8vec4(x * 255 / ramp.x, y * 255 / ramp.y,
+                                           128 + n, (x + y) * 127 / (ramp.x + ramp.y) + n);
+            }
+        img.unlock(p);
+        return img;
+    }
+
+    /* Root mean square error over the colour or alpha channels */
+    static float rmse(image &a, image &b, bool alpha)
+    {
+        u8vec4 const *pa = a.lock<PixelFormat::RGBA_8>();
+        u8vec4 const *pb = b.lock<PixelFormat::RGBA_8>();
+        int count = a.size().x * a.size().y;
+        float sum = 0.f;
+        for (int i = 0; i < count; ++i)
+        {
+            vec4 d = (vec4)pa[i] - (vec4)pb[i];
+            sum += alpha ? d.a * d.a : (d.r * d.r + d.g * d.g + d.b * d.b) / 3.f;
+        }
+        a.unlock(pa);
+        b.unlock(pb);
+        return lol::sqrt(sum / count);
+    }
+
+    static float roundtrip(image &src, CompressedFormat format, bool alpha)
+    {
+        array<uint8_t> blocks = src.compress(format);
+        image dst = image::decompress(src.size(), format,
+                                      span<uint8_t const>(blocks.data(), blocks.count()));
+        return rmse(src, dst, alpha);
+    }
+
+    lolunit_declare_test(block_count)
+    {
+        image src = make_image(ivec2(10, 5));
+
+        lolunit_assert_equal(3 * 2 * 8, src.compress(CompressedFormat::BC1).count());
+        lolunit_assert_equal(3 * 2 * 16, src.compress(CompressedFormat::BC3).count());
+        lolunit_assert_equal(3 * 2 * 8, src.compress(CompressedFormat::ETC2_RGB8).count());
+        lolunit_assert_equal(3 * 2 * 16, src.compress(CompressedFormat::ETC2_RGBA8).count());
+
+        array<uint8_t> blocks = src.compress(CompressedFormat::BC1);
+        image dst = image::decompress(ivec2(10, 5), CompressedFormat::BC1,
+                                      span<uint8_t const>(blocks.data(), blocks.count()));
+        lolunit_assert_equal(ivec2(10, 5), dst.size());
+    }
+
+    lolunit_declare_test(colour)
+    {
+        image src = make_image(ivec2(64, 48));
+
+        lolunit_assert_less(roundtrip(src, CompressedFormat::BC1, false), 4.f);
+        lolunit_assert_less(roundtrip(src, CompressedFormat::BC3, false), 4.f);
+        lolunit_assert_less(roundtrip(src, CompressedFormat::ETC2_RGB8, false), 5.f);
+        lolunit_assert_less(roundtrip(src, CompressedFormat::ETC2_RGBA8, false), 5.f);
+    }
+
+    lolunit_declare_test(alpha)
+    {
+        image src = make_image(ivec2(64, 48));
+
+        lolunit_assert_less(roundtrip(src, CompressedFormat::BC3, true), 2.f);
+        lolunit_assert_less(roundtrip(src, CompressedFormat::ETC2_RGBA8, true), 2.f);
+
+        /* Fully opaque and fully transparent pixels survive exactly */
+        image mask(ivec2(8, 8));
+        u8vec4 *p = mask.lock<PixelFormat::RGBA_8>();
+        for (int i = 0; i < 64; ++i)
+            p[i] = u8vec4(200, 100, 50, i % 3 ? 255 : 0);
+        mask.unlock(p);
+
+        lolunit_assert_equal(0.f, roundtrip(mask, CompressedFormat::BC3, true));
+        lolunit_assert_equal(0.f, roundtrip(mask, CompressedFormat::ETC2_RGBA8, true));
+    }
+
+    lolunit_declare_test(odd_sizes)
+    {
+        image src = make_image(ivec2(7, 3));
+
+        lolunit_assert_less(roundtrip(src, CompressedFormat::BC1, false), 4.f);
+        lolunit_assert_less(roundtrip(src, CompressedFormat::ETC2_RGB8, false), 5.f);
+
+        image tiny = make_image(ivec2(1, 1));
+        lolunit_assert_less(roundtrip(tiny, CompressedFormat::BC3, false), 4.f);
+    }
+
+    lolunit_declare_test(mipmap_box)
+    {
+        /* A checkerboard averages to grey */
+        image src(ivec2(4, 4));
+        u8vec4 *p = src.lock<PixelFormat::RGBA_8>();
+        for (int i = 0; i < 16; ++i)
+            p[i] = ((i >> 2) + i) & 1 ? u8vec4(255) : u8vec4(0, 0, 0, 255);
+        src.unlock(p);
+
+        image dst = src.mipmap(MipmapFilter::Box);
+        lolunit_assert_equal(ivec2(2, 2), dst.size());
+        lolunit_assert(dst.format() == PixelFormat::RGBA_8);
+
+        u8vec4 const *q = dst.lock<PixelFormat::RGBA_8>();
+        for (int i = 0; i < 4; ++i)
+        {
+            lolunit_assert_doubles_equal(128.f, (float)q[i].r, 1.f);
+            lolunit_assert_equal(255, (int)q[i].a);
+        }
+        dst.unlock(q);
+
+        lolunit_assert_equal(ivec2(3, 1), make_image(ivec2(5, 2)).mipmap(MipmapFilter::Box).size());
+        lolunit_assert_equal(ivec2(1, 1), make_image(ivec2(1, 1)).mipmap(MipmapFilter::Box).size());
+    }
+
+    lolunit_declare_test(mipmap_kaiser)
+    {
+        /* The filter is normalised, so flat images stay flat */
+        image src(ivec2(16, 16));
+        u8vec4 *p = src.lock<PixelFormat::RGBA_8>();
+        for (int i = 0; i < 256; ++i)
+            p[i] = u8vec4(10, 100, 200, 255);
+        src.unlock(p);
+
+        image dst = src.mipmap(MipmapFilter::Kaiser);
+        lolunit_assert_equal(ivec2(8, 8), dst.size());
+
+        u8vec4 const *q = dst.lock<PixelFormat::RGBA_8>();
+        for (int i = 0; i < 64; ++i)
+        {
+            lolunit_assert_equal(10, (int)q[i].r);
+            lolunit_assert_equal(100, (int)q[i].g);
+            lolunit_assert_equal(200, (int)q[i].b);
+        }
+        dst.unlock(q);
+    }
+};
+
+} /* namespace lol */
@@ -0,0 +1,184 @@
+//
+//  Lol Engine — Unit tests
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(distance_test)
+{
+    /* A grey image with a few random white pixels */
+    static image random_seeds(ivec2 size, int count)
+    {
+        image ret(size);
+        float *data = ret.lock<PixelFormat::Y_F32>();
+        for (int i = 0; i < size.x * size.y; ++i)
+            data[i] = 0.25f;
+        for (int i = 0; i < count; ++i)
+            data[lol::rand(size.x * size.y)] = 1.f;
+        ret.unlock(data);
+        return ret;
+    }
+
+    /* The distance to the nearest seed, the slow way */
+    static float brute_force(float const *data, ivec2 size, ivec2 pos)
+    {
+        float ret = 1e30f;
+        for (int y = 0; y < size.y; ++y)
+            for (int x = 0; x < size.x; ++x)
+                if (data[y * size.x + x] >= 0.5f)
+                    ret = lol::min(ret, distance(vec2(x, y), vec2(pos)));
+        return ret;
+    }
+
+    lolunit_declare_test(exact)
+    {
+        ivec2 const size(47, 31);
+
+        for (int count : { 1, 5, 40 })
+        {
+            image src = random_seeds(size, count);
+            image dst = src.distance_transform();
+            lolunit_assert(dst.format() == PixelFormat::Y_F32);
+
+            float *in = src.lock<PixelFormat::Y_F32>();
+            float *out = dst.lock<PixelFormat::Y_F32>();
+            for (int y = 0; y < size.y; ++y)
+                for (int x = 0; x < size.x; ++x)
+                    lolunit_assert_doubles_equal(out[y * size.x + x],
+                                         brute_force(in, size, ivec2(x, y)), 1e-4f);
+            src.unlock(in);
+            dst.unlock(out);
+        }
+    }
+
+    lolunit_declare_test(channels)
+    {
+        /* Each channel of an RGBA image gets the same distance field as
+         * a grey image with the same seeds */
+        ivec2 const size(33, 20);
+        image grey[4];
+        for (auto &im : grey)
+            im = random_seeds(size, 6);
+
+        image src(size);
+        vec4 *data = src.lock<PixelFormat::RGBA_F32>();
+        for (int ch = 0; ch < 4; ++ch)
+        {
+            float *in = grey[ch].lock<PixelFormat::Y_F32>();
+            for (int i = 0; i < size.x * size.y; ++i)
+                data[i][ch] = in[i];
+            grey[ch].unlock(in);
+        }
+        src.unlock(data);
+
+        image dst = src.distance_transform();
+        lolunit_assert(dst.format() == PixelFormat::RGBA_F32);
+
+        vec4 *out = dst.lock<PixelFormat::RGBA_F32>();
+        for (int ch = 0; ch < 4; ++ch)
+        {
+            image ref = grey[ch].distance_transform();
+            float *expected = ref.lock<PixelFormat::Y_F32>();
+            for (int i = 0; i < size.x * size.y; ++i)
+                lolunit_assert_equal(out[i][ch], expected[i]);
+            ref.unlock(expected);
+        }
+        dst.unlock(out);
+    }
+
+    lolunit_declare_test(signed_field)
+    {
+        /* A disc in an 8-bit mask */
+        ivec2 const size(64, 64);
+        image src(size);
+        uint8_t *data = src.lock<PixelFormat::Y_8>();
+        for (int y = 0; y < size.y; ++y)
+            for (int x = 0; x < size.x; ++x)
+                data[y * size.x + x] = sqlength(vec2(x, y) - vec2(31.5f)) < 20.f * 20.f ? 255 : 0;
+        src.unlock(data);
+
+        image dst = src.signed_distance_field(4.f);
+        lolunit_assert(dst.format() == PixelFormat::Y_F32);
+
+        float *out = dst.lock<PixelFormat::Y_F32>();
+        for (int y = 0; y < size.y; ++y)
+            for (int x = 0; x < size.x; ++x)
+            {
+                /* The field follows the distance to the circle, and
+                 * saturates past the radius */
+                float r = distance(vec2(x, y), vec2(31.5f));
+                float expected = lol::clamp(0.5f + (20.f - r) / 8.f, 0.f, 1.f);
+                lolunit_assert_doubles_equal(out[y * size.x + x], expected, 0.1f);
+                lolunit_assert_equal(out[y * size.x + x] >= 0.5f, r < 20.f);
+            }
+        dst.unlock(out);
+    }
+
+    lolunit_declare_test(voronoi)
+    {
+        ivec2 const size(80, 57);
+        image src(size);
+        vec4 *data = src.lock<PixelFormat::RGBA_F32>();
+        for (int i = 0; i < size.x * size.y; ++i)
+            data[i] = vec4(0.f);
+        for (int i = 0; i < 30; ++i)
+            data[lol::rand(size.x * size.y)] = vec4(lol::rand(1.f), lol::rand(1.f), lol::rand(1.f), 1.f);
+        src.unlock(data);
+
+        array2d<ivec2> seeds = src.nearest_seed();
+        image dst = src.voronoi();
+        image ref = src.distance_transform(1.f);
+
+        /* Jump flooding may miss the exact nearest seed, but very rarely,
+         * and only by a small margin */
+        vec4 *in = src.lock<PixelFormat::RGBA_F32>();
+        vec4 *out = dst.lock<PixelFormat::RGBA_F32>();
+        vec4 *exact = ref.lock<PixelFormat::RGBA_F32>();
+        int errors = 0;
+        for (int y = 0; y < size.y; ++y)
+            for (int x = 0; x < size.x; ++x)
+            {
+                ivec2 seed = seeds[x][y];
+                lolunit_assert(in[seed.y * size.x + seed.x].a == 1.f);
+                lolunit_assert(out[y * size.x + x] == in[seed.y * size.x + seed.x]);
+
+                float d = distance(vec2(seed), vec2(x, y));
+                lolunit_assert(d < exact[y * size.x + x].a + 1.5f);
+                errors += d > exact[y * size.x + x].a + 1e-4f;
+            }
+        lolunit_assert(errors < size.x * size.y / 100);
+        src.unlock(in);
+        dst.unlock(out);
+        ref.unlock(exact);
+    }
+
+    lolunit_declare_test(no_seed)
+    {
+        image src(ivec2(9, 7));
+        vec4 *data = src.lock<PixelFormat::RGBA_F32>();
+        for (int i = 0; i < 9 * 7; ++i)
+            data[i] = vec4(0.f);
+        src.unlock(data);
+
+        array2d<ivec2> seeds = src.nearest_seed();
+        for (int y = 0; y < 7; ++y)
+            for (int x = 0; x < 9; ++x)
+                lolunit_assert(seeds[x][y] == ivec2(-1));
+    }
+};
+
+} /* namespace lol */
+
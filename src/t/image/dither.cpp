@@ -0,0 +1,203 @@
+//
+//  Lol Engine — Unit tests
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <cstdlib>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(dither_test)
+{
+    /* A plain sequential error diffusion, as a reference */
+    static image reference_ediff(image const &src, array2d<float> const &ker,
+                                 ScanMode scan)
+    {
+        image dst = src;
+
+        ivec2 isize = dst.size();
+        ivec2 ksize = ker.size();
+
+        int kx;
+        for (kx = 0; kx < ksize.x; kx++)
+            if (ker[kx][0] > 0.f)
+                break;
+
+        float *pixels = dst.lock<PixelFormat::Y_F32>();
+        for (int y = 0; y < isize.y; y++)
+        {
+            bool reverse = (y & 1) && (scan == ScanMode::Serpentine);
+
+            for (int x = 0; x < isize.x; x++)
+            {
+                int x2 = reverse ? isize.x - 1 - x : x;
+                int s = reverse ? -1 : 1;
+
+                float p = pixels[y * isize.x + x2];
+                float q = p < 0.5f ? 0.f : 1.f;
+                pixels[y * isize.x + x2] = q;
+
+                float e = (p - q);
+
+                for (int j = 0; j < ksize.y && y < isize.y - j; j++)
+                    for (int i = 0; i < ksize.x; i++)
+                    {
+                        if (j == 0 && i <= kx)
+                            continue;
+
+                        if (x + i - kx < 0 || x + i - kx >= isize.x)
+                            continue;
+
+                        pixels[(y + j) * isize.x + x2 + (i - kx) * s]
+                           += e * ker[i][j];
+                    }
+            }
+        }
+        dst.unlock(pixels);
+
+        return dst;
+    }
+
+    /* Large enough to trigger the multithreaded code paths */
+    static image gradient()
+    {
+        ivec2 const size(421, 317);
+        image img(size);
+        float *pixels = img.lock<PixelFormat::Y_F32>();
+        for (int y = 0; y < size.y; ++y)
+            for (int x = 0; x < size.x; ++x)
+                pixels[y * size.x + x] = (float)((x * 7 + y * 3) % 256) / 255.f
+                                       + 0.1f * lol::sin(0.03f * x * y);
+        img.unlock(pixels);
+        return img;
+    }
+
+    static int count_differences(image &a, image &b)
+    {
+        if (a.size() != b.size())
+            return -1;
+
+        int ret = 0;
+        float *pa = a.lock<PixelFormat::Y_F32>();
+        float *pb = b.lock<PixelFormat::Y_F32>();
+        for (int n = 0; n < a.size().x * a.size().y; ++n)
+            ret += pa[n] != pb[n];
+        a.unlock(pa);
+        b.unlock(pb);
+        return ret;
+    }
+
+    /* The perceived error that DBS minimises: the squared error filtered
+     * by the same HVS kernel, including where it spills past the edges */
+    static double perceived_error(image &src, image &halftone)
+    {
+        int const n = 7, nn = 2 * n + 1;
+        array2d<float> ker(ivec2(nn, nn));
+        float t = 0.f;
+        for (int j = 0; j < nn; j++)
+            for (int i = 0; i < nn; i++)
+            {
+                vec2 v = vec2((float)(i - n), (float)(j - n));
+                ker[i][j] = exp(-sqlength(v / 1.6f) / 2.f)
+                          + exp(-sqlength(v / 0.6f) / 2.f);
+                t += ker[i][j];
+            }
+
+        ivec2 const isize = src.size();
+        float *ps = src.lock<PixelFormat::Y_F32>();
+        float *ph = halftone.lock<PixelFormat::Y_F32>();
+        double ret = 0.0;
+        for (int y = 0; y < isize.y + 2 * n; y++)
+            for (int x = 0; x < isize.x + 2 * n; x++)
+            {
+                float e = 0.f;
+                for (int j = max(0, y - 2 * n); j < min(isize.y, y + 1); j++)
+                    for (int i = max(0, x - 2 * n); i < min(isize.x, x + 1); i++)
+                        e += ker[x - i][y - j] / t
+                           * (ph[j * isize.x + i] - ps[j * isize.x + i]);
+                ret += e * e;
+            }
+        src.unlock(ps);
+        halftone.unlock(ph);
+        return ret;
+    }
+
+    lolunit_declare_test(ediff_matches_reference)
+    {
+        image src = gradient();
+
+        for (int n = 0; n <= (int)EdiffAlgorithm::Lite; ++n)
+        {
+            EdiffAlgorithm algorithm = (EdiffAlgorithm)n;
+            array2d<float> ker = image::kernel::ediff(algorithm);
+
+            for (ScanMode scan : { ScanMode::Raster, ScanMode::Serpentine })
+            {
+                image ref = reference_ediff(src, ker, scan);
+                image out1 = src.dither_ediff(ker, scan);
+                image out2 = src.dither_ediff(algorithm, scan);
+
+                lolunit_set_context(n);
+                lolunit_assert_equal(count_differences(ref, out1), 0);
+                lolunit_assert_equal(count_differences(ref, out2), 0);
+                lolunit_unset_context(n);
+            }
+        }
+    }
+
+    lolunit_declare_test(dbs_converges)
+    {
+        image src = gradient();
+        image out = src.dither_dbs();
+
+        lolunit_assert_equal(out.size().x, src.size().x);
+        lolunit_assert_equal(out.size().y, src.size().y);
+
+        /* Output is binary and preserves the average brightness */
+        float const *pin = src.lock<PixelFormat::Y_F32>();
+        float const *pout = out.lock<PixelFormat::Y_F32>();
+        double sum_in = 0.0, sum_out = 0.0;
+        int count = src.size().x * src.size().y;
+        for (int n = 0; n < count; ++n)
+        {
+            lolunit_assert(pout[n] == 0.f || pout[n] == 1.f);
+            sum_in += pin[n];
+            sum_out += pout[n];
+        }
+        src.unlock(pin);
+        out.unlock(pout);
+
+        lolunit_assert_doubles_equal(sum_in / count, sum_out / count, 0.01);
+
+        /* DBS starts from a random halftone and must improve on it */
+        std::srand(1);
+        image start = src.dither_random();
+        std::srand(1);
+        image out1 = src.dither_dbs();
+        lolunit_assert_less(perceived_error(src, out1),
+                            perceived_error(src, start));
+
+        /* The result does not depend on the number of threads */
+        thread_pool &pool = thread_pool::shared();
+        pool.set_max_threads(1);
+        std::srand(1);
+        image out2 = src.dither_dbs();
+        pool.set_max_threads(0);
+        lolunit_assert_equal(count_differences(out1, out2), 0);
+    }
+};
+
+} /* namespace lol */
+
@@ -0,0 +1,171 @@
+//
+//  Lol Engine — Unit tests for the fractal renderer
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(fractal_test)
+{
+    /* Iterate z ← z² + c directly with reals, using the same bailout
+     * and smoothing as the renderer. */
+    static float direct(rcmplx z, rcmplx const &c, int max_iterations)
+    {
+        for (int n = 0; n < max_iterations; ++n)
+        {
+            double r2 = (double)sqlength(z);
+            if (r2 > 65536.0)
+                return (float)(n + 1 - std::log2(std::log(r2) / std::log(65536.0)));
+            z = z * z + c;
+        }
+        return (double)sqlength(z) > 65536.0 ? (float)max_iterations : -1.f;
+    }
+
+    void check(array2d<float> const &a, array2d<float> const &b)
+    {
+        for (int j = 0; j < a.size().y; ++j)
+            for (int i = 0; i < a.size().x; ++i)
+                lolunit_assert_doubles_equal(a[i][j], b[i][j], 1e-2);
+    }
+
+    lolunit_declare_test(mandelbrot)
+    {
+        /* At this zoom level, pixel coordinates do not fit in a double */
+        rcmplx center(real("-0.743643887037158704752191506114774"),
+                      real("0.131825904205311970493132056385139"));
+        double const radius = 1e-25;
+        dvec2 const origin(-1.0, 1.0), step(0.25, -0.25);
+
+        fractal_renderer r;
+        r.set_view(center, radius);
+        r.set_max_iterations(2000);
+
+        array2d<float> a(ivec2(9, 9)), b(ivec2(9, 9));
+        r.render(a, origin, step);
+        lolunit_assert(r.get_stats().skipped > 0);
+
+        for (int j = 0; j < 9; ++j)
+            for (int i = 0; i < 9; ++i)
+            {
+                dvec2 u = (origin + dvec2(i, j) * step) * radius;
+                rcmplx c = center + rcmplx(real(u.x), real(u.y));
+                b[i][j] = direct(rcmplx(0.0), c, 2000);
+            }
+
+        check(a, b);
+    }
+
+    lolunit_declare_test(julia)
+    {
+        rcmplx const c(-0.8, 0.156);
+
+        fractal_renderer r;
+        r.set_view(rcmplx(0.1, 0.0), 1.5);
+        r.set_julia(true, c);
+        r.set_max_iterations(300);
+
+        array2d<float> a(ivec2(16, 16)), b(ivec2(16, 16));
+        dvec2 const origin(-1.0, 1.0), step(0.125, -0.125);
+        r.render(a, origin, step);
+
+        for (int j = 0; j < 16; ++j)
+            for (int i = 0; i < 16; ++i)
+            {
+                dvec2 u = (origin + dvec2(i, j) * step) * 1.5;
+                b[i][j] = direct(rcmplx(0.1 + u.x, u.y), c, 300);
+            }
+
+        check(a, b);
+    }
+
+    lolunit_declare_test(deep_zoom)
+    {
+        /* Near the Misiurewicz point c = i there is detail at any depth;
+         * the offset makes the reference orbit escape, so pixels have to
+         * be rebased. */
+        rcmplx center = rcmplx(real::R_0(), real::R_1())
+                      + rcmplx(real("1.2345e-62"), real("-6.789e-63"));
+
+        fractal_renderer r;
+        r.set_view(center, 1e-60);
+        r.set_max_iterations(1000);
+
+        array2d<float> a(ivec2(32, 32)), b(ivec2(32, 32)), c(ivec2(32, 32));
+        dvec2 const origin(-1.0, 1.0), step(1.0 / 16, -1.0 / 16);
+        r.render(a, origin, step);
+        lolunit_assert(r.get_stats().skipped > 0);
+        lolunit_assert(r.get_stats().rebases > 0);
+
+        /* Disabling the series approximation, or using long doubles,
+         * does not change the result */
+        r.set_series(false);
+        r.render(b, origin, step);
+        lolunit_assert_equal(0, r.get_stats().skipped);
+        check(a, b);
+
+        r.set_long_double(true);
+        r.render(c, origin, step);
+        check(b, c);
+
+        /* The image is not uniform */
+        float lo = a[0][0], hi = a[0][0];
+        for (int j = 0; j < 32; ++j)
+            for (int i = 0; i < 32; ++i)
+            {
+                lo = lol::min(lo, a[i][j]);
+                hi = lol::max(hi, a[i][j]);
+            }
+        lolunit_assert(hi - lo > 1.f);
+    }
+
+    lolunit_declare_test(outside)
+    {
+        /* With the centre outside the set, the reference orbit escapes
+         * right away; pixels must still be rendered correctly. */
+        dvec2 const origin(-1.0, 1.0), step(0.5, -0.5);
+        array2d<float> a(ivec2(4, 4)), b(ivec2(4, 4));
+
+        fractal_renderer r;
+        r.set_view(rcmplx(3.0, 0.0), 0.5);
+        r.render(a, origin, step);
+        lolunit_assert_equal(2, r.get_stats().reference);
+
+        for (int j = 0; j < 4; ++j)
+            for (int i = 0; i < 4; ++i)
+            {
+                dvec2 u = (origin + dvec2(i, j) * step) * 0.5;
+                b[i][j] = direct(rcmplx(0.0), rcmplx(3.0 + u.x, u.y), 256);
+            }
+        check(a, b);
+
+        /* Same for Julia sets, where z0 itself is too large */
+        rcmplx const c(-0.8, 0.156);
+        r.set_view(rcmplx(0.0, 2.5), 0.5);
+        r.set_julia(true, c);
+        r.set_long_double(true);
+        r.render(a, origin, step);
+
+        for (int j = 0; j < 4; ++j)
+            for (int i = 0; i < 4; ++i)
+            {
+                dvec2 u = (origin + dvec2(i, j) * step) * 0.5;
+                b[i][j] = direct(rcmplx(u.x, 2.5 + u.y), c, 256);
+            }
+        check(a, b);
+    }
+};
+
+} /* namespace lol */
+
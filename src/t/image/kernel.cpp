@@ -0,0 +1,69 @@
+//
+//  Lol Engine — Unit tests for the image kernels
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <lolunit.h>
+
+#include <algorithm>
+#include <cstdio>
+
+namespace lol
+{
+
+lolunit_declare_fixture(kernel_test)
+{
+    lolunit_declare_test(blue_noise)
+    {
+        ivec2 const size(64, 48);
+        array2d<float> ker = image::kernel::blue_noise(size, ivec2(8, 8));
+
+        /* Every texel gets a distinct rank */
+        array<float> values;
+        for (int n = 0; n < ker.count(); ++n)
+            values << ker.data()[n];
+        std::sort(values.data(), values.data() + values.count());
+        for (int n = 0; n < values.count(); ++n)
+            lolunit_assert_doubles_equal((n + 1.f) / (ker.count() + 1), values[n], 1e-6);
+
+        /* The first 10% of the texels have no neighbours, even across
+         * the mask edges */
+        for (int y = 0; y < size.y; ++y)
+        for (int x = 0; x < size.x; ++x)
+        {
+            if (ker[x][y] > 0.1f)
+                continue;
+            for (int j = -1; j <= 1; ++j)
+            for (int i = -1; i <= 1; ++i)
+                if (i || j)
+                    lolunit_assert(ker[(x + i + size.x) % size.x]
+                                      [(y + j + size.y) % size.y] > 0.1f);
+        }
+    }
+
+    lolunit_declare_test(blue_noise_cache)
+    {
+        ivec2 const size(16, 16);
+        std::string const path = "./bluenoise1-16x16-4x4.bin";
+        std::remove(path.c_str());
+
+        array2d<float> a = image::kernel::blue_noise(size, ivec2(4, 4), ".");
+        array2d<float> b = image::kernel::blue_noise(size, ivec2(4, 4), ".");
+        std::remove(path.c_str());
+
+        lolunit_assert_equal(a.count(), b.count());
+        lolunit_assert(!memcmp(a.data(), b.data(), a.bytes()));
+    }
+};
+
+} /* namespace lol */
+
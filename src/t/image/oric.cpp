@@ -0,0 +1,359 @@
+//
+//  Lol Engine — Unit tests
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(oric_test)
+{
+    static image gradient()
+    {
+        ivec2 const size(240, 24);
+        image img(size);
+        vec4 *pixels = img.lock<PixelFormat::RGBA_F32>();
+        for (int y = 0; y < size.y; ++y)
+            for (int x = 0; x < size.x; ++x)
+                pixels[y * size.x + x]
+                    = vec4(0.5f + 0.5f * lol::sin(x * 0.05f),
+                           (float)y / size.y,
+                           0.5f + 0.5f * lol::cos((x + y) * 0.03f), 1.f);
+        img.unlock(pixels);
+        return img;
+    }
+
+    /* Mean squared difference of the blurred images, which is roughly
+     * what the encoder tries to minimise. */
+    static double perceived_error(image &a, image &b)
+    {
+        if (a.size() != b.size())
+            return 1.0;
+
+        array2d<float> ker = image::kernel::gaussian(vec2(1.5f));
+        image fa = a.Convolution(ker), fb = b.Convolution(ker);
+
+        vec4 const *pa = fa.lock<PixelFormat::RGBA_F32>();
+        vec4 const *pb = fb.lock<PixelFormat::RGBA_F32>();
+        int const count = a.size().x * a.size().y;
+        double ret = 0.0;
+        for (int n = 0; n < count; ++n)
+            ret += sqlength((pa[n] - pb[n]).rgb);
+        fa.unlock(pa);
+        fb.unlock(pb);
+
+        return ret / count;
+    }
+
+    static double encode(image &src, int quality)
+    {
+        char const *path = "oric-test.tap";
+
+        auto data = new ResourceImageData(new image(src));
+        data->m_quality = quality;
+        bool saved = ResourceLoader::Save(path, data);
+        delete data;
+
+        image dst;
+        bool loaded = saved && dst.load(path);
+        std::remove(path);
+
+        return loaded ? perceived_error(src, dst) : 1.0;
+    }
+
+    /*
+     * The sequential encoder that the threaded one replaced, as a
+     * reference: a plain depth-2 search without the error cache.
+     */
+
+    static ivec3 const *ref_palette(int n)
+    {
+#define V(a,b,c) ivec3(a,b,c),ivec3(a,b,c),ivec3(a,b,c),\
+                 ivec3(a,b,c),ivec3(a,b,c),ivec3(a,b,c),
+        static ivec3 const palette[8][6] =
+        {
+            { V(0x0000, 0x0000, 0x0000) },
+            { V(0xffff, 0x0000, 0x0000) },
+            { V(0x0000, 0xffff, 0x0000) },
+            { V(0xffff, 0xffff, 0x0000) },
+            { V(0x0000, 0x0000, 0xffff) },
+            { V(0xffff, 0x0000, 0xffff) },
+            { V(0x0000, 0xffff, 0xffff) },
+            { V(0xffff, 0xffff, 0xffff) },
+        };
+#undef V
+        return palette[n];
+    }
+
+    static u8vec2 ref_domove(uint8_t command, u8vec2 bgfg)
+    {
+        if ((command & 0x78) == 0x00)
+            bgfg[1] = command & 0x7;
+        else if ((command & 0x78) == 0x10)
+            bgfg[0] = command & 0x7;
+        return bgfg;
+    }
+
+    static int ref_geterror(ivec3 const *in, ivec3 indelta,
+                            ivec3 const *out, ivec3 *outdelta)
+    {
+        ivec3 tmpdelta[9] = { indelta, ivec3(0) };
+        int ret = 0;
+
+        for (int i = 0; i < 6; i++)
+        {
+            ivec3 a = in[i] + tmpdelta[0];
+            ivec3 b = out[i];
+
+            tmpdelta[0] = (a - b) * 15 / 32;
+            tmpdelta[i + 1] += (a - b) * 6 / 32;
+            tmpdelta[i + 2] += (a - b) * 9 / 32;
+            tmpdelta[i + 3] += (a - b) * 1 / 32;
+
+            ret += dot((a - b) / 256, (a - b) / 256);
+        }
+
+        for (int i = 0; i < 4; i++)
+        {
+            ivec3 a = (in[i] + in[i + 1] + in[i + 2]) / 3;
+            ivec3 b = (out[i] + out[i + 1] + out[i + 2]) / 3;
+
+            ret += dot((a - b) / 256, (a - b) / 256);
+        }
+
+        ret += dot(tmpdelta[0] / 256, tmpdelta[0] / 256);
+
+        *outdelta = tmpdelta[0];
+        return ret;
+    }
+
+    static uint8_t ref_bestmove(ivec3 const *in, u8vec2 bgfg,
+                                ivec3 delta, int depth, int *error, ivec3 *out)
+    {
+        ivec3 tmprgb[6], bestrgb[6];
+        ivec3 nop_rgb_delta, inop_rgb_delta;
+        ivec3 const *rgb, *nop_rgb, *inop_rgb;
+        int suberror, statice = 0, nop_error, inop_error;
+
+        nop_rgb = ref_palette(bgfg[0]);
+        nop_error = ref_geterror(in, delta, nop_rgb, &nop_rgb_delta);
+        inop_rgb = ref_palette(7 - bgfg[0]);
+        inop_error = ref_geterror(in, delta, inop_rgb, &inop_rgb_delta);
+
+        if (depth > 0)
+            ref_bestmove(in + 6, bgfg, ivec3(0), depth - 1, &statice, nullptr);
+
+        static uint8_t const command_list[] =
+        {
+            0x00, 0x04, 0x01, 0x05, 0x02, 0x06, 0x03, 0x07,
+            0x80, 0x84, 0x81, 0x85, 0x82, 0x86, 0x83, 0x87,
+            0x10, 0x14, 0x11, 0x15, 0x12, 0x16, 0x13, 0x17,
+            0x90, 0x94, 0x91, 0x95, 0x92, 0x96, 0x93, 0x97,
+            0x40, 0xc0
+        };
+
+        int besterror = 0x7ffffff;
+        uint8_t bestcommand = 0x10;
+        memcpy((void *)bestrgb, nop_rgb, sizeof(bestrgb));
+
+        for (uint8_t command : command_list)
+        {
+            ivec3 nexterr = ivec3(0);
+            int curerror = 0;
+
+            u8vec2 newbgfg = ref_domove(command, bgfg);
+            if ((command & 0x40) == 0x00 && newbgfg == bgfg)
+                continue;
+
+            if ((command & 0xf8) == 0x00)
+            {
+                curerror = nop_error;
+                rgb = nop_rgb;
+                nexterr = nop_rgb_delta;
+            }
+            else if ((command & 0xf8) == 0x80)
+            {
+                curerror = inop_error;
+                rgb = inop_rgb;
+                nexterr = inop_rgb_delta;
+            }
+            else if ((command & 0xf8) == 0x10)
+            {
+                rgb = ref_palette(newbgfg[0]);
+                curerror = ref_geterror(in, delta, rgb, &nexterr);
+            }
+            else if ((command & 0xf8) == 0x90)
+            {
+                rgb = ref_palette(7 - newbgfg[0]);
+                curerror = ref_geterror(in, delta, rgb, &nexterr);
+            }
+            else
+            {
+                bool const inverse = (command & 0x80) != 0;
+                ivec3 bgcolor = ref_palette(inverse ? 7 - bgfg[0] : bgfg[0])[0];
+                ivec3 fgcolor = ref_palette(inverse ? 7 - bgfg[1] : bgfg[1])[0];
+                ivec3 tmpvec = delta;
+
+                for (int i = 0; i < 6; i++)
+                {
+                    ivec3 delta1 = in[i] + tmpvec - bgcolor;
+                    ivec3 delta2 = in[i] + tmpvec - fgcolor;
+
+                    if (dot(delta1 / 256, delta1) < dot(delta2 / 256, delta2))
+                    {
+                        tmpvec = delta1 * 15 / 32;
+                        tmprgb[i] = bgcolor;
+                    }
+                    else
+                    {
+                        tmpvec = delta2 * 15 / 32;
+                        tmprgb[i] = fgcolor;
+                        command |= (1 << (5 - i));
+                    }
+                }
+
+                curerror += ref_geterror(in, delta, tmprgb, &nexterr);
+                rgb = tmprgb;
+            }
+
+            if (curerror > besterror)
+                continue;
+
+            curerror = curerror * 3 / 4;
+
+            if (depth == 0)
+                suberror = 0;
+            else if ((command & 0x68) == 0x00)
+                ref_bestmove(in + 6, newbgfg, nexterr, depth - 1,
+                             &suberror, nullptr);
+            else
+                suberror = statice;
+
+            if (curerror + suberror < besterror)
+            {
+                besterror = curerror + suberror;
+                bestcommand = command;
+                memcpy((void *)bestrgb, rgb, sizeof(bestrgb));
+            }
+        }
+
+        *error = besterror;
+        if (out)
+            memcpy((void *)out, bestrgb, sizeof(bestrgb));
+
+        return bestcommand;
+    }
+
+    /* Encode with the reference search, and decode the result with the
+     * codec, like encode() does; the image must be 240 pixels wide. */
+    static double reference(image &src)
+    {
+        ivec2 const size = src.size();
+        int const stride = size.x + 1, cells = size.x / 6;
+
+        array2d<ivec3> in(size + ivec2(1)), out(size + ivec2(1));
+        memset((void *)in.data(), 0, in.bytes());
+        memset((void *)out.data(), 0, out.bytes());
+
+        vec4 *pixels = src.lock<PixelFormat::RGBA_F32>();
+        for (int y = 0; y < size.y; y++)
+            for (int x = 0; x < size.x; x++)
+                for (int c = 0; c < 3; c++)
+                    in[x][y][c] = (int32_t)(0xffff * pixels[y * size.x + x][2 - c]);
+        src.unlock(pixels);
+
+        char const *path = "oric-ref.tap";
+        array<uint8_t> result;
+        result << 0x16 << 0x16 << 0x16 << 0x16 << 0x24;
+        result << 0 << 0xff << 0x80 << 0 << 0xbf << 0x3f << 0xa0 << 0;
+        for (char const *name = path; name[4]; ++name)
+            result << (uint8_t)name[0];
+        result << 0;
+
+        for (int y = 0; y < size.y; y++)
+        {
+            u8vec2 bgfg(0, 7);
+
+            for (int cell = 0; cell < cells; cell++)
+            {
+                ivec3 *srcl = &in[cell * 6][y];
+                ivec3 *dstl = &out[cell * 6][y];
+
+                int dummy;
+                uint8_t command = ref_bestmove(srcl, bgfg, ivec3(0),
+                                               min(2, cells - 1 - cell),
+                                               &dummy, dstl);
+                for (int i = 0; i < 6; i++)
+                {
+                    ivec3 delta = srcl[i] - dstl[i];
+                    srcl[i + 1] += delta * 15 / 32;
+                    srcl[i + stride - 1] += delta * 6 / 32;
+                    srcl[i + stride] += delta * 9 / 32;
+                    srcl[i + stride + 1] += delta * 1 / 32;
+                }
+
+                bgfg = ref_domove(command, bgfg);
+                result << command;
+            }
+        }
+
+        File f;
+        f.Open(path, FileAccess::Write);
+        f.Write(result.data(), result.bytes());
+        f.Close();
+
+        image dst;
+        bool loaded = dst.load(path);
+        std::remove(path);
+
+        return loaded ? perceived_error(src, dst) : 1.0;
+    }
+
+    lolunit_declare_test(quality_ordering)
+    {
+        image src = gradient();
+
+        /* An empty screen, to make sure the encoder does something */
+        image black(src.size());
+        vec4 *pixels = black.lock<PixelFormat::RGBA_F32>();
+        for (int n = 0; n < src.size().x * src.size().y; ++n)
+            pixels[n] = vec4(0.f, 0.f, 0.f, 1.f);
+        black.unlock(pixels);
+        double const empty_error = perceived_error(src, black);
+
+        double const fast_error = encode(src, 0);
+        double const default_error = encode(src, 50);
+        double const best_error = encode(src, 100);
+        double const reference_error = reference(src);
+
+        lolunit_assert_less(default_error, empty_error * 0.01);
+
+        /* The default setting is within 5% of the previous encoder, and
+         * the fastest setting within 15% */
+        lolunit_assert_lequal(default_error, reference_error * 1.05);
+        lolunit_assert_lequal(fast_error, reference_error * 1.15);
+
+        /* Searching deeper never does worse than the fastest setting,
+         * and the fastest setting stays within 15% of the default. */
+        lolunit_assert_lequal(default_error, fast_error);
+        lolunit_assert_lequal(best_error, fast_error);
+        lolunit_assert_lequal(fast_error, default_error * 1.15);
+    }
+};
+
+} /* namespace lol */
+
@@ -0,0 +1,151 @@
+//
+//  Lol Engine — Unit tests
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(resample_test)
+{
+    ResampleAlgorithm const filters[4] =
+    {
+        ResampleAlgorithm::Box,
+        ResampleAlgorithm::Mitchell,
+        ResampleAlgorithm::CatmullRom,
+        ResampleAlgorithm::Lanczos3,
+    };
+
+    /* A random 8-bit image */
+    static image random_image(ivec2 size)
+    {
+        image ret(size);
+        u8vec4 *data = ret.lock<PixelFormat::RGBA_8>();
+        for (int i = 0; i < size.x * size.y; ++i)
+            data[i] = u8vec4(lol::rand(256), lol::rand(256), lol::rand(256), lol::rand(256));
+        ret.unlock(data);
+        return ret;
+    }
+
+    lolunit_declare_test(constant)
+    {
+        /* Flat images stay flat, whatever the filter and the format */
+        for (auto filter : filters)
+        {
+            image src(ivec2(37, 23));
+            u8vec4 *data = src.lock<PixelFormat::RGBA_8>();
+            for (int i = 0; i < 37 * 23; ++i)
+                data[i] = u8vec4(10, 100, 200, 255);
+            src.unlock(data);
+
+            for (ivec2 size : { ivec2(11, 7), ivec2(37, 23), ivec2(80, 50) })
+            {
+                image dst = src.Resize(size, filter);
+                lolunit_assert(dst.format() == PixelFormat::RGBA_8);
+                lolunit_assert(dst.size() == size);
+
+                u8vec4 *out = dst.lock<PixelFormat::RGBA_8>();
+                for (int i = 0; i < size.x * size.y; ++i)
+                    lolunit_assert(out[i] == u8vec4(10, 100, 200, 255));
+                dst.unlock(out);
+            }
+        }
+    }
+
+    lolunit_declare_test(identity)
+    {
+        /* Interpolating filters give back the same image at scale 1 */
+        image src = random_image(ivec2(29, 17));
+        u8vec4 *in = src.lock<PixelFormat::RGBA_8>();
+
+        for (auto filter : { ResampleAlgorithm::Box, ResampleAlgorithm::CatmullRom,
+                             ResampleAlgorithm::Lanczos3 })
+        {
+            image dst = src.Resize(ivec2(29, 17), filter);
+            u8vec4 *out = dst.lock<PixelFormat::RGBA_8>();
+            for (int i = 0; i < 29 * 17; ++i)
+                lolunit_assert(out[i] == in[i]);
+            dst.unlock(out);
+        }
+
+        src.unlock(in);
+    }
+
+    lolunit_declare_test(antialias)
+    {
+        /* A one-pixel checkerboard shrunk by two becomes flat grey, except
+         * near the edges where the filters see clamped pixels */
+        image src(ivec2(64, 64));
+        float *data = src.lock<PixelFormat::Y_F32>();
+        for (int y = 0; y < 64; ++y)
+            for (int x = 0; x < 64; ++x)
+                data[y * 64 + x] = (float)((x ^ y) & 1);
+        src.unlock(data);
+
+        for (auto filter : filters)
+        {
+            image dst = src.Resize(ivec2(32, 32), filter);
+            lolunit_assert(dst.format() == PixelFormat::Y_F32);
+
+            float *out = dst.lock<PixelFormat::Y_F32>();
+            for (int y = 3; y < 29; ++y)
+                for (int x = 3; x < 29; ++x)
+                    lolunit_assert_doubles_equal(out[y * 32 + x], 0.5f, 1e-5f);
+            dst.unlock(out);
+        }
+    }
+
+    lolunit_declare_test(channels)
+    {
+        /* Formats with 4 channels use dedicated kernels; they must give
+         * the same result as formats with 1 and 3 channels */
+        image src = random_image(ivec2(53, 41));
+
+        for (auto filter : filters)
+        for (ivec2 size : { ivec2(20, 15), ivec2(61, 97) })
+        {
+            image rgba8(src), rgb8(src), rgbaf(src), rgbf(src);
+            rgb8.unlock(rgb8.lock<PixelFormat::RGB_8>());
+            rgbaf.unlock(rgbaf.lock<PixelFormat::RGBA_F32>());
+            rgbf.unlock(rgbf.lock<PixelFormat::RGB_F32>());
+
+            image a = rgba8.Resize(size, filter), b = rgb8.Resize(size, filter);
+            image c = rgbaf.Resize(size, filter), d = rgbf.Resize(size, filter);
+            lolunit_assert(b.format() == PixelFormat::RGB_8);
+
+            u8vec4 *pa = a.lock<PixelFormat::RGBA_8>();
+            u8vec3 *pb = b.lock<PixelFormat::RGB_8>();
+            vec4 *pc = c.lock<PixelFormat::RGBA_F32>();
+            vec3 *pd = d.lock<PixelFormat::RGB_F32>();
+
+            for (int i = 0; i < size.x * size.y; ++i)
+            {
+                lolunit_assert(pa[i].rgb == pb[i]);
+                lolunit_assert_doubles_equal(pc[i].r, pd[i].r, 1e-5f);
+                lolunit_assert_doubles_equal(pc[i].b, pd[i].b, 1e-5f);
+
+                /* Fixed point and float agree, give or take rounding */
+                lolunit_assert(lol::abs(pa[i].g / 255.f - pc[i].g) < 2.5f / 255.f);
+            }
+
+            a.unlock(pa);
+            b.unlock(pb);
+            c.unlock(pc);
+            d.unlock(pd);
+        }
+    }
+};
+
+} /* namespace lol */
+
@@ -0,0 +1,243 @@
+//
+//  Lol Engine — Unit tests
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+#include <lol/lua.h>
+
+#include <cstdio>
+
+#include <lolunit.h>
+
+#include "lolua/bytecode.h"
+
+namespace lol
+{
+
+lolunit_declare_fixture(baselua_test)
+{
+    static int dump_writer(lua_State *l, void const *p, size_t size, void *data)
+    {
+        UNUSED(l);
+        static_cast<std::string *>(data)->append((char const *)p, size);
+        return 0;
+    }
+
+    /* Real bytecode, for the loader to run */
+    static std::string compile(char const *code)
+    {
+        std::string chunk;
+        lua_State *l = luaL_newstate();
+        if (luaL_loadstring(l, code) == LUA_OK)
+            lua_dump(l, dump_writer, &chunk, 0);
+        lua_close(l);
+        return chunk;
+    }
+
+    static uint64_t key(std::string const &code)
+    {
+        /* Code run with ExecLuaCode() is its own chunk name */
+        return LuaBytecodeCache::Hash(code.c_str(), code.length(), code);
+    }
+
+    static std::string read_file(std::string const &path)
+    {
+        File f;
+        f.Open(path, FileAccess::Read, true);
+        std::string data = f.IsValid() ? f.ReadString() : "";
+        f.Close();
+        return data;
+    }
+
+    static void write_file(std::string const &path, std::string const &data)
+    {
+        File f;
+        f.Open(path, FileAccess::Write, true);
+        f.Write(data);
+        f.Close();
+    }
+
+    lolunit_declare_test(bytecode_hit_and_miss)
+    {
+        LuaBytecodeCache cache;
+        cache.SetDirectory(".");
+        uint64_t const k = key("hit = 1");
+        std::string const path = cache.GetPath(k);
+        std::remove(path.c_str());
+
+        std::string chunk;
+        lolunit_assert(!cache.Find(k, chunk));
+        cache.Insert(k, "some bytecode", true);
+        lolunit_assert(cache.Find(k, chunk));
+        lolunit_assert(chunk == "some bytecode");
+
+        /* Another run finds the saved chunk */
+        LuaBytecodeCache other;
+        other.SetDirectory(".");
+        chunk.clear();
+        lolunit_assert(other.Find(k, chunk));
+        lolunit_assert(chunk == "some bytecode");
+
+        /* Without a directory, nothing is read or written */
+        LuaBytecodeCache memory_only;
+        lolunit_assert(memory_only.GetPath(k) == "");
+        lolunit_assert(!memory_only.Find(k, chunk));
+
+        std::remove(path.c_str());
+    }
+
+    lolunit_declare_test(bytecode_invalidation)
+    {
+        /* Changing the source or the chunk name changes the key */
+        lolunit_assert(key("x = 1") != key("x = 2"));
+        lolunit_assert(LuaBytecodeCache::Hash("x = 1", 5, "a")
+                        != LuaBytecodeCache::Hash("x = 1", 5, "b"));
+
+        LuaBytecodeCache cache;
+        cache.SetDirectory(".");
+        cache.Insert(key("x = 1"), "old bytecode", true);
+
+        LuaBytecodeCache other;
+        other.SetDirectory(".");
+        std::string chunk;
+        lolunit_assert(!other.Find(key("x = 2"), chunk));
+
+        /* A file saved for another source is not trusted either */
+        std::string const path = other.GetPath(key("x = 2"));
+        write_file(path, read_file(other.GetPath(key("x = 1"))));
+        lolunit_assert(!other.Find(key("x = 2"), chunk));
+
+        std::remove(path.c_str());
+        std::remove(other.GetPath(key("x = 1")).c_str());
+    }
+
+    lolunit_declare_test(bytecode_damaged)
+    {
+        uint64_t const k = key("damaged = 1");
+        std::string const good = "some longer bytecode";
+
+        LuaBytecodeCache cache;
+        cache.SetDirectory(".");
+        cache.Insert(k, good, true);
+        std::string const path = cache.GetPath(k);
+        std::string const data = read_file(path);
+        lolunit_assert(data.length() > good.length());
+
+        /* Flip one bit anywhere in the file, or cut it short */
+        for (size_t i = 0; i < data.length(); ++i)
+        {
+            std::string bad = data;
+            bad[i] ^= 0x10;
+            write_file(path, bad);
+            LuaBytecodeCache other;
+            other.SetDirectory(".");
+            std::string chunk;
+            lolunit_assert(!other.Find(k, chunk));
+        }
+
+        for (size_t len : { (size_t)0, (size_t)8, data.length() - 1 })
+        {
+            write_file(path, data.substr(0, len));
+            LuaBytecodeCache other;
+            other.SetDirectory(".");
+            std::string chunk;
+            lolunit_assert(!other.Find(k, chunk));
+        }
+
+        /* Inserting again repairs the file */
+        cache.Insert(k, good, true);
+        LuaBytecodeCache other;
+        other.SetDirectory(".");
+        std::string chunk;
+        lolunit_assert(other.Find(k, chunk));
+        lolunit_assert(chunk == good);
+
+        std::remove(path.c_str());
+    }
+
+    lolunit_declare_test(loader_cache)
+    {
+        /* The loader runs saved bytecode instead of the source: plant a
+         * different program where the cache will look for it */
+        std::string const code = "planted = 1";
+        LuaBytecodeCache planter;
+        planter.SetDirectory(".");
+        std::string const path = planter.GetPath(key(code));
+        planter.Insert(key(code), compile("planted = 2"), true);
+
+        LuaLoader::SetBytecodeCache(".");
+        LuaLoader loader;
+        lolunit_assert(loader.ExecLuaCode(code));
+        lolunit_assert_equal(2, loader.Get<int32_t>("planted"));
+
+        /* Damaged bytecode must not crash; the source runs instead, and
+         * its bytecode replaces the damaged file */
+        std::string const code2 = "damaged = 1";
+        std::string const path2 = planter.GetPath(key(code2));
+        planter.Insert(key(code2), compile("damaged = 2"), true);
+        std::string data = read_file(path2);
+        data[data.length() / 2] ^= 0x55;
+        write_file(path2, data);
+
+        lolunit_assert(loader.ExecLuaCode(code2));
+        lolunit_assert_equal(1, loader.Get<int32_t>("damaged"));
+
+        LuaBytecodeCache reader;
+        reader.SetDirectory(".");
+        std::string chunk;
+        lolunit_assert(reader.Find(key(code2), chunk));
+        lolunit_assert(chunk == compile(code2.c_str()));
+
+        LuaLoader::SetBytecodeCache("");
+        std::remove(path.c_str());
+        std::remove(path2.c_str());
+    }
+
+    lolunit_declare_test(gc_budget)
+    {
+        LuaLoader loader;
+        lolunit_assert(loader.ExecLuaCode(
+            "function garbage(n) for i = 1, n do local t = {} end end\n"
+            "collectgarbage()\n"
+            "kb0 = collectgarbage('count')\n"));
+        float const kb0 = loader.Get<float>("kb0");
+
+        /* With a budget, garbage piles up until CollectGarbage() */
+        loader.SetGcBudget(0.001f);
+        lolunit_assert(loader.ExecLuaCode(
+            "garbage(100000)\n"
+            "kb1 = collectgarbage('count')\n"));
+        float const kb1 = loader.Get<float>("kb1");
+        lolunit_assert_less(kb0 + 2048.f, kb1);
+
+        /* Each call does a bounded amount of work; enough of them free
+         * the garbage */
+        int calls = 0;
+        for (; calls < 10000; ++calls)
+        {
+            loader.CollectGarbage();
+            lolunit_assert(loader.ExecLuaCode("kb2 = collectgarbage('count')"));
+            if (loader.Get<float>("kb2") < kb0 + 512.f)
+                break;
+        }
+        lolunit_assert_less(calls, 10000);
+
+        /* Without a budget, the collector runs on its own again */
+        loader.SetGcBudget(0.f);
+        lolunit_assert(loader.ExecLuaCode(
+            "garbage(100000)\n"
+            "kb3 = collectgarbage('count')\n"));
+        lolunit_assert_less(loader.Get<float>("kb3"), kb1);
+    }
+};
+
+} /* namespace lol */
+
@@ -0,0 +1,160 @@
+//
+//  Lol Engine — Unit tests
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+#include <lol/lua.h>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+/* Two ways of returning the same vector from C++ */
+static int push_floats(lua_State *l)
+{
+    auto stack = LuaStack::Begin(l);
+    return (stack << vec3(1.f, 2.f, 3.f)).End();
+}
+
+static int push_value(lua_State *l)
+{
+    auto stack = LuaStack::Begin(l);
+    return (stack << LuaValue<vec3>(vec3(1.f, 2.f, 3.f))).End();
+}
+
+class MathLuaLoader : public LuaLoader
+{
+public:
+    MathLuaLoader()
+    {
+        lua_State *l = GetLuaState();
+        LuaFunction f1(l, "push_floats", &push_floats);
+        LuaFunction f2(l, "push_value", &push_value);
+    }
+};
+
+lolunit_declare_fixture(mathlua_test)
+{
+    lolunit_declare_test(components)
+    {
+        MathLuaLoader loader;
+        lolunit_assert(loader.ExecLuaCode(
+            "local v = vec4(1, 2, 3, 4)\n"
+            "x, g, z, w = v.x, v.g, v[3], v.w\n"
+            "v.y = 5; v[3] = 6\n"
+            "y2, z2 = v.y, v.b\n"
+            "bad = v.q\n"
+            "splat = vec3(7)\n"
+            "copy = vec3(splat)\n"
+            "ok = pcall(function() v.q = 1 end)\n"));
+
+        lolunit_assert_equal(1.f, loader.Get<float>("x"));
+        lolunit_assert_equal(2.f, loader.Get<float>("g"));
+        lolunit_assert_equal(3.f, loader.Get<float>("z"));
+        lolunit_assert_equal(4.f, loader.Get<float>("w"));
+        lolunit_assert_equal(5.f, loader.Get<float>("y2"));
+        lolunit_assert_equal(6.f, loader.Get<float>("z2"));
+        lolunit_assert(loader.ExecLuaCode("assert(bad == nil)"));
+        lolunit_assert(loader.Get<vec3>("splat") == vec3(7.f));
+        lolunit_assert(loader.Get<vec3>("copy") == vec3(7.f));
+        lolunit_assert(!loader.Get<bool>("ok"));
+    }
+
+    lolunit_declare_test(arithmetic)
+    {
+        MathLuaLoader loader;
+        lolunit_assert(loader.ExecLuaCode(
+            "local a, b = vec3(1, 2, 3), vec3(4, 5, 6)\n"
+            "add, sub, neg = a + b, b - a, -a\n"
+            "mul, lmul, vmul = a * 2, 2 * a, a * b\n"
+            "div, ldiv = b / 2, 12 / b\n"
+            "dot, cross = a:dot(b), vec3.cross(a, b)\n"
+            "len = vec2(3, 4):length()\n"
+            "ok = pcall(function() return a + 1 end)\n"));
+
+        lolunit_assert(loader.Get<vec3>("add") == vec3(5.f, 7.f, 9.f));
+        lolunit_assert(loader.Get<vec3>("sub") == vec3(3.f));
+        lolunit_assert(loader.Get<vec3>("neg") == vec3(-1.f, -2.f, -3.f));
+        lolunit_assert(loader.Get<vec3>("mul") == vec3(2.f, 4.f, 6.f));
+        lolunit_assert(loader.Get<vec3>("lmul") == vec3(2.f, 4.f, 6.f));
+        lolunit_assert(loader.Get<vec3>("vmul") == vec3(4.f, 10.f, 18.f));
+        lolunit_assert(loader.Get<vec3>("div") == vec3(2.f, 2.5f, 3.f));
+        lolunit_assert(loader.Get<vec3>("ldiv") == vec3(3.f, 2.4f, 2.f));
+        lolunit_assert_equal(32.f, loader.Get<float>("dot"));
+        lolunit_assert(loader.Get<vec3>("cross") == vec3(-3.f, 6.f, -3.f));
+        lolunit_assert_equal(5.f, loader.Get<float>("len"));
+        lolunit_assert(!loader.Get<bool>("ok"));
+    }
+
+    lolunit_declare_test(equality)
+    {
+        MathLuaLoader loader;
+        lolunit_assert(loader.ExecLuaCode(
+            "same = vec3(1, 2, 3) == vec3(1, 2, 3)\n"
+            "different = vec3(1, 2, 3) ~= vec3(1, 2, 4)\n"
+            "mixed = vec2(1) == vec3(1)\n"
+            "matrices = mat4(1) == mat4.scale(1)\n"
+            "name = tostring(vec2(1, 2.5))\n"));
+
+        lolunit_assert(loader.Get<bool>("same"));
+        lolunit_assert(loader.Get<bool>("different"));
+        lolunit_assert(!loader.Get<bool>("mixed"));
+        lolunit_assert(loader.Get<bool>("matrices"));
+        lolunit_assert(loader.Get<std::string>("name") == "vec2(1, 2.5)");
+    }
+
+    lolunit_declare_test(quat_and_mat4)
+    {
+        MathLuaLoader loader;
+        lolunit_assert(loader.ExecLuaCode(
+            "local q = quat.rotate(math.pi / 2, vec3(0, 0, 1))\n"
+            "rotated = q * vec3(1, 0, 0)\n"
+            "local m = mat4.translate(1, 2, 3)\n"
+            "moved = m * vec3(0)\n"
+            "back = m:inverse() * moved\n"
+            "column = m[4]\n"
+            "q2 = q * q:conjugate()\n"));
+
+        vec3 rotated = loader.Get<vec3>("rotated");
+        lolunit_assert_doubles_equal(0.f, rotated.x, 1e-5f);
+        lolunit_assert_doubles_equal(1.f, rotated.y, 1e-5f);
+        lolunit_assert_doubles_equal(0.f, rotated.z, 1e-5f);
+        lolunit_assert(loader.Get<vec3>("moved") == vec3(1.f, 2.f, 3.f));
+        lolunit_assert_doubles_equal(0.f, length(loader.Get<vec3>("back")), 1e-5f);
+        lolunit_assert(loader.Get<vec4>("column") == vec4(1.f, 2.f, 3.f, 1.f));
+        lolunit_assert_doubles_equal(1.f, loader.Get<quat>("q2").w, 1e-5f);
+    }
+
+    lolunit_declare_test(push_arity)
+    {
+        /* Pushed vectors are still three numbers unless asked otherwise */
+        MathLuaLoader loader;
+        lolunit_assert(loader.ExecLuaCode(
+            "n1 = select('#', push_floats())\n"
+            "n2 = select('#', push_value())\n"
+            "v = push_value()\n"
+            "sum = v.x + v.y + v.z\n"));
+        lolunit_assert_equal(3, loader.Get<int32_t>("n1"));
+        lolunit_assert_equal(1, loader.Get<int32_t>("n2"));
+        lolunit_assert_equal(6.f, loader.Get<float>("sum"));
+
+        /* Globals hold one value, so references store userdata */
+        LuaRef<vec3> ref = loader.GetRef<vec3>("pos");
+        ref.Set(vec3(4.f, 5.f, 6.f));
+        lolunit_assert(loader.ExecLuaCode("y = pos.y"));
+        lolunit_assert_equal(5.f, loader.Get<float>("y"));
+        lolunit_assert(ref.Get() == vec3(4.f, 5.f, 6.f));
+    }
+};
+
+} /* namespace lol */
+
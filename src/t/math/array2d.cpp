@@ -65,6 +65,22 @@ lolunit_declare_fixture(array2d_test)
         lolunit_assert_equal(a[2][2], 7);
         lolunit_assert_equal(a[3][2], 6);
     }
+
+    lolunit_declare_test(array2d_vector_index)
+    {
+        array2d<int> a(ivec2(7, 3));
+
+        for (int j = 0; j < 3; ++j)
+            for (int i = 0; i < 7; ++i)
+                a[i][j] = i * 10 + j;
+
+        for (int j = 0; j < 3; ++j)
+            for (int i = 0; i < 7; ++i)
+                lolunit_assert_equal(a[ivec2(i, j)], i * 10 + j);
+
+        a[ivec2(6, 0)] = -1;
+        lolunit_assert_equal(a[6][0], -1);
+    }
 };
 
 } /* namespace lol */
@@ -349,6 +349,75 @@ lolunit_declare_fixture(polynomial_test)
         lolunit_assert_equal(t4[3], 0.f);
         lolunit_assert_equal(t4[4], 8.f);
     }
+
+    lolunit_declare_test(eval_estrin)
+    {
+        for (int degree = -1; degree < 20; ++degree)
+        {
+            polynomial<double> p;
+            for (int i = 0; i <= degree; ++i)
+                p.set(i, 1.0 + 0.25 * i);
+
+            for (double x : { -1.5, -0.3, 0.0, 0.7, 2.0 })
+                lolunit_assert_doubles_equal(p.eval(x), p.eval_estrin(x),
+                                             1e-13 * lol::max(1.0, lol::abs(p.eval(x))));
+        }
+    }
+
+    lolunit_declare_test(eval_batch)
+    {
+        polynomial<float> p { 1.f, -2.f, 0.5f, 3.f, -0.25f };
+        polynomial<double> q { 1.0, -2.0, 0.5, 3.0, -0.25 };
+        polynomial<real> r { real(1.0), real(-2.0), real(0.5), real(3.0), real(-0.25) };
+
+        /* Use a count that leaves some values after the SIMD loops */
+        array<float> x;
+        array<double> y;
+        array<real> z;
+        for (int i = 0; i < 23; ++i)
+        {
+            x << -1.f + 0.125f * i;
+            y << -1.0 + 0.125 * i;
+            z << real(-1.0 + 0.125 * i);
+        }
+
+        array<float> px = p.eval(x);
+        array<double> qy = q.eval(y);
+        array<real> rz = r.eval(z);
+        lolunit_assert_equal(px.count(), x.count());
+        for (int i = 0; i < x.count(); ++i)
+        {
+            lolunit_assert_doubles_equal(p.eval(x[i]), px[i], 1e-6);
+            lolunit_assert_equal(q.eval(y[i]), qy[i]);
+            lolunit_assert_doubles_equal((double)r.eval(z[i]), (double)rz[i], 1e-15);
+        }
+
+        /* The zero polynomial */
+        array<double> zero = polynomial<double>().eval(y);
+        for (int i = 0; i < y.count(); ++i)
+            lolunit_assert_equal(zero[i], 0.0);
+    }
+
+    lolunit_declare_test(karatsuba_multiplication)
+    {
+        /* Small integer coefficients give exact results with both
+         * methods; the degrees are large enough to use Karatsuba. */
+        polynomial<double> p, q;
+        for (int i = 0; i <= 100; ++i)
+            p.set(i, (double)(i * 7 % 11) - 5);
+        for (int i = 0; i <= 77; ++i)
+            q.set(i, (double)(i * 5 % 13) - 6);
+
+        polynomial<double> r = p * q;
+        lolunit_assert_equal(r.degree(), 177);
+        for (int n = 0; n <= r.degree(); ++n)
+        {
+            double expected = 0.0;
+            for (int i = 0; i <= n; ++i)
+                expected += p[i] * q[n - i];
+            lolunit_assert_equal(expected, r[n]);
+        }
+    }
 };
 
 } /* namespace lol */
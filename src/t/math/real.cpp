@@ -178,6 +178,73 @@ lolunit_declare_fixture(real_test)
         lolunit_assert_equal(i2, 0.5);
     }
 
+    /* The relative error must stay within a few bits of the precision */
+    void check_close(real const &x, real const &expected, int slack)
+    {
+        real delta = fabs(x - expected);
+        lolunit_assert(!delta || ldexp(delta, x.total_bits() - slack) < fabs(expected));
+    }
+
+    lolunit_declare_test(known_digits)
+    {
+        static char const *pi =
+            "3.14159265358979323846264338327950288419716939937510582097494459"
+            "2307816406286208998628034825342117067982148086513282306647093844"
+            "6095505822317253594081284811174502841027019385211055596446229489"
+            "5493038196442881097566593344612847564823378678316527120190914564"
+            "8566923460348610454326648213393607260249141273724587006606315588"
+            "1748815209209628292540917153643678925903600113305305488204665213"
+            "8414695194151160943305727036575959195309218611738193261179310511"
+            "8548074462379962749567351885752724891227938183011949129833673362"
+            "4406566430860213949463952247371907021798609437027705392171762931"
+            "76752384674818467669405132000568127145263560";
+        static char const *e =
+            "2.71828182845904523536028747135266249775724709369995957496696762"
+            "7724076630353547594571382178525166427427466391932003059921817413"
+            "5966290435729003342952605956307381323286279434907632338298807531"
+            "9525101901157383418793070215408914993488416750924476146066808226"
+            "4800168477411853742345442437107539077744992069551702761838606261"
+            "3313845830007520449338265602976067371132007093287091274437470472"
+            "3069697720931014169283681902551510865746377211125238978442505695"
+            "3696770785449969967946864454905987931636889230098793127736178215"
+            "4249992295763514822082698951936680331825288693984964651058209392"
+            "39829488793320362509443117301238197068416140";
+        static char const *ln2 =
+            "0.69314718055994530941723212145817656807550013436025525412068000"
+            "9493393621969694715605863326996418687542001481020570685733685520"
+            "2357581305570326707516350759619307275708283714351903070386238916"
+            "7347112335011536449795523912047517268157493206515552473413952588"
+            "2950453007095326366642654104239157814952043740430385500801944170"
+            "6416715186447128399681717845469570262716310645461502572074024816"
+            "3777338963855069526066834113727387372292895649354702576265209885"
+            "9693201965058554764703306793654432547632744951250406069438147104"
+            "6899465062201677204245245296126879465461931651746813926725041038"
+            "02546259656869144192871608293803172714367782";
+
+        /* Also check 2048-bit values, as used for minimax tables */
+        int const old_count = real::DEFAULT_BIGIT_COUNT;
+        for (int count : { 16, 64, 16 })
+        {
+            real::DEFAULT_BIGIT_COUNT = count;
+            lolunit_set_context(count);
+
+            /* Parsing the long decimal strings loses a few bits */
+            check_close(real::R_PI(), real(pi), 16);
+            check_close(real::R_E(), real(e), 16);
+            check_close(real::R_LN2(), real(ln2), 16);
+
+            check_close(atan(real::R_1()) * 4, real::R_PI(), 4);
+            check_close(log(real::R_E()), real::R_1(), 4);
+            check_close(exp(real::R_LN2()), real::R_2(), 4);
+            check_close(cos(real::R_PI() / 3), real::R_1() / 2, 4);
+            check_close(sqrt(real::R_2()) * sqrt(real::R_2()), real::R_2(), 4);
+            check_close(inverse(real::R_3()) * 3, real::R_1(), 4);
+            lolunit_assert(ldexp(fabs(sin(real::R_PI())), real::R_PI().total_bits() - 4)
+                            < real::R_1());
+        }
+        real::DEFAULT_BIGIT_COUNT = old_count;
+    }
+
     lolunit_declare_test(init)
     {
         real r;
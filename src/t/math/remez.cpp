@@ -0,0 +1,99 @@
+//
+//  Lol Engine — Unit tests for the Remez solver
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(remez_test)
+{
+    /* The largest error of p with f on a fine grid over [a..b] */
+    static double max_error(polynomial<real> const &p,
+                            remez_solver::function const &f,
+                            double a, double b, bool relative)
+    {
+        double ret = 0.0;
+        for (int i = 0; i <= 1000; ++i)
+        {
+            real const x = real(a + (b - a) * i / 1000);
+            real err = p.eval(x) - f(x);
+            if (relative)
+                err /= f(x);
+            ret = lol::max(ret, lol::abs((double)err));
+        }
+        return ret;
+    }
+
+    lolunit_declare_test(exp)
+    {
+        remez_solver::function f = [](real const &x) { return lol::exp(x); };
+
+        remez_solver solver;
+        polynomial<real> p = solver.run(4, -real::R_1(), real::R_1(), f);
+        lolunit_assert_equal(p.degree(), 4);
+
+        /* The minimax error is well known, and it is the maximum error */
+        double const error = (double)solver.error();
+        lolunit_assert_doubles_equal(5.46668e-4, error, 1e-9);
+        lolunit_assert(max_error(p, f, -1.0, 1.0, false) <= error * (1 + 1e-10));
+
+        /* It is better than the truncated Taylor series */
+        polynomial<real> taylor { real(1.0), real(1.0), real(0.5),
+                                  real::R_1() / 6, real::R_1() / 24 };
+        lolunit_assert(max_error(taylor, f, -1.0, 1.0, false) > 2 * error);
+    }
+
+    lolunit_declare_test(relative_error)
+    {
+        remez_solver::function f = [](real const &x) { return lol::sin(x) + real(2.0); };
+
+        remez_solver solver;
+        polynomial<real> p = solver.run(5, real(0.5), real(3.0), f, f);
+
+        double const error = (double)solver.error();
+        lolunit_assert(error > 0.0 && error < 1e-3);
+        lolunit_assert(max_error(p, f, 0.5, 3.0, true) <= error * (1 + 1e-10));
+    }
+
+    lolunit_declare_test(exact_polynomial)
+    {
+        /* Approximating a polynomial of a lower degree gives it back */
+        polynomial<real> q { real(0.5), real(-1.0), real(3.0) };
+        remez_solver::function f = [&](real const &x) { return q.eval(x); };
+
+        remez_solver solver;
+        polynomial<real> p = solver.run(3, real(-2.0), real(1.0), f);
+        for (int i = 0; i <= 3; ++i)
+            lolunit_assert_doubles_equal((double)q[i], (double)p[i], 1e-30);
+    }
+
+    lolunit_declare_test(cpp_table)
+    {
+        remez_solver::function f = [](real const &x) { return lol::exp(x); };
+
+        remez_solver solver;
+        polynomial<real> p = solver.run(2, real(0.0), real(1.0), f);
+
+        std::string const table = solver.cpp_table<double>("exp_coeffs");
+        lolunit_assert(table.find("static constexpr double exp_coeffs[] =") != std::string::npos);
+        lolunit_assert(table.find(lol::format("%.17e", (double)p[2])) != std::string::npos);
+
+        std::string const table_f = solver.cpp_table<float>("exp_coeffs_f");
+        lolunit_assert(table_f.find(lol::format("%.9ef,", (float)p[0])) != std::string::npos);
+    }
+};
+
+} /* namespace lol */
+
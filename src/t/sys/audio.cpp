@@ -0,0 +1,163 @@
+//
+//  Lol Engine — Unit tests
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <lolunit.h>
+
+#include "audio/mixer.h"
+
+namespace lol
+{
+
+lolunit_declare_fixture(audio_test)
+{
+    /* Buffers of an odd size, to test the mixing loops’ tails */
+    static int const FRAMES = 61;
+
+    static audio::format float_format()
+    {
+        return is_big_endian() ? audio::format::float32be
+                               : audio::format::float32le;
+    }
+
+    /* A voice that always plays the same value on all its channels */
+    static std::shared_ptr<audio_voice> constant(float value, int frequency,
+                                                 int channels)
+    {
+        auto voice = std::make_shared<audio_voice>(float_format(), frequency,
+                                                   channels);
+        voice->m_callback = [value](void *buf, int bytes)
+        {
+            for (int i = 0; i < bytes / 4; ++i)
+                ((float *)buf)[i] = value;
+        };
+        return voice;
+    }
+
+    lolunit_declare_test(sum)
+    {
+        audio_mixer mixer(float_format(), 48000, 2, 64);
+        mixer.add_voice(constant(0.25f, 48000, 2));
+        mixer.add_voice(constant(0.125f, 48000, 1));
+        /* A different frequency needs interpolation */
+        mixer.add_voice(constant(0.0625f, 22050, 2));
+
+        /* The first buffer fades in from silence */
+        float out[FRAMES * 2];
+        mixer.render(out, FRAMES);
+        lolunit_assert_equal(out[0], 0.f);
+        for (int n = 1; n < FRAMES; ++n)
+            lolunit_assert_less(out[n * 2 - 2], out[n * 2]);
+
+        mixer.render(out, FRAMES);
+        for (float x : out)
+            lolunit_assert_doubles_equal(x, 0.4375f, 1e-6f);
+    }
+
+    lolunit_declare_test(volume)
+    {
+        audio_mixer mixer(float_format(), 44100, 2, 64);
+        int const id = mixer.add_voice(constant(0.5f, 44100, 2));
+        float out[FRAMES * 2];
+        mixer.render(out, FRAMES);
+
+        /* Volume ramps over one buffer, then stays */
+        mixer.voice(id)->m_volume = 0.5f;
+        mixer.render(out, FRAMES);
+        lolunit_assert_doubles_equal(out[0], 0.5f, 1e-6f);
+        lolunit_assert_doubles_equal(out[FRAMES * 2 - 1], 0.25f, 0.5f / FRAMES);
+        mixer.render(out, FRAMES);
+        for (float x : out)
+            lolunit_assert_doubles_equal(x, 0.25f, 1e-6f);
+
+        /* Pan turns the other side down */
+        mixer.voice(id)->m_pan = 1.f;
+        mixer.render(out, FRAMES);
+        mixer.render(out, FRAMES);
+        for (int n = 0; n < FRAMES; ++n)
+        {
+            lolunit_assert_doubles_equal(out[n * 2], 0.f, 1e-6f);
+            lolunit_assert_doubles_equal(out[n * 2 + 1], 0.25f, 1e-6f);
+        }
+
+        /* The master gain applies to every voice */
+        mixer.set_master(0.f);
+        mixer.render(out, FRAMES);
+        mixer.render(out, FRAMES);
+        for (float x : out)
+            lolunit_assert_equal(x, 0.f);
+    }
+
+    lolunit_declare_test(clipping)
+    {
+        /* Integer outputs saturate instead of wrapping around */
+        audio_mixer mixer(audio::format::sint16le, 44100, 1, 64);
+        mixer.add_voice(constant(0.9f, 44100, 1));
+        mixer.add_voice(constant(0.9f, 44100, 1));
+        mixer.add_voice(constant(0.9f, 44100, 1));
+
+        int16_t out[FRAMES];
+        mixer.render(out, FRAMES);
+        mixer.render(out, FRAMES);
+        for (int16_t x : out)
+            lolunit_assert_equal(x, 32767);
+
+        audio_mixer negative(audio::format::uint8, 44100, 2, 64);
+        negative.add_voice(constant(-0.75f, 44100, 2));
+        negative.add_voice(constant(-0.75f, 44100, 2));
+
+        uint8_t out8[FRAMES * 2];
+        negative.render(out8, FRAMES);
+        negative.render(out8, FRAMES);
+        for (uint8_t x : out8)
+            lolunit_assert_equal(x, 0);
+    }
+
+    lolunit_declare_test(add_and_large_buffers)
+    {
+        /* Mixing on top of existing samples, more frames than the mixer’s
+         * buffer size at once */
+        audio_mixer mixer(float_format(), 44100, 2, 16);
+        mixer.add_voice(constant(0.25f, 44100, 2));
+        float out[FRAMES * 2];
+        mixer.render(out, FRAMES);
+
+        for (float &x : out)
+            x = -0.5f;
+        mixer.render(out, FRAMES, true);
+        for (float x : out)
+            lolunit_assert_doubles_equal(x, -0.25f, 1e-6f);
+    }
+
+    lolunit_declare_test(buffer_voice)
+    {
+        /* A buffer played once is marked done, then goes away */
+        audio_mixer mixer(float_format(), 44100, 1, 64);
+        float const data[] = { 0.5f, 0.5f, 0.5f, 0.5f, 0.5f };
+        auto voice = std::make_shared<audio_voice>(float_format(), 44100, 1);
+        voice->m_data = (uint8_t const *)data;
+        voice->m_data_bytes = sizeof(data);
+        mixer.add_voice(voice);
+
+        float out[FRAMES];
+        mixer.render(out, FRAMES);
+        lolunit_assert(voice->m_done);
+        lolunit_assert_equal(out[FRAMES - 1], 0.f);
+
+        mixer.add_voice(constant(0.f, 44100, 1));
+        lolunit_assert_equal((int)mixer.voices().size(), 1);
+    }
+};
+
+} /* namespace lol */
+
@@ -0,0 +1,118 @@
+//
+//  Lol Engine — Unit tests
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <cstdio>
+#include <string>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(file_test)
+{
+    std::string m_path, m_contents;
+
+    void setup()
+    {
+        m_path = "lol-test-file.tmp";
+        m_contents.clear();
+        for (int i = 0; i < 100000; ++i)
+            m_contents += (char)('a' + i * 7 % 26);
+
+        File f;
+        f.Open(m_path, FileAccess::Write, true);
+        f.Write(m_contents);
+        f.Close();
+    }
+
+    void teardown()
+    {
+        std::remove(m_path.c_str());
+    }
+
+    lolunit_declare_test(read_string)
+    {
+        File f;
+        f.Open(m_path, FileAccess::Read, true);
+        lolunit_assert(f.IsValid());
+        lolunit_assert_equal((int64_t)m_contents.length(), f.size());
+
+        f.SetPosFromStart(10);
+        lolunit_assert_equal(10, (int)f.GetPosFromStart());
+        std::string s = f.ReadString();
+        f.Close();
+
+        lolunit_assert(s == m_contents.substr(10));
+    }
+
+    lolunit_declare_test(map)
+    {
+        File f;
+        f.Open(m_path, FileAccess::Read, true);
+        span<uint8_t const> view = f.Map(FileHint::Random);
+
+        /* Mapping is optional, but it must be correct when available */
+        if (!view.empty())
+        {
+            lolunit_assert_equal(m_contents.length(), view.size());
+            lolunit_assert(std::string((char const *)view.data(), view.size())
+                            == m_contents);
+            lolunit_assert_equal(m_contents[12345], (char)view[12345]);
+        }
+        f.Close();
+    }
+
+    lolunit_declare_test(reader)
+    {
+        File f;
+        f.Open(m_path, FileAccess::Read, true);
+        f.SetPosFromStart(3);
+
+        std::string s;
+        FileReader reader(f, 1000);
+        for (auto chunk = reader.Next(); !chunk.empty(); chunk = reader.Next())
+        {
+            lolunit_assert(chunk.size() <= 1000 || s.empty());
+            s.append((char const *)chunk.data(), chunk.size());
+        }
+        f.Close();
+
+        lolunit_assert(s == m_contents.substr(3));
+    }
+
+    lolunit_declare_test(write_span)
+    {
+        /* Write the contents back in two pieces, then nothing */
+        File src, dst;
+        src.Open(m_path, FileAccess::Read, true);
+        std::string copy = src.ReadString();
+        src.Close();
+
+        span<uint8_t const> data((uint8_t const *)copy.data(), copy.length());
+        dst.Open(m_path, FileAccess::Write, true);
+        lolunit_assert_equal((int64_t)12345, dst.Write(data.subspan(0, 12345)));
+        lolunit_assert_equal((int64_t)(data.size() - 12345),
+                             dst.Write(data.subspan(12345)));
+        lolunit_assert_equal((int64_t)0, dst.Write(span<uint8_t const>()));
+        dst.Close();
+
+        src.Open(m_path, FileAccess::Read, true);
+        lolunit_assert(src.ReadString() == m_contents);
+        src.Close();
+    }
+};
+
+} /* namespace lol */
+
@@ -0,0 +1,252 @@
+//
+//  Lol Engine — Unit tests
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(pack_test)
+{
+    std::string m_path, m_text, m_noise;
+
+    void setup()
+    {
+        m_path = "lol-test-pack.tmp";
+
+        m_text.clear();
+        for (int i = 0; i < 5000; ++i)
+            m_text += "line " + std::to_string(i % 37) + " of some text\n";
+
+        m_noise.clear();
+        for (int i = 0; i < 3000; ++i)
+            m_noise += (char)rand<uint8_t>();
+
+        pack_writer writer(64);
+        writer.add("data/text.txt", view(m_text));
+        writer.add("data/noise.bin", view(m_noise));
+        writer.add("data/copy.txt", view(m_text));
+        writer.add("data/sub/stored.txt", view(m_text), false);
+        writer.add(".\\empty", view(""));
+        writer.save(m_path);
+        lolunit_assert_equal(5, writer.count());
+        lolunit_assert_equal(4, writer.blob_count());
+    }
+
+    void teardown()
+    {
+        sys::unmount_packs();
+        std::remove(m_path.c_str());
+    }
+
+    static span<uint8_t const> view(std::string const &s)
+    {
+        return span<uint8_t const>((uint8_t const *)s.data(), s.size());
+    }
+
+    static std::string str(span<uint8_t const> s)
+    {
+        return std::string((char const *)s.data(), s.size());
+    }
+
+    lolunit_declare_test(codec)
+    {
+        for (auto const &s : { m_text, m_noise, std::string("aaaaaaaaaaaaaaaaaaaaaaa"),
+                               std::string("ab"), std::string() })
+        {
+            array<uint8_t> packed = pack::lz_compress(view(s));
+            std::string out(s.size(), '\0');
+            span<uint8_t> dst((uint8_t *)&out[0], out.size());
+            lolunit_assert(pack::lz_decompress(span<uint8_t const>(packed.data(), packed.count()), dst));
+            lolunit_assert(out == s);
+        }
+
+        /* Text compresses well, and truncated data is rejected */
+        array<uint8_t> packed = pack::lz_compress(view(m_text));
+        lolunit_assert(packed.count() < (int)m_text.size() / 4);
+        std::string out(m_text.size(), '\0');
+        span<uint8_t> dst((uint8_t *)&out[0], out.size());
+        lolunit_assert(!pack::lz_decompress(span<uint8_t const>(packed.data(), packed.count() / 2), dst));
+    }
+
+    lolunit_declare_test(read)
+    {
+        pack p;
+        lolunit_assert(p.open(m_path));
+        lolunit_assert_equal(5, p.count());
+
+        lolunit_assert_equal(-1, p.find("data/missing.txt"));
+        int text = p.find("data/text.txt");
+        int noise = p.find("./data/noise.bin");
+        int stored = p.find("data\\sub\\stored.txt");
+        int empty = p.find("empty");
+        lolunit_assert(text >= 0 && noise >= 0 && stored >= 0 && empty >= 0);
+
+        lolunit_assert(p.codec(text) == pack_codec::lz);
+        lolunit_assert(p.codec(noise) == pack_codec::none);
+        lolunit_assert(p.codec(stored) == pack_codec::none);
+        lolunit_assert(p.name(stored) == "data/sub/stored.txt");
+        lolunit_assert_equal(m_text.size(), p.size(text));
+
+        array<uint8_t> buffer;
+        lolunit_assert(str(p.read(text, buffer)) == m_text);
+        lolunit_assert(str(p.read(p.find("data/copy.txt"), buffer)) == m_text);
+        lolunit_assert(str(p.read(noise, buffer)) == m_noise);
+        lolunit_assert(str(p.read(stored, buffer)) == m_text);
+        lolunit_assert(p.read(empty, buffer).empty());
+        p.close();
+    }
+
+    lolunit_declare_test(vfs)
+    {
+        lolunit_assert(sys::mount_pack(m_path));
+
+        File f;
+        f.Open("data/text.txt", FileAccess::Read, true);
+        lolunit_assert(f.IsValid());
+        lolunit_assert_equal((int64_t)m_text.size(), f.size());
+        lolunit_assert(str(f.Map()) == m_text);
+
+        f.SetPosFromStart(100);
+        uint8_t buf[10];
+        lolunit_assert_equal(10, (int)f.Read(buf, 10));
+        lolunit_assert(std::string((char const *)buf, 10) == m_text.substr(100, 10));
+        lolunit_assert(f.ReadString() == m_text.substr(110));
+        lolunit_assert_equal(-1, (int)f.Read(buf, 10));
+        f.Close();
+
+        /* Names found in packs are not looked up in the data directories */
+        array<std::string> paths = sys::get_path_list("data/noise.bin");
+        lolunit_assert_equal(1, paths.count());
+        lolunit_assert(paths[0] == "data/noise.bin");
+
+        array<std::string> files;
+        array<Directory> dirs;
+        Directory d("data");
+        lolunit_assert(d.IsValid());
+        d.GetContent(files, dirs);
+        lolunit_assert_equal(3, files.count());
+        lolunit_assert_equal(1, dirs.count());
+        lolunit_assert(dirs[0].GetName() == "data/sub/");
+
+        sys::unmount_packs();
+        f.Open("data/text.txt", FileAccess::Read, true);
+        lolunit_assert(!f.IsValid());
+    }
+
+    lolunit_declare_test(vfs_overlay)
+    {
+        /* Names found in several packs are only listed once */
+        std::string other = m_path + ".2";
+        pack_writer writer;
+        writer.add("data/text.txt", view(m_noise));
+        writer.add("data/sub/more.txt", view(m_noise));
+        writer.add("data/other.txt", view(m_noise));
+        writer.save(other);
+
+        lolunit_assert(sys::mount_pack(m_path));
+        lolunit_assert(sys::mount_pack(other));
+
+        array<std::string> files, dirs;
+        lolunit_assert(sys::vfs_list("data", &files, &dirs));
+        lolunit_assert_equal(4, files.count());
+        lolunit_assert_equal(1, dirs.count());
+
+        /* The pack mounted last wins */
+        File f;
+        f.Open("data/text.txt", FileAccess::Read, true);
+        lolunit_assert(f.ReadString() == m_noise);
+        f.Close();
+
+        sys::unmount_packs();
+        std::remove(other.c_str());
+    }
+
+    /* Save the one-entry pack contents, altered by a patch, and try it */
+    template<typename F>
+    bool try_corrupt(std::string const &contents, F patch)
+    {
+        std::string bad = contents;
+        patch(&bad[0]);
+
+        File f;
+        f.Open(m_path, FileAccess::Write, true);
+        f.Write(bad);
+        f.Close();
+
+        pack p;
+        return p.open(m_path);
+    }
+
+    lolunit_declare_test(corrupt)
+    {
+        /* One compressed entry, at offset 64 after the 32-byte header */
+        pack_writer writer(64);
+        writer.add("text.txt", view(m_text));
+        writer.save(m_path);
+
+        File f;
+        f.Open(m_path, FileAccess::Read, true);
+        std::string contents = f.ReadString();
+        f.Close();
+
+        uint64_t names_offset;
+        memcpy(&names_offset, &contents[24], sizeof(names_offset));
+        uint64_t index_offset = names_offset - 32;
+        lolunit_assert(try_corrupt(contents, [](char *) {}));
+
+        /* An index size that wraps around cannot point outside the file */
+        lolunit_assert(!try_corrupt(contents, [&](char *data)
+        {
+            uint32_t count = 0x08000000;
+            uint64_t offset = names_offset - ((uint64_t)count << 5);
+            memcpy(data + 8, &count, sizeof(count));
+            memcpy(data + 16, &offset, sizeof(offset));
+        }));
+
+        /* Neither can entries */
+        lolunit_assert(!try_corrupt(contents, [&](char *data)
+        {
+            uint64_t offset = contents.size() + 64;
+            memcpy(data + index_offset + 8, &offset, sizeof(offset));
+        }));
+        lolunit_assert(!try_corrupt(contents, [&](char *data)
+        {
+            uint32_t stored_size = 0xffffff00;
+            memcpy(data + index_offset + 16, &stored_size, sizeof(stored_size));
+        }));
+        lolunit_assert(!try_corrupt(contents, [&](char *data)
+        {
+            uint64_t offset = 0;
+            memcpy(data + index_offset + 8, &offset, sizeof(offset));
+        }));
+
+        /* Damaged data is only found when reading, and the file is then
+         * invalid rather than empty */
+        lolunit_assert(try_corrupt(contents, [](char *data)
+        {
+            memset(data + 64, 0xff, 32);
+        }));
+        lolunit_assert(sys::mount_pack(m_path));
+        f.Open("text.txt", FileAccess::Read, true);
+        lolunit_assert(!f.IsValid());
+    }
+};
+
+} /* namespace lol */
+
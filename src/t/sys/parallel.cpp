@@ -0,0 +1,134 @@
+//
+//  Lol Engine — Unit tests for the parallel algorithms
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(parallel_test)
+{
+    lolunit_declare_test(pool)
+    {
+        thread_pool pool(4);
+        lolunit_assert_equal(4, pool.size());
+
+        array<int> hits;
+        hits.resize(1000, 0);
+        pool.run(hits.count(), [&](int n) { hits[n]++; });
+        for (int x : hits)
+            lolunit_assert_equal(1, x);
+
+        /* Nested jobs run serially in the calling task */
+        std::atomic<int> total(0);
+        pool.run(8, [&](int)
+        {
+            pool.run(8, [&](int) { ++total; });
+        });
+        lolunit_assert_equal(64, (int)total);
+
+        pool.set_max_threads(1);
+        lolunit_assert_equal(1, pool.size());
+    }
+
+    lolunit_declare_test(for_tiles)
+    {
+        array2d<int> a(ivec2(100, 70), 0);
+        parallel_for(a, ivec2(16, 16), [&](ivec2 lo, ivec2 hi)
+        {
+            for (int y = lo.y; y < hi.y; ++y)
+                for (int x = lo.x; x < hi.x; ++x)
+                    a[x][y] += x + y;
+        });
+
+        for (int y = 0; y < 70; ++y)
+            for (int x = 0; x < 100; ++x)
+                lolunit_assert_equal(x + y, a[x][y]);
+
+        std::atomic<int> cells(0);
+        parallel_for(ivec3(9, 10, 11), ivec3(4), [&](ivec3 lo, ivec3 hi)
+        {
+            ivec3 d = hi - lo;
+            cells += d.x * d.y * d.z;
+        });
+        lolunit_assert_equal(9 * 10 * 11, (int)cells);
+    }
+
+    lolunit_declare_test(reduce)
+    {
+        int64_t sum = parallel_reduce(100000, (int64_t)0,
+                                      [](ptrdiff_t i) { return (int64_t)i; },
+                                      [](int64_t a, int64_t b) { return a + b; });
+        lolunit_assert_equal((int64_t)100000 * 99999 / 2, sum);
+
+        /* In deterministic mode, the thread count does not matter */
+        thread_pool &pool = thread_pool::shared();
+        pool.set_deterministic(true);
+        auto f = [](ptrdiff_t i) { return 1.f / (float)(i + 1); };
+        auto add = [](float a, float b) { return a + b; };
+        pool.set_max_threads(1);
+        float s1 = parallel_reduce(100000, 0.f, f, add);
+        pool.set_max_threads(0);
+        float s2 = parallel_reduce(100000, 0.f, f, add);
+        pool.set_deterministic(false);
+        lolunit_assert_equal(s1, s2);
+    }
+
+    lolunit_declare_test(scan)
+    {
+        array<int> in, out;
+        for (int i = 0; i < 1001; ++i)
+            in << i % 7;
+
+        auto add = [](int a, int b) { return a + b; };
+        parallel_inclusive_scan(in, out, add, 10);
+        int acc = 0;
+        for (int i = 0; i < in.count(); ++i)
+            lolunit_assert_equal(acc += in[i], out[i]);
+
+        parallel_exclusive_scan(in, out, 5, add, 64);
+        acc = 5;
+        for (int i = 0; i < in.count(); ++i)
+        {
+            lolunit_assert_equal(acc, out[i]);
+            acc += in[i];
+        }
+    }
+
+    lolunit_declare_test(sort)
+    {
+        array<ivec2> a;
+        for (int i = 0; i < 5000; ++i)
+            a << ivec2(rand(100), i);
+
+        /* Only sort on x, so that stability can be checked on y */
+        parallel_sort(a, [](ivec2 u, ivec2 v) { return u.x < v.x; }, 300);
+        for (int i = 1; i < a.count(); ++i)
+        {
+            lolunit_assert(a[i - 1].x <= a[i].x);
+            if (a[i - 1].x == a[i].x)
+                lolunit_assert(a[i - 1].y < a[i].y);
+        }
+
+        array<float> b, c;
+        for (int i = 0; i < 1000; ++i)
+            b << (float)i;
+        parallel_transform(b, c, [](float x) { return x * 2.f; });
+        lolunit_assert_equal(1000, c.count());
+        lolunit_assert_equal(1998.f, c.last());
+    }
+};
+
+} /* namespace lol */
+
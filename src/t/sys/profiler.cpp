@@ -0,0 +1,48 @@
+//
+//  Lol Engine — Unit tests
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <lolunit.h>
+
+namespace lol
+{
+
+lolunit_declare_fixture(profiler_test)
+{
+    lolunit_declare_test(statistics)
+    {
+        int const id = Profiler::STAT_USER_09;
+        Profiler::Reset(id);
+        lolunit_assert_equal(Profiler::GetPercentile(id, 0.5f), 0.f);
+        lolunit_assert_equal(Profiler::GetJitter(id), 0.f);
+
+        /* Samples of 1, 2, …, 10 ms */
+        for (int i = 1; i <= 10; ++i)
+        {
+            timer t;
+            Profiler::Start(id);
+            t.wait(i * 1e-3f);
+            Profiler::Stop(id);
+        }
+
+        lolunit_assert_doubles_equal(Profiler::GetAvg(id), 5.5e-3f, 5e-4f);
+        lolunit_assert_doubles_equal(Profiler::GetMax(id), 10e-3f, 5e-4f);
+        lolunit_assert_doubles_equal(Profiler::GetPercentile(id, 0.5f), 5e-3f, 5e-4f);
+        lolunit_assert_doubles_equal(Profiler::GetPercentile(id, 0.99f), 10e-3f, 5e-4f);
+        lolunit_assert_doubles_equal(Profiler::GetPercentile(id, 0.f), 1e-3f, 5e-4f);
+        lolunit_assert_doubles_equal(Profiler::GetJitter(id), 1e-3f, 5e-4f);
+    }
+};
+
+} /* namespace lol */
+
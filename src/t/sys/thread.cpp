@@ -57,6 +57,64 @@ lolunit_declare_fixture(thread_test)
         lolunit_assert_equal(false, b2);
         lolunit_assert_equal(42, tmp);
     }
+
+    lolunit_declare_test(spsc_queue_wrap)
+    {
+        spsc_queue<int> q(5);
+        int in[] = { 1, 2, 3, 4, 5, 6 }, out[6];
+
+        lolunit_assert_equal(5, (int)q.push(in, 6));
+        lolunit_assert_equal(5, (int)q.size());
+        lolunit_assert_equal(3, (int)q.pop(out, 3));
+        lolunit_assert_equal(3, out[2]);
+
+        /* These wrap around the end of the storage */
+        lolunit_assert_equal(3, (int)q.push(in, 6));
+        lolunit_assert_equal(5, (int)q.pop(out, 6));
+        lolunit_assert_equal(4, out[0]);
+        lolunit_assert_equal(5, out[1]);
+        lolunit_assert_equal(1, out[2]);
+        lolunit_assert_equal(3, out[4]);
+        lolunit_assert_equal(0, (int)q.size());
+    }
+
+#if LOL_FEATURE_THREADS
+    lolunit_declare_test(spsc_queue_threads)
+    {
+        int const count = 100000;
+        spsc_queue<int> q(17);
+        bool ordered = true;
+
+        {
+            thread consumer([&](thread *)
+            {
+                for (int expected = 0; expected < count; )
+                {
+                    int buf[7];
+                    size_t n = q.pop(buf, 7);
+                    for (size_t i = 0; i < n; ++i)
+                        ordered &= buf[i] == expected++;
+                    if (!n)
+                        std::this_thread::yield();
+                }
+            });
+
+            for (int sent = 0; sent < count; )
+            {
+                int buf[5];
+                for (int i = 0; i < 5; ++i)
+                    buf[i] = sent + i;
+                size_t n = q.push(buf, lol::min(5, count - sent));
+                sent += (int)n;
+                if (!n)
+                    std::this_thread::yield();
+            }
+        }
+
+        lolunit_assert(ordered);
+        lolunit_assert_equal(0, (int)q.size());
+    }
+#endif
 };
 
 } /* namespace lol */
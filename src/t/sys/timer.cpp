@@ -44,6 +44,25 @@ lolunit_declare_fixture(timer_test)
         t1.wait(1.5);
         lolunit_assert_doubles_equal(3.0, t0.get(), 1e-3);
     }
+
+    lolunit_declare_test(short_waits)
+    {
+        /* Frame-sized waits must not return early. The OS may wake us up
+         * late, especially on a loaded machine, so lateness is only
+         * checked loosely. */
+        array<float> lates;
+        for (int i = 0; i < 51; ++i)
+        {
+            timer t;
+            t.wait(2e-3f);
+            float late = t.get() - 2e-3f;
+            lolunit_assert(late >= 0.f);
+            lates << late;
+        }
+
+        lates.sort(SortAlgorithm::QuickSwap);
+        lolunit_assert(lates[25] < 1e-3f);
+    }
 };
 
 }
\ No newline at end of file
@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include <memory>
+
 //
 // The TileSet class
 // -----------------
@@ -36,6 +38,24 @@ public:
 
     Image *m_image = nullptr;
     Texture *m_texture = nullptr;
+
+    /* Region of m_image that changed, and a counter of new images so
+     * that a stale upload is never swapped in */
+    ibox2 m_dirty;
+    int m_generation = 0;
+
+    /* Upload settings */
+    bool m_mipmaps = false, m_compress = false;
+    MipmapFilter m_mipmap_filter = MipmapFilter::Box;
+    CompressedFormat m_compression = CompressedFormat::BC1;
+
+    /* Size and pixel format of m_texture, to know whether it can be
+     * updated in place */
+    ivec2 m_live_size = ivec2(0);
+    PixelFormat m_live_format = PixelFormat::Unknown;
+
+    /* The texture being prepared and uploaded, if any */
+    std::shared_ptr<class texture_stream> m_stream;
 };
 
 } /* namespace lol */
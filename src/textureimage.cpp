@@ -12,9 +12,14 @@
 
 #include <lol/engine-internal.h>
 
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
+#if LOL_FEATURE_THREADS
+#   include <thread>
+#endif
 
 #if defined _WIN32
 #   define WIN32_LEAN_AND_MEAN
@@ -28,7 +33,294 @@ namespace lol
 {
 
 /*
- * TileSet implementation class
+ * Upload budget shared by all texture images, reset every frame
+ */
+
+static struct upload_budget
+{
+    /* Whether bytes can be uploaded now; the first slice of each frame
+     * always can, so that large slices still make progress */
+    bool allow(int64_t bytes)
+    {
+        if (ticker::GetFrameNum() != m_frame)
+        {
+            m_frame = ticker::GetFrameNum();
+            m_spent = 0;
+        }
+        return m_limit <= 0 || !m_spent || m_spent + bytes <= m_limit;
+    }
+
+    /* How many rows of a given pitch can be uploaded now */
+    int rows(int pitch, int wanted)
+    {
+        if (!allow(pitch))
+            return 0;
+        if (m_limit <= 0)
+            return wanted;
+        int64_t left = lol::max(m_limit - m_spent, (int64_t)pitch);
+        return (int)lol::min((int64_t)wanted, left / pitch);
+    }
+
+    void spend(int64_t bytes) { m_spent += bytes; }
+
+    int64_t m_limit = 4 << 20;
+    int64_t m_spent = 0;
+    int m_frame = -1;
+}
+g_upload_budget;
+
+/*
+ * A texture being prepared and uploaded. The levels are computed by
+ * prepare(), usually on a worker thread, then upload() sends them from
+ * the draw thread a few rows at a time, into a new texture that is only
+ * used once complete.
+ */
+
+class texture_stream
+{
+public:
+    ~texture_stream()
+    {
+        delete m_image;
+    }
+
+    void prepare()
+    {
+        int count = 1;
+        if (m_mipmaps)
+            while ((m_texture_size.x >> count) || (m_texture_size.y >> count))
+                ++count;
+        m_levels.resize(count);
+
+        image mip;
+        for (int n = 0; n < count; ++n)
+        {
+            if (n)
+                mip = (n == 1 ? *m_image : mip).mipmap(m_filter);
+            image &src = n ? mip : *m_image;
+            level &l = m_levels[n];
+
+            if (m_compress)
+            {
+                /* Compressed levels are sent whole, so fill the power of
+                 * two level by repeating the last row and column */
+                ivec2 size(lol::max(1, m_texture_size.x >> n),
+                           lol::max(1, m_texture_size.y >> n));
+                image padded(size);
+                u8vec4 const *sp = src.lock<PixelFormat::RGBA_8>();
+                u8vec4 *dp = padded.lock<PixelFormat::RGBA_8>();
+                ivec2 isize = src.size();
+                for (int y = 0; y < size.y; ++y)
+                    for (int x = 0; x < size.x; ++x)
+                        dp[y * size.x + x] = sp[lol::min(y, isize.y - 1) * isize.x
+                                                 + lol::min(x, isize.x - 1)];
+                padded.unlock(dp);
+                src.unlock(sp);
+
+                l.size = size;
+                l.data = padded.compress(m_compression);
+                l.pixels = l.data.data();
+                continue;
+            }
+
+            /* Rows must start on 4-byte boundaries for the default GL
+             * unpack alignment */
+            int bpp = BytesPerPixel(m_format);
+            l.size = src.size();
+            l.pitch = (l.size.x * bpp + 3) & ~3;
+            uint8_t const *pixels = (uint8_t const *)src.lock();
+            if (n == 0 && l.pitch == l.size.x * bpp)
+            {
+                l.pixels = pixels;
+            }
+            else
+            {
+                l.data.resize(l.pitch * l.size.y);
+                for (int y = 0; y < l.size.y; ++y)
+                    memcpy(l.data.data() + y * l.pitch,
+                           pixels + y * l.size.x * bpp, l.size.x * bpp);
+                l.pixels = l.data.data();
+            }
+            src.unlock(pixels);
+        }
+
+        m_ready = true;
+    }
+
+    /* Upload what the budget allows, and return true when done */
+    bool upload()
+    {
+        if (!m_texture)
+        {
+            if (m_compress)
+                m_texture = new Texture(m_texture_size, m_compression);
+            else
+                m_texture = new Texture(m_texture_size, m_format);
+            if (m_levels.count() > 1)
+                m_texture->SetMinFiltering(TextureMinFilter::LINEAR_TEXEL_LINEAR_MIPMAP);
+        }
+
+        m_texture->Bind();
+        while (m_level < m_levels.count())
+        {
+            level const &l = m_levels[m_level];
+
+            if (m_compress)
+            {
+                if (!g_upload_budget.allow(l.data.count()))
+                    return false;
+                m_texture->SetCompressedData(span<uint8_t const>(l.data.data(),
+                                                                 l.data.count()), m_level);
+                g_upload_budget.spend(l.data.count());
+                ++m_level;
+                continue;
+            }
+
+            int rows = g_upload_budget.rows(l.pitch, l.size.y - m_row);
+            if (!rows)
+                return false;
+
+            if (m_row == 0)
+                m_texture->SetData(nullptr, m_level);
+            m_texture->SetSubData(ivec2(0, m_row), ivec2(l.size.x, rows),
+                                  l.pixels + m_row * l.pitch, m_level);
+            g_upload_budget.spend(rows * l.pitch);
+
+            m_row += rows;
+            if (m_row == l.size.y)
+            {
+                ++m_level;
+                m_row = 0;
+            }
+        }
+
+        return true;
+    }
+
+    /* Called from the draw thread when the upload is abandoned */
+    void cancel()
+    {
+        delete m_texture;
+        m_texture = nullptr;
+    }
+
+    /* Free the prepared levels once uploaded */
+    void release()
+    {
+        m_levels.clear();
+        delete m_image;
+        m_image = nullptr;
+    }
+
+    struct level
+    {
+        ivec2 size;
+        int pitch = 0;
+        array<uint8_t> data;
+        uint8_t const *pixels = nullptr;
+    };
+
+    /* Set before prepare() */
+    image *m_image = nullptr;
+    int m_generation = 0;
+    ivec2 m_texture_size;
+    PixelFormat m_format;
+    bool m_mipmaps, m_compress;
+    MipmapFilter m_filter;
+    CompressedFormat m_compression;
+
+    /* Set by prepare() */
+    array<level> m_levels;
+    std::atomic<bool> m_ready { false };
+
+    /* Upload progress */
+    Texture *m_texture = nullptr;
+    int m_level = 0, m_row = 0;
+};
+
+/*
+ * Worker threads for texture preparation; when they are busy, or when
+ * there are no threads, the draw thread does the work.
+ */
+
+static class texture_workers
+{
+public:
+    ~texture_workers()
+    {
+#if LOL_FEATURE_THREADS
+        for (int n = 0; n < m_threads.count(); ++n)
+            m_jobs.push(nullptr);
+        for (thread *t : m_threads)
+            delete t; // This joins the thread
+#endif
+    }
+
+    void push(std::shared_ptr<texture_stream> const &stream)
+    {
+#if LOL_FEATURE_THREADS
+        if (!m_threads.count())
+        {
+            int jobs = clamp((int)std::thread::hardware_concurrency() - 2, 1, 4);
+            for (int n = 0; n < jobs; ++n)
+                m_threads.push(new thread([this](thread *)
+                {
+                    for (auto s = m_jobs.pop(); s; s = m_jobs.pop())
+                        s->prepare();
+                }));
+        }
+
+        if (m_jobs.try_push(stream))
+            return;
+#endif
+        stream->prepare();
+    }
+
+private:
+#if LOL_FEATURE_THREADS
+    queue<std::shared_ptr<texture_stream>, 64> m_jobs;
+    array<thread *> m_threads;
+#endif
+}
+g_texture_workers;
+
+/* Upload a rectangle of an image to an existing texture */
+static void update_rect(Texture *texture, image *img, ibox2 rect)
+{
+    ivec2 const size = img->size();
+    rect = ibox2(lol::max(rect.aa, ivec2(0)), lol::min(rect.bb, size));
+    ivec2 const extent = rect.bb - rect.aa;
+    if (extent.x <= 0 || extent.y <= 0)
+        return;
+
+    int const bpp = BytesPerPixel(img->format());
+    int const pitch = size.x * bpp;
+    uint8_t const *pixels = (uint8_t const *)img->lock();
+
+    texture->Bind();
+    if (extent.x == size.x && pitch % 4 == 0)
+    {
+        texture->SetSubData(ivec2(0, rect.aa.y), extent,
+                            pixels + rect.aa.y * pitch);
+        g_upload_budget.spend(extent.y * pitch);
+    }
+    else
+    {
+        int const row = (extent.x * bpp + 3) & ~3;
+        array<uint8_t> tmp;
+        tmp.resize(row * extent.y);
+        for (int y = 0; y < extent.y; ++y)
+            memcpy(tmp.data() + y * row,
+                   pixels + (rect.aa.y + y) * pitch + rect.aa.x * bpp, extent.x * bpp);
+        texture->SetSubData(rect.aa, extent, tmp.data());
+        g_upload_budget.spend(tmp.count());
+    }
+
+    img->unlock(pixels);
+}
+
+/*
+ * TextureImage implementation class
  */
 
 TextureImageData* TextureImage::GetNewData()
@@ -80,6 +372,7 @@ void TextureImage::Init(std::string const &path, image* img)
 
     m_data->m_texture = nullptr;
     m_data->m_image = img;
+    m_data->m_dirty = ibox2(ivec2(0), img->size());
     m_data->m_image_size = m_data->m_image->size();
     m_data->m_texture_size = ivec2(PotUp(m_data->m_image_size.x),
                                    PotUp(m_data->m_image_size.y));
@@ -91,55 +384,70 @@ void TextureImage::tick_draw(float seconds, Scene &scene)
 {
     super::tick_draw(seconds, scene);
 
-    if (has_flags(entity::flags::destroying))
+    /* Forget about uploads made obsolete by a newer image */
+    auto &stream = m_data->m_stream;
+    if (stream && (stream->m_generation != m_data->m_generation
+                    || has_flags(entity::flags::destroying)))
     {
-        if (m_data->m_image)
-        {
-            delete m_data->m_image;
-            m_data->m_image = nullptr;
-        }
-        else
-        {
-            delete m_data->m_texture;
-            m_data->m_texture = nullptr;
-        }
+        stream->cancel();
+        stream.reset();
     }
-    else if (m_data->m_image)
+
+    if (has_flags(entity::flags::destroying))
     {
-        //Update texture is needed
-        if (m_data->m_texture)
-        {
-            delete m_data->m_texture;
-            m_data->m_texture = nullptr;
-        }
+        delete m_data->m_image;
+        m_data->m_image = nullptr;
+        delete m_data->m_texture;
+        m_data->m_texture = nullptr;
+        return;
+    }
 
-        PixelFormat format = m_data->m_image->format();
-        int planes = BytesPerPixel(format);
+    if (m_data->m_image)
+    {
+        image *img = m_data->m_image;
+        m_data->m_image = nullptr;
 
-        int w = m_data->m_texture_size.x;
-        int h = m_data->m_texture_size.y;
+        bool compress = m_data->m_compress
+                         && Texture::IsSupported(m_data->m_compression);
 
-        uint8_t *pixels = (uint8_t *)m_data->m_image->lock();
-        bool resized = false;
-        if (w != m_data->m_image_size.x || h != m_data->m_image_size.y)
+        if (m_data->m_texture && !stream && !m_data->m_mipmaps && !compress
+             && m_data->m_live_size == m_data->m_texture_size
+             && m_data->m_live_format == img->format())
         {
-            uint8_t *tmp = new uint8_t[planes * w * h];
-            for (int line = 0; line < m_data->m_image_size.y; line++)
-                memcpy(tmp + planes * w * line,
-                       pixels + planes * m_data->m_image_size.x * line,
-                       planes * m_data->m_image_size.x);
-            pixels = tmp;
-            resized = false;
+            /* Same size and format: only upload what changed */
+            update_rect(m_data->m_texture, img, m_data->m_dirty);
+            delete img;
         }
-        /* FIXME: no unlock? */
-
-        m_data->m_texture = new Texture(ivec2(w, h), format);
-        m_data->m_texture->SetData(pixels);
+        else
+        {
+            stream = std::make_shared<texture_stream>();
+            stream->m_image = img;
+            stream->m_generation = m_data->m_generation;
+            stream->m_texture_size = m_data->m_texture_size;
+            stream->m_format = img->format();
+            stream->m_mipmaps = m_data->m_mipmaps;
+            stream->m_filter = m_data->m_mipmap_filter;
+            stream->m_compress = compress;
+            stream->m_compression = m_data->m_compression;
+
+            /* Plain textures only need a repack, if anything */
+            if (stream->m_mipmaps || stream->m_compress)
+                g_texture_workers.push(stream);
+            else
+                stream->prepare();
+        }
+    }
 
-        if (resized)
-            delete[] pixels;
-        delete m_data->m_image;
-        m_data->m_image = nullptr;
+    if (stream && stream->m_ready && stream->upload())
+    {
+        delete m_data->m_texture;
+        m_data->m_texture = stream->m_texture;
+        m_data->m_live_size = stream->m_texture_size;
+        m_data->m_live_format = stream->m_compress ? PixelFormat::Unknown
+                                                   : stream->m_format;
+        stream->m_texture = nullptr;
+        stream->release();
+        stream.reset();
     }
 }
 
@@ -151,12 +459,45 @@ std::string TextureImage::GetName() const
 
 void TextureImage::UpdateTexture(image* img)
 {
+    UpdateTexture(img, ibox2(ivec2(0), img->size()));
+}
+
+void TextureImage::UpdateTexture(image* img, ibox2 dirty)
+{
+    /* An image that was never uploaded is replaced, so merge its
+     * changes with the new ones */
+    if (m_data->m_image && m_data->m_image != img)
+    {
+        delete m_data->m_image;
+        dirty = ibox2(lol::min(dirty.aa, m_data->m_dirty.aa),
+                      lol::max(dirty.bb, m_data->m_dirty.bb));
+    }
+
     m_data->m_image = img;
+    m_data->m_dirty = dirty;
+    ++m_data->m_generation;
     m_data->m_image_size = m_data->m_image->size();
     m_data->m_texture_size = ivec2(PotUp(m_data->m_image_size.x),
                                    PotUp(m_data->m_image_size.y));
 }
 
+void TextureImage::SetMipmaps(bool enable, MipmapFilter filter)
+{
+    m_data->m_mipmaps = enable;
+    m_data->m_mipmap_filter = filter;
+}
+
+void TextureImage::SetCompression(bool enable, CompressedFormat format)
+{
+    m_data->m_compress = enable;
+    m_data->m_compression = format;
+}
+
+void TextureImage::SetUploadBudget(int bytes)
+{
+    g_upload_budget.m_limit = bytes;
+}
+
 Texture * TextureImage::GetTexture()
 {
     return m_data->m_texture;
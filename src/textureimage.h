@@ -57,6 +57,20 @@ public:
     virtual std::string GetName() const;
 
     void UpdateTexture(image* img);
+    /* If the size and format did not change, only upload the pixels
+     * inside dirty */
+    void UpdateTexture(image* img, ibox2 dirty);
+
+    /* Settings for the next images: mipmaps and block compression are
+     * prepared on worker threads, then streamed in while the previous
+     * texture stays in use */
+    void SetMipmaps(bool enable, MipmapFilter filter = MipmapFilter::Box);
+    void SetCompression(bool enable, CompressedFormat format = CompressedFormat::BC1);
+
+    /* Maximum bytes uploaded per frame by all texture images, or 0 for
+     * no limit; at least one slice is uploaded every frame */
+    static void SetUploadBudget(int bytes);
+
     Texture * GetTexture();
     Texture const * GetTexture() const;
     image * GetImage();
@@ -13,6 +13,8 @@
 #include <lol/engine-internal.h>
 
 #include <map>
+#include <vector>
+#include <climits>
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
@@ -38,13 +40,218 @@ static entity_dict<TileSet> tileset_cache;
 class TileSetData
 {
     friend class TileSet;
+    friend class TileSetAtlas;
 
 protected:
     /* Pixels, then texture coordinates */
     array<ibox2, box2> m_tiles;
     ivec2 m_tile_size;
+
+    /* Position in the atlas, if the tileset is in there */
+    int m_atlas_handle = -1;
+    ivec2 m_atlas_origin = ivec2(0);
+    bool m_no_atlas = false;
+    bool m_distance_field = false;
+};
+
+/*
+ * The texture atlas shared by tilesets. It is only used from the draw
+ * tick, where textures are uploaded.
+ */
+
+static int const ATLAS_PAGE_SIZE = 2048;
+static float const ATLAS_MAX_WASTE = 0.5f;
+
+class TileSetAtlas
+{
+public:
+    TileSetAtlas()
+      : m_atlas(ivec2(ATLAS_PAGE_SIZE))
+    {}
+
+    /* Copy the image of a tileset into a page, if it is suitable */
+    bool add(TileSet *tileset, image *img)
+    {
+        ivec2 size = img->size();
+        if (!m_enabled || img->format() != PixelFormat::RGBA_8
+             || size.x > ATLAS_PAGE_SIZE / 2 || size.y > ATLAS_PAGE_SIZE / 2)
+            return false;
+
+        int handle = m_atlas.add(size);
+        if (handle < 0)
+            return false;
+
+        m_owners[handle] = tileset;
+        tileset->m_tileset_data->m_atlas_handle = handle;
+
+        u8vec4 *pixels = img->lock<PixelFormat::RGBA_8>();
+        blit(handle, pixels, size.x);
+        img->unlock(pixels);
+
+        flush();
+        relocate(handle);
+        return true;
+    }
+
+    void remove(TileSet *tileset)
+    {
+        int handle = tileset->m_tileset_data->m_atlas_handle;
+        tileset->m_tileset_data->m_atlas_handle = -1;
+        blit(handle, nullptr, 0);
+        m_atlas.remove(handle);
+        m_owners.erase(handle);
+
+        defragment();
+        flush();
+    }
+
+    /* Take a tileset out of the atlas and return a copy of its image */
+    image *extract(TileSet *tileset)
+    {
+        int handle = tileset->m_tileset_data->m_atlas_handle;
+        ivec2 size = m_atlas.size(handle), origin = m_atlas.origin(handle);
+        u8vec4 const *src = m_pages[m_atlas.page(handle)].pixels.data()
+                          + origin.y * ATLAS_PAGE_SIZE + origin.x;
+
+        image *ret = new image(size);
+        u8vec4 *pixels = ret->lock<PixelFormat::RGBA_8>();
+        for (int y = 0; y < size.y; ++y)
+            memcpy((void *)(pixels + y * size.x),
+                   src + y * ATLAS_PAGE_SIZE, size.x * sizeof(u8vec4));
+        ret->unlock(pixels);
+
+        remove(tileset);
+        return ret;
+    }
+
+    bool m_enabled = true;
+    atlas m_atlas;
+
+private:
+    /* Copy pixels into an allocation, or clear it if pixels is null. The
+     * edge pixels are repeated into the padding, so that linear filtering
+     * at the tileset borders does not bleed from the neighbours. */
+    void blit(int handle, u8vec4 const *pixels, int pitch)
+    {
+        int page = m_atlas.page(handle);
+        if ((int)m_pages.size() <= page)
+            m_pages.resize(page + 1);
+
+        atlas_page &p = m_pages[page];
+        if (!p.pixels.count())
+            p.pixels.resize(ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE, u8vec4(0));
+
+        int const pad = m_atlas.padding();
+        ivec2 size = m_atlas.size(handle), origin = m_atlas.origin(handle);
+        for (int y = -pad; y < size.y + pad; ++y)
+        {
+            u8vec4 *dst = p.pixels.data() + (origin.y + y) * ATLAS_PAGE_SIZE
+                        + origin.x - pad;
+            if (!pixels)
+            {
+                memset((void *)dst, 0, (size.x + 2 * pad) * sizeof(u8vec4));
+                continue;
+            }
+
+            u8vec4 const *src = pixels + lol::clamp(y, 0, size.y - 1) * pitch;
+            memcpy((void *)(dst + pad), src, size.x * sizeof(u8vec4));
+            for (int x = 0; x < pad; ++x)
+            {
+                dst[x] = src[0];
+                dst[pad + size.x + x] = src[size.x - 1];
+            }
+        }
+
+        p.dirty_min = lol::min(p.dirty_min, origin.y - pad);
+        p.dirty_max = lol::max(p.dirty_max, origin.y + size.y + pad);
+    }
+
+    /* Repack the pages that have too much unused space */
+    void defragment()
+    {
+        std::map<int, array<u8vec4>> old_pages;
+        for (int i = 0; i < m_atlas.page_count(); ++i)
+            if (m_atlas.waste(i) > ATLAS_MAX_WASTE)
+                old_pages[i] = m_pages[i].pixels;
+        if (old_pages.empty())
+            return;
+
+        std::map<int, ivec3> old_places;
+        for (auto const &kv : m_owners)
+        {
+            int page = m_atlas.page(kv.first);
+            if (old_pages.count(page))
+                old_places[kv.first] = ivec3(m_atlas.origin(kv.first), page);
+        }
+
+        m_atlas.defragment(ATLAS_MAX_WASTE);
+
+        for (auto &kv : old_pages)
+        {
+            memset((void *)m_pages[kv.first].pixels.data(), 0,
+                   m_pages[kv.first].pixels.bytes());
+            m_pages[kv.first].dirty_min = 0;
+            m_pages[kv.first].dirty_max = ATLAS_PAGE_SIZE;
+        }
+
+        for (auto const &kv : old_places)
+        {
+            ivec2 origin = kv.second.xy;
+            u8vec4 const *src = old_pages[kv.second.z].data()
+                              + origin.y * ATLAS_PAGE_SIZE + origin.x;
+            blit(kv.first, src, ATLAS_PAGE_SIZE);
+        }
+
+        flush();
+        for (auto const &kv : old_places)
+            relocate(kv.first);
+    }
+
+    /* Upload the modified rows of each page */
+    void flush()
+    {
+        for (auto &p : m_pages)
+        {
+            if (p.dirty_min >= p.dirty_max)
+                continue;
+
+            if (!p.texture)
+            {
+                p.texture = new Texture(ivec2(ATLAS_PAGE_SIZE), PixelFormat::RGBA_8);
+                p.texture->SetData(p.pixels.data());
+            }
+            else
+            {
+                p.texture->Bind();
+                p.texture->SetSubData(ivec2(0, p.dirty_min),
+                                      ivec2(ATLAS_PAGE_SIZE, p.dirty_max - p.dirty_min),
+                                      p.pixels.data() + p.dirty_min * ATLAS_PAGE_SIZE);
+            }
+
+            p.dirty_min = INT_MAX;
+            p.dirty_max = 0;
+        }
+    }
+
+    void relocate(int handle)
+    {
+        m_owners[handle]->relocate(m_pages[m_atlas.page(handle)].texture,
+                                   ivec2(ATLAS_PAGE_SIZE), m_atlas.origin(handle));
+    }
+
+    struct atlas_page
+    {
+        Texture *texture = nullptr;
+        array<u8vec4> pixels;
+        int dirty_min = INT_MAX, dirty_max = 0;
+    };
+
+    std::vector<atlas_page> m_pages;
+    std::map<int, TileSet *> m_owners;
 };
 
+static TileSetAtlas g_atlas;
+
 /*
  * Public TileSet class
  */
@@ -178,6 +385,48 @@ void TileSet::Init(std::string const &path, Image* image)
     m_data->m_name = "<tileset> " + path;
 }
 
+void TileSet::tick_draw(float seconds, Scene &scene)
+{
+    TileSetData *data = m_tileset_data;
+
+    /* Page textures belong to the atlas, so forget about them before
+     * the texture image code gets to destroy or replace the texture */
+    if (data->m_atlas_handle >= 0)
+    {
+        if (has_flags(entity::flags::destroying) || m_data->m_image)
+            g_atlas.remove(this);
+        else if (data->m_no_atlas)
+            m_data->m_image = g_atlas.extract(this);
+
+        if (data->m_atlas_handle < 0)
+            relocate(nullptr, ivec2(PotUp(m_data->m_image_size.x),
+                                    PotUp(m_data->m_image_size.y)), ivec2(0));
+    }
+
+    if (!has_flags(entity::flags::destroying) && m_data->m_image
+         && !data->m_no_atlas && g_atlas.add(this, m_data->m_image))
+    {
+        delete m_data->m_image;
+        m_data->m_image = nullptr;
+    }
+
+    super::tick_draw(seconds, scene);
+}
+
+void TileSet::relocate(Texture *texture, ivec2 texture_size, ivec2 origin)
+{
+    m_data->m_texture = texture;
+    m_data->m_texture_size = texture_size;
+    m_tileset_data->m_atlas_origin = origin;
+
+    for (int i = 0; i < m_tileset_data->m_tiles.count(); ++i)
+    {
+        ibox2 const &rect = m_tileset_data->m_tiles[i].m1;
+        m_tileset_data->m_tiles[i].m2 = box2((vec2)(rect.aa + origin) / (vec2)texture_size,
+                                             (vec2)(rect.bb + origin) / (vec2)texture_size);
+    }
+}
+
 //Inherited from entity -------------------------------------------------------
 std::string TileSet::GetName() const
 {
@@ -192,9 +441,10 @@ void TileSet::clear_all()
 
 int TileSet::define_tile(ibox2 rect)
 {
+    ivec2 origin = m_tileset_data->m_atlas_origin;
     m_tileset_data->m_tiles.push(rect,
-             box2((vec2)rect.aa / (vec2)m_data->m_texture_size,
-                  (vec2)rect.bb / (vec2)m_data->m_texture_size));
+             box2((vec2)(rect.aa + origin) / (vec2)m_data->m_texture_size,
+                  (vec2)(rect.bb + origin) / (vec2)m_data->m_texture_size));
     return m_tileset_data->m_tiles.count() - 1;
 }
 
@@ -245,6 +495,13 @@ box2 TileSet::GetTileTexel(int tileid) const
 //Palette ---------------------------------------------------------------------
 void TileSet::SetPalette(TileSet* palette)
 {
+    /* Palettes are looked up by absolute coordinates, and so are the
+     * indices of the tilesets that use them */
+    if (palette)
+    {
+        palette->m_tileset_data->m_no_atlas = true;
+        m_tileset_data->m_no_atlas = true;
+    }
     m_palette = palette;
 }
 
@@ -258,6 +515,36 @@ TileSet const* TileSet::GetPalette() const
     return m_palette;
 }
 
+//Distance field --------------------------------------------------------------
+void TileSet::SetDistanceField(bool enable)
+{
+    /* Distance fields need linear filtering, which atlas pages do not
+     * have, and would bleed into their neighbours anyway */
+    if (enable)
+        m_tileset_data->m_no_atlas = true;
+    m_tileset_data->m_distance_field = enable;
+}
+
+bool TileSet::IsDistanceField() const
+{
+    return m_tileset_data->m_distance_field;
+}
+
+void TileSet::EnableAtlas(bool enable)
+{
+    g_atlas.m_enabled = enable;
+}
+
+float TileSet::GetAtlasOccupancy()
+{
+    return g_atlas.m_atlas.occupancy();
+}
+
+int TileSet::GetAtlasPageCount()
+{
+    return g_atlas.m_atlas.page_count();
+}
+
 void TileSet::BlitTile(uint32_t id, mat4 model, vec3 *vertex, vec2 *texture)
 {
     ibox2 pixels = m_tileset_data->m_tiles[id].m1;
@@ -39,6 +39,7 @@ class TileSetData;
 class TileSet : public TextureImage
 {
     typedef TextureImage super;
+    friend class TileSetAtlas;
 
 public:
     static TileSet *create(std::string const &path);
@@ -61,6 +62,8 @@ protected:
     virtual void Init(std::string const &path, ResourceCodecData* loaded_data);
     virtual void Init(std::string const &path, image* img);
 
+    virtual void tick_draw(float seconds, Scene &scene);
+
 public:
     /* Inherited from entity */
     virtual std::string GetName() const;
@@ -79,8 +82,24 @@ public:
     void SetPalette(TileSet* palette);
     TileSet* GetPalette();
     TileSet const * GetPalette() const;
+
+    /* The alpha channel holds a signed distance field, e.g. from
+     * image::signed_distance_field(), and tiles are drawn with a
+     * shader that keeps the outlines sharp at any scale. */
+    void SetDistanceField(bool enable);
+    bool IsDistanceField() const;
     void BlitTile(uint32_t id, mat4 model, vec3 *vertex, vec2 *texture);
 
+    /* Small RGBA tilesets share the pages of a texture atlas, so that
+     * consecutive tiles from different tilesets can be drawn at once.
+     * Palettes are never put in the atlas. */
+    static void EnableAtlas(bool enable);
+    static float GetAtlasOccupancy();
+    static int GetAtlasPageCount();
+
+private:
+    void relocate(Texture *texture, ivec2 texture_size, ivec2 origin);
+
 protected:
     TileSetData *m_tileset_data;
     TileSet *m_palette;
@@ -329,53 +329,28 @@ void gui::render_draw_lists(ImDrawData* draw_data)
     // Register uniforms
     m_shader->SetUniform(m_ortho, ortho);
 
+    // Lay out every command list in the shared buffers
+    m_batch.begin();
     for (int n = 0; n < draw_data->CmdListsCount; n++)
     {
         auto const &command_list = *draw_data->CmdLists[n];
-        /*const unsigned char* vtx_buffer = (const unsigned char*)&command_list.VtxBuffer.front();*/
 
-        struct Vertex
-        {
-            vec2 pos, tex;
-            u8vec4 color;
-        };
-
-        auto vbo = std::make_shared<VertexBuffer>(command_list.VtxBuffer.Size * sizeof(ImDrawVert));
-        ImDrawVert *vert = (ImDrawVert *)vbo->Lock(0, 0);
-        memcpy(vert, command_list.VtxBuffer.Data, command_list.VtxBuffer.Size * sizeof(ImDrawVert));
-        vbo->Unlock();
-
-        auto ibo = std::make_shared<IndexBuffer>(command_list.IdxBuffer.Size * sizeof(ImDrawIdx));
-        ImDrawIdx *indices = (ImDrawIdx *)ibo->Lock(0, 0);
-        memcpy(indices, command_list.IdxBuffer.Data, command_list.IdxBuffer.Size * sizeof(ImDrawIdx));
-        ibo->Unlock();
-
-        ibo->Bind();
-        m_vdecl->Bind();
-        m_vdecl->SetStream(vbo, m_attribs[0], m_attribs[1], m_attribs[2]);
-
-        const ImDrawIdx* idx_buffer_offset = 0;
-        for (int cmd_i = 0; cmd_i < command_list.CmdBuffer.Size; cmd_i++)
-        {
-            auto const &command = command_list.CmdBuffer[cmd_i];
-            Texture* texture = (Texture*)command.TextureId;
-            if (texture)
-            {
-                texture->Bind();
-                m_shader->SetUniform(m_texture, texture->GetTextureUniform(), 0);
-            }
-
-            rc.scissor_rect(command.ClipRect);
+        m_commands.resize(0);
+        for (auto const &command : command_list.CmdBuffer)
+            m_commands.push(gui_batch::command {
+                static_cast<Texture *>(command.TextureId),
+                vec4(command.ClipRect), (int)command.ElemCount });
 
 #ifdef SHOW_IMGUI_DEBUG
+        ImDrawVert const *vert = command_list.VtxBuffer.Data;
+        ImDrawIdx const *indices = command_list.IdxBuffer.Data;
+        uint32_t idx_buffer_offset_i = 0;
+        for (auto const &command : command_list.CmdBuffer)
+        {
             //-----------------------------------------------------------------
             //<Debug render> --------------------------------------------------
             //-----------------------------------------------------------------
             //Doesn't work anymore ......
-            static uint32_t idx_buffer_offset_i = 0;
-            if (cmd_i == 0)
-                idx_buffer_offset_i = 0;
-
             float mod = -200.f;
             vec3 off = vec3(vec2(-size.x, -size.y), 0.f);
             vec3 pos[4] = {
@@ -386,7 +361,7 @@ void gui::render_draw_lists(ImDrawData* draw_data)
             };
             for (int i = 0; i < 4; ++i)
                 Debug::DrawLine(pos[i], pos[(i + 1) % 4], Color::white);
-            ImDrawVert* buf = vert;
+            ImDrawVert const* buf = vert;
             for (uint16_t i = 0; i < command.ElemCount; i += 3)
             {
                 uint16_t ib = indices[idx_buffer_offset_i + i];
@@ -407,18 +382,80 @@ void gui::render_draw_lists(ImDrawData* draw_data)
             //-----------------------------------------------------------------
             //<\Debug render> -------------------------------------------------
             //-----------------------------------------------------------------
+        }
 #endif //SHOW_IMGUI_DEBUG
-            //Debug::DrawLine(vec2::zero, vec2::axis_x /*, Color::green*/);
 
-            m_vdecl->DrawIndexedElements(MeshPrimitive::Triangles, command.ElemCount, (const short*)idx_buffer_offset);
+        m_batch.add_list(command_list.VtxBuffer.Data,
+                         command_list.VtxBuffer.Size * sizeof(ImDrawVert),
+                         command_list.IdxBuffer.Data,
+                         command_list.IdxBuffer.Size * sizeof(ImDrawIdx),
+                         sizeof(ImDrawIdx), m_commands.data(), m_commands.count());
+    }
+
+    // Grow the buffers if necessary; their contents are then lost
+    size_t const min_size = 64 * 1024;
+    if (!m_vbo || m_vbo->GetSize() < m_batch.vertex_bytes())
+    {
+        m_vbo = std::make_shared<VertexBuffer>(lol::max(min_size, m_batch.vertex_bytes() * 3 / 2));
+        m_batch.invalidate();
+    }
+    if (!m_ibo || m_ibo->GetSize() < m_batch.index_bytes())
+    {
+        m_ibo = std::make_shared<IndexBuffer>(lol::max(min_size, m_batch.index_bytes() * 3 / 2));
+        m_batch.invalidate();
+    }
 
-            idx_buffer_offset += command.ElemCount;
+    // Only upload the lists that changed since the last frame
+    for (int n = 0; n < draw_data->CmdListsCount; n++)
+    {
+        auto const &command_list = *draw_data->CmdLists[n];
+        auto const &info = m_batch.lists()[n];
+        if (!info.dirty)
+            continue;
+
+        m_vbo->Upload(info.vertex_offset, command_list.VtxBuffer.Data, info.vertex_size);
+        m_ibo->Upload(info.index_offset, command_list.IdxBuffer.Data, info.index_size);
+    }
+
+    Profiler::SetCounter(Profiler::COUNTER_GUI_COMMANDS, m_batch.command_count());
+    Profiler::SetCounter(Profiler::COUNTER_GUI_DRAW_CALLS, m_batch.draw_calls().count());
+    Profiler::SetCounter(Profiler::COUNTER_GUI_UPLOAD_BYTES, (int)m_batch.upload_bytes());
+
+    m_ibo->Bind();
+    m_vdecl->Bind();
+
+    // Only change the state that differs from the previous draw call
+    size_t vertex_offset = ~(size_t)0;
+    Texture *texture = nullptr;
+    vec4 clip(-1.f);
+    for (auto const &draw : m_batch.draw_calls())
+    {
+        if (draw.vertex_offset != vertex_offset)
+        {
+            vertex_offset = draw.vertex_offset;
+            m_vdecl->SetStream(m_vbo, vertex_offset, m_attribs[0], m_attribs[1], m_attribs[2]);
         }
 
-        m_vdecl->Unbind();
-        ibo->Unbind();
+        if (draw.texture && draw.texture != texture)
+        {
+            texture = draw.texture;
+            texture->Bind();
+            m_shader->SetUniform(m_texture, texture->GetTextureUniform(), 0);
+        }
+
+        if (draw.clip != clip)
+        {
+            clip = draw.clip;
+            rc.scissor_rect(clip);
+        }
+
+        m_vdecl->DrawIndexedElements(MeshPrimitive::Triangles, draw.count,
+                                     (const short*)(uintptr_t)(draw.index * sizeof(ImDrawIdx)));
     }
 
+    m_vdecl->Unbind();
+    m_ibo->Unbind();
+
     m_shader->Unbind();
 }
 
@@ -38,6 +38,8 @@
 #undef IM_VEC2_CLASS_EXTRA
 #undef IM_VEC4_CLASS_EXTRA
 
+#include "ui/guibatch.h"
+
 namespace lol
 {
 
@@ -87,6 +89,12 @@ protected:
     std::shared_ptr<VertexDeclaration> m_vdecl;
     std::string m_clipboard;
 
+    /* Geometry is kept across frames and only uploaded when it changes */
+    gui_batch m_batch;
+    array<gui_batch::command> m_commands;
+    std::shared_ptr<VertexBuffer> m_vbo;
+    std::shared_ptr<IndexBuffer> m_ibo;
+
     class primitive : public PrimitiveRenderer
     {
     public:
@@ -0,0 +1,123 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <cstring>
+
+#include "ui/guibatch.h"
+
+namespace lol
+{
+
+/* 64-bit FNV-1a, fed with 64-bit words instead of bytes because the
+ * GUI geometry easily reaches hundreds of kilobytes per frame */
+static uint64_t hash_words(uint64_t h, void const *data, size_t len)
+{
+    uint8_t const *p = (uint8_t const *)data;
+    for (; len >= 8; p += 8, len -= 8)
+    {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        h = (h ^ word) * 0x100000001b3ull;
+    }
+    for (; len; ++p, --len)
+        h = (h ^ *p) * 0x100000001b3ull;
+    return h;
+}
+
+static size_t align_up(size_t x, size_t align)
+{
+    return (x + align - 1) / align * align;
+}
+
+void gui_batch::begin()
+{
+    /* Keep last frame’s layout to find out which lists changed */
+    m_frame ^= 1;
+    m_lists[m_frame].clear();
+    m_hashes[m_frame].clear();
+    m_draws.clear();
+    m_vertex_bytes = m_index_bytes = 0;
+    m_commands = 0;
+}
+
+void gui_batch::add_list(void const *vertices, size_t vertex_bytes,
+                         void const *indices, size_t index_bytes, size_t index_size,
+                         command const *commands, int count)
+{
+    list_info info;
+    info.vertex_offset = align_up(m_vertex_bytes, 16);
+    info.vertex_size = vertex_bytes;
+    info.index_offset = align_up(m_index_bytes, 16);
+    info.index_size = index_bytes;
+
+    uint64_t h = 0xcbf29ce484222325ull;
+    h = hash_words(h, vertices, vertex_bytes);
+    h = hash_words(h, indices, index_bytes);
+
+    /* A list only needs uploading if its data or its place changed */
+    auto const &old_lists = m_lists[m_frame ^ 1];
+    auto const &old_hashes = m_hashes[m_frame ^ 1];
+    int n = m_lists[m_frame].count();
+    info.dirty = n >= old_lists.count()
+              || old_hashes[n] != h
+              || old_lists[n].vertex_offset != info.vertex_offset
+              || old_lists[n].vertex_size != info.vertex_size
+              || old_lists[n].index_offset != info.index_offset
+              || old_lists[n].index_size != info.index_size;
+
+    m_lists[m_frame] << info;
+    m_hashes[m_frame] << h;
+    m_vertex_bytes = info.vertex_offset + vertex_bytes;
+    m_index_bytes = info.index_offset + index_bytes;
+
+    /* Adjacent commands with the same state become one draw call */
+    int first = (int)(info.index_offset / index_size);
+    int const start = m_draws.count();
+    for (int i = 0; i < count; ++i)
+    {
+        command const &c = commands[i];
+        m_commands += 1;
+
+        if (c.count > 0)
+        {
+            if (m_draws.count() > start
+                 && m_draws.last().texture == c.texture
+                 && m_draws.last().clip == c.clip)
+                m_draws.last().count += c.count;
+            else
+                m_draws.push(draw_call { c.texture, c.clip, first, c.count,
+                                         info.vertex_offset });
+        }
+
+        first += c.count;
+    }
+}
+
+void gui_batch::invalidate()
+{
+    for (auto &l : m_lists[m_frame])
+        l.dirty = true;
+}
+
+size_t gui_batch::upload_bytes() const
+{
+    size_t ret = 0;
+    for (auto const &l : m_lists[m_frame])
+        if (l.dirty)
+            ret += l.vertex_size + l.index_size;
+    return ret;
+}
+
+} /* namespace lol */
+
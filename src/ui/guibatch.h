@@ -0,0 +1,95 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// The gui_batch class
+// -------------------
+//
+// Turns the GUI command lists of a frame into a short list of draw
+// calls, independently from the GPU: all lists share one vertex and one
+// index buffer, adjacent commands that use the same texture and clip
+// rectangle are merged, and lists whose contents did not change since
+// the last frame are not uploaded again.
+//
+
+namespace lol
+{
+
+class Texture;
+
+class gui_batch
+{
+public:
+    /* One GUI command, as found in the command lists */
+    struct command
+    {
+        Texture *texture;
+        vec4 clip;
+        int count;
+    };
+
+    /* One draw call: count indices starting at index, with vertices
+     * read from vertex_offset bytes into the vertex buffer */
+    struct draw_call
+    {
+        Texture *texture;
+        vec4 clip;
+        int index, count;
+        size_t vertex_offset;
+    };
+
+    /* Where a list goes in the shared buffers, and whether its data
+     * must be uploaded there */
+    struct list_info
+    {
+        size_t vertex_offset, vertex_size;
+        size_t index_offset, index_size;
+        bool dirty;
+    };
+
+    void begin();
+
+    /* Add a command list; index_size is the size of one index */
+    void add_list(void const *vertices, size_t vertex_bytes,
+                  void const *indices, size_t index_bytes, size_t index_size,
+                  command const *commands, int count);
+
+    /* Mark every list as needing an upload, for instance after the
+     * buffers were reallocated */
+    void invalidate();
+
+    array<list_info> const &lists() const { return m_lists[m_frame]; }
+    array<draw_call> const &draw_calls() const { return m_draws; }
+
+    size_t vertex_bytes() const { return m_vertex_bytes; }
+    size_t index_bytes() const { return m_index_bytes; }
+    int command_count() const { return m_commands; }
+
+    /* Bytes that need uploading this frame */
+    size_t upload_bytes() const;
+
+private:
+    /* This frame’s lists and hashes, and last frame’s; begin() swaps
+     * them instead of copying */
+    array<list_info> m_lists[2];
+    array<uint64_t> m_hashes[2];
+    int m_frame = 0;
+    array<draw_call> m_draws;
+
+    size_t m_vertex_bytes = 0, m_index_bytes = 0;
+    int m_commands = 0;
+};
+
+} /* namespace lol */
+
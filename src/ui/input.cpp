@@ -60,13 +60,13 @@ static std::vector<input::key> g_all_keys
 #include "ui/keys.inc"
 };
 
-static std::map<input::key, std::string> g_key_to_name
+static hash_map<input::key, std::string> g_key_to_name
 {
 #define _SC(code, str, name) { input::key::SC_##name, #name },
 #include "ui/keys.inc"
 };
 
-static std::map<std::string, input::key> g_name_to_key
+static hash_map<std::string, input::key> g_name_to_key
 {
 #define _SC(code, str, name) { #name, input::key::SC_##name },
 #include "ui/keys.inc"
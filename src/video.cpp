@@ -20,8 +20,16 @@
 #   undef far /* Fuck Microsoft again */
 #endif
 
+#include <algorithm>
+#include <cstring>
+
 #include "lolgl.h"
 
+#if (defined LOL_USE_GLEW || defined HAVE_GL_2X) && !defined HAVE_GLES_2X \
+     && defined GL_PIXEL_PACK_BUFFER
+#   define LOL_CAPTURE_PBO 1
+#endif
+
 namespace lol
 {
 
@@ -31,10 +39,26 @@ class VideoData
 
 private:
     static DebugRenderMode render_mode;
+
+#if LOL_CAPTURE_PBO
+    /* Ring of pixel buffers for asynchronous captures: a frame is read
+     * into one of them, and only mapped when the ring comes back to it,
+     * by which time the transfer is usually complete. */
+    static int const CAPTURE_RING = 3;
+    static GLuint capture_pbo[CAPTURE_RING];
+    static ivec2 capture_size;
+    static int capture_index, capture_pending;
+#endif
 };
 
 DebugRenderMode VideoData::render_mode = DebugRenderMode::Default;
 
+#if LOL_CAPTURE_PBO
+GLuint VideoData::capture_pbo[VideoData::CAPTURE_RING];
+ivec2 VideoData::capture_size(0);
+int VideoData::capture_index = 0, VideoData::capture_pending = 0;
+#endif
+
 /*
  * Public Video class
  */
@@ -87,6 +111,12 @@ DebugRenderMode Video::GetDebugRenderMode()
 
 void Video::Destroy()
 {
+#if LOL_CAPTURE_PBO
+    if (VideoData::capture_size != ivec2(0))
+        glDeleteBuffers(VideoData::CAPTURE_RING, VideoData::capture_pbo);
+    VideoData::capture_size = ivec2(0);
+#endif
+
     Scene::DestroyAll();
 }
 
@@ -109,17 +139,120 @@ void Video::Capture(uint32_t *buffer)
 #   endif
 
     for (int j = 0; j < height / 2; j++)
-        for (int i = 0; i < width; i++)
+        std::swap_ranges(buffer + j * width, buffer + (j + 1) * width,
+                         buffer + (height - j - 1) * width);
+#else
+    UNUSED(buffer);
+#endif
+}
+
+bool Video::CaptureAsync(u8vec4 *buffer, ivec2 size)
+{
+#if LOL_CAPTURE_PBO
+    GLint v[4];
+    glGetIntegerv(GL_VIEWPORT, v);
+    ivec2 vsize(v[2], v[3]);
+
+    /* Pending frames are lost when the viewport size changes */
+    if (vsize != VideoData::capture_size)
+    {
+        if (VideoData::capture_size != ivec2(0))
+            glDeleteBuffers(VideoData::CAPTURE_RING, VideoData::capture_pbo);
+        glGenBuffers(VideoData::CAPTURE_RING, VideoData::capture_pbo);
+        for (GLuint pbo : VideoData::capture_pbo)
         {
-            uint32_t tmp = buffer[j * width + i];
-            buffer[j * width + i] = buffer[(height - j - 1) * width + i];
-            buffer[(height - j - 1) * width + i] = tmp;
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+            glBufferData(GL_PIXEL_PACK_BUFFER, vsize.x * vsize.y * 4,
+                         nullptr, GL_STREAM_READ);
         }
+        VideoData::capture_size = vsize;
+        VideoData::capture_index = 0;
+        VideoData::capture_pending = 0;
+    }
+
+    /* Retrieve the oldest frame before reusing its buffer */
+    bool ready = false;
+    if (VideoData::capture_pending == VideoData::CAPTURE_RING)
+        ready = FlushCapture(buffer, size);
+
+    int &index = VideoData::capture_index;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, VideoData::capture_pbo[index]);
+    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, vsize.x, vsize.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    ++VideoData::capture_pending;
+    index = (index + 1) % VideoData::CAPTURE_RING;
+    return ready;
+#elif defined LOL_USE_GLEW || defined HAVE_GL_2X || defined HAVE_GLES_2X
+    /* No pixel buffers: read the frame synchronously */
+    GLint v[4];
+    glGetIntegerv(GL_VIEWPORT, v);
+    ivec2 vsize(v[2], v[3]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    if (vsize == size)
+    {
+        glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, buffer);
+        return true;
+    }
+
+    static array<u8vec4> tmp;
+    tmp.resize(vsize.x * vsize.y);
+    glReadPixels(0, 0, vsize.x, vsize.y, GL_RGBA, GL_UNSIGNED_BYTE, tmp.data());
+    CopyFrame(buffer, size, tmp.data(), vsize);
+    return true;
 #else
-    UNUSED(buffer);
+    UNUSED(buffer, size);
+    return false;
+#endif
+}
+
+bool Video::FlushCapture(u8vec4 *buffer, ivec2 size)
+{
+#if LOL_CAPTURE_PBO
+    int &pending = VideoData::capture_pending;
+    if (pending == 0)
+        return false;
+
+    int const oldest = (VideoData::capture_index - pending
+                         + VideoData::CAPTURE_RING) % VideoData::CAPTURE_RING;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, VideoData::capture_pbo[oldest]);
+    void *data = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+    if (data)
+    {
+        CopyFrame(buffer, size, (u8vec4 const *)data, VideoData::capture_size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    --pending;
+    return data != nullptr;
+#else
+    /* Synchronous captures never leave anything pending */
+    UNUSED(buffer, size);
+    return false;
 #endif
 }
 
+void Video::CopyFrame(u8vec4 *dst, ivec2 dst_size,
+                      u8vec4 const *src, ivec2 src_size)
+{
+    ivec2 const common = max(min(dst_size, src_size), ivec2(0));
+
+    for (int j = 0; j < common.y; ++j)
+    {
+        u8vec4 *line = dst + j * dst_size.x;
+        memcpy((void *)line, src + j * src_size.x, common.x * sizeof(u8vec4));
+        memset((void *)(line + common.x), 0,
+               (dst_size.x - common.x) * sizeof(u8vec4));
+    }
+
+    if (dst_size.y > common.y && dst_size.x > 0)
+        memset((void *)(dst + common.y * dst_size.x), 0,
+               (dst_size.y - common.y) * dst_size.x * sizeof(u8vec4));
+}
+
 void Video::Resize(ivec2 size)
 {
     Scene::GetScene(0).resize(size);
@@ -57,6 +57,19 @@ public:
     static void SetDebugRenderMode(DebugRenderMode d);
     static DebugRenderMode GetDebugRenderMode();
     static void Capture(uint32_t *buffer);
+
+    /* Queue an asynchronous read of the current frame and retrieve an
+     * older one, as bottom-up RGBA pixels, if one is ready. The copy
+     * lags a few frames behind, but never stalls the GPU pipeline. The
+     * buffer holds size pixels, whatever the viewport size. */
+    static bool CaptureAsync(u8vec4 *buffer, ivec2 size);
+    /* Retrieve the oldest frame still pending, if any */
+    static bool FlushCapture(u8vec4 *buffer, ivec2 size);
+
+    /* Copy the bottom left part that a src_size frame has in common
+     * with a dst_size frame, and clear the rest of the latter. */
+    static void CopyFrame(u8vec4 *dst, ivec2 dst_size,
+                          u8vec4 const *src, ivec2 src_size);
 };
 
 } /* namespace lol */
@@ -0,0 +1,378 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#include <lol/engine-internal.h>
+
+#include <algorithm>
+#include <cfloat>
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define LOL_VISIBILITY_SSE2 1
+#endif
+
+/* Below this many boxes, building a hierarchy is not worth it */
+#define HIERARCHY_THRESHOLD 32
+
+/* Maximum number of boxes in a hierarchy leaf */
+#define LEAF_SIZE 8
+
+namespace lol
+{
+
+ivec2 const visibility::depth_size(128, 64);
+
+/* Corners of each box face, with bit 0, 1, 2 of each index selecting
+ * the maximum x, y, z coordinate respectively. */
+static int const face_corners[6][4] =
+{
+    { 0, 2, 6, 4 }, { 1, 3, 7, 5 },
+    { 0, 1, 5, 4 }, { 2, 3, 7, 6 },
+    { 0, 1, 3, 2 }, { 4, 5, 7, 6 },
+};
+
+/* Project the corners of a box to depth buffer coordinates; returns false
+ * if any of them is behind the camera. */
+static bool project_box(mat4 const &view_proj, box3 const &b, vec3 *out)
+{
+    vec2 const scale = 0.5f * vec2(visibility::depth_size);
+
+    for (int k = 0; k < 8; ++k)
+    {
+        vec4 p = view_proj * vec4(k & 1 ? b.bb.x : b.aa.x,
+                                  k & 2 ? b.bb.y : b.aa.y,
+                                  k & 4 ? b.bb.z : b.aa.z, 1.f);
+        if (p.w <= 1e-5f)
+            return false;
+
+        vec3 ndc = p.xyz / p.w;
+        out[k] = vec3((ndc.xy + vec2(1.f)) * scale, ndc.z);
+    }
+
+    return true;
+}
+
+visibility::visibility()
+  : m_depth(depth_size)
+{
+    m_stats[0] = m_stats[1] = m_stats[2] = 0;
+}
+
+void visibility::reset(mat4 const &view_proj)
+{
+    m_view_proj = view_proj;
+
+    /* Extract the frustum planes from the matrix rows; a point p is
+     * inside if dot(plane.xyz, p) + plane.w >= 0 for all of them. */
+    vec4 const row[4] =
+    {
+        vec4(view_proj[0][0], view_proj[1][0], view_proj[2][0], view_proj[3][0]),
+        vec4(view_proj[0][1], view_proj[1][1], view_proj[2][1], view_proj[3][1]),
+        vec4(view_proj[0][2], view_proj[1][2], view_proj[2][2], view_proj[3][2]),
+        vec4(view_proj[0][3], view_proj[1][3], view_proj[2][3], view_proj[3][3]),
+    };
+
+    for (int i = 0; i < 3; ++i)
+    {
+        m_planes[2 * i] = row[3] + row[i];
+        m_planes[2 * i + 1] = row[3] - row[i];
+    }
+
+    m_count = 0;
+    m_boxes.clear();
+    m_occluder.clear();
+}
+
+int visibility::add(box3 const &bounds, bool occluder)
+{
+    m_boxes.push(bounds);
+    m_occluder.push(occluder ? 1 : 0);
+    return m_count++;
+}
+
+void visibility::cull(bool hierarchy, bool occlusion)
+{
+    m_state.resize(m_count);
+    m_order.resize(m_count);
+    for (int i = 0; i < m_count; ++i)
+        m_order[i] = i;
+
+    /* The hierarchy is rebuilt for every query, since most primitives
+     * are registered again every frame anyway. */
+    hierarchy = hierarchy && m_count >= HIERARCHY_THRESHOLD;
+    m_nodes.clear();
+    if (hierarchy)
+    {
+        m_nodes.push(node());
+        build_node(0, 0, m_count);
+    }
+
+    m_cx.resize(m_count); m_cy.resize(m_count); m_cz.resize(m_count);
+    m_ex.resize(m_count); m_ey.resize(m_count); m_ez.resize(m_count);
+    for (int i = 0; i < m_count; ++i)
+    {
+        box3 const &b = m_boxes[m_order[i]];
+        vec3 c = 0.5f * (b.aa + b.bb), e = 0.5f * (b.bb - b.aa);
+        m_cx[i] = c.x; m_cy[i] = c.y; m_cz[i] = c.z;
+        m_ex[i] = e.x; m_ey[i] = e.y; m_ez[i] = e.z;
+    }
+
+    if (hierarchy)
+        cull_node(0, false);
+    else
+        cull_range(0, m_count);
+
+    if (occlusion)
+    {
+        float *depth = m_depth.data();
+        for (int i = 0; i < depth_size.x * depth_size.y; ++i)
+            depth[i] = FLT_MAX;
+
+        for (int i = 0; i < m_count; ++i)
+            if (m_occluder[i] && m_state[i] == 0)
+                rasterise_occluder(m_boxes[i]);
+
+        for (int i = 0; i < m_count; ++i)
+            if (!m_occluder[i] && m_state[i] == 0 && is_occluded(m_boxes[i]))
+                m_state[i] = 2;
+    }
+
+    m_stats[0] = m_stats[1] = m_stats[2] = 0;
+    for (int i = 0; i < m_count; ++i)
+        if (!m_occluder[i])
+            ++m_stats[m_state[i]];
+}
+
+/* Test boxes start to end (in m_order order) against the frustum. A box
+ * is outside if it is entirely on the negative side of any plane, that
+ * is if dot(n, centre) + dot(|n|, extents) + w < 0 for that plane. */
+void visibility::cull_range(int start, int end)
+{
+    int i = start;
+
+#if LOL_VISIBILITY_SSE2
+    for ( ; i + 4 <= end; i += 4)
+    {
+        __m128 const cx = _mm_loadu_ps(&m_cx[i]);
+        __m128 const cy = _mm_loadu_ps(&m_cy[i]);
+        __m128 const cz = _mm_loadu_ps(&m_cz[i]);
+        __m128 const ex = _mm_loadu_ps(&m_ex[i]);
+        __m128 const ey = _mm_loadu_ps(&m_ey[i]);
+        __m128 const ez = _mm_loadu_ps(&m_ez[i]);
+        __m128 outside = _mm_setzero_ps();
+
+        for (vec4 const &p : m_planes)
+        {
+            __m128 d = _mm_set1_ps(p.w);
+            d = _mm_add_ps(d, _mm_mul_ps(cx, _mm_set1_ps(p.x)));
+            d = _mm_add_ps(d, _mm_mul_ps(cy, _mm_set1_ps(p.y)));
+            d = _mm_add_ps(d, _mm_mul_ps(cz, _mm_set1_ps(p.z)));
+            d = _mm_add_ps(d, _mm_mul_ps(ex, _mm_set1_ps(lol::abs(p.x))));
+            d = _mm_add_ps(d, _mm_mul_ps(ey, _mm_set1_ps(lol::abs(p.y))));
+            d = _mm_add_ps(d, _mm_mul_ps(ez, _mm_set1_ps(lol::abs(p.z))));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(d, _mm_setzero_ps()));
+        }
+
+        int const mask = _mm_movemask_ps(outside);
+        for (int k = 0; k < 4; ++k)
+            m_state[m_order[i + k]] = (mask >> k) & 1;
+    }
+#endif
+
+    for ( ; i < end; ++i)
+    {
+        uint8_t outside = 0;
+        for (vec4 const &p : m_planes)
+        {
+            float d = p.w + p.x * m_cx[i] + p.y * m_cy[i] + p.z * m_cz[i]
+                    + lol::abs(p.x) * m_ex[i] + lol::abs(p.y) * m_ey[i]
+                    + lol::abs(p.z) * m_ez[i];
+            outside |= d < 0.f;
+        }
+        m_state[m_order[i]] = outside;
+    }
+}
+
+/* Cull a hierarchy node: whole subtrees are accepted or rejected when
+ * the node is entirely inside or outside the frustum. */
+void visibility::cull_node(int index, bool inside)
+{
+    node const &n = m_nodes[index];
+
+    if (!inside)
+    {
+        vec3 const c = 0.5f * (n.m_bounds.aa + n.m_bounds.bb);
+        vec3 const e = 0.5f * (n.m_bounds.bb - n.m_bounds.aa);
+
+        inside = true;
+        for (vec4 const &p : m_planes)
+        {
+            float const d = dot(p.xyz, c) + p.w;
+            float const r = dot(lol::abs(p.xyz), e);
+            if (d + r < 0.f)
+            {
+                for (int i = n.m_start; i < n.m_end; ++i)
+                    m_state[m_order[i]] = 1;
+                return;
+            }
+            inside = inside && d - r >= 0.f;
+        }
+    }
+
+    if (inside)
+    {
+        for (int i = n.m_start; i < n.m_end; ++i)
+            m_state[m_order[i]] = 0;
+    }
+    else if (n.m_child < 0)
+        cull_range(n.m_start, n.m_end);
+    else
+    {
+        int const child = n.m_child;
+        cull_node(child, false);
+        cull_node(child + 1, false);
+    }
+}
+
+/* Build a hierarchy node for boxes start to end of m_order, splitting
+ * them at the median along the largest axis of their centres. */
+void visibility::build_node(int index, int start, int end)
+{
+    box3 bounds = m_boxes[m_order[start]];
+    vec3 cmin = 0.5f * (bounds.aa + bounds.bb), cmax = cmin;
+    for (int i = start + 1; i < end; ++i)
+    {
+        box3 const &b = m_boxes[m_order[i]];
+        vec3 const c = 0.5f * (b.aa + b.bb);
+        bounds.aa = min(bounds.aa, b.aa);
+        bounds.bb = max(bounds.bb, b.bb);
+        cmin = min(cmin, c);
+        cmax = max(cmax, c);
+    }
+
+    m_nodes[index].m_bounds = bounds;
+    m_nodes[index].m_start = start;
+    m_nodes[index].m_end = end;
+    m_nodes[index].m_child = -1;
+
+    if (end - start <= LEAF_SIZE)
+        return;
+
+    vec3 const size = cmax - cmin;
+    int const axis = size.x >= size.y && size.x >= size.z ? 0
+                   : size.y >= size.z ? 1 : 2;
+    int const mid = (start + end) / 2;
+    std::nth_element(&m_order[start], &m_order[mid], &m_order[end - 1] + 1,
+                     [&](int a, int b)
+    {
+        return m_boxes[a].aa[axis] + m_boxes[a].bb[axis]
+             < m_boxes[b].aa[axis] + m_boxes[b].bb[axis];
+    });
+
+    int const child = m_nodes.count();
+    m_nodes[index].m_child = child;
+    m_nodes.push(node());
+    m_nodes.push(node());
+    build_node(child, start, mid);
+    build_node(child + 1, mid, end);
+}
+
+/* Rasterise the faces of a solid box into the depth buffer. Only pixels
+ * entirely covered by a face are written, with the face’s farthest
+ * depth, so that the buffer never hides anything visible. Faces are
+ * drawn as whole quads (they remain convex once projected) because
+ * splitting them into triangles would leave their diagonal uncovered. */
+void visibility::rasterise_occluder(box3 const &b)
+{
+    vec3 p[8];
+    if (!project_box(m_view_proj, b, p))
+        return;
+
+    for (auto const &face : face_corners)
+    {
+        vec3 const v[4] = { p[face[0]], p[face[1]], p[face[2]], p[face[3]] };
+
+        float area = 0.f;
+        for (int i = 0; i < 4; ++i)
+            area += v[i].x * v[(i + 1) % 4].y - v[i].y * v[(i + 1) % 4].x;
+        if (lol::abs(area) < 1e-6f)
+            continue;
+
+        /* Edge functions, oriented so that the inside is positive */
+        float const s = area > 0.f ? 1.f : -1.f;
+        vec3 e[4];
+        vec3 vmin = v[0], vmax = v[0];
+        for (int i = 0; i < 4; ++i)
+        {
+            vec3 const &a = v[i], &c = v[(i + 1) % 4];
+            e[i] = s * vec3(a.y - c.y, c.x - a.x, a.x * c.y - a.y * c.x);
+            vmin = min(vmin, a);
+            vmax = max(vmax, a);
+        }
+
+        int const x0 = max(0, (int)floor(vmin.x));
+        int const y0 = max(0, (int)floor(vmin.y));
+        int const x1 = min(depth_size.x, (int)ceil(vmax.x));
+        int const y1 = min(depth_size.y, (int)ceil(vmax.y));
+
+        for (int y = y0; y < y1; ++y)
+            for (int x = x0; x < x1; ++x)
+            {
+                /* The pixel is covered if its worst corner is inside
+                 * all four edges. */
+                bool covered = true;
+                for (vec3 const &f : e)
+                {
+                    float cx = f.x < 0.f ? x + 1.f : (float)x;
+                    float cy = f.y < 0.f ? y + 1.f : (float)y;
+                    covered = covered && f.x * cx + f.y * cy + f.z >= 0.f;
+                }
+
+                if (covered)
+                    m_depth[x][y] = min(m_depth[x][y], vmax.z);
+            }
+    }
+}
+
+/* A box is occluded if every depth buffer pixel touched by its screen
+ * rectangle is closer than its nearest point. */
+bool visibility::is_occluded(box3 const &b) const
+{
+    vec3 p[8];
+    if (!project_box(m_view_proj, b, p))
+        return false;
+
+    vec3 pmin = p[0], pmax = p[0];
+    for (int k = 1; k < 8; ++k)
+    {
+        pmin = min(pmin, p[k]);
+        pmax = max(pmax, p[k]);
+    }
+
+    int const x0 = max(0, (int)floor(pmin.x));
+    int const y0 = max(0, (int)floor(pmin.y));
+    int const x1 = min(depth_size.x, (int)ceil(pmax.x));
+    int const y1 = min(depth_size.y, (int)ceil(pmax.y));
+
+    if (x0 >= x1 || y0 >= y1)
+        return false;
+
+    for (int y = y0; y < y1; ++y)
+        for (int x = x0; x < x1; ++x)
+            if (m_depth[x][y] >= pmin.z)
+                return false;
+
+    return true;
+}
+
+} /* namespace lol */
+
@@ -0,0 +1,93 @@
+//
+//  Lol Engine
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  Lol Engine is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#pragma once
+
+//
+// The visibility class
+// --------------------
+// Decides which of a set of world space bounding boxes can be seen from
+// a camera. Boxes are first tested against the view frustum, optionally
+// through a bounding volume hierarchy, then against a coarse depth
+// buffer into which the boxes flagged as occluders are rasterised.
+//
+
+#include <cstdint>
+
+namespace lol
+{
+
+class visibility
+{
+public:
+    visibility();
+
+    /* Start a new query for the given view × projection matrix */
+    void reset(mat4 const &view_proj);
+
+    /* Add a box and return its index. Occluders must be entirely solid
+     * (for instance the inner box of a wall), because they are used to
+     * hide other boxes. */
+    int add(box3 const &bounds, bool occluder = false);
+
+    /* Compute visibility for all boxes added since the last reset() */
+    void cull(bool hierarchy, bool occlusion);
+
+    inline int count() const { return m_count; }
+    inline bool is_visible(int index) const { return m_state[index] == 0; }
+
+    /* Statistics for the last query; occluders are not counted */
+    inline int visible_count() const { return m_stats[0]; }
+    inline int frustum_culled_count() const { return m_stats[1]; }
+    inline int occlusion_culled_count() const { return m_stats[2]; }
+
+    /* Resolution of the occlusion depth buffer */
+    static ivec2 const depth_size;
+
+private:
+    void cull_range(int start, int end);
+    void cull_node(int node, bool inside);
+    void build_node(int node, int start, int end);
+    void rasterise_occluder(box3 const &b);
+    bool is_occluded(box3 const &b) const;
+
+    mat4 m_view_proj;
+    vec4 m_planes[6];
+
+    int m_count = 0;
+    int m_stats[3];
+    array<box3> m_boxes;
+    array<uint8_t> m_occluder;
+
+    /* 0 for visible, 1 for outside the frustum, 2 for occluded */
+    array<uint8_t> m_state;
+
+    /* Boxes as centres and half extents, in structure of arrays form so
+     * that several of them can be tested at once. They follow the order
+     * of m_order, which is the hierarchy order when it is used. */
+    array<float> m_cx, m_cy, m_cz, m_ex, m_ey, m_ez;
+    array<int> m_order;
+
+    /* Hierarchy nodes: bounds, then the range of boxes for leaves or
+     * the index of the first child (the second one follows) */
+    struct node
+    {
+        box3 m_bounds;
+        int m_start, m_end, m_child;
+    };
+    array<node> m_nodes;
+
+    array2d<float> m_depth;
+};
+
+} /* namespace lol */
+
@@ -0,0 +1,134 @@
+//
+//  lolpack — create Lol Engine pack files
+//
+//  Copyright © 2010—2019 Sam Hocevar <sam@hocevar.net>
+//
+//  This program is free software. It comes without any warranty, to
+//  the extent permitted by applicable law. You can redistribute it
+//  and/or modify it under the terms of the Do What the Fuck You Want
+//  to Public License, Version 2, as published by the WTFPL Task Force.
+//  See http://www.wtfpl.net/ for more details.
+//
+
+#if HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <lol/engine.h>
+
+using namespace lol;
+
+static void usage()
+{
+    printf("Usage: lolpack [OPTION]... -o PACK FILE...\n");
+    printf("Store FILEs in PACK, using their names as given. If FILE is -,\n");
+    printf("read file names from the standard input, one per line.\n");
+    printf("\n");
+    printf("  -o, --output PACK     pack file to create\n");
+    printf("  -C, --directory DIR   read files from DIR\n");
+    printf("  -a, --align N         align entries on N bytes (default 16)\n");
+    printf("  -0, --store           do not compress entries\n");
+    printf("  -h, --help            display this help and exit\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::string output, directory;
+    uint32_t alignment = 16;
+    bool compress = true;
+
+    lol::getopt opt(argc, argv);
+    opt.add_opt('o', "output", true);
+    opt.add_opt('C', "directory", true);
+    opt.add_opt('a', "align", true);
+    opt.add_opt('0', "store", false);
+    opt.add_opt('h', "help", false);
+
+    for (;;)
+    {
+        int c = opt.parse();
+        if (c == -1)
+            break;
+
+        switch (c)
+        {
+        case 'o':
+            output = opt.arg;
+            break;
+        case 'C':
+            directory = opt.arg;
+            if (directory.length() && directory.back() != '/')
+                directory += '/';
+            break;
+        case 'a':
+            alignment = (uint32_t)atoi(opt.arg);
+            break;
+        case '0':
+            compress = false;
+            break;
+        case 'h':
+            usage();
+            return EXIT_SUCCESS;
+        default:
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (output.empty() || opt.index >= argc
+         || !alignment || (alignment & (alignment - 1)))
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    array<std::string> names;
+    for (int i = opt.index; i < argc; ++i)
+    {
+        if (std::string(argv[i]) != "-")
+        {
+            names << argv[i];
+            continue;
+        }
+
+        for (std::string line; std::getline(std::cin, line); )
+            if (line.length())
+                names << line;
+    }
+
+    pack_writer writer(alignment);
+    size_t total = 0;
+    for (auto const &name : names)
+    {
+        File f;
+        f.Open(directory + name, FileAccess::Read, true);
+        if (!f.IsValid())
+        {
+            fprintf(stderr, "lolpack: cannot open %s\n", name.c_str());
+            return EXIT_FAILURE;
+        }
+
+        std::string data = f.ReadString();
+        f.Close();
+        total += data.size();
+        if (!writer.add(name, span<uint8_t const>((uint8_t const *)data.data(),
+                                                  data.size()), compress))
+            return EXIT_FAILURE;
+    }
+
+    if (!writer.save(output))
+        return EXIT_FAILURE;
+
+    File f;
+    f.Open(output, FileAccess::Read, true);
+    printf("%s: %d entries, %d unique, %d bytes in %d bytes\n", output.c_str(),
+           writer.count(), writer.blob_count(), (int)total, (int)f.size());
+
+    return EXIT_SUCCESS;
+}
+